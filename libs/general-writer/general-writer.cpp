@@ -29,6 +29,10 @@
 
 #include <kfc/defs.h>
 
+#include <zlib.h>
+
+#include <cstddef>
+
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -41,7 +45,7 @@ using namespace std;
 namespace ncbi
 {
 
-#if GW_CURRENT_VERSION <= 3
+#if GW_CURRENT_VERSION <= 4
     typedef :: gwp_1string_evt_v1 gwp_1string_evt;
     typedef :: gwp_2string_evt_v1 gwp_2string_evt;
     typedef :: gwp_column_evt_v1 gwp_column_evt;
@@ -49,9 +53,12 @@ namespace ncbi
     typedef :: gwp_1string_evt_U16_v1 gwp_1string_evt_U16;
     typedef :: gwp_2string_evt_U16_v1 gwp_2string_evt_U16;
     typedef :: gwp_data_evt_U16_v1 gwp_data_evt_U16;
-    #if GW_CURRENT_VERSION == 3
+    #if GW_CURRENT_VERSION >= 3
         typedef :: gwp_3string_evt_v1 gwp_3string_evt;
     #endif
+    #if GW_CURRENT_VERSION >= 4
+        typedef :: gwp_batch_evt_v1 gwp_batch_evt;
+    #endif
 #else
 #error "unrecognized GW version"
 #endif
@@ -870,6 +877,112 @@ namespace ncbi
         }
     }
 
+    template < class T > static
+    void append_ints ( vector < uint8_t > & out, const void * data, uint32_t elem_count )
+    {
+        const T * input = ( const T * ) data;
+        uint8_t packed [ 16 ];
+
+        for ( uint32_t i = 0; i < elem_count; ++ i )
+        {
+            int num_writ = encode_int < T > ( input [ i ], packed, packed + sizeof packed );
+            if ( num_writ <= 0 )
+                throw "error encoding integer data";
+            out . insert ( out . end (), packed, packed + num_writ );
+        }
+    }
+
+    void GeneralWriter :: writeBatch ( int stream_id, uint32_t elem_bits, const void *data,
+                                       const uint32_t *elem_counts, uint32_t nrows )
+    {
+        switch ( state )
+        {
+        case opened:
+            break;
+        default:
+            throw "state violation writing column batch";
+        }
+
+        if ( stream_id <= 0 )
+            throw "Stream_id is not valid";
+        if ( stream_id > ( int ) streams.size () )
+            throw "Stream_id is out of bounds";
+
+        if ( nrows == 0 )
+            return;
+
+        if ( elem_counts == 0 )
+            throw "Invalid elem_counts ptr";
+
+        const int_stream & s = streams [ stream_id - 1 ];
+
+        if ( elem_bits != s . elem_bits )
+            throw "Invalid elem_bits";
+
+        void ( * append ) ( vector < uint8_t > & out, const void * data, uint32_t elem_count ) = 0;
+        if ( ( s . flag_bits & 1 ) != 0 )
+        {
+            switch ( elem_bits )
+            {
+            case 16:
+                append = append_ints < uint16_t >;
+                break;
+            case 32:
+                append = append_ints < uint32_t >;
+                break;
+            case 64:
+                append = append_ints < uint64_t >;
+                break;
+            default:
+                throw "INTERNAL ERROR: corrupt element bits";
+            }
+        }
+
+        batch_counts . clear ();
+        batch_cells . clear ();
+
+        // room for the packed element count of the next cell
+        const size_t count_max = 5;
+
+        const uint8_t * dp = ( const uint8_t * ) data;
+        uint32_t first = 0;
+        for ( uint32_t row = 0; row < nrows; ++ row )
+        {
+            size_t num_bytes = ( ( size_t ) elem_bits * elem_counts [ row ] + 7 ) / 8;
+            if ( num_bytes != 0 && dp == 0 )
+                throw "Invalid data ptr";
+
+            size_t cell_start = batch_cells . size ();
+            if ( append != 0 )
+                ( * append ) ( batch_cells, dp, elem_counts [ row ] );
+            else
+                batch_cells . insert ( batch_cells . end (), dp, dp + num_bytes );
+            dp += num_bytes;
+
+            if ( batch_counts . size () + batch_cells . size () + count_max > BATCH_LIMIT )
+            {
+                if ( row == first )
+                    throw "cell-data exceeds batch maximum";
+
+                // send the rows before this one, it starts the next batch
+                vector < uint8_t > cell ( batch_cells . begin () + cell_start, batch_cells . end () );
+                batch_cells . resize ( cell_start );
+                write_batch_event ( stream_id, row - first );
+
+                batch_counts . clear ();
+                batch_cells . swap ( cell );
+                first = row;
+
+                if ( batch_cells . size () + count_max > BATCH_LIMIT )
+                    throw "cell-data exceeds batch maximum";
+            }
+
+            append_ints < uint32_t > ( batch_counts, & elem_counts [ row ], 1 );
+        }
+
+        write_batch_event ( stream_id, nrows - first );
+    }
+
     void GeneralWriter :: nextRow ( int table_id )
     {
         switch ( state )
@@ -908,6 +1021,48 @@ namespace ncbi
         write_event ( & hdr . dad, sizeof hdr );
     }
 
+    void GeneralWriter :: nextRows ( int table_id, uint64_t nrows )
+    {
+        switch ( state )
+        {
+        case opened:
+            break;
+        default:
+            throw "state violation committing batched rows";
+        }
+
+        if ( table_id <= 0 || ( size_t ) table_id > tables.size () )
+            throw "Invalid table id";
+
+        if ( nrows == 0 )
+            return;
+
+        require_batch_version ();
+
+        gwp_move_ahead_evt_v1 hdr;
+        init ( hdr, table_id, evt_next_rows );
+        set_nrows ( hdr, nrows );
+        write_event ( & hdr . dad, sizeof hdr );
+    }
+
+    void GeneralWriter :: setBatchCompression ( gw_batch_codec codec, int level )
+    {
+        switch ( codec )
+        {
+        case gw_batch_none:
+            break;
+        case gw_batch_zlib:
+            if ( level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION )
+                throw "Invalid compression level";
+            break;
+        default:
+            throw "Invalid batch codec";
+        }
+
+        batch_codec = codec;
+        batch_level = level;
+    }
+
     void GeneralWriter :: logError ( const  string & msg )
     {
         switch ( state )
@@ -1035,9 +1190,13 @@ namespace ncbi
         , byte_count ( 0 )
         , pid ( getpid () )
         , packing_buffer ( 0 )
+        , batch_codec ( gw_batch_none )
+        , batch_level ( -1 )
         , output_buffer ( 0 )
         , output_bsize ( bsize )
         , output_marker ( 0 )
+        , header_version ( GW_BASE_VERSION )
+        , header_flushed ( false )
         , out_fd ( -1 )
         , state ( uninitialized )
     {
@@ -1058,9 +1217,13 @@ namespace ncbi
         , byte_count ( 0 )
         , pid ( getpid () )
         , packing_buffer ( 0 )
+        , batch_codec ( gw_batch_none )
+        , batch_level ( -1 )
         , output_buffer ( 0 )
         , output_bsize ( buffer_size )
         , output_marker ( 0 )
+        , header_version ( GW_BASE_VERSION )
+        , header_flushed ( false )
         , out_fd ( _out_fd )
         , state ( uninitialized )
     {
@@ -1120,6 +1283,7 @@ namespace ncbi
     {
         :: gw_header_v1 hdr;
         init ( hdr );
+        hdr . dad . version = header_version;
         internal_write ( & hdr, sizeof hdr );
         state = header_written;
 
@@ -1143,6 +1307,7 @@ namespace ncbi
 
             output_marker = 0;
         }
+        header_flushed = true;
     }
 
     void GeneralWriter :: internal_write ( const void * data, size_t num_bytes )
@@ -1179,6 +1344,97 @@ namespace ncbi
         }
     }
 
+    void GeneralWriter :: write_batch_event ( int stream_id, uint32_t nrows )
+    {
+        size_t raw_size = batch_counts . size () + batch_cells . size ();
+        assert ( raw_size <= BATCH_LIMIT );
+
+        require_batch_version ();
+
+        gwp_batch_evt hdr;
+        init ( hdr, stream_id, evt_cell_batch );
+        set_nrows ( hdr, nrows );
+        set_raw_size ( hdr, raw_size );
+
+        if ( batch_codec != gw_batch_none && compress_batch ( raw_size ) )
+        {
+            set_codec ( hdr, batch_codec );
+            set_size ( hdr, batch_compressed . size () );
+            write_event ( & hdr . dad, sizeof hdr );
+            internal_write ( batch_compressed . data (), batch_compressed . size () );
+        }
+        else
+        {
+            set_size ( hdr, raw_size );
+            write_event ( & hdr . dad, sizeof hdr );
+            internal_write ( batch_counts . data (), batch_counts . size () );
+            if ( ! batch_cells . empty () )
+                internal_write ( batch_cells . data (), batch_cells . size () );
+        }
+    }
+
+    // the header was written with GW_BASE_VERSION: patch it in place
+    void GeneralWriter :: require_batch_version ()
+    {
+        if ( header_version >= GW_BATCH_VERSION )
+            return;
+
+        uint32_t version = GW_BATCH_VERSION;
+        size_t offset = offsetof ( :: gw_header, version );
+        if ( out_fd < 0 )
+        {
+            streampos pos = out . tellp ();
+            out . seekp ( offset );
+            out . write ( ( const char * ) & version, sizeof version );
+            out . seekp ( pos );
+            if ( ! out )
+                throw "cannot raise the stream header to version 4 for batch events";
+        }
+        else if ( ! header_flushed )
+        {
+            // writeHeader () put it at the start of the buffer
+            memmove ( & output_buffer [ offset ], & version, sizeof version );
+        }
+        else if ( :: pwrite ( out_fd, & version, sizeof version, offset ) != ( ssize_t ) sizeof version )
+        {
+            throw "cannot raise the stream header to version 4 for batch events: header already sent";
+        }
+        header_version = version;
+    }
+
+    // false if the payload does not get any smaller
+    bool GeneralWriter :: compress_batch ( size_t raw_size )
+    {
+        assert ( batch_codec == gw_batch_zlib );
+
+        z_stream zs;
+        memset ( & zs, 0, sizeof zs );
+        if ( deflateInit ( & zs, batch_level ) != Z_OK )
+            throw "failed to initialize batch compression";
+
+        batch_compressed . resize ( deflateBound ( & zs, raw_size ) );
+        zs . next_out = batch_compressed . data ();
+        zs . avail_out = ( uInt ) batch_compressed . size ();
+
+        zs . next_in = batch_counts . data ();
+        zs . avail_in = ( uInt ) batch_counts . size ();
+        int zrc = deflate ( & zs, Z_NO_FLUSH );
+        if ( zrc == Z_OK )
+        {
+            zs . next_in = batch_cells . data ();
+            zs . avail_in = ( uInt ) batch_cells . size ();
+            zrc = deflate ( & zs, Z_FINISH );
+        }
+        size_t compressed_size = zs . total_out;
+        deflateEnd ( & zs );
+
+        if ( zrc != Z_STREAM_END || compressed_size >= raw_size )
+            return false;
+
+        batch_compressed . resize ( compressed_size );
+        return true;
+    }
+
     void GeneralWriter :: write_event ( const gwp_evt_hdr * e, size_t evt_size )
     {
 #if PROGRESS_EVENT
@@ -29,6 +29,8 @@
 
 #include <kfs/defs.h>
 
+#include <zlib.h>
+
 #include <iostream>
 #include <vector>
 #include <algorithm>
@@ -491,16 +493,17 @@ namespace gw_dump
     }
 
     /* dump_move_ahead
+     *  also used for next-rows, which shares the event structure
      */
     template < class D, class T > static
-    void dump_move_ahead ( FILE * in, const D & e )
+    void dump_move_ahead ( FILE * in, const D & e, const char * type = "move-ahead" )
     {
         T eh;
         init ( eh, e );
 
         size_t num_read = readFILE ( eh . nrows, sizeof eh - sizeof ( D ), 1, in );
         if ( num_read != 1 )
-            throw "failed to read move-ahead event";
+            throw "failed to read move-ahead or next-rows event";
 
         check_move_ahead ( eh );
 
@@ -515,7 +518,7 @@ namespace gw_dump
         switch (display) {
         case 1:
             std :: cout
-                << event_num << ": move-ahead\n"
+                << event_num << ": " << type << '\n'
                 << "  table_id = " << tableId << " ( \"" << tbl_name << "\" )\n"
                 << "  nrows = " << nrows << '\n'
                 << "  row_id = " << te . row_id << '\n'
@@ -523,7 +526,7 @@ namespace gw_dump
             break;
         case 2:
             std::cout
-                << "{ \"event\": \"move-ahead\""
+                << "{ \"event\": \"" << type << "\""
                    ", \"table-id\": " << tableId
                 << ", \"rows\": " << nrows
                 << " }\n";
@@ -983,6 +986,150 @@ namespace gw_dump
     }
 
 
+    /* check_cell_batch
+     *  all:
+     *    0 < id <= count ( columns )
+     *    known codec
+     *    payload sizes within limit
+     */
+    static
+    void check_cell_batch ( const gwp_batch_evt_v1 & eh )
+    {
+        check_cell_event ( eh );
+
+        if ( codec ( eh ) >= gw_batch_max_codec )
+            throw "unknown codec within cell-batch event";
+        if ( eh . reserved != 0 )
+            throw "non-zero reserved byte within cell-batch event";
+        if ( raw_size ( eh ) > BATCH_LIMIT || size ( eh ) > BATCH_LIMIT )
+            throw "cell-batch payload exceeds maximum";
+        if ( codec ( eh ) == gw_batch_none && size ( eh ) != raw_size ( eh ) )
+            throw "bad payload size within cell-batch event";
+    }
+
+    /* dump_cell_batch
+     */
+    static
+    void dump_cell_batch ( FILE * in, const gwp_evt_hdr_v1 & e )
+    {
+        gwp_batch_evt_v1 eh;
+        init ( eh, e );
+
+        size_t num_read = readFILE ( & eh . codec, sizeof eh - sizeof e, 1, in );
+        if ( num_read != 1 )
+            throw "failed to read cell-batch event";
+
+        check_cell_batch ( eh );
+
+        auto const data_size = size ( eh );
+        auto data_buffer = std::vector<uint8_t>(data_size);
+        if (data_size != readFILE(data_buffer.data(), 1, data_size, in))
+            throw "failed to read cell-batch payload";
+
+        auto const payload_size = raw_size ( eh );
+        auto payload = std::vector<uint8_t>();
+        if ( codec ( eh ) == gw_batch_zlib )
+        {
+            payload . resize ( payload_size );
+            uLongf inflated = payload_size;
+            if ( uncompress ( payload . data (), & inflated, data_buffer . data (), data_size ) != Z_OK || inflated != payload_size )
+                throw "corrupt compressed payload within cell-batch event";
+        }
+        else
+        {
+            payload . swap ( data_buffer );
+        }
+
+        // element counts, one per row
+        auto const nrows = get_nrows ( eh );
+        const uint8_t * start = payload . data ();
+        const uint8_t * end = start + payload_size;
+        uint64_t total_elems = 0;
+        size_t unpacked_size = 0;
+        auto const columnId = id(eh.dad);
+        col_entry const &entry = col_entries[columnId - 1];
+        for ( uint32_t row = 0; row < nrows; ++ row )
+        {
+            uint32_t elem_count;
+            int num_count = decode_int < uint32_t > ( start, end, & elem_count );
+            if ( num_count <= 0 )
+                throw "corrupt element counts within cell-batch event";
+            start += num_count;
+            total_elems += elem_count;
+            unpacked_size += ( ( size_t ) entry . elem_bits * elem_count + 7 ) / 8;
+        }
+
+        bool packed_int = false;
+        size_t const cells_size = end - start;
+        if ( ( entry . flag_bits & 1 ) != 0 )
+        {
+            size_t cells_unpacked;
+            switch ( entry . elem_bits )
+            {
+            case 16:
+                cells_unpacked = check_int_packing < uint16_t > ( start, cells_size );
+                break;
+            case 32:
+                cells_unpacked = check_int_packing < uint32_t > ( start, cells_size );
+                break;
+            case 64:
+                cells_unpacked = check_int_packing < uint64_t > ( start, cells_size );
+                break;
+            default:
+                throw "bad element size for packed integer";
+            }
+            if ( cells_unpacked != unpacked_size )
+                throw "element counts do not match packed data within cell-batch event";
+
+            packed_int = true;
+        }
+        else if ( cells_size != unpacked_size )
+        {
+            throw "element counts do not match data within cell-batch event";
+        }
+
+        switch (display) {
+        case 1:
+            std :: cout
+                << event_num << ": cell-batch\n"
+                   "  stream_id = " << columnId << " ( " << tbl_entries[entry.table_id - 1].tbl_name << " . " << entry . spec << " )\n"
+                   "  elem_bits = " << entry . elem_bits << '\n'
+                << "  nrows = " << nrows << '\n'
+                ;
+            if ( packed_int )
+            {
+                std :: cout
+                    << "  elem_count = " << total_elems
+                    << " ( " << unpacked_size << " bytes, " << cells_size << " packed )\n"
+                    ;
+            }
+            else
+            {
+                std :: cout
+                    << "  elem_count = " << total_elems << " ( " << unpacked_size << " bytes )\n"
+                    ;
+            }
+            if ( codec ( eh ) == gw_batch_zlib )
+            {
+                std :: cout
+                    << "  codec = zlib ( " << payload_size << " bytes, " << data_size << " compressed )\n"
+                    ;
+            }
+            break;
+        case 2:
+            std::cout
+                << "{ \"event\": \"batch\""
+                   ", \"column-id\": " << columnId
+                << ", \"rows\": " << nrows
+                << ", \"elements\": " << total_elems
+                << ", \"codec\": \"" << ( codec ( eh ) == gw_batch_zlib ? "zlib" : "none" ) << "\""
+                   ", \"data\": \"<batch data>\""
+                   " }\n";
+            break;
+        }
+    }
+
+
     /* check_open_stream
      */
     static
@@ -1981,6 +2128,11 @@ namespace gw_dump
         case evt_col_metadata_node_attr2:
             throw "packed event id within non-packed stream";
 
+            // version 4 messages are only packed
+        case evt_cell_batch:
+        case evt_next_rows:
+            throw "packed event id within non-packed stream";
+
         default:
             throw "unrecognized event id";
         }
@@ -2123,6 +2275,14 @@ namespace gw_dump
             dump_metadata_node_attr < gwp_evt_hdr_v1, gwp_3string_evt_U16_v1 > ( in, e, mnr_column );
             break;
 
+            // add in new message handlers for version 4
+        case evt_cell_batch:
+            dump_cell_batch ( in, e );
+            break;
+        case evt_next_rows:
+            dump_move_ahead < gwp_evt_hdr_v1, gwp_move_ahead_evt_v1 > ( in, e, "next-rows" );
+            break;
+
 
         default:
             throw "unrecognized packed event id";
@@ -2204,6 +2364,7 @@ namespace gw_dump
         case 1:
         case 2:
         case 3:
+        case 4:
             dump_v1_header ( in, hdr, packed );
             break;
         default:
@@ -2227,6 +2388,7 @@ namespace gw_dump
         case 1:
         case 2:
         case 3:
+        case 4:
             if (packed)
                 dumper = dump_v1_packed_event;
 
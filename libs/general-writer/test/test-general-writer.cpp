@@ -29,6 +29,7 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <vector>
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
@@ -175,6 +176,48 @@ namespace ncbi
         free ( columns );
     }
 
+    void testWriteBatch ( GeneralWriter *gw, int table_id, int *stream_ids, int column_count, const char *file_names [] )
+    {
+        // the lines of each column file again, as one batch per column
+        uint64_t nrows = 0;
+        for ( int i = 0; i < column_count; ++ i )
+        {
+            ifstream column ( file_names [ i ] );
+            if ( ! column )
+                throw "Error opening column file";
+
+            string data;
+            vector < uint32_t > elem_counts;
+            string line;
+            while ( getline ( column, line ) )
+            {
+                data += line;
+                elem_counts . push_back ( line . size () );
+            }
+
+            gw -> writeBatch ( stream_ids [ i ], 8, data . data (), elem_counts . data (), elem_counts . size () );
+            nrows = elem_counts . size ();
+        }
+        gw -> nextRows ( table_id, nrows );
+
+        // repetitive cells make for a compressed payload
+        const uint32_t compressed_rows = 100;
+        string data;
+        vector < uint32_t > elem_counts;
+        for ( uint32_t row = 0; row < compressed_rows; ++ row )
+        {
+            string cell ( 20 + row % 10, "ACGT" [ row % 4 ] );
+            data += cell;
+            elem_counts . push_back ( cell . size () );
+        }
+
+        gw -> setBatchCompression ( gw_batch_zlib );
+        for ( int i = 0; i < column_count; ++ i )
+            gw -> writeBatch ( stream_ids [ i ], 8, data . data (), elem_counts . data (), compressed_rows );
+        gw -> nextRows ( table_id, compressed_rows );
+        gw -> setBatchCompression ( gw_batch_none );
+    }
+
     void testAddDBMetadataNode ( GeneralWriter *gw, const char * node, const char *value )
     {
         gw -> setDBMetadataNode ( 0, node, value );
@@ -227,7 +270,7 @@ namespace ncbi
         }
     }
 
-    void runTest ( int column_count, const char * columns [], const char *outfile, const char * schema_path )
+    void runTest ( int column_count, const char * columns [], const char *outfile, const char * schema_path, bool batches )
     {
         GeneralWriter *gw;
         try
@@ -262,6 +305,14 @@ namespace ncbi
             std :: cerr << "write Success" << std :: endl;
             std :: cerr << "---------------------------------" << std :: endl;
 
+            // batch events make it a version 4 stream
+            if ( batches )
+            {
+                testWriteBatch ( gw, table_id, stream_ids, column_count, column_names );
+                std :: cerr << "writeBatch Success" << std :: endl;
+                std :: cerr << "---------------------------------" << std :: endl;
+            }
+
             testAddDBMetadataNode ( gw, "db_metadata_node", "01a2b3c4d" );
             std :: cerr << "setDBMetadataNode Success" << std :: endl;
             std :: cerr << "---------------------------------" << std :: endl;
@@ -320,10 +371,12 @@ int main ( int argc, char * argv [] )
 
     try
     {
-        const char *outfile = "./actual/test-general-writer.gw";
+        // --batch: the same stream with batch events added, written to its own file
+        bool batches = ( argc > 1 && strcmp ( argv [ 1 ], "--batch" ) == 0 );
+        const char *outfile = batches ? "./actual/test-general-writer-v4.gw" : "./actual/test-general-writer.gw";
         const char *schema_path = "./test-general-writer.vschema";
         const char * columns [ 2 ] = { "input/column01", "input/column02" };
-        ncbi :: runTest ( 2, columns, outfile, schema_path );
+        ncbi :: runTest ( 2, columns, outfile, schema_path, batches );
 
         status = 0;
 
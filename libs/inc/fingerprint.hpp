@@ -148,6 +148,11 @@ public:
             accum[index++].record(base);
         accum[index].recordEnd();
     }
+    /// Adds count to the counter of base at position; base 0 is the end of read.
+    /// Used to rebuild or combine fingerprints from their JSON form.
+    void record(char base, size_t position, uint64_t count) {
+        accum[position][base] += count;
+    }
 
     friend 
     JSON_ostream &operator <<(JSON_ostream &out, Fingerprint const &self)
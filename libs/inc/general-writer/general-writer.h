@@ -88,19 +88,41 @@ enum gw_evt_id
     evt_tbl_metadata_node_attr2,
     evt_col_metadata_node_attr2,
 
+    /* BEGIN VERSION 4 MESSAGES */
+    evt_cell_batch,                       /* cells of N rows of a column */
+    evt_next_rows,                        /* commit N rows of a table    */
+
     evt_max_id                            /* must be last                */
 };
 
 #define GW_SIGNATURE "NCBIgnld"
 #define GW_GOOD_ENDIAN 1
 #define GW_REVERSE_ENDIAN ( 1 << 24 )
-#define GW_CURRENT_VERSION 3
+#define GW_CURRENT_VERSION 4
+
+/* GeneralWriter announces GW_BATCH_VERSION only in streams that carry
+   evt_cell_batch or evt_next_rows, all others stay at GW_BASE_VERSION:
+   readers built before version 4 reject any higher version */
+#define GW_BASE_VERSION 3
+#define GW_BATCH_VERSION 4
 
 //These are not to change
 #define STRING_LIMIT_8 0x100
 #define STRING_LIMIT_16 0x10000
 #define ID_LOWER_LIMIT 0
 #define ID_UPPER_LIMIT 255
+#define BATCH_LIMIT 0x1000000
+
+/*----------------------------------------------------------------------
+ * cell batch payload codecs
+ */
+enum gw_batch_codec
+{
+    gw_batch_none,                        /* payload is sent as-is       */
+    gw_batch_zlib,                        /* payload is a zlib stream    */
+
+    gw_batch_max_codec                    /* must be last                */
+};
 
 /********************************
  * DESCRIPTION OF STREAM EVENTS *
@@ -173,6 +195,27 @@ enum gw_evt_id
     follow with the bytes in path
       write ( path, strlen ( path ) );
 
+ 3. CELL BATCHES [ VERSION 4, PACKED ONLY ]
+    The cells of one column for a run of rows can be sent in a single
+    event instead of one data event per cell, use "gwp_batch_evt".
+      GWP_SET_ID_EVT ( & evt.dad, column_id, evt_cell_batch );
+      evt.nrows = nrows - 1;
+      evt.raw_sz = sizeof payload - 1;
+    the payload is the element counts of the nrows cells, each packed
+    with encode_uint32, followed by the data of the cells in row order,
+    each cell starting on a byte boundary. The data of integer packed
+    columns are packed as in "evt_cell_data".
+    When evt.codec != gw_batch_none, the payload is compressed.
+      evt.sz = sizeof compressed payload - 1;
+    follow with the bytes of the ( compressed ) payload
+      write ( payload, evt.sz + 1 );
+    neither size may exceed BATCH_LIMIT.
+
+    A batch is held by the receiver until "evt_next_rows" commits
+    its rows; the event uses "gwp_move_ahead_evt" and every batch
+    pending for the table must have exactly that many rows.
+    Batches of the same column before the commit are appended.
+
   MORE TO COME...
 
  */
@@ -420,6 +463,23 @@ struct gwp_move_ahead_evt_v1
     uint16_t nrows [ 4 ]; /* the number of rows to move ahead                 */
 };
 
+/* gwp_batch_evt_v1
+ *  event used to transfer the cells of a column for a run of rows
+ *
+ *  used for events:
+ *    { evt_cell_batch }
+ */
+struct gwp_batch_evt_v1
+{
+    gwp_evt_hdr_v1 dad;   /* common header : id = column id                   */
+    uint8_t codec;        /* gw_batch_codec of the payload                    */
+    uint8_t reserved;     /* must be 0                                        */
+    uint16_t nrows [ 2 ]; /* the number - 1 of rows in the batch              */
+    uint16_t raw_sz [ 2 ];/* the size - 1 of the payload before compression   */
+    uint16_t sz [ 2 ];    /* the size - 1 of the payload in bytes             */
+ /* uint8_t data [ sz+1 ]; * payload                                          */
+};
+
 
 /* SPECIAL VERSIONS WITH 16-BIT SIZE FIELDS */
 
@@ -1007,6 +1067,68 @@ namespace ncbi
     }
 
 
+    // gwp_batch_evt_v1
+    inline void init ( :: gwp_batch_evt_v1 & hdr, uint32_t id, gw_evt_id evt )
+    {
+        init ( hdr . dad, id, evt );
+        hdr . codec = hdr . reserved = 0;
+        memset ( & hdr . nrows, 0, sizeof hdr . nrows );
+        memset ( & hdr . raw_sz, 0, sizeof hdr . raw_sz );
+        memset ( & hdr . sz, 0, sizeof hdr . sz );
+    }
+    inline void init ( :: gwp_batch_evt_v1 & hdr, const :: gwp_evt_hdr_v1 & dad )
+    {
+        hdr . dad = dad;
+        hdr . codec = hdr . reserved = 0;
+        memset ( & hdr . nrows, 0, sizeof hdr . nrows );
+        memset ( & hdr . raw_sz, 0, sizeof hdr . raw_sz );
+        memset ( & hdr . sz, 0, sizeof hdr . sz );
+    }
+
+    inline gw_batch_codec codec ( const :: gwp_batch_evt_v1 & self )
+    { return ( gw_batch_codec ) self . codec; }
+
+    inline void set_codec ( :: gwp_batch_evt_v1 & self, gw_batch_codec codec )
+    {
+        assert ( codec < gw_batch_max_codec );
+        self . codec = ( uint8_t ) codec;
+    }
+
+    // the 32-bit fields are stored as length - 1 in a pair of 16-bit words
+    inline uint32_t get_batch_field ( const uint16_t self [ 2 ] )
+    {
+        uint32_t val;
+        memmove ( & val, self, sizeof val );
+        return val + 1;
+    }
+
+    inline void set_batch_field ( uint16_t self [ 2 ], size_t val )
+    {
+        assert ( val != 0 );
+        assert ( val <= 0x100000000ULL );
+        uint32_t stored = ( uint32_t ) ( val - 1 );
+        memmove ( self, & stored, sizeof stored );
+    }
+
+    inline uint32_t get_nrows ( const :: gwp_batch_evt_v1 & self )
+    { return get_batch_field ( self . nrows ); }
+
+    inline void set_nrows ( :: gwp_batch_evt_v1 & self, uint32_t nrows )
+    { set_batch_field ( self . nrows, nrows ); }
+
+    inline uint32_t raw_size ( const :: gwp_batch_evt_v1 & self )
+    { return get_batch_field ( self . raw_sz ); }
+
+    inline void set_raw_size ( :: gwp_batch_evt_v1 & self, size_t bytes )
+    { set_batch_field ( self . raw_sz, bytes ); }
+
+    inline uint32_t size ( const :: gwp_batch_evt_v1 & self )
+    { return get_batch_field ( self . sz ); }
+
+    inline void set_size ( :: gwp_batch_evt_v1 & self, size_t bytes )
+    { set_batch_field ( self . sz, bytes ); }
+
+
     // recording string size
     inline void set_string_size ( uint16_t & sz, size_t bytes )
     {
@@ -42,7 +42,7 @@
 
 namespace ncbi
 {
-#if GW_CURRENT_VERSION <= 3
+#if GW_CURRENT_VERSION <= 4
     typedef :: gwp_evt_hdr_v1 gwp_evt_hdr;
 #else
 #error "unrecognized GW version"
@@ -128,9 +128,27 @@ namespace ncbi
         // may be repeated as often as necessary to complete a single cell's data
         void write ( int stream_id, uint32_t elem_bits, const void *data, uint32_t elem_count );
 
+        // generate the cells of a column for nrows consecutive rows
+        // data holds the cells back to back, each starting on a byte boundary,
+        // elem_counts [ i ] is the number of elements in the i-th cell
+        // the rows are committed by nextRows ()
+        void writeBatch ( int stream_id, uint32_t elem_bits, const void *data,
+                          const uint32_t *elem_counts, uint32_t nrows );
+
         // commit and close current row, move to next row
         void nextRow ( int table_id );
 
+        // commit the rows of the pending batches of the table, one row at a time
+        void nextRows ( int table_id, uint64_t nrows );
+
+        // writeBatch and nextRows raise the stream's header to GW_BATCH_VERSION:
+        // on a pipe, that is only possible while the header has not been flushed,
+        // i.e. the first batch has to follow within the first buffer_size bytes
+
+        // compress the payload of subsequent batches
+        // level is the codec's own, -1 for its default
+        void setBatchCompression ( gw_batch_codec codec, int level = -1 );
+
         // commit and close current row, move ahead by nrows
         void moveAhead ( int table_id, uint64_t nrows );
 
@@ -161,6 +179,9 @@ namespace ncbi
         void writeHeader ();
         void internal_write ( const void *data, size_t num_bytes );
         void write_event ( const gwp_evt_hdr * evt, size_t evt_size );
+        void write_batch_event ( int stream_id, uint32_t nrows );
+        void require_batch_version ();
+        bool compress_batch ( size_t raw_size );
         void flush ();
 
         uint32_t getPid () const { return ( uint32_t ) pid; }
@@ -220,10 +241,21 @@ namespace ncbi
 
         uint8_t * packing_buffer;
 
+        // payload of the batch being built: packed element counts, then cells
+        std :: vector < uint8_t > batch_counts;
+        std :: vector < uint8_t > batch_cells;
+        std :: vector < uint8_t > batch_compressed;
+        gw_batch_codec batch_codec;
+        int batch_level;
+
         uint8_t * output_buffer;
         size_t output_bsize;
         size_t output_marker;
 
+        // version announced by the header, and whether the header has left output_buffer
+        uint32_t header_version;
+        bool header_flushed;
+
         int out_fd;
 
         enum stream_state
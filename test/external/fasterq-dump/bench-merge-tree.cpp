@@ -0,0 +1,68 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*/
+
+/**
+* Benchmark for tools/external/fasterq-dump/merge_tree.c
+*
+* usage: bench-merge-tree
+*
+* Merges 1M entries from 2 to 256 sorted sources with the linear scan and with
+* the loser-tree and reports M entries/s for both. Not run by ctest, build it
+* with "make bench-merge-tree" and run it by hand.
+*/
+
+#include "merge-tree-sources.hpp"
+
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+int main ( void )
+{
+    const size_t total = 1000000;
+    cout << "sources\tlinear (M entries/s)\tloser-tree (M entries/s)" << endl;
+    for ( uint32_t count = 2; count <= 256; count *= 2 ) {
+        auto src1 = make_sources( count, total / count, count );
+        auto src2 = src1;
+
+        auto t0 = chrono::steady_clock::now();
+        size_t n1 = linear_merge( src1, nullptr );
+        auto t1 = chrono::steady_clock::now();
+        size_t n2 = tree_merge( src2, nullptr );
+        auto t2 = chrono::steady_clock::now();
+        if ( n1 != n2 ) {
+            cerr << "the loser-tree merged " << n2 << " entries instead of " << n1 << endl;
+            return 1;
+        }
+
+        double s1 = chrono::duration< double >( t1 - t0 ) . count();
+        double s2 = chrono::duration< double >( t2 - t1 ) . count();
+        cout << count << "\t"
+             << ( s1 > 0 ? n1 / s1 / 1e6 : 0 ) << "\t"
+             << ( s2 > 0 ? n2 / s2 / 1e6 : 0 ) << endl;
+    }
+    return 0;
+}
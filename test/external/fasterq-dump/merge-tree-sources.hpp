@@ -0,0 +1,102 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*/
+
+/**
+* Sorted sources and the two ways to merge them, for test-merge-tree and bench-merge-tree
+*/
+
+#ifndef _h_merge_tree_sources_
+#define _h_merge_tree_sources_
+
+#include <merge_tree.h>
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+/* a sorted run of keys, standing in for a lookup-file or a KVector */
+struct Source {
+    std::vector< uint64_t > keys;
+    size_t pos = 0;
+    bool valid() const { return pos < keys.size(); }
+    uint64_t key() const { return valid() ? keys[ pos ] : 0; }
+};
+
+inline std::vector< Source > make_sources( uint32_t count, size_t per_source, uint32_t seed ) {
+    std::mt19937_64 rng( seed );
+    std::vector< Source > res( count );
+    for ( auto & src : res ) {
+        uint64_t key = rng() % 16;
+        src . keys . reserve( per_source );
+        for ( size_t i = 0; i < per_source; ++i ) {
+            key += rng() % 16;
+            src . keys . push_back( key );
+        }
+    }
+    return res;
+}
+
+/* merge via the loser-tree, returns the number of merged entries */
+inline size_t tree_merge( std::vector< Source > & src, std::vector< uint64_t > * out ) {
+    struct merge_tree_t * tree = nullptr;
+    if ( 0 != make_merge_tree( &tree, ( uint32_t )src . size() ) ) {
+        throw std::logic_error( "make_merge_tree() failed" );
+    }
+    for ( uint32_t i = 0; i < src . size(); ++i ) {
+        merge_tree_set( tree, i, src[ i ] . valid(), src[ i ] . key() );
+    }
+    merge_tree_build( tree );
+    size_t n = 0;
+    uint32_t idx;
+    while ( merge_tree_winner( tree, &idx ) ) {
+        Source & s = src[ idx ];
+        if ( nullptr != out ) { out -> push_back( s . key() ); }
+        ++n;
+        s . pos++;
+        merge_tree_update( tree, s . valid(), s . key() );
+    }
+    release_merge_tree( tree );
+    return n;
+}
+
+/* the linear scan fasterq-dump used before the loser-tree */
+inline size_t linear_merge( std::vector< Source > & src, std::vector< uint64_t > * out ) {
+    size_t n = 0;
+    while ( true ) {
+        Source * min = nullptr;
+        for ( auto & s : src ) {
+            if ( s . valid() && ( nullptr == min || s . key() < min -> key() ) ) {
+                min = &s;
+            }
+        }
+        if ( nullptr == min ) { break; }
+        if ( nullptr != out ) { out -> push_back( min -> key() ); }
+        ++n;
+        min -> pos++;
+    }
+    return n;
+}
+
+#endif
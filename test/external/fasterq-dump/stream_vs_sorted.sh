@@ -0,0 +1,123 @@
+#!/usr/bin/env bash
+# ================================================================
+#
+#   Test :
+#       does the stream-mode of fasterq-dump produce the same reads
+#       as the sorted mode? ( bases of READ_TYPE REVERSE reads included )
+#
+#   we need sam-factory and bam-load to create such a cSRA,
+#   because we want to avoid to depend on production accessions
+#
+# ================================================================
+
+set -e
+
+DIRTOTEST="$1"
+BINDIR="$2"
+
+SAMFACTORY="${DIRTOTEST}/sam-factory"
+if [[ ! -x $SAMFACTORY ]]; then
+    SAMFACTORY="${BINDIR}/sam-factory"
+    if [[ ! -x $SAMFACTORY ]]; then
+        echo "${SAMFACTORY} not found - exiting..."
+        exit 3
+    fi
+fi
+
+BAMLOAD="${DIRTOTEST}/bam-load"
+if [[ ! -x $BAMLOAD ]]; then
+    echo "${BAMLOAD} not found - exiting(skipped)..."
+    exit 0
+fi
+
+KAR="${DIRTOTEST}/kar"
+if [[ ! -x $KAR ]]; then
+    echo "${KAR} not found - exiting..."
+    exit 3
+fi
+
+FASTERQDUMP="${DIRTOTEST}/fasterq-dump"
+if [[ ! -x $FASTERQDUMP ]]; then
+    echo "${FASTERQDUMP} not found - exiting..."
+    exit 3
+fi
+
+echo -e "\ntesting ${FASTERQDUMP} --stream against the sorted mode"
+
+SAM_FACTORY_CONFIG="stream_vs_sorted.sf"
+if [[ ! -f $SAM_FACTORY_CONFIG ]]; then
+    echo "${SAM_FACTORY_CONFIG} not found - exiting..."
+    exit 3
+fi
+
+#then next 2 names have to match what is defined in SAM_FACTORY_CONFIG!
+BAM_LOAD_SAM="stream_vs_sorted.sam"
+BAM_LOAD_REF="stream_vs_sorted.fasta"
+
+rm -rf "${BAM_LOAD_SAM}" "${BAM_LOAD_REF}"
+
+#=======================================================
+cat "${SAM_FACTORY_CONFIG}" | "${SAMFACTORY}"
+#=======================================================
+
+if [[ ! -f $BAM_LOAD_SAM || ! -f $BAM_LOAD_REF ]]; then
+    echo "${BAM_LOAD_SAM} or ${BAM_LOAD_REF} was not created by sam-factory - exiting..."
+    exit 3
+fi
+
+BAM_LOAD_OUTDIR="STREAM_VS_SORTED.DIR"
+rm -rf "${BAM_LOAD_OUTDIR}"
+#=======================================================
+${BAMLOAD} ${BAM_LOAD_SAM} --ref-file ${BAM_LOAD_REF} --output ${BAM_LOAD_OUTDIR}
+#=======================================================
+if [[ ! -d $BAM_LOAD_OUTDIR ]]; then
+    echo "${BAM_LOAD_OUTDIR} was not created by bam-load - exiting..."
+    exit 3
+fi
+rm -rf "${BAM_LOAD_SAM}" "${BAM_LOAD_REF}"
+
+KAR_OUTPUT="STREAM_VS_SORTED.ACC"
+rm -rf "${KAR_OUTPUT}" "${KAR_OUTPUT}.md5"
+#=======================================================
+${KAR} --force -c ${KAR_OUTPUT} -d ${BAM_LOAD_OUTDIR}
+#=======================================================
+if [[ ! -f $KAR_OUTPUT ]]; then
+    echo "${KAR_OUTPUT} was not created by kar - exiting..."
+    exit 3
+fi
+rm -rf "${BAM_LOAD_OUTDIR}"
+
+#the stream-mode has no spot-names and writes unsorted: compare sorted records of spot-id, read-id, bases and qualities
+DEFLINES=( --seq-defline '@$si/$ri' --qual-defline '+' )
+SORTED_OUTPUT="STREAM_VS_SORTED.SORTED"
+STREAM_OUTPUT="STREAM_VS_SORTED.STREAM"
+
+function cleanup {
+    rm -rf "${KAR_OUTPUT}" "${KAR_OUTPUT}.md5" "${SORTED_OUTPUT}" "${STREAM_OUTPUT}"
+}
+
+#=======================================================
+${FASTERQDUMP} ${KAR_OUTPUT} --split-spot --stdout "${DEFLINES[@]}" | paste - - - - | LC_ALL=C sort > ${SORTED_OUTPUT}
+#=======================================================
+if [[ ! -s $SORTED_OUTPUT ]]; then
+    echo "the sorted mode of fasterq-dump did not produce any output - exiting..."
+    cleanup
+    exit 3
+fi
+
+for THREADS in 1 4
+do
+    #=======================================================
+    ${FASTERQDUMP} ${KAR_OUTPUT} --stream --threads ${THREADS} --stdout "${DEFLINES[@]}" | paste - - - - | LC_ALL=C sort > ${STREAM_OUTPUT}
+    #=======================================================
+    if ! cmp -s ${SORTED_OUTPUT} ${STREAM_OUTPUT}; then
+        echo "fasterq-dump --stream --threads ${THREADS} differs from the sorted mode:"
+        diff ${SORTED_OUTPUT} ${STREAM_OUTPUT} | head -n 20
+        cleanup
+        exit 3
+    fi
+done
+
+cleanup
+echo "success!"
+exit 0
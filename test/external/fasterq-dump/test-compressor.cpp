@@ -0,0 +1,130 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*/
+
+/**
+* Unit tests for tools/external/fasterq-dump/compressor.c
+*/
+
+#include <compressor.h>
+
+#include <ktst/unit_test.hpp>
+
+#include <zlib.h>
+
+#include <random>
+#include <string>
+
+using namespace std;
+
+TEST_SUITE(FasterqDumpCompressorTestSuite);
+
+/* inflate a stream of concatenated gzip-members */
+static string gunzip( const string & src ) {
+    string res;
+    z_stream zs = {};
+    if ( Z_OK != inflateInit2( &zs, 15 + 16 ) ) { throw logic_error( "inflateInit2() failed" ); }
+    zs . next_in = ( Bytef * )src . data();
+    zs . avail_in = ( uInt )src . size();
+    char buf[ 16 * 1024 ];
+    while ( zs . avail_in > 0 ) {
+        zs . next_out = ( Bytef * )buf;
+        zs . avail_out = sizeof buf;
+        int zres = inflate( &zs, Z_NO_FLUSH );
+        res . append( buf, sizeof buf - zs . avail_out );
+        if ( Z_STREAM_END == zres ) {
+            /* the next member starts here */
+            inflateReset( &zs );
+        } else if ( Z_OK != zres ) {
+            inflateEnd( &zs );
+            throw logic_error( "inflate() failed" );
+        }
+    }
+    inflateEnd( &zs );
+    return res;
+}
+
+static string fastq_text( size_t records, uint32_t seed ) {
+    mt19937 rng( seed );
+    const char * bases = "ACGT";
+    string res;
+    for ( size_t i = 0; i < records; ++i ) {
+        res += "@SRR000001." + to_string( i + 1 ) + " length=50\n";
+        for ( int j = 0; j < 50; ++j ) { res += bases[ rng() % 4 ]; }
+        res += "\n+SRR000001." + to_string( i + 1 ) + " length=50\n";
+        for ( int j = 0; j < 50; ++j ) { res += ( char )( '!' + rng() % 41 ); }
+        res += "\n";
+    }
+    return res;
+}
+
+static string compress( struct compressor_t * c, const string & src ) {
+    const char * dst = nullptr;
+    size_t dst_len = 0;
+    if ( 0 != compressor_run( c, src . data(), src . size(), &dst, &dst_len ) ) {
+        throw logic_error( "compressor_run() failed" );
+    }
+    return string( dst, dst_len );
+}
+
+TEST_CASE(Compressor_None_Is_Not_A_Compressor)
+{
+    struct compressor_t * c = nullptr;
+    REQUIRE_NE( ( rc_t )0, make_compressor( &c, ct_none, 0 ) );
+    REQUIRE( compressor_available( ct_gzip ) );
+}
+
+TEST_CASE(Compressor_Gzip_Roundtrip)
+{
+    struct compressor_t * c = nullptr;
+    REQUIRE_RC( make_compressor( &c, ct_gzip, 0 ) );
+    string text = fastq_text( 1000, 1 );
+    string z = compress( c, text );
+    REQUIRE_LT( z . size(), text . size() );
+    REQUIRE_EQ( text, gunzip( z ) );
+    release_compressor( c );
+}
+
+/* blocks compressed independently ( by different compressors ) concatenate into one valid stream */
+TEST_CASE(Compressor_Gzip_Members_Concatenate)
+{
+    struct compressor_t * c1 = nullptr;
+    struct compressor_t * c2 = nullptr;
+    REQUIRE_RC( make_compressor( &c1, ct_gzip, 1 ) );
+    REQUIRE_RC( make_compressor( &c2, ct_gzip, 9 ) );
+    string expected, stream;
+    for ( uint32_t block = 0; block < 10; ++block ) {
+        string text = fastq_text( 100 + block * 37, block );
+        expected += text;
+        stream += compress( ( 0 == block % 2 ) ? c1 : c2, text );
+    }
+    REQUIRE_EQ( expected, gunzip( stream ) );
+    release_compressor( c1 );
+    release_compressor( c2 );
+}
+
+int main ( int argc, char *argv [] )
+{
+    return FasterqDumpCompressorTestSuite( argc, argv );
+}
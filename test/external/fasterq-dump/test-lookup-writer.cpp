@@ -0,0 +1,221 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for tools/external/fasterq-dump/lookup_writer.c
+* ( written with the lookup- and index-writer, read back with both lookup-readers )
+*/
+
+#include <lookup_writer.h>
+#include <lookup_reader.h>
+#include <dna_pack.h>
+#include <helper.h>
+
+#include <ktst/unit_test.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+TEST_SUITE(FasterqDumpLookupWriterTestSuite);
+
+static const char * LookupFile = "lw_test.lookup";
+static const char * IndexFile  = "lw_test.idx";
+
+struct Entry {
+    int64_t row_id;
+    uint32_t read_id;
+    string bases;
+};
+
+static string make_bases( uint32_t len, uint32_t & seed ) {
+    static const char alphabet[] = "ACGTACGTACGTACGTN";
+    string res( len, 'A' );
+    for ( uint32_t i = 0; i < len; ++i ) {
+        seed = seed * 1103515245 + 12345;
+        res[ i ] = alphabet[ ( seed >> 16 ) % ( sizeof alphabet - 1 ) ];
+    }
+    return res;
+}
+
+static string reverse_complement( const string & s ) {
+    string res( s.rbegin(), s.rend() );
+    for ( auto & c : res ) {
+        switch ( c ) {
+            case 'A' : c = 'T'; break;
+            case 'C' : c = 'G'; break;
+            case 'G' : c = 'C'; break;
+            case 'T' : c = 'A'; break;
+        }
+    }
+    return res;
+}
+
+class LookupFixture
+{
+public:
+    LookupFixture() : dir( nullptr ) {
+        KDirectoryNativeDir( &dir );
+    }
+    ~LookupFixture() {
+        KDirectoryRemove( dir, true, "%s", LookupFile );
+        KDirectoryRemove( dir, true, "%s", IndexFile );
+        KDirectoryRelease( dir );
+    }
+
+    /* 2 READs per spot, one of them with N's in it, one long READ at the end */
+    void MakeEntries( int64_t spots ) {
+        uint32_t seed = 42;
+        for ( int64_t row_id = 1; row_id <= spots; ++row_id ) {
+            for ( uint32_t read_id = 1; read_id <= 2; ++read_id ) {
+                uint32_t len = 1 + ( ( row_id * 7 + read_id * 13 ) % 300 );
+                entries.push_back( { row_id, read_id, make_bases( len, seed ) } );
+            }
+        }
+        entries.push_back( { spots + 1, 1, make_bases( 70000, seed ) } );
+    }
+
+    rc_t WriteEntries( uint64_t frequency ) {
+        struct index_writer_t * idx = nullptr;
+        rc_t rc = make_index_writer( dir, &idx, 4096, frequency, "%s", IndexFile );
+        if ( 0 == rc ) {
+            struct lookup_writer_t * writer = nullptr;
+            rc = make_lookup_writer( dir, idx, &writer, 4096, "%s", LookupFile );
+            if ( 0 == rc ) {
+                vector< uint8_t > packed;
+                for ( auto & e : entries ) {
+                    String S;
+                    packed.resize( dna_pack_max_size( e.bases.size() ) );
+                    size_t size = dna_pack_2na( ( const uint8_t * )e.bases.data(), e.bases.size(), packed.data() );
+                    StringInit( &S, ( const char * )packed.data(), size, ( uint32_t )size );
+                    rc = write_packed_to_lookup_writer( writer, hlp_make_key( e.row_id, e.read_id ), &S );
+                    if ( 0 != rc ) { break; }
+                }
+                release_lookup_writer( writer );
+            }
+            release_index_writer( idx );
+        }
+        return rc;
+    }
+
+    KDirectory * dir;
+    vector< Entry > entries;
+};
+
+FIXTURE_TEST_CASE(LookupWriter_RoundTrip_Sequential, LookupFixture)
+{
+    MakeEntries( 500 );
+    REQUIRE_RC( WriteEntries( 16 ) );
+
+    struct lookup_reader_t * reader = nullptr;
+    REQUIRE_RC( make_lookup_reader( dir, nullptr, &reader, 4096, "%s", LookupFile ) );
+    SBuffer_t packed;
+    SBuffer_t unpacked;
+    REQUIRE_RC( make_SBuffer( &packed, 64 ) );
+    REQUIRE_RC( make_SBuffer( &unpacked, 64 ) );
+    for ( auto & e : entries ) {
+        uint64_t key;
+        REQUIRE_RC( lookup_reader_get( reader, &key, &packed ) );
+        REQUIRE_EQ( hlp_make_key( e.row_id, e.read_id ), key );
+        REQUIRE_EQ( ( dna_len_t )e.bases.size(), dna_packed_len( *( const dna_len_t * )packed.S.addr ) );
+        REQUIRE_RC( dna_unpack_2na( &packed.S, &unpacked, false ) );
+        REQUIRE_EQ( e.bases, string( unpacked.S.addr, unpacked.S.size ) );
+    }
+    /* nothing left after the last entry */
+    uint64_t key;
+    REQUIRE_RC_FAIL( lookup_reader_get( reader, &key, &packed ) );
+    release_SBuffer( &packed );
+    release_SBuffer( &unpacked );
+    release_lookup_reader( reader );
+}
+
+FIXTURE_TEST_CASE(LookupWriter_RoundTrip_Indexed, LookupFixture)
+{
+    MakeEntries( 500 );
+    REQUIRE_RC( WriteEntries( 16 ) );
+
+    struct index_reader_t * idx = nullptr;
+    REQUIRE_RC( make_index_reader( dir, &idx, 4096, "%s", IndexFile ) );
+    uint64_t max_key;
+    REQUIRE_RC( get_max_key( idx, &max_key ) );
+    REQUIRE( max_key <= hlp_make_key( entries.back().row_id, entries.back().read_id ) );
+
+    /* the buffered and the mapped reader have to agree, in random order and reversed */
+    for ( int mapped = 0; mapped < 2; ++mapped ) {
+        struct lookup_reader_t * reader = nullptr;
+        if ( mapped ) {
+            REQUIRE_RC( make_mapped_lookup_reader( dir, idx, &reader, 4096, "%s", LookupFile ) );
+        } else {
+            REQUIRE_RC( make_lookup_reader( dir, idx, &reader, 4096, "%s", LookupFile ) );
+        }
+        SBuffer_t B;
+        REQUIRE_RC( make_SBuffer( &B, 64 ) );
+
+        /* random access: seek first, then read the entry */
+        vector< size_t > order( entries.size() );
+        for ( size_t i = 0; i < order.size(); ++i ) { order[ i ] = ( i * 7919 ) % order.size(); }
+        for ( auto i : order ) {
+            const Entry & e = entries[ i ];
+            uint64_t key = hlp_make_key( e.row_id, e.read_id );
+            uint64_t key_found = 0;
+            bool reverse = ( 0 != ( i & 4 ) );
+            REQUIRE_RC( seek_lookup_reader( reader, key, &key_found, true ) );
+            REQUIRE_EQ( key, key_found );
+            REQUIRE_RC( lookup_bases( reader, e.row_id, e.read_id, &B, reverse ) );
+            REQUIRE_EQ( reverse ? reverse_complement( e.bases ) : e.bases, string( B.S.addr, B.S.size ) );
+        }
+
+        /* ascending with gaps: lookup_bases() has to re-position the reader by itself */
+        uint64_t first_key = 0;
+        REQUIRE_RC( seek_lookup_reader( reader, hlp_make_key( 1, 1 ), &first_key, true ) );
+        for ( size_t i = 0; i < entries.size(); i += 3 ) {
+            const Entry & e = entries[ i ];
+            REQUIRE_RC( lookup_bases( reader, e.row_id, e.read_id, &B, false ) );
+            REQUIRE_EQ( e.bases, string( B.S.addr, B.S.size ) );
+        }
+        release_SBuffer( &B );
+        release_lookup_reader( reader );
+    }
+    release_index_reader( idx );
+}
+
+FIXTURE_TEST_CASE(LookupWriter_Check_And_Count, LookupFixture)
+{
+    MakeEntries( 100 );
+    REQUIRE_RC( WriteEntries( 0 ) );
+    REQUIRE_RC( lookup_check_file( dir, 4096, LookupFile ) );
+    uint32_t count = 0;
+    REQUIRE_RC( lookup_count_file( dir, 4096, LookupFile, &count ) );
+    REQUIRE_EQ( ( uint32_t )entries.size(), count );
+}
+
+int main ( int argc, char *argv [] )
+{
+    return FasterqDumpLookupWriterTestSuite( argc, argv );
+}
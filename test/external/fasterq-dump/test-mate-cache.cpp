@@ -0,0 +1,153 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*/
+
+/**
+* Unit tests for tools/external/fasterq-dump/mate_cache.c
+*/
+
+#include <mate_cache.h>
+
+#include <ktst/unit_test.hpp>
+
+#include <map>
+#include <random>
+#include <string>
+
+using namespace std;
+
+TEST_SUITE(FasterqDumpMateCacheTestSuite);
+
+static string to_str( const String & s ) { return string( s . addr, s . len ); }
+
+static rc_t put( struct mate_cache_t * c, uint64_t spot_id, uint32_t read_id,
+                 const string & bases, const string & qual ) {
+    String b, q;
+    StringInit( &b, bases . data(), bases . size(), ( uint32_t )bases . size() );
+    StringInit( &q, qual . data(), qual . size(), ( uint32_t )qual . size() );
+    return mate_cache_put( c, spot_id, read_id, &b, &q );
+}
+
+TEST_CASE(MateCache_Make_Zero)
+{
+    struct mate_cache_t * c = nullptr;
+    REQUIRE_NE( ( rc_t )0, make_mate_cache( &c, 0 ) );
+}
+
+TEST_CASE(MateCache_Put_Take)
+{
+    struct mate_cache_t * c = nullptr;
+    REQUIRE_RC( make_mate_cache( &c, 4 ) );
+    REQUIRE_RC( put( c, 17, 1, "ACGT", "IIII" ) );
+    REQUIRE_EQ( ( uint32_t )1, mate_cache_count( c ) );
+
+    mate_cache_rec_t rec;
+    REQUIRE( ! mate_cache_take( c, 18, &rec ) );
+    REQUIRE( mate_cache_take( c, 17, &rec ) );
+    REQUIRE_EQ( ( uint64_t )17, rec . spot_id );
+    REQUIRE_EQ( ( uint32_t )1, rec . read_id );
+    REQUIRE_EQ( string( "ACGT" ), to_str( rec . read ) );
+    REQUIRE_EQ( string( "IIII" ), to_str( rec . quality ) );
+    REQUIRE_EQ( ( uint32_t )0, mate_cache_count( c ) );
+    REQUIRE( ! mate_cache_take( c, 17, &rec ) );
+    release_mate_cache( c );
+}
+
+TEST_CASE(MateCache_Evict_Oldest)
+{
+    struct mate_cache_t * c = nullptr;
+    mate_cache_rec_t rec;
+    REQUIRE_RC( make_mate_cache( &c, 2 ) );
+    REQUIRE( ! mate_cache_evict( c, &rec ) );
+    REQUIRE_RC( put( c, 1, 1, "A", "1" ) );
+    REQUIRE_RC( put( c, 2, 1, "C", "2" ) );
+    /* the cache is full: the next put needs an eviction first */
+    REQUIRE_NE( ( rc_t )0, put( c, 3, 1, "G", "3" ) );
+    REQUIRE( mate_cache_evict( c, &rec ) );
+    REQUIRE_EQ( ( uint64_t )1, rec . spot_id );
+    REQUIRE_EQ( string( "A" ), to_str( rec . read ) );
+    REQUIRE_RC( put( c, 3, 1, "G", "3" ) );
+    REQUIRE( ! mate_cache_take( c, 1, &rec ) );
+    REQUIRE( mate_cache_take( c, 3, &rec ) );
+    REQUIRE_EQ( string( "3" ), to_str( rec . quality ) );
+    release_mate_cache( c );
+}
+
+TEST_CASE(MateCache_Flush)
+{
+    struct mate_cache_t * c = nullptr;
+    mate_cache_rec_t rec;
+    REQUIRE_RC( make_mate_cache( &c, 8 ) );
+    for ( uint64_t spot = 10; spot < 15; ++spot ) {
+        REQUIRE_RC( put( c, spot, 2, "ACGTACGT", "########" ) );
+    }
+    REQUIRE( mate_cache_take( c, 12, &rec ) );
+    uint64_t expected[] = { 10, 11, 13, 14 };
+    for ( auto spot : expected ) {
+        REQUIRE( mate_cache_flush( c, &rec ) );
+        REQUIRE_EQ( spot, rec . spot_id );
+    }
+    REQUIRE( ! mate_cache_flush( c, &rec ) );
+    REQUIRE_EQ( ( uint32_t )0, mate_cache_count( c ) );
+    release_mate_cache( c );
+}
+
+/* random puts / takes / evictions checked against a std::map */
+TEST_CASE(MateCache_Random_Against_Map)
+{
+    const uint32_t capacity = 100;
+    struct mate_cache_t * c = nullptr;
+    mate_cache_rec_t rec;
+    map< uint64_t, string > model;
+    mt19937_64 rng( 2024 );
+    REQUIRE_RC( make_mate_cache( &c, capacity ) );
+    for ( int i = 0; i < 200000; ++i ) {
+        uint64_t spot = rng() % 1000;
+        if ( mate_cache_take( c, spot, &rec ) ) {
+            auto it = model . find( spot );
+            REQUIRE( it != model . end() );
+            REQUIRE_EQ( it -> second, to_str( rec . read ) );
+            model . erase( it );
+        } else {
+            REQUIRE( model . find( spot ) == model . end() );
+            if ( mate_cache_evict( c, &rec ) ) {
+                REQUIRE_EQ( ( size_t )1, model . erase( rec . spot_id ) );
+            }
+            string bases( 1 + rng() % 20, 'A' + ( char )( spot % 26 ) );
+            REQUIRE_RC( put( c, spot, 1, bases, bases ) );
+            model[ spot ] = bases;
+        }
+        REQUIRE_EQ( model . size(), ( size_t )mate_cache_count( c ) );
+    }
+    while ( mate_cache_flush( c, &rec ) ) {
+        REQUIRE_EQ( ( size_t )1, model . erase( rec . spot_id ) );
+    }
+    REQUIRE( model . empty() );
+    release_mate_cache( c );
+}
+
+int main ( int argc, char *argv [] )
+{
+    return FasterqDumpMateCacheTestSuite( argc, argv );
+}
@@ -0,0 +1,98 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*/
+
+/**
+* Unit tests for tools/external/fasterq-dump/merge_tree.c
+*/
+
+#include "merge-tree-sources.hpp"
+
+#include <ktst/unit_test.hpp>
+
+using namespace std;
+
+TEST_SUITE(FasterqDumpMergeTreeTestSuite);
+
+TEST_CASE(MergeTree_Make_Zero)
+{
+    struct merge_tree_t * tree = nullptr;
+    REQUIRE_NE( ( rc_t )0, make_merge_tree( &tree, 0 ) );
+}
+
+TEST_CASE(MergeTree_Single_Source)
+{
+    auto src = make_sources( 1, 100, 1 );
+    vector< uint64_t > res;
+    REQUIRE_EQ( ( size_t )100, tree_merge( src, &res ) );
+    REQUIRE_EQ( src[ 0 ] . keys, res );
+}
+
+TEST_CASE(MergeTree_All_Empty)
+{
+    auto src = make_sources( 5, 0, 1 );
+    REQUIRE_EQ( ( size_t )0, tree_merge( src, nullptr ) );
+}
+
+TEST_CASE(MergeTree_Same_As_Linear)
+{
+    for ( uint32_t count = 1; count <= 67; ++count ) {
+        auto src1 = make_sources( count, 50 + count, count );
+        auto src2 = src1;
+        /* some sources are empty or run out early */
+        if ( count > 3 ) {
+            src1[ 2 ] . keys . clear();
+            src2[ 2 ] . keys . clear();
+        }
+        vector< uint64_t > res1, res2;
+        tree_merge( src1, &res1 );
+        linear_merge( src2, &res2 );
+        REQUIRE_EQ( res2, res1 );
+    }
+}
+
+TEST_CASE(MergeTree_Duplicate_Keys_Stable)
+{
+    /* equal keys have to come out in source-order, the way the linear scan did it */
+    const uint32_t count = 9;
+    struct merge_tree_t * tree = nullptr;
+    REQUIRE_EQ( ( rc_t )0, make_merge_tree( &tree, count ) );
+    for ( uint32_t i = 0; i < count; ++i ) {
+        merge_tree_set( tree, i, true, 42 );
+    }
+    merge_tree_build( tree );
+    uint32_t expected = 0;
+    uint32_t idx;
+    while ( merge_tree_winner( tree, &idx ) ) {
+        REQUIRE_EQ( expected++, idx );
+        merge_tree_update( tree, false, 0 );
+    }
+    REQUIRE_EQ( count, expected );
+    release_merge_tree( tree );
+}
+
+int main ( int argc, char *argv [] )
+{
+    return FasterqDumpMergeTreeTestSuite( argc, argv );
+}
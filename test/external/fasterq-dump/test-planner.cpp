@@ -0,0 +1,153 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for tools/external/fasterq-dump/planner.c
+*/
+
+#include <planner.h>
+
+#include <ktst/unit_test.hpp>
+
+#include <cstring>
+
+using namespace std;
+
+TEST_SUITE(FasterqDumpPlannerTestSuite);
+
+static plan_input_t make_input( uint32_t threads, uint64_t seq_rows ) {
+    plan_input_t input;
+    memset( &input, 0, sizeof input );
+    input . requested_threads = threads;
+    input . cpu_count = 8;
+    input . seq_rows = seq_rows;
+    return input;
+}
+
+TEST_CASE(Planner_Automatic_Threads)
+{
+    plan_t plan;
+    plan_input_t input = make_input( 0, 10000000 );
+    plan_make( &input, &plan );
+    REQUIRE( plan . automatic );
+    REQUIRE_EQ( ( uint32_t )8, plan . threads );
+    REQUIRE_EQ( ( uint32_t )8, plan . join_threads );
+    REQUIRE_EQ( ( uint64_t )1250000, plan . join_rows_per_slice );
+    REQUIRE_EQ( ( uint32_t )0, plan . lookup_threads );
+}
+
+TEST_CASE(Planner_Requested_Threads)
+{
+    plan_t plan;
+    plan_input_t input = make_input( 3, 10000000 );
+    plan_make( &input, &plan );
+    REQUIRE( ! plan . automatic );
+    REQUIRE_EQ( ( uint32_t )3, plan . threads );
+    /* the slices cover all rows */
+    REQUIRE( ( uint64_t )10000000 <= plan . join_threads * plan . join_rows_per_slice );
+}
+
+TEST_CASE(Planner_Few_Rows)
+{
+    /* the planner gives each thread a reasonable slice */
+    plan_t plan;
+    plan_input_t input = make_input( 0, 120000 );
+    plan_make( &input, &plan );
+    REQUIRE_EQ( ( uint32_t )8, plan . threads );
+    REQUIRE_EQ( ( uint32_t )2, plan . join_threads );
+    REQUIRE_EQ( ( uint64_t )60000, plan . join_rows_per_slice );
+
+    input . seq_rows = 10;
+    plan_make( &input, &plan );
+    REQUIRE_EQ( ( uint32_t )1, plan . join_threads );
+    REQUIRE_EQ( ( uint64_t )10, plan . join_rows_per_slice );
+}
+
+TEST_CASE(Planner_Few_Rows_Requested_Threads)
+{
+    /* a requested thread-count is not reduced, as long as each thread has a row */
+    plan_t plan;
+    plan_input_t input = make_input( 16, 120000 );
+    plan_make( &input, &plan );
+    REQUIRE_EQ( ( uint32_t )16, plan . threads );
+    REQUIRE_EQ( ( uint32_t )16, plan . join_threads );
+    REQUIRE_EQ( ( uint64_t )7500, plan . join_rows_per_slice );
+
+    input . sorted_csra = true;
+    input . align_rows = 90000;
+    plan_make( &input, &plan );
+    /* one core is left for the background-mergers */
+    REQUIRE_EQ( ( uint32_t )15, plan . lookup_threads );
+    REQUIRE_EQ( ( uint64_t )6000, plan . lookup_rows_per_slice );
+
+    input . seq_rows = 10;
+    plan_make( &input, &plan );
+    REQUIRE_EQ( ( uint32_t )10, plan . join_threads );
+    REQUIRE_EQ( ( uint64_t )1, plan . join_rows_per_slice );
+}
+
+TEST_CASE(Planner_Sorted_cSRA)
+{
+    plan_t plan;
+    plan_input_t input = make_input( 0, 10000000 );
+    input . sorted_csra = true;
+    input . align_rows = 8000000;
+    input . align_bases = 8000000L * 150;
+    input . total_ram = 1024L * 1024 * 1024 * 16;
+    plan_make( &input, &plan );
+    /* one core is left for the background-mergers */
+    REQUIRE_EQ( ( uint32_t )7, plan . lookup_threads );
+    REQUIRE( ( uint64_t )8000000 <= plan . lookup_threads * plan . lookup_rows_per_slice );
+    REQUIRE_EQ( ( uint64_t )( 300000000 + 96000000 ), plan . est_lookup_size );
+    /* the share of each producer fits into its part of the RAM */
+    REQUIRE_EQ( ( size_t )( ( plan . est_lookup_size + 6 ) / 7 ), plan . mem_limit );
+    REQUIRE_EQ( ( uint32_t )8, plan . merge_batch );
+}
+
+TEST_CASE(Planner_Requested_MemLimit)
+{
+    plan_t plan;
+    plan_input_t input = make_input( 4, 10000000 );
+    input . sorted_csra = true;
+    input . align_rows = 8000000;
+    input . align_bases = 8000000L * 150;
+    input . total_ram = 1024L * 1024 * 1024 * 16;
+    input . requested_mem_limit = 1024L * 1024 * 10;
+    plan_make( &input, &plan );
+    REQUIRE_EQ( ( size_t )( 1024L * 1024 * 10 ), plan . mem_limit );
+    REQUIRE_EQ( ( uint32_t )4, plan . lookup_threads );
+    REQUIRE_EQ( ( uint32_t )4, plan . merge_batch );
+
+    /* a slow temp-directory: merge more at once */
+    input . temp_write_speed = 1024L * 1024 * 50;
+    plan_make( &input, &plan );
+    REQUIRE_EQ( ( uint32_t )38, plan . merge_batch );
+}
+
+int main ( int argc, char *argv [] )
+{
+    return FasterqDumpPlannerTestSuite( argc, argv );
+}
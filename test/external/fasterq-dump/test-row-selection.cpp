@@ -0,0 +1,177 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for tools/external/fasterq-dump/row_selection.c
+*/
+
+#include <row_selection.h>
+
+#include <ktst/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using namespace std;
+
+TEST_SUITE(FasterqDumpRowSelectionTestSuite);
+
+static struct row_selection_t * make_sel( const char * ranges, int64_t first, uint64_t count ) {
+    struct row_selection_t * sel = nullptr;
+    if ( 0 == make_row_selection( &sel ) ) {
+        if ( nullptr != ranges ) { rsel_add_ranges( sel, ranges ); }
+        rsel_seal( sel, first, count );
+    }
+    return sel;
+}
+
+TEST_CASE(RowSelection_All_Rows)
+{
+    struct row_selection_t * sel = make_sel( nullptr, 1, 1000 );
+    REQUIRE_NOT_NULL( sel );
+    REQUIRE_EQ( ( uint64_t )1000, rsel_row_count( sel ) );
+    REQUIRE( rsel_contains( sel, 1 ) );
+    REQUIRE( rsel_contains( sel, 1000 ) );
+    REQUIRE( ! rsel_contains( sel, 1001 ) );
+    release_row_selection( sel );
+}
+
+TEST_CASE(RowSelection_Ranges_Merged_And_Clipped)
+{
+    struct row_selection_t * sel = make_sel( "500-600,1,550-700, 701 ,900-", 1, 1000 );
+    REQUIRE_NOT_NULL( sel );
+    /* 1 + 500..701 + 900..1000 */
+    REQUIRE_EQ( ( uint64_t )( 1 + 202 + 101 ), rsel_row_count( sel ) );
+    REQUIRE( rsel_contains( sel, 1 ) );
+    REQUIRE( ! rsel_contains( sel, 2 ) );
+    REQUIRE( rsel_contains( sel, 701 ) );
+    REQUIRE( ! rsel_contains( sel, 702 ) );
+    REQUIRE( rsel_contains( sel, 1000 ) );
+    REQUIRE( ! rsel_contains( sel, 1001 ) );
+    release_row_selection( sel );
+
+    sel = make_sel( "2000-3000", 1, 1000 );
+    REQUIRE_EQ( ( uint64_t )0, rsel_row_count( sel ) );
+    release_row_selection( sel );
+}
+
+TEST_CASE(RowSelection_Invalid)
+{
+    struct row_selection_t * sel = nullptr;
+    REQUIRE_RC( make_row_selection( &sel ) );
+    REQUIRE_NE( ( rc_t )0, rsel_add_ranges( sel, "10-5" ) );
+    REQUIRE_NE( ( rc_t )0, rsel_add_ranges( sel, "0" ) );
+    REQUIRE_NE( ( rc_t )0, rsel_add_ranges( sel, "12x" ) );
+    /* does not fit into a row-id ( INT64_MAX + 1, 2^64 + 1 ) */
+    REQUIRE_NE( ( rc_t )0, rsel_add_ranges( sel, "9223372036854775808" ) );
+    REQUIRE_NE( ( rc_t )0, rsel_add_ranges( sel, "1-18446744073709551617" ) );
+    REQUIRE_NE( ( rc_t )0, rsel_set_sample( sel, 0.0, 1 ) );
+    REQUIRE_NE( ( rc_t )0, rsel_set_sample( sel, 1.5, 1 ) );
+    release_row_selection( sel );
+}
+
+TEST_CASE(RowSelection_Slices)
+{
+    struct row_selection_t * sel = make_sel( "1-10,101-110,1001-1010", 1, 2000 );
+    int64_t first;
+    uint64_t count;
+    /* 30 rows in 3 slices: one range each */
+    rsel_slice( sel, 0, 3, &first, &count );
+    REQUIRE_EQ( ( int64_t )1, first );
+    REQUIRE_EQ( ( uint64_t )10, count );
+    rsel_slice( sel, 1, 3, &first, &count );
+    REQUIRE_EQ( ( int64_t )101, first );
+    REQUIRE_EQ( ( uint64_t )10, count );
+    rsel_slice( sel, 2, 3, &first, &count );
+    REQUIRE_EQ( ( int64_t )1001, first );
+    REQUIRE_EQ( ( uint64_t )10, count );
+    /* 30 rows in 4 slices: 7 + 8 + 7 + 8, the windows follow each other */
+    int64_t prev_end = 0;
+    uint64_t total = 0;
+    for ( uint32_t i = 0; i < 4; ++i ) {
+        rsel_slice( sel, i, 4, &first, &count );
+        REQUIRE( first > prev_end );
+        prev_end = first + ( int64_t )count - 1;
+        for ( int64_t row = first; row <= prev_end; ++row ) {
+            if ( rsel_contains( sel, row ) ) { total++; }
+        }
+    }
+    REQUIRE_EQ( ( uint64_t )30, total );
+    release_row_selection( sel );
+}
+
+TEST_CASE(RowSelection_Sample)
+{
+    struct row_selection_t * sel1 = nullptr;
+    struct row_selection_t * sel2 = nullptr;
+    REQUIRE_RC( make_row_selection( &sel1 ) );
+    REQUIRE_RC( make_row_selection( &sel2 ) );
+    REQUIRE_RC( rsel_set_sample( sel1, 0.1, 42 ) );
+    REQUIRE_RC( rsel_set_sample( sel2, 0.1, 42 ) );
+    REQUIRE_RC( rsel_seal( sel1, 1, 100000 ) );
+    REQUIRE_RC( rsel_seal( sel2, 1, 100000 ) );
+    REQUIRE_EQ( ( uint64_t )10000, rsel_expected_count( sel1 ) );
+    uint64_t n = 0;
+    for ( int64_t row = 1; row <= 100000; ++row ) {
+        bool in = rsel_contains( sel1, row );
+        /* the same seed selects the same rows */
+        REQUIRE_EQ( in, rsel_contains( sel2, row ) );
+        if ( in ) { n++; }
+    }
+    REQUIRE( n > 9500 && n < 10500 );
+    release_row_selection( sel1 );
+    release_row_selection( sel2 );
+}
+
+TEST_CASE(RowSelection_Spot_List)
+{
+    const char * filename = "rsel_spot_list.txt";
+    {
+        ofstream f( filename, ios::trunc );
+        f << "# spots to extract\n5\n17\r\n3-4\n\n100 # the last one\n17";
+    }
+    KDirectory * dir = nullptr;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    struct row_selection_t * sel = nullptr;
+    REQUIRE_RC( make_row_selection( &sel ) );
+    REQUIRE_RC( rsel_add_spot_list( sel, dir, filename ) );
+    REQUIRE_RC( rsel_seal( sel, 1, 1000 ) );
+    REQUIRE_EQ( ( uint64_t )5, rsel_row_count( sel ) );
+    REQUIRE( rsel_contains( sel, 3 ) );
+    REQUIRE( rsel_contains( sel, 5 ) );
+    REQUIRE( rsel_contains( sel, 17 ) );
+    REQUIRE( rsel_contains( sel, 100 ) );
+    REQUIRE( ! rsel_contains( sel, 6 ) );
+    release_row_selection( sel );
+    KDirectoryRelease( dir );
+    remove( filename );
+}
+
+int main ( int argc, char *argv [] )
+{
+    return FasterqDumpRowSelectionTestSuite( argc, argv );
+}
@@ -0,0 +1,192 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for tools/external/fasterq-dump/var_fmt.c
+*/
+
+#include <var_fmt.h>
+
+#include <ktst/unit_test.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+TEST_SUITE(FasterqDumpVarFmtTestSuite);
+
+/* the same variables as in flex_printer.c */
+enum { s_acc = 0, s_sn = 1, s_sg = 2, s_rd1 = 3 };
+enum { i_si = 0, i_ri = 1, i_rl = 2 };
+
+class VarFmtFixture
+{
+public:
+    VarFmtFixture() : vars( vfmt_create_desc_list() ), fmt( nullptr ) {
+        vfmt_add_str_to_desc_list( vars, "$ac",  s_acc, 0xFF );
+        vfmt_add_str_to_desc_list( vars, "$sn",  s_sn,  i_si );   /* spot-name, the spot-id if missing */
+        vfmt_add_str_to_desc_list( vars, "$sg",  s_sg,  0xFF );
+        vfmt_add_str_to_desc_list( vars, "$RD1", s_rd1, 0xFF );
+        vfmt_add_int_to_desc_list( vars, "$si",  i_si );
+        vfmt_add_int_to_desc_list( vars, "$ri",  i_ri );
+        vfmt_add_int_to_desc_list( vars, "$rl",  i_rl );
+        memset( str_args, 0, sizeof str_args );
+        memset( int_args, 0, sizeof int_args );
+    }
+    ~VarFmtFixture() {
+        vfmt_release( fmt );
+        vfmt_release_desc_list( vars );
+    }
+
+    void Compile( const char * text ) {
+        String S;
+        StringInitCString( &S, text );
+        vfmt_release( fmt );
+        fmt = vfmt_create( &S, vars );
+    }
+
+    /* render into a buffer of exactly vfmt_max_len() bytes, guarded on both sides */
+    string Render() {
+        const size_t guard = 16;
+        size_t max_len = vfmt_max_len( fmt, str_args, 4 );
+        vector< char > buf( max_len + 2 * guard, '#' );
+        size_t len = vfmt_render( fmt, buf.data() + guard, str_args, 4, int_args, 3 );
+        if ( len > max_len ) { throw logic_error( "vfmt_render() wrote more than vfmt_max_len()" ); }
+        for ( size_t i = 0; i < guard; ++i ) {
+            if ( '#' != buf[ i ] || '#' != buf[ guard + max_len + i ] ) {
+                throw logic_error( "vfmt_render() wrote outside of its buffer" );
+            }
+        }
+        return string( buf.data() + guard, len );
+    }
+
+    void SetStr( int idx, const char * value ) {
+        if ( nullptr == value ) {
+            str_args[ idx ] = nullptr;
+        } else {
+            StringInitCString( &strings[ idx ], value );
+            str_args[ idx ] = &strings[ idx ];
+        }
+    }
+
+    struct vfmt_desc_list_t * vars;
+    struct vfmt_t * fmt;
+    String strings[ 4 ];
+    const String * str_args[ 4 ];
+    uint64_t int_args[ 3 ];
+};
+
+FIXTURE_TEST_CASE(VarFmt_Literals_And_Variables, VarFmtFixture)
+{
+    Compile( "@$ac.$si $sn length=$rl" );
+    REQUIRE_NOT_NULL( fmt );
+    SetStr( s_acc, "SRR000001" );
+    SetStr( s_sn, "EM7LVYS02FOYNU" );
+    int_args[ i_si ] = 1;
+    int_args[ i_rl ] = 284;
+    REQUIRE_EQ( string( "@SRR000001.1 EM7LVYS02FOYNU length=284" ), Render() );
+
+    /* only literals, only variables */
+    Compile( "no variables here" );
+    REQUIRE_EQ( string( "no variables here" ), Render() );
+    Compile( "$ac$si$rl" );
+    REQUIRE_EQ( string( "SRR0000011284" ), Render() );
+}
+
+FIXTURE_TEST_CASE(VarFmt_String_With_Alternative, VarFmtFixture)
+{
+    Compile( ">$sn/$ri" );
+    int_args[ i_si ] = 4711;
+    int_args[ i_ri ] = 2;
+
+    SetStr( s_sn, "name" );
+    REQUIRE_EQ( string( ">name/2" ), Render() );
+
+    /* a missing or an empty spot-name is replaced by the spot-id */
+    SetStr( s_sn, nullptr );
+    REQUIRE_EQ( string( ">4711/2" ), Render() );
+    SetStr( s_sn, "" );
+    REQUIRE_EQ( string( ">4711/2" ), Render() );
+}
+
+FIXTURE_TEST_CASE(VarFmt_String_Without_Alternative, VarFmtFixture)
+{
+    Compile( "[$sg]" );
+    SetStr( s_sg, nullptr );
+    REQUIRE_EQ( string( "[]" ), Render() );
+    SetStr( s_sg, "" );
+    REQUIRE_EQ( string( "[]" ), Render() );
+    SetStr( s_sg, "grp" );
+    REQUIRE_EQ( string( "[grp]" ), Render() );
+}
+
+FIXTURE_TEST_CASE(VarFmt_Integers, VarFmtFixture)
+{
+    const uint64_t values[] = { 0, 9, 10, 99, 100, 101, 999, 1000, 12345,
+                                4294967296ULL, 10000000000000000000ULL, 18446744073709551615ULL };
+    Compile( "$si" );
+    for ( auto v : values ) {
+        int_args[ i_si ] = v;
+        REQUIRE_EQ( to_string( v ), Render() );
+    }
+}
+
+FIXTURE_TEST_CASE(VarFmt_Append_To_Buffer, VarFmtFixture)
+{
+    Compile( "@$ac.$si length=$rl\n$RD1\n" );
+    SetStr( s_acc, "SRR1" );
+    string expected;
+    SBuffer_t buf;
+    REQUIRE_RC( make_SBuffer( &buf, 8 ) );  /* too small: has to grow */
+    for ( uint64_t spot = 1; spot <= 200; ++spot ) {
+        string bases( ( size_t )( spot % 150 ) + 1, "ACGT"[ spot % 4 ] );
+        SetStr( s_rd1, bases.c_str() );
+        int_args[ i_si ] = spot;
+        int_args[ i_rl ] = bases.size();
+        REQUIRE_RC( vfmt_append_to_buffer( fmt, &buf, str_args, 4, int_args, 3 ) );
+        expected += "@SRR1." + to_string( spot ) + " length=" + to_string( bases.size() ) + "\n" + bases + "\n";
+    }
+    REQUIRE_EQ( expected, string( buf.S.addr, buf.S.size ) );
+    REQUIRE_EQ( ( uint32_t )expected.size(), buf.S.len );
+    release_SBuffer( &buf );
+
+    /* vfmt_write_to_buffer() starts from an empty buffer each time */
+    SetStr( s_rd1, "ACGT" );
+    int_args[ i_si ] = 7;
+    int_args[ i_rl ] = 4;
+    SBuffer_t * res = vfmt_write_to_buffer( fmt, str_args, 4, int_args, 3 );
+    REQUIRE_NOT_NULL( res );
+    res = vfmt_write_to_buffer( fmt, str_args, 4, int_args, 3 );
+    REQUIRE_NOT_NULL( res );
+    REQUIRE_EQ( string( "@SRR1.7 length=4\nACGT\n" ), string( res -> S.addr, res -> S.size ) );
+}
+
+int main ( int argc, char *argv [] )
+{
+    return FasterqDumpVarFmtTestSuite( argc, argv );
+}
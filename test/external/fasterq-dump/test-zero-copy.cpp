@@ -0,0 +1,132 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*/
+
+
+/**
+* Unit tests for tools/external/fasterq-dump/zero_copy.c
+*/
+
+#include <zero_copy.h>
+
+#include <ktst/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+TEST_SUITE(FasterqDumpZeroCopyTestSuite);
+
+static void write_file( const string & name, const string & content ) {
+    ofstream f( name, ios::binary | ios::trunc );
+    f << content;
+}
+
+static string read_file( const string & name ) {
+    ifstream f( name, ios::binary );
+    stringstream ss;
+    ss << f . rdbuf();
+    return ss . str();
+}
+
+static string make_content( size_t size, char c ) {
+    string res;
+    for ( size_t i = 0; i < size; ++i ) { res . push_back( c + ( char )( i % 13 ) ); }
+    return res;
+}
+
+class ZeroCopyFixture {
+public:
+    ZeroCopyFixture() : dir( nullptr ) { KDirectoryNativeDir( &dir ); }
+    ~ZeroCopyFixture() {
+        for ( auto & name : files ) { remove( name . c_str() ); }
+        KDirectoryRelease( dir );
+    }
+    string make( const string & name, const string & content ) {
+        write_file( name, content );
+        files . push_back( name );
+        return name;
+    }
+    KDirectory * dir;
+    vector< string > files;
+};
+
+/* parts of sizes that are not multiples of the block-size: the following parts
+   cannot be reflinked, but copy_file_range() has to take over */
+FIXTURE_TEST_CASE(ZeroCopy_Append_Parts, ZeroCopyFixture)
+{
+    const size_t sizes[] = { 4096, 5000, 8192, 123, 0, 70000 };
+    string expected;
+    make( "zc_dst", "" );
+    for ( size_t i = 0; i < sizeof sizes / sizeof sizes[ 0 ]; ++i ) {
+        string content = make_content( sizes[ i ], 'a' + ( char )i );
+        make( "zc_part_" + to_string( i ), content );
+        expected += content;
+    }
+
+    struct zero_copy_t * zc = nullptr;
+    rc_t rc = make_zero_copy( &zc, dir, "zc_dst" );
+    if ( zero_copy_unsupported( rc ) ) { return; } /* not available on this platform */
+    REQUIRE_RC( rc );
+
+    uint64_t pos = 0;
+    for ( size_t i = 0; i < sizeof sizes / sizeof sizes[ 0 ]; ++i ) {
+        zc_method_t method;
+        uint64_t written = 0;
+        rc = zero_copy_append( zc, ( "zc_part_" + to_string( i ) ) . c_str(), pos, &method, &written );
+        if ( zero_copy_unsupported( rc ) ) { break; } /* filesystem cannot do it */
+        REQUIRE_RC( rc );
+        REQUIRE_EQ( ( uint64_t )sizes[ i ], written );
+        pos += written;
+    }
+    release_zero_copy( zc );
+    if ( pos == expected . size() ) {
+        REQUIRE( expected == read_file( "zc_dst" ) );
+    }
+}
+
+FIXTURE_TEST_CASE(ZeroCopy_Missing_Source, ZeroCopyFixture)
+{
+    make( "zc_dst2", "" );
+    struct zero_copy_t * zc = nullptr;
+    rc_t rc = make_zero_copy( &zc, dir, "zc_dst2" );
+    if ( zero_copy_unsupported( rc ) ) { return; }
+    REQUIRE_RC( rc );
+
+    zc_method_t method;
+    uint64_t written;
+    rc = zero_copy_append( zc, "zc_does_not_exist", 0, &method, &written );
+    REQUIRE_NE( ( rc_t )0, rc );
+    REQUIRE( !zero_copy_unsupported( rc ) );
+    release_zero_copy( zc );
+}
+
+int main ( int argc, char *argv [] )
+{
+    return FasterqDumpZeroCopyTestSuite( argc, argv );
+}
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+
+# decodes the BAM-output of sam-dump back into SAM-text, without samtools
+#
+#   bam_to_sam.py file.bam                          ... header and all records
+#   bam_to_sam.py file.bam file.bam.bai REF:FROM-TO ... the records overlapping the region
+#                                                       ( 1-based, inclusive ), found via
+#                                                       the BAI- or CSI-index, no header
+
+import gzip
+import struct
+import sys
+import zlib
+
+SEQ_CHARS = "=ACMGRSVTWYHKDBN"
+CIGAR_OPS = "MIDNSHP=X"
+
+def fail( msg ) :
+    sys.stderr.write( "ERROR: " + msg + "\n" )
+    exit( 1 )
+
+# the whole BGZF-file uncompressed, and the uncompressed offset of each block by file-offset
+def read_bgzf( filename ) :
+    with open( filename, "rb" ) as f :
+        raw = f.read()
+    data = bytearray()
+    starts = {}
+    pos = 0
+    while pos < len( raw ) :
+        if raw[ pos : pos + 4 ] != b"\x1f\x8b\x08\x04" or raw[ pos + 12 : pos + 14 ] != b"BC" :
+            fail( "not a BGZF-block at offset %d of %s" % ( pos, filename ) )
+        bsize = struct.unpack_from( "<H", raw, pos + 16 )[ 0 ] + 1
+        starts[ pos ] = len( data )
+        data += zlib.decompress( raw[ pos + 18 : pos + bsize - 8 ], -15 )
+        pos += bsize
+    if raw[ -28 : ] != bytes( bytearray( [ 0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 0x42, 0x43, 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 ] ) ) :
+        fail( "the EOF-marker is missing in " + filename )
+    starts[ pos ] = len( data )
+    return ( bytes( data ), starts )
+
+def real_offset( starts, voffset ) :
+    block = voffset >> 16
+    if block not in starts :
+        fail( "the index points to offset %d, not the start of a BGZF-block" % block )
+    return starts[ block ] + ( voffset & 0xffff )
+
+def read_header( data ) :
+    if data[ 0 : 4 ] != b"BAM\x01" :
+        fail( "BAM-magic missing" )
+    l_text = struct.unpack_from( "<i", data, 4 )[ 0 ]
+    text = data[ 8 : 8 + l_text ].decode( "ascii" )
+    pos = 8 + l_text
+    n_ref = struct.unpack_from( "<i", data, pos )[ 0 ]
+    pos += 4
+    refs = []
+    for i in range( n_ref ) :
+        l_name = struct.unpack_from( "<i", data, pos )[ 0 ]
+        refs.append( data[ pos + 4 : pos + 3 + l_name ].decode( "ascii" ) )
+        pos += 4 + l_name + 4
+    return ( text, refs, pos )
+
+def tag_value( data, pos, t ) :
+    fmt = { "c" : "<b", "C" : "<B", "s" : "<h", "S" : "<H", "i" : "<i", "I" : "<I", "f" : "<f" }
+    if t == "A" :
+        return ( chr( data[ pos ] ), pos + 1 )
+    if t in "ZH" :
+        end = data.index( b"\x00", pos )
+        return ( data[ pos : end ].decode( "ascii" ), end + 1 )
+    if t == "B" :
+        sub = chr( data[ pos ] )
+        n = struct.unpack_from( "<i", data, pos + 1 )[ 0 ]
+        pos += 5
+        values = []
+        for i in range( n ) :
+            v = struct.unpack_from( fmt[ sub ], data, pos )[ 0 ]
+            values.append( "%g" % v if sub == "f" else str( v ) )
+            pos += struct.calcsize( fmt[ sub ] )
+        return ( ",".join( [ sub ] + values ), pos )
+    v = struct.unpack_from( fmt[ t ], data, pos )[ 0 ]
+    return ( "%g" % v if t == "f" else str( v ), pos + struct.calcsize( fmt[ t ] ) )
+
+# one record at pos: ( ref_id, beg, end, SAM-line, pos of the next record )
+def read_record( data, pos, refs ) :
+    ( block_size, ref_id, p, l_name, mapq, bin, n_cigar, flag, l_seq,
+      next_ref_id, next_p, tlen ) = struct.unpack_from( "<iiiBBHHHiiii", data, pos )
+    next_rec = pos + 4 + block_size
+    pos += 36
+    qname = data[ pos : pos + l_name - 1 ].decode( "ascii" )
+    pos += l_name
+    cigar = ""
+    ref_len = 0
+    for i in range( n_cigar ) :
+        op = struct.unpack_from( "<I", data, pos + 4 * i )[ 0 ]
+        cigar += str( op >> 4 ) + CIGAR_OPS[ op & 0xf ]
+        if CIGAR_OPS[ op & 0xf ] in "MDN=X" :
+            ref_len += op >> 4
+    pos += 4 * n_cigar
+    seq = "".join( SEQ_CHARS[ ( data[ pos + i // 2 ] >> ( 4 if i % 2 == 0 else 0 ) ) & 0xf ] for i in range( l_seq ) )
+    pos += ( l_seq + 1 ) // 2
+    qual = data[ pos : pos + l_seq ]
+    pos += l_seq
+    if l_seq == 0 or qual[ 0 ] == 0xff :
+        qual = "*"
+    else :
+        qual = "".join( chr( q + 33 ) for q in bytearray( qual ) )
+    tags = []
+    while pos < next_rec :
+        tag = data[ pos : pos + 2 ].decode( "ascii" )
+        t = chr( data[ pos + 2 ] )
+        ( v, pos ) = tag_value( data, pos + 3, t )
+        tags.append( "%s:%s:%s" % ( tag, "i" if t in "cCsSiI" else t, v ) )
+    rname = refs[ ref_id ] if ref_id >= 0 else "*"
+    if next_ref_id < 0 :
+        rnext = "*"
+    elif next_ref_id == ref_id :
+        rnext = "="
+    else :
+        rnext = refs[ next_ref_id ]
+    fields = [ qname, str( flag ), rname, str( p + 1 ), str( mapq ), cigar if n_cigar > 0 else "*",
+               rnext, str( next_p + 1 ), str( tlen ), seq if l_seq > 0 else "*", qual ] + tags
+    return ( ref_id, p, p + ( ref_len if ref_len > 0 else 1 ), "\t".join( fields ), next_rec )
+
+# ( min_shift, depth, per reference a dictionary bin -> chunks )
+def read_index( filename ) :
+    if filename.endswith( ".csi" ) :
+        with gzip.open( filename, "rb" ) as f :
+            data = f.read()
+        if data[ 0 : 4 ] != b"CSI\x01" :
+            fail( "CSI-magic missing" )
+        ( min_shift, depth, l_aux ) = struct.unpack_from( "<iii", data, 4 )
+        pos = 16 + l_aux
+    else :
+        with open( filename, "rb" ) as f :
+            data = f.read()
+        if data[ 0 : 4 ] != b"BAI\x01" :
+            fail( "BAI-magic missing" )
+        ( min_shift, depth ) = ( 14, 5 )
+        pos = 4
+    csi = filename.endswith( ".csi" )
+    n_ref = struct.unpack_from( "<i", data, pos )[ 0 ]
+    pos += 4
+    refs = []
+    for r in range( n_ref ) :
+        bins = {}
+        n_bin = struct.unpack_from( "<i", data, pos )[ 0 ]
+        pos += 4
+        for b in range( n_bin ) :
+            bin = struct.unpack_from( "<I", data, pos )[ 0 ]
+            pos += 4 + ( 8 if csi else 0 )
+            n_chunk = struct.unpack_from( "<i", data, pos )[ 0 ]
+            pos += 4
+            bins[ bin ] = [ struct.unpack_from( "<QQ", data, pos + 16 * c ) for c in range( n_chunk ) ]
+            pos += 16 * n_chunk
+        if not csi :
+            n_intv = struct.unpack_from( "<i", data, pos )[ 0 ]
+            pos += 4 + 8 * n_intv
+        refs.append( bins )
+    return ( min_shift, depth, refs )
+
+# as in the SAM-spec: the bins that may hold records overlapping [ beg, end )
+def reg2bins( beg, end, min_shift, depth ) :
+    res = []
+    end -= 1
+    s = min_shift + depth * 3
+    t = 0
+    for l in range( depth + 1 ) :
+        res.extend( range( t + ( beg >> s ), t + ( end >> s ) + 1 ) )
+        s -= 3
+        t += 1 << ( l * 3 )
+    return res
+
+def query( data, starts, refs, index_name, region ) :
+    ( min_shift, depth, index ) = read_index( index_name )
+    ( name, coords ) = region.split( ":" )
+    ( beg, end ) = [ int( x ) for x in coords.split( "-" ) ]
+    beg -= 1
+    if name not in refs :
+        fail( "unknown reference " + name )
+    ref_id = refs.index( name )
+    chunks = []
+    for bin in reg2bins( beg, end, min_shift, depth ) :
+        chunks.extend( index[ ref_id ].get( bin, [] ) )
+    found = {}
+    for ( c_beg, c_end ) in chunks :
+        pos = real_offset( starts, c_beg )
+        stop = real_offset( starts, c_end )
+        while pos < stop :
+            ( r, r_beg, r_end, line, next_rec ) = read_record( data, pos, refs )
+            if r == ref_id and r_beg < end and r_end > beg :
+                found[ pos ] = line
+            pos = next_rec
+    for pos in sorted( found ) :
+        print( found[ pos ] )
+
+if len( sys.argv ) != 2 and len( sys.argv ) != 4 :
+    fail( "usage: bam_to_sam.py file.bam [ index REF:FROM-TO ]" )
+
+( data, starts ) = read_bgzf( sys.argv[ 1 ] )
+( text, refs, pos ) = read_header( data )
+if len( sys.argv ) == 4 :
+    query( data, starts, refs, sys.argv[ 2 ], sys.argv[ 3 ] )
+else :
+    sys.stdout.write( text )
+    while pos < len( data ) :
+        ( r, r_beg, r_end, line, pos ) = read_record( data, pos, refs )
+        print( line )
@@ -0,0 +1,130 @@
+#!/usr/bin/env bash
+
+# the goal of this script is to measure how many aligned records per second
+# sam-dump can format ( SAM-text-output )
+#
+# the test uses the sam-factory-tool to produce a fixed cSRA-object
+# ( sam-factory does not seed its random-generator, the fixture is the same
+#   on every run, no dependecies on production-runs ! )
+#
+# the test also depends on the bam-load-tool and kar-tool to produce a cSRA-object
+#
+# if the environment-variable BASELINE_SAMDUMP points to another sam-dump-binary
+# ( for instance one build from an earlier revision ), this binary is measured too,
+# both outputs have to be identical, and the speedup is reported
+#
+# the number of timed runs per binary can be set via BENCH_RUNS ( default 3 ),
+# the best run counts
+#
+
+set -e
+
+source ./check_bin_tools.sh $1 $2 $3
+
+print_verbose "benchmark of the record-formatter of sam-dump"
+print_verbose "-------------------------------------------"
+
+#------------------------------------------------------------
+#produce the fixed sam-file
+
+BENCHSAM="bench_sam.SAM"
+BENCHREF="bench-ref.fasta"
+
+rm -f "$BENCHSAM" "$BENCHREF"
+
+#with the help of HEREDOC we pipe the configuration into
+# the sam-factory-tool via stdin to produce 100.000 alignment-pairs
+# on 2 references
+$SAMFACTORY << EOF
+r:type=random,name=R1,length=500000
+r:type=random,name=R2,length=300000
+ref-out:$BENCHREF
+sam-out:$BENCHSAM
+p:name=A,ref=R1,repeat=60000
+p:name=A,ref=R1,repeat=60000
+p:name=B,ref=R2,repeat=40000
+p:name=B,ref=R2,repeat=40000
+EOF
+
+#check if the sam-file and the reference have been produced
+for F in $BENCHSAM $BENCHREF
+do
+    if [[ ! -f "$F" ]]; then
+        echo "$F not produced"
+        exit 3
+    fi
+done
+
+print_verbose "fixed SAM-file produced!"
+
+BENCHCSRA="bench_csra"
+source ./sam_to_csra.sh $BENCHSAM $BENCHREF $BENCHCSRA
+rm $BENCHSAM $BENCHREF
+
+RUNS="${BENCH_RUNS:-3}"
+
+#------------------------------------------------------------
+# function to time a sam-dump-binary: $1 = binary, $2 = output-file
+# prints the best time in milliseconds of $RUNS runs
+function best_time_ms {
+    local BEST=""
+    local I
+    for (( I=0; I<RUNS; I++ ))
+    do
+        local T0=`date +%s%N`
+        $1 --no-header $BENCHCSRA > $2
+        local T1=`date +%s%N`
+        local MS=$(( ( T1 - T0 ) / 1000000 ))
+        if [[ "$MS" -lt "1" ]]; then
+            MS=1
+        fi
+        if [[ -z "$BEST" || "$MS" -lt "$BEST" ]]; then
+            BEST=$MS
+        fi
+    done
+    echo $BEST
+}
+
+#------------------------------------------------------------
+#measure the sam-dump under test
+
+BENCH_OUT="bench_out.SAM"
+MS=`best_time_ms $SAMDUMP $BENCH_OUT`
+RECORDS=`wc -l < $BENCH_OUT`
+if [[ "$RECORDS" -eq "0" ]]; then
+    echo "sam-dump did not produce any records"
+    exit 3
+fi
+RATE=$(( RECORDS * 1000 / MS ))
+echo "sam-dump : $RECORDS records in $MS ms ( $RATE records/sec )"
+
+#------------------------------------------------------------
+#measure the baseline, if one is given
+
+if [[ -n "$BASELINE_SAMDUMP" ]]; then
+    if [[ ! -x "$BASELINE_SAMDUMP" ]]; then
+        echo "$BASELINE_SAMDUMP - executable not found"
+        exit 3
+    fi
+    BASE_OUT="bench_base.SAM"
+    BASE_MS=`best_time_ms $BASELINE_SAMDUMP $BASE_OUT`
+    BASE_RATE=$(( RECORDS * 1000 / BASE_MS ))
+    echo "baseline : $RECORDS records in $BASE_MS ms ( $BASE_RATE records/sec )"
+
+    if ! cmp -s $BENCH_OUT $BASE_OUT; then
+        echo "the output of sam-dump differs from the output of the baseline"
+        rm -f $BENCH_OUT $BASE_OUT $BENCHCSRA
+        exit 3
+    fi
+    print_verbose "output of sam-dump and baseline is identical"
+
+    SPEEDUP=$(( BASE_MS * 100 / MS ))
+    echo "speedup  : $(( SPEEDUP / 100 )).$(( SPEEDUP % 100 / 10 ))$(( SPEEDUP % 10 ))x"
+    rm -f $BASE_OUT
+fi
+
+#we do not need the output and the cSRA-object any more ...
+rm -f $BENCH_OUT $BENCHCSRA
+
+print_verbose "success!"
+print_verbose -e "--------\n"
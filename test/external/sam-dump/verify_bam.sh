@@ -0,0 +1,135 @@
+#!/usr/bin/env bash
+
+# the goal of this test is to verify the BAM-output of sam-dump ( --bam, --bam-index )
+#
+# the BAM-file is decoded back into SAM-text ( bam_to_sam.py, no samtools needed )
+# and compared to the text-output of sam-dump, a region is queried via the BAI- and
+# the CSI-index and compared to the text-output of sam-dump for the same region
+#
+# the test uses the sam-factory-tool to produce a fixed cSRA-object
+# the test also depends on the bam-load-tool and kar-tool to produce a cSRA-object
+#
+
+set -e
+
+source ./check_bin_tools.sh $1 $2
+
+print_verbose "testing sam-dump --bam / --bam-index"
+print_verbose "-------------------------------------------"
+
+PYTHON="python3"
+
+#------------------------------------------------------------
+#produce the fixed sam-file
+
+BAMSAM="bam_sam.SAM"
+BAMREF="bam-ref.fasta"
+
+rm -f "$BAMSAM" "$BAMREF"
+
+#with the help of HEREDOC we pipe the configuration into
+# the sam-factory-tool via stdin: random pairs on 2 references long enough
+# to span several bins of the index, and unaligned records
+$SAMFACTORY << EOF
+r:type=random,name=R1,length=600000
+r:type=random,name=R2,length=300000
+ref-out:$BAMREF
+sam-out:$BAMSAM
+p:name=A,ref=R1,repeat=2000
+p:name=A,ref=R1,repeat=2000
+p:name=B,ref=R2,repeat=1000
+p:name=B,ref=R2,repeat=1000
+u:name=U1,len=44
+u:name=U2,len=60
+EOF
+
+#check if the sam-file and the reference have been produced
+for F in $BAMSAM $BAMREF
+do
+    if [[ ! -f "$F" ]]; then
+        echo "$F not produced"
+        exit 3
+    fi
+done
+
+print_verbose "fixed SAM-file produced!"
+
+BAMCSRA="bam_csra"
+source ./sam_to_csra.sh $BAMSAM $BAMREF $BAMCSRA
+rm $BAMSAM $BAMREF
+
+TEXT_OUT="bam_text.SAM"
+DECODED="bam_decoded.SAM"
+BAMOUT="bam_out.bam"
+REGION="R1:200001-300000"
+
+function cleanup {
+    rm -f $TEXT_OUT $DECODED $BAMOUT $BAMOUT.bai $BAMOUT.csi
+}
+
+function fail {
+    echo "$1"
+    diff $2 $3 | head -n 20
+    cleanup
+    rm -f $BAMCSRA
+    exit 3
+}
+
+#------------------------------------------------------------
+# the BAM-file decoded has to be the text-output, with and without a pool of deflate-threads
+$SAMDUMP $BAMCSRA > $TEXT_OUT
+for IDX in bai csi
+do
+    for THREADS in 1 4
+    do
+        rm -f $BAMOUT $BAMOUT.$IDX
+        $SAMDUMP --bam --bam-index $IDX --threads $THREADS --output-file $BAMOUT $BAMCSRA
+        if [[ ! -s "$BAMOUT.$IDX" ]]; then
+            echo "sam-dump --bam --bam-index $IDX did not produce $BAMOUT.$IDX"
+            cleanup
+            exit 3
+        fi
+        $PYTHON bam_to_sam.py $BAMOUT > $DECODED
+        if ! cmp -s $TEXT_OUT $DECODED; then
+            fail "sam-dump --bam --bam-index $IDX --threads $THREADS differs from the text-output:" $TEXT_OUT $DECODED
+        fi
+        print_verbose "sam-dump --bam --bam-index $IDX --threads $THREADS : identical to text-output"
+    done
+done
+
+#------------------------------------------------------------
+# a region-query via each index has to find what sam-dump prints for the region
+$SAMDUMP --no-header --aligned-region $REGION $BAMCSRA > $TEXT_OUT
+if [[ ! -s "$TEXT_OUT" ]]; then
+    echo "sam-dump --aligned-region $REGION did not produce any output"
+    cleanup
+    exit 3
+fi
+for IDX in bai csi
+do
+    rm -f $BAMOUT $BAMOUT.$IDX
+    $SAMDUMP --bam --bam-index $IDX --output-file $BAMOUT $BAMCSRA
+    $PYTHON bam_to_sam.py $BAMOUT $BAMOUT.$IDX $REGION > $DECODED
+    if ! cmp -s $TEXT_OUT $DECODED; then
+        fail "region $REGION via the $IDX-index differs from sam-dump --aligned-region:" $TEXT_OUT $DECODED
+    fi
+    print_verbose "region $REGION via the $IDX-index : identical to text-output"
+done
+
+#------------------------------------------------------------
+# the unaligned reads come from the text-printer, they are converted into BAM-records
+$SAMDUMP -u $BAMCSRA > $TEXT_OUT
+rm -f $BAMOUT
+$SAMDUMP -u --bam --output-file $BAMOUT $BAMCSRA
+$PYTHON bam_to_sam.py $BAMOUT > $DECODED
+if ! cmp -s $TEXT_OUT $DECODED; then
+    fail "sam-dump -u --bam differs from the text-output:" $TEXT_OUT $DECODED
+fi
+print_verbose "sam-dump -u --bam : identical to text-output"
+
+#we do not need the random cSRA-object any more ...
+cleanup
+rm -f $BAMCSRA
+
+print_verbose "success!"
+print_verbose -e "--------\n"
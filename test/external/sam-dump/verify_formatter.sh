@@ -0,0 +1,123 @@
+#!/usr/bin/env bash
+
+# the goal of this test is to verify the output of the record-formatter of sam-dump
+# against checked-in expected output ( expected/formatter_*.tsv )
+#
+# the test uses the sam-factory-tool to produce a fixed cSRA-object
+# ( sam-factory does not seed its random-generator, the fixture is the same
+#   on every run, no dependecies on production-runs ! )
+#
+# the QNAME is the spot-id given by bam-load, the expected output therefore holds the
+# columns sam-dump takes from the fixture: RNAME, POS, MAPQ, CIGAR, SEQ and QUAL, and
+# for FASTQ the defline without the spot-id, the bases and the qualities
+# the QNAME-modes ( --prefix, --spot-group ) are checked against the default output
+#
+# the test also depends on the bam-load-tool and kar-tool to produce a cSRA-object
+#
+
+set -e
+
+source ./check_bin_tools.sh $1 $2
+
+print_verbose "testing the record-formatter of sam-dump against expected output"
+print_verbose "-------------------------------------------"
+
+#------------------------------------------------------------
+#produce the fixed sam-file
+
+FMTSAM="fmt_sam.SAM"
+FMTREF="fmt-ref.fasta"
+
+rm -f "$FMTSAM" "$FMTREF"
+
+#with the help of HEREDOC we pipe the configuration into
+# the sam-factory-tool via stdin to produce 4 alignment-pairs on 2 references,
+# forward and reverse, with several read-lengths, positions and mapping-qualities
+# ( changing this changes the random bases and qualities: the expected output has to follow )
+$SAMFACTORY << EOF
+r:type=random,name=R1,length=20000
+r:type=random,name=R2,length=12000
+ref-out:$FMTREF
+sam-out:$FMTSAM
+p:name=A,ref=R1,pos=1,mapq=0,opts=RG:Z:grp1
+p:name=A,ref=R1,pos=95,mapq=9,reverse=yes,opts=RG:Z:grp1
+p:name=B,ref=R1,pos=999,mapq=10,cigar=50M,opts=RG:Z:grp1
+p:name=B,ref=R1,pos=1001,mapq=99,cigar=50M,reverse=yes,opts=RG:Z:grp1
+p:name=C,ref=R1,pos=12345,mapq=100,cigar=75M,opts=RG:Z:grp1
+p:name=C,ref=R1,pos=19900,mapq=60,cigar=75M,reverse=yes,opts=RG:Z:grp1
+p:name=D,ref=R2,pos=5000,mapq=255,opts=RG:Z:grp1
+p:name=D,ref=R2,pos=11000,mapq=42,reverse=yes,opts=RG:Z:grp1
+EOF
+
+#check if the sam-file and the reference have been produced
+for F in $FMTSAM $FMTREF
+do
+    if [[ ! -f "$F" ]]; then
+        echo "$F not produced"
+        exit 3
+    fi
+done
+
+print_verbose "fixed SAM-file produced!"
+
+FMTCSRA="fmt_csra"
+source ./sam_to_csra.sh $FMTSAM $FMTREF $FMTCSRA
+rm $FMTSAM $FMTREF
+
+DEFAULT_OUT="fmt_default.SAM"
+MODE_OUT="fmt_mode.SAM"
+PROJECTED="fmt_projected.tsv"
+
+function cleanup {
+    rm -f $DEFAULT_OUT $MODE_OUT $PROJECTED $FMTCSRA
+}
+
+# $1 = what is compared, $2 = expected, $3 = actual
+function compare {
+    if ! cmp -s $2 $3; then
+        echo "$1 differs from $2:"
+        diff $2 $3 | head -n 20
+        cleanup
+        exit 3
+    fi
+    print_verbose "$1 : as expected"
+}
+
+#------------------------------------------------------------
+# SAM: the columns from the fixture, without and with quality-quantization
+$SAMDUMP --no-header $FMTCSRA > $DEFAULT_OUT
+cut -f3-6,10,11 $DEFAULT_OUT | LC_ALL=C sort > $PROJECTED
+compare "sam-dump" expected/formatter_default.tsv $PROJECTED
+
+$SAMDUMP --no-header --qual-quant "1:10,10:20,20:30,30:-" $FMTCSRA > $MODE_OUT
+cut -f3-6,10,11 $MODE_OUT | LC_ALL=C sort > $PROJECTED
+compare "sam-dump --qual-quant" expected/formatter_qual_quant.tsv $PROJECTED
+
+#------------------------------------------------------------
+# FASTQ: defline without the spot-id, bases and qualities in the orientation of the read
+$SAMDUMP --fastq $FMTCSRA | paste - - - - | sed -e 's/^@[0-9]*//' | cut -f1,2,4 | LC_ALL=C sort > $PROJECTED
+compare "sam-dump --fastq" expected/formatter_fastq.tsv $PROJECTED
+
+#------------------------------------------------------------
+# QNAME: the prefix in front of the spot-id, the spot-group ( RG-tag ) behind it,
+# every other column as in the default output
+$SAMDUMP --no-header --prefix PFX $FMTCSRA > $MODE_OUT
+awk -F '\t' 'BEGIN { OFS = "\t" } { $1 = "PFX." $1; print }' $DEFAULT_OUT > $PROJECTED
+compare "sam-dump --prefix" $PROJECTED $MODE_OUT
+
+$SAMDUMP --no-header --spot-group $FMTCSRA > $MODE_OUT
+awk -F '\t' 'BEGIN { OFS = "\t" } {
+    for ( i = 12; i <= NF; ++i ) { if ( substr( $i, 1, 5 ) == "RG:Z:" ) { $1 = $1 "." substr( $i, 6 ) } }
+    print }' $DEFAULT_OUT > $PROJECTED
+if ! grep -q "RG:Z:grp1" $DEFAULT_OUT; then
+    echo "the spot-group of the fixture is missing in the output of sam-dump"
+    cleanup
+    exit 3
+fi
+compare "sam-dump --spot-group" $PROJECTED $MODE_OUT
+
+#we do not need the outputs and the cSRA-object any more ...
+cleanup
+
+print_verbose "success!"
+print_verbose -e "--------\n"
@@ -0,0 +1,103 @@
+#!/usr/bin/env bash
+
+# the goal of this test is to verify that sam-dump produces the same output
+# with several threads walking the references as with one thread
+#
+# the test uses the sam-factory-tool to produce a fixed cSRA-object
+# ( sam-factory does not seed its random-generator, the fixture is the same
+#   on every run, no dependecies on production-runs ! )
+# the references are longer than one window of the threaded walk ( 128k bases ),
+# the mates of the random pairs land in other windows than their partners
+#
+# the test also depends on the bam-load-tool and kar-tool to produce a cSRA-object
+#
+
+set -e
+
+source ./check_bin_tools.sh $1 $2
+
+print_verbose "testing sam-dump with threads against single-threaded output"
+print_verbose "-------------------------------------------"
+
+#------------------------------------------------------------
+#produce the fixed sam-file
+
+THREADSAM="threads_sam.SAM"
+THREADREF="threads-ref.fasta"
+
+rm -f "$THREADSAM" "$THREADREF"
+
+#with the help of HEREDOC we pipe the configuration into
+# the sam-factory-tool via stdin to produce random pairs on 2 references
+# of 5 and 3 windows, pairs with given positions whose mates are
+# in other windows, and unaligned records
+$SAMFACTORY << EOF
+r:type=random,name=R1,length=600000
+r:type=random,name=R2,length=300000
+ref-out:$THREADREF
+sam-out:$THREADSAM
+p:name=A,ref=R1,repeat=3000
+p:name=A,ref=R1,repeat=3000
+p:name=B,ref=R2,repeat=2000
+p:name=B,ref=R2,repeat=2000
+p:name=X1,ref=R1,pos=131000
+p:name=X1,ref=R1,pos=131100
+p:name=X2,ref=R1,pos=100
+p:name=X2,ref=R1,pos=590000
+p:name=X3,ref=R2,pos=262100,reverse=yes
+p:name=X3,ref=R2,pos=1000
+u:name=U1,len=44
+u:name=U2,len=60
+EOF
+
+#check if the sam-file and the reference have been produced
+for F in $THREADSAM $THREADREF
+do
+    if [[ ! -f "$F" ]]; then
+        echo "$F not produced"
+        exit 3
+    fi
+done
+
+print_verbose "fixed SAM-file produced!"
+
+THREADCSRA="threads_csra"
+source ./sam_to_csra.sh $THREADSAM $THREADREF $THREADCSRA
+rm $THREADSAM $THREADREF
+
+#------------------------------------------------------------
+# function to compare the threaded against the serial output
+# $1 = additional sam-dump options, the threads are given as --threads and as -e
+function compare_threads {
+    local SERIAL_OUT="threads_serial.SAM"
+    local THREADED_OUT="threads_threaded.SAM"
+    local THREADS_OPT
+    $SAMDUMP $1 $THREADCSRA > $SERIAL_OUT
+    if [[ ! -s "$SERIAL_OUT" ]]; then
+        echo "sam-dump $1 did not produce any output"
+        exit 3
+    fi
+    for THREADS_OPT in "--threads 4" "-e 4"
+    do
+        $SAMDUMP $1 $THREADS_OPT $THREADCSRA > $THREADED_OUT
+        if ! cmp -s $SERIAL_OUT $THREADED_OUT; then
+            echo "sam-dump $1 $THREADS_OPT differs from the single-threaded output:"
+            diff $SERIAL_OUT $THREADED_OUT | head -n 20
+            rm -f $SERIAL_OUT $THREADED_OUT $THREADCSRA
+            exit 3
+        fi
+        print_verbose "sam-dump $1 $THREADS_OPT : identical"
+    done
+    rm -f $SERIAL_OUT $THREADED_OUT
+}
+
+compare_threads ""
+compare_threads "-u"
+compare_threads "--fastq"
+compare_threads "--no-mate-cache"
+
+#we do not need the random cSRA-object any more ...
+rm -f $THREADCSRA
+
+print_verbose "success!"
+print_verbose -e "--------\n"
@@ -0,0 +1,71 @@
+#!/usr/bin/env python
+
+import subprocess
+import sys
+import os.path
+
+TOOL = sys.argv [ 1 ]
+
+def check_if_tool_exits( tool ) :
+    if not os.path.exists ( tool ):
+        print ( "\nERROR: Can not find tool : '" + tool + "'\n" )
+        exit ( 1 )
+
+def run_tool( tool, args ) :
+    a = [ tool ]
+    for arg in args :
+        a.append( arg )
+    p = subprocess.Popen ( a, stdout = subprocess.PIPE, stderr = subprocess.PIPE )
+    res  = "".join( chr( x ) for x in p.stdout.read() )
+    if p.wait() != 0 :
+        print ( "error executing tool" )
+        exit( 1 )
+    return res
+
+# position -> depth from the samtools-like pileup ( ref, pos, base, depth, ... )
+def depth_of_pileup( text ) :
+    res = {}
+    for line in text.splitlines() :
+        f = line.split( "\t" )
+        res[ int( f[ 1 ] ) ] = int( f[ 3 ] )
+    return res
+
+# position -> depth from the bedGraph-intervals ( ref, start 0-based, end exclusive, depth )
+def depth_of_intervals( text ) :
+    res = {}
+    for line in text.splitlines() :
+        f = line.split( "\t" )
+        for pos in range( int( f[ 1 ] ) + 1, int( f[ 2 ] ) + 1 ) :
+            res[ pos ] = int( f[ 3 ] )
+    return res
+
+if sys.version_info[ 0 ] < 3 :
+    print( "does not work with python version < 3!" )
+    sys.exit( 3 )
+
+check_if_tool_exits( TOOL )
+
+# the slice covers 3 windows of 64k, to test the cuts between them
+SLICE = "chr1:3000000-3200000"
+ACCESSION = "SRR5486177"
+
+print( "running step 1" )
+pileup = run_tool( TOOL, [ ACCESSION, "-r", SLICE ] )
+
+print( "running step 2" )
+depth = run_tool( TOOL, [ ACCESSION, "-r", SLICE, "--function", "depth" ] )
+if depth_of_pileup( pileup ) != depth_of_intervals( depth ) :
+    print ( "error comparison 1: the depth differs from the depth of the pileup" )
+    exit( 1 )
+
+print( "running step 3" )
+depth_mt = run_tool( TOOL, [ ACCESSION, "-r", SLICE, "--function", "depth", "--threads", "4" ] )
+if depth != depth_mt :
+    print ( "error comparison 2:" )
+    print ( depth )
+    print ( "vs:" )
+    print ( depth_mt )
+    exit( 1 )
+
+print ( "[" + os.path.basename ( __file__ ) + "] test passed for tool '" + TOOL + "'" )
+exit( 0 )
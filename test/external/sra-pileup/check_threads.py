@@ -0,0 +1,66 @@
+#!/usr/bin/env python
+
+import subprocess
+import sys
+import os.path
+
+TOOL = sys.argv [ 1 ]
+
+def check_if_tool_exits( tool ) :
+    if not os.path.exists ( tool ):
+        print ( "\nERROR: Can not find tool : '" + tool + "'\n" )
+        exit ( 1 )
+
+def run_tool( tool, args ) :
+    a = [ tool ]
+    for arg in args :
+        a.append( arg )
+    p = subprocess.Popen ( a, stdout = subprocess.PIPE, stderr = subprocess.PIPE )
+    res  = "".join( chr( x ) for x in p.stdout.read() )
+    if p.wait() != 0 :
+        print ( "error executing tool" )
+        exit( 1 )
+    return res
+
+if sys.version_info[ 0 ] < 3 :
+    print( "does not work with python version < 3!" )
+    sys.exit( 3 )
+
+check_if_tool_exits( TOOL )
+
+# the slice covers 3 windows of 64k, to test the cuts between them
+SLICE = "chr1:3000000-3200000"
+ACCESSION = "SRR5486177"
+
+# the output with 4 threads has to be the single-threaded output, for every function walked in windows
+step = 0
+for function in [ None, "counters", "stat", "index", "varcount" ] :
+    args = [ ACCESSION, "-r", SLICE ]
+    if function is not None :
+        args += [ "--function", function ]
+    name = "default" if function is None else function
+
+    step += 1
+    print( "running step %d ( %s )" % ( step, name ) )
+    serial = run_tool( TOOL, args )
+    if len( serial ) == 0 :
+        print ( "error: no output for function " + name )
+        exit( 1 )
+    threaded = run_tool( TOOL, args + [ "--threads", "4" ] )
+    if serial != threaded :
+        print ( "error comparison %d: function %s differs with 4 threads" % ( step, name ) )
+        s = serial.splitlines()
+        t = threaded.splitlines()
+        for i in range( max( len( s ), len( t ) ) ) :
+            a = s[ i ] if i < len( s ) else "<missing>"
+            b = t[ i ] if i < len( t ) else "<missing>"
+            if a != b :
+                print ( "line %d:" % ( i + 1 ) )
+                print ( a )
+                print ( "vs:" )
+                print ( b )
+                break
+        exit( 1 )
+
+print ( "[" + os.path.basename ( __file__ ) + "] test passed for tool '" + TOOL + "'" )
+exit( 0 )
@@ -16,6 +16,20 @@ if [ "$res" != "0" ];
 	then echo "sra-pileup check_skiplist test FAILED, res=$res output=$output" && exit 1;
 fi
 
+echo check_depth:
+output=$(${python_bin} check_depth.py ${bin_dir}/sra-pileup)
+res=$?
+if [ "$res" != "0" ];
+	then echo "sra-pileup check_depth test FAILED, res=$res output=$output" && exit 1;
+fi
+
+echo check_threads:
+output=$(${python_bin} check_threads.py ${bin_dir}/sra-pileup)
+res=$?
+if [ "$res" != "0" ];
+	then echo "sra-pileup check_threads test FAILED, res=$res output=$output" && exit 1;
+fi
+
 echo fastq_dump_vs_sam_dump:
 ACC=SRR3332402
 output=$(${python_bin} test_diff_fastq_dump_vs_sam_dump.py -a ${ACC} -f ${bin_dir}/fastq-dump -m ${bin_dir}/sam-dump)
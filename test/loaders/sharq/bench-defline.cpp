@@ -0,0 +1,209 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Benchmark for SHARQ defline matchers
+*
+* usage: bench-defline [-n iterations] [corpus-file]
+*
+* Runs every matcher over a corpus of deflines (built-in samples, or one
+* defline per line from corpus-file) and reports ns/defline per matcher and
+* per platform, with and without the shape prefilter.
+* Fails if the prefilter rejects a defline the matcher's regex accepts.
+*/
+#include <cassert>
+#include "../../../tools/loaders/sharq/fastq_defline_parser.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+using namespace std;
+
+struct sample_t
+{
+    string platform;
+    string defline;
+};
+
+static const vector<sample_t> s_samples = {
+    { "Illumina", "@HET-141-007:154:C391TACXX:6:1216:12924:76893 1:N:0" },
+    { "Illumina", "@DJB77P1:546:H8V5MADXX:2:1101:11528:3334 1:N:0:_I_GACGAC" },
+    { "Illumina", "@DG7PMJN1:293:D12THACXX:2:1101:1161:1968_1:N:0:GATCAG" },
+    { "Illumina", "@8:1101:1486:2141 1:N:0:/1" },
+    { "Illumina", "@HWI-ST1234:33:D1019ACXX:2:1101:1415:2223/1 1:N:0:ATCACG" },
+    { "Illumina", "@MISEQ:36:000000000-A5BCL:1:1101:24982:8584;smpl=12;brcd=ACTTTCCCTCGA 1:N:0:ACTTTCCCTCGA" },
+    { "Illumina", "@SAMPLE.7.1101.1234.5678 1.N.0.ACGTAC" },
+    { "Illumina", "@SAMPLE_7_1101_1234_5678 1_N_0_ACGTAC" },
+    { "Illumina", "@spot2 1:N:0:ATCTTGTT" },
+    { "Illumina", ">HWI-EAS6_4_FC2010T:1:1:80:366" },
+    { "Illumina", "@120315_SN711_0193_BC0KW7ACXX:1:1101:1419:2074:1#0/1" },
+    { "Illumina", "@7:1:164:-0" },
+    { "Illumina", "@HWI-EAS30_2_FC20416AAXX_7_1_116_317" },
+    { "Illumina", "@HWI-IT879:92:5:1101:1170:2026#0/1:0" },
+    { "Illumina", ">M01056:83:000000000-A7GBN:1:1108:17094:2684--W1" },
+    { "Illumina", "@READ_190546#ACGTAC/1" },
+    { "Illumina", "@Read_190546#BC005 length=1419" },
+    { "Illumina", "@200/2" },
+    { "BGI", "@CL100159005L1C001R001_2 1:N:0:0" },
+    { "BGI", "@CL100048465L2C001R015_402436/1" },
+    { "PacBio", "@m101111_134728_richard_c000027022550000000115022502211150_s1_p0/1" },
+    { "PacBio", "@m120204_011539_00128_c100220982555400000315052304111230_s2_p0/8/0_1446" },
+    { "PacBio", "@m54261_181223_050738_4194378" },
+    { "PacBio", "@m54336U_191028_160945/1/120989_128438" },
+    { "PacBio", "@m64049_200827_171349/2/ccs" },
+    { "Nanopore", "@channel_108_read_11_twodirections:flowcell_17/LomanLabz_PC_E.coli_MG1655_ONI_3058_1_ch108_file21_strand.fast5" },
+    { "Nanopore", "@ch120_file10_strand_template" },
+    { "Nanopore", "@7f63e67e-fef9-41f6-885a-b253662e145d_Basecall_Alignment_template MINICOL235_20170120_FN__MN16250_sequencing_throughput_ONLL3135_25304_ch143_read16016_strand" },
+    { "Nanopore", "@77_2_Basecall_2D_template MINION_read_20_ch_41_strand.fast5" },
+    { "Nanopore", "@3b1b4e3c-3e1d-4a70-9e33-2d7a8e3f1c2b runid=5c1a read=123 ch=45 start_time=2019-01-01T00:00:00Z" },
+    { "Nanopore", "@7f63e67e-fef9-41f6-885a-b253662e145d_Basecall_1D_template" },
+    { "IonTorrent", ">311CX:3560:2667   length=347" },
+    { "IonTorrent", "@A313D:7:49" },
+    { "IonTorrent", "@SEDCJ:00674:05781 1:N:0:AAAAA" },
+    { "LS454", "@EBE9SKK01DZCXB" },
+    { "LS454", "@GA8TRFX01AMSQN/1" },
+    { "ElementBio", "@AV240401:AVT0059:2409682889:1:10602:5169:0001" },
+    { "ElementBio", "@AV234203:AVITI_0003_A:2327482621:1:10102:0605:0003 1:N:0:TCGCCAGA+CGAGCTTT" },
+    { "Other", "@SRA56789 200/1" },
+    { "Other", "@qqq" },
+};
+
+static double s_NsPerDefline(chrono::steady_clock::duration elapsed, size_t count)
+{
+    return count == 0 ? 0 : double(chrono::duration_cast<chrono::nanoseconds>(elapsed).count()) / count;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t iterations = 1000;
+    vector<sample_t> corpus;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            iterations = stoul(argv[++i]);
+        } else {
+            ifstream in(arg);
+            if (!in) {
+                cerr << "Failed to open '" << arg << "'" << endl;
+                return 2;
+            }
+            string line;
+            while (getline(in, line)) {
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                if (!line.empty())
+                    corpus.push_back({ string(), line });
+            }
+        }
+    }
+    if (corpus.empty())
+        corpus = s_samples;
+
+    CDefLineParser parser;
+    parser.SetMatchAll();
+    const auto& matchers = parser.GetDeflineMatchers();
+
+    // the platform of a corpus line is the one of the first matcher accepting it
+    for (auto& sample : corpus) {
+        if (!sample.platform.empty())
+            continue;
+        CDefLineParser p;
+        sample.platform = p.Match(sample.defline, true) ? p.GetDeflineType() : "Other";
+    }
+
+    // the prefilter must not reject what the regex accepts
+    int rc = 0;
+    for (auto& matcher : matchers) {
+        for (auto& sample : corpus) {
+            if (matcher->Matches(sample.defline) && !matcher->MayMatch(CDefLineShape(sample.defline))) {
+                cerr << "Prefilter of " << matcher->Defline() << " rejects '" << sample.defline << "'" << endl;
+                rc = 1;
+            }
+        }
+    }
+
+    cout << "corpus: " << corpus.size() << " deflines, " << iterations << " iterations" << endl << endl;
+
+    // every matcher over the whole corpus
+    cout << "matcher                      regex ns/defline  prefiltered ns/defline  regex runs" << endl;
+    size_t hits = 0;
+    for (auto& matcher : matchers) {
+        auto start = chrono::steady_clock::now();
+        for (size_t it = 0; it < iterations; ++it)
+            for (auto& sample : corpus)
+                hits += matcher->Matches(sample.defline);
+        auto regex_time = chrono::steady_clock::now() - start;
+
+        size_t runs = 0;
+        start = chrono::steady_clock::now();
+        for (size_t it = 0; it < iterations; ++it)
+            for (auto& sample : corpus) {
+                if (matcher->MayMatch(CDefLineShape(sample.defline))) {
+                    ++runs;
+                    hits += matcher->Matches(sample.defline);
+                }
+            }
+        auto filtered_time = chrono::steady_clock::now() - start;
+        printf("%-28s %18.1f %23.1f %7.1f%%\n", matcher->Defline().c_str(),
+            s_NsPerDefline(regex_time, iterations * corpus.size()),
+            s_NsPerDefline(filtered_time, iterations * corpus.size()),
+            100.0 * runs / (iterations * corpus.size()));
+    }
+
+    // the lookup of a defline's matcher from scratch, per platform
+    map<string, vector<string>> platforms;
+    for (auto& sample : corpus)
+        platforms[sample.platform].push_back(sample.defline);
+    cout << endl << "platform                     full scan ns/defline  dispatch ns/defline" << endl;
+    for (auto& [platform, deflines] : platforms) {
+        auto start = chrono::steady_clock::now();
+        for (size_t it = 0; it < iterations; ++it)
+            for (auto& defline : deflines) {
+                for (auto& matcher : matchers) {
+                    if (matcher->Matches(defline)) {
+                        ++hits;
+                        break;
+                    }
+                }
+            }
+        auto scan_time = chrono::steady_clock::now() - start;
+
+        start = chrono::steady_clock::now();
+        for (size_t it = 0; it < iterations; ++it)
+            for (auto& defline : deflines) {
+                parser.Reset();
+                hits += parser.Match(defline);
+            }
+        auto dispatch_time = chrono::steady_clock::now() - start;
+        printf("%-28s %20.1f %20.1f\n", platform.c_str(),
+            s_NsPerDefline(scan_time, iterations * deflines.size()),
+            s_NsPerDefline(dispatch_time, iterations * deflines.size()));
+    }
+    cout << endl << "matches: " << hits << endl;
+    return rc;
+}
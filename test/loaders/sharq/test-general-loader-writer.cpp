@@ -0,0 +1,133 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for SHARQ loader's in-process VDB writer ( --vdb-direct )
+*/
+
+#include "../../../tools/loaders/sharq/general_loader_writer.hpp"
+
+#include <thread>
+
+#include <kfs/directory.h>
+
+#include <ktst/unit_test.hpp>
+
+using namespace std;
+
+TEST_SUITE(SharQGeneralLoaderWriterTestSuite);
+
+static bool db_exists(const string& path)
+{
+    KDirectory* wd = nullptr;
+    if (KDirectoryNativeDir(&wd) != 0)
+        return false;
+    bool res = (KDirectoryPathType(wd, "%s", path.c_str()) != kptNotFound);
+    KDirectoryRelease(wd);
+    return res;
+}
+
+static void make_actual_dir()
+{
+    KDirectory* wd = nullptr;
+    if (KDirectoryNativeDir(&wd) == 0) {
+        KDirectoryCreateDir(wd, 0775, kcmOpen | kcmParents, "actual");
+        KDirectoryRelease(wd);
+    }
+}
+
+class GeneralLoaderWriterFixture
+{
+public:
+    GeneralLoaderWriterFixture()
+        : m_writer("test-general-loader-writer", vector<string>{ SCHEMA_INCLUDE })
+    {
+        make_actual_dir();
+    }
+
+    void Open(const string& db)
+    {
+        m_db = "actual/" + db;
+        m_writer.destination(m_db);
+        m_writer.schema("sra/generic-fastq.vschema", "NCBI:SRA:GenericFastq:db");
+        m_writer.openTable(1, "SEQUENCE");
+        m_writer.openColumn(1, 1, 8, "READ");
+        m_writer.beginWriting();
+    }
+
+    void WriteRows(size_t count)
+    {
+        static const char bases[] = "ACGTACGTAC";
+        for (size_t i = 0; i < count; ++i) {
+            m_writer.value(1, 10, 1, bases);
+            m_writer.closeRow(1);
+        }
+    }
+
+    sharq::general_loader_writer m_writer;
+    string m_db;
+};
+
+FIXTURE_TEST_CASE(ErrorMessage_Fails_The_Load, GeneralLoaderWriterFixture)
+{
+    Open("glw-error");
+    WriteRows(10);
+    m_writer.errorMessage("something went wrong");
+    REQUIRE(!m_writer.endWriting());
+    REQUIRE(!db_exists(m_db));
+}
+
+// the producer's log-sink reports errors from other threads while the rows are written
+FIXTURE_TEST_CASE(ErrorMessage_From_Another_Thread, GeneralLoaderWriterFixture)
+{
+    Open("glw-error-mt");
+    thread reporter([this]() { m_writer.errorMessage("something went wrong"); });
+    WriteRows(3 * sharq::general_loader_writer::BATCH_ROWS);
+    reporter.join();
+    REQUIRE(!m_writer.endWriting());
+    REQUIRE(!db_exists(m_db));
+}
+
+TEST_CASE(Destroyed_Without_EndWriting)
+{
+    make_actual_dir();
+    {
+        sharq::general_loader_writer writer("test-general-loader-writer", vector<string>{ SCHEMA_INCLUDE });
+        writer.destination("actual/glw-abandoned");
+        writer.schema("sra/generic-fastq.vschema", "NCBI:SRA:GenericFastq:db");
+        writer.openTable(1, "SEQUENCE");
+        writer.openColumn(1, 1, 8, "READ");
+        writer.beginWriting();
+        writer.value(1, 4, 1, "ACGT");
+        writer.closeRow(1);
+    }
+    REQUIRE(!db_exists("actual/glw-abandoned"));
+}
+
+int main(int argc, char* argv[])
+{
+    return SharQGeneralLoaderWriterTestSuite(argc, argv);
+}
@@ -32,6 +32,8 @@
 #include "../../tools/loaders/sharq/fastq_parser.hpp"
 #include "../../tools/loaders/sharq/fastq_writer.hpp"
 
+#include <filesystem>
+
 using namespace std;
 
 TEST_SUITE(SharQParserTestSuite);
@@ -124,6 +126,171 @@ FIXTURE_TEST_CASE(ReaderMd5, LoaderFixture)
     wr->close();
 }
 
+FIXTURE_TEST_CASE(SpotSpill, LoaderFixture)
+{   // far reads round-trip through the spill partitions
+    const size_t num_spots = 1000;
+    sharq::spot_spill_t spill;
+    string dir = filesystem::temp_directory_path().string();
+    spill.open(dir, 4);
+    REQUIRE(spill.is_open());
+    // mate 1 of all spots, then mate 2 of all spots in reverse order
+    for (size_t i = 0; i < 2 * num_spots; ++i) {
+        bool is_last = i >= num_spots;
+        size_t spot_no = is_last ? 2 * num_spots - 1 - i : i;
+        fastq_read read;
+        read.SetSpot("spot" + to_string(spot_no));
+        read.m_SpotId = spot_no + 1;
+        read.m_ReaderIdx = is_last;
+        read.SetLineNumber(4 * i);
+        read.SetReadNum(string(is_last ? "2" : "1"));
+        read.SetSpotGroup(string("ACGT"));
+        read.SetReadFilter(spot_no % 2);
+        read.SetSequence(string(10 + spot_no % 7, "ACGTN"[spot_no % 5]));
+        read.SetQualScores(vector<uint8_t>(10 + spot_no % 7, 30 + spot_no % 10));
+        spill.save_read(read, is_last);
+    }
+
+    size_t spots = 0;
+    size_t prev_line = 0;
+    size_t order_breaks = 0;
+    spill.assemble([&](vector<fastq_read>& spot) {
+        REQUIRE_EQ(spot.size(), 2lu);
+        size_t spot_no = spot[0].m_SpotId - 1;
+        REQUIRE_EQ(spot[1].m_SpotId, spot_no + 1);
+        REQUIRE_EQ(spot[1].Spot(), "spot" + to_string(spot_no));
+        REQUIRE_EQ(spot[0].ReadNum(), string("1"));
+        REQUIRE_EQ(spot[1].ReadNum(), string("2"));
+        REQUIRE_EQ(spot[0].LineNumber(), 4 * spot_no);
+        REQUIRE_EQ((int)spot[1].m_ReaderIdx, 1);
+        REQUIRE_EQ(spot[1].SpotGroup(), string("ACGT"));
+        REQUIRE_EQ((int)spot[0].ReadFilter(), int(spot_no % 2));
+        REQUIRE_EQ(spot[0].Sequence(), string(10 + spot_no % 7, "ACGTN"[spot_no % 5]));
+        REQUIRE(spot[1].GetQualScores() == vector<uint8_t>(10 + spot_no % 7, 30 + spot_no % 10));
+        if (spot[1].LineNumber() < prev_line)
+            ++order_breaks;
+        prev_line = spot[1].LineNumber();
+        ++spots;
+    });
+    REQUIRE_EQ(spots, num_spots);
+    REQUIRE_LT(order_breaks, 4lu); // in the order of the last reads within a partition
+    REQUIRE(!spill.is_open());
+
+    const auto& metrics = spill.metrics();
+    REQUIRE_EQ(metrics.reads, 2 * num_spots);
+    REQUIRE_EQ(metrics.spots, num_spots);
+    REQUIRE_EQ(metrics.partitions, 4lu);
+    REQUIRE_GT(metrics.bytes, 0lu);
+    REQUIRE_LT(metrics.max_partition_bytes, metrics.bytes);
+    REQUIRE_LE(metrics.max_pending_reads, num_spots);
+}
+
+FIXTURE_TEST_CASE(StageQueue, LoaderFixture)
+{   // every item gets to exactly one consumer, the queue is done once all producers close it
+    const size_t num_producers = 3;
+    const size_t num_consumers = 4;
+    const size_t num_items = 20000;
+    atomic<bool> cancelled{false};
+    queue_t<size_t, 64> queue("test_queue", cancelled, num_producers, num_consumers);
+
+    vector<future<void>> producers;
+    for (size_t p = 0; p < num_producers; ++p)
+        producers.push_back(std::async(std::launch::async, [&, p]() {
+            vector<size_t> batch;
+            for (size_t i = p; i < num_items; i += num_producers) {
+                if (i % 2) {
+                    queue.enqueue(size_t(i));
+                } else {
+                    batch.push_back(i);
+                    if (batch.size() == 16)
+                        queue.enqueue_bulk(batch);
+                }
+            }
+            queue.enqueue_bulk(batch);
+            queue.close();
+        }));
+
+    vector<vector<size_t>> received(num_consumers);
+    vector<future<void>> consumers;
+    for (size_t c = 0; c < num_consumers; ++c)
+        consumers.push_back(std::async(std::launch::async, [&, c]() {
+            if (c % 2) {
+                size_t item;
+                while (queue.dequeue(item))
+                    received[c].push_back(item);
+            } else {
+                vector<size_t> items;
+                while (queue.dequeue_bulk(items, 8))
+                    received[c].insert(received[c].end(), items.begin(), items.end());
+            }
+        }));
+    for (auto& f : producers)
+        f.get();
+    for (auto& f : consumers)
+        f.get();
+
+    vector<size_t> all;
+    for (const auto& r : received)
+        all.insert(all.end(), r.begin(), r.end());
+    sort(all.begin(), all.end());
+    REQUIRE_EQ(all.size(), num_items);
+    for (size_t i = 0; i < num_items; ++i)
+        REQUIRE_EQ(all[i], i);
+    REQUIRE(queue.eof());
+
+    auto stats = queue.stats();
+    REQUIRE_EQ(stats.capacity, 64lu);
+    REQUIRE_EQ(stats.producers, num_producers);
+    REQUIRE_EQ(stats.consumers, num_consumers);
+    REQUIRE_EQ(stats.enqueued, num_items);
+    REQUIRE_EQ(stats.dequeued, num_items);
+    REQUIRE_GT(stats.max_occupancy, 0lu);
+    REQUIRE_LE(stats.max_occupancy, 64lu);
+    REQUIRE_LE(stats.avg_occupancy(), 64.);
+    REQUIRE_GT(stats.wall, 0.);
+
+    sharq::queue_stats_t total;
+    total += stats;
+    total += stats;
+    REQUIRE_EQ(total.enqueued, 2 * num_items);
+    REQUIRE_EQ(total.max_occupancy, stats.max_occupancy);
+}
+
+FIXTURE_TEST_CASE(SpotNameIndex, LoaderFixture)
+{   // names are counted across runs and flushes, duplicates survive a save/load round trip
+    const size_t num_names = 50000;
+    sharq::spot_name_index index(4);
+    auto name = [](size_t i) { return "SRR000001.L1C001R" + to_string(i) + "/1"; };
+    for (size_t i = 0; i < num_names; ++i) {
+        index.add(name(i));
+        if (i % 1000 == 0)
+            index.add(name(i / 2));
+        if (i == num_names / 2)
+            index.flush();
+    }
+    index.flush();
+    REQUIRE_EQ(index.size(), num_names + num_names / 1000);
+    REQUIRE_EQ(index.count(name(0)), 2lu);
+    REQUIRE_EQ(index.count(name(500)), 2lu);
+    REQUIRE_EQ(index.count(name(501)), 1lu);
+    REQUIRE_EQ(index.count(name(num_names - 1)), 1lu);
+    REQUIRE_EQ(index.count(name(num_names)), 0lu);
+    REQUIRE_EQ(index.count(string()), 0lu);
+
+    string file = (filesystem::temp_directory_path() / "sharq_spot_names.idx").string();
+    index.save(file);
+    sharq::spot_name_index loaded;
+    loaded.load(file);
+    filesystem::remove(file);
+    REQUIRE_EQ(loaded.size(), index.size());
+    REQUIRE_EQ(loaded.count(name(500)), 2lu);
+
+    map<string, size_t> dups;
+    loaded.for_each_duplicate([&](const string& n, size_t count) { dups[n] = count; });
+    REQUIRE_EQ(dups.size(), num_names / 1000);
+    REQUIRE_EQ(dups[name(0)], 2lu);
+    REQUIRE_EQ(dups[name(24500)], 2lu);
+}
+
 ////////////////////////////////////////////
 
 int main (int argc, char *argv [])
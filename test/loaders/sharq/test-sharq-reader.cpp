@@ -31,6 +31,8 @@
 #include "../../tools/loaders/sharq/fastq_parser.hpp"
 #include "../../tools/loaders/sharq/fastq_read.hpp"
 #include "../../tools/loaders/sharq/fastq_error.hpp"
+#include "../../tools/loaders/sharq/fastq_block_reader.hpp"
+#include "../../tools/loaders/sharq/parallel_inflate.hpp"
 
 #include <ktst/unit_test.hpp>
 #include <klib/rc.h>
@@ -1248,6 +1250,146 @@ FIXTURE_TEST_CASE(ElementBio, LoaderFixture)
     REQUIRE(read.ReadNum().empty());
 }
 
+FIXTURE_TEST_CASE(BlockReaderLines, LoaderFixture)
+{   // tiny blocks: lines cross the block boundaries, one line is longer than a block
+    const string longLine(100, 'A');
+    sharq::fastq_block_reader reader(create_stream("ab\n\n" + longLine + "\r\nlast"), 8);
+    string_view line;
+    REQUIRE(reader.get_line(line));
+    REQUIRE_EQ(string(line), string("ab"));
+    REQUIRE(reader.get_line(line));
+    REQUIRE(line.empty());
+    REQUIRE(reader.get_line(line));
+    REQUIRE_EQ(string(line), longLine + "\r");
+    REQUIRE(!reader.eof());
+    REQUIRE(reader.get_line(line));
+    REQUIRE_EQ(string(line), string("last"));
+    REQUIRE(reader.eof());
+    REQUIRE(!reader.get_line(line));
+}
+
+FIXTURE_TEST_CASE(BlockReaderHeldBlock, LoaderFixture)
+{   // a held block keeps its lines valid while the reader moves on
+    sharq::fastq_block_reader reader(create_stream("first\nsecond\nthird\n"), 4);
+    string_view first;
+    REQUIRE(reader.get_line(first));
+    sharq::fastq_block_ptr block = reader.current_block();
+    string_view line;
+    while (reader.get_line(line));
+    REQUIRE(reader.eof());
+    REQUIRE_EQ(string(first), string("first"));
+}
+
+FIXTURE_TEST_CASE(CrLfReads, LoaderFixture)
+{   // records with crlf line-ends, the carriage-returns are trimmed
+    string data;
+    for (int i = 0; i < 1000; ++i)
+        data += "@" + cDEFLINE1 + "\r\n" + cSEQ + "\r\n+\r\n" + cQUAL + "\r\n";
+    fastq_reader reader("test", create_stream(data));
+    CFastqRead read;
+    size_t count = 0;
+    while (reader.parse_read<>(read)) {
+        REQUIRE_EQ(read.Spot(), cSPOT1);
+        REQUIRE_EQ(read.Sequence(), cSEQ);
+        REQUIRE_EQ(read.Quality(), cQUAL);
+        ++count;
+    }
+    REQUIRE_EQ(count, 1000lu);
+    REQUIRE(reader.eof());
+}
+
+// gzip member of 'data', with the BGZF 'BC' extra field if bgzf is set
+static string s_GzipMember(const string& data, bool bgzf)
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    gz_header header;
+    memset(&header, 0, sizeof(header));
+    Bytef extra[6] = { 'B', 'C', 2, 0, 0, 0 };
+    if (bgzf) {
+        header.extra = extra;
+        header.extra_len = sizeof(extra);
+        deflateSetHeader(&strm, &header);
+    }
+    string out(deflateBound(&strm, data.size()) + 64, 0);
+    strm.next_in = (Bytef*)data.data();
+    strm.avail_in = data.size();
+    strm.next_out = (Bytef*)out.data();
+    strm.avail_out = out.size();
+    deflate(&strm, Z_FINISH);
+    out.resize(strm.total_out);
+    deflateEnd(&strm);
+    if (bgzf) {
+        uint16_t bsize = uint16_t(out.size() - 1);
+        out[16] = char(bsize & 0xff);
+        out[17] = char(bsize >> 8);
+    }
+    return out;
+}
+
+static size_t s_CountReads(const string& compressed, unsigned threads, bool& is_compressed)
+{
+    auto sb = sharq::make_parallel_inflate(new stringbuf(compressed), threads);
+    fastq_reader reader("test", shared_ptr<istream>(new sharq::istreambuf_holder(sb)));
+    CFastqRead read;
+    size_t count = 0;
+    while (reader.parse_read<>(read)) {
+        if (read.Sequence() != cSEQ || read.Quality() != cQUAL)
+            throw runtime_error("read mismatch");
+        ++count;
+    }
+    // bxz detects the compression on the first read
+    is_compressed = reader.is_compressed();
+    return count;
+}
+
+FIXTURE_TEST_CASE(ParallelInflate, LoaderFixture)
+{   // BGZF blocks, concatenated gzip members and plain text
+    string bgzf, members, plain;
+    for (int i = 0; i < 100; ++i) {
+        string chunk;
+        for (int j = 0; j < 200; ++j)
+            chunk += "@" + cDEFLINE1 + "\n" + cSEQ + "\n+\n" + cQUAL + "\n";
+        bgzf += s_GzipMember(chunk, true);
+        members += s_GzipMember(chunk, false);
+        plain += chunk;
+    }
+    bgzf += s_GzipMember("", true);    // BGZF end-of-file marker
+
+    bool is_compressed = false;
+    REQUIRE_EQ(s_CountReads(bgzf, 4, is_compressed), 20000lu);
+    REQUIRE(is_compressed);
+    REQUIRE_EQ(s_CountReads(members, 4, is_compressed), 20000lu);
+    REQUIRE(is_compressed);
+    REQUIRE_EQ(s_CountReads(plain, 4, is_compressed), 20000lu);
+    REQUIRE(!is_compressed);
+    // without the front end bxz decompresses
+    REQUIRE_EQ(s_CountReads(members, 0, is_compressed), 20000lu);
+    REQUIRE(is_compressed);
+}
+
+static string s_Inflate(const string& compressed, unsigned threads)
+{
+    sharq::istreambuf_holder in(sharq::make_parallel_inflate(new stringbuf(compressed), threads));
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+FIXTURE_TEST_CASE(ParallelInflateTruncated, LoaderFixture)
+{   // truncated input ends with the data inflated so far, as it does with bxz
+    string chunk;
+    for (int j = 0; j < 1000; ++j)
+        chunk += "@" + cDEFLINE1 + "\n" + cSEQ + "\n+\n" + cQUAL + "\n";
+    string bgzf = s_GzipMember(chunk, true);
+    string truncated = s_Inflate(bgzf.substr(0, bgzf.size() / 2), 0);
+    REQUIRE(!truncated.empty());
+    REQUIRE_LT(truncated.size(), chunk.size());
+    REQUIRE_EQ(truncated, chunk.substr(0, truncated.size()));
+    REQUIRE_EQ(s_Inflate(bgzf.substr(0, bgzf.size() / 2), 2), truncated);
+    string member = s_GzipMember(chunk, false);
+    REQUIRE_EQ(s_Inflate(member.substr(0, member.size() / 2), 2), s_Inflate(member.substr(0, member.size() / 2), 0));
+}
+
 ////////////////////////////////////////////
 
 int main (int argc, char *argv [])
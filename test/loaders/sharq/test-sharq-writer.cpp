@@ -29,6 +29,7 @@
 */
 
 #include "../../../tools/loaders/sharq/fastq_writer.hpp"
+#include "../../../tools/loaders/sharq/shard_merge.hpp"
 
 #include <tuple>
 
@@ -275,6 +276,66 @@ FIXTURE_TEST_CASE(Fingerprinting, VdbWriterFixture)
     }
 }
 
+// general-writer stream of a shard with one spot from one input file
+static string s_shard_stream(const string& file, const string& sequence)
+{
+    ostringstream os;
+    {
+        fastq_writer_vdb w(os);
+        CFastqRead r;
+        r.SetSequence(sequence);
+        Fingerprint fp;
+        fp.record(r.Sequence());
+        const uint8_t md5[16] = {};
+        w.set_checksums(file, fp, md5);
+        w.open();
+        w.write_spot("spot_" + file, { r });
+        w.close();
+    }
+    return os.str();
+}
+
+TEST_CASE(ShardMerge)
+{   // the merged run has the rows of both shards, renumbered input fingerprints and the combined output fingerprint
+    const string part1 = "test-sharq-writer.shard1";
+    const string part2 = "test-sharq-writer.shard2";
+    ofstream(part1, ios::binary) << s_shard_stream("file1", "A");
+    ofstream(part2, ios::binary) << s_shard_stream("file2", "C");
+
+    shared_ptr<test_writer> tw(new test_writer());
+    sharq::shard_merger merger(tw, "merged.out");
+    merger.merge({ part1, part2 });
+    remove(part1.c_str());
+    remove(part2.c_str());
+
+    REQUIRE_EQ( string("merged.out"), tw->m_destination );
+    REQUIRE_EQ( string("NCBI:SRA:GenericFastq:db"), tw->m_dbSpec );
+    REQUIRE_EQ( (size_t)2, merger.metrics().parts );
+    REQUIRE_EQ( (size_t)2, merger.metrics().rows );
+    REQUIRE_EQ( (size_t)2, merger.metrics().input_files );
+
+    REQUIRE_EQ( 8, (int)tw->m_metadata.size() );  // 1 per input + 6 for output
+    REQUIRE_EQ( string("LOAD/QC/file_1"), get<2>(tw->m_metadata[0]) );
+    REQUIRE_EQ( string("LOAD/QC/file_2"), get<2>(tw->m_metadata[1]) );
+    REQUIRE_EQ( string("file2"), get<4>(tw->m_metadataAttrs[6]) );
+
+    // same as for a single load of both spots, see Fingerprinting
+    REQUIRE_EQ( string("QC/current/fingerprint"), get<2>(tw->m_metadata[2]) );
+    REQUIRE_EQ( string(R"({"maximum-position":1,"A":[1,0],"C":[1,0],"G":[0,0],"T":[0,0],"N":[0,0],"EoR":[0,2]})"), get<3>(tw->m_metadata[2]) );
+    REQUIRE_EQ( string("2944f448d685435cffa136126a7fd7975d9177b36369b480ddd64c0bf818a5e0"), get<3>(tw->m_metadata[3]) );
+}
+
+TEST_CASE(ShardMergeIncomplete)
+{
+    const string part = "test-sharq-writer.shard";
+    auto stream = s_shard_stream("file1", "A");
+    ofstream(part, ios::binary) << stream.substr(0, stream.size() - 4); // no end of stream
+    shared_ptr<test_writer> tw(new test_writer());
+    sharq::shard_merger merger(tw, "merged.out");
+    REQUIRE_THROW( merger.merge({ part }) );
+    remove(part.c_str());
+}
+
 int main (int argc, char *argv [])
 {
     return SharQWriterTestSuite(argc, argv);
@@ -170,6 +170,31 @@ TEST_CASE(WrapAround)
     REQUIRE_EQ( expected, strm.str() );
 }
 
+TEST_CASE(Counts)
+{
+    Fingerprint all(6);
+    all.record("ACGTN");
+    all.record("AACCGT");
+
+    // the same counts, added in bulk
+    Fingerprint fp(6);
+    fp.record('A', 0, 2);
+    fp.record('A', 1, 1);
+    fp.record('C', 1, 1);
+    fp.record('C', 2, 1);
+    fp.record('G', 2, 1);
+    fp.record('C', 3, 1);
+    fp.record('T', 3, 1);
+    fp.record('G', 4, 1);
+    fp.record('N', 4, 1);
+    fp.record(0, 5, 1);
+    fp.record('T', 5, 1);
+    fp.record(0, 6, 1);
+
+    REQUIRE_EQ( all.JSON(), fp.JSON() );
+    REQUIRE_EQ( all.digest(), fp.digest() );
+}
+
 int main (int argc, char *argv [])
 {
     return QaStatsFingerprintTestSuite(argc, argv);
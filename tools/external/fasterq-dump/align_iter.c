@@ -36,36 +36,83 @@
 
 #include <klib/out.h>
 
+#ifndef _h_insdc_insdc_
+#include <insdc/insdc.h> /* for READ_TYPE_REVERSE */
+#endif
+
+#ifndef _h_helper_
+#include "helper.h"
+#endif
+
 typedef struct alit_t {
     struct cmn_iter_t * cmn;
+    struct cmn_iter_t * seq_cmn;  /* random access into SEQUENCE.READ_TYPE, if opt.with_read_type */
+    KDataBuffer qual_buffer;  /* klib/databuffer.h */
+    KDataBuffer read_buffer;  /* the reverse-complemented read */
+    alit_opt_t opt;
     uint32_t cur_idx_raw_read;
     uint32_t cur_idx_spot_id;
     uint32_t cur_idx_seq_read_id;
-    bool uses_read_id;
+    uint32_t cur_idx_quality;
+    uint32_t cur_idx_mate_id;
+    uint32_t seq_idx_read_type;
+    char qual_2_ascii_lut[ 256 ];
 } alit_t;
 
 
-rc_t alit_create( const cmn_iter_params_t * params, alit_t ** iter, bool uses_read_id ) {
+rc_t alit_create( const cmn_iter_params_t * params, alit_t ** iter, alit_opt_t opt ) {
     rc_t rc = 0;
     alit_t * self = calloc( 1, sizeof * self );
     if ( NULL == self ) {
         rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
         ErrMsg( "make_fastq_tbl_iter.calloc( %d ) -> %R", ( sizeof * self ), rc );
     } else {
-        self -> uses_read_id = uses_read_id;
-        rc = cmn_iter_make( params, "PRIMARY_ALIGNMENT", &( self -> cmn ) );
+        self -> opt = opt;
+        if ( opt . with_quality ) {
+            rc = KDataBufferMakeBytes( &self -> qual_buffer, 4096 );
+            if ( 0 != rc ) {
+                ErrMsg( "alit_create().KDataBufferMakeBytes() -> %R", rc );
+            } else {
+                hlp_init_qual_to_ascii_lut( &( self -> qual_2_ascii_lut[ 0 ] ),
+                                            sizeof( self -> qual_2_ascii_lut ) ); /* helper.c */
+            }
+        }
+        if ( 0 == rc ) {
+            rc = cmn_iter_make( params, "PRIMARY_ALIGNMENT", &( self -> cmn ) );
+        }
         if ( 0 == rc ) {
             rc = cmn_iter_add_column( self -> cmn, "RAW_READ", &( self -> cur_idx_raw_read ) );
         }
         if ( 0 == rc ) {
             rc = cmn_iter_add_column( self -> cmn, "SEQ_SPOT_ID", &( self -> cur_idx_spot_id ) );
         }
-        if ( 0 == rc && uses_read_id ) {
+        if ( 0 == rc && opt . with_read_id ) {
             rc = cmn_iter_add_column( self -> cmn, "SEQ_READ_ID", &( self -> cur_idx_seq_read_id ) );
         }
+        if ( 0 == rc && opt . with_quality ) {
+            /* QUALITY is in read-orientation, SAM_QUALITY would be in reference-orientation */
+            rc = cmn_iter_add_column( self -> cmn, "QUALITY", &( self -> cur_idx_quality ) );
+        }
+        if ( 0 == rc && opt . with_mate_id ) {
+            rc = cmn_iter_add_column( self -> cmn, "MATE_ALIGN_ID", &( self -> cur_idx_mate_id ) );
+        }
         if ( 0 == rc ) {
             rc = cmn_iter_detect_range( self -> cmn, self -> cur_idx_raw_read );
         }
+        if ( 0 == rc && opt . with_read_type ) {
+            rc = KDataBufferMakeBytes( &self -> read_buffer, 4096 );
+            if ( 0 != rc ) {
+                ErrMsg( "alit_create().KDataBufferMakeBytes() -> %R", rc );
+            } else {
+                rc = cmn_iter_make( params, "SEQUENCE", &( self -> seq_cmn ) );
+            }
+            if ( 0 == rc ) {
+                rc = cmn_iter_add_column( self -> seq_cmn, "READ_TYPE", &( self -> seq_idx_read_type ) );
+            }
+            if ( 0 == rc ) {
+                rc = cmn_iter_detect_range( self -> seq_cmn, self -> seq_idx_read_type ); /* opens the cursor */
+            }
+        }
         if ( 0 != rc ) {
             alit_release( self );
         } else {
@@ -78,10 +125,75 @@ rc_t alit_create( const cmn_iter_params_t * params, alit_t ** iter, bool uses_re
 void alit_release( alit_t * self ) {
     if ( NULL != self ) {
         cmn_iter_release( self -> cmn );
+        cmn_iter_release( self -> seq_cmn );
+        if ( NULL != self -> qual_buffer . base ) {
+            KDataBufferWhack( &self -> qual_buffer );
+        }
+        if ( NULL != self -> read_buffer . base ) {
+            KDataBufferWhack( &self -> read_buffer );
+        }
         free( ( void * ) self );
     }
 }
 
+static rc_t alit_read_quality( alit_t * self, String * quality ) {
+    uint8_t * qual_values = NULL;
+    uint32_t num_qual = 0;
+    rc_t rc = cmn_iter_read_uint8_array( self -> cmn, self -> cur_idx_quality, &qual_values, &num_qual );
+    StringInit( quality, NULL, 0, 0 );
+    if ( 0 == rc && num_qual > 0 && NULL != qual_values ) {
+        if ( num_qual > self -> qual_buffer . elem_count ) {
+            rc = KDataBufferResize( &( self -> qual_buffer ), num_qual );
+        }
+        if ( 0 == rc ) {
+            uint32_t idx;
+            char * b = self -> qual_buffer . base;
+            for ( idx = 0; idx < num_qual; idx++ ) {
+                b[ idx ] = self -> qual_2_ascii_lut[ qual_values[ idx ] ];
+            }
+            StringInit( quality, b, num_qual, num_qual );
+        }
+    }
+    return rc;
+}
+
+/* the lookup-file of the sorted mode knows only ACGT and N, it reverse-complements the same way */
+static char alit_complement( char base ) {
+    switch( base ) {
+        case 'A' : return 'T';
+        case 'C' : return 'G';
+        case 'G' : return 'C';
+        case 'T' : return 'A';
+    }
+    return 'N';
+}
+
+/* RAW_READ is in reference-orientation: a read of type REVERSE is reverse-complemented,
+   as the sorted mode does it ( dbj_is_reverse() in db_join.c ) */
+static rc_t alit_orient_read( alit_t * self, alit_rec_t * rec ) {
+    uint8_t * read_types = NULL;
+    uint32_t num_read_types = 0;
+    rc_t rc;
+    cmn_iter_set_row_id( self -> seq_cmn, ( int64_t )rec -> spot_id );
+    rc = cmn_iter_read_uint8_array( self -> seq_cmn, self -> seq_idx_read_type, &read_types, &num_read_types );
+    if ( 0 == rc && rec -> read_id > 0 && rec -> read_id <= num_read_types &&
+         READ_TYPE_REVERSE == ( read_types[ rec -> read_id - 1 ] & READ_TYPE_REVERSE ) ) {
+        uint32_t len = rec -> read . len;
+        if ( len > self -> read_buffer . elem_count ) {
+            rc = KDataBufferResize( &( self -> read_buffer ), len );
+        }
+        if ( 0 == rc ) {
+            uint32_t idx;
+            char * b = self -> read_buffer . base;
+            for ( idx = 0; idx < len; idx++ ) {
+                b[ len - 1 - idx ] = alit_complement( rec -> read . addr[ idx ] );
+            }
+            StringInit( &( rec -> read ), b, len, len );
+        }
+    }
+    return rc;
+}
+
 bool alit_get_rec( alit_t * self, alit_rec_t * rec, rc_t * rc ) {
     rc_t rc2;
     bool res = cmn_iter_get_next( self -> cmn, &rc2 );
@@ -97,11 +209,30 @@ bool alit_get_rec( alit_t * self, alit_rec_t * rec, rc_t * rc ) {
             rec -> spot_id = 0;
         }
         
-        if ( 0 == rc1 && self -> uses_read_id ) {
+        if ( 0 == rc1 && self -> opt . with_read_id ) {
             rc1 = cmn_iter_read_uint32( self -> cmn, self -> cur_idx_seq_read_id, &( rec -> read_id ) );
         } else {
             rec -> read_id = 0;
         }
+
+        if ( 0 == rc1 && self -> opt . with_read_type ) {
+            rc1 = alit_orient_read( self, rec ); /* above */
+        }
+
+        if ( 0 == rc1 && self -> opt . with_quality ) {
+            rc1 = alit_read_quality( self, &( rec -> quality ) ); /* above */
+        } else {
+            StringInit( &( rec -> quality ), NULL, 0, 0 );
+        }
+
+        rec -> mate_id = 0;
+        if ( 0 == rc1 && self -> opt . with_mate_id ) {
+            /* MATE_ALIGN_ID has 0 or 1 elements */
+            uint32_t values_read = 0;
+            rc1 = cmn_iter_read_uint64_array( self -> cmn, self -> cur_idx_mate_id,
+                                              &( rec -> mate_id ), 1, &values_read );
+            if ( 0 == values_read ) { rec -> mate_id = 0; }
+        }
         
         if ( NULL != rc ) { *rc = rc1; }
     }
@@ -118,6 +249,7 @@ rc_t alit_extract_row_count( KDirectory * dir,
                              const char * accession_path,
                              size_t cur_cache,
                              uint64_t * res ) {
+    alit_opt_t opt = { false, false, false, false };
     rc_t rc;
     cmn_iter_params_t cp;
     struct alit_t * iter;
@@ -130,7 +262,7 @@ rc_t alit_extract_row_count( KDirectory * dir,
                               0,
                               0,
                               0 );
-    rc = alit_create( &cp, &iter, false );
+    rc = alit_create( &cp, &iter, opt );
     if ( 0 == rc ) {
         *res = alit_get_row_count( iter );
         alit_release( iter );
@@ -48,15 +48,25 @@ typedef struct alit_rec_t
 {
     int64_t row_id;
     uint64_t spot_id;
+    uint64_t mate_id;   /* row-id of the mate in PRIMARY_ALIGNMENT, 0 if it has none */
     uint32_t read_id;
-    String read;
+    String read;        /* in read-orientation if with_read_type, else as in RAW_READ */
+    String quality;     /* in read-orientation, ascii */
 } alit_rec_t;
 
+typedef struct alit_opt_t
+{
+    bool with_read_id;
+    bool with_quality;
+    bool with_mate_id;
+    bool with_read_type;    /* reverse-complement the reads of type REVERSE ( SEQUENCE.READ_TYPE ), needs with_read_id */
+} alit_opt_t;
+
 struct alit_t;
 
 rc_t alit_create( const cmn_iter_params_t * params,
                   struct alit_t ** iter,
-                  bool uses_read_id );
+                  alit_opt_t opt );
 
 void alit_release( struct alit_t * self );
 
@@ -30,6 +30,9 @@
 #include <klib/text.h>
 #endif
 
+#include <errno.h>
+#include <math.h>       /* isfinite */
+
 rc_t ArgsOptionCount( const struct Args * self, const char * option_name, uint32_t * count );
 rc_t ArgsOptionValue( const struct Args * self, const char * option_name, uint32_t iteration, const void ** value );
 
@@ -99,6 +102,23 @@ uint32_t ahlp_get_uint32_t_option( const struct Args * args, const char *name, u
     return ahlp_str_2_u32( ahlp_get_str_option( args, name, NULL ), dflt );
 }
 
+rc_t ahlp_get_double_option( const struct Args * args, const char *name, double dflt, double * value ) {
+    rc_t rc = 0;
+    const char * s = ahlp_get_str_option( args, name, NULL );
+    *value = dflt;
+    if ( NULL != s ) {
+        char * endptr = NULL;
+        errno = 0;
+        *value = strtod( s, &endptr );
+        /* the whole string has to be a finite number */
+        if ( endptr == s || 0 != *endptr || 0 != errno || !isfinite( *value ) ) {
+            rc = RC( rcExe, rcArgv, rcParsing, rcParam, rcInvalid );
+            *value = dflt;
+        }
+    }
+    return rc;
+}
+
 size_t ahlp_get_size_t_option( const struct Args * args, const char *name, size_t dflt ) {
     size_t res = dflt;
     const char * s = ahlp_get_str_option( args, name, NULL );
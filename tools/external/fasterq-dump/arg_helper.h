@@ -51,6 +51,8 @@ bool ahlp_get_bool_option( const struct Args *args, const char *name );
 size_t ahlp_get_size_t_option( const struct Args * args, const char *name, size_t dflt );
 uint64_t ahlp_get_uint64_t_option( const struct Args * args, const char *name, uint64_t dflt );
 uint32_t ahlp_get_uint32_t_option( const struct Args * args, const char *name, uint32_t dflt );
+/* rc != 0 if the option is given but not a number, value = dflt if not given */
+rc_t ahlp_get_double_option( const struct Args * args, const char *name, double dflt, double * value );
 
 uint32_t ahlp_get_env_u32( const char * name, uint32_t dflt );
 
@@ -39,6 +39,10 @@
 #include "idx_to_name.h"
 #endif
 
+#ifndef _h_row_selection_
+#include "row_selection.h"
+#endif
+
 #ifndef _h_klib_num_gen_
 #include <klib/num-gen.h>
 #endif
@@ -81,6 +85,7 @@ bool cmn_iter_populate_params( cmn_iter_params_t * params,
         params -> first_row = first_row;
         params -> row_count = row_count;
         params -> thread_id = thread_id;
+        params -> selection = NULL;
         res = true;
     }
     return res;
@@ -90,6 +95,7 @@ typedef struct cmn_iter_t {
     const VCursor * cursor;
     struct num_gen * ranges;
     const struct num_gen_iter * row_iter;
+    const struct row_selection_t * selection;
     uint64_t row_count;
     int64_t first_row, row_id;
     const char * tbl_name;
@@ -277,6 +283,7 @@ rc_t cmn_iter_make( const cmn_iter_params_t * cp, const char * tblname, cmn_iter
                     i -> cursor = cur;
                     i -> first_row = cp -> first_row;
                     i -> row_count = cp -> row_count;
+                    i -> selection = cp -> selection;
                     idx_to_name_init( &( i -> idx_to_name ) ); /* introduced 01/2026 because of VDB-6259 */
                     if ( NULL == tblname ) {
                         i -> tbl_name = NULL;
@@ -319,6 +326,28 @@ static rc_t cmn_iter_make_row_iter( struct num_gen * ranges, int64_t first, uint
     return rc;
 }
 
+/* replaces the ranges with the selected rows inside the window, an empty selection leaves row_iter NULL */
+static rc_t cmn_iter_make_selected_row_iter( cmn_iter_t * self, int64_t first, uint64_t count ) {
+    rc_t rc = 0;
+    if ( NULL != self -> ranges ) {
+        num_gen_destroy( self -> ranges );
+        self -> ranges = NULL;
+    }
+    rc = num_gen_make_sorted( &self -> ranges, true );
+    if ( 0 != rc ) {
+        ErrMsg( "%s %s num_gen_make_sorted( thread:%u ) -> %R\n", __FN__, __func__, self -> thread_id, rc );
+    } else {
+        rc = rsel_add_to_num_gen( self -> selection, self -> ranges, first, count ); /* row_selection.c */
+        if ( 0 == rc && !num_gen_empty( self -> ranges ) ) {
+            rc = num_gen_iterator_make( self -> ranges, &self -> row_iter );
+            if ( 0 != rc ) {
+                ErrMsg( "%s %s num_gen_iterator_make( thread:%u ) -> %R", __FN__, __func__, self -> thread_id, rc );
+            }
+        }
+    }
+    return rc;
+}
+
 rc_t cmn_iter_set_range( struct cmn_iter_t * self, int64_t start_row, uint64_t row_count ) {
     rc_t rc;
     if ( NULL == self ) {
@@ -327,25 +356,31 @@ rc_t cmn_iter_set_range( struct cmn_iter_t * self, int64_t start_row, uint64_t r
     } else {
         if ( NULL != self -> row_iter ) {
             num_gen_iterator_destroy( self -> row_iter );
+            self -> row_iter = NULL;
         }
         if ( NULL != self -> ranges ) {
             num_gen_destroy( self -> ranges );
+            self -> ranges = NULL;
         }
 
-        rc = num_gen_make_sorted( &self -> ranges, true );
-        if ( 0 != rc ) {
-            ErrMsg( "%s %s num_gen_make_sorted( thread:%u ) -> %R\n", __FN__, __func__, self -> thread_id, rc );
-        }
-        else if ( row_count > 0 ) {
-            rc = num_gen_add( self -> ranges, start_row, row_count );
+        if ( NULL != self -> selection ) {
+            rc = cmn_iter_make_selected_row_iter( self, start_row, row_count );
+        } else {
+            rc = num_gen_make_sorted( &self -> ranges, true );
             if ( 0 != rc ) {
-                ErrMsg( "%s %s num_gen_add( thread:%u %ld.%lu ) -> %R\n",
-                    __FN__, __func__, self -> thread_id, self -> first_row, self -> row_count, rc );
-            } else {
-                rc = cmn_iter_make_row_iter( self -> ranges, start_row, row_count, &self -> row_iter );
+                ErrMsg( "%s %s num_gen_make_sorted( thread:%u ) -> %R\n", __FN__, __func__, self -> thread_id, rc );
+            }
+            else if ( row_count > 0 ) {
+                rc = num_gen_add( self -> ranges, start_row, row_count );
                 if ( 0 != rc ) {
-                    ErrMsg( "%s %s cmn_iter_make_row_iter( thread:%u %ld.%lu ) -> %R\n",
-                            __FN__, __func__, self -> thread_id, start_row, row_count, rc );
+                    ErrMsg( "%s %s num_gen_add( thread:%u %ld.%lu ) -> %R\n",
+                        __FN__, __func__, self -> thread_id, self -> first_row, self -> row_count, rc );
+                } else {
+                    rc = cmn_iter_make_row_iter( self -> ranges, start_row, row_count, &self -> row_iter );
+                    if ( 0 != rc ) {
+                        ErrMsg( "%s %s cmn_iter_make_row_iter( thread:%u %ld.%lu ) -> %R\n",
+                                __FN__, __func__, self -> thread_id, start_row, row_count, rc );
+                    }
                 }
             }
         }
@@ -370,21 +405,31 @@ rc_t cmn_iter_add_column( struct cmn_iter_t * self, const char * name, uint32_t
 }
 
 bool cmn_iter_get_next( struct cmn_iter_t * self, rc_t * rc ) {
-    if ( NULL == self ) { return false; }
-    return num_gen_iterator_next( self -> row_iter, &self -> row_id, rc );
+    bool res;
+    if ( NULL == self || NULL == self -> row_iter ) { return false; }
+    res = num_gen_iterator_next( self -> row_iter, &self -> row_id, rc );
+    /* skip the rows not in the random sample ( if any ) */
+    while ( res && !rsel_sampled( self -> selection, self -> row_id ) ) {
+        res = num_gen_iterator_next( self -> row_iter, &self -> row_id, rc );
+    }
+    return res;
 }
 
 int64_t cmn_iter_get_row_id( const struct cmn_iter_t * self ) {
     return ( NULL == self ) ? 0 : self -> row_id;
 }
 
+void cmn_iter_set_row_id( struct cmn_iter_t * self, int64_t row_id ) {
+    if ( NULL != self ) { self -> row_id = row_id; }
+}
+
 uint64_t cmn_iter_get_row_count( struct cmn_iter_t * self ) {
     uint64_t res = 0;
     rc_t rc;
     if ( NULL == self ) {
         rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
         ErrMsg( "%s %s() -> %R", __FN__, __func__, rc );
-    } else {
+    } else if ( NULL != self -> row_iter ) {
         rc = num_gen_iterator_count( self -> row_iter, &res );
         if ( 0 != rc ) {
             ErrMsg( "%s %s num_gen_iterator_count( thread:%u ) -> %R\n", __FN__, __func__, self -> thread_id, rc );
@@ -416,6 +461,8 @@ rc_t cmn_iter_detect_range( struct cmn_iter_t * self, uint32_t col_id ) {
             }
         }
         if ( 0 == rc ) {
+            int64_t req_first = self -> first_row;
+            uint64_t req_count = self -> row_count;
             rc = VCursorIdRange( self -> cursor, col_id, &self -> first_row, &self -> row_count );
             if ( rc != 0 ) {
                 const char * name = idx_to_name_get( &( self -> idx_to_name ), col_id );
@@ -424,6 +471,18 @@ rc_t cmn_iter_detect_range( struct cmn_iter_t * self, uint32_t col_id ) {
                 } else {
                     ErrMsg( "%s %s VCursorIdRange( thread:%u col:%s ) -> %R", __FN__, __func__, self -> thread_id, name, rc );
                 }
+            } else if ( NULL != self -> selection ) {
+                /* the requested window ( if any ) clipped to the rows of the table */
+                int64_t first = self -> first_row;
+                int64_t last = self -> first_row + ( int64_t )self -> row_count - 1;
+                if ( req_count > 0 ) {
+                    int64_t req_last = req_first + ( int64_t )req_count - 1;
+                    if ( req_first > first ) { first = req_first; }
+                    if ( req_last < last ) { last = req_last; }
+                }
+                if ( last >= first ) {
+                    rc = cmn_iter_make_selected_row_iter( self, first, ( uint64_t )( last - first ) + 1 );
+                }
             } else {
                 rc = cmn_iter_make_row_iter( self -> ranges, self -> first_row, self -> row_count, &self -> row_iter );
                 if ( 0 != rc ) {
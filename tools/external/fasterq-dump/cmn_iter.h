@@ -43,6 +43,8 @@ extern "C" {
 #include "helper.h"
 #endif
 
+struct row_selection_t;
+
 typedef struct cmn_iter_params_t
 {
     const KDirectory * dir;
@@ -53,6 +55,7 @@ typedef struct cmn_iter_params_t
     int64_t first_row;
     uint64_t row_count;
     uint32_t thread_id;
+    const struct row_selection_t * selection;  /* the rows ( spots ) to visit, NULL for all, row_selection.h */
 } cmn_iter_params_t;
 
 bool cmn_iter_populate_params( cmn_iter_params_t * params,
@@ -76,6 +79,8 @@ rc_t cmn_iter_detect_range( struct cmn_iter_t * self, uint32_t col_id );
 
 bool cmn_iter_get_next( struct cmn_iter_t * self, rc_t * rc );
 int64_t cmn_iter_get_row_id( const struct cmn_iter_t * self );
+/* random access: the next reads come from this row ( the cursor is opened by cmn_iter_detect_range ) */
+void cmn_iter_set_row_id( struct cmn_iter_t * self, int64_t row_id );
 uint64_t cmn_iter_get_row_count( struct cmn_iter_t * self );
 
 rc_t cmn_iter_read_uint64( struct cmn_iter_t * self, uint32_t col_id, uint64_t *value );
@@ -0,0 +1,204 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "compressor.h"
+
+#include <stdlib.h>
+
+#include <zlib.h>   /* from ncbi-vdb/interfaces/ext */
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+typedef struct compressor_t {
+    compress_t type;
+    int level;
+    z_stream zs;        /* gzip: deflate-state, reset for each block */
+    bool zs_valid;
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx * zctx;   /* zstd: compression-context, reused for each block */
+#endif
+    char * out;         /* the compressed block */
+    size_t out_size;
+} compressor_t;
+
+#define DFLT_GZIP_LEVEL 6
+#define DFLT_ZSTD_LEVEL 3
+
+bool compressor_available( compress_t type ) {
+    switch( type ) {
+        case ct_none : return true;
+        case ct_gzip : return true;
+#ifdef HAVE_ZSTD
+        case ct_zstd : return true;
+#endif
+        default : return false;
+    }
+}
+
+void release_compressor( compressor_t * self ) {
+    if ( NULL != self ) {
+        if ( self -> zs_valid ) { deflateEnd( &( self -> zs ) ); }
+#ifdef HAVE_ZSTD
+        if ( NULL != self -> zctx ) { ZSTD_freeCCtx( self -> zctx ); }
+#endif
+        free( ( void * ) self -> out );
+        free( ( void * ) self );
+    }
+}
+
+static rc_t compressor_init( compressor_t * self, uint32_t level ) {
+    rc_t rc = 0;
+    switch( self -> type ) {
+        case ct_gzip : {
+                self -> level = ( level > 0 && level <= 9 ) ? ( int )level : DFLT_GZIP_LEVEL;
+                /* windowBits = 15 + 16 : write a gzip-header and -trailer around each block */
+                if ( Z_OK != deflateInit2( &( self -> zs ), self -> level, Z_DEFLATED,
+                                           15 + 16, 8, Z_DEFAULT_STRATEGY ) ) {
+                    rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                } else {
+                    self -> zs_valid = true;
+                }
+            } break;
+
+#ifdef HAVE_ZSTD
+        case ct_zstd : {
+                self -> level = ( level > 0 && level <= ( uint32_t )ZSTD_maxCLevel() ) ? ( int )level : DFLT_ZSTD_LEVEL;
+                self -> zctx = ZSTD_createCCtx();
+                if ( NULL == self -> zctx ) {
+                    rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                }
+            } break;
+#endif
+
+        default : rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcUnsupported ); break;
+    }
+    return rc;
+}
+
+rc_t make_compressor( compressor_t ** c, compress_t type, uint32_t level ) {
+    rc_t rc = 0;
+    if ( NULL == c ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcNull );
+    } else {
+        compressor_t * self = calloc( 1, sizeof * self );
+        *c = NULL;
+        if ( NULL == self ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        } else {
+            self -> type = type;
+            rc = compressor_init( self, level ); /* above */
+            if ( 0 != rc ) {
+                release_compressor( self );
+            } else {
+                *c = self;
+            }
+        }
+    }
+    return rc;
+}
+
+static rc_t compressor_reserve( compressor_t * self, size_t needed ) {
+    rc_t rc = 0;
+    if ( needed > self -> out_size ) {
+        char * tmp = realloc( self -> out, needed );
+        if ( NULL == tmp ) {
+            rc = RC( rcVDB, rcNoTarg, rcWriting, rcMemory, rcExhausted );
+        } else {
+            self -> out = tmp;
+            self -> out_size = needed;
+        }
+    }
+    return rc;
+}
+
+static rc_t compressor_run_gzip( compressor_t * self, const char * src, size_t src_len, size_t * dst_len ) {
+    rc_t rc = 0;
+    z_stream * zs = &( self -> zs );
+    if ( Z_OK != deflateReset( zs ) ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcData, rcUnexpected );
+    } else {
+        /* src_len can be larger than uInt on 64-bit systems, feed it in pieces */
+        rc = compressor_reserve( self, deflateBound( zs, ( uLong )src_len ) ); /* above */
+        if ( 0 == rc ) {
+            int zres = Z_OK;
+            zs -> next_in = ( Bytef * )src;
+            zs -> next_out = ( Bytef * )self -> out;
+            zs -> avail_out = ( uInt )self -> out_size;
+            while ( 0 == rc && Z_STREAM_END != zres ) {
+                size_t left = src_len - ( ( const char * )zs -> next_in - src );
+                zs -> avail_in = ( left > 0x40000000 ) ? 0x40000000 : ( uInt )left;
+                zres = deflate( zs, ( left > zs -> avail_in ) ? Z_NO_FLUSH : Z_FINISH );
+                if ( Z_OK != zres && Z_STREAM_END != zres ) {
+                    rc = RC( rcVDB, rcNoTarg, rcWriting, rcData, rcUnexpected );
+                } else if ( Z_OK == zres && 0 == zs -> avail_out ) {
+                    /* deflateBound() is a guarantee, this should never happen */
+                    rc = RC( rcVDB, rcNoTarg, rcWriting, rcBuffer, rcInsufficient );
+                }
+            }
+            if ( 0 == rc ) {
+                *dst_len = ( const char * )zs -> next_out - self -> out;
+            }
+        }
+    }
+    return rc;
+}
+
+#ifdef HAVE_ZSTD
+static rc_t compressor_run_zstd( compressor_t * self, const char * src, size_t src_len, size_t * dst_len ) {
+    rc_t rc = compressor_reserve( self, ZSTD_compressBound( src_len ) ); /* above */
+    if ( 0 == rc ) {
+        size_t res = ZSTD_compressCCtx( self -> zctx, self -> out, self -> out_size,
+                                        src, src_len, self -> level );
+        if ( ZSTD_isError( res ) ) {
+            rc = RC( rcVDB, rcNoTarg, rcWriting, rcData, rcUnexpected );
+        } else {
+            *dst_len = res;
+        }
+    }
+    return rc;
+}
+#endif
+
+rc_t compressor_run( compressor_t * self, const char * src, size_t src_len,
+                     const char ** dst, size_t * dst_len ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == dst || NULL == dst_len || ( NULL == src && src_len > 0 ) ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcParam, rcNull );
+    } else {
+        *dst_len = 0;
+        switch( self -> type ) {
+            case ct_gzip : rc = compressor_run_gzip( self, src, src_len, dst_len ); break; /* above */
+#ifdef HAVE_ZSTD
+            case ct_zstd : rc = compressor_run_zstd( self, src, src_len, dst_len ); break; /* above */
+#endif
+            default : rc = RC( rcVDB, rcNoTarg, rcWriting, rcParam, rcUnsupported ); break;
+        }
+        *dst = self -> out;
+    }
+    return rc;
+}
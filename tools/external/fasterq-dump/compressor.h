@@ -0,0 +1,71 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#ifndef _h_compressor_
+#define _h_compressor_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_helper_
+#include "helper.h"
+#endif
+
+/* -----------------------------------------------------------------------------------
+    Compresses independent blocks of output: each block becomes a complete gzip-member
+    or zstd-frame. Concatenated members/frames are a valid gzip/zstd-stream, so blocks
+    compressed in different threads, and files made of them, can be concatenated without
+    recompression. A compressor is not thread-safe, each thread needs its own instance.
+
+    usage:
+        make_compressor( &c, ct_gzip, 0 );
+        compressor_run( c, data, len, &out, &out_len );
+        ... write out/out_len, valid until the next call ...
+        release_compressor( c );
+   ----------------------------------------------------------------------------------- */
+
+struct compressor_t;
+
+/* level = 0 ... the default level for the type */
+rc_t make_compressor( struct compressor_t ** c, compress_t type, uint32_t level );
+
+void release_compressor( struct compressor_t * self );
+
+rc_t compressor_run( struct compressor_t * self, const char * src, size_t src_len,
+                     const char ** dst, size_t * dst_len );
+
+/* is this type compiled in? ( zstd is optional ) */
+bool compressor_available( compress_t type );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
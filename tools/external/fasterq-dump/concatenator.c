@@ -26,6 +26,8 @@
 
 #include "concatenator.h"
 
+#include <string.h>     /* memset() */
+
 #ifndef _h_err_msg_
 #include "err_msg.h"
 #endif
@@ -42,35 +44,192 @@
 #include <kfs/buffile.h>
 #endif
 
+#ifndef _h_zero_copy_
+#include "zero_copy.h"
+#endif
+
+#ifndef _h_perf_report_
+#include "perf_report.h"
+#endif
+
+#ifndef _h_klib_out_
+#include <klib/out.h>
+#endif
+
+/* ---------------------------------------------------------------------------------- */
+
+void concat_add_stats( concat_stats_t * stats, const concat_stats_t * to_add ) {
+    if ( NULL != stats && NULL != to_add ) {
+        stats -> bytes_renamed      += to_add -> bytes_renamed;
+        stats -> bytes_reflinked    += to_add -> bytes_reflinked;
+        stats -> bytes_copy_range   += to_add -> bytes_copy_range;
+        stats -> bytes_copied       += to_add -> bytes_copied;
+        stats -> elapsed_us         += to_add -> elapsed_us;
+    }
+}
+
+rc_t concat_print_stats( const concat_stats_t * stats ) {
+    rc_t rc = 0;
+    if ( NULL != stats ) {
+        uint64_t moved = stats -> bytes_reflinked + stats -> bytes_copy_range + stats -> bytes_copied;
+        KOutHandlerSetStdErr();
+        rc = KOutMsg( "concat-path     :%s%s%s%s\n",
+                      stats -> bytes_renamed > 0 ? " rename" : "",
+                      stats -> bytes_reflinked > 0 ? " reflink" : "",
+                      stats -> bytes_copy_range > 0 ? " copy_file_range" : "",
+                      stats -> bytes_copied > 0 ? " copy-machine" : "" );
+        if ( 0 == rc && stats -> bytes_renamed > 0 ) {
+            rc = KOutMsg( "concat renamed  : %,lu bytes\n", stats -> bytes_renamed );
+        }
+        if ( 0 == rc && stats -> bytes_reflinked > 0 ) {
+            rc = KOutMsg( "concat reflinked: %,lu bytes\n", stats -> bytes_reflinked );
+        }
+        if ( 0 == rc && stats -> bytes_copy_range > 0 ) {
+            rc = KOutMsg( "concat in kernel: %,lu bytes\n", stats -> bytes_copy_range );
+        }
+        if ( 0 == rc && stats -> bytes_copied > 0 ) {
+            rc = KOutMsg( "concat copied   : %,lu bytes\n", stats -> bytes_copied );
+        }
+        if ( 0 == rc && moved > 0 && stats -> elapsed_us > 0 ) {
+            /* bytes per micro-second == MB per second */
+            rc = KOutMsg( "concat speed    : %,lu MB/s\n", moved / stats -> elapsed_us );
+        }
+        KOutHandlerSetStdOut();
+    }
+    return rc;
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+/* append as many parts as the kernel can handle without a copy through user-space,
+   advances src_list_offset and dst_pos - the rest is left for the copy-machine */
+static rc_t concat_zero_copy( KDirectory * dir,
+                    const char * output_filename,
+                    const struct VNamelist * files,
+                    uint32_t count,
+                    uint32_t * src_list_offset,
+                    uint64_t * dst_pos,
+                    struct bg_progress_t * progress,
+                    concat_stats_t * stats ) {
+    struct zero_copy_t * zc;
+    rc_t rc = make_zero_copy( &zc, dir, output_filename ); /* zero_copy.c */
+    if ( 0 != rc ) {
+        rc = 0; /* no zero-copy on this platform: everything goes through the copy-machine */
+    } else {
+        bool done = false;
+        while ( 0 == rc && !done && *src_list_offset < count ) {
+            const char * filename;
+            rc = VNameListGet( files, *src_list_offset, &filename );
+            if ( 0 != rc ) {
+                ErrMsg( "concat_zero_copy() VNameListGet( %u ) -> %R", *src_list_offset, rc );
+            } else {
+                zc_method_t method;
+                uint64_t written;
+                rc = zero_copy_append( zc, filename, *dst_pos, &method, &written ); /* zero_copy.c */
+                if ( zero_copy_unsupported( rc ) ) {
+                    /* different filesystems, or not supported by the filesystem */
+                    rc = 0;
+                    done = true;
+                } else if ( 0 == rc ) {
+                    *dst_pos += written;
+                    *src_list_offset += 1;
+                    if ( zcm_reflink == method ) {
+                        stats -> bytes_reflinked += written;
+                    } else {
+                        stats -> bytes_copy_range += written;
+                    }
+                    bg_progress_update( progress, written ); /* progress_thread.c */
+                    perf_add( pc_output_bytes_written, written ); /* perf_report.c */
+                    rc = KDirectoryRemove( dir, true, "%s", filename );
+                    if ( 0 != rc ) {
+                        ErrMsg( "concat_zero_copy().KDirectoryRemove( '%s' ) -> %R", filename, rc );
+                    }
+                }
+            }
+        }
+        release_zero_copy( zc ); /* zero_copy.c */
+    }
+    return rc;
+}
+
+/* the parts that could not be zero-copied: read them through user-space buffers */
+static rc_t concat_copy_machine( KDirectory * dir,
+                    const char * output_filename,
+                    struct KFile * dst,
+                    const struct VNamelist * files,
+                    uint32_t count,
+                    uint32_t src_list_offset,
+                    uint64_t dst_pos,
+                    size_t buf_size,
+                    bool buffered,
+                    struct bg_progress_t * progress,
+                    uint32_t q_wait_time,
+                    concat_stats_t * stats ) {
+    rc_t rc = 0;
+    if ( src_list_offset < count ) {
+        uint64_t size_after;
+        if ( buffered && buf_size > 0 ) {
+            struct KFile * tmp;
+            rc = KBufFileMakeWrite( &tmp, dst, false, buf_size );
+            if ( 0 != rc ) {
+                ErrMsg( "concat_copy_machine() KBufFileMakeWrite( '%s' ) -> %R",
+                        output_filename, rc );
+            } else {
+                rc = cm_make_a_copy( dir, tmp, files, progress, dst_pos, buf_size,
+                                     src_list_offset, q_wait_time ); /* copy_machine.c */
+                {
+                    rc_t rc2 = ft_release_file( tmp, "concat_copy_machine( '%s' )", output_filename );
+                    rc = ( 0 == rc ) ? rc2 : rc;
+                }
+            }
+        } else {
+            rc = cm_make_a_copy( dir, dst, files, progress, dst_pos, buf_size,
+                                 src_list_offset, q_wait_time ); /* copy_machine.c */
+        }
+        if ( 0 == rc && 0 == KDirectoryFileSize( dir, &size_after, "%s", output_filename ) &&
+             size_after > dst_pos ) {
+            stats -> bytes_copied += ( size_after - dst_pos );
+        }
+    }
+    return rc;
+}
+
 static rc_t concat_execute_un_compressed_append( KDirectory * dir,
                     const char * output_filename,
                     const struct VNamelist * files,
                     size_t buf_size,
                     struct bg_progress_t * progress,
                     uint32_t count,
-                    uint32_t q_wait_time ) {
+                    uint32_t q_wait_time,
+                    concat_stats_t * stats ) {
     uint64_t size_of_existing_file;
     rc_t rc = KDirectoryFileSize ( dir, &size_of_existing_file, "%s", output_filename );
     if ( 0 != rc ) {
         ErrMsg( "execute_concat_un_compressed_append() KDirectoryFileSize( '%s' ) -> %R",
                 output_filename, rc );
     } else {
-        struct KFile * dst;
-        rc = KDirectoryOpenFileWrite ( dir, &dst, true, "%s", output_filename );
-        if ( 0 != rc ) {
-            ErrMsg( "execute_concat_un_compressed_append() KDirectoryOpenFileWrite( '%s' ) -> %R",
-                    output_filename, rc );
-        } else {
-            rc = cm_make_a_copy( dir, dst, files, progress, size_of_existing_file, buf_size, 0, q_wait_time ); /* copy_machine.c */
-            {
-                rc_t rc2 = ft_release_file( dst, "execute_concat_un_compressed_append()" );
-                rc = ( 0 == rc ) ? rc2 : rc;
+        uint32_t files_offset = 0;
+        uint64_t dst_pos = size_of_existing_file;
+        rc = concat_zero_copy( dir, output_filename, files, count,
+                               &files_offset, &dst_pos, progress, stats ); /* above */
+        if ( 0 == rc && files_offset < count ) {
+            struct KFile * dst;
+            rc = KDirectoryOpenFileWrite ( dir, &dst, true, "%s", output_filename );
+            if ( 0 != rc ) {
+                ErrMsg( "execute_concat_un_compressed_append() KDirectoryOpenFileWrite( '%s' ) -> %R",
+                        output_filename, rc );
+            } else {
+                rc = concat_copy_machine( dir, output_filename, dst, files, count, files_offset,
+                                          dst_pos, buf_size, false, progress, q_wait_time, stats ); /* above */
+                {
+                    rc_t rc2 = ft_release_file( dst, "execute_concat_un_compressed_append()" );
+                    rc = ( 0 == rc ) ? rc2 : rc;
+                }
             }
         }
     }
     return rc;
 }
-
 static rc_t concat_execute_un_compressed_no_append( KDirectory * dir,
                     const char * output_filename,
                     const struct VNamelist * files,
@@ -78,7 +237,8 @@ static rc_t concat_execute_un_compressed_no_append( KDirectory * dir,
                     struct bg_progress_t * progress,
                     bool force,
                     uint32_t count,
-                    uint32_t q_wait_time ) {
+                    uint32_t q_wait_time,
+                    concat_stats_t * stats ) {
     const char * file1;
     rc_t rc = VNameListGet( files, 0, &file1 );
     if ( 0 != rc ) {
@@ -109,6 +269,8 @@ static rc_t concat_execute_un_compressed_no_append( KDirectory * dir,
                     size_file1 = 0;
                     rc = KDirectoryCreateFile( dir, &dst, false, 0664, kcmInit, "%s", output_filename );
                 } else {
+                    stats -> bytes_renamed += size_file1;
+                    perf_add( pc_output_bytes_written, size_file1 ); /* perf_report.c */
                     rc = KDirectoryOpenFileWrite ( dir, &dst, true, "%s", output_filename );
                 }
 
@@ -117,24 +279,19 @@ static rc_t concat_execute_un_compressed_no_append( KDirectory * dir,
                 }
                 
                 if ( 0 == rc ) {
-                    if ( buf_size > 0 ) {
-                        struct KFile * tmp;
-                        rc = KBufFileMakeWrite( &tmp, dst, false, buf_size );
-                        if ( 0 != rc ) {
-                            ErrMsg( "execute_concat_un_compressed() KBufFileMakeWrite( '%s' ) -> %R",
-                                    output_filename, rc );
-                        } else {
-                            rc_t rc2 = ft_release_file( dst,
-                                "execute_concat_un_compressed( '%s' ).1", output_filename );
-                            rc = ( 0 == rc ) ? rc2 : rc;
-                            dst = tmp;
-                        }
-                    }
+                    uint64_t dst_pos = size_file1;
 
                     bg_progress_update( progress, size_file1 ); /* progress_thread.c */
 
-                    rc = cm_make_a_copy( dir, dst, files, progress, size_file1, buf_size,
-                                      files_offset, q_wait_time ); /* copy_machine.c */
+                    /* the kernel appends what it can without a copy through user-space... */
+                    rc = concat_zero_copy( dir, output_filename, files, count,
+                                           &files_offset, &dst_pos, progress, stats ); /* above */
+
+                    /* ... the copy-machine takes care of the rest */
+                    if ( 0 == rc ) {
+                        rc = concat_copy_machine( dir, output_filename, dst, files, count, files_offset,
+                                                  dst_pos, buf_size, true, progress, q_wait_time, stats ); /* above */
+                    }
 
                     {
                         rc_t rc2 = ft_release_file( dst,
@@ -157,7 +314,8 @@ rc_t concat_execute( KDirectory * dir,
                     size_t buf_size,
                     struct bg_progress_t * progress,
                     bool force,
-                    bool append ) {
+                    bool append,
+                    concat_stats_t * stats ) {
     uint32_t count;
     rc_t rc = VNameListCount( files, &count );
     if ( 0 != rc ) {
@@ -166,13 +324,16 @@ rc_t concat_execute( KDirectory * dir,
         uint32_t q_wait_time = 500;
         bool file_exists = ft_file_exists( dir, "%s", output_filename );
         bool perform_append = ( append && file_exists );
+        concat_stats_t local_stats;
+        memset( &local_stats, 0, sizeof local_stats );
         if ( perform_append ) {
             rc = concat_execute_un_compressed_append( dir, output_filename, files,
-                                buf_size, progress, count, q_wait_time );
+                                buf_size, progress, count, q_wait_time, &local_stats );
         } else {
             rc = concat_execute_un_compressed_no_append( dir, output_filename, files,
-                                buf_size, progress, force, count, q_wait_time );
+                                buf_size, progress, force, count, q_wait_time, &local_stats );
         }
+        concat_add_stats( stats, &local_stats ); /* above, ignores NULL */
     }
     return rc;
 }
@@ -51,13 +51,28 @@ extern "C" {
 #include "progress_thread.h"
 #endif
 
+/* how the parts have been concatenated, the counters are added up over all output-files */
+typedef struct concat_stats_t {
+    uint64_t bytes_renamed;     /* the 1st part has been moved into place */
+    uint64_t bytes_reflinked;   /* zero-copy, blocks shared ( FICLONERANGE ) zero_copy.h */
+    uint64_t bytes_copy_range;  /* zero-copy, copy_file_range() */
+    uint64_t bytes_copied;      /* through user-space buffers, copy_machine.h */
+    uint64_t elapsed_us;        /* wall-clock time for all output-files, set by the caller */
+} concat_stats_t;
+
+void concat_add_stats( concat_stats_t * stats, const concat_stats_t * to_add );
+
+rc_t concat_print_stats( const concat_stats_t * stats );
+
+/* stats can be NULL */
 rc_t concat_execute( KDirectory * dir,
                     const char * output_filename,
                     const struct VNamelist * files,
                     size_t buf_size,
                     struct bg_progress_t * progress,
                     bool force,
-                    bool append );
+                    bool append,
+                    concat_stats_t * stats );
 
 #ifdef __cplusplus
 }
@@ -37,6 +37,10 @@
 #include "file_tools.h"
 #endif
 
+#ifndef _h_perf_report_
+#include "perf_report.h"
+#endif
+
 #ifndef _h_klib_time_
 #include <klib/time.h>
 #endif
@@ -155,7 +159,9 @@ static rc_t cm_copy_this_file( copy_machine_t * self, const struct KFile * src )
             ErrMsg( "copy_machine.c copy_this_file().TimeoutInit( %lu ms ) -> %R", self -> q_wait_time, rc );
         } else {
             copy_machine_block_t * block;
+            uint64_t t_start = perf_now_us(); /* perf_report.c */
             rc = KQueuePop ( self -> empty_q, ( void ** )&block, &tm );
+            perf_add( pc_cm_reader_wait_us, perf_now_us() - t_start ); /* perf_report.c */
             if ( 0 == rc ) {
                 block -> available = 0;
                 rc = KFileRead( src, src_pos, block -> buffer, self -> buf_size, &num_read );
@@ -243,7 +249,9 @@ static rc_t cm_writer_thread( const KThread * thread, void *data ) {
             ErrMsg( "copy_machine.c copy_machine_writer_thread().TimeoutInit() -> %R", rc );
         } else {
             copy_machine_block_t * block;
+            uint64_t t_start = perf_now_us(); /* perf_report.c */
             rc = KQueuePop ( self -> to_write_q, ( void ** )&block, /*&tm*/ NULL );
+            perf_add( pc_cm_writer_wait_us, perf_now_us() - t_start ); /* perf_report.c */
             if ( 0 == rc ) {
                 /* we got a block to write out of the to_write_q */
                 size_t num_written;
@@ -252,6 +260,7 @@ static rc_t cm_writer_thread( const KThread * thread, void *data ) {
                 if ( 0 == rc ) {
                     /* increment the write - position */
                     self -> dst_pos += num_written;
+                    perf_add( pc_output_bytes_written, num_written ); /* perf_report.c */
 
                     /* inform the background-process about it */
                     bg_progress_update( self -> progress, num_written ); /* progress_thread.c */
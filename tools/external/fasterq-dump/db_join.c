@@ -58,6 +58,18 @@
 #include "flex_printer.h"
 #endif
 
+#ifndef _h_mate_cache_
+#include "mate_cache.h"
+#endif
+
+#ifndef _h_row_selection_
+#include "row_selection.h"
+#endif
+
+#ifndef _h_perf_report_
+#include "perf_report.h"
+#endif
+
 #ifndef _h_klib_out_
 #include <klib/out.h>
 #endif
@@ -117,17 +129,21 @@ static rc_t dbj_init_cmn_data( dbj_cmn_t * j,
     j -> looked_up_bases_2 . S . addr = NULL;
     j -> loop_nr = 0;
     j -> cmp_read_present = cmp_read_present;
+    j -> index = NULL;
 
     if ( NULL != index_filename ) {
         if ( ft_file_exists( cp -> dir, "%s", index_filename ) ) {
             rc = make_index_reader( cp -> dir, &j -> index, buf_size, "%s", index_filename ); /* index.c */
+            if ( 0 != rc ) {
+                /* we can live without the index, it just makes the seeks slower */
+                j -> index = NULL;
+            }
         }
-    } else {
-        j -> index = NULL;
     }
 
-    rc = make_lookup_reader( cp -> dir, j -> index, &( j -> lookup ), buf_size,
-                             "%s", lookup_filename ); /* lookup_reader.c */
+    /* every join-thread jumps into its own slice of the lookup-file: map it if possible */
+    rc = make_mapped_lookup_reader( cp -> dir, j -> index, &( j -> lookup ), buf_size,
+                                    "%s", lookup_filename ); /* lookup_reader.c */
     if ( 0 == rc ) {
         rc = make_SBuffer( &( j -> looked_up_bases_1 ), 4096 );  /* helper.c */
         if ( 0 != rc ) {
@@ -1757,6 +1773,7 @@ typedef struct dbj_thread_data_t {
     struct bg_progress_t * progress;
     struct temp_registry_t * registry;
     struct filter_2na_t * filter;
+    const struct row_selection_t * selection;
 
     KThread * thread;
 
@@ -1768,6 +1785,11 @@ typedef struct dbj_thread_data_t {
     format_t fmt;
     uint32_t thread_id;
     bool cmp_read_present;
+    bool show_details;
+    lookup_seek_stats_t seek_stats;     /* lookup_reader.h */
+    uint64_t elapsed_us;                /* perf_report.h */
+    uint32_t mate_cache_capacity;       /* streaming-mode, mate_cache.h */
+    bool read_type_present;             /* streaming-mode, SEQUENCE.READ_TYPE orients the aligned reads */
 
     const join_options_t * join_options;
     struct multi_writer_t * multi_writer;
@@ -1776,6 +1798,7 @@ typedef struct dbj_thread_data_t {
 static rc_t dbj_sorted_thread( const KThread * self, void * data ) {
     rc_t rc = 0;
     dbj_thread_data_t * jtd = data;
+    uint64_t t_start = perf_now_us(); /* perf_report.c */
     const join_options_t * jo = jtd -> join_options;
     struct filter_2na_t * filter = hlp_make_2na_filter( jo -> filter_bases ); /* helper.c */
     struct flp_t * flex_printer = NULL;
@@ -1785,7 +1808,9 @@ static rc_t dbj_sorted_thread( const KThread * self, void * data ) {
                          jtd -> dir,
                          jtd -> registry,
                          jtd -> part_file,
-                         jtd -> buf_size );
+                         jtd -> buf_size,
+                         jo -> compress,
+                         jo -> compress_level );
     /* make_flex_printer() is in flex_printer.c */
     flex_printer = flp_create_1( &file_args,
                 jtd -> accession_short,             /* we need that for the flexible defline! */
@@ -1804,6 +1829,7 @@ static rc_t dbj_sorted_thread( const KThread * self, void * data ) {
                                   jtd -> first_row,
                                   jtd -> row_limit > 0 ? jtd -> row_limit : jtd -> row_count,
                                   jtd -> thread_id );
+        cp . selection = jtd -> selection;
         rc = dbj_init_cmn_data( &j,
                         &jtd -> stats,
                         jtd -> join_options,
@@ -1835,14 +1861,26 @@ static rc_t dbj_sorted_thread( const KThread * self, void * data ) {
                 case ft_fasta_concat : break;           /* or this */                    
                 case ft_ref_report : break;             /* or this */                    
             }
+            lookup_reader_seek_stats( j . lookup, &jtd -> seek_stats ); /* lookup_reader.c */
             dbj_release_cmn_data( &j );
         }
-        flp_release( flex_printer ); /* flex_printer.c */
+        {
+            rc_t rc_flp = flp_release( flex_printer ); /* flex_printer.c */
+            if ( 0 == rc ) { rc = rc_flp; }
+        }
     }
     hlp_release_2na_filter( filter );   /* helper.c */
+    jtd -> elapsed_us = perf_now_us() - t_start; /* perf_report.c */
     return rc;
 }
 
+static void dbj_print_seek_stats( const dbj_thread_data_t * jtd ) {
+    const lookup_seek_stats_t * s = &( jtd -> seek_stats );
+    KOutMsg( "join #%u : %,lu seeks ( %,lu full scans ), %,lu bytes scanned, %,lu us, lookup %s\n",
+             jtd -> thread_id, s -> seeks, s -> full_scans, s -> bytes_scanned, s -> micro_seconds,
+             s -> mapped ? "mapped" : "buffered" );
+}
+
 static rc_t dbj_collect_threads_and_stats( Vector * threads, join_stats_t * stats ) {
     rc_t rc = 0;
     /* collect the threads, and add the join_stats */
@@ -1854,6 +1892,14 @@ static rc_t dbj_collect_threads_and_stats( Vector * threads, join_stats_t * stat
             KThreadWait( jtd -> thread, &rc_thread );
             if ( 0 != rc_thread ) { rc = rc_thread; }
             KThreadRelease( jtd -> thread );
+            if ( jtd -> show_details ) {
+                dbj_print_seek_stats( jtd ); /* above */
+            }
+            perf_thread_rate( ps_join, jtd -> thread_id, jtd -> stats . spots_read, jtd -> elapsed_us ); /* perf_report.c */
+            perf_add( pc_join_spots, jtd -> stats . spots_read );
+            perf_add( pc_lookup_seeks, jtd -> seek_stats . seeks );
+            perf_add( pc_lookup_full_scans, jtd -> seek_stats . full_scans );
+            perf_add( pc_lookup_bytes_scanned, jtd -> seek_stats . bytes_scanned );
             hlp_add_join_stats( stats, &jtd -> stats ); /* helper.c */
             free( jtd );
         }
@@ -1900,11 +1946,19 @@ rc_t dbj_create_sorted_fastq_fasta( const dbj_sorted_fastq_fasta_args_t * args )
             corrected_join_options . print_spotgroup = spot_group_requested( args -> seq_defline,
                                                                              args -> qual_defline ); /* flex_printer.c */
             VectorInit( &threads, 0, args -> num_threads );
-            rows_per_thread = hlp_calculate_rows_per_thread( &num_threads2, seq_row_count );
+            if ( NULL != args -> selection ) {
+                /* each thread gets the same number of selected rows, the windows are computed below */
+                rows_per_thread = hlp_calculate_rows_per_thread( &num_threads2, rsel_row_count( args -> selection ) );
+            } else {
+                /* the planner has chosen the slice-size */
+                rows_per_thread = hlp_calculate_rows_per_slice( &num_threads2, seq_row_count,
+                                                                args -> rows_per_slice ); /* helper.c */
+            }
 
             /* we need the row-count for that... */
             if ( args -> show_progress ) {
-                rc = bg_progress_make( &progress, seq_row_count, 0, 0 ); /* progress_thread.c */
+                uint64_t total = ( NULL != args -> selection ) ? rsel_expected_count( args -> selection ) : seq_row_count;
+                rc = bg_progress_make( &progress, total, 0, 0 ); /* progress_thread.c */
             }
 
             for ( thread_id = 0; 0 == rc && thread_id < num_threads2; ++thread_id ) {
@@ -1931,6 +1985,12 @@ rc_t dbj_create_sorted_fastq_fasta( const dbj_sorted_fastq_fasta_args_t * args )
                     jtd -> join_options     = &corrected_join_options;
                     jtd -> thread_id        = thread_id;
                     jtd -> cmp_read_present = cmp_read_column_present;
+                    jtd -> show_details     = args -> show_details;
+                    jtd -> selection        = args -> selection;
+                    if ( NULL != args -> selection ) {
+                        rsel_slice( args -> selection, thread_id, num_threads2,
+                                    &jtd -> first_row, &jtd -> row_count ); /* row_selection.c */
+                    }
 
                     rc = make_joined_filename( args -> temp_dir, jtd -> part_file, sizeof jtd -> part_file,
                                                args -> accession_short, thread_id ); /* temp_dir.c */
@@ -1965,12 +2025,14 @@ static rc_t dbj_unsorted_fasta_align_thread( const KThread * self, void * data )
 {
     rc_t rc = 0;
     dbj_thread_data_t * jtd = data;
+    uint64_t t_start = perf_now_us(); /* perf_report.c */
     join_stats_t * stats = &( jtd -> stats );
     cmn_iter_params_t cp;
     struct alit_t * align_iter;
     uint64_t loop_nr = 0;
     struct flp_t * flex_printer;
     bool uses_read_id;
+    alit_opt_t alit_opt;
     alit_rec_t rec;
 
     cmn_iter_populate_params( &cp,
@@ -1993,7 +2055,11 @@ static rc_t dbj_unsorted_fasta_align_thread( const KThread * self, void * data )
     }
 
     uses_read_id = read_id_requested( jtd -> seq_defline, NULL ); /* dflt_defline.c */
-    rc = alit_create( &cp, &align_iter, uses_read_id ); /* fastq-iter.c */
+    alit_opt . with_read_id = uses_read_id;
+    alit_opt . with_quality = false;
+    alit_opt . with_mate_id = false;
+    alit_opt . with_read_type = false;
+    rc = alit_create( &cp, &align_iter, alit_opt ); /* align_iter.c */
     if ( 0 != rc ) {
         ErrMsg( "fast_align_thread_func().make_align_iter() -> %R", rc );
         flp_release( flex_printer );
@@ -2038,7 +2104,11 @@ static rc_t dbj_unsorted_fasta_align_thread( const KThread * self, void * data )
     } /* END of iterate over the aligned READS */
 
     alit_release( align_iter );
-    flp_release( flex_printer );
+    {
+        rc_t rc_flp = flp_release( flex_printer ); /* flex_printer.c */
+        if ( 0 == rc ) { rc = rc_flp; }
+    }
+    jtd -> elapsed_us = perf_now_us() - t_start; /* perf_report.c */
     return rc;
 }
 
@@ -2108,6 +2178,7 @@ static rc_t dbj_create_unsorted_fasta_from_align( KDirectory * dir,
 static rc_t dbj_unsorted_fasta_seq_thread( const KThread * self, void * data ) {
     rc_t rc = 0;
     dbj_thread_data_t * jtd = data;
+    uint64_t t_start = perf_now_us(); /* perf_report.c */
     const join_options_t * jo = jtd -> join_options;
     join_stats_t * stats = &( jtd -> stats );
     cmn_iter_params_t cp;
@@ -2153,8 +2224,12 @@ static rc_t dbj_unsorted_fasta_seq_thread( const KThread * self, void * data ) {
 
     /* iterate over the SPOTs of the given row-range */
     while ( 0 == rc && fq_seq_csra_iter_get_data( iter, &rec, &rc ) ) {
-        uint32_t read_id_0, offset;
-        stats -> spots_read++;
+        uint32_t read_id_0, offset, aligned = 0;
+        for ( read_id_0 = 0; read_id_0 < rec . num_alig_id && read_id_0 < 2; read_id_0++ ) {
+            if ( 0 != rec . prim_alig_id[ read_id_0 ] ) { aligned++; }
+        }
+        /* spots with both mates aligned are counted by the align-threads */
+        if ( aligned < 2 ) { stats -> spots_read++; }
         rc = hlp_get_quitting(); /* helper.c */
         if ( 0 != rc ) { break; } /* the user has interrupted the tool */
 
@@ -2221,7 +2296,11 @@ static rc_t dbj_unsorted_fasta_seq_thread( const KThread * self, void * data ) {
     } /* END of iterating over the SPOTs in the given row-range */
     fq_seq_csra_iter_release( iter );
 
-    flp_release( flex_printer );
+    {
+        rc_t rc_flp = flp_release( flex_printer ); /* flex_printer.c */
+        if ( 0 == rc ) { rc = rc_flp; }
+    }
+    jtd -> elapsed_us = perf_now_us() - t_start; /* perf_report.c */
     return rc;
 }
 
@@ -2312,7 +2391,9 @@ rc_t dbj_create_unsorted_fasta( const dbj_unsorted_fasta_args_t * args ) {
                     args -> buf_size,
                     0,                          /* q_wait_time, if 0 --> use default = 5 ms */
                     args -> num_threads * 3,    /* q_num_blocks, if 0 use default = 8 */
-                    0 );                        /* q_block_size, if 0 use default = 4 MB */
+                    0,                          /* q_block_size, if 0 use default = 4 MB */
+                    args -> join_options -> compress,
+                    args -> join_options -> compress_level );
             if ( NULL != multi_writer ) {
                 struct bg_progress_t * progress = NULL;
                 struct filter_2na_t * filter = hlp_make_2na_filter( args -> join_options -> filter_bases ); /* helper.c */
@@ -2389,3 +2470,478 @@ rc_t dbj_create_unsorted_fasta( const dbj_unsorted_fasta_args_t * args ) {
     }
     return rc;
 }
+
+/* ======================================================================================================================
+    the streaming FASTQ approach for cSRA databases ( split-spot, unsorted ) ...
+   ====================================================================================================================== */
+
+/* an approximation of what a cached read costs: bases + qualities + entry + hash-slots */
+#define DBJ_MATE_CACHE_BYTES_PER_READ 512
+#define DBJ_MATE_CACHE_MIN_CAPACITY 1024
+
+static rc_t dbj_streaming_print( struct flp_t * flex_printer,
+                                 uint64_t spot_id, uint32_t read_id,
+                                 const String * read, const String * quality ) {
+    flp_data_t data;
+    data . row_id = spot_id;
+    data . read_id = read_id;
+    data . dst_id = 0;          /* not used, because registry=NULL - output to common final file */
+    data . spotname = NULL;     /* we do not have the spot-name in the align-table */
+    data . spotgroup = NULL;    /* align-rec does not have spot-group! */
+    data . read1 = read;
+    data . read2 = NULL;
+    data . quality = quality;
+    return flp_print( flex_printer, &data ); /* flex_printer.c */
+}
+
+static rc_t dbj_streaming_print_single( struct flp_t * flex_printer,
+                                        join_stats_t * stats,
+                                        const mate_cache_rec_t * rec ) {
+    rc_t rc = dbj_streaming_print( flex_printer, rec -> spot_id, rec -> read_id,
+                                   &( rec -> read ), &( rec -> quality ) ); /* above */
+    if ( 0 == rc ) {
+        stats -> reads_written++;
+        stats -> mates_split++;
+    }
+    return rc;
+}
+
+/* both mates in one transaction, the one with the lower read-id first */
+static rc_t dbj_streaming_print_pair( struct flp_t * flex_printer,
+                                      join_stats_t * stats,
+                                      const mate_cache_rec_t * a,
+                                      const mate_cache_rec_t * b ) {
+    rc_t rc = flp_begin_transaction( flex_printer ); /* flex_printer.c */
+    if ( 0 == rc ) {
+        const mate_cache_rec_t * first = ( a -> read_id <= b -> read_id ) ? a : b;
+        const mate_cache_rec_t * second = ( first == a ) ? b : a;
+        rc = dbj_streaming_print( flex_printer, first -> spot_id, first -> read_id,
+                                  &( first -> read ), &( first -> quality ) ); /* above */
+        if ( 0 == rc ) {
+            rc = dbj_streaming_print( flex_printer, second -> spot_id, second -> read_id,
+                                      &( second -> read ), &( second -> quality ) ); /* above */
+        }
+        if ( 0 == rc ) {
+            rc = flp_commit_transaction( flex_printer ); /* flex_printer.c */
+        } else {
+            /* do not let a half-written pair into the output */
+            flp_abort_transaction( flex_printer ); /* flex_printer.c */
+        }
+        if ( 0 == rc ) {
+            stats -> reads_written += 2;
+            stats -> mates_paired++;
+        }
+    }
+    return rc;
+}
+
+/* one aligned read: print it alone, pair it with a waiting mate or let it wait */
+static rc_t dbj_streaming_handle_align_rec( struct flp_t * flex_printer,
+                                            struct mate_cache_t * cache,
+                                            join_stats_t * stats,
+                                            const alit_rec_t * rec,
+                                            int64_t first_row,
+                                            int64_t last_row ) {
+    rc_t rc = 0;
+    mate_cache_rec_t this_rec, mate;
+    this_rec . spot_id = rec -> spot_id;
+    this_rec . read_id = rec -> read_id;
+    this_rec . read = rec -> read;
+    this_rec . quality = rec -> quality;
+
+    if ( mate_cache_take( cache, rec -> spot_id, &mate ) ) { /* mate_cache.c */
+        rc = dbj_streaming_print_pair( flex_printer, stats, &this_rec, &mate ); /* above */
+    } else {
+        int64_t mate_row = ( int64_t )rec -> mate_id;
+        /* only wait for a mate that comes later in the row-range of this thread,
+           all others have been evicted already or are handled by a different thread */
+        if ( mate_row > rec -> row_id && mate_row <= last_row && mate_row >= first_row ) {
+            mate_cache_rec_t evicted;
+            if ( mate_cache_evict( cache, &evicted ) ) { /* mate_cache.c */
+                rc = dbj_streaming_print_single( flex_printer, stats, &evicted ); /* above */
+            }
+            if ( 0 == rc ) {
+                rc = mate_cache_put( cache, rec -> spot_id, rec -> read_id,
+                                     &( rec -> read ), &( rec -> quality ) ); /* mate_cache.c */
+                if ( 0 != rc ) {
+                    ErrMsg( "dbj_streaming_handle_align_rec().mate_cache_put( spot #%lu ) -> %R",
+                            rec -> spot_id, rc );
+                }
+            }
+        } else {
+            rc = dbj_streaming_print( flex_printer, rec -> spot_id, rec -> read_id,
+                                      &( rec -> read ), &( rec -> quality ) ); /* above */
+            if ( 0 == rc ) {
+                stats -> reads_written++;
+                if ( 0 != mate_row ) { stats -> mates_split++; }
+            }
+        }
+    }
+    return rc;
+}
+
+/* iterate over the ALIGN-table, pair the mates via a bounded mate-cache */
+static rc_t dbj_streaming_align_thread( const KThread * self, void * data ) {
+    rc_t rc = 0;
+    dbj_thread_data_t * jtd = data;
+    uint64_t t_start = perf_now_us(); /* perf_report.c */
+    const join_options_t * jo = jtd -> join_options;
+    join_stats_t * stats = &( jtd -> stats );
+    cmn_iter_params_t cp;
+    struct alit_t * align_iter = NULL;
+    struct mate_cache_t * cache = NULL;
+    struct filter_2na_t * filter = NULL;
+    struct flp_t * flex_printer = NULL;
+    uint64_t loop_nr = 0;
+    uint64_t row_count = jtd -> row_limit > 0 ? jtd -> row_limit : jtd -> row_count;
+    int64_t last_row = jtd -> first_row + ( int64_t )row_count - 1;
+    alit_opt_t alit_opt;
+    alit_rec_t rec;
+
+    cmn_iter_populate_params( &cp,
+                              jtd -> dir,
+                              jtd -> vdb_mgr,
+                              jtd -> accession_short,
+                              jtd -> accession_path,
+                              jtd -> cur_cache,
+                              jtd -> first_row,
+                              row_count,
+                              jtd -> thread_id );
+
+    alit_opt . with_read_id = true;     /* needed to print the mates in order */
+    alit_opt . with_quality = true;
+    alit_opt . with_mate_id = true;
+    alit_opt . with_read_type = jtd -> read_type_present; /* the same orientation as the sorted mode */
+
+    flex_printer = flp_create_2( jtd -> multi_writer,     /* passed in multi-writer */
+                            jtd -> accession_short,       /* the accession to be printed */
+                            jtd -> seq_defline,           /* if seq-defline is NULL, use default */
+                            jtd -> qual_defline,          /* if qual-defline is NULL, use default */
+                            false );                      /* fastq-mode */
+    if ( NULL == flex_printer ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    } else {
+        filter = hlp_make_2na_filter( jo -> filter_bases ); /* helper.c */
+        rc = make_mate_cache( &cache, jtd -> mate_cache_capacity ); /* mate_cache.c */
+        if ( 0 != rc ) {
+            ErrMsg( "dbj_streaming_align_thread().make_mate_cache( %u ) -> %R", jtd -> mate_cache_capacity, rc );
+        } else {
+            rc = alit_create( &cp, &align_iter, alit_opt ); /* align_iter.c */
+            if ( 0 != rc ) {
+                ErrMsg( "dbj_streaming_align_thread().alit_create() -> %R", rc );
+            }
+        }
+    }
+
+    /* iterate over the aligned READS in the given row-range */
+    while ( 0 == rc && alit_get_rec( align_iter, &rec, &rc ) ) { /* align_iter.c */
+        rc = hlp_get_quitting(); /* helper.c */
+        if ( 0 != rc ) {
+            ErrMsg( "terminated in loop_nr #%u.%lu for ALIGN-ROWID #%ld", jtd -> thread_id, loop_nr, rec . row_id );
+            hlp_set_quitting(); /* helper.c */
+            break;
+        }
+
+        /* a spot with both mates aligned is counted once, at the mate with the lower ALIGN-row,
+           the seq-threads count all other spots */
+        if ( rec . mate_id > ( uint64_t )rec . row_id ) {
+            stats -> spots_read++;
+        }
+
+        if ( rec . read . len > 0 ) {
+            stats -> reads_read += 1;
+            if ( rec . read . len != rec . quality . len ) {
+                ErrMsg( "align-row #%ld : read.len(%u) != quality.len(%u)\n", rec . row_id,
+                        rec . read . len, rec . quality . len );
+                stats -> reads_invalid++;
+            } else if ( jo -> min_read_len > 0 && rec . read . len < jo -> min_read_len ) {
+                stats -> reads_too_short++;
+            } else if ( hlp_filter_2na_1( filter, &( rec . read ) ) ) { /* helper.c */
+                rc = dbj_streaming_handle_align_rec( flex_printer, cache, stats, &rec,
+                                                     jtd -> first_row, last_row ); /* above */
+            }
+        } else {
+            stats -> reads_zero_length++;
+        }
+
+        if ( 0 == rc ) {
+            loop_nr ++;
+            bg_progress_inc( jtd -> progress ); /* progress_thread.c (ignores NULL) */
+        }
+    } /* END of iterate over the aligned READS */
+
+    /* the reads still waiting for a mate are printed alone */
+    if ( 0 == rc ) {
+        mate_cache_rec_t left;
+        while ( 0 == rc && mate_cache_flush( cache, &left ) ) { /* mate_cache.c */
+            rc = dbj_streaming_print_single( flex_printer, stats, &left ); /* above */
+        }
+    }
+
+    alit_release( align_iter );
+    release_mate_cache( cache );
+    hlp_release_2na_filter( filter ); /* helper.c */
+    {
+        rc_t rc_flp = flp_release( flex_printer ); /* flex_printer.c */
+        if ( 0 == rc ) { rc = rc_flp; }
+    }
+    jtd -> elapsed_us = perf_now_us() - t_start; /* perf_report.c */
+    return rc;
+}
+
+/* iterate over the SEQ-table, but only use what is half/fully unaligned... */
+static rc_t dbj_streaming_seq_thread( const KThread * self, void * data ) {
+    rc_t rc = 0;
+    dbj_thread_data_t * jtd = data;
+    uint64_t t_start = perf_now_us(); /* perf_report.c */
+    const join_options_t * jo = jtd -> join_options;
+    join_stats_t * stats = &( jtd -> stats );
+    cmn_iter_params_t cp;
+    struct fq_seq_csra_iter_t * iter = NULL;
+    struct filter_2na_t * filter = NULL;
+    struct flp_t * flex_printer = NULL;
+    fq_seq_csra_opt_t opt;
+    uint64_t loop_nr = 0;
+    fq_seq_csra_rec_t rec;
+
+    cmn_iter_populate_params( &cp,
+                              jtd -> dir,
+                              jtd -> vdb_mgr,
+                              jtd -> accession_short,
+                              jtd -> accession_path,
+                              jtd -> cur_cache,
+                              jtd -> first_row,
+                              jtd -> row_limit > 0 ? jtd -> row_limit : jtd -> row_count,
+                              jtd -> thread_id );
+
+    opt . with_read_len = true;
+    opt . with_name = false;
+    opt . with_read_type = true;
+    opt . with_cmp_read = jtd -> cmp_read_present;
+    opt . with_quality = true;
+    opt . with_spotgroup = jo -> print_spotgroup;
+
+    flex_printer = flp_create_2( jtd -> multi_writer,     /* passed in multi-writer */
+                            jtd -> accession_short,       /* the accession to be printed */
+                            jtd -> seq_defline,           /* if seq-defline is NULL, use default */
+                            jtd -> qual_defline,          /* if qual-defline is NULL, use default */
+                            false );                      /* fastq-mode */
+    if ( NULL == flex_printer ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    } else {
+        filter = hlp_make_2na_filter( jo -> filter_bases ); /* helper.c */
+        rc = fq_seq_csra_iter_make( &cp, opt, &iter ); /* fq_seq_csra_iter.c */
+        if ( 0 != rc ) {
+            ErrMsg( "dbj_streaming_seq_thread().fq_seq_csra_iter_make() -> %R", rc );
+        }
+    }
+
+    /* iterate over the SPOTs of the given row-range */
+    while ( 0 == rc && fq_seq_csra_iter_get_data( iter, &rec, &rc ) ) {
+        uint32_t read_id_0, offset, aligned = 0;
+        for ( read_id_0 = 0; read_id_0 < rec . num_alig_id && read_id_0 < 2; read_id_0++ ) {
+            if ( 0 != rec . prim_alig_id[ read_id_0 ] ) { aligned++; }
+        }
+        /* spots with both mates aligned are counted by the align-threads */
+        if ( aligned < 2 ) { stats -> spots_read++; }
+        rc = hlp_get_quitting(); /* helper.c */
+        if ( 0 != rc ) { break; } /* the user has interrupted the tool */
+
+        if ( rec . num_read_start != rec . num_read_len ) {
+            ErrMsg( "row #%ld : num-read-start (%u) != num-read-len(%u)\n",
+                    rec . row_id, rec . num_read_start, rec . num_read_len );
+            rc = SILENT_RC( rcApp, rcNoTarg, rcAccessing, rcRow, rcInvalid );
+        }
+
+        /* iterate over the READ's of the SPOT, CMP_READ holds only the unaligned bases */
+        for ( read_id_0 = 0, offset = 0; 0 == rc && read_id_0 < rec . num_read_start; read_id_0++ ) {
+            uint32_t read_len = rec . read_len[ read_id_0 ];
+            uint32_t read_start = rec . read_start[ read_id_0 ];
+            if ( 0 == read_len ) {
+                stats -> reads_zero_length++;
+            } else if ( 0 == rec . prim_alig_id[ read_id_0 ] ) {
+                uint32_t bases_start = jtd -> cmp_read_present ? offset : read_start;
+                offset += read_len;
+                stats -> reads_read += 1;
+                if ( bases_start + read_len > rec . read . len ||
+                     read_start + read_len > rec . quality . len ) {
+                    ErrMsg( "row #%ld : read[%u] ( start=%u, len=%u ) out of bounds: READ.len = %u, QUALITY.len = %u\n",
+                            rec . row_id, read_id_0, bases_start, read_len, rec . read . len, rec . quality . len );
+                    rc = SILENT_RC( rcApp, rcNoTarg, rcAccessing, rcRow, rcInvalid );
+                } else if ( dbj_filter( stats, &rec, jo, read_id_0 ) ) { /* above */
+                    String READ, QUAL;
+                    dbj_init_str( &( rec . read ), &READ, bases_start, read_len ); /* above */
+                    dbj_init_str( &( rec . quality ), &QUAL, read_start, read_len ); /* above */
+                    if ( hlp_filter_2na_1( filter, &READ ) ) { /* helper.c */
+                        flp_data_t data;
+                        data . row_id = rec . row_id;
+                        data . read_id = read_id_0 + 1;
+                        data . dst_id = 0;
+                        data . spotname = NULL;
+                        data . spotgroup = &( rec . spotgroup );
+                        data . read1 = &READ;
+                        data . read2 = NULL;
+                        data . quality = &QUAL;
+                        rc = flp_print( flex_printer, &data ); /* flex_printer.c */
+                        if ( 0 == rc ) { stats -> reads_written++; }
+                    }
+                }
+            }
+        } /* END of iterating over the READS's of the SPOT */
+
+        if ( 0 == rc ) {
+            loop_nr ++;
+            bg_progress_inc( jtd -> progress ); /* progress_thread.c (ignores NULL) */
+        } else {
+            ErrMsg( "terminated in loop_nr #%u.%lu for SEQ-ROWID #%ld", jtd -> thread_id, loop_nr, rec . row_id );
+            hlp_set_quitting(); /* helper.c */
+        }
+    } /* END of iterating over the SPOTs in the given row-range */
+
+    fq_seq_csra_iter_release( iter );
+    hlp_release_2na_filter( filter ); /* helper.c */
+    {
+        rc_t rc_flp = flp_release( flex_printer ); /* flex_printer.c */
+        if ( 0 == rc ) { rc = rc_flp; }
+    }
+    jtd -> elapsed_us = perf_now_us() - t_start; /* perf_report.c */
+    return rc;
+}
+
+static rc_t dbj_create_streaming_threads( const dbj_streaming_fastq_args_t * args,
+                    const join_options_t * join_options,
+                    uint32_t num_threads,
+                    uint64_t row_count,
+                    uint32_t mate_cache_capacity,
+                    bool cmp_read_column_present,
+                    rc_t ( * thread_func ) ( const KThread *, void * ),
+                    struct bg_progress_t * progress,
+                    struct multi_writer_t * multi_writer,
+                    Vector * threads ) {
+    rc_t rc = 0;
+    int64_t row = 1;
+    uint32_t thread_id;
+    uint64_t rows_per_thread = hlp_calculate_rows_per_thread( &num_threads, row_count );
+
+    for ( thread_id = 0; 0 == rc && thread_id < num_threads; ++thread_id ) {
+        dbj_thread_data_t * jtd = calloc( 1, sizeof * jtd );
+        if ( NULL != jtd ) {
+            jtd -> dir              = args -> dir;
+            jtd -> vdb_mgr          = args -> vdb_mgr;
+            jtd -> accession_path   = args -> accession_path;
+            jtd -> accession_short  = args -> accession_short;
+            jtd -> seq_defline      = args -> seq_defline;
+            jtd -> qual_defline     = args -> qual_defline;
+            jtd -> first_row        = row;
+            jtd -> row_count        = rows_per_thread;
+            jtd -> row_limit        = args -> row_limit;
+            jtd -> cur_cache        = args -> cur_cache;
+            jtd -> buf_size         = args -> buf_size;
+            jtd -> progress         = progress;
+            jtd -> multi_writer     = multi_writer;
+            jtd -> fmt              = ft_fastq_split_spot; /* we handle only this one... */
+            jtd -> join_options     = join_options;
+            jtd -> thread_id        = thread_id;
+            jtd -> cmp_read_present = cmp_read_column_present;
+            jtd -> mate_cache_capacity = mate_cache_capacity;
+            jtd -> read_type_present = args -> insp_output -> seq . has_read_type_column;
+
+            rc = hlp_make_thread( &jtd -> thread, thread_func, jtd, THREAD_BIG_STACK_SIZE );
+            if ( 0 != rc ) {
+                ErrMsg( "join.c helper_make_thread( stream #%d ) -> %R", thread_id, rc );
+                free( jtd );
+            } else {
+                rc = VectorAppend( threads, NULL, jtd );
+                if ( 0 != rc ) {
+                    ErrMsg( "join.c VectorAppend( stream-thread #%d ) -> %R", thread_id, rc );
+                }
+            }
+            row += rows_per_thread;
+        }
+    }
+    return rc;
+}
+
+rc_t dbj_create_streaming_fastq( const dbj_streaming_fastq_args_t * args ) {
+    rc_t rc = 0;
+    if ( args -> show_progress ) {
+        KOutHandlerSetStdErr();
+        rc = KOutMsg( "stream :" );
+        KOutHandlerSetStdOut();
+    }
+
+    if ( 0 == rc ) {
+        uint64_t seq_row_count = args -> insp_output -> seq . row_count;
+        uint64_t align_row_count = args -> insp_output -> align . row_count;
+        bool cmp_read_column_present;
+        const char * seq_tbl_name = args -> insp_output -> seq . tbl_name;
+
+        rc = cmn_iter_check_db_column( args -> dir, args -> vdb_mgr, args -> accession_short, args -> accession_path,
+                                  seq_tbl_name, "CMP_READ", &cmp_read_column_present ); /* cmn_iter.c */
+
+        if ( 0 == rc && ( seq_row_count > 0 || align_row_count > 0 ) ) {
+            struct multi_writer_t * multi_writer = mw_create( args -> dir,
+                    args -> output_filename,
+                    args -> buf_size,
+                    0,                          /* q_wait_time, if 0 --> use default = 5 ms */
+                    args -> num_threads * 3,    /* q_num_blocks, if 0 use default = 8 */
+                    0,                          /* q_block_size, if 0 use default = 4 MB */
+                    args -> join_options -> compress,
+                    args -> join_options -> compress_level );
+            if ( NULL != multi_writer ) {
+                struct bg_progress_t * progress = NULL;
+                join_options_t corrected_join_options; /* helper.h */
+                uint64_t cache_capacity;
+                Vector seq_threads, align_threads;
+
+                uint32_t num_threads2 = args -> num_threads;
+                if ( !( args -> only_unaligned || args -> only_aligned ) ) {
+                    num_threads2 = args -> num_threads >> 1;
+                    if ( 1 == ( args -> num_threads & 0x01 ) ) { num_threads2 += 1; }
+                }
+                if ( 0 == num_threads2 ) { num_threads2 = 1; }
+
+                /* the memory-limit is shared by the mate-caches of all align-threads */
+                cache_capacity = ( args -> mem_limit / num_threads2 ) / DBJ_MATE_CACHE_BYTES_PER_READ;
+                if ( cache_capacity < DBJ_MATE_CACHE_MIN_CAPACITY ) { cache_capacity = DBJ_MATE_CACHE_MIN_CAPACITY; }
+                if ( cache_capacity > 0x10000000 ) { cache_capacity = 0x10000000; }
+
+                hlp_correct_join_options( &corrected_join_options, args -> join_options, false );
+                corrected_join_options . print_spotgroup = spot_group_requested( args -> seq_defline,
+                                                                                 args -> qual_defline ); /* dflt_defline.c */
+
+                if ( args -> show_progress ) {
+                    uint64_t total = ( args -> only_aligned ? 0 : seq_row_count ) +
+                                     ( args -> only_unaligned ? 0 : align_row_count );
+                    rc = bg_progress_make( &progress, total, 0, 0 ); /* progress_thread.c */
+                }
+
+                VectorInit( &seq_threads, 0, num_threads2 );
+                VectorInit( &align_threads, 0, num_threads2 );
+
+                /* both kinds of threads run at the same time, writing into the same multi-writer */
+                if ( 0 == rc && !( args -> only_aligned ) && seq_row_count > 0 ) {
+                    rc = dbj_create_streaming_threads( args, &corrected_join_options, num_threads2,
+                                    seq_row_count, 0, cmp_read_column_present,
+                                    dbj_streaming_seq_thread, progress, multi_writer, &seq_threads ); /* above */
+                }
+                if ( 0 == rc && !( args -> only_unaligned ) && align_row_count > 0 ) {
+                    rc = dbj_create_streaming_threads( args, &corrected_join_options, num_threads2,
+                                    align_row_count, ( uint32_t )cache_capacity, cmp_read_column_present,
+                                    dbj_streaming_align_thread, progress, multi_writer, &align_threads ); /* above */
+                }
+                {
+                    rc_t rc1 = dbj_collect_threads_and_stats( &align_threads, args -> stats ); /* above */
+                    rc_t rc2 = dbj_collect_threads_and_stats( &seq_threads, args -> stats ); /* above */
+                    if ( 0 == rc ) { rc = ( 0 != rc1 ) ? rc1 : rc2; }
+                }
+                bg_progress_release( progress ); /* progress_thread.c ( ignores NULL ) */
+                mw_release( multi_writer ); /* ( ignores NULL ) */
+            } else {
+                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                ErrMsg( "dbj_create_streaming_fastq().mw_create() -> %R", rc );
+            }
+        }
+    }
+    return rc;
+}
@@ -59,6 +59,8 @@ extern "C" {
 #include "inspector.h"
 #endif
 
+struct row_selection_t;
+
 typedef struct dbj_sorted_fastq_fasta_args_t {
     KDirectory * dir;
     const VDBManager * vdb_mgr;
@@ -76,8 +78,11 @@ typedef struct dbj_sorted_fastq_fasta_args_t {
     size_t cursor_cache;
     size_t buf_size;
     uint32_t num_threads;
+    uint64_t rows_per_slice;            /* 0 ... split the rows evenly across the threads, planner.h */
     uint64_t row_limit;
+    const struct row_selection_t * selection;  /* the spots to extract, NULL for all, row_selection.h */
     bool show_progress;
+    bool show_details;                  /* print the seek-statistics of the join-threads */
     format_t fmt;
 } dbj_sorted_fastq_fasta_args_t;
 
@@ -106,6 +111,34 @@ typedef struct dbj_unsorted_fasta_args_t {
 
 rc_t dbj_create_unsorted_fasta( const dbj_unsorted_fasta_args_t * args );
 
+
+/* streaming-mode for cSRA: no lookup-file, no temp-files, output in no particular order
+   the unaligned reads come from the SEQUENCE-table, the aligned reads and their qualities
+   from the PRIMARY_ALIGNMENT-table, mates found within a bounded cache are printed together */
+typedef struct dbj_streaming_fastq_args_t {
+    KDirectory * dir;
+    const VDBManager * vdb_mgr;
+    const char * accession_short;           /* accession-name to be used for output-file/error-reports */
+    const char * accession_path;            /* full path to accession for opening it */
+    const char * output_filename;           /* NULL for stdout! */
+    const char * seq_defline;               /* NULL for default */
+    const char * qual_defline;              /* NULL for default */
+    join_stats_t * stats;                   /* helper.h */
+    const join_options_t * join_options;    /* helper.h */
+    const insp_output_t * insp_output;      /* inspector.h */
+    size_t cur_cache;                       /* size of cursor-cache for vdb-cursor */
+    size_t buf_size;                        /* size of buffer-file for output-writing */
+    size_t mem_limit;                       /* memory for all mate-caches together */
+    uint32_t num_threads;                   /* how many threads to use */
+    uint64_t row_limit;
+    bool show_progress;                     /* display progressbar */
+    bool force;                             /* overwrite output-file if it exists */
+    bool only_unaligned;                    /* process only un-aligned reads */
+    bool only_aligned;                      /* process only aligned reads */
+} dbj_streaming_fastq_args_t;
+
+rc_t dbj_create_streaming_fastq( const dbj_streaming_fastq_args_t * args );
+
 #ifdef __cplusplus
 }
 #endif
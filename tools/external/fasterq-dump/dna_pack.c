@@ -0,0 +1,215 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "dna_pack.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+dna_len_t dna_packed_len( dna_len_t header ) {
+    return header & DNA_LEN_MASK;
+}
+
+size_t dna_packed_bytes( dna_len_t header ) {
+    size_t dna_len = header & DNA_LEN_MASK;
+    size_t res = ( dna_len + 3 ) / 4;
+    if ( 0 != ( header & DNA_N_MASK_FLAG ) ) {
+        res += ( dna_len + 7 ) / 8;
+    }
+    return res;
+}
+
+size_t dna_pack_max_size( dna_len_t dna_len ) {
+    return sizeof( dna_len_t ) + dna_packed_bytes( dna_len | DNA_N_MASK_FLAG );
+}
+
+/* 2na-code for A/C/G/T, everything else maps to A and gets a bit in the N-mask */
+static const uint8_t xASCII_to_2na[ 256 ] = {
+    /* 0x00 .. 0x3F */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    /* @  A  B  C  D  E  F  G  H  I  J  K  L  M  N  O */
+       0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+    /* P  Q  R  S  T  U  V  W  X  Y  Z  [  \  ]  ^  _ */
+       0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    /* 0x60 .. 0xFF */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static bool is_acgt( uint8_t c ) {
+    return ( 'A' == c || 'C' == c || 'G' == c || 'T' == c );
+}
+
+#if defined( __SSE2__ )
+/* spread the 16 bits of x into the even bit-positions of the result */
+static uint32_t spread_bits( uint32_t x ) {
+    x = ( x | ( x << 8 ) ) & 0x00FF00FF;
+    x = ( x | ( x << 4 ) ) & 0x0F0F0F0F;
+    x = ( x | ( x << 2 ) ) & 0x33333333;
+    x = ( x | ( x << 1 ) ) & 0x55555555;
+    return x;
+}
+
+/* packs 16 bases at once: 4 bytes of 2na into dst, returns the 16-bit N-mask */
+static uint32_t pack_16_bases( const uint8_t * src, uint8_t * dst ) {
+    const __m128i v = _mm_loadu_si128( ( const __m128i * )src );
+    const __m128i a = _mm_cmpeq_epi8( v, _mm_set1_epi8( 'A' ) );
+    const __m128i c = _mm_cmpeq_epi8( v, _mm_set1_epi8( 'C' ) );
+    const __m128i g = _mm_cmpeq_epi8( v, _mm_set1_epi8( 'G' ) );
+    const __m128i t = _mm_cmpeq_epi8( v, _mm_set1_epi8( 'T' ) );
+    /* low bit of the 2na-code is set for C and T, the high bit for G and T */
+    const uint32_t lo = ( uint32_t )_mm_movemask_epi8( _mm_or_si128( c, t ) );
+    const uint32_t hi = ( uint32_t )_mm_movemask_epi8( _mm_or_si128( g, t ) );
+    const uint32_t acgt = ( uint32_t )_mm_movemask_epi8( _mm_or_si128( _mm_or_si128( a, c ), _mm_or_si128( g, t ) ) );
+    const uint32_t codes = spread_bits( lo ) | ( spread_bits( hi ) << 1 );
+    dst[ 0 ] = ( uint8_t )( codes );
+    dst[ 1 ] = ( uint8_t )( codes >> 8 );
+    dst[ 2 ] = ( uint8_t )( codes >> 16 );
+    dst[ 3 ] = ( uint8_t )( codes >> 24 );
+    return ( ~acgt ) & 0xFFFF;
+}
+#endif
+
+size_t dna_pack_2na( const uint8_t * src, dna_len_t dna_len, uint8_t * dst ) {
+    dna_len_t header = dna_len & DNA_LEN_MASK;
+    uint8_t * bases = dst + sizeof header;
+    uint8_t * mask = bases + ( ( ( size_t )header + 3 ) / 4 );
+    bool has_n = false;
+    dna_len_t idx = 0;
+
+#if defined( __SSE2__ )
+    for ( ; idx + 16 <= header; idx += 16 ) {
+        uint32_t n_mask = pack_16_bases( src + idx, bases + ( idx / 4 ) );
+        mask[ idx / 8 ] = ( uint8_t )( n_mask );
+        mask[ ( idx / 8 ) + 1 ] = ( uint8_t )( n_mask >> 8 );
+        has_n |= ( 0 != n_mask );
+    }
+#endif
+
+    /* the remaining bases ( or all of them without SSE2 ) one at a time */
+    for ( ; idx < header; ++idx ) {
+        uint8_t c = src[ idx ];
+        uint32_t shift2 = ( idx & 3 ) * 2;
+        uint32_t shift1 = ( idx & 7 );
+        if ( 0 == shift2 ) { bases[ idx / 4 ] = 0; }
+        if ( 0 == shift1 ) { mask[ idx / 8 ] = 0; }
+        bases[ idx / 4 ] |= ( uint8_t )( xASCII_to_2na[ c ] << shift2 );
+        if ( !is_acgt( c ) ) {
+            mask[ idx / 8 ] |= ( uint8_t )( 1 << shift1 );
+            has_n = true;
+        }
+    }
+
+    if ( has_n ) { header |= DNA_N_MASK_FLAG; }
+    memcpy( dst, &header, sizeof header );
+    return sizeof header + dna_packed_bytes( header );
+}
+
+static const char x2na_to_ASCII_fwd[ 4 ] = { 'A', 'C', 'G', 'T' };
+static const char x2na_to_ASCII_rev[ 4 ] = { 'T', 'G', 'C', 'A' };
+
+rc_t dna_unpack_2na( const String * packed, SBuffer_t * unpacked, bool reverse ) {
+    rc_t rc = 0;
+    const uint8_t * src = ( const uint8_t * )packed -> addr;
+    dna_len_t header = 0;
+    dna_len_t dna_len = 0;
+
+    if ( packed -> size < sizeof header ) {
+        rc = RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+        ErrMsg( "dna_unpack_2na() packed size %lu too small -> %R", packed -> size, rc );
+    } else {
+        memcpy( &header, src, sizeof header );
+        dna_len = dna_packed_len( header );
+        if ( packed -> size < sizeof header + dna_packed_bytes( header ) ) {
+            rc = RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+            ErrMsg( "dna_unpack_2na() packed size %lu too small for %u bases -> %R", packed -> size, dna_len, rc );
+        } else if ( dna_len >= unpacked -> buffer_size ) {
+            rc = increase_SBuffer_to( unpacked, dna_len + 4 );
+            if ( 0 != rc ) {
+                ErrMsg( "dna_unpack_2na() -> %R failed to increase buffer", rc );
+            }
+        }
+    }
+    if ( 0 == rc ) {
+        char * dst = ( char * )unpacked -> S . addr;
+        const uint8_t * bases = src + sizeof header;
+        const char * lookup = reverse ? x2na_to_ASCII_rev : x2na_to_ASCII_fwd;
+        dna_len_t idx;
+
+        if ( reverse ) {
+            for ( idx = 0; idx < dna_len; ++idx ) {
+                uint8_t code = ( bases[ idx / 4 ] >> ( ( idx & 3 ) * 2 ) ) & 3;
+                dst[ dna_len - 1 - idx ] = lookup[ code ];
+            }
+        } else {
+            for ( idx = 0; idx < dna_len; ++idx ) {
+                uint8_t code = ( bases[ idx / 4 ] >> ( ( idx & 3 ) * 2 ) ) & 3;
+                dst[ idx ] = lookup[ code ];
+            }
+        }
+
+        if ( 0 != ( header & DNA_N_MASK_FLAG ) ) {
+            /* overlay the N's, skip whole bytes of the mask without N's */
+            const uint8_t * mask = bases + ( ( ( size_t )dna_len + 3 ) / 4 );
+            size_t mask_bytes = ( ( size_t )dna_len + 7 ) / 8;
+            size_t m;
+            for ( m = 0; m < mask_bytes; ++m ) {
+                uint8_t bits = mask[ m ];
+                while ( 0 != bits ) {
+                    uint32_t bit = 0;
+                    while ( 0 == ( bits & ( 1 << bit ) ) ) { bit++; }
+                    bits &= ~( 1 << bit );
+                    idx = ( dna_len_t )( m * 8 + bit );
+                    if ( idx < dna_len ) {
+                        dst[ reverse ? dna_len - 1 - idx : idx ] = 'N';
+                    }
+                }
+            }
+        }
+
+        /* set the dna-length in the output-string and terminate it, just in case */
+        unpacked -> S . size = dna_len;
+        unpacked -> S . len = dna_len;
+        dst[ dna_len ] = 0;
+    }
+    return rc;
+}
@@ -0,0 +1,74 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_dna_pack_
+#define _h_dna_pack_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_helper_
+#include "helper.h"     /* dna_len_t */
+#endif
+
+/* -----------------------------------------------------------------------------------
+    The packed form of a READ, as it is stored in the lookup-files:
+
+    [ dna_len_t header ][ 2na bases ][ N-mask ( optional ) ]
+
+    header      ... number of bases, bit #31 signals the presence of the N-mask
+    2na bases   ... 4 bases per byte ( A=0, C=1, G=2, T=3 ), base #i at bits 2*(i%4)
+                    of byte i/4, ( dna_len + 3 ) / 4 bytes
+    N-mask      ... 1 bit per base, base #i at bit i%8 of byte i/8, ( dna_len + 7 ) / 8 bytes
+                    a set bit means the base is not one of A/C/G/T, it unpacks to 'N'
+                    the N-mask is omitted if there are no such bases in the READ
+   ----------------------------------------------------------------------------------- */
+
+#define DNA_N_MASK_FLAG 0x80000000
+#define DNA_LEN_MASK    0x7FFFFFFF
+
+/* the number of bases encoded in the header */
+dna_len_t dna_packed_len( dna_len_t header );
+
+/* the number of bytes following the header */
+size_t dna_packed_bytes( dna_len_t header );
+
+/* how many bytes dna_pack_2na() needs at most for dna_len bases ( incl. the header ) */
+size_t dna_pack_max_size( dna_len_t dna_len );
+
+/* packs dna_len ASCII-bases from src into dst, dst must have room for
+   dna_pack_max_size( dna_len ) bytes, returns the number of bytes used ( incl. the header ) */
+size_t dna_pack_2na( const uint8_t * src, dna_len_t dna_len, uint8_t * dst );
+
+/* unpacks a packed READ ( incl. the header ) into ASCII, reverse-complemented if requested */
+rc_t dna_unpack_2na( const String * packed, SBuffer_t * unpacked, bool reverse );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
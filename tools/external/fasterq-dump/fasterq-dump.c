@@ -61,6 +61,14 @@
 #include "ref_inventory.h"
 #endif
 
+#ifndef _h_index_
+#include "index.h"
+#endif
+
+#ifndef _h_perf_report_
+#include "perf_report.h"
+#endif
+
 #ifndef _h_kapp_args_
 #include <kapp/args.h>
 #endif
@@ -108,7 +116,7 @@ static const char * curcache_usage[] = { "size of cursor-cache dflt=10MB", NULL
 #define OPTION_CURCACHE "curcache"
 #define ALIAS_CURCACHE  "c"
 
-static const char * mem_usage[] = { "memory limit for sorting dflt=100MB", NULL };
+static const char * mem_usage[] = { "memory limit for sorting dflt: planned from RAM and accession", NULL };
 #define OPTION_MEM      "mem"
 #define ALIAS_MEM       "m"
 
@@ -116,7 +124,7 @@ static const char * temp_usage[] = { "where to put temp. files dflt=curr dir", N
 #define OPTION_TEMP     "temp"
 #define ALIAS_TEMP      "t"
 
-static const char * threads_usage[] = { "how many thread dflt=6", NULL };
+static const char * threads_usage[] = { "how many threads dflt: planned from cpu-count and accession", NULL };
 #define OPTION_THREADS  "threads"
 #define ALIAS_THREADS   "e"
 
@@ -219,6 +227,30 @@ static const char * row_limit_usage[] = { "limit rowcount per thread", NULL };
 #define OPTION_ROW_LIMIT        "row-limit"
 #define ALIAS_ROW_LIMIT         "l"
 
+static const char * rows_usage[] = { "extract only these spots: \"1-1000,5000,7000-\"", NULL };
+#define OPTION_ROWS             "rows"
+
+static const char * spot_list_usage[] = { "extract only the spots listed in this file",
+                                          "(one spot-id or range per line)",
+                                          NULL };
+#define OPTION_SPOT_LIST        "spot-list"
+
+static const char * sample_usage[] = { "extract a random sample of the spots",
+                                       "(fraction between 0.0 and 1.0, e.g. 0.01)",
+                                       NULL };
+#define OPTION_SAMPLE           "sample"
+
+static const char * seed_usage[] = { "seed for the random sample (dflt: 0)", NULL };
+#define OPTION_SEED             "seed"
+
+static const char * perf_report_usage[] = { "write a performance-report ( JSON-lines ) into this file", NULL };
+#define OPTION_PERF_REPORT      "perf-report"
+
+static const char * perf_interval_usage[] = { "add a sample to the performance-report every n seconds",
+                                              "(dflt: 0 ... only the final report)",
+                                              NULL };
+#define OPTION_PERF_INTERVAL    "perf-interval"
+
 static const char * check_usage[] = { "switch to control:",
                                       "on=perform size-check (default), ",
                                       "off=do not perform size-check, ",
@@ -235,6 +267,24 @@ static const char * disk_limit_tmp_usage[] = { "explicitly set disk-limit for te
 static const char * ngc_usage[] = { "PATH to ngc file", NULL };
 #define OPTION_NGC              "ngc"
 
+static const char * index_stride_usage[] = { "distance between entries in the lookup-index",
+                                             "(in spots*2, dflt: 20000)",
+                                             NULL };
+#define OPTION_INDEX_STRIDE     "index-stride"
+
+static const char * stream_usage[] = { "cSRA: no temp. files, unsorted split-spot output",
+                                       "(mem-limit bounds the cache for mate-pairing)",
+                                       NULL };
+#define OPTION_STREAM           "stream"
+
+static const char * compress_usage[] = { "compress output: none (default), gzip, zstd",
+                                         "(compressed in parallel, in blocks)",
+                                         NULL };
+#define OPTION_COMPRESS         "compress"
+
+static const char * compress_level_usage[] = { "compression-level (dflt: gzip=6, zstd=3)", NULL };
+#define OPTION_COMPRESS_LEVEL   "compress-level"
+
 static const char * keep_usage[] = { "keep temp. files", NULL };
 #define OPTION_KEEP              "keep"
 
@@ -283,9 +333,19 @@ OptDef ToolOptions[] = {
     { OPTION_DISK_LIMIT_TMP,NULL,               NULL, disk_limit_tmp_usage, 1, true,   false },
     { OPTION_CHECK,         NULL,               NULL, check_usage,          1, true,   false },
     { OPTION_NGC,           NULL,               NULL, ngc_usage,            1, true,   false },
+    { OPTION_INDEX_STRIDE,  NULL,               NULL, index_stride_usage,   1, true,   false },
+    { OPTION_STREAM,        NULL,               NULL, stream_usage,         1, false,  false },
+    { OPTION_COMPRESS,      NULL,               NULL, compress_usage,       1, true,   false },
+    { OPTION_COMPRESS_LEVEL,NULL,               NULL, compress_level_usage, 1, true,   false },
     { OPTION_KEEP,          NULL,               NULL, keep_usage,           1, false,  false },
     { OPTION_STEP,          NULL,               NULL, step_usage,           1, true,   false },
-    { OPTION_ROW_LIMIT,     ALIAS_ROW_LIMIT,    NULL, row_limit_usage,      1, true,   false }
+    { OPTION_ROW_LIMIT,     ALIAS_ROW_LIMIT,    NULL, row_limit_usage,      1, true,   false },
+    { OPTION_ROWS,          NULL,               NULL, rows_usage,           1, true,   false },
+    { OPTION_SPOT_LIST,     NULL,               NULL, spot_list_usage,      1, true,   false },
+    { OPTION_SAMPLE,        NULL,               NULL, sample_usage,         1, true,   false },
+    { OPTION_SEED,          NULL,               NULL, seed_usage,           1, true,   false },
+    { OPTION_PERF_REPORT,   NULL,               NULL, perf_report_usage,    1, true,   false },
+    { OPTION_PERF_INTERVAL, NULL,               NULL, perf_interval_usage,  1, true,   false }
 };
 
 /* ----------------------------------------------------------------------------------- */
@@ -380,11 +440,32 @@ static rc_t main_get_user_input( tool_ctx_t * tool_ctx, const Args * args ) {
     tool_ctx -> output_filename = ahlp_get_str_option( args, OPTION_OUTPUT_F, NULL );
     tool_ctx -> output_dirname = ahlp_get_str_option( args, OPTION_OUTPUT_D, NULL );
     tool_ctx -> buf_size = ahlp_get_size_t_option( args, OPTION_BUFSIZE, DFLT_BUF_SIZE );
-    tool_ctx -> mem_limit = ahlp_get_size_t_option( args, OPTION_MEM, DFLT_MEM_LIMIT );
+    tool_ctx -> requested_mem_limit = ahlp_get_size_t_option( args, OPTION_MEM, 0 );
+    tool_ctx -> mem_limit = ( tool_ctx -> requested_mem_limit > 0 ) ? tool_ctx -> requested_mem_limit : DFLT_MEM_LIMIT;
     tool_ctx -> row_limit = ahlp_get_uint64_t_option( args, OPTION_ROW_LIMIT, 0 );
     tool_ctx -> disk_limit_out_cmdl = ahlp_get_size_t_option( args, OPTION_DISK_LIMIT_OUT, 0 );
     tool_ctx -> disk_limit_tmp_cmdl = ahlp_get_size_t_option( args, OPTION_DISK_LIMIT_TMP, 0 );
-    tool_ctx -> num_threads = ahlp_get_uint32_t_option( args, OPTION_THREADS, DFLT_NUM_THREADS );
+    tool_ctx -> requested_threads = ahlp_get_uint32_t_option( args, OPTION_THREADS, 0 );
+    tool_ctx -> num_threads = ( tool_ctx -> requested_threads > 0 ) ? tool_ctx -> requested_threads : DFLT_NUM_THREADS;
+    tool_ctx -> index_stride = ahlp_get_uint64_t_option( args, OPTION_INDEX_STRIDE, DFLT_INDEX_FREQUENCY );
+    tool_ctx -> row_ranges = ahlp_get_str_option( args, OPTION_ROWS, NULL );
+    tool_ctx -> spot_list = ahlp_get_str_option( args, OPTION_SPOT_LIST, NULL );
+    if ( 0 == rc ) {
+        /* 0.0 ... no sampling, a given fraction has to be > 0.0 and <= 1.0 */
+        rc = ahlp_get_double_option( args, OPTION_SAMPLE, 0.0, &( tool_ctx -> sample_fraction ) );
+        if ( 0 == rc && NULL != ahlp_get_str_option( args, OPTION_SAMPLE, NULL ) &&
+             !( tool_ctx -> sample_fraction > 0.0 && tool_ctx -> sample_fraction <= 1.0 ) ) {
+            rc = RC( rcExe, rcArgv, rcParsing, rcParam, rcOutofrange );
+        }
+        if ( 0 != rc ) {
+            ErrMsg( "invalid sample-fraction '%s', expected a number > 0.0 and <= 1.0 -> %R",
+                    ahlp_get_str_option( args, OPTION_SAMPLE, "" ), rc );
+            UsageSummary( UsageDefaultName );
+        }
+    }
+    tool_ctx -> sample_seed = ahlp_get_uint64_t_option( args, OPTION_SEED, 0 );
+    tool_ctx -> perf_report = ahlp_get_str_option( args, OPTION_PERF_REPORT, NULL );
+    tool_ctx -> perf_interval = ahlp_get_uint32_t_option( args, OPTION_PERF_INTERVAL, 0 );
 
     /* join_options_t is defined in helper.h */
     tool_ctx -> join_options . rowid_as_name = false;
@@ -407,6 +488,7 @@ static rc_t main_get_user_input( tool_ctx_t * tool_ctx, const Args * args ) {
     tool_ctx -> split_file = split_file; /* passing it though for fasta-ref-tbl */
     tool_ctx -> use_name = ahlp_get_bool_option( args, OPTION_USE_NAME );
     tool_ctx -> keep_tmp_files = ahlp_get_bool_option( args, OPTION_KEEP );
+    tool_ctx -> stream = ahlp_get_bool_option( args, OPTION_STREAM );
     tool_ctx -> stop_after_step = ahlp_get_uint32_t_option( args, OPTION_STEP, 0 );
 
     if ( 0 == rc && NULL != tool_ctx -> ref_name_filter ) {
@@ -453,6 +535,13 @@ static rc_t main_get_user_input( tool_ctx_t * tool_ctx, const Args * args ) {
         ErrMsg( "invalid check-mode -> %R", rc );
     }
 
+    tool_ctx -> join_options . compress = hlp_get_compress_t( ahlp_get_str_option( args, OPTION_COMPRESS, NULL ) );
+    tool_ctx -> join_options . compress_level = ahlp_get_uint32_t_option( args, OPTION_COMPRESS_LEVEL, 0 );
+    if ( 0 == rc && ct_unknown == tool_ctx -> join_options . compress ) {
+        rc = RC( rcExe, rcFile, rcPacking, rcName, rcUnknown  );
+        ErrMsg( "invalid compression -> %R", rc );
+    }
+
     tool_ctx -> requested_seq_tbl_name = ahlp_get_str_option( args, OPTION_TABLE, NULL );
     tool_ctx -> append = ahlp_get_bool_option( args, OPTION_APPEND );
     tool_ctx -> use_stdout = ahlp_get_bool_option( args, OPTION_STDOUT );
@@ -489,6 +578,11 @@ static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
     struct background_file_merger_t * bg_file_merger;   /* merge_sorter.h */
     struct background_vector_merger_t * bg_vec_merger;  /* merge_sorter.h */
     uint64_t align_row_count = tool_ctx -> insp_output . align . row_count;
+    uint32_t lookup_threads = ( tool_ctx -> plan . lookup_threads > 0 )
+        ? tool_ctx -> plan . lookup_threads : tool_ctx -> num_threads;
+    uint32_t merge_batch = ( tool_ctx -> plan . merge_batch > 0 )
+        ? tool_ctx -> plan . merge_batch : tool_ctx -> num_threads;
+    uint64_t t_start = hlp_now_us(); /* helper.c */
 
     if ( tool_ctx -> show_progress ) {
         rc = bg_update_make( &gap, 0 );
@@ -504,7 +598,8 @@ static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
         fm_args . cleanup_task = tool_ctx -> cleanup_task;
         fm_args . lookup_filename = tool_ctx -> lookup_filename;
         fm_args . index_filename = tool_ctx -> index_filename;
-        fm_args . batch_size = tool_ctx -> num_threads;
+        fm_args . index_frequency = tool_ctx -> index_stride;
+        fm_args . batch_size = merge_batch;
         fm_args . wait_time = queue_timeout;
         fm_args . buf_size = tool_ctx -> buf_size;
         fm_args . gap = gap;
@@ -514,7 +609,7 @@ static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
         rc = make_background_file_merger( &bg_file_merger, &fm_args ); /* merge_sorter.c */
     }
 
-    /* the background-vector-merger catches the KVectors produced by
+    /* the background-vector-merger catches the lookup-stores produced by
        the lookup-produceer */
     if ( 0 == rc ) {
         vector_merger_args_t vm_args; /* merge_sorter.h */
@@ -523,7 +618,7 @@ static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
         vm_args . temp_dir = tool_ctx -> temp_dir;
         vm_args . cleanup_task = tool_ctx -> cleanup_task;
         vm_args . file_merger = bg_file_merger;
-        vm_args . batch_size = tool_ctx -> num_threads;
+        vm_args . batch_size = merge_batch;
         vm_args . q_wait_time = queue_timeout;
         vm_args . buf_size = tool_ctx -> buf_size;
         vm_args . gap = gap;
@@ -538,13 +633,13 @@ static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
    --------------------------------------------------------------------------------------------
     reading SEQ_SPOT_ID, SEQ_READ_ID and RAW_READ
     SEQ_SPOT_ID and SEQ_READ_ID is merged into a 64-bit-key
-    RAW_READ is read as 4na-unpacked ( Schema does not provide 4na-packed for this column )
-    these key-pairs are temporarely stored in a KVector until a limit is reached
-    after that limit is reached they are pushed to the background-vector-merger
-    This KVector looks like this:
+    RAW_READ is read as ASCII ( Schema does not provide 2na-packed for this column )
+    these key-pairs are temporarely stored in a lookup-store until the mem-limit is reached
+    after that limit is reached they are sorted and pushed to the background-vector-merger
+    This lookup-store looks like this:
     content: [KEY][RAW_READ]
     KEY... 64-bit value as SEQ_SPOT_ID shifted left by 1 bit, zero-bit contains SEQ_READ_ID
-    RAW_READ... 16-bit binary-chunk-lenght, followed by n bytes of packed 4na
+    RAW_READ... 32-bit base-count, followed by packed 2na and an optional N-mask ( dna_pack.h )
 -------------------------------------------------------------------------------------------- */
     /* the lookup-producer is the source of the chain */
     if ( 0 == rc ) {
@@ -560,11 +655,21 @@ static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
         args . cursor_cache = tool_ctx -> cursor_cache;
         args . buf_size = tool_ctx -> buf_size;
         args . mem_limit = tool_ctx -> mem_limit;
-        args . num_threads = tool_ctx -> num_threads;
+        args . num_threads = lookup_threads;
+        args . rows_per_slice = tool_ctx -> plan . lookup_rows_per_slice;
+        args . selection = tool_ctx -> selection;
         args . show_progress = tool_ctx -> show_progress;
         args . keep_tmp_files = tool_ctx -> keep_tmp_files;
 
+        perf_stage_begin( ps_lookup ); /* perf_report.c */
         rc = execute_lookup_production( &args ); /* sorter.c */
+        perf_stage_end( ps_lookup, align_row_count );
+        perf_stage_begin( ps_merge );
+        if ( 0 == rc && tool_ctx -> show_details ) {
+            uint64_t t_now = hlp_now_us();
+            plan_print_stage( "lookup", align_row_count, 0, t_now - t_start ); /* planner.c */
+            t_start = t_now;
+        }
     }
 
     if ( 1 == tool_ctx -> stop_after_step ) { return rc; }
@@ -582,11 +687,13 @@ static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
     }
 
     bg_update_release( gap );
+    perf_stage_end( ps_merge, align_row_count ); /* perf_report.c */
 
     if ( 0 == rc ) {
         if ( tool_ctx -> show_details ) {
             uint64_t lookup_size = ft_file_size( tool_ctx -> dir, tool_ctx -> lookup_filename );
             uint64_t index_size = ft_file_size( tool_ctx -> dir, tool_ctx -> index_filename );
+            plan_print_stage( "merge", 0, lookup_size, hlp_now_us() - t_start ); /* planner.c */
             KOutMsg( "lookup = %,lu bytes\nindex = %,lu bytes\n", lookup_size, index_size );
         }
     } else {
@@ -634,13 +741,23 @@ static rc_t main_produce_final_db_output( const tool_ctx_t * tool_ctx ) {
     args . registry= registry;
     args . cursor_cache = tool_ctx -> cursor_cache;
     args . buf_size = tool_ctx -> buf_size;
-    args . num_threads = tool_ctx -> num_threads;
+    args . num_threads = ( tool_ctx -> plan . join_threads > 0 )
+        ? tool_ctx -> plan . join_threads : tool_ctx -> num_threads;
+    args . rows_per_slice = tool_ctx -> plan . join_rows_per_slice;
     args . row_limit = tool_ctx -> row_limit;
+    args . selection = tool_ctx -> selection;
     args . show_progress = tool_ctx -> show_progress;
+    args . show_details = tool_ctx -> show_details;
     args . fmt = tool_ctx -> fmt;
 
     if ( rc == 0 ) {
+        uint64_t t_start = hlp_now_us(); /* helper.c */
+        perf_stage_begin( ps_join ); /* perf_report.c */
         rc = dbj_create_sorted_fastq_fasta( &args );
+        perf_stage_end( ps_join, stats . spots_read );
+        if ( 0 == rc && tool_ctx -> show_details ) {
+            plan_print_stage( "join", stats . spots_read, 0, hlp_now_us() - t_start ); /* planner.c */
+        }
     }
 
     /* from now on we do not need the lookup-file and it's index any more... */
@@ -654,6 +771,7 @@ static rc_t main_produce_final_db_output( const tool_ctx_t * tool_ctx ) {
 
     /* STEP 4 : concatenate output-chunks */
     if ( 0 == rc ) {
+        perf_stage_begin( ps_concat ); /* perf_report.c */
         if ( tool_ctx -> use_stdout ) {
             rc = temp_registry_to_stdout( registry,
                                           tool_ctx -> dir,
@@ -665,9 +783,11 @@ static rc_t main_produce_final_db_output( const tool_ctx_t * tool_ctx ) {
                               tool_ctx -> output_filename,
                               tool_ctx -> buf_size,
                               tool_ctx -> show_progress,
+                              tool_ctx -> show_details,
                               tool_ctx -> force,
                               tool_ctx -> append ); /* temp_registry.c */
         }
+        perf_stage_end( ps_concat, stats . reads_written );
     }
 
     /* in case some of the partial results have not been deleted be the concatenator */
@@ -706,7 +826,46 @@ static rc_t main_process_csra_fasta_unsorted( const tool_ctx_t * tool_ctx ) {
     args . only_unaligned = tool_ctx -> only_unaligned;
     args . only_aligned = tool_ctx -> only_aligned;
 
+    perf_stage_begin( ps_join ); /* perf_report.c */
     rc = dbj_create_unsorted_fasta( &args );
+    perf_stage_end( ps_join, stats . spots_read );
+
+    hlp_print_stats( &stats, rc );
+
+    return rc;
+}
+
+static rc_t main_process_csra_fastq_stream( const tool_ctx_t * tool_ctx ) {
+    rc_t rc;
+
+    join_stats_t stats; /* helper.h */
+    dbj_streaming_fastq_args_t args; /* db_join.h */
+
+    hlp_clear_join_stats( &stats );
+
+    args . dir = tool_ctx -> dir;
+    args . vdb_mgr = tool_ctx -> vdb_mgr;
+    args . accession_short = tool_ctx -> accession_short;
+    args . accession_path = tool_ctx -> accession_path;
+    args . output_filename = tool_ctx -> use_stdout ? NULL : tool_ctx -> output_filename;
+    args . seq_defline = tool_ctx -> seq_defline;
+    args . qual_defline = tool_ctx -> qual_defline;
+    args . stats = &stats;
+    args . insp_output = &( tool_ctx -> insp_output );
+    args . join_options = &( tool_ctx -> join_options );
+    args . cur_cache = tool_ctx -> cursor_cache;
+    args . buf_size = tool_ctx -> buf_size;
+    args . mem_limit = tool_ctx -> mem_limit;
+    args . num_threads = tool_ctx -> num_threads;
+    args . row_limit = tool_ctx -> row_limit;
+    args . show_progress = tool_ctx -> show_progress;
+    args . force = tool_ctx -> force;
+    args . only_unaligned = tool_ctx -> only_unaligned;
+    args . only_aligned = tool_ctx -> only_aligned;
+
+    perf_stage_begin( ps_join ); /* perf_report.c */
+    rc = dbj_create_streaming_fastq( &args );
+    perf_stage_end( ps_join, stats . spots_read );
 
     hlp_print_stats( &stats, rc );
 
@@ -724,15 +883,20 @@ static rc_t main_process_csra_fasta_concat( const tool_ctx_t * tool_ctx ) {
 static rc_t main_process_csra( const tool_ctx_t * tool_ctx ) {
     rc_t rc;
 
-    switch ( tool_ctx -> fmt ) { /* fmt defined in helper.h */
-        case ft_fasta_us_split_spot : rc = main_process_csra_fasta_unsorted( tool_ctx ); break;
-        case ft_fasta_concat : rc = main_process_csra_fasta_concat( tool_ctx ); break;
-        case ft_fasta_ref_tbl : rc = ref_inventory_print( tool_ctx ); break;
-        case ft_ref_report : rc = ref_inventory_print_report( tool_ctx ); break;
-        default : {
-            rc = main_produce_lookup_files( tool_ctx );
-            if ( 0 == rc && 0 == tool_ctx -> stop_after_step ) {
-                rc = main_produce_final_db_output( tool_ctx );
+    /* stream-mode: tool_ctx.c has already switched the format to ft_fastq_split_spot */
+    if ( tool_ctx -> stream && ft_fastq_split_spot == tool_ctx -> fmt ) {
+        rc = main_process_csra_fastq_stream( tool_ctx );
+    } else {
+        switch ( tool_ctx -> fmt ) { /* fmt defined in helper.h */
+            case ft_fasta_us_split_spot : rc = main_process_csra_fasta_unsorted( tool_ctx ); break;
+            case ft_fasta_concat : rc = main_process_csra_fasta_concat( tool_ctx ); break;
+            case ft_fasta_ref_tbl : rc = ref_inventory_print( tool_ctx ); break;
+            case ft_ref_report : rc = ref_inventory_print_report( tool_ctx ); break;
+            default : {
+                rc = main_produce_lookup_files( tool_ctx );
+                if ( 0 == rc && 0 == tool_ctx -> stop_after_step ) {
+                    rc = main_produce_final_db_output( tool_ctx );
+                }
             }
         }
     }
@@ -767,8 +931,11 @@ static rc_t main_process_table_in_seq_order( const tool_ctx_t * tool_ctx, const
         args . cmn . join_options = &( tool_ctx -> join_options );
         args . cmn . cursor_cache = tool_ctx -> cursor_cache;
         args . cmn . buf_size = tool_ctx -> buf_size;
-        args . cmn . num_threads = tool_ctx -> num_threads;
+        args . cmn . num_threads = ( tool_ctx -> plan . join_threads > 0 )
+            ? tool_ctx -> plan . join_threads : tool_ctx -> num_threads;
+        args . cmn . rows_per_slice = tool_ctx -> plan . join_rows_per_slice;
         args . cmn . row_limit = tool_ctx -> row_limit;
+        args . cmn . selection = tool_ctx -> selection;
         args . cmn . show_progress = tool_ctx -> show_progress;
         args . cmn . fmt = tool_ctx -> fmt;
 
@@ -776,10 +943,13 @@ static rc_t main_process_table_in_seq_order( const tool_ctx_t * tool_ctx, const
         args . temp_dir = tool_ctx -> temp_dir;
         args . registry = registry;
 
+        perf_stage_begin( ps_join ); /* perf_report.c */
         rc = execute_tbl_join( &args ); /* tbl_join.c */
+        perf_stage_end( ps_join, stats . spots_read );
     }
 
     if ( 0 == rc ) {
+        perf_stage_begin( ps_concat );
         if ( tool_ctx -> use_stdout ) {
             rc = temp_registry_to_stdout( registry,
                                         tool_ctx -> dir,
@@ -791,9 +961,11 @@ static rc_t main_process_table_in_seq_order( const tool_ctx_t * tool_ctx, const
                             tool_ctx -> output_filename,
                             tool_ctx -> buf_size,
                             tool_ctx -> show_progress,
+                            tool_ctx -> show_details,
                             tool_ctx -> force,
                             tool_ctx -> append ); /* temp_registry.c */
         }
+        perf_stage_end( ps_concat, stats . reads_written );
     }
 
     if ( NULL != registry ) {
@@ -823,8 +995,11 @@ static rc_t main_process_table_fasta_unsorted( const tool_ctx_t * tool_ctx, cons
     args . cmn . join_options = &( tool_ctx -> join_options );
     args . cmn . cursor_cache = tool_ctx -> cursor_cache;
     args . cmn . buf_size = tool_ctx -> buf_size;
-    args . cmn . num_threads = tool_ctx -> num_threads;
+    args . cmn . num_threads = ( tool_ctx -> plan . join_threads > 0 )
+        ? tool_ctx -> plan . join_threads : tool_ctx -> num_threads;
+    args . cmn . rows_per_slice = tool_ctx -> plan . join_rows_per_slice;
     args . cmn . row_limit = tool_ctx -> row_limit;
+    args . cmn . selection = tool_ctx -> selection;
     args . cmn . show_progress = tool_ctx -> show_progress;
     if ( acc_pacbio_native == tool_ctx -> insp_output . acc_type ) {
         args . cmn . fmt = ft_fasta_whole_spot;
@@ -835,7 +1010,9 @@ static rc_t main_process_table_fasta_unsorted( const tool_ctx_t * tool_ctx, cons
     args . output_filename = tool_ctx -> use_stdout ? NULL : tool_ctx -> output_filename;
     args . force = tool_ctx -> force;
 
+    perf_stage_begin( ps_join ); /* perf_report.c */
     rc = execute_unsorted_fasta_tbl_join( &args ); /* tbl_join.c */
+    perf_stage_end( ps_join, stats . spots_read );
 
     hlp_print_stats( &stats, rc );
 
@@ -924,9 +1101,16 @@ MAIN_DECL( argc, argv )
                 memset( &tool_ctx, 0, sizeof tool_ctx );
 
                 rc = main_get_user_input( &tool_ctx, args );
+                if ( 0 == rc && NULL != tool_ctx . perf_report ) {
+                    rc = perf_start( tool_ctx . perf_report,
+                                     tool_ctx . perf_interval,
+                                     tool_ctx . accession_path ); /* perf_report.c */
+                }
                 if ( 0 == rc ) {
+                    perf_stage_begin( ps_inspect ); /* perf_report.c */
                     rc = tctx_populate_and_call_inspector( &tool_ctx ); /* tool_ctx.c */
                     /* returns rc != 0 if inspection failed, because of check-mode */
+                    perf_stage_end( ps_inspect, tool_ctx . insp_output . seq . row_count );
                 }
 
                 /* for safety: */
@@ -977,6 +1161,10 @@ MAIN_DECL( argc, argv )
                                               break;
                     }
                 }
+                if ( NULL != tool_ctx . perf_report ) {
+                    rc_t rc2 = perf_finish( tool_ctx . num_threads, rc ); /* perf_report.c */
+                    rc = ( 0 == rc ) ? rc2 : rc;
+                }
                 rc = tctx_release( &tool_ctx, rc );
             }
         }
@@ -26,7 +26,7 @@
 
 #include "flex_printer.h"
 
-#include <string.h>     /* for strstr() */
+#include <string.h>     /* for strstr(), memmove() */
 
 #ifndef _h_klib_printf_
 #include <klib/printf.h>
@@ -44,32 +44,82 @@
 #include "var_fmt.h"
 #endif
 
+#ifndef _h_compressor_
+#include "compressor.h"
+#endif
+
+#ifndef _h_perf_report_
+#include "perf_report.h"
+#endif
+
+/* if the output is compressed: collect this much text, then write it as one gzip-member / zstd-frame */
+#define FLP_COMPRESS_BLOCK_SIZE ( 4 * 1024 * 1024 )
+
 typedef struct fwrap_t {
     struct KFile * f;
     uint64_t file_pos;
+    struct compressor_t * compressor;   /* NULL if not compressing */
+    SBuffer_t pending;                  /* uncompressed text, waiting for the compressor */
 } fwrap_t;
 
 void flp_initialize_args( flp_args_t * self,
                           KDirectory * dir,
                           struct temp_registry_t * registry,
                           const char * output_base,
-                          size_t buffer_size ) {
+                          size_t buffer_size,
+                          compress_t compress,
+                          uint32_t compress_level ) {
     self -> dir = dir;
     self -> registry = registry;
     self -> output_base = output_base;
     self -> buffer_size = buffer_size;
+    self -> compress = compress;
+    self -> compress_level = compress_level;
 }
 
-static void flp_release_fwrap( void * item, void * data ) {
-    if ( NULL != item ) {
-        fwrap_t * p = item;
-        if ( NULL != p -> f ) { ft_release_file( p -> f, "flp_release_fwrap()" ); }
-        free( item );
+/* compress what is pending and write it to the file */
+static rc_t flp_flush_fwrap( fwrap_t * self ) {
+    rc_t rc = 0;
+    if ( NULL != self -> compressor && self -> pending . S . len > 0 ) {
+        const char * out;
+        size_t out_len;
+        rc = compressor_run( self -> compressor, self -> pending . S . addr, self -> pending . S . len,
+                             &out, &out_len ); /* compressor.c */
+        if ( 0 != rc ) {
+            ErrMsg( "flp_flush_fwrap().compressor_run() -> %R", rc );
+        } else {
+            size_t num_writ;
+            rc = KFileWriteAll( self -> f, self -> file_pos, out, out_len, &num_writ );
+            if ( 0 != rc ) {
+                ErrMsg( "flp_flush_fwrap().KFileWriteAll() -> %R", rc );
+            } else {
+                self -> file_pos += num_writ;
+            }
+        }
+        clear_SBuffer( &( self -> pending ) ); /* sbuffer.c */
     }
+    return rc;
+}
+
+/* returns the rc of writing out what is still pending */
+static rc_t flp_release_fwrap( fwrap_t * p ) {
+    rc_t rc = 0;
+    if ( NULL != p ) {
+        if ( NULL != p -> f ) {
+            rc = flp_flush_fwrap( p ); /* above */
+            ft_release_file( p -> f, "flp_release_fwrap()" );
+            perf_add( pc_join_bytes_written, p -> file_pos ); /* perf_report.c */
+        }
+        release_compressor( p -> compressor ); /* compressor.c */
+        release_SBuffer( &( p -> pending ) ); /* sbuffer.c */
+        free( p );
+    }
+    return rc;
 }
 
 static fwrap_t * flp_create_fwrap_from_filename( KDirectory * dir,
-                                                 const char * filename, size_t buffer_size ) {
+                                                 const char * filename, size_t buffer_size,
+                                                 compress_t compress, uint32_t compress_level ) {
     fwrap_t * res = calloc( 1, sizeof * res );
     if ( NULL != res ) {
         struct KFile * f;
@@ -83,6 +133,17 @@ static fwrap_t * flp_create_fwrap_from_filename( KDirectory * dir,
             }
             res -> f = f;
         }
+        if ( 0 == rc && ct_none != compress && ct_unknown != compress ) {
+            rc = make_compressor( &( res -> compressor ), compress, compress_level ); /* compressor.c */
+            if ( 0 == rc ) {
+                rc = make_SBuffer( &( res -> pending ), FLP_COMPRESS_BLOCK_SIZE + 4096 ); /* sbuffer.c */
+            }
+            if ( 0 != rc ) {
+                ErrMsg( "flp_create_fwrap_from_filename( '%s' ) cannot create compressor -> %R", filename, rc );
+                flp_release_fwrap( res );
+                res = NULL;
+            }
+        }
     }
     return res;
 }
@@ -96,11 +157,12 @@ static fwrap_t * flp_create_fwrap( flp_args_t * file_args, uint32_t dst_id ) {
     if ( 0 != rc ) {
         ErrMsg( "make_join_printer().string_printf() -> %R", rc );
     } else {
-        res = flp_create_fwrap_from_filename( file_args -> dir, filename, file_args -> buffer_size );
+        res = flp_create_fwrap_from_filename( file_args -> dir, filename, file_args -> buffer_size,
+                                              file_args -> compress, file_args -> compress_level );
         if ( NULL != res ) {
             rc = register_temp_file( file_args -> registry, dst_id, filename );
             if ( 0 != rc ) {
-                flp_release_fwrap( res, NULL );
+                flp_release_fwrap( res );
                 res = NULL;
             }
         }
@@ -137,7 +199,8 @@ typedef struct flp_t {
 typedef enum string_data_index_t { sdi_acc = 0, sdi_sn = 1, sdi_sg = 2, sdi_rd1 = 3, sdi_rd2 = 4, sdi_qa = 5 } string_data_index_t;
 typedef enum int_data_index_t { idi_si = 0, idi_ri = 1, idi_rl = 2 } int_data_index_t;
 
-void flp_release( struct flp_t * self ) {
+rc_t flp_release( struct flp_t * self ) {
+    rc_t rc = 0;
     if ( NULL != self ) {
         release_SBuffer( &( self -> transaction_buffer ) );
         if ( NULL != self -> multi_writer && NULL != self -> block ) {
@@ -146,12 +209,20 @@ void flp_release( struct flp_t * self ) {
                 self -> block = NULL;
             }
         }
-        if ( NULL != self -> file_args ) {  VectorWhack ( &self -> printers, flp_release_fwrap, NULL ); }
+        if ( NULL != self -> file_args ) {
+            uint32_t idx, n = VectorLength( &self -> printers );
+            for ( idx = VectorStart( &self -> printers ); idx < n; ++idx ) {
+                rc_t rc1 = flp_release_fwrap( VectorGet( &self -> printers, idx ) ); /* above */
+                if ( 0 == rc ) { rc = rc1; }
+            }
+            VectorWhack ( &self -> printers, NULL, NULL );
+        }
         if ( NULL != self -> string_data[ sdi_acc ] ) StringWhack( self -> string_data[ 0 ] );
         if ( NULL != self -> fmt_v1 ) { vfmt_release( self -> fmt_v1 ); }
         if ( NULL != self -> fmt_v2 ) { vfmt_release( self -> fmt_v2 ); }
         free( ( void * )self );
     }
+    return rc;
 }
 
 static struct vfmt_desc_list_t * flp_make_vars( void ) {
@@ -344,9 +415,11 @@ static struct vfmt_t * flp_prepare_data( struct flp_t * self, const flp_data_t *
     return fmt;
 }
 
-/* submit a buffer to the multi-writer ( via a queue into a different thread! ) */
-static rc_t flp_submit_to_buffer( struct flp_t * self, SBuffer_t * t ) {
+/* room for size bytes in the current block of the multi-writer:
+   a full block is submitted ( via a queue into a different thread! ) and a new one is taken */
+static rc_t flp_reserve_in_block( struct flp_t * self, size_t size, char ** dst ) {
     rc_t rc = 0;
+    *dst = NULL;
     if ( NULL == self -> block ) {
         self -> block = mw_get_empty_block( self -> multi_writer );
     }
@@ -354,29 +427,30 @@ static rc_t flp_submit_to_buffer( struct flp_t * self, SBuffer_t * t ) {
         rc = RC( rcApp, rcNoTarg, rcConstructing, rcParam, rcInvalid );
         ErrMsg( "flex_submit() could not get block from multi-writer -> %R", rc );
     } else {
-        if ( t -> S . len > 0 ) {
-            if ( !mw_append_block( self -> block, t -> S. addr, t -> S . len ) ) {
-                /* block was not big enough to hold the new data : */
-                if ( !mw_submit_block( self -> multi_writer, self -> block ) ) {
+        *dst = mw_reserve_block( self -> block, size ); /* multi_writer.c */
+        if ( NULL == *dst ) {
+            /* block was not big enough to hold the new data : */
+            if ( !mw_submit_block( self -> multi_writer, self -> block ) ) {
+                rc = RC( rcApp, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+                ErrMsg( "flex_submit() cannot submit block to multi-writer -> %R", rc );
+            } else {
+                self -> block = mw_get_empty_block( self -> multi_writer );
+                if ( NULL == self -> block ) {
                     rc = RC( rcApp, rcNoTarg, rcConstructing, rcParam, rcInvalid );
-                    ErrMsg( "flex_submit() cannot submit block to multi-writer -> %R", rc );
+                    ErrMsg( "flex_submit() could not get block from multi-writer -> %R", rc );
                 } else {
-                    self -> block = mw_get_empty_block( self -> multi_writer );
-                    if ( NULL == self -> block ) {
-                        rc = RC( rcApp, rcNoTarg, rcConstructing, rcParam, rcInvalid );
-                        ErrMsg( "flex_submit() could not get block from multi-writer -> %R", rc );
-                    } else {
-                        if ( !mw_append_block( self -> block, t -> S. addr, t -> S . len ) ) {
-                            /* oops the data does not fit into an new, empty block... */
-                            size_t needed = t -> S . len + 1;
-                            if ( ! mw_expand_block( self -> block, needed ) ) /* copy_machine.c */ {
+                    *dst = mw_reserve_block( self -> block, size ); /* multi_writer.c */
+                    if ( NULL == *dst ) {
+                        /* oops the data does not fit into an new, empty block... */
+                        size_t needed = size + 1;
+                        if ( ! mw_expand_block( self -> block, needed ) ) /* multi_writer.c */ {
+                            rc = RC( rcApp, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+                            ErrMsg( "flex_submit() could not expand block from multi-writer to %u -> %R", needed, rc );
+                        } else {
+                            *dst = mw_reserve_block( self -> block, size ); /* multi_writer.c */
+                            if ( NULL == *dst ) {
                                 rc = RC( rcApp, rcNoTarg, rcConstructing, rcParam, rcInvalid );
-                                ErrMsg( "flex_submit() could not expand block from multi-writer to %u -> %R", needed, rc );
-                            } else {
-                                if ( !mw_append_block( self -> block, t -> S. addr, t -> S . len ) ) {
-                                    rc = RC( rcApp, rcNoTarg, rcConstructing, rcParam, rcInvalid );
-                                    ErrMsg( "flex_submit() still cannot append block to multi-writer -> %R", rc );
-                                }
+                                ErrMsg( "flex_submit() still cannot append block to multi-writer -> %R", rc );
                             }
                         }
                     }
@@ -387,6 +461,34 @@ static rc_t flp_submit_to_buffer( struct flp_t * self, SBuffer_t * t ) {
     return rc;
 }
 
+/* submit a buffer to the multi-writer */
+static rc_t flp_submit_to_buffer( struct flp_t * self, SBuffer_t * t ) {
+    rc_t rc = 0;
+    if ( t -> S . len > 0 ) {
+        char * dst;
+        rc = flp_reserve_in_block( self, t -> S . len, &dst ); /* above */
+        if ( 0 == rc ) {
+            memmove( dst, t -> S . addr, t -> S . len );
+            mw_commit_block( self -> block, t -> S . len ); /* multi_writer.c */
+        }
+    }
+    return rc;
+}
+
+/* render the record directly into the block of the multi-writer: one bounded write, no copy */
+static rc_t flp_render_to_block( struct flp_t * self, const struct vfmt_t * fmt ) {
+    size_t max_len = vfmt_max_len( fmt, self -> string_data, sdi_qa + 1 ); /* var_fmt.c */
+    char * dst;
+    rc_t rc = flp_reserve_in_block( self, max_len, &dst ); /* above */
+    if ( 0 == rc ) {
+        size_t written = vfmt_render( fmt, dst,
+                                      self -> string_data, sdi_qa + 1,
+                                      self -> int_data, idi_rl + 1 ); /* var_fmt.c */
+        mw_commit_block( self -> block, written ); /* multi_writer.c */
+    }
+    return rc;
+}
+
 rc_t flp_print( struct flp_t * self, const flp_data_t * data ) {
     rc_t rc = 0;
     if ( NULL == self || data == NULL ) {
@@ -399,7 +501,17 @@ rc_t flp_print( struct flp_t * self, const flp_data_t * data ) {
             /* we are in file-per-read-id--mode */
             fwrap_t * printer = flp_get_or_create_fwrap( &( self -> printers ),
                                                   data -> dst_id, self -> file_args ); /* above */
-            if ( NULL != printer ) {
+            if ( NULL != printer && NULL != printer -> compressor ) {
+                /* collect the text, compress it in big blocks */
+                rc = vfmt_append_to_buffer( fmt, &( printer -> pending ),
+                                            self -> string_data, sdi_qa + 1,
+                                            self -> int_data, idi_rl + 1 ); /* var_fmt.c */
+                if ( 0 != rc ) {
+                    ErrMsg( "flex_print() cannot format data into buffer -> %R", rc );
+                } else if ( printer -> pending . S . len >= FLP_COMPRESS_BLOCK_SIZE ) {
+                    rc = flp_flush_fwrap( printer ); /* above */
+                }
+            } else if ( NULL != printer ) {
                 rc = vfmt_print_to_file( fmt,
                                     printer -> f, &( printer -> file_pos ),
                                     self -> string_data, sdi_qa + 1,
@@ -409,20 +521,67 @@ rc_t flp_print( struct flp_t * self, const flp_data_t * data ) {
                 ErrMsg( "flex_print() cannot create printer -> %R", rc );
             }
         } else if ( NULL != self -> multi_writer ) {
-            /* we are in multi-writer-mode :
-             * the return value is not allocated every-time, it is a reference to a buffer
-             * enclosed in fmt...
-             */
-            SBuffer_t * t = vfmt_write_to_buffer( fmt,
-                                               self -> string_data, sdi_qa + 1,
-                                               self -> int_data, idi_rl + 1 ); /* var_fmt.c */
-            if ( NULL != t ) {
-                rc = flp_submit_to_buffer( self, t ); /* above */
+            /* we are in multi-writer-mode */
+            if ( self -> in_transaction ) {
+                /* collect until flp_commit_transaction() */
+                rc = vfmt_append_to_buffer( fmt, &( self -> transaction_buffer ),
+                                            self -> string_data, sdi_qa + 1,
+                                            self -> int_data, idi_rl + 1 ); /* var_fmt.c */
             } else {
-                rc = RC( rcApp, rcNoTarg, rcConstructing, rcParam, rcNull );
+                rc = flp_render_to_block( self, fmt ); /* above */
+            }
+            if ( 0 != rc ) {
                 ErrMsg( "flex_print() cannot format data into buffer -> %R", rc );
             }
        }
     }
     return rc;
 }
+
+rc_t flp_begin_transaction( struct flp_t * self ) {
+    rc_t rc = 0;
+    if ( NULL == self ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcSelf, rcNull );
+        ErrMsg( "flp_begin_transaction() -> %R", rc );
+    } else if ( self -> in_transaction ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcState, rcBusy );
+        ErrMsg( "flp_begin_transaction() already in transaction -> %R", rc );
+    } else {
+        rc = clear_SBuffer( &( self -> transaction_buffer ) ); /* sbuffer.c */
+        self -> in_transaction = ( 0 == rc );
+    }
+    return rc;
+}
+
+rc_t flp_commit_transaction( struct flp_t * self ) {
+    rc_t rc = 0;
+    if ( NULL == self ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcSelf, rcNull );
+        ErrMsg( "flp_commit_transaction() -> %R", rc );
+    } else if ( !self -> in_transaction ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcState, rcInvalid );
+        ErrMsg( "flp_commit_transaction() not in transaction -> %R", rc );
+    } else {
+        self -> in_transaction = false;
+        if ( NULL != self -> multi_writer ) {
+            rc = flp_submit_to_buffer( self, &( self -> transaction_buffer ) ); /* above */
+        }
+        clear_SBuffer( &( self -> transaction_buffer ) ); /* sbuffer.c */
+    }
+    return rc;
+}
+
+rc_t flp_abort_transaction( struct flp_t * self ) {
+    rc_t rc = 0;
+    if ( NULL == self ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcSelf, rcNull );
+        ErrMsg( "flp_abort_transaction() -> %R", rc );
+    } else if ( !self -> in_transaction ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcState, rcInvalid );
+        ErrMsg( "flp_abort_transaction() not in transaction -> %R", rc );
+    } else {
+        self -> in_transaction = false;
+        rc = clear_SBuffer( &( self -> transaction_buffer ) ); /* sbuffer.c */
+    }
+    return rc;
+}
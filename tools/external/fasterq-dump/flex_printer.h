@@ -75,13 +75,17 @@ typedef struct flp_args_t {
     struct temp_registry_t * registry;
     const char * output_base;
     size_t buffer_size;
+    compress_t compress;        /* helper.h, each file is written as compressed blocks */
+    uint32_t compress_level;
 } flp_args_t;
 
 void flp_initialize_args( flp_args_t * self,
                           KDirectory * dir,
                           struct temp_registry_t * registry,
                           const char * output_base,
-                          size_t buffer_size );
+                          size_t buffer_size,
+                          compress_t compress,
+                          uint32_t compress_level );
 
 /* ---------------------------------------------------------------------------------------------------
     accession       ... used in both modes for filling into the flexible defline
@@ -104,7 +108,8 @@ struct flp_t * flp_create_2( struct multi_writer_t * multi_writer,
                         const char * qual_defline,
                         bool fasta );
 
-void flp_release( struct flp_t * self );
+/* returns the rc of flushing the per-read-id files ( if any ) */
+rc_t flp_release( struct flp_t * self );
 
 /* depending on the data:
     quality == NULL ... fasta / fastq
@@ -112,6 +117,15 @@ void flp_release( struct flp_t * self );
  */
 rc_t flp_print( struct flp_t * self, const flp_data_t * data );
 
+/* in multi-writer-mode: everything printed between begin and commit lands in the output
+   as one piece, other threads cannot interleave ( used to keep mates together ).
+   in file-per-read-id-mode the transaction has no effect */
+rc_t flp_begin_transaction( struct flp_t * self );
+rc_t flp_commit_transaction( struct flp_t * self );
+
+/* ends the transaction, everything collected since flp_begin_transaction() is dropped */
+rc_t flp_abort_transaction( struct flp_t * self );
+
 #ifdef __cplusplus
 }
 #endif
@@ -293,6 +293,80 @@ const char * hlp_check_mode_2_string( check_mode_t cm ) {
 
 /* -------------------------------------------------------------------------------- */
 
+static compress_t compress_cmp( const String * Compress, const char * test, compress_t test_ct ) {
+    String STestCompress;
+    StringInitCString( &STestCompress, test );
+    if ( 0 == StringCaseCompare ( Compress, &STestCompress ) )  {
+        return test_ct;
+    }
+    return ct_unknown;
+}
+
+compress_t hlp_get_compress_t( const char * compress ) {
+    compress_t res = ct_none;
+    if ( NULL != compress ) {
+        String Compress;
+        StringInitCString( &Compress, compress );
+
+        res = compress_cmp( &Compress, "none", ct_none );
+        if ( ct_unknown == res ) {
+            res = compress_cmp( &Compress, "gzip", ct_gzip );
+        }
+        if ( ct_unknown == res ) {
+            res = compress_cmp( &Compress, "gz", ct_gzip );
+        }
+        if ( ct_unknown == res ) {
+            res = compress_cmp( &Compress, "zstd", ct_zstd );
+        }
+    }
+    return res;
+}
+
+static const char * CT_UNKNOWN  = "unknown";
+static const char * CT_NONE     = "none";
+static const char * CT_GZIP     = "gzip";
+static const char * CT_ZSTD     = "zstd";
+
+const char * hlp_compress_2_string( compress_t ct ) {
+    const char * res = CT_UNKNOWN;
+    switch ( ct ) {
+        case ct_unknown : res = CT_UNKNOWN; break;
+        case ct_none    : res = CT_NONE; break;
+        case ct_gzip    : res = CT_GZIP; break;
+        case ct_zstd    : res = CT_ZSTD; break;
+    }
+    return res;
+}
+
+const char * hlp_compress_ext( compress_t ct ) {
+    const char * res = "";
+    switch ( ct ) {
+        case ct_gzip    : res = ".gz"; break;
+        case ct_zstd    : res = ".zst"; break;
+        default         : break;
+    }
+    return res;
+}
+
+/* compressed output may contain 0-bytes: bypass the formatting of KOutMsg() */
+rc_t hlp_write_to_stdout( const char * src, size_t len ) {
+    rc_t rc = 0;
+    KWrtWriter writer = KOutWriterGet();
+    void * writer_data = KOutDataGet();
+    while ( 0 == rc && len > 0 ) {
+        size_t num_writ = 0;
+        rc = writer( writer_data, src, len, &num_writ );
+        if ( 0 == rc && 0 == num_writ ) {
+            rc = RC( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+        }
+        src += num_writ;
+        len -= num_writ;
+    }
+    return rc;
+}
+
+/* -------------------------------------------------------------------------------- */
+
 static atomic32_t quit_flag;
 
 rc_t hlp_get_quitting( void ) {
@@ -316,6 +390,8 @@ void hlp_correct_join_options( join_options_t * dst, const join_options_t * src,
     dst -> print_spotgroup = src -> print_spotgroup;
     dst -> min_read_len = src -> min_read_len;
     dst -> filter_bases = src -> filter_bases;
+    dst -> compress = src -> compress;
+    dst -> compress_level = src -> compress_level;
 }
 
 /* -------------------------------------------------------------------------------- */
@@ -457,6 +533,8 @@ void hlp_clear_join_stats( join_stats_t * stats ) {
         stats -> reads_technical = 0;
         stats -> reads_too_short = 0;
         stats -> reads_invalid = 0;
+        stats -> mates_paired = 0;
+        stats -> mates_split = 0;
     }
 }
 
@@ -470,6 +548,8 @@ void hlp_add_join_stats( join_stats_t * stats, const join_stats_t * to_add ) {
         stats -> reads_technical += to_add -> reads_technical;
         stats -> reads_too_short += to_add -> reads_too_short;
         stats -> reads_invalid += to_add -> reads_invalid;
+        stats -> mates_paired += to_add -> mates_paired;
+        stats -> mates_split += to_add -> mates_split;
     }
 }
 
@@ -494,6 +574,12 @@ rc_t hlp_print_stats( const join_stats_t * stats, rc_t rc_in ) {
     if ( 0 == rc && stats -> reads_invalid > 0 ) {
         rc = KOutMsg( "reads invalid   : %,lu\n", stats -> reads_invalid );
     }
+    if ( 0 == rc && stats -> mates_paired > 0 ) {
+        rc = KOutMsg( "mates paired    : %,lu\n", stats -> mates_paired );
+    }
+    if ( 0 == rc && stats -> mates_split > 0 ) {
+        rc = KOutMsg( "mates split     : %,lu\n", stats -> mates_split );
+    }
     KOutHandlerSetStdOut();
     return rc;
 }
@@ -686,6 +772,23 @@ uint64_t hlp_calculate_rows_per_thread( uint32_t * num_threads, uint64_t row_cou
     return res;
 }
 
+uint64_t hlp_calculate_rows_per_slice( uint32_t * num_threads, uint64_t row_count, uint64_t rows_per_slice ) {
+    uint64_t res;
+    if ( 0 == rows_per_slice ) {
+        res = hlp_calculate_rows_per_thread( num_threads, row_count );
+    } else {
+        uint64_t slices = ( row_count + rows_per_slice - 1 ) / rows_per_slice;
+        res = rows_per_slice;
+        if ( slices < *num_threads ) { *num_threads = ( uint32_t )slices; }
+        if ( 0 == *num_threads ) { *num_threads = 1; }
+        if ( ( uint64_t )( *num_threads ) * res < row_count ) {
+            /* fewer threads than planned: the slices have to grow */
+            res = hlp_calculate_rows_per_thread( num_threads, row_count );
+        }
+    }
+    return res;
+}
+
 /* -------------------------------------------------------------------------------- */
 
 void hlp_unread_rc_info( bool show ) {
@@ -736,3 +839,24 @@ bool hlp_paths_on_same_filesystem( const char * path1, const char * path2 ) {
 #endif
     return true; /* assume they are the same */
 }
+
+/* -------------------------------------------------------------------------------- */
+
+#ifdef WINDOWS
+#ifndef _h_klib_time_
+#include <klib/time.h>
+#endif
+#else
+#include <time.h>
+#endif
+
+uint64_t hlp_now_us( void ) {
+#ifdef WINDOWS
+    /* only millisecond-resolution available here */
+    return ( uint64_t )KTimeMsStamp() * 1000;
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( ( uint64_t )ts . tv_sec * 1000000 ) + ( ts . tv_nsec / 1000 );
+#endif
+}
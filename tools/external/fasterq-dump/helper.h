@@ -87,8 +87,14 @@ typedef struct join_stats
     uint64_t reads_technical;
     uint64_t reads_too_short;
     uint64_t reads_invalid;
+    uint64_t mates_paired;      /* streaming-mode: mate-pairs printed next to each other */
+    uint64_t mates_split;       /* streaming-mode: reads whose mate was not found in the mate-cache */
 } join_stats_t;
 
+typedef enum compress_t {
+    ct_unknown, ct_none, ct_gzip, ct_zstd
+    } compress_t;
+
 typedef struct join_options
 {
     bool rowid_as_name;
@@ -96,6 +102,8 @@ typedef struct join_options
     bool print_spotgroup;
     uint32_t min_read_len;
     const char * filter_bases;
+    compress_t compress;        /* compress the output-blocks, compressor.h */
+    uint32_t compress_level;    /* 0 ... default level of the compressor */
 } join_options_t;
 
 /* -------------------------------------------------------------------------------- */
@@ -145,6 +153,17 @@ const char * hlp_check_mode_2_string( check_mode_t cm );
 
 /* -------------------------------------------------------------------------------- */
 
+compress_t hlp_get_compress_t( const char * compress );
+
+const char * hlp_compress_2_string( compress_t ct );
+
+/* the extension to be appended to the output-filename: "" / ".gz" / ".zst" */
+const char * hlp_compress_ext( compress_t ct );
+
+rc_t hlp_write_to_stdout( const char * src, size_t len );
+
+/* -------------------------------------------------------------------------------- */
+
 rc_t Quitting(); /* to avoid including kapp/main.h */
 rc_t hlp_get_quitting( void );
 void hlp_set_quitting( void );
@@ -201,6 +220,10 @@ rc_t hlp_make_thread( KThread ** self,
 rc_t hlp_join_and_release_threads( Vector * threads );
 uint64_t hlp_calculate_rows_per_thread( uint32_t * num_threads, uint64_t row_count );
 
+/* rows_per_slice as planned ( planner.h ): not more threads than there are slices,
+   0 == rows_per_slice ... the same as hlp_calculate_rows_per_thread() */
+uint64_t hlp_calculate_rows_per_slice( uint32_t * num_threads, uint64_t row_count, uint64_t rows_per_slice );
+
 /* -------------------------------------------------------------------------------- */
 
 void hlp_unread_rc_info( bool show );
@@ -214,6 +237,11 @@ void hlp_init_qual_to_ascii_lut( char * lut, size_t size );
 /* returns 0 if the id cannot be found ( for instance on none-posix systems ) */
 bool hlp_paths_on_same_filesystem( const char * path1, const char * path2 );
 
+/* -------------------------------------------------------------------------------- */
+
+/* monotonic timestamp in micro-seconds, for measuring durations */
+uint64_t hlp_now_us( void );
+
 #ifdef __cplusplus
 }
 #endif
@@ -39,6 +39,10 @@
 #include <kfs/buffile.h>
 #endif
 
+#ifndef _h_kfs_mmap_
+#include <kfs/mmap.h>
+#endif
+
 typedef struct index_writer_t {
     struct KFile * f;
     uint64_t frequency, pos, last_key;
@@ -150,13 +154,23 @@ rc_t make_index_writer( KDirectory * dir, struct index_writer_t ** writer,
 
 /* ----------------------------------------------------------------------- */
 
+typedef struct index_entry_t {
+    uint64_t key;
+    uint64_t offset;
+} index_entry_t;
+
 typedef struct index_reader_t {
     const struct KFile * f;
+    const struct KMMap * mm;        /* NULL if the index-file could not be mapped */
+    const index_entry_t * entries;  /* points into the mapped file */
     uint64_t frequency, file_size, max_key;
 } index_reader_t;
 
 void release_index_reader( index_reader_t * reader ) {
     if ( NULL != reader ) {
+        if ( NULL != reader -> mm ) {
+            KMMapRelease( reader -> mm );
+        }
         if ( NULL != reader -> f ) {
             ft_release_file( reader -> f, "make_index_reader()" );
         }
@@ -172,11 +186,6 @@ static rc_t read_value( const index_reader_t * reader, uint64_t pos, uint64_t *
     return rc;
 }
 
-typedef struct index_entry_t {
-    uint64_t key;
-    uint64_t offset;
-} index_entry_t;
-
 static rc_t read_entry( const index_reader_t * reader, uint64_t entry_idx,
                         index_entry_t * entry, uint32_t count ) {
     uint64_t pos = sizeof reader -> frequency;
@@ -216,6 +225,51 @@ static rc_t make_index_reader_obj( index_reader_t ** reader,
     return rc;
 }
 
+/* the index-file is small and read randomly by every join-thread:
+   we try to map it into memory, if that fails we fall back to reading it via KFile */
+static rc_t map_index_reader_obj( index_reader_t ** reader,
+                                  const struct KFile * f,
+                                  const struct KMMap * mm ) {
+    rc_t rc = 0;
+    index_reader_t * r = calloc( 1, sizeof * r );
+    if ( NULL == r ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        ErrMsg( "index.c map_index_reader_obj().calloc( %d ) -> %R", ( sizeof * r ), rc );
+    } else {
+        const void * addr;
+        size_t size;
+        r -> f = f;
+        r -> mm = mm;
+        rc = KMMapAddrRead( mm, &addr );
+        if ( 0 != rc ) {
+            ErrMsg( "index.c map_index_reader_obj().KMMapAddrRead() -> %R", rc );
+        } else {
+            rc = KMMapSize( mm, &size );
+            if ( 0 != rc ) {
+                ErrMsg( "index.c map_index_reader_obj().KMMapSize() -> %R", rc );
+            } else if ( size < ( sizeof r -> frequency ) ) {
+                rc = RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+                ErrMsg( "index.c map_index_reader_obj() - index file has invalid size of %lu", size );
+            }
+        }
+        if ( 0 == rc ) {
+            const uint8_t * base = addr;
+            r -> frequency = *( ( const uint64_t * )base );
+            r -> file_size = size;
+            r -> entries = ( const index_entry_t * )( base + sizeof r -> frequency );
+            /* the last sampled key is not the last key in the lookup-file, with the
+               index in memory we can always start from the last entry: no upper limit */
+            r -> max_key = 0;
+            *reader = r;
+        } else {
+            r -> f = NULL;
+            r -> mm = NULL;
+            release_index_reader( r );
+        }
+    }
+    return rc;
+}
+
 rc_t make_index_reader( const KDirectory * dir, index_reader_t ** reader,
                         size_t buf_size, const char * fmt, ... ) {
     rc_t rc;
@@ -230,18 +284,28 @@ rc_t make_index_reader( const KDirectory * dir, index_reader_t ** reader,
     if ( 0 != rc ) {
         ErrMsg( "index.c make_index_reader() KDirectoryVOpenFileRead() -> %R", rc );
     } else {
-        if ( buf_size > 0 ) {
-            const struct KFile * temp_file;
-            rc = KBufFileMakeRead( &temp_file, f, buf_size );
-            if ( 0 != rc ) {
-                ErrMsg( "index.c make_index_reader() KBufFileMakeRead() -> %R", rc );
-            } else {
-                rc = ft_release_file( f, "make_index_reader()" );
-                f = temp_file;
+        const struct KMMap * mm = NULL;
+        bool mapped = false;
+        if ( 0 == KMMapMakeRead( &mm, f ) ) {
+            mapped = ( 0 == map_index_reader_obj( reader, f, mm ) );
+            if ( !mapped ) {
+                KMMapRelease( mm );
             }
         }
-        if ( 0 == rc ) {
-            rc = make_index_reader_obj( reader, f );
+        if ( !mapped ) {
+            if ( buf_size > 0 ) {
+                const struct KFile * temp_file;
+                rc = KBufFileMakeRead( &temp_file, f, buf_size );
+                if ( 0 != rc ) {
+                    ErrMsg( "index.c make_index_reader() KBufFileMakeRead() -> %R", rc );
+                } else {
+                    rc = ft_release_file( f, "make_index_reader()" );
+                    f = temp_file;
+                }
+            }
+            if ( 0 == rc ) {
+                rc = make_index_reader_obj( reader, f );
+            }
         }
     }
     return rc;
@@ -322,6 +386,34 @@ static rc_t nearest_offset_binary_search( const index_reader_t * self,
     return rc;
 }
 
+/* the mapped index: find the last entry with a key not greater than key_to_find
+   ( in O(log n) without any file-io ), keys beyond the last entry map to the last entry */
+static rc_t nearest_offset_mapped_search( const index_reader_t * self,
+                         uint64_t key_to_find,
+                         uint64_t * key_found,
+                         uint64_t * offset,
+                         uint64_t entry_count ) {
+    rc_t rc = 0;
+    uint64_t lower_bound = 0;
+    uint64_t upper_bound = entry_count;
+    while ( lower_bound < upper_bound ) {
+        uint64_t entry_idx = lower_bound + ( ( upper_bound - lower_bound ) / 2 );
+        if ( self -> entries[ entry_idx ] . key <= key_to_find ) {
+            lower_bound = entry_idx + 1;
+        } else {
+            upper_bound = entry_idx;
+        }
+    }
+    if ( 0 == lower_bound ) {
+        /* key_to_find is smaller than the first key in the index */
+        rc = SILENT_RC( rcVDB, rcNoTarg, rcReading, rcId, rcNotFound );
+    } else {
+        *key_found = self -> entries[ lower_bound - 1 ] . key;
+        *offset = self -> entries[ lower_bound - 1 ] . offset;
+    }
+    return rc;
+}
+
 /* the caller is in lookup_reader.c indexed_seek() - it only searches forward from the
    key_found/offset position!!! */
 rc_t get_nearest_offset( const index_reader_t * self,
@@ -337,6 +429,8 @@ rc_t get_nearest_offset( const index_reader_t * self,
         if ( 0 == entry_count ) {
             rc = RC( rcVDB, rcNoTarg, rcReading, rcParam, rcTooShort );
             ErrMsg( "index.c get_nearest_offset( entry_count == 0 ) -> %R", rc );
+        } else if ( NULL != self -> entries ) {
+            rc = nearest_offset_mapped_search( self, key_to_find, key_found, offset, entry_count );
         } else if ( key_to_find > self -> max_key ) {
             rc = RC( rcVDB, rcNoTarg, rcReading, rcParam, rcIncorrect );
             ErrMsg( "index.c get_nearest_offset( key_to_find > max_key ) -> %R", rc );
@@ -357,7 +451,7 @@ rc_t get_max_key( const index_reader_t * self, uint64_t * max_key ) {
     if ( NULL == self || NULL == max_key ) {
         rc = RC( rcVDB, rcNoTarg, rcReading, rcParam, rcInvalid );
         ErrMsg( "index.c get_max_key() -> %R", rc );
-    } else if ( self -> max_key > 0 ) {
+    } else if ( self -> max_key > 0 || NULL != self -> entries ) {
         *max_key = self -> max_key;
     } else {
         uint64_t data[ 6 ];
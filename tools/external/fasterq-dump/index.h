@@ -43,7 +43,10 @@ extern "C" {
 #include <kfs/directory.h>
 #endif
 
+/* the distance in keys between 2 entries of the index, a key is (spot-id << 1) | read-bit,
+   can be overwritten with the --index-stride option */
 #define DFLT_INDEX_FREQUENCY 20000
+#define MIN_INDEX_FREQUENCY 64
 
 struct index_writer_t;
 
@@ -39,19 +39,33 @@
 #include "file_tools.h"
 #endif
 
+#ifndef _h_dna_pack_
+#include "dna_pack.h"
+#endif
+
 #ifndef _h_kfs_buffile_
 #include <kfs/buffile.h>
 #endif
 
+#ifndef _h_kfs_mmap_
+#include <kfs/mmap.h>
+#endif
+
 typedef struct lookup_reader_t {
     const struct KFile * f;
+    const struct KMMap * mm;        /* NULL if the file is read via KFile */
+    const uint8_t * base;           /* start of the mapped file */
     const struct index_reader_t * index;
     SBuffer_t buf;
+    lookup_seek_stats_t seek_stats;
     uint64_t pos, f_size, max_key;
 } lookup_reader_t;
 
 void release_lookup_reader( struct lookup_reader_t * self ) {
     if ( NULL != self ) {
+        if ( NULL != self -> mm ) {
+            KMMapRelease( self -> mm );
+        }
         if ( NULL != self -> f ) {
             ft_release_file( self -> f, "release_lookup_reader()" );
         }
@@ -60,9 +74,29 @@ void release_lookup_reader( struct lookup_reader_t * self ) {
     }
 }
 
+static rc_t map_lookup_reader_obj( struct lookup_reader_t * r ) {
+    const void * addr;
+    size_t size;
+    rc_t rc = KMMapAddrRead( r -> mm, &addr );
+    if ( 0 != rc ) {
+        ErrMsg( "map_lookup_reader_obj().KMMapAddrRead() -> %R", rc );
+    } else {
+        rc = KMMapSize( r -> mm, &size );
+        if ( 0 != rc ) {
+            ErrMsg( "map_lookup_reader_obj().KMMapSize() -> %R", rc );
+        } else {
+            r -> base = addr;
+            r -> f_size = size;
+            r -> seek_stats . mapped = true;
+        }
+    }
+    return rc;
+}
+
 static rc_t make_lookup_reader_obj( struct lookup_reader_t ** reader,
                                     const struct index_reader_t * index,
-                                    const struct KFile * f ) {
+                                    const struct KFile * f,
+                                    const struct KMMap * mm ) {
     rc_t rc = 0;
     lookup_reader_t * r = calloc( 1, sizeof * r );
     if ( NULL == r ) {
@@ -70,12 +104,18 @@ static rc_t make_lookup_reader_obj( struct lookup_reader_t ** reader,
         ErrMsg( "make_lookup_reader_obj().calloc( %d ) -> %R", ( sizeof * r ), rc );
     } else {
         r -> f = f;
+        r -> mm = mm;
         r -> index = index;
-        rc = KFileSize( f, & r -> f_size );
+        if ( NULL != mm ) {
+            rc = map_lookup_reader_obj( r ); /* above */
+        } else {
+            rc = KFileSize( f, & r -> f_size );
+            if ( 0 != rc ) {
+                ErrMsg( "make_lookup_reader_obj().KFileSize() -> %R", rc );
+            }
+        }
         if ( 0 == rc ) {
             rc = make_SBuffer( &( r -> buf ), 4096 ); /* helper.c */
-        } else {
-            ErrMsg( "make_lookup_reader_obj().KFileSize() -> %R", rc );
         }
 
         if ( 0 == rc && NULL != index ) {
@@ -91,20 +131,21 @@ static rc_t make_lookup_reader_obj( struct lookup_reader_t ** reader,
     return rc;
 }
 
-rc_t make_lookup_reader( const KDirectory *dir, const struct index_reader_t * index,
-                         struct lookup_reader_t ** reader, size_t buf_size, const char * fmt, ... ) {
-    rc_t rc;
+static rc_t make_lookup_reader_v( const KDirectory *dir, const struct index_reader_t * index,
+                         struct lookup_reader_t ** reader, size_t buf_size, bool mapped,
+                         const char * fmt, va_list args ) {
     const struct KFile * f = NULL;
-
-    va_list args;
-    va_start ( args, fmt );
-    rc = KDirectoryVOpenFileRead( dir, &f, fmt, args );
-    va_end ( args );
-
+    rc_t rc = KDirectoryVOpenFileRead( dir, &f, fmt, args );
     if ( 0 != rc ) {
         ErrMsg( "make_lookup_reader().KDirectoryVOpenFileRead( '?' ) -> %R",  rc );
     } else {
-        if ( buf_size > 0 ) {
+        const struct KMMap * mm = NULL;
+        if ( mapped && 0 != KMMapMakeRead( &mm, f ) ) {
+            mm = NULL; /* not mappable: fall back to reading via KFile */
+        }
+        if ( NULL != mm ) {
+            rc = make_lookup_reader_obj( reader, index, f, mm );
+        } else if ( buf_size > 0 ) {
             const struct KFile * temp_file = NULL;
             rc = KBufFileMakeRead( &temp_file, f, buf_size );
             if ( 0 != rc ) {
@@ -114,18 +155,54 @@ rc_t make_lookup_reader( const KDirectory *dir, const struct index_reader_t * in
                 if ( 0 == rc ) { f = temp_file; }
             }
         }
-        if ( 0 == rc ) {
-            rc = make_lookup_reader_obj( reader, index, f );
+        if ( 0 == rc && NULL == mm ) {
+            rc = make_lookup_reader_obj( reader, index, f, NULL );
         }
     }
     return rc;
 }
 
+rc_t make_lookup_reader( const KDirectory *dir, const struct index_reader_t * index,
+                         struct lookup_reader_t ** reader, size_t buf_size, const char * fmt, ... ) {
+    rc_t rc;
+    va_list args;
+    va_start ( args, fmt );
+    rc = make_lookup_reader_v( dir, index, reader, buf_size, false, fmt, args );
+    va_end ( args );
+    return rc;
+}
+
+rc_t make_mapped_lookup_reader( const KDirectory *dir, const struct index_reader_t * index,
+                         struct lookup_reader_t ** reader, size_t buf_size, const char * fmt, ... ) {
+    rc_t rc;
+    va_list args;
+    va_start ( args, fmt );
+    rc = make_lookup_reader_v( dir, index, reader, buf_size, true, fmt, args );
+    va_end ( args );
+    return rc;
+}
+
+/* the mapped reader: copy what is available at pos, in the same way KFileReadAll() does */
+static size_t read_mapped( const struct lookup_reader_t * self, uint64_t pos, void * dst, size_t to_read ) {
+    size_t res = 0;
+    if ( pos < self -> f_size ) {
+        uint64_t available = self -> f_size - pos;
+        res = ( available < to_read ) ? ( size_t )available : to_read;
+        memmove( dst, self -> base + pos, res );
+    }
+    return res;
+}
+
 static rc_t read_key_and_len( struct lookup_reader_t * self, uint64_t pos, uint64_t *key, size_t *len ) {
     size_t num_read;
     /*const size_t buffer_size = sizeof( *key ) + sizeof( dna_len_t );*/
     uint8_t buffer[ sizeof( *key ) + sizeof( dna_len_t ) ];
-    rc_t rc = KFileReadAll( self -> f, pos, buffer, sizeof buffer, &num_read );
+    rc_t rc = 0;
+    if ( NULL != self -> base ) {
+        num_read = read_mapped( self, pos, buffer, sizeof buffer ); /* above */
+    } else {
+        rc = KFileReadAll( self -> f, pos, buffer, sizeof buffer, &num_read );
+    }
     if ( rc != 0 ) {
         ErrMsg( "read_key_and_len().KFileReadAll( at %ld, to_read %u ) -> %R", pos, sizeof buffer, rc );
     } else if ( num_read != sizeof buffer ) {
@@ -140,8 +217,8 @@ static rc_t read_key_and_len( struct lookup_reader_t * self, uint64_t pos, uint6
         memmove( &dna_len, buffer + sizeof *key, sizeof dna_len );   /* get 2/4 of of the buffer */
         {
             // the dna_len encodes the number of bases ! NOT the number of bytes
-            // adjust for odd vs. even number of bases to calculate the number of bytes to read
-            size_t dna_bytes = ( dna_len & 1 ) ? ( dna_len + 1 ) >> 1 : dna_len >> 1;
+            // the number of bytes depends on the 2na-packing and the optional N-mask ( dna_pack.c )
+            size_t dna_bytes = dna_packed_bytes( dna_len );
             *len = ( ( sizeof *key ) + ( sizeof dna_len ) + dna_bytes );
         }
     }
@@ -169,6 +246,7 @@ static rc_t loop_until_key_found( struct lookup_reader_t * self, uint64_t key_to
             *offset = curr;
         } else if ( key_to_find > *key_found ) {
             curr += found_len;
+            self -> seek_stats . bytes_scanned += found_len;
         } else {
             done = true;
             rc = SILENT_RC( rcVDB, rcNoTarg, rcReading, rcId, rcNotFound );
@@ -180,7 +258,9 @@ static rc_t loop_until_key_found( struct lookup_reader_t * self, uint64_t key_to
 static rc_t full_table_seek( struct lookup_reader_t * self, uint64_t key_to_find, uint64_t * key_found ) {
     /* we have no index! search the whole thing... */
     uint64_t offset = 0;
-    rc_t rc = loop_until_key_found( self, key_to_find, key_found, &offset );
+    rc_t rc;
+    self -> seek_stats . full_scans++;
+    rc = loop_until_key_found( self, key_to_find, key_found, &offset );
     if ( 0 == rc ) {
         if ( keys_equal( key_to_find, *key_found ) ) {
             self -> pos = offset;
@@ -232,6 +312,7 @@ rc_t seek_lookup_reader( struct lookup_reader_t * self, uint64_t key_to_find, ui
         rc = RC( rcVDB, rcNoTarg, rcReading, rcParam, rcInvalid );
         ErrMsg( "lookup_reader.c seek_lookup_reader() -> %R", rc );
     } else {
+        uint64_t start = hlp_now_us(); /* helper.c */
         if ( NULL != self -> index ) {
             rc = indexed_seek( self, key_to_find, key_found, exactly );
             if ( 0 != rc ) {
@@ -240,6 +321,46 @@ rc_t seek_lookup_reader( struct lookup_reader_t * self, uint64_t key_to_find, ui
         } else {
             rc = full_table_seek( self, key_to_find, key_found );
         }
+        self -> seek_stats . seeks++;
+        self -> seek_stats . micro_seconds += ( hlp_now_us() - start );
+    }
+    return rc;
+}
+
+/* the mapped reader: packed_bases points directly into the mapped file,
+   it starts with the dna-base-count followed by the packed bases ( dna_pack.c ) */
+static rc_t lookup_reader_peek( struct lookup_reader_t * self, uint64_t * key, String * packed_bases ) {
+    rc_t rc = 0;
+    const size_t header_size = sizeof( *key ) + sizeof( dna_len_t );
+    if ( self -> pos + 1 >= self -> f_size ) {
+        rc = SILENT_RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+    } else if ( self -> pos + header_size > self -> f_size ) {
+        rc = SILENT_RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+        ErrMsg( "lookup_reader_peek() truncated entry at %lu", self -> pos );
+    } else {
+        const uint8_t * src = self -> base + self -> pos;
+        dna_len_t dna_bases;
+
+        memcpy( key, src, sizeof *key );
+        memcpy( &dna_bases, src + sizeof *key, sizeof dna_bases );
+        if ( 0 == dna_packed_len( dna_bases ) ) {
+            rc = SILENT_RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+            ErrMsg( "lookup_reader_peek() to_read == 0 at %lu, key = %lu", self -> pos, *key );
+            packed_bases -> size = 0;
+            packed_bases -> len = 0;
+            self -> pos += header_size;
+        } else {
+            size_t dna_bytes = dna_packed_bytes( dna_bases ); /* dna_pack.c */
+            if ( self -> pos + header_size + dna_bytes > self -> f_size ) {
+                rc = RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+                ErrMsg( "lookup_reader_peek() truncated entry at %lu, key = %lu -> %R", self -> pos, *key, rc );
+            } else {
+                packed_bases -> addr = ( const char * )( src + sizeof *key );
+                packed_bases -> size = dna_bytes + sizeof dna_bases;
+                packed_bases -> len = ( uint32_t )packed_bases -> size;
+                self -> pos += ( header_size + dna_bytes );
+            }
+        }
     }
     return rc;
 }
@@ -249,6 +370,19 @@ rc_t lookup_reader_get( struct lookup_reader_t * self, uint64_t * key, SBuffer_t
     if ( NULL == self || NULL == key || NULL == packed_bases ) {
         rc = RC( rcVDB, rcNoTarg, rcReading, rcParam, rcInvalid );
         ErrMsg( "lookup_reader_get() #invalid input# -> %R",  rc );
+    } else if ( NULL != self -> base ) {
+        String mapped;
+        rc = lookup_reader_peek( self, key, &mapped ); /* above */
+        if ( 0 == rc ) {
+            if ( packed_bases -> buffer_size < mapped . size ) {
+                rc = increase_SBuffer_to( packed_bases, mapped . size );
+            }
+            if ( 0 == rc ) {
+                memcpy( ( void * )packed_bases -> S . addr, mapped . addr, mapped . size );
+                packed_bases -> S . size = mapped . size;
+                packed_bases -> S . len = mapped . len;
+            }
+        }
     } else {
         if ( self -> pos >= ( self -> f_size - 1 ) ) {
             rc = SILENT_RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
@@ -273,19 +407,18 @@ rc_t lookup_reader_get( struct lookup_reader_t * self, uint64_t * key, SBuffer_t
                     /* we get the dna-len out of buffer1 */
                     memcpy( &dna_bases, &( buffer1[ sizeof *key ] ), sizeof dna_bases );
 
-                    /* adjust the number of bytes to read to the half of the dna_len */
-                    if ( 0 == dna_bases ) {
+                    /* the number of bytes to read depends on the packing ( dna_pack.c ) */
+                    if ( 0 == dna_packed_len( dna_bases ) ) {
                         rc = SILENT_RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
                         ErrMsg( "lookup_reader_get() to_read == 0 at %lu, key = %lu", self -> pos, *key );
                         packed_bases -> S . size = 0;
                         packed_bases -> S . len = 0;
                         self -> pos += ( sizeof ( *key ) + sizeof( dna_bases ) );
                     } else {
-                        size_t dna_bytes = ( dna_bases / 2 );
-                        if ( 1 == ( dna_bases & 1 ) ) { dna_bytes++; }
+                        size_t dna_bytes = dna_packed_bytes( dna_bases );
                         /* maybe we have to increase the size of the SBuffer, after seeing the real dna-length */
                         if ( packed_bases -> buffer_size < ( dna_bytes + sizeof dna_bases ) ) {
-                            rc = increase_SBuffer_to( packed_bases, dna_bytes + dna_bases );
+                            rc = increase_SBuffer_to( packed_bases, dna_bytes + sizeof dna_bases );
                         }
                         if ( 0 == rc ) {
                             uint8_t * dst = ( uint8_t * )( packed_bases -> S . addr );
@@ -320,67 +453,15 @@ rc_t lookup_reader_get( struct lookup_reader_t * self, uint64_t * key, SBuffer_t
     return rc;
 }
 
-static const char x4na_to_ASCII_fwd[ 16 ] = {
-    /* 0x00 0x01 0x02 0x03 0x04 0x05 0x06 0x07 0x08 0x09 0x0A 0x0B 0x0C 0x0D 0x0E 0x0F */
-       'N', 'A', 'C', 'N', 'G', 'N', 'N', 'N', 'T', 'N', 'N', 'N', 'N', 'N', 'N', 'N'
-};
-
-static const char x4na_to_ASCII_rev[ 16 ] = {
-    /* 0x00 0x01 0x02 0x03 0x04 0x05 0x06 0x07 0x08 0x09 0x0A 0x0B 0x0C 0x0D 0x0E 0x0F */
-       'N', 'T', 'G', 'N', 'C', 'N', 'N', 'N', 'A', 'N', 'N', 'N', 'N', 'N', 'N', 'N'
-};
-
-static rc_t unpack_4na( const String * packed, SBuffer_t * unpacked, bool reverse ) {
-    rc_t rc = 0;
-    uint8_t * src = ( uint8_t * )packed -> addr;
-    dna_len_t dna_len;
-
-    /* the first 2 bytes are the 16-bit dna-length */
-    memmove( &dna_len, src, sizeof( dna_len_t ) );
-
-    if ( dna_len > unpacked -> buffer_size ) {
-        rc = increase_SBuffer_to( unpacked, dna_len + 4 );
-        if ( 0 != rc ) {
-            ErrMsg( "lookup_reader_get().unpack_4na() -> %R failed to increase buffer", rc );
-        }
-    }
-    if ( 0 == rc ) {
-        if ( 0 == dna_len ) {
-            unpacked -> S . size = 0;
-            unpacked -> S . len = 0;
-        } else {
-            uint8_t * dst = ( uint8_t * )unpacked -> S . addr;
-            int32_t dst_idx;
-            uint32_t src_idx;
-
-            /* use the complement-lookup-table in case of reverse */
-            const char * lookup = reverse ? x4na_to_ASCII_rev : x4na_to_ASCII_fwd;
-
-            dst_idx = reverse ? dna_len - 1 : 0;
-
-            for ( src_idx = sizeof( dna_len_t ); dst_idx >= 0 && src_idx < packed -> len; ++src_idx ) {
-                /* get the packed byte out of the packed input */
-                uint8_t packed_byte = src[ src_idx ];
-
-                /* write the first unpacked byte */
-                if ( dst_idx < unpacked -> buffer_size ) {
-                    dst[ dst_idx ] = lookup[ ( packed_byte >> 4 ) & 0x0F ];
-                    dst_idx += reverse ? -1 : 1;
-                }
-
-                /* write the second unpacked byte */
-                if ( dst_idx < unpacked -> buffer_size ) {
-                    dst[ dst_idx ] = lookup[ packed_byte & 0x0F ];
-                    dst_idx += reverse ? -1 : 1;
-                }
-            }
-
-            /* set the dna-length in the output-string */
-            unpacked -> S . size = dna_len;
-            unpacked -> S . len = ( uint32_t )unpacked -> S . size;
-
-            /* terminated the output-string, just in case */
-            dst[ dna_len ] = 0;
+/* the next entry: zero-copy for the mapped reader, via the internal buffer otherwise */
+static rc_t lookup_reader_next( struct lookup_reader_t * self, uint64_t * key, String * packed_bases ) {
+    rc_t rc;
+    if ( NULL != self -> base ) {
+        rc = lookup_reader_peek( self, key, packed_bases ); /* above */
+    } else {
+        rc = lookup_reader_get( self, key, &self -> buf ); /* above */
+        if ( 0 == rc ) {
+            *packed_bases = self -> buf . S;
         }
     }
     return rc;
@@ -390,6 +471,7 @@ rc_t lookup_bases( struct lookup_reader_t * self, int64_t row_id, uint32_t read_
     int64_t found_row_id;
     uint32_t found_read_id;
     uint64_t key;
+    String packed;
     rc_t rc = 0;
     if ( NULL == self || NULL == B ) {
         rc = RC( rcRuntime, rcData, rcAccessing, rcMemory, rcNull );
@@ -398,13 +480,13 @@ rc_t lookup_bases( struct lookup_reader_t * self, int64_t row_id, uint32_t read_
     }
 
     if ( 0 == rc ) {
-        rc = lookup_reader_get( self, &key, &self -> buf );
+        rc = lookup_reader_next( self, &key, &packed ); /* above */
         if ( 0 == rc ) {
             found_row_id = key >> 1;
             found_read_id = key & 1 ? 2 : 1;
 
             if ( found_row_id == row_id && found_read_id == read_id ) {
-                rc = unpack_4na( &self -> buf . S, B, reverse ); /* helper.c */
+                rc = dna_unpack_2na( &packed, B, reverse ); /* dna_pack.c */
             } else {
                 /* in case the reader is not pointed to the right position, we try to seek again */
                 rc_t rc1;
@@ -420,13 +502,13 @@ rc_t lookup_bases( struct lookup_reader_t * self, int64_t row_id, uint32_t read_
 
                 rc1 = seek_lookup_reader( self, key_to_find, &key_found, true );
                 if ( 0 == rc1 ) {
-                    rc = lookup_reader_get( self, &key, &self -> buf );
+                    rc = lookup_reader_next( self, &key, &packed ); /* above */
                     if ( 0 == rc ) {
                         found_row_id = key >> 1;
                         found_read_id = key & 1 ? 2 : 1;
 
                         if ( found_row_id == row_id && found_read_id == read_id ) {
-                            rc = unpack_4na( &self -> buf . S, B, reverse ); /* helper.c */
+                            rc = dna_unpack_2na( &packed, B, reverse ); /* dna_pack.c */
                         } else {
                             rc = RC( rcVDB, rcNoTarg, rcConstructing, rcTransfer, rcInvalid );
                             ErrMsg( "lookup_bases #2( %lu.%u ) ---> found %lu.%u (at pos=%lu)",
@@ -447,6 +529,16 @@ rc_t lookup_bases( struct lookup_reader_t * self, int64_t row_id, uint32_t read_
     return rc;
 }
 
+void lookup_reader_seek_stats( const struct lookup_reader_t * self, lookup_seek_stats_t * stats ) {
+    if ( NULL != stats ) {
+        if ( NULL != self ) {
+            *stats = self -> seek_stats;
+        } else {
+            memset( stats, 0, sizeof *stats );
+        }
+    }
+}
+
 rc_t lookup_check( struct lookup_reader_t * self ) {
     rc_t rc = 0;
     int64_t last_key = 0;
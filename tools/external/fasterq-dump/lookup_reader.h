@@ -55,11 +55,26 @@ void release_lookup_reader( struct lookup_reader_t * self );
 rc_t make_lookup_reader( const KDirectory *dir, const struct index_reader_t * index,
                          struct lookup_reader_t ** reader, size_t buf_size, const char * fmt, ... );
 
+/* maps the lookup-file into memory for random access ( the join-threads ),
+   falls back to a buffered reader of buf_size if the file cannot be mapped */
+rc_t make_mapped_lookup_reader( const KDirectory *dir, const struct index_reader_t * index,
+                         struct lookup_reader_t ** reader, size_t buf_size, const char * fmt, ... );
+
 rc_t seek_lookup_reader( struct lookup_reader_t * self, uint64_t key, uint64_t * key_found, bool exactly );
 
 rc_t lookup_reader_get( struct lookup_reader_t * self, uint64_t * key, SBuffer_t * packed_bases );
 rc_t lookup_bases( struct lookup_reader_t * self, int64_t row_id, uint32_t read_id, SBuffer_t * B, bool reverse );
 
+typedef struct lookup_seek_stats_t {
+    uint64_t seeks;             /* how often the reader had to be re-positioned */
+    uint64_t full_scans;        /* how many of these seeks had to scan from the start of the file */
+    uint64_t bytes_scanned;     /* how many bytes have been walked over to find the keys */
+    uint64_t micro_seconds;     /* time spent seeking */
+    bool mapped;                /* was the lookup-file mapped into memory */
+} lookup_seek_stats_t;
+
+void lookup_reader_seek_stats( const struct lookup_reader_t * self, lookup_seek_stats_t * stats );
+
 rc_t lookup_check( struct lookup_reader_t * self );
 rc_t lookup_check_file( const KDirectory *dir, size_t buf_size, const char * filename );
 
@@ -0,0 +1,212 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "lookup_store.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#ifndef _h_dna_pack_
+#include "dna_pack.h"
+#endif
+
+#ifndef _h_klib_sort_
+#include <klib/sort.h>
+#endif
+
+#define LOOKUP_STORE_MIN_ARENA ( 64 * 1024 )
+#define LOOKUP_STORE_MIN_ENTRIES 1024
+
+typedef struct lookup_store_entry_t {
+    uint64_t key;
+    uint64_t offset;    /* into the arena, points to the packed READ ( incl. header ) */
+} lookup_store_entry_t;
+
+typedef struct lookup_store_t {
+    uint8_t * arena;
+    lookup_store_entry_t * entries;
+    size_t arena_size, arena_used;
+    size_t entries_size, entries_used;
+    size_t mem_limit;
+} lookup_store_t;
+
+rc_t make_lookup_store( lookup_store_t ** store, size_t mem_limit ) {
+    rc_t rc = 0;
+    lookup_store_t * s = calloc( 1, sizeof * s );
+    if ( NULL == s ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        ErrMsg( "make_lookup_store().calloc( %d ) -> %R", ( sizeof * s ), rc );
+    } else {
+        s -> mem_limit = mem_limit;
+        *store = s;
+    }
+    return rc;
+}
+
+void release_lookup_store( lookup_store_t * self ) {
+    if ( NULL != self ) {
+        free( ( void * ) self -> arena );
+        free( ( void * ) self -> entries );
+        free( ( void * ) self );
+    }
+}
+
+size_t lookup_store_bytes( const lookup_store_t * self ) {
+    size_t res = 0;
+    if ( NULL != self ) {
+        res = self -> arena_size + ( self -> entries_size * sizeof( lookup_store_entry_t ) );
+    }
+    return res;
+}
+
+uint64_t lookup_store_count( const lookup_store_t * self ) {
+    return ( NULL != self ) ? self -> entries_used : 0;
+}
+
+/* the new capacity, doubling but capped by what is left of the mem-limit */
+static size_t lookup_store_grow( size_t current, size_t needed, size_t min_size, size_t limit ) {
+    size_t res = ( current < min_size ) ? min_size : current * 2;
+    if ( limit > 0 && res > limit ) { res = limit; }
+    if ( res < needed ) { res = needed; }
+    return res;
+}
+
+static size_t lookup_store_bytes_left( const lookup_store_t * self, size_t entries_size, size_t arena_size ) {
+    size_t used = arena_size + ( entries_size * sizeof( lookup_store_entry_t ) );
+    return ( used < self -> mem_limit ) ? self -> mem_limit - used : 0;
+}
+
+bool lookup_store_has_room( const lookup_store_t * self, uint32_t dna_len ) {
+    bool res = true;
+    if ( NULL != self && self -> mem_limit > 0 && self -> entries_used > 0 ) {
+        size_t arena_needed = self -> arena_used + dna_pack_max_size( dna_len ); /* dna_pack.c */
+        size_t bytes_needed = 0;
+        if ( arena_needed > self -> arena_size ) {
+            bytes_needed += arena_needed - self -> arena_size;
+        }
+        if ( self -> entries_used >= self -> entries_size ) {
+            bytes_needed += sizeof( lookup_store_entry_t );
+        }
+        res = ( bytes_needed <= lookup_store_bytes_left( self, self -> entries_size, self -> arena_size ) );
+    }
+    return res;
+}
+
+rc_t lookup_store_add( lookup_store_t * self, uint64_t key, const String * bases ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == bases ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcParam, rcNull );
+        ErrMsg( "lookup_store_add() -> %R", rc );
+    } else if ( bases -> len < 1 ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcFormat, rcNull );
+        ErrMsg( "lookup_store_add( key = %lu ) empty READ -> %R", key, rc );
+    } else {
+        size_t max_size = dna_pack_max_size( bases -> len ); /* dna_pack.c */
+        size_t left = lookup_store_bytes_left( self, self -> entries_size, self -> arena_size );
+
+        size_t arena_extra = ( self -> arena_used + max_size > self -> arena_size )
+                                ? self -> arena_used + max_size - self -> arena_size : 0;
+
+        /* make room for one more entry, leave enough of the mem-limit for the arena */
+        if ( self -> entries_used >= self -> entries_size ) {
+            size_t avail = ( left > arena_extra ) ? left - arena_extra : 0;
+            size_t limit = ( self -> entries_size * sizeof( lookup_store_entry_t ) + avail ) / sizeof( lookup_store_entry_t );
+            size_t new_size = lookup_store_grow( self -> entries_size, self -> entries_used + 1,
+                                                 LOOKUP_STORE_MIN_ENTRIES, self -> mem_limit > 0 ? limit : 0 );
+            lookup_store_entry_t * tmp = realloc( self -> entries, new_size * sizeof * tmp );
+            if ( NULL == tmp ) {
+                rc = RC( rcVDB, rcNoTarg, rcWriting, rcMemory, rcExhausted );
+                ErrMsg( "lookup_store_add().realloc( entries = %lu ) -> %R", new_size, rc );
+            } else {
+                self -> entries = tmp;
+                self -> entries_size = new_size;
+            }
+        }
+
+        /* make room in the arena for the packed READ */
+        if ( 0 == rc && self -> arena_used + max_size > self -> arena_size ) {
+            size_t limit;
+            size_t new_size;
+            uint8_t * tmp;
+            left = lookup_store_bytes_left( self, self -> entries_size, self -> arena_size );
+            limit = self -> arena_size + left;
+            new_size = lookup_store_grow( self -> arena_size, self -> arena_used + max_size,
+                                          LOOKUP_STORE_MIN_ARENA, self -> mem_limit > 0 ? limit : 0 );
+            tmp = realloc( self -> arena, new_size );
+            if ( NULL == tmp ) {
+                rc = RC( rcVDB, rcNoTarg, rcWriting, rcMemory, rcExhausted );
+                ErrMsg( "lookup_store_add().realloc( arena = %lu ) -> %R", new_size, rc );
+            } else {
+                self -> arena = tmp;
+                self -> arena_size = new_size;
+            }
+        }
+
+        if ( 0 == rc ) {
+            lookup_store_entry_t * e = &( self -> entries[ self -> entries_used++ ] );
+            e -> key = key;
+            e -> offset = self -> arena_used;
+            self -> arena_used += dna_pack_2na( ( const uint8_t * )bases -> addr,
+                                                bases -> len,
+                                                self -> arena + self -> arena_used ); /* dna_pack.c */
+        }
+    }
+    return rc;
+}
+
+static int64_t CC lookup_store_cmp( const void * a, const void * b, void * data ) {
+    const lookup_store_entry_t * ea = a;
+    const lookup_store_entry_t * eb = b;
+    if ( ea -> key < eb -> key ) { return -1; }
+    if ( ea -> key > eb -> key ) { return 1; }
+    return 0;
+}
+
+void lookup_store_sort( lookup_store_t * self ) {
+    if ( NULL != self && self -> entries_used > 1 ) {
+        ksort( self -> entries, self -> entries_used, sizeof * self -> entries, lookup_store_cmp, NULL );
+    }
+}
+
+rc_t lookup_store_get( const lookup_store_t * self, uint64_t idx, uint64_t * key, String * packed ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == key || NULL == packed ) {
+        rc = RC( rcVDB, rcNoTarg, rcReading, rcParam, rcNull );
+    } else if ( idx >= self -> entries_used ) {
+        rc = SILENT_RC( rcVDB, rcNoTarg, rcReading, rcId, rcNotFound );
+    } else {
+        const lookup_store_entry_t * e = &( self -> entries[ idx ] );
+        const uint8_t * p = self -> arena + e -> offset;
+        dna_len_t header;
+        memcpy( &header, p, sizeof header );
+        *key = e -> key;
+        StringInit( packed, ( const char * )p,
+                    sizeof header + dna_packed_bytes( header ), /* dna_pack.c */
+                    ( uint32_t )( sizeof header + dna_packed_bytes( header ) ) );
+    }
+    return rc;
+}
@@ -0,0 +1,79 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_lookup_store_
+#define _h_lookup_store_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_klib_text_
+#include <klib/text.h>
+#endif
+
+/* -----------------------------------------------------------------------------------
+    The in-memory store of the lookup-producer ( sorter.c ):
+    the READs are packed ( dna_pack.h ) directly into one growing arena, the keys and
+    the offsets into the arena are kept in a separate array. No allocation per READ.
+    The store accounts exactly for the memory it holds, and refuses to grow beyond
+    the mem-limit ( unless it is empty, a single READ is always accepted ).
+    Before it is handed to the background-vector-merger ( merge_sorter.c ) the store
+    is sorted by key, the producer is allowed to add keys in any order.
+   ----------------------------------------------------------------------------------- */
+
+struct lookup_store_t;
+
+rc_t make_lookup_store( struct lookup_store_t ** store, size_t mem_limit );
+
+void release_lookup_store( struct lookup_store_t * self );
+
+/* false if adding a READ with dna_len bases would exceed the mem-limit */
+bool lookup_store_has_room( const struct lookup_store_t * self, uint32_t dna_len );
+
+/* pack the READ and add it with the given key */
+rc_t lookup_store_add( struct lookup_store_t * self, uint64_t key, const String * bases );
+
+/* sort the entries by key, has to be called before lookup_store_get() */
+void lookup_store_sort( struct lookup_store_t * self );
+
+uint64_t lookup_store_count( const struct lookup_store_t * self );
+
+/* the exact number of bytes allocated by the store */
+size_t lookup_store_bytes( const struct lookup_store_t * self );
+
+/* get entry #idx ( in key-order after sorting ), packed points into the arena */
+rc_t lookup_store_get( const struct lookup_store_t * self, uint64_t idx, uint64_t * key, String * packed );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -42,6 +42,10 @@
 #include "file_tools.h"
 #endif
 
+#ifndef _h_perf_report_
+#include "perf_report.h"
+#endif
+
 #ifndef _h_kfs_buffile_
 #include <kfs/buffile.h>
 #endif
@@ -62,6 +66,7 @@ void release_lookup_writer( struct lookup_writer_t * writer ) {
         if ( NULL != writer -> f ) {
             ft_release_file( writer -> f, "release_lookup_writer()" );
         }
+        perf_add( pc_temp_bytes_written, writer -> pos ); /* perf_report.c */
         release_SBuffer( &( writer -> buf ) );
         free( ( void * ) writer );
     }
@@ -125,8 +130,8 @@ rc_t make_lookup_writer( KDirectory *dir,
 }
 
 rc_t write_packed_to_lookup_writer( struct lookup_writer_t * writer,
-                                    const uint64_t key,
-                                    const String * bases_as_packed_4na ) {
+                                    uint64_t key,
+                                    const String * packed_bases ) {
     size_t num_writ;
     /* first write the key ( combination of seq-id and read-id ) */
     rc_t rc = KFileWriteAll( writer -> f, writer -> pos, &key, sizeof key, &num_writ );
@@ -140,15 +145,15 @@ rc_t write_packed_to_lookup_writer( struct lookup_writer_t * writer,
         uint64_t start_pos = writer -> pos; /* store the pos to be written later to the index... */
 
         writer -> pos += num_writ;
-        /* now write the packed 4na ( length + packed data ) */
+        /* now write the packed 2na ( header + packed data, see dna_pack.h ) */
         rc = KFileWriteAll( writer -> f,
                             writer -> pos,
-                            bases_as_packed_4na -> addr,
-                            bases_as_packed_4na -> size,
+                            packed_bases -> addr,
+                            packed_bases -> size,
                             &num_writ );
         if ( 0 != rc ) {
             ErrMsg( "write_packed_to_lookup_writer().KFileWriteAll( bases ) -> %R", rc );
-        } else if ( num_writ != bases_as_packed_4na -> size ) {
+        } else if ( num_writ != packed_bases -> size ) {
             rc = RC( rcVDB, rcNoTarg, rcWriting, rcFormat, rcInvalid );
             ErrMsg( "write_packed_to_lookup_writer().KFileWriteAll( bases ) -> %R", rc );
         } else {
@@ -51,12 +51,13 @@ struct lookup_writer_t;
 
 void release_lookup_writer( struct lookup_writer_t * writer );
 
-rc_t make_lookup_writer( KDirectory *dir, struct index_writer_t * idx, struct lookup_writer_t ** writer,
+rc_t make_lookup_writer( KDirectory *dir, struct index_writer_t * index_writer, struct lookup_writer_t ** writer,
                          size_t buf_size, const char * fmt, ... );
 
-/* used in merge_sorter.c and lookup_writer.c */
+/* used in merge_sorter.c and lookup_writer.c
+   packed_bases ... one READ as produced by dna_pack_2na() ( incl. the header ) */
 rc_t write_packed_to_lookup_writer( struct lookup_writer_t * writer,
-            uint64_t key, const String * bases_as_packed_4na );
+            uint64_t key, const String * packed_bases );
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,228 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "mate_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* -----------------------------------------------------------------------------------
+    The entries are a ring: cursor points to the entry the next put will use.
+    The spot-id's are found via an open-addressing hash-table with linear probing,
+    it has at least 2 * capacity slots, a slot holds ( entry-index + 1 ), 0 = empty.
+    Deleted slots are closed by shifting the following cluster back, no tombstones.
+   ----------------------------------------------------------------------------------- */
+
+typedef struct mate_cache_entry_t {
+    uint64_t spot_id;
+    uint32_t read_id;
+    uint32_t read_len;
+    uint32_t qual_len;
+    size_t data_size;
+    char * data;        /* bases followed by qualities */
+    bool used;
+} mate_cache_entry_t;
+
+typedef struct mate_cache_t {
+    mate_cache_entry_t * entries;
+    uint32_t * slots;
+    uint32_t capacity;
+    uint32_t slot_mask;
+    uint32_t cursor;
+    uint32_t count;
+} mate_cache_t;
+
+static uint32_t mate_cache_home( const mate_cache_t * self, uint64_t spot_id ) {
+    uint64_t h = spot_id * 0x9E3779B97F4A7C15ULL;
+    return ( uint32_t )( h >> 32 ) & self -> slot_mask;
+}
+
+rc_t make_mate_cache( mate_cache_t ** cache, uint32_t capacity ) {
+    rc_t rc = 0;
+    if ( NULL == cache || 0 == capacity || capacity > 0x40000000 ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+    } else {
+        mate_cache_t * c = calloc( 1, sizeof * c );
+        *cache = NULL;
+        if ( NULL == c ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        } else {
+            uint32_t slot_count = 2;
+            while ( slot_count < 2 * capacity ) { slot_count <<= 1; }
+            c -> capacity = capacity;
+            c -> slot_mask = slot_count - 1;
+            c -> entries = calloc( capacity, sizeof * c -> entries );
+            c -> slots = calloc( slot_count, sizeof * c -> slots );
+            if ( NULL == c -> entries || NULL == c -> slots ) {
+                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                release_mate_cache( c );
+            } else {
+                *cache = c;
+            }
+        }
+    }
+    return rc;
+}
+
+void release_mate_cache( mate_cache_t * self ) {
+    if ( NULL != self ) {
+        if ( NULL != self -> entries ) {
+            uint32_t idx;
+            for ( idx = 0; idx < self -> capacity; ++idx ) {
+                free( ( void * ) self -> entries[ idx ] . data );
+            }
+            free( ( void * ) self -> entries );
+        }
+        free( ( void * ) self -> slots );
+        free( ( void * ) self );
+    }
+}
+
+/* returns the slot holding this spot-id, or the empty slot where it would go */
+static uint32_t mate_cache_find_slot( const mate_cache_t * self, uint64_t spot_id ) {
+    uint32_t slot = mate_cache_home( self, spot_id );
+    while ( 0 != self -> slots[ slot ] &&
+            self -> entries[ self -> slots[ slot ] - 1 ] . spot_id != spot_id ) {
+        slot = ( slot + 1 ) & self -> slot_mask;
+    }
+    return slot;
+}
+
+static void mate_cache_clear_slot( mate_cache_t * self, uint32_t slot ) {
+    uint32_t next = slot;
+    self -> slots[ slot ] = 0;
+    for ( ;; ) {
+        uint32_t home;
+        next = ( next + 1 ) & self -> slot_mask;
+        if ( 0 == self -> slots[ next ] ) { break; }
+        home = mate_cache_home( self, self -> entries[ self -> slots[ next ] - 1 ] . spot_id );
+        /* can the entry at next move into the hole at slot? only if its home is not
+           cyclically inside ( slot, next ] */
+        if ( ( ( next - home ) & self -> slot_mask ) >= ( ( next - slot ) & self -> slot_mask ) ) {
+            self -> slots[ slot ] = self -> slots[ next ];
+            self -> slots[ next ] = 0;
+            slot = next;
+        }
+    }
+}
+
+static void mate_cache_remove( mate_cache_t * self, uint32_t idx, mate_cache_rec_t * rec ) {
+    mate_cache_entry_t * e = &( self -> entries[ idx ] );
+    mate_cache_clear_slot( self, mate_cache_find_slot( self, e -> spot_id ) );
+    e -> used = false;
+    self -> count--;
+    if ( NULL != rec ) {
+        rec -> spot_id = e -> spot_id;
+        rec -> read_id = e -> read_id;
+        StringInit( &( rec -> read ), e -> data, e -> read_len, e -> read_len );
+        StringInit( &( rec -> quality ), e -> data + e -> read_len, e -> qual_len, e -> qual_len );
+    }
+}
+
+bool mate_cache_take( mate_cache_t * self, uint64_t spot_id, mate_cache_rec_t * rec ) {
+    bool res = false;
+    if ( NULL != self && self -> count > 0 ) {
+        uint32_t slot = mate_cache_find_slot( self, spot_id );
+        if ( 0 != self -> slots[ slot ] ) {
+            mate_cache_remove( self, self -> slots[ slot ] - 1, rec );
+            res = true;
+        }
+    }
+    return res;
+}
+
+bool mate_cache_evict( mate_cache_t * self, mate_cache_rec_t * rec ) {
+    bool res = false;
+    if ( NULL != self && self -> entries[ self -> cursor ] . used ) {
+        mate_cache_remove( self, self -> cursor, rec );
+        res = true;
+    }
+    return res;
+}
+
+rc_t mate_cache_put( mate_cache_t * self, uint64_t spot_id, uint32_t read_id,
+                     const String * read, const String * quality ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == read ) {
+        rc = RC( rcVDB, rcNoTarg, rcInserting, rcParam, rcInvalid );
+    } else {
+        mate_cache_entry_t * e = &( self -> entries[ self -> cursor ] );
+        if ( e -> used ) {
+            /* the caller has not evicted the previous occupant */
+            rc = RC( rcVDB, rcNoTarg, rcInserting, rcItem, rcBusy );
+        } else {
+            uint32_t qual_len = ( NULL != quality ) ? quality -> len : 0;
+            size_t needed = ( size_t )read -> len + qual_len;
+            if ( needed > e -> data_size ) {
+                char * data = realloc( e -> data, needed );
+                if ( NULL == data ) {
+                    rc = RC( rcVDB, rcNoTarg, rcInserting, rcMemory, rcExhausted );
+                } else {
+                    e -> data = data;
+                    e -> data_size = needed;
+                }
+            }
+            if ( 0 == rc ) {
+                uint32_t slot = mate_cache_find_slot( self, spot_id );
+                if ( 0 != self -> slots[ slot ] ) {
+                    /* a third aligned read of the same spot: the caller takes before it puts,
+                       so this only happens if the spot has more than 2 aligned reads */
+                    rc = RC( rcVDB, rcNoTarg, rcInserting, rcItem, rcExists );
+                } else {
+                    memmove( e -> data, read -> addr, read -> len );
+                    if ( qual_len > 0 ) {
+                        memmove( e -> data + read -> len, quality -> addr, qual_len );
+                    }
+                    e -> spot_id = spot_id;
+                    e -> read_id = read_id;
+                    e -> read_len = read -> len;
+                    e -> qual_len = qual_len;
+                    e -> used = true;
+                    self -> slots[ slot ] = self -> cursor + 1;
+                    self -> count++;
+                    self -> cursor = ( self -> cursor + 1 ) % self -> capacity;
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+bool mate_cache_flush( mate_cache_t * self, mate_cache_rec_t * rec ) {
+    bool res = false;
+    if ( NULL != self ) {
+        while ( !res && self -> count > 0 ) {
+            /* oldest entries first: they sit at and after the cursor */
+            res = mate_cache_evict( self, rec );
+            self -> cursor = ( self -> cursor + 1 ) % self -> capacity;
+        }
+    }
+    return res;
+}
+
+uint32_t mate_cache_count( const mate_cache_t * self ) {
+    return ( NULL != self ) ? self -> count : 0;
+}
@@ -0,0 +1,98 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#ifndef _h_mate_cache_
+#define _h_mate_cache_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_klib_text_
+#include <klib/text.h>
+#endif
+
+/* ================================================================================= */
+
+/* -----------------------------------------------------------------------------------
+    A bounded cache for reads waiting for their mate, used by the streaming-mode.
+    The reads are keyed by their spot-id, the cache owns a copy of bases and qualities.
+    The capacity is fixed: the entries are reused in round-robin order, before putting
+    a new read into the cache the caller has to ask for the entry to be evicted
+    ( this is the read that has been put into the cache capacity-puts ago, if it
+    is still waiting ). The strings returned in mate_cache_rec_t point into the cache,
+    they are valid until the next call to mate_cache_put().
+
+    usage:
+        make_mate_cache( &cache, capacity );
+        for each read :
+            if ( mate_cache_take( cache, spot_id, &mate ) ) {
+                ... print read and mate ...
+            } else {
+                if ( mate_cache_evict( cache, &evicted ) ) { ... print evicted alone ... }
+                mate_cache_put( cache, spot_id, read_id, &read, &quality );
+            }
+        while ( mate_cache_flush( cache, &left ) ) { ... print left alone ... }
+        release_mate_cache( cache );
+   ----------------------------------------------------------------------------------- */
+
+typedef struct mate_cache_rec_t {
+    uint64_t spot_id;
+    uint32_t read_id;
+    String read;
+    String quality;
+} mate_cache_rec_t;
+
+struct mate_cache_t;
+
+rc_t make_mate_cache( struct mate_cache_t ** cache, uint32_t capacity );
+
+void release_mate_cache( struct mate_cache_t * self );
+
+/* returns true and removes the entry if a read for this spot is waiting in the cache */
+bool mate_cache_take( struct mate_cache_t * self, uint64_t spot_id, mate_cache_rec_t * rec );
+
+/* returns true and removes the entry if the next put would overwrite a waiting read */
+bool mate_cache_evict( struct mate_cache_t * self, mate_cache_rec_t * rec );
+
+/* fails if the entry to be used has not been evicted before */
+rc_t mate_cache_put( struct mate_cache_t * self, uint64_t spot_id, uint32_t read_id,
+                     const String * read, const String * quality );
+
+/* returns true and removes one of the waiting reads, false if the cache is empty */
+bool mate_cache_flush( struct mate_cache_t * self, mate_cache_rec_t * rec );
+
+/* how many reads are waiting */
+uint32_t mate_cache_count( const struct mate_cache_t * self );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
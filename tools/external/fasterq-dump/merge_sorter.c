@@ -51,6 +51,14 @@
 #include "locked_value.h"
 #endif
 
+#ifndef _h_merge_tree_
+#include "merge_tree.h"
+#endif
+
+#ifndef _h_lookup_store_
+#include "lookup_store.h"
+#endif
+
 #ifndef _h_klib_status_
 #include <klib/status.h>
 #endif
@@ -78,30 +86,13 @@ typedef struct merge_src {
     rc_t rc;
 } merge_src_t;
 
-static merge_src_t * get_min_merge_src( merge_src_t * src, uint32_t count ) {
-    merge_src_t * res = NULL;
-    uint32_t i;
-    for ( i = 0; i < count; ++i ) {
-        merge_src_t * item = &src[ i ];
-        if ( 0 == item -> rc ) {
-            if ( NULL == res ) {
-                /* pick the first one */
-                res = item;
-            } else if ( item -> key < res -> key ) {
-                /* if this src has a smaller key... */
-                res = item;
-            }
-        }
-    }
-    return res;
-}
-
 /* ================================================================================= */
 
 typedef struct merge_sorter_t {
     struct lookup_writer_t * dst; /* lookup_writer.h */
     struct index_writer_t * idx;  /* index.h */
     merge_src_t * src;            /* vector of input-files to be merged */
+    struct merge_tree_t * tree;   /* loser-tree to find the next src to write, merge_tree.h */
     struct bg_update_t * gap;     /* indicator of running merge */
     uint64_t total_size, total_entries;
     uint32_t num_src;
@@ -111,6 +102,7 @@ static rc_t init_merge_sorter( merge_sorter_t * self,
                                KDirectory * dir,
                                const char * output,
                                const char * index,
+                               uint64_t index_frequency,
                                VNamelist * files,
                                size_t buf_size,
                                uint32_t num_src,
@@ -119,7 +111,7 @@ static rc_t init_merge_sorter( merge_sorter_t * self,
 
     if ( NULL != index ) {
         rc = make_index_writer( dir, &( self -> idx ), buf_size,
-                        DFLT_INDEX_FREQUENCY, "%s", index ); /* index.h */
+                        index_frequency, "%s", index ); /* index.h */
     } else {
         self -> idx = NULL;
     }
@@ -128,6 +120,8 @@ static rc_t init_merge_sorter( merge_sorter_t * self,
     self -> total_entries = 0;
     self -> num_src = num_src;
     self -> gap = gap;
+    self -> src = NULL;
+    self -> tree = NULL;
 
     if ( 0 == rc ) {
         rc = make_lookup_writer( dir, self -> idx, &( self -> dst ), buf_size, "%s", output ); /* lookup_writer.h */
@@ -157,12 +151,34 @@ static rc_t init_merge_sorter( merge_sorter_t * self,
             }
         }
     }
+
+    if ( 0 == rc && self -> num_src > 0 ) {
+        rc = make_merge_tree( &( self -> tree ), self -> num_src ); /* merge_tree.c */
+        if ( 0 != rc ) {
+            ErrMsg( "init_merge_sorter().make_merge_tree( %u ) -> %R", self -> num_src, rc );
+        } else {
+            for ( uint32_t i = 0; i < self -> num_src; ++i ) {
+                merge_src_t * s = &self -> src[ i ];
+                merge_tree_set( self -> tree, i, 0 == s -> rc, s -> key );
+            }
+            merge_tree_build( self -> tree );
+        }
+    }
     return rc;
 }
 
+static merge_src_t * get_min_merge_src( merge_sorter_t * self ) {
+    uint32_t idx;
+    if ( merge_tree_winner( self -> tree, &idx ) ) { /* merge_tree.c */
+        return &self -> src[ idx ];
+    }
+    return NULL;
+}
+
 static void release_merge_sorter( merge_sorter_t * self ) {
     release_lookup_writer( self -> dst );
     release_index_writer( self -> idx );
+    release_merge_tree( self -> tree ); /* merge_tree.c */
     if ( NULL != self -> src ) {
         for ( uint32_t i = 0; i < self -> num_src; ++i ) {
             merge_src_t * s = &self -> src[ i ];
@@ -178,7 +194,7 @@ static rc_t run_merge_sorter( merge_sorter_t * self ) {
     uint64_t last_key = 0;
     uint64_t loop_nr = 0;
 
-    merge_src_t * to_write = get_min_merge_src( self -> src, self -> num_src ); /* above */
+    merge_src_t * to_write = get_min_merge_src( self ); /* above */
 
     while( 0 == rc && NULL != to_write ) {
         rc = hlp_get_quitting();    /* helper.c */
@@ -196,8 +212,11 @@ static rc_t run_merge_sorter( merge_sorter_t * self ) {
                     to_write -> rc = lookup_reader_get( to_write -> reader,
                                                         &to_write -> key,
                                                         &to_write -> packed_bases ); /* lookup_reader.h */
+                    merge_tree_update( self -> tree, 0 == to_write -> rc, to_write -> key ); /* merge_tree.c */
+                    to_write = get_min_merge_src( self ); /* above */
+                } else {
+                    to_write = NULL;
                 }
-                to_write = get_min_merge_src( self -> src, self -> num_src ); /* above */
             }
             if ( 0 != rc ) {
                 hlp_set_quitting();     /* helper.c */
@@ -211,12 +230,12 @@ static rc_t run_merge_sorter( merge_sorter_t * self ) {
 
 /* =================================================================================
     The background-merger is composed from 1 background-thread, which is the consumer
-    of a job_q. The producer-pool in sorter.c puts KVector-instances into the queue.
+    of a job_q. The producer-pool in sorter.c puts lookup-stores into the queue.
     The background-merger pops the jobs out of the queue until it has assembled
     a batch of jobs. It then processes this batch by merge-sorting the content of
-    the KVector's into a temporary file. The entries are key-value pairs with a 64-bit
+    the ( sorted ) lookup-stores into a temporary file. The entries are key-value pairs with a 64-bit
     key which is composed from the SEQID and one bit: first or second read in a spot.
-    The value is the packed READ ( pack_4na() in lookup_writer.c ).
+    The value is the packed READ ( dna_pack_2na() in dna_pack.c ).
     The background-merger terminates when it's input-queue is sealed in perform_fastdump()
     in fastdump.c after all sorter-threads ( producers ) have been joined.
     The final output of the background-merger is a list of temporary files produced
@@ -226,12 +245,12 @@ static rc_t run_merge_sorter( merge_sorter_t * self ) {
 typedef struct background_vector_merger_t {
     KDirectory * dir;               /* needed to perform the merge-sort */
     const struct temp_dir_t * temp_dir; /* needed to create temp. files */
-    KQueue * job_q;                 /* the KVector objects arrive here from the lookup-producer */
+    KQueue * job_q;                 /* the lookup-stores arrive here from the lookup-producer */
     KThread * thread;               /* the thread that performs the merge-sort */
     struct background_file_merger_t * file_merger;    /* below */
     struct CleanupTask_t * cleanup_task;     /* add the produced temp_files here too */
     uint32_t product_id;            /* increased by one for each batch-run, used in temp-file-name */
-    uint32_t batch_size;            /* how many KVectors have to arrive to run a batch */
+    uint32_t batch_size;            /* how many lookup-stores have to arrive to run a batch */
     uint32_t q_wait_time;           /* timeout in milliseconds to get something out of in_q */
     size_t buf_size;                /* needed to perform the merge-sort */
     struct bg_update_t * gap;       /* visualize the gap after the producer finished */
@@ -289,51 +308,33 @@ rc_t wait_for_and_release_background_vector_merger( background_vector_merger_t *
 }
 
 typedef struct bg_vec_merge_src_t {
-    KVector * store;
+    struct lookup_store_t * store;  /* lookup_store.h */
+    uint64_t idx;
     uint64_t key;
-    const String * bases;
+    String bases;   /* points into the arena of the store */
     rc_t rc;
 } bg_vec_merge_src_t;
 
-static rc_t init_bg_vec_merge_src( bg_vec_merge_src_t * src, KVector * store ) {
+static rc_t init_bg_vec_merge_src( bg_vec_merge_src_t * src, struct lookup_store_t * store ) {
     src -> store = store;
-    src -> rc = KVectorGetFirstPtr ( src -> store, &( src -> key ), ( void ** )&( src -> bases ) );
+    src -> idx = 0;
+    src -> rc = lookup_store_get( src -> store, src -> idx, &( src -> key ), &( src -> bases ) ); /* lookup_store.c */
     return src -> rc;
 }
 
 static void release_bg_vec_merge_src( bg_vec_merge_src_t * src ) {
-    if ( NULL != src -> store ) {
-        KVectorRelease( src -> store );
-    }
-}
-
-static bg_vec_merge_src_t * get_min_bg_vec_merge_src( bg_vec_merge_src_t * batch, uint32_t count ) {
-    bg_vec_merge_src_t * res = NULL;
-    uint32_t i;
-    for ( i = 0; i < count; ++i ) {
-        bg_vec_merge_src_t * item = &batch[ i ];
-        if ( 0 == item -> rc ) {
-            if ( NULL == res ) {
-                res = item;
-            } else if ( item -> key < res -> key ) {
-                res = item;
-            }
-        }
-    }
-    return res;
+    release_lookup_store( src -> store ); /* lookup_store.c ( ignores NULL ) */
+    src -> store = NULL;
 }
 
 static rc_t write_bg_vec_merge_src( bg_vec_merge_src_t * src, struct lookup_writer_t * writer ) {
     rc_t rc = src -> rc;
     if ( 0 == rc ) {
-        rc = write_packed_to_lookup_writer( writer, src -> key, src -> bases ); /* lookup_writer.c */
-        StringWhack ( src -> bases );
-        src -> bases = NULL;
+        rc = write_packed_to_lookup_writer( writer, src -> key, &( src -> bases ) ); /* lookup_writer.c */
     }
     if ( 0 == rc ) {
-        uint64_t next_key;
-        src -> rc = KVectorGetNextPtr ( src -> store, &next_key, src -> key, ( void ** )&( src -> bases ) );
-        src -> key = next_key;
+        src -> idx += 1;
+        src -> rc = lookup_store_get( src -> store, src -> idx, &( src -> key ), &( src -> bases ) ); /* lookup_store.c */
     }
     return rc;
 }
@@ -354,7 +355,7 @@ static rc_t background_vector_merger_collect_batch( background_vector_merger_t *
             struct timeout_t tm;
             rc = TimeoutInit ( &tm, self -> q_wait_time );
             if ( 0 == rc ) {
-                KVector * store = NULL;
+                struct lookup_store_t * store = NULL;
                 rc = KQueuePop ( self -> job_q, ( void ** )&store, &tm );
                 if ( 0 == rc ) {
                     /* we pulled out a store from the Q */
@@ -416,22 +417,37 @@ static rc_t background_vector_merger_process_batch( background_vector_merger_t *
                 self -> product_id += 1;
             }
             if ( 0 == rc ) {
-                bg_vec_merge_src_t * to_write = get_min_bg_vec_merge_src( batch, count ); /* above */
-                while( 0 == rc && NULL != to_write ) {
-                    rc = hlp_get_quitting();    /* helper.c */
-                    if ( 0 == rc ) {
-                        rc = write_bg_vec_merge_src( to_write, writer ); /* above */
+                struct merge_tree_t * tree; /* merge_tree.h */
+                rc = make_merge_tree( &tree, count ); /* merge_tree.c */
+                if ( 0 != rc ) {
+                    ErrMsg( "merge_sorter.c background_vector_merger_process_batch().make_merge_tree( %u ) -> %R", count, rc );
+                } else {
+                    uint32_t idx;
+                    bool running;
+                    for ( idx = 0; idx < count; ++idx ) {
+                        merge_tree_set( tree, idx, 0 == batch[ idx ] . rc, batch[ idx ] . key );
+                    }
+                    merge_tree_build( tree );
+                    running = merge_tree_winner( tree, &idx );
+                    while( 0 == rc && running ) {
+                        rc = hlp_get_quitting();    /* helper.c */
                         if ( 0 == rc ) {
-                            self -> total++;
-                            to_write = get_min_bg_vec_merge_src( batch, count ); /* above */
-                        } else {
-                            to_write = NULL;
-                        }
-                        bg_update_update( self -> gap, 1 );
-                        if ( 0 != rc ) {
-                            hlp_set_quitting();     /* helper.c */
+                            bg_vec_merge_src_t * to_write = &batch[ idx ];
+                            rc = write_bg_vec_merge_src( to_write, writer ); /* above */
+                            if ( 0 == rc ) {
+                                self -> total++;
+                                merge_tree_update( tree, 0 == to_write -> rc, to_write -> key );
+                                running = merge_tree_winner( tree, &idx );
+                            } else {
+                                running = false;
+                            }
+                            bg_update_update( self -> gap, 1 );
+                            if ( 0 != rc ) {
+                                hlp_set_quitting();     /* helper.c */
+                            }
                         }
                     }
+                    release_merge_tree( tree ); /* merge_tree.c */
                 }
                 release_lookup_writer( writer ); /* lookup_writer.c */
             }
@@ -454,7 +470,7 @@ static rc_t background_vector_merger_thread_func( const KThread * thread, void *
         bg_vec_merge_src_t * batch = NULL;
         uint32_t count = 0;
 
-        /* Step 1 : get n = batch_size KVector's out of the in_q */
+        /* Step 1 : get n = batch_size lookup-stores out of the in_q */
         STATUS ( STAT_USR, "collecting batch" );
         rc = background_vector_merger_collect_batch( self, &batch, &count );
         STATUS ( STAT_USR, "done collectin batch: rc = %R, count = %u", rc, count );
@@ -539,7 +555,7 @@ rc_t seal_background_vector_merger( background_vector_merger_t * self ) {
     return rc;
 }
 
-rc_t push_to_background_vector_merger( background_vector_merger_t * self, KVector * store ) {
+rc_t push_to_background_vector_merger( background_vector_merger_t * self, struct lookup_store_t * store ) {
     rc_t rc;
     bool running = true;
     while ( running ) {
@@ -573,7 +589,7 @@ rc_t push_to_background_vector_merger( background_vector_merger_t * self, KVecto
     a batch of jobs. It then processes this batch by merge-sorting the content of
     the the files into a temporary file. The file-entries are key-value pairs with a 64-bit
     key which is composed from the SEQID and one bit: first or second read in a spot.
-    The value is the packed READ ( pack_4na() in lookup_writer.c ).
+    The value is the packed READ ( dna_pack_2na() in dna_pack.c ).
     The background-merger terminates when it's input-queue is sealed in perform_fastdump()
     in fastdump.c after all background-vector-merger-threads ( producers ) have been joined.
     The final output of the background-merger is a list of temporary files produced
@@ -584,6 +600,7 @@ typedef struct background_file_merger_t {
     const struct temp_dir_t * temp_dir;      /* needed to create temp. files */
     const char * lookup_filename;
     const char * index_filename;
+    uint64_t index_frequency;        /* key-distance between entries in the index-file */
     locked_file_list_t files;        /* a locked file-list */
     locked_value_t sealed;           /* flag to signal if the input is sealed */
     struct CleanupTask_t * cleanup_task;     /* add the produced temp_files here too */
@@ -669,6 +686,7 @@ static rc_t process_background_file_merger( background_file_merger_t * self ) {
                                         self -> dir,
                                         tmp_filename,   /* the output file */
                                         NULL,           /* opt. index_filename */
+                                        0,              /* no index: no frequency */
                                         batch_files,    /* the input files */
                                         self -> buf_size,
                                         num_src,
@@ -724,6 +742,7 @@ static rc_t process_final_background_file_merger( background_file_merger_t * sel
                                     self -> dir,
                                     self -> lookup_filename,   /* the output file */
                                     self -> index_filename,    /* opt. index_filename */
+                                    self -> index_frequency,   /* key-distance of the index-entries */
                                     batch_files,               /* the input files */
                                     self -> buf_size,
                                     num_src,
@@ -796,6 +815,7 @@ rc_t make_background_file_merger( background_file_merger_t ** merger,
         b -> temp_dir = args -> temp_dir;
         b -> lookup_filename = args -> lookup_filename;
         b -> index_filename = args -> index_filename;
+        b -> index_frequency = args -> index_frequency;
         b -> batch_size = args -> batch_size;
         b -> wait_time = args -> wait_time;
         b -> buf_size = args -> buf_size;
@@ -53,6 +53,7 @@ extern "C" {
 
 struct background_vector_merger_t;
 struct background_file_merger_t;
+struct lookup_store_t;
 
 /* ================================================================================= */
 
@@ -75,7 +76,8 @@ rc_t make_background_vector_merger( struct background_vector_merger_t ** merger,
 
 void tell_total_rowcount_to_vector_merger( struct background_vector_merger_t * self, uint64_t value );
 
-rc_t push_to_background_vector_merger( struct background_vector_merger_t * self, KVector * store );
+/* takes ownership of the ( sorted ) store, lookup_store.h */
+rc_t push_to_background_vector_merger( struct background_vector_merger_t * self, struct lookup_store_t * store );
 
 rc_t seal_background_vector_merger( struct background_vector_merger_t * self );
 
@@ -90,6 +92,7 @@ typedef struct file_merger_args_t {
     struct CleanupTask_t * cleanup_task;
     const char * lookup_filename;
     const char * index_filename;
+    uint64_t index_frequency;       /* key-distance between entries in the index, index.h */
     uint32_t batch_size;
     uint32_t wait_time;
     size_t buf_size;
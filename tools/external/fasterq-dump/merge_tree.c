@@ -0,0 +1,155 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "merge_tree.h"
+
+#include <stdlib.h>
+
+/* -----------------------------------------------------------------------------------
+    The tree is stored implicit: the leaves are at ( count + idx ), the parent of node n
+    is at ( n / 2 ). nodes[ n ] for 0 < n < count holds the loser of the match at node n,
+    nodes[ 0 ] holds the overall winner.
+   ----------------------------------------------------------------------------------- */
+
+typedef struct merge_tree_t {
+    uint64_t * keys;    /* current key of each source */
+    bool * valid;       /* is the source still producing keys */
+    uint32_t * nodes;   /* losers of each match, nodes[ 0 ] is the winner */
+    uint32_t * scratch; /* 2 * count winners, needed to build the tree */
+    uint32_t count;
+} merge_tree_t;
+
+rc_t make_merge_tree( merge_tree_t ** tree, uint32_t count ) {
+    rc_t rc = 0;
+    if ( NULL == tree || 0 == count ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+    } else {
+        merge_tree_t * t = calloc( 1, sizeof * t );
+        *tree = NULL;
+        if ( NULL == t ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        } else {
+            t -> count = count;
+            t -> keys  = calloc( count, sizeof * t -> keys );
+            t -> valid = calloc( count, sizeof * t -> valid );
+            t -> nodes = calloc( count, sizeof * t -> nodes );
+            t -> scratch = calloc( 2 * ( size_t )count, sizeof * t -> scratch );
+            if ( NULL == t -> keys || NULL == t -> valid || NULL == t -> nodes || NULL == t -> scratch ) {
+                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                release_merge_tree( t );
+            } else {
+                *tree = t;
+            }
+        }
+    }
+    return rc;
+}
+
+void release_merge_tree( merge_tree_t * self ) {
+    if ( NULL != self ) {
+        free( ( void * ) self -> keys );
+        free( ( void * ) self -> valid );
+        free( ( void * ) self -> nodes );
+        free( ( void * ) self -> scratch );
+        free( ( void * ) self );
+    }
+}
+
+void merge_tree_set( merge_tree_t * self, uint32_t idx, bool valid, uint64_t key ) {
+    if ( NULL != self && idx < self -> count ) {
+        self -> keys[ idx ] = key;
+        self -> valid[ idx ] = valid;
+    }
+}
+
+/* does source a win against source b ? */
+static bool merge_tree_beats( const merge_tree_t * self, uint32_t a, uint32_t b ) {
+    if ( !self -> valid[ a ] ) { return false; }
+    if ( !self -> valid[ b ] ) { return true; }
+    if ( self -> keys[ a ] != self -> keys[ b ] ) {
+        return self -> keys[ a ] < self -> keys[ b ];
+    }
+    return a < b;
+}
+
+void merge_tree_build( merge_tree_t * self ) {
+    if ( NULL != self ) {
+        uint32_t count = self -> count;
+        if ( 1 == count ) {
+            self -> nodes[ 0 ] = 0;
+        } else {
+            /* play all matches bottom up, remember the winners in the scratch-space */
+            uint32_t * winners = self -> scratch;
+            uint32_t n;
+            for ( n = 0; n < count; ++n ) {
+                winners[ count + n ] = n;
+            }
+            for ( n = count - 1; n > 0; --n ) {
+                uint32_t a = winners[ 2 * n ];
+                uint32_t b = winners[ 2 * n + 1 ];
+                if ( merge_tree_beats( self, a, b ) ) {
+                    winners[ n ] = a;
+                    self -> nodes[ n ] = b;
+                } else {
+                    winners[ n ] = b;
+                    self -> nodes[ n ] = a;
+                }
+            }
+            self -> nodes[ 0 ] = winners[ 1 ];
+        }
+    }
+}
+
+bool merge_tree_winner( const merge_tree_t * self, uint32_t * idx ) {
+    bool res = false;
+    if ( NULL != self && NULL != idx ) {
+        uint32_t winner = self -> nodes[ 0 ];
+        res = self -> valid[ winner ];
+        if ( res ) {
+            *idx = winner;
+        }
+    }
+    return res;
+}
+
+void merge_tree_update( merge_tree_t * self, bool valid, uint64_t key ) {
+    if ( NULL != self ) {
+        uint32_t winner = self -> nodes[ 0 ];
+        uint32_t n = ( self -> count + winner ) / 2;
+        self -> keys[ winner ] = key;
+        self -> valid[ winner ] = valid;
+        /* replay the matches on the path from the leaf to the root */
+        while ( n > 0 ) {
+            uint32_t loser = self -> nodes[ n ];
+            if ( merge_tree_beats( self, loser, winner ) ) {
+                self -> nodes[ n ] = winner;
+                winner = loser;
+            }
+            n /= 2;
+        }
+        self -> nodes[ 0 ] = winner;
+    }
+}
@@ -0,0 +1,79 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_merge_tree_
+#define _h_merge_tree_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+/* ================================================================================= */
+
+/* -----------------------------------------------------------------------------------
+    A loser-tree over k sources, used for k-way merging of sorted sequences of 64-bit
+    keys. Finding the source with the smallest key is O(1), replacing the key of the
+    winning source ( after it advanced to its next entry ) costs O( log k ).
+    Exhausted sources lose against every valid source. If 2 sources have the same key,
+    the one with the lower index wins - this keeps the merge stable.
+
+    usage:
+        make_merge_tree( &tree, k );
+        for each source : merge_tree_set( tree, idx, valid, key );
+        merge_tree_build( tree );
+        while ( merge_tree_winner( tree, &idx ) ) {
+            ... write source idx, advance it ...
+            merge_tree_update( tree, valid, key );
+        }
+        release_merge_tree( tree );
+   ----------------------------------------------------------------------------------- */
+
+struct merge_tree_t;
+
+rc_t make_merge_tree( struct merge_tree_t ** tree, uint32_t count );
+
+void release_merge_tree( struct merge_tree_t * self );
+
+/* set the initial state of source #idx, call merge_tree_build() after all sources have been set */
+void merge_tree_set( struct merge_tree_t * self, uint32_t idx, bool valid, uint64_t key );
+
+void merge_tree_build( struct merge_tree_t * self );
+
+/* returns false if all sources are exhausted, otherwise idx contains the winning source */
+bool merge_tree_winner( const struct merge_tree_t * self, uint32_t * idx );
+
+/* the winning source has advanced: give it the new key ( or valid = false if exhausted ) */
+void merge_tree_update( struct merge_tree_t * self, bool valid, uint64_t key );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
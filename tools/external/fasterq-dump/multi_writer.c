@@ -38,6 +38,14 @@
 #include "file_tools.h"
 #endif
 
+#ifndef _h_compressor_
+#include "compressor.h"
+#endif
+
+#ifndef _h_perf_report_
+#include "perf_report.h"
+#endif
+
 #ifndef _h_klib_time_
 #include <klib/time.h>
 #endif
@@ -59,6 +67,9 @@ typedef struct multi_writer_block_t
     char * data;
     size_t len;
     size_t available;
+    struct compressor_t * compressor;   /* created on first use, travels with the block */
+    const char * out;                   /* what the writer-thread writes: data or compressed data */
+    size_t out_len;
 } multi_writer_block_t;
 
 static multi_writer_block_t * mw_create_block( size_t size ) {
@@ -79,6 +90,7 @@ static multi_writer_block_t * mw_create_block( size_t size ) {
 
 static void mw_release_block( multi_writer_block_t * self ) {
     if ( NULL != self ) {
+        release_compressor( self -> compressor ); /* compressor.c */
         free( ( void * ) self -> data );
         free( ( void * ) self );
     }
@@ -127,6 +139,21 @@ bool mw_append_block( multi_writer_block_t * self, const char * data, size_t siz
     return res;
 }
 
+char * mw_reserve_block( multi_writer_block_t * self, size_t size ) {
+    char * res = NULL;
+    if ( NULL != self && ( self -> len + size ) < self -> available ) {
+        res = self -> data;
+        res += self -> len;
+    }
+    return res;
+}
+
+void mw_commit_block( multi_writer_block_t * self, size_t size ) {
+    if ( NULL != self ) {
+        self -> len += size;
+    }
+}
+
 static rc_t mw_push( KQueue * q, const void * item, uint32_t wait_time ) {
     rc_t rc;
     bool running = true;
@@ -164,11 +191,14 @@ typedef struct multi_writer_t {
     KQueue * empty_q;                   /* pre-allocated blocks to write to, client gets from it, thread puts to into it */
     KQueue * write_q;                   /* blocks to write, thread gets from it, client puts to into it */
     uint32_t q_wait_time;
+    compress_t compress;                /* blocks are compressed by the client-thread in mw_submit_block() */
+    uint32_t compress_level;
 } multi_writer_t;
 
 static rc_t mw_get_block( KQueue * q, uint32_t timeout, multi_writer_block_t ** block ) {
     rc_t rc = 0;
     bool running = true;
+    uint64_t t_start = perf_now_us(); /* perf_report.c */
     *block = NULL;
     while ( 0 == rc && running ) {
         struct timeout_t tm;
@@ -195,6 +225,7 @@ static rc_t mw_get_block( KQueue * q, uint32_t timeout, multi_writer_block_t **
             }
         }
     }
+    perf_add( pc_mw_client_wait_us, perf_now_us() - t_start ); /* perf_report.c */
     return rc;
 }
 
@@ -280,21 +311,27 @@ static rc_t mw_thread( const KThread * thread, void *data ) {
             ErrMsg( "copy_machine.c multi_writer_thread().TimeoutInit() -> %R", rc );
         } else {
             multi_writer_block_t * block;
+            uint64_t t_start = perf_now_us(); /* perf_report.c */
             rc = KQueuePop ( self -> write_q, ( void ** )&block, &tm );
+            perf_add( pc_mw_writer_wait_us, perf_now_us() - t_start ); /* perf_report.c */
             if ( 0 == rc ) {
                 /* we got a block to write out of the to_write_q */
+                perf_add( pc_output_bytes_written, block -> out_len );
 
                 if ( NULL != self -> f ) {
                     /* we have a file to write to... */
-                    if ( NULL != block -> data && block -> len > 0 ) {
+                    if ( NULL != block -> out && block -> out_len > 0 ) {
                         size_t num_written;
-                        rc = KFileWrite( self -> f, self -> pos,
-                                        block -> data, block -> len, &num_written );
+                        rc = KFileWriteAll( self -> f, self -> pos,
+                                        block -> out, block -> out_len, &num_written );
                         if ( 0 == rc ) { self -> pos += num_written;  }
                     }
-                } else {
+                } else if ( ct_none == self -> compress ) {
                     /* no file to print into, write to stdout! */
-                    rc = KOutMsg( "%.*s", block -> len, block -> data );
+                    rc = KOutMsg( "%.*s", block -> out_len, block -> out );
+                } else {
+                    /* compressed data is binary, bypass the formatting of KOutMsg() */
+                    rc = hlp_write_to_stdout( block -> out, block -> out_len ); /* helper.c */
                 }
                 if ( 0 == rc ) {
                     /* put the block back into the empty-q */
@@ -352,13 +389,22 @@ struct multi_writer_t * mw_create( KDirectory * dir,
                     size_t buf_size,
                     uint32_t q_wait_time,
                     uint32_t q_num_blocks,
-                    size_t q_block_size  ) {
+                    size_t q_block_size,
+                    compress_t compress,
+                    uint32_t compress_level ) {
     uint32_t wait_time = ( 0 == q_wait_time ) ? MULTI_WRITER_WAIT : q_wait_time;
     uint32_t num_blocks = ( 0 == q_num_blocks ) ? N_MULTI_WRITER_BLOCKS : q_num_blocks;
     uint32_t block_size = ( 0 == q_block_size ) ? MULTI_WRITER_BLOCK_SIZE : q_block_size;
-    multi_writer_t * res = calloc( 1, sizeof * res );
+    multi_writer_t * res = NULL;
+    if ( ct_none != compress && ct_unknown != compress && !compressor_available( compress ) ) { /* compressor.c */
+        ErrMsg( "mw_create() : compression '%s' is not available", hlp_compress_2_string( compress ) );
+    } else {
+        res = calloc( 1, sizeof * res );
+    }
     if ( NULL != res ) {
         rc_t rc = 0;
+        res -> compress = ( ct_unknown == compress ) ? ct_none : compress;
+        res -> compress_level = compress_level;
         if ( NULL != filename ) {
             rc = mw_create_file( res, dir, filename, buf_size );
             if ( 0 != rc ) {
@@ -418,10 +464,34 @@ struct multi_writer_block_t * mw_get_empty_block( struct multi_writer_t * self )
     return block;
 }
 
+/* runs in the thread of the caller: this is what makes the compression parallel */
+static rc_t mw_compress_block( struct multi_writer_t * self, multi_writer_block_t * block ) {
+    rc_t rc = 0;
+    if ( ct_none == self -> compress || 0 == block -> len ) {
+        block -> out = block -> data;
+        block -> out_len = block -> len;
+    } else {
+        if ( NULL == block -> compressor ) {
+            rc = make_compressor( &( block -> compressor ), self -> compress, self -> compress_level ); /* compressor.c */
+        }
+        if ( 0 == rc ) {
+            rc = compressor_run( block -> compressor, block -> data, block -> len,
+                                 &( block -> out ), &( block -> out_len ) ); /* compressor.c */
+        }
+        if ( 0 != rc ) {
+            ErrMsg( "mw_compress_block( %s ) -> %R", hlp_compress_2_string( self -> compress ), rc );
+        }
+    }
+    return rc;
+}
+
 bool mw_submit_block( struct multi_writer_t * self, struct multi_writer_block_t * block ) {
     bool res = false;
     if ( NULL != self && NULL != block ) {
-        rc_t rc =  mw_push( self -> write_q, block, self -> q_wait_time );
+        rc_t rc = mw_compress_block( self, block ); /* above */
+        if ( 0 == rc ) {
+            rc = mw_push( self -> write_q, block, self -> q_wait_time );
+        }
         res = ( 0 == rc );
     }
     return res;
@@ -440,7 +510,10 @@ static rc_t mw_write( struct multi_writer_t * self, const char * src, size_t siz
         if ( 0 == rc ) {
             if ( NULL != block ) {
                 if ( mw_multi_writer_block_write( block, src, size ) ) {
-                    rc =  mw_push( self -> write_q, block, self -> q_wait_time );
+                    rc = mw_compress_block( self, block ); /* above */
+                    if ( 0 == rc ) {
+                        rc = mw_push( self -> write_q, block, self -> q_wait_time );
+                    }
                 } else {
                     rc = RC( rcExe, rcFile, rcPacking, rcConstraint, rcViolated );
                     ErrMsg( "mw_write().mw_multi_writer_block_write() failed -> %R", rc );
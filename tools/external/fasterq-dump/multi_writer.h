@@ -39,12 +39,21 @@ extern "C" {
 #include <kfs/directory.h>
 #endif
 
+#ifndef _h_helper_
+#include "helper.h"
+#endif
+
 struct multi_writer_block_t;
 
 bool mw_append_block( struct multi_writer_block_t * self, const char * data, size_t len );
 
 bool mw_expand_block( struct multi_writer_block_t * self, size_t size );
 
+/* room for size bytes at the end of the block ( NULL if they do not fit ),
+   to be written into directly and committed with the number of bytes actually used */
+char * mw_reserve_block( struct multi_writer_block_t * self, size_t size );
+void mw_commit_block( struct multi_writer_block_t * self, size_t size );
+
 struct multi_writer_t;
 
 struct multi_writer_t * mw_create( KDirectory * dir,
@@ -52,7 +61,11 @@ struct multi_writer_t * mw_create( KDirectory * dir,
                                     size_t buf_size,
                                     uint32_t q_wait_time,
                                     uint32_t q_num_blocks,
-                                    size_t q_block_size  );
+                                    size_t q_block_size,
+                                    compress_t compress,
+                                    uint32_t compress_level );
+/* if compress is ct_gzip/ct_zstd each submitted block is compressed in the thread
+   submitting it into a gzip-member / zstd-frame ( compressor.h ) */
 
 void mw_release( struct multi_writer_t * self );
 
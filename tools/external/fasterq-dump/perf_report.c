@@ -0,0 +1,457 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "perf_report.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#ifndef _h_helper_
+#include "helper.h"   /* hlp_now_us, hlp_make_thread */
+#endif
+
+#ifndef _h_kfs_directory_
+#include <kfs/directory.h>
+#endif
+
+#ifndef _h_kfs_file_
+#include <kfs/file.h>
+#endif
+
+#ifndef _h_kproc_thread_
+#include <kproc/thread.h>
+#endif
+
+#ifndef _h_klib_time_
+#include <klib/time.h>
+#endif
+
+#ifndef _h_klib_printf_
+#include <klib/printf.h>
+#endif
+
+#ifndef _h_atomic_
+#include <atomic.h>
+#endif
+
+#ifndef _h_atomic64_
+#include <atomic64.h>
+#endif
+
+#include <stdarg.h>
+
+#ifdef WINDOWS
+/* no getrusage() on WINDOWS: cpu-time and peak-rss are reported as 0 */
+#else
+#include <sys/resource.h>
+#endif
+
+#define PERF_MAX_THREADS 128
+#define PERF_LINE_SIZE ( 1024 * 1024 )
+
+static const char * stage_names[ ps_count ] = {
+    "inspect", "lookup", "merge", "join", "concat"
+};
+
+static const char * counter_names[ pc_count ] = {
+    "lookup_rows",
+    "lookup_bytes_read",
+    "lookup_queue_wait_us",
+    "temp_bytes_written",
+    "join_spots",
+    "join_bytes_written",
+    "lookup_seeks",
+    "lookup_full_scans",
+    "lookup_bytes_scanned",
+    "mw_client_wait_us",
+    "mw_writer_wait_us",
+    "cm_reader_wait_us",
+    "cm_writer_wait_us",
+    "output_bytes_written"
+};
+
+typedef struct perf_thread_t {
+    uint64_t rows;
+    uint64_t elapsed_us;
+    bool used;
+} perf_thread_t;
+
+typedef struct perf_stage_data_t {
+    uint64_t start_us;
+    uint64_t wall_us;
+    uint64_t start_cpu_us;
+    uint64_t cpu_us;
+    uint64_t rows;
+    atomic_t state;     /* 0 ... not started, 1 ... running, 2 ... finished ( read by the sampler ) */
+    perf_thread_t threads[ PERF_MAX_THREADS ];
+} perf_stage_data_t;
+
+typedef struct perf_report_t {
+    KDirectory * dir;
+    KFile * f;
+    uint64_t file_pos;
+    KThread * thread;
+    const char * accession;
+    uint64_t start_us;
+    uint32_t interval_s;
+    atomic_t done;
+    atomic_t active;
+    atomic64_t counters[ pc_count ];
+    perf_stage_data_t stages[ ps_count ];
+    char * line;
+    size_t line_len;
+} perf_report_t;
+
+/* the state is process-wide like the quit-flag in helper.c */
+static perf_report_t perf;
+
+bool perf_enabled( void ) {
+    return ( 0 != atomic_read( &perf . active ) );
+}
+
+uint64_t perf_now_us( void ) {
+    return perf_enabled() ? hlp_now_us() : 0; /* helper.c */
+}
+
+void perf_add( perf_counter_t counter, uint64_t value ) {
+    if ( counter < pc_count && 0 != value && perf_enabled() ) {
+        atomic64_read_and_add( &perf . counters[ counter ], value );
+    }
+}
+
+static uint64_t perf_cpu_us( void ) {
+#ifdef WINDOWS
+    return 0;
+#else
+    uint64_t res = 0;
+    struct rusage ru;
+    if ( 0 == getrusage( RUSAGE_SELF, &ru ) ) {
+        res  = ( ( uint64_t )ru . ru_utime . tv_sec * 1000000 ) + ru . ru_utime . tv_usec;
+        res += ( ( uint64_t )ru . ru_stime . tv_sec * 1000000 ) + ru . ru_stime . tv_usec;
+    }
+    return res;
+#endif
+}
+
+static uint64_t perf_peak_rss_kb( void ) {
+#ifdef WINDOWS
+    return 0;
+#else
+    uint64_t res = 0;
+    struct rusage ru;
+    if ( 0 == getrusage( RUSAGE_SELF, &ru ) ) {
+#ifdef MAC
+        res = ( uint64_t )ru . ru_maxrss / 1024;   /* bytes on MAC */
+#else
+        res = ( uint64_t )ru . ru_maxrss;          /* kilobytes on Linux */
+#endif
+    }
+    return res;
+#endif
+}
+
+void perf_stage_begin( perf_stage_t stage ) {
+    if ( stage < ps_count && perf_enabled() ) {
+        perf_stage_data_t * s = &perf . stages[ stage ];
+        s -> start_us = hlp_now_us(); /* helper.c */
+        s -> start_cpu_us = perf_cpu_us();
+        atomic_set( &s -> state, 1 );
+    }
+}
+
+void perf_stage_end( perf_stage_t stage, uint64_t rows ) {
+    if ( stage < ps_count && perf_enabled() ) {
+        perf_stage_data_t * s = &perf . stages[ stage ];
+        if ( 1 == atomic_read( &s -> state ) ) {
+            s -> wall_us = hlp_now_us() - s -> start_us; /* helper.c */
+            s -> cpu_us = perf_cpu_us() - s -> start_cpu_us;
+            s -> rows = rows;
+            atomic_set( &s -> state, 2 );
+        }
+    }
+}
+
+void perf_thread_rate( perf_stage_t stage, uint32_t thread_id, uint64_t rows, uint64_t elapsed_us ) {
+    if ( stage < ps_count && thread_id < PERF_MAX_THREADS && perf_enabled() ) {
+        /* each thread writes only its own slot, the slot is read after the thread is joined */
+        perf_thread_t * t = &perf . stages[ stage ] . threads[ thread_id ];
+        t -> rows += rows;
+        t -> elapsed_us += elapsed_us;
+        t -> used = true;
+    }
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+static uint64_t rate_per_sec( uint64_t rows, uint64_t elapsed_us ) {
+    return ( elapsed_us > 0 ) ? ( rows * 1000000 ) / elapsed_us : 0;
+}
+
+static rc_t perf_append( const char * fmt, ... ) {
+    rc_t rc = 0;
+    size_t num_writ = 0;
+    va_list args;
+    va_start( args, fmt );
+    rc = string_vprintf( &perf . line[ perf . line_len ], PERF_LINE_SIZE - perf . line_len, &num_writ, fmt, args );
+    va_end( args );
+    if ( 0 != rc ) {
+        ErrMsg( "perf_report.c perf_append().string_vprintf() -> %R", rc );
+    } else {
+        perf . line_len += num_writ;
+    }
+    return rc;
+}
+
+/* accession-paths can contain backslashes ( WINDOWS ) or quotes */
+static rc_t perf_append_json_string( const char * key, const char * value ) {
+    rc_t rc = perf_append( "\"%s\":\"", key );
+    const char * p = value;
+    while ( 0 == rc && 0 != *p ) {
+        if ( '"' == *p || '\\' == *p ) {
+            rc = perf_append( "\\%c", *p );
+        } else if ( ( unsigned char )*p >= 0x20 ) {
+            rc = perf_append( "%c", *p );
+        }
+        p++;
+    }
+    if ( 0 == rc ) {
+        rc = perf_append( "\"," );
+    }
+    return rc;
+}
+
+static rc_t perf_append_counters( void ) {
+    rc_t rc = perf_append( "\"counters\":{" );
+    uint32_t idx;
+    for ( idx = 0; 0 == rc && idx < pc_count; ++idx ) {
+        rc = perf_append( "%s\"%s\":%lu",
+                          idx > 0 ? "," : "",
+                          counter_names[ idx ],
+                          atomic64_read( &perf . counters[ idx ] ) );
+    }
+    if ( 0 == rc ) {
+        rc = perf_append( "}" );
+    }
+    return rc;
+}
+
+static rc_t perf_append_threads( const perf_stage_data_t * s ) {
+    rc_t rc = perf_append( "\"threads\":[" );
+    uint32_t idx;
+    bool first = true;
+    for ( idx = 0; 0 == rc && idx < PERF_MAX_THREADS; ++idx ) {
+        const perf_thread_t * t = &s -> threads[ idx ];
+        if ( t -> used ) {
+            rc = perf_append( "%s{\"id\":%u,\"rows\":%lu,\"wall_us\":%lu,\"rows_per_sec\":%lu}",
+                              first ? "" : ",",
+                              idx, t -> rows, t -> elapsed_us,
+                              rate_per_sec( t -> rows, t -> elapsed_us ) );
+            first = false;
+        }
+    }
+    if ( 0 == rc ) {
+        rc = perf_append( "]" );
+    }
+    return rc;
+}
+
+static rc_t perf_append_stages( void ) {
+    rc_t rc = perf_append( "\"stages\":[" );
+    uint32_t idx;
+    bool first = true;
+    for ( idx = 0; 0 == rc && idx < ps_count; ++idx ) {
+        const perf_stage_data_t * s = &perf . stages[ idx ];
+        if ( 2 == atomic_read( &s -> state ) ) {
+            rc = perf_append( "%s{\"name\":\"%s\",\"wall_us\":%lu,\"cpu_us\":%lu,\"rows\":%lu,\"rows_per_sec\":%lu,",
+                              first ? "" : ",",
+                              stage_names[ idx ], s -> wall_us, s -> cpu_us, s -> rows,
+                              rate_per_sec( s -> rows, s -> wall_us ) );
+            if ( 0 == rc ) {
+                rc = perf_append_threads( s );
+            }
+            if ( 0 == rc ) {
+                rc = perf_append( "}" );
+            }
+            first = false;
+        }
+    }
+    if ( 0 == rc ) {
+        rc = perf_append( "]" );
+    }
+    return rc;
+}
+
+static const char * perf_running_stage( void ) {
+    const char * res = "none";
+    uint32_t idx;
+    for ( idx = 0; idx < ps_count; ++idx ) {
+        if ( 1 == atomic_read( &perf . stages[ idx ] . state ) ) {
+            res = stage_names[ idx ];
+        }
+    }
+    return res;
+}
+
+static rc_t perf_write_line( void ) {
+    rc_t rc = perf_append( "}\n" );
+    if ( 0 == rc ) {
+        size_t num_writ;
+        rc = KFileWriteAll( perf . f, perf . file_pos, perf . line, perf . line_len, &num_writ );
+        if ( 0 != rc ) {
+            ErrMsg( "perf_report.c perf_write_line().KFileWriteAll( at %lu ) -> %R", perf . file_pos, rc );
+        } else {
+            perf . file_pos += num_writ;
+        }
+    }
+    perf . line_len = 0;
+    return rc;
+}
+
+static rc_t perf_write_sample( void ) {
+    rc_t rc = perf_append( "{\"type\":\"sample\",\"wall_us\":%lu,\"cpu_us\":%lu,\"rss_kb\":%lu,\"stage\":\"%s\",",
+                           hlp_now_us() - perf . start_us, /* helper.c */
+                           perf_cpu_us(),
+                           perf_peak_rss_kb(),
+                           perf_running_stage() );
+    if ( 0 == rc ) {
+        rc = perf_append_counters();
+    }
+    if ( 0 == rc ) {
+        rc = perf_write_line();
+    }
+    return rc;
+}
+
+static rc_t perf_write_report( uint32_t num_threads, rc_t tool_rc ) {
+    rc_t rc = perf_append( "{\"type\":\"report\"," );
+    if ( 0 == rc ) {
+        rc = perf_append_json_string( "accession", perf . accession );
+    }
+    if ( 0 == rc ) {
+        rc = perf_append( "\"rc\":%u,\"threads\":%u,\"wall_us\":%lu,\"cpu_us\":%lu,\"peak_rss_kb\":%lu,",
+                          tool_rc, num_threads,
+                          hlp_now_us() - perf . start_us, /* helper.c */
+                          perf_cpu_us(),
+                          perf_peak_rss_kb() );
+    }
+    if ( 0 == rc ) {
+        rc = perf_append_stages();
+    }
+    if ( 0 == rc ) {
+        rc = perf_append( "," );
+    }
+    if ( 0 == rc ) {
+        rc = perf_append_counters();
+    }
+    if ( 0 == rc ) {
+        rc = perf_write_line();
+    }
+    return rc;
+}
+
+static rc_t perf_sampler_thread( const KThread * self, void * data ) {
+    rc_t rc = 0;
+    uint32_t ms_slept = 0;
+    const uint32_t interval_ms = perf . interval_s * 1000;
+    while ( 0 == rc && 0 == atomic_read( &perf . done ) ) {
+        KSleepMs( 100 );
+        ms_slept += 100;
+        if ( ms_slept >= interval_ms ) {
+            rc = perf_write_sample();
+            ms_slept = 0;
+        }
+    }
+    return rc;
+}
+
+rc_t perf_start( const char * filename, uint32_t interval_s, const char * accession ) {
+    rc_t rc = 0;
+    if ( NULL == filename ) {
+        rc = RC( rcExe, rcFile, rcCreating, rcParam, rcNull );
+        ErrMsg( "perf_report.c perf_start() -> %R", rc );
+    } else {
+        perf . line = malloc( PERF_LINE_SIZE );
+        if ( NULL == perf . line ) {
+            rc = RC( rcExe, rcFile, rcCreating, rcMemory, rcExhausted );
+            ErrMsg( "perf_report.c perf_start().malloc( %d ) -> %R", PERF_LINE_SIZE, rc );
+        } else {
+            rc = KDirectoryNativeDir( &perf . dir );
+            if ( 0 != rc ) {
+                ErrMsg( "perf_report.c perf_start().KDirectoryNativeDir() -> %R", rc );
+            } else {
+                rc = KDirectoryCreateFile( perf . dir, &perf . f, false, 0664, kcmInit | kcmParents, "%s", filename );
+                if ( 0 != rc ) {
+                    ErrMsg( "perf_report.c perf_start().KDirectoryCreateFile( '%s' ) -> %R", filename, rc );
+                }
+            }
+        }
+    }
+    if ( 0 == rc ) {
+        perf . accession = ( NULL != accession ) ? accession : "";
+        perf . start_us = hlp_now_us(); /* helper.c */
+        perf . interval_s = interval_s;
+        atomic_set( &perf . active, 1 );
+        if ( interval_s > 0 ) {
+            rc = hlp_make_thread( &perf . thread, perf_sampler_thread, NULL, THREAD_DFLT_STACK_SIZE ); /* helper.c */
+            if ( 0 != rc ) {
+                ErrMsg( "perf_report.c perf_start().hlp_make_thread() -> %R", rc );
+            }
+        }
+    }
+    return rc;
+}
+
+rc_t perf_finish( uint32_t num_threads, rc_t tool_rc ) {
+    rc_t rc = 0;
+    if ( NULL != perf . thread ) {
+        atomic_set( &perf . done, 1 );
+        KThreadWait( perf . thread, NULL );
+        KThreadRelease( perf . thread );
+        perf . thread = NULL;
+    }
+    if ( NULL != perf . f ) {
+        rc = perf_write_report( num_threads, tool_rc );
+        {
+            rc_t rc2 = KFileRelease( perf . f );
+            if ( 0 != rc2 ) {
+                ErrMsg( "perf_report.c perf_finish().KFileRelease() -> %R", rc2 );
+                rc = ( 0 == rc ) ? rc2 : rc;
+            }
+            perf . f = NULL;
+        }
+    }
+    if ( NULL != perf . dir ) {
+        KDirectoryRelease( perf . dir );
+        perf . dir = NULL;
+    }
+    if ( NULL != perf . line ) {
+        free( perf . line );
+        perf . line = NULL;
+    }
+    atomic_set( &perf . active, 0 );
+    return rc;
+}
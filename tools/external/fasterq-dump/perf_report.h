@@ -0,0 +1,101 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_perf_report_
+#define _h_perf_report_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+/* -----------------------------------------------------------------------------------
+    A machine-readable performance report: wall- and cpu-time per stage, bytes read
+    and written, the time spent waiting on the queues of multi_writer.c, copy_machine.c
+    and merge_sorter.c, the seek-statistics of the lookup-readers, and row-rates per
+    thread. The counters are process-wide ( like the quit-flag in helper.c ), so the
+    modules just add to them without passing a context around.
+
+    The report is written as JSON-lines: with a sampling-interval one line of type
+    "sample" every n seconds while the tool runs, at exit one line of type "report".
+   ----------------------------------------------------------------------------------- */
+
+typedef enum perf_stage_t {
+    ps_inspect = 0,
+    ps_lookup,
+    ps_merge,
+    ps_join,
+    ps_concat,
+    ps_count
+} perf_stage_t;
+
+typedef enum perf_counter_t {
+    pc_lookup_rows = 0,         /* alignments put into the lookup-stores, sorter.c */
+    pc_lookup_bytes_read,       /* bases read from RAW_READ, sorter.c */
+    pc_lookup_queue_wait_us,    /* producers blocked on the queue of the vector-merger */
+    pc_temp_bytes_written,      /* lookup-files written into the temp-directory, lookup_writer.c */
+    pc_join_spots,              /* spots read by the join-threads */
+    pc_join_bytes_written,      /* part-files / multi-writer-blocks ( before concatenation ) */
+    pc_lookup_seeks,            /* lookup_reader.c : seeks of the join-threads */
+    pc_lookup_full_scans,       /* lookup_reader.c : seeks that had to scan from the start */
+    pc_lookup_bytes_scanned,    /* lookup_reader.c : bytes skipped while scanning */
+    pc_mw_client_wait_us,       /* multi_writer.c : join-threads waiting for an empty block */
+    pc_mw_writer_wait_us,       /* multi_writer.c : the writer waiting for a full block */
+    pc_cm_reader_wait_us,       /* copy_machine.c : the reader waiting for an empty block */
+    pc_cm_writer_wait_us,       /* copy_machine.c : the writer waiting for a full block */
+    pc_output_bytes_written,    /* the final output-file(s) */
+    pc_count
+} perf_counter_t;
+
+/* opens the report-file, starts the sampling-thread if interval_s > 0 */
+rc_t perf_start( const char * filename, uint32_t interval_s, const char * accession );
+
+/* stops the sampling-thread, writes the final report, closes the file */
+rc_t perf_finish( uint32_t num_threads, rc_t tool_rc );
+
+/* are we collecting at all? the modules can skip measuring time if not */
+bool perf_enabled( void );
+
+/* the timestamp for the hooks: hlp_now_us() if the report is requested, 0 if not,
+   so an unrequested report does not cost a clock-read per hook */
+uint64_t perf_now_us( void );
+
+void perf_add( perf_counter_t counter, uint64_t value );
+
+void perf_stage_begin( perf_stage_t stage );
+void perf_stage_end( perf_stage_t stage, uint64_t rows );
+
+/* the rows a thread of a stage has processed, and how long it took */
+void perf_thread_rate( perf_stage_t stage, uint32_t thread_id, uint64_t rows, uint64_t elapsed_us );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
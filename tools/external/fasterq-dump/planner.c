@@ -0,0 +1,170 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "planner.h"
+
+#include <string.h>     /* memset() */
+
+#ifndef _h_err_msg_
+#include "err_msg.h"    /* InfoMsg() */
+#endif
+
+#ifdef WINDOWS
+/* no cpu-count on WINDOWS: the default thread-count is used */
+#else
+#include <unistd.h>
+#endif
+
+#define PLAN_DFLT_THREADS 6                             /* if the cpu-count is unknown */
+#define PLAN_MIN_THREADS 2
+#define PLAN_MAX_AUTO_THREADS 32
+#define PLAN_MIN_ROWS_PER_SLICE 50000                   /* less is not worth opening a cursor */
+#define PLAN_DFLT_MEM_LIMIT ( 1024L * 1024 * 50 )
+#define PLAN_MAX_MEM_LIMIT ( 1024L * 1024 * 1024 )
+#define PLAN_RAM_FRACTION 4                             /* the lookup-stores get 1/4 of the RAM */
+#define PLAN_SLOW_TEMP_SPEED ( 1024L * 1024 * 200 )     /* bytes per second */
+#define PLAN_MAX_MERGE_BATCH 64                         /* open files per merge */
+#define PLAN_LOOKUP_BYTES_PER_ROW 12                    /* key + base-count per entry */
+
+uint32_t plan_cpu_count( void ) {
+    uint32_t res = 0;
+#ifndef WINDOWS
+    long n = sysconf( _SC_NPROCESSORS_ONLN );
+    if ( n > 0 ) { res = ( uint32_t )n; }
+#endif
+    return res;
+}
+
+static uint64_t plan_div_up( uint64_t a, uint64_t b ) {
+    return ( 0 == b ) ? a : ( a + b - 1 ) / b;
+}
+
+/* a planned thread gets at least PLAN_MIN_ROWS_PER_SLICE rows,
+   a requested thread-count is only limited by the rows ( each slice needs one ) */
+static uint32_t plan_threads_for_rows( uint32_t threads, uint64_t rows, bool automatic ) {
+    uint64_t max_threads = automatic ? rows / PLAN_MIN_ROWS_PER_SLICE : rows;
+    if ( max_threads < 1 ) { max_threads = 1; }
+    return ( threads > max_threads ) ? ( uint32_t )max_threads : threads;
+}
+
+void plan_make( const plan_input_t * input, plan_t * plan ) {
+    if ( NULL != input && NULL != plan ) {
+        uint32_t threads;
+
+        memset( plan, 0, sizeof * plan );
+        plan -> cpu_count = input -> cpu_count;
+        plan -> temp_write_speed = input -> temp_write_speed;
+        plan -> automatic = ( 0 == input -> requested_threads );
+        if ( plan -> automatic ) {
+            threads = ( input -> cpu_count > 0 ) ? input -> cpu_count : PLAN_DFLT_THREADS;
+            if ( threads > PLAN_MAX_AUTO_THREADS ) { threads = PLAN_MAX_AUTO_THREADS; }
+        } else {
+            threads = input -> requested_threads;
+        }
+        if ( threads < PLAN_MIN_THREADS ) { threads = PLAN_MIN_THREADS; }
+        plan -> threads = threads;
+
+        /* the join-phase: one slice per thread */
+        plan -> join_threads = plan_threads_for_rows( threads, input -> seq_rows, plan -> automatic );
+        plan -> join_rows_per_slice = plan_div_up( input -> seq_rows, plan -> join_threads );
+
+        plan -> mem_limit = ( input -> requested_mem_limit > 0 ) ? input -> requested_mem_limit : PLAN_DFLT_MEM_LIMIT;
+        plan -> merge_batch = threads;
+        if ( input -> sorted_csra ) {
+            uint64_t stores;
+
+            /* the vector- and the file-merger run in the background: leave a core for them */
+            uint32_t lt = ( threads > 4 ) ? threads - 1 : threads;
+            plan -> lookup_threads = plan_threads_for_rows( lt, input -> align_rows, plan -> automatic );
+            plan -> lookup_rows_per_slice = plan_div_up( input -> align_rows, plan -> lookup_threads );
+
+            /* 2na-packed bases plus key and length for each alignment, lookup_store.c */
+            plan -> est_lookup_size = ( input -> align_bases / 4 ) +
+                                      ( input -> align_rows * PLAN_LOOKUP_BYTES_PER_ROW );
+
+            if ( 0 == input -> requested_mem_limit && input -> total_ram > 0 ) {
+                /* as much as the RAM allows, but not more than the share of the lookup-data of each producer:
+                   the bigger the stores, the less there is to merge */
+                uint64_t mem = ( input -> total_ram / PLAN_RAM_FRACTION ) / plan -> lookup_threads;
+                uint64_t share = plan_div_up( plan -> est_lookup_size, plan -> lookup_threads );
+                if ( mem > share ) { mem = share; }
+                if ( mem > PLAN_MAX_MEM_LIMIT ) { mem = PLAN_MAX_MEM_LIMIT; }
+                if ( mem < PLAN_DFLT_MEM_LIMIT ) { mem = PLAN_DFLT_MEM_LIMIT; }
+                plan -> mem_limit = ( size_t )mem;
+            }
+
+            /* every merge-pass reads and writes all of the lookup-data again:
+               on a slow temp-directory merge more at once, to have fewer passes */
+            stores = plan_div_up( plan -> est_lookup_size, plan -> mem_limit );
+            if ( input -> temp_write_speed > 0 && input -> temp_write_speed < PLAN_SLOW_TEMP_SPEED &&
+                 stores > plan -> merge_batch ) {
+                plan -> merge_batch = ( stores > PLAN_MAX_MERGE_BATCH ) ? PLAN_MAX_MERGE_BATCH : ( uint32_t )stores;
+            }
+        }
+    }
+}
+
+rc_t plan_print( const plan_t * plan ) {
+    rc_t rc = 0;
+    if ( NULL != plan ) {
+        rc = InfoMsg( "plan         : %s, %u threads ( %u cpus )",
+                      plan -> automatic ? "automatic" : "requested", plan -> threads, plan -> cpu_count );
+        if ( 0 == rc && plan -> lookup_threads > 0 ) {
+            rc = InfoMsg( "plan lookup  : %u threads x %,lu rows, mem-limit %,lu bytes, est. %,lu bytes",
+                          plan -> lookup_threads, plan -> lookup_rows_per_slice,
+                          plan -> mem_limit, plan -> est_lookup_size );
+            if ( 0 == rc ) {
+                rc = InfoMsg( "plan merge   : batch of %u", plan -> merge_batch );
+            }
+        }
+        if ( 0 == rc ) {
+            rc = InfoMsg( "plan join    : %u threads x %,lu rows",
+                          plan -> join_threads, plan -> join_rows_per_slice );
+        }
+        if ( 0 == rc && plan -> temp_write_speed > 0 ) {
+            rc = InfoMsg( "plan temp    : %,lu MB/s", plan -> temp_write_speed / ( 1024 * 1024 ) );
+        }
+    }
+    return rc;
+}
+
+rc_t plan_print_stage( const char * stage, uint64_t items, uint64_t bytes, uint64_t elapsed_us ) {
+    rc_t rc;
+    uint64_t ms = elapsed_us / 1000;
+    uint64_t us = ( 0 == elapsed_us ) ? 1 : elapsed_us;
+    uint64_t rows_per_sec = ( uint64_t )( ( ( double )items * 1000000 ) / us );
+    uint64_t mb_per_sec = bytes / us;   /* bytes per micro-second == MB per second */
+    if ( items > 0 && bytes > 0 ) {
+        rc = InfoMsg( "stage %-7s: %,lu ms, %,lu rows/s, %,lu MB/s", stage, ms, rows_per_sec, mb_per_sec );
+    } else if ( items > 0 ) {
+        rc = InfoMsg( "stage %-7s: %,lu ms, %,lu rows/s", stage, ms, rows_per_sec );
+    } else if ( bytes > 0 ) {
+        rc = InfoMsg( "stage %-7s: %,lu ms, %,lu MB/s", stage, ms, mb_per_sec );
+    } else {
+        rc = InfoMsg( "stage %-7s: %,lu ms", stage, ms );
+    }
+    return rc;
+}
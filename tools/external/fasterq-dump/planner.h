@@ -0,0 +1,98 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_planner_
+#define _h_planner_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+/* ================================================================================= */
+
+/* -----------------------------------------------------------------------------------
+    The planner decides how many threads each stage gets, how big the row-ranges
+    ( slices ) of the threads are and how much memory the lookup-producers can use.
+    Its input is what the inspector found out about the accession, the number of
+    CPUs, the total RAM and the measured write-speed of the temp-directory.
+    Values the user has given explicitly ( -e, -m ) are used as they are.
+
+    cSRA ( sorted ):  lookup-producers ---> vector-merger ---> file-merger ---> join-threads
+                      ( lookup_threads )   ( 2 background-threads,         ( join_threads )
+                                             merge_batch stores/files )
+    everything else:  join-threads only
+   ----------------------------------------------------------------------------------- */
+
+typedef struct plan_input_t {
+    uint32_t requested_threads;     /* -e from the commandline, 0 ... let the planner decide */
+    size_t requested_mem_limit;     /* -m from the commandline, 0 ... let the planner decide */
+    uint32_t cpu_count;             /* 0 ... unknown */
+    uint64_t total_ram;             /* 0 ... unknown */
+    uint64_t temp_write_speed;      /* bytes per second, 0 ... not measured */
+    uint64_t seq_rows;              /* from the inspector */
+    uint64_t align_rows;
+    uint64_t align_bases;
+    bool sorted_csra;               /* the lookup-table has to be produced and merged */
+} plan_input_t;
+
+typedef struct plan_t {
+    uint32_t threads;               /* the overall thread-count */
+    uint32_t lookup_threads;        /* producers of the lookup-table ( sorter.c ) */
+    uint32_t merge_batch;           /* stores/files merged at once ( merge_sorter.c ) */
+    uint32_t join_threads;          /* the threads producing the output */
+    size_t mem_limit;               /* per lookup-producer */
+    uint64_t lookup_rows_per_slice; /* row-range of each lookup-producer */
+    uint64_t join_rows_per_slice;   /* row-range of each join-thread */
+    uint64_t est_lookup_size;       /* estimated size of the lookup-file */
+    uint64_t temp_write_speed;      /* what the plan was based on */
+    uint32_t cpu_count;
+    bool automatic;                 /* the thread-count was chosen by the planner */
+} plan_t;
+
+/* the number of online CPUs, 0 if unknown */
+uint32_t plan_cpu_count( void );
+
+void plan_make( const plan_input_t * input, plan_t * plan );
+
+/* logs the plan at info-level */
+rc_t plan_print( const plan_t * plan );
+
+/* logs the throughput of one stage at info-level ( items/bytes can be 0 if not known ) */
+rc_t plan_print_stage( const char * stage, uint64_t items, uint64_t bytes, uint64_t elapsed_us );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
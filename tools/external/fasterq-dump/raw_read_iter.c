@@ -34,8 +34,14 @@
 #include "file_printer.h"
 #endif
 
+#ifndef _h_row_selection_
+#include "row_selection.h"
+#endif
+
 typedef struct raw_read_iter_t {
     struct cmn_iter_t * cmn;
+    const struct row_selection_t * spots;  /* only alignments of these spots, NULL for all */
+    uint64_t skipped;                       /* alignments of other spots */
     uint32_t seq_spot_id, seq_read_id, read_id;
 } raw_read_iter_t;
 
@@ -55,7 +61,11 @@ rc_t make_raw_read_iter( cmn_iter_params_t * params, struct raw_read_iter_t ** i
         rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
         ErrMsg( "make_raw_read_iter.calloc( %d ) -> %R", ( sizeof * i ), rc );
     } else {
-        rc = cmn_iter_make( params, "PRIMARY_ALIGNMENT", &i -> cmn );
+        /* the selection is about rows of the SEQUENCE-table, here it filters by SEQ_SPOT_ID */
+        cmn_iter_params_t cp = *params;
+        cp . selection = NULL;
+        i -> spots = params -> selection;
+        rc = cmn_iter_make( &cp, "PRIMARY_ALIGNMENT", &i -> cmn );
         if ( 0 == rc ) {
             rc = cmn_iter_add_column( i -> cmn, "SEQ_SPOT_ID", &i -> seq_spot_id );
         }
@@ -81,10 +91,19 @@ bool get_from_raw_read_iter( struct raw_read_iter_t * iter, raw_read_rec_t * rec
     bool res = cmn_iter_get_next( iter -> cmn, rc );
     if ( res ) {
         *rc = cmn_iter_read_uint64( iter -> cmn, iter -> seq_spot_id, &rec -> seq_spot_id );
-        if ( 0 == *rc ) {
+        /* skip the alignments of unselected spots before reading the READ-column */
+        while ( res && 0 == *rc && NULL != iter -> spots &&
+                !rsel_contains( iter -> spots, ( int64_t )rec -> seq_spot_id ) ) {
+            iter -> skipped++;
+            res = cmn_iter_get_next( iter -> cmn, rc );
+            if ( res ) {
+                *rc = cmn_iter_read_uint64( iter -> cmn, iter -> seq_spot_id, &rec -> seq_spot_id );
+            }
+        }
+        if ( res && 0 == *rc ) {
             *rc = cmn_iter_read_uint32( iter -> cmn, iter -> seq_read_id, &rec -> seq_read_id );
         }
-        if ( 0 == *rc ) {
+        if ( res && 0 == *rc ) {
             *rc = cmn_iter_read_String( iter -> cmn, iter -> read_id, &rec -> read );
         }
     }
@@ -95,6 +114,10 @@ uint64_t get_row_count_of_raw_read( struct raw_read_iter_t * iter ) {
     return cmn_iter_get_row_count( iter -> cmn );
 }
 
+uint64_t get_skipped_of_raw_read( const struct raw_read_iter_t * iter ) {
+    return ( NULL == iter ) ? 0 : iter -> skipped;
+}
+
 rc_t write_out_prim( const KDirectory *dir, size_t buf_size, size_t cursor_cache,
                      const char * accession_short, const char * accession_path,
                      const char * output_file ) {
@@ -108,6 +131,7 @@ rc_t write_out_prim( const KDirectory *dir, size_t buf_size, size_t cursor_cache
     params . first_row = 0;
     params . row_count = 0;
     params . cursor_cache = cursor_cache;
+    params . selection = NULL;
 
     rc = make_raw_read_iter( &params, &iter ); /* raw_read_iter.c */
     if ( 0 == rc ) {
@@ -59,6 +59,9 @@ bool get_from_raw_read_iter( struct raw_read_iter_t * iter, raw_read_rec_t * rec
 
 uint64_t get_row_count_of_raw_read( struct raw_read_iter_t * iter );
 
+/* the number of alignments skipped because their spot is not selected */
+uint64_t get_skipped_of_raw_read( const struct raw_read_iter_t * iter );
+
 rc_t write_out_prim( const KDirectory *dir, size_t buf_size, size_t cursor_cache,
                      const char * accession_short, const char * accession_path,
                      const char * output_file );
@@ -0,0 +1,436 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "row_selection.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#ifndef _h_kfs_file_
+#include <kfs/file.h>
+#endif
+
+#ifndef _h_klib_sort_
+#include <klib/sort.h>
+#endif
+
+#ifndef _h_klib_num_gen_
+#include <klib/num-gen.h>
+#endif
+
+#include <stdlib.h>     /* calloc(), realloc(), free() */
+
+#define RSEL_OPEN_END UINT64_MAX            /* count of a range like "7000-" before rsel_seal() */
+#define RSEL_FILE_CHUNK ( 1024 * 64 )
+
+typedef struct rsel_range_t {
+    int64_t first;
+    uint64_t count;
+    uint64_t before;        /* the number of rows in all ranges before this one, set by rsel_seal() */
+} rsel_range_t;
+
+typedef struct row_selection_t {
+    rsel_range_t * ranges;
+    uint32_t num_ranges, capacity;
+    uint64_t row_count;     /* sum of the counts of all ranges, set by rsel_seal() */
+    uint64_t threshold;     /* a row is in the sample if its hash is below this */
+    uint64_t seed;
+    double fraction;
+    bool sampling;
+    bool has_ranges;        /* ranges have been given, even if all of them turn out to be empty */
+} row_selection_t;
+
+rc_t make_row_selection( struct row_selection_t ** sel ) {
+    rc_t rc = 0;
+    if ( NULL == sel ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcNull );
+        ErrMsg( "row_selection.c make_row_selection() -> %R", rc );
+    } else {
+        row_selection_t * self = calloc( 1, sizeof * self );
+        if ( NULL == self ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            ErrMsg( "row_selection.c make_row_selection().calloc( %d ) -> %R", ( sizeof * self ), rc );
+        } else {
+            self -> fraction = 1.0;
+            *sel = self;
+        }
+    }
+    return rc;
+}
+
+void release_row_selection( struct row_selection_t * self ) {
+    if ( NULL != self ) {
+        free( ( void * )self -> ranges );
+        free( ( void * )self );
+    }
+}
+
+static rc_t rsel_append( row_selection_t * self, int64_t first, uint64_t count ) {
+    rc_t rc = 0;
+    if ( first < 1 || 0 == count ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+        ErrMsg( "row_selection.c invalid row-range %ld.%lu -> %R", first, count, rc );
+    } else {
+        if ( self -> num_ranges == self -> capacity ) {
+            uint32_t new_capacity = ( 0 == self -> capacity ) ? 64 : self -> capacity * 2;
+            rsel_range_t * tmp = realloc( self -> ranges, new_capacity * sizeof * tmp );
+            if ( NULL == tmp ) {
+                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                ErrMsg( "row_selection.c rsel_append().realloc( %u ) -> %R", new_capacity, rc );
+            } else {
+                self -> ranges = tmp;
+                self -> capacity = new_capacity;
+            }
+        }
+        if ( 0 == rc ) {
+            rsel_range_t * r = &( self -> ranges[ self -> num_ranges++ ] );
+            r -> first = first;
+            r -> count = count;
+            r -> before = 0;
+            self -> has_ranges = true;
+        }
+    }
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+/* the parser for the commandline and the spot-list: it is fed one character at a time,
+   because the spot-list is read in chunks */
+
+typedef struct rsel_parser_t {
+    uint64_t value, first;
+    bool in_value, in_range, in_comment;
+} rsel_parser_t;
+
+static rc_t rsel_parse_token_end( row_selection_t * self, rsel_parser_t * p ) {
+    rc_t rc = 0;
+    if ( p -> in_range ) {
+        if ( !p -> in_value ) {
+            rc = rsel_append( self, ( int64_t )p -> first, RSEL_OPEN_END );
+        } else if ( p -> value < p -> first ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+            ErrMsg( "row_selection.c invalid row-range %lu-%lu -> %R", p -> first, p -> value, rc );
+        } else {
+            rc = rsel_append( self, ( int64_t )p -> first, ( p -> value - p -> first ) + 1 );
+        }
+    } else if ( p -> in_value ) {
+        rc = rsel_append( self, ( int64_t )p -> value, 1 );
+    }
+    p -> value = 0;
+    p -> first = 0;
+    p -> in_value = false;
+    p -> in_range = false;
+    return rc;
+}
+
+static rc_t rsel_parse_char( row_selection_t * self, rsel_parser_t * p, char c ) {
+    rc_t rc = 0;
+    if ( p -> in_comment ) {
+        p -> in_comment = ( '\n' != c );
+    } else if ( c >= '0' && c <= '9' ) {
+        uint64_t digit = ( uint64_t )( c - '0' );
+        /* row-ids are int64_t: reject what does not fit instead of wrapping around */
+        if ( p -> value > ( ( uint64_t )INT64_MAX - digit ) / 10 ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcExcessive );
+            ErrMsg( "row_selection.c row-id too large in row-selection -> %R", rc );
+        } else {
+            p -> value = ( p -> value * 10 ) + digit;
+            p -> in_value = true;
+        }
+    } else if ( '-' == c && p -> in_value && !p -> in_range ) {
+        p -> first = p -> value;
+        p -> value = 0;
+        p -> in_value = false;
+        p -> in_range = true;
+    } else if ( ' ' == c || '\t' == c || '\r' == c || '\n' == c || ',' == c ) {
+        rc = rsel_parse_token_end( self, p );
+    } else if ( '#' == c ) {
+        rc = rsel_parse_token_end( self, p );
+        p -> in_comment = true;
+    } else {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+        ErrMsg( "row_selection.c unexpected character '%c' in row-selection -> %R", c, rc );
+    }
+    return rc;
+}
+
+rc_t rsel_add_ranges( struct row_selection_t * self, const char * src ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == src ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcNull );
+        ErrMsg( "row_selection.c rsel_add_ranges() -> %R", rc );
+    } else {
+        rsel_parser_t p = { 0, 0, false, false, false };
+        while ( 0 == rc && 0 != *src ) {
+            rc = rsel_parse_char( self, &p, *src++ );
+        }
+        if ( 0 == rc ) {
+            rc = rsel_parse_token_end( self, &p );
+        }
+    }
+    return rc;
+}
+
+rc_t rsel_add_spot_list( struct row_selection_t * self, const KDirectory * dir, const char * filename ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == dir || NULL == filename ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcNull );
+        ErrMsg( "row_selection.c rsel_add_spot_list() -> %R", rc );
+    } else {
+        const KFile * f;
+        rc = KDirectoryOpenFileRead( dir, &f, "%s", filename );
+        if ( 0 != rc ) {
+            ErrMsg( "row_selection.c rsel_add_spot_list().KDirectoryOpenFileRead( '%s' ) -> %R", filename, rc );
+        } else {
+            char * buffer = malloc( RSEL_FILE_CHUNK );
+            if ( NULL == buffer ) {
+                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                ErrMsg( "row_selection.c rsel_add_spot_list().malloc( %d ) -> %R", RSEL_FILE_CHUNK, rc );
+            } else {
+                rsel_parser_t p = { 0, 0, false, false, false };
+                uint64_t pos = 0;
+                size_t num_read = 1;
+                while ( 0 == rc && num_read > 0 ) {
+                    rc = KFileReadAll( f, pos, buffer, RSEL_FILE_CHUNK, &num_read );
+                    if ( 0 != rc ) {
+                        ErrMsg( "row_selection.c rsel_add_spot_list().KFileReadAll( '%s' at %lu ) -> %R", filename, pos, rc );
+                    } else {
+                        size_t i;
+                        for ( i = 0; 0 == rc && i < num_read; ++i ) {
+                            rc = rsel_parse_char( self, &p, buffer[ i ] );
+                        }
+                        pos += num_read;
+                    }
+                }
+                if ( 0 == rc ) {
+                    rc = rsel_parse_token_end( self, &p );
+                }
+                free( ( void * )buffer );
+            }
+            KFileRelease( f );
+        }
+    }
+    return rc;
+}
+
+rc_t rsel_set_sample( struct row_selection_t * self, double fraction, uint64_t seed ) {
+    rc_t rc = 0;
+    if ( NULL == self ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcNull );
+        ErrMsg( "row_selection.c rsel_set_sample() -> %R", rc );
+    } else if ( !( fraction > 0.0 && fraction <= 1.0 ) ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+        ErrMsg( "row_selection.c sample-fraction has to be > 0.0 and <= 1.0 -> %R", rc );
+    } else {
+        self -> fraction = fraction;
+        self -> seed = seed;
+        self -> sampling = ( fraction < 1.0 );
+        /* 2^64 * fraction: the hashes are evenly distributed over the 64-bit-range */
+        self -> threshold = self -> sampling ? ( uint64_t )( fraction * 18446744073709551616.0 ) : UINT64_MAX;
+    }
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------------------- */
+
+static int64_t CC rsel_range_cmp( const void * a, const void * b, void * data ) {
+    const rsel_range_t * ra = a;
+    const rsel_range_t * rb = b;
+    if ( ra -> first < rb -> first ) { return -1; }
+    return ( ra -> first > rb -> first ) ? 1 : 0;
+}
+
+/* the last row of a range, clipped at last_row */
+static int64_t rsel_range_last( const rsel_range_t * r, int64_t last_row ) {
+    int64_t res = last_row;
+    if ( RSEL_OPEN_END != r -> count && ( uint64_t )( last_row - r -> first ) >= r -> count ) {
+        res = r -> first + ( int64_t )r -> count - 1;
+    }
+    return res;
+}
+
+rc_t rsel_seal( struct row_selection_t * self, int64_t first_row, uint64_t row_count ) {
+    rc_t rc = 0;
+    if ( NULL == self ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcNull );
+        ErrMsg( "row_selection.c rsel_seal() -> %R", rc );
+    } else if ( !self -> has_ranges ) {
+        /* no ranges: all rows ( maybe sampled ) */
+        if ( row_count > 0 ) {
+            rc = rsel_append( self, first_row, row_count );
+        }
+    } else {
+        int64_t last_row = first_row + ( int64_t )row_count - 1;
+        uint32_t src, dst = 0;
+        ksort( self -> ranges, self -> num_ranges, sizeof self -> ranges[ 0 ], rsel_range_cmp, NULL );
+        for ( src = 0; src < self -> num_ranges; ++src ) {
+            rsel_range_t r = self -> ranges[ src ];
+            if ( r . first < first_row ) {
+                /* clip the start: the range begins before the table */
+                if ( RSEL_OPEN_END != r . count ) {
+                    uint64_t cut = ( uint64_t )( first_row - r . first );
+                    r . count = ( r . count > cut ) ? r . count - cut : 0;
+                }
+                r . first = first_row;
+            }
+            if ( r . count > 0 && r . first <= last_row ) {
+                int64_t r_last = rsel_range_last( &r, last_row );
+                r . count = ( uint64_t )( r_last - r . first ) + 1;
+                if ( dst > 0 ) {
+                    rsel_range_t * prev = &( self -> ranges[ dst - 1 ] );
+                    int64_t prev_last = prev -> first + ( int64_t )prev -> count - 1;
+                    if ( r . first <= prev_last + 1 ) {
+                        /* overlapping or adjacent: merge */
+                        if ( r_last > prev_last ) {
+                            prev -> count = ( uint64_t )( r_last - prev -> first ) + 1;
+                        }
+                        continue;
+                    }
+                }
+                self -> ranges[ dst++ ] = r;
+            }
+        }
+        self -> num_ranges = dst;
+    }
+    if ( 0 == rc ) {
+        uint32_t i;
+        self -> row_count = 0;
+        for ( i = 0; i < self -> num_ranges; ++i ) {
+            self -> ranges[ i ] . before = self -> row_count;
+            self -> row_count += self -> ranges[ i ] . count;
+        }
+    }
+    return rc;
+}
+
+uint64_t rsel_row_count( const struct row_selection_t * self ) {
+    return ( NULL == self ) ? 0 : self -> row_count;
+}
+
+uint64_t rsel_expected_count( const struct row_selection_t * self ) {
+    uint64_t res = 0;
+    if ( NULL != self ) {
+        res = self -> sampling ? ( uint64_t )( ( double )self -> row_count * self -> fraction ) : self -> row_count;
+    }
+    return res;
+}
+
+/* splitmix64: a cheap, well mixing hash of the row-id and the seed */
+static uint64_t rsel_hash( uint64_t seed, int64_t row ) {
+    uint64_t z = seed + ( ( uint64_t )row * 0x9E3779B97F4A7C15ULL );
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+    return z ^ ( z >> 31 );
+}
+
+bool rsel_sampled( const struct row_selection_t * self, int64_t row ) {
+    bool res = true;
+    if ( NULL != self && self -> sampling ) {
+        res = ( rsel_hash( self -> seed, row ) < self -> threshold );
+    }
+    return res;
+}
+
+/* the index of the last range starting at or before row, num_ranges if there is none */
+static uint32_t rsel_find( const row_selection_t * self, int64_t row ) {
+    uint32_t res = self -> num_ranges;
+    uint32_t lo = 0, hi = self -> num_ranges;
+    while ( lo < hi ) {
+        uint32_t mid = lo + ( hi - lo ) / 2;
+        if ( self -> ranges[ mid ] . first <= row ) {
+            res = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return res;
+}
+
+bool rsel_contains( const struct row_selection_t * self, int64_t row ) {
+    bool res = false;
+    if ( NULL != self ) {
+        uint32_t idx = rsel_find( self, row );
+        if ( idx < self -> num_ranges ) {
+            const rsel_range_t * r = &( self -> ranges[ idx ] );
+            res = ( ( uint64_t )( row - r -> first ) < r -> count ) && rsel_sampled( self, row );
+        }
+    }
+    return res;
+}
+
+/* the row at position pos ( 0 ... row_count - 1 ) in the sequence of all ranges */
+static int64_t rsel_row_at( const row_selection_t * self, uint64_t pos ) {
+    uint32_t lo = 0, hi = self -> num_ranges;
+    while ( hi - lo > 1 ) {
+        uint32_t mid = lo + ( hi - lo ) / 2;
+        if ( self -> ranges[ mid ] . before <= pos ) { lo = mid; } else { hi = mid; }
+    }
+    return self -> ranges[ lo ] . first + ( int64_t )( pos - self -> ranges[ lo ] . before );
+}
+
+void rsel_slice( const struct row_selection_t * self, uint32_t idx, uint32_t num_slices,
+                 int64_t * first, uint64_t * count ) {
+    *first = 0;
+    *count = 0;
+    if ( NULL != self && num_slices > 0 && idx < num_slices && self -> row_count > 0 ) {
+        uint64_t start = ( self -> row_count / num_slices ) * idx +
+                         ( ( self -> row_count % num_slices ) * idx ) / num_slices;
+        uint64_t end = ( self -> row_count / num_slices ) * ( idx + 1 ) +
+                         ( ( self -> row_count % num_slices ) * ( idx + 1 ) ) / num_slices;
+        if ( end > start ) {
+            int64_t last = rsel_row_at( self, end - 1 );
+            *first = rsel_row_at( self, start );
+            *count = ( uint64_t )( last - *first ) + 1;
+        }
+    }
+}
+
+rc_t rsel_add_to_num_gen( const struct row_selection_t * self, struct num_gen * ng,
+                          int64_t first, uint64_t count ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == ng ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcNull );
+        ErrMsg( "row_selection.c rsel_add_to_num_gen() -> %R", rc );
+    } else if ( count > 0 && self -> num_ranges > 0 ) {
+        int64_t last = first + ( int64_t )count - 1;
+        uint32_t idx = rsel_find( self, first );
+        if ( idx == self -> num_ranges ) { idx = 0; }   /* the window starts before the first range */
+        for ( ; 0 == rc && idx < self -> num_ranges && self -> ranges[ idx ] . first <= last; ++idx ) {
+            const rsel_range_t * r = &( self -> ranges[ idx ] );
+            int64_t lo = ( r -> first > first ) ? r -> first : first;
+            int64_t hi = rsel_range_last( r, last );
+            if ( hi >= lo ) {
+                rc = num_gen_add( ng, lo, ( uint64_t )( hi - lo ) + 1 );
+                if ( 0 != rc ) {
+                    ErrMsg( "row_selection.c num_gen_add( %ld.%lu ) -> %R", lo, ( uint64_t )( hi - lo ) + 1, rc );
+                }
+            }
+        }
+    }
+    return rc;
+}
@@ -0,0 +1,97 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_row_selection_
+#define _h_row_selection_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_kfs_directory_
+#include <kfs/directory.h>
+#endif
+
+/* -----------------------------------------------------------------------------------
+    A subset of the rows ( spots ) of the SEQUENCE-table: row-ranges from the
+    commandline, spot-ids from a file and / or a deterministic random sample.
+    The ranges are kept sorted and merged, the sample is a hash of the row-id and
+    the seed - the same seed always selects the same rows, no matter how the rows
+    are split across the threads.
+   ----------------------------------------------------------------------------------- */
+
+struct row_selection_t;
+struct num_gen;
+
+rc_t make_row_selection( struct row_selection_t ** sel );
+void release_row_selection( struct row_selection_t * self );
+
+/* "1-1000,5000,7000-" : single rows, ranges and open ranges ( up to the last row ) */
+rc_t rsel_add_ranges( struct row_selection_t * self, const char * src );
+
+/* a file with one spot-id or range per line, '#' starts a comment */
+rc_t rsel_add_spot_list( struct row_selection_t * self, const KDirectory * dir, const char * filename );
+
+/* keep each selected row with the probability of fraction ( 0.0 < fraction <= 1.0 ) */
+rc_t rsel_set_sample( struct row_selection_t * self, double fraction, uint64_t seed );
+
+/* sorts and merges the ranges and clips them to the rows of the table,
+   without any ranges all rows of the table are selected */
+rc_t rsel_seal( struct row_selection_t * self, int64_t first_row, uint64_t row_count );
+
+/* the number of rows in the ranges ( before sampling ) */
+uint64_t rsel_row_count( const struct row_selection_t * self );
+
+/* the number of rows expected after sampling */
+uint64_t rsel_expected_count( const struct row_selection_t * self );
+
+/* is the row in one of the ranges and in the sample */
+bool rsel_contains( const struct row_selection_t * self, int64_t row );
+
+/* is the row in the sample ( true if not sampling ) */
+bool rsel_sampled( const struct row_selection_t * self, int64_t row );
+
+/* the row-window of slice idx out of num_slices: each slice has the same number of rows
+   of the ranges, the windows do not overlap and follow each other in row-order */
+void rsel_slice( const struct row_selection_t * self, uint32_t idx, uint32_t num_slices,
+                 int64_t * first, uint64_t * count );
+
+/* adds the parts of the ranges, that fall into the window, to a num-gen ( klib/num-gen.h ) */
+rc_t rsel_add_to_num_gen( const struct row_selection_t * self, struct num_gen * ng,
+                          int64_t first, uint64_t count );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -155,7 +155,16 @@ rc_t split_filename_insert_idx( SBuffer_t * dst, size_t dst_size,
         rc = hlp_split_path_into_stem_and_extension( &S_in, &S_name, &S_ext );
         if ( 0 == rc ) {
             /* we found a dot to split the filename! */
-            if ( S_ext . len > 0 ) {
+            String S_stem, S_ext2;
+            bool compressed = ( ( 2 == S_ext . len && 0 == string_cmp( S_ext . addr, 2, "gz", 2, 2 ) ) ||
+                                ( 3 == S_ext . len && 0 == string_cmp( S_ext . addr, 3, "zst", 3, 3 ) ) );
+            if ( compressed &&
+                 0 == hlp_split_path_into_stem_and_extension( &S_name, &S_stem, &S_ext2 ) &&
+                 S_ext2 . len > 0 ) {
+                /* 'X.fastq.gz' -> 'X_1.fastq.gz' instead of 'X.fastq_1.gz' */
+                rc = make_and_print_to_SBuffer( dst, dst_size, "%S_%u.%S.%S",
+                            &S_stem, idx, &S_ext2, &S_ext ); /* helper.c */
+            } else if ( S_ext . len > 0 ) {
                 rc = make_and_print_to_SBuffer( dst, dst_size, "%S_%u.%S",
                             &S_name, idx, &S_ext ); /* helper.c */
             } else {
@@ -186,7 +195,7 @@ rc_t copy_SBuffer( SBuffer_t * self, const SBuffer_t * src ) {
             rc = increase_SBuffer_to( self, src -> buffer_size );
         }
         if ( 0 == rc ) {
-            size_t new_size = string_copy( ( char * )self -> S . addr, self -> S . size,
+            size_t new_size = string_copy( ( char * )self -> S . addr, self -> buffer_size,
                                             src -> S . addr, src -> S . size );
             self -> S . size = new_size;
             self -> S . len = ( uint32_t )self -> S . size;
@@ -195,12 +204,12 @@ rc_t copy_SBuffer( SBuffer_t * self, const SBuffer_t * src ) {
     return rc;
 }
 
-rc_t append_SBuffer( SBuffer_t * self, const SBuffer_t * src ) {
+rc_t reserve_SBuffer( SBuffer_t * self, size_t len ) {
     rc_t rc = 0;
-    if ( NULL == self || NULL == src ) {
+    if ( NULL == self ) {
         rc = RC( rcVDB, rcNoTarg, rcConstructing, rcSelf, rcNull );
     } else {
-        size_t needed = self -> S . size + src -> S . size + 1;
+        size_t needed = self -> S . size + len + 1;
         if ( needed > self -> buffer_size ) {
             /* we have to store the content of self, because increase_SBuffer_to() will destroy it! */
             SBuffer_t tmp;
@@ -216,12 +225,22 @@ rc_t append_SBuffer( SBuffer_t * self, const SBuffer_t * src ) {
                 release_SBuffer( &tmp );
             }
         }
+    }
+    return rc;
+}
+
+rc_t append_SBuffer( SBuffer_t * self, const SBuffer_t * src ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == src ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcSelf, rcNull );
+    } else {
+        rc = reserve_SBuffer( self, src -> S . size );
         if ( 0 == rc ) {
             char * dst = ( char * )&( self -> S . addr[ self -> S . size ] );
             size_t dst_size = self -> buffer_size - self -> S . size;
             size_t new_size = string_copy( dst, dst_size,
                                            src -> S . addr, src -> S . size );
-            self -> S . size = new_size;
+            self -> S . size += new_size;
             self -> S . len = ( uint32_t )self -> S . size;
         }
     }
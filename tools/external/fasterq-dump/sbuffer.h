@@ -59,6 +59,8 @@ rc_t split_filename_insert_idx( SBuffer_t * dst, size_t dst_size,
 
 rc_t copy_SBuffer( SBuffer_t * self, const SBuffer_t * src );
 rc_t append_SBuffer( SBuffer_t * self, const SBuffer_t * src );
+/* makes room for len more bytes ( + terminator ) at the end, keeps the content */
+rc_t reserve_SBuffer( SBuffer_t * self, size_t len );
 rc_t clear_SBuffer( SBuffer_t * self );
 
 #ifdef __cplusplus
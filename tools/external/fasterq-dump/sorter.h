@@ -58,6 +58,8 @@ typedef struct lookup_production_args_t {
     size_t buf_size;
     size_t mem_limit;
     uint32_t num_threads;
+    uint64_t rows_per_slice;    /* 0 ... align_row_count / num_threads, planner.h */
+    const struct row_selection_t * selection;  /* only lookup-entries of these spots, NULL for all */
     bool show_progress;
     bool keep_tmp_files;
 } lookup_production_args_t;
@@ -41,6 +41,14 @@
 #include "flex_printer.h"
 #endif
 
+#ifndef _h_row_selection_
+#include "row_selection.h"
+#endif
+
+#ifndef _h_perf_report_
+#include "perf_report.h"
+#endif
+
 #ifndef _h_klib_out_
 #include <klib/out.h>
 #endif
@@ -853,12 +861,14 @@ typedef struct join_thread_data_t {
     struct multi_writer_t * multi_writer;
     struct bg_progress_t * progress;
     struct temp_registry_t * registry;
+    const struct row_selection_t * selection;
     KThread * thread;
 
     uint32_t thread_id;
     int64_t first_row;
     uint64_t row_count;
     uint64_t row_limit;
+    uint64_t elapsed_us;    /* perf_report.h */
     size_t cur_cache;
     size_t buf_size;
     format_t fmt;
@@ -869,6 +879,7 @@ typedef struct join_thread_data_t {
 static rc_t sorted_fastq_fasta_thread_func( const KThread *self, void *data ) {
     rc_t rc = 0;
     join_thread_data_t * jtd = data;
+    uint64_t t_start = perf_now_us(); /* perf_report.c */
     flp_args_t file_args;
     table_join_t tj;
 
@@ -881,12 +892,15 @@ static rc_t sorted_fastq_fasta_thread_func( const KThread *self, void *data ) {
                               jtd -> first_row,
                               jtd -> row_limit > 0 ? jtd -> row_limit : jtd -> row_count,
                               jtd -> thread_id );
+    tj . cp . selection = jtd -> selection;
     
     flp_initialize_args( &file_args,
                          jtd -> dir,
                          jtd -> registry,
                          jtd -> part_file,
-                         jtd -> buf_size );
+                         jtd -> buf_size,
+                         jtd -> join_options -> compress,
+                         jtd -> join_options -> compress_level );
     
     tj . printer = flp_create_1( &file_args,
                                  jtd -> accession_short,         /* we need that for the flexible defline! */
@@ -919,9 +933,13 @@ static rc_t sorted_fastq_fasta_thread_func( const KThread *self, void *data ) {
             case ft_fasta_concat : break;           /* or this */                
             case ft_ref_report : break;             /* or this */
         }
-        flp_release( tj . printer );
+        {
+            rc_t rc_flp = flp_release( tj . printer ); /* flex_printer.c */
+            if ( 0 == rc ) { rc = rc_flp; }
+        }
     }
     hlp_release_2na_filter( tj . filter );
+    jtd -> elapsed_us = perf_now_us() - t_start; /* perf_report.c */
     return rc;
 }
 
@@ -937,6 +955,8 @@ static rc_t join_the_threads_and_collect_status( Vector *threads, join_stats_t *
                 rc = rc_thread;
             }
             KThreadRelease( jtd -> thread );
+            perf_thread_rate( ps_join, jtd -> thread_id, jtd -> stats . spots_read, jtd -> elapsed_us ); /* perf_report.c */
+            perf_add( pc_join_spots, jtd -> stats . spots_read );
             hlp_add_join_stats( stats, &jtd -> stats );
             free( jtd );
         }
@@ -971,9 +991,16 @@ rc_t execute_tbl_join( const execute_tbl_join_args_t * args ) {
                                       name_column_present ); /* helper.c */
             corrected_join_options . print_spotgroup = spot_group_requested( args -> cmn . seq_defline,
                                                                              args -> qual_defline ); /* flex_printer.c */
-            rows_per_thread = hlp_calculate_rows_per_thread( &num_threads, row_count );
+            if ( NULL != args -> cmn . selection ) {
+                /* split the selected rows evenly, not the rows of the table */
+                rows_per_thread = hlp_calculate_rows_per_thread( &num_threads, rsel_row_count( args -> cmn . selection ) );
+            } else {
+                rows_per_thread = hlp_calculate_rows_per_slice( &num_threads, row_count,
+                                                                args -> cmn . rows_per_slice ); /* helper.c */
+            }
             if ( args -> cmn . show_progress ) {
-                rc = bg_progress_make( &progress, row_count, 0, 0 ); /* progress_thread.c */
+                uint64_t total = ( NULL != args -> cmn . selection ) ? rsel_expected_count( args -> cmn . selection ) : row_count;
+                rc = bg_progress_make( &progress, total, 0, 0 ); /* progress_thread.c */
             }
 
             for ( thread_id = 0; 0 == rc && thread_id < num_threads; ++thread_id ) {
@@ -998,6 +1025,11 @@ rc_t execute_tbl_join( const execute_tbl_join_args_t * args ) {
                     jtd -> join_options     = &corrected_join_options;
                     jtd -> thread_id        = thread_id;
                     jtd -> has_read_type    = args -> cmn . insp_output -> seq . has_read_type_column;
+                    jtd -> selection        = args -> cmn . selection;
+                    if ( NULL != args -> cmn . selection ) {
+                        rsel_slice( args -> cmn . selection, thread_id, num_threads,
+                                    &jtd -> first_row, &jtd -> row_count ); /* row_selection.c */
+                    }
 
                     rc = make_joined_filename( args -> temp_dir, jtd -> part_file, sizeof jtd -> part_file,
                                 args -> cmn . accession_short, thread_id ); /* temp_dir.c */
@@ -1049,6 +1081,7 @@ static rc_t unsorted_fasta_split_spot_thread_func( const KThread *self, void *da
                               jtd -> first_row,
                               jtd -> row_limit > 0 ? jtd -> row_limit : jtd -> row_count,
                               jtd -> thread_id );
+    cp . selection = jtd -> selection;
     
     opt . with_read_len = true;
     opt . with_name = !( jo -> rowid_as_name );
@@ -1121,7 +1154,10 @@ static rc_t unsorted_fasta_split_spot_thread_func( const KThread *self, void *da
         if ( 0 != rc ) { hlp_set_quitting(); }
         fq_seq_ua_iter_release( iter );
     }
-    flp_release( flex_printer );
+    {
+        rc_t rc_flp = flp_release( flex_printer ); /* flex_printer.c */
+        if ( 0 == rc ) { rc = rc_flp; }
+    }
     /* jtd is released in join_the_threads_and_collect_status() */
     return rc;
 }
@@ -1147,6 +1183,7 @@ static rc_t unsorted_fasta_whole_spot_thread_func( const KThread *self, void *da
                               jtd -> first_row,
                               jtd -> row_limit > 0 ? jtd -> row_limit : jtd -> row_count,
                               jtd -> thread_id );
+    cp . selection = jtd -> selection;
 
     opt . with_read_len = true;
     opt . with_name = !( jo -> rowid_as_name );
@@ -1202,7 +1239,10 @@ static rc_t unsorted_fasta_whole_spot_thread_func( const KThread *self, void *da
         if ( 0 != rc ) { hlp_set_quitting(); }
         fq_seq_ua_iter_release( iter );
     }
-    flp_release( flex_printer );
+    {
+        rc_t rc_flp = flp_release( flex_printer ); /* flex_printer.c */
+        if ( 0 == rc ) { rc = rc_flp; }
+    }
     /* jtd is released in join_the_threads_and_collect_status() */
     return rc;
 }
@@ -1224,7 +1264,9 @@ rc_t execute_unsorted_fasta_tbl_join( const execute_fasta_tbl_join_args_t * args
                     args -> cmn . buf_size,
                     0,                              /* q_wait_time, if 0 --> use default = 5 ms */
                     args -> cmn . num_threads * 3,  /* q_num_blocks, if 0 use default = 8 */
-                    0 );                            /* q_block_size, if 0 use default = 4 MB */
+                    0,                              /* q_block_size, if 0 use default = 4 MB */
+                    args -> cmn . join_options -> compress,
+                    args -> cmn . join_options -> compress_level );
             if ( NULL != multi_writer ) {
                 /* create a 2na-base-filter ( if filterbases were given, by default not ) */
                 struct filter_2na_t * filter = hlp_make_2na_filter( args -> cmn . join_options -> filter_bases );
@@ -1240,8 +1282,16 @@ rc_t execute_unsorted_fasta_tbl_join( const execute_fasta_tbl_join_args_t * args
                 hlp_correct_join_options( &corrected_join_options, args -> cmn . join_options,
                                           name_column_present ); /* helper.c */
                 corrected_join_options . print_spotgroup = spot_group_requested( args -> cmn . seq_defline, NULL ); /* flex_printer.c */
-                rows_per_thread = hlp_calculate_rows_per_thread( &num_threads, row_count );
-                if ( args -> cmn . show_progress ) { rc = bg_progress_make( &progress, row_count, 0, 0 ); } /* progress_thread.c */
+                if ( NULL != args -> cmn . selection ) {
+                    rows_per_thread = hlp_calculate_rows_per_thread( &num_threads, rsel_row_count( args -> cmn . selection ) );
+                } else {
+                    rows_per_thread = hlp_calculate_rows_per_slice( &num_threads, row_count,
+                                                                    args -> cmn . rows_per_slice ); /* helper.c */
+                }
+                if ( args -> cmn . show_progress ) {
+                    uint64_t total = ( NULL != args -> cmn . selection ) ? rsel_expected_count( args -> cmn . selection ) : row_count;
+                    rc = bg_progress_make( &progress, total, 0, 0 ); /* progress_thread.c */
+                }
 
                 for ( thread_id = 0; 0 == rc && thread_id < num_threads; ++thread_id ) {
                     join_thread_data_t * jtd = calloc( 1, sizeof * jtd ); /* above */
@@ -1264,6 +1314,11 @@ rc_t execute_unsorted_fasta_tbl_join( const execute_fasta_tbl_join_args_t * args
                         jtd -> part_file[ 0 ]   = 0; /* we are not using a part-file */
                         jtd -> multi_writer     = multi_writer;
                         jtd -> has_read_type    = args -> cmn . insp_output -> seq . has_read_type_column;
+                        jtd -> selection        = args -> cmn . selection;
+                        if ( NULL != args -> cmn . selection ) {
+                            rsel_slice( args -> cmn . selection, thread_id, num_threads,
+                                        &jtd -> first_row, &jtd -> row_count ); /* row_selection.c */
+                        }
 
                         if ( ft_fasta_us_split_spot == jtd -> fmt ) {
                             rc = hlp_make_thread( &( jtd -> thread ),
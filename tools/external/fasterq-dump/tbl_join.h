@@ -59,6 +59,8 @@ extern "C" {
 #include "inspector.h"
 #endif
 
+struct row_selection_t;
+
 typedef struct execute_tbl_join_args_common_t {
     KDirectory * dir;
     const VDBManager * vdb_mgr;
@@ -72,7 +74,9 @@ typedef struct execute_tbl_join_args_common_t {
     size_t cursor_cache;
     size_t buf_size;
     uint32_t num_threads;
+    uint64_t rows_per_slice;                /* 0 ... split the rows evenly across the threads, planner.h */
     uint64_t row_limit;
+    const struct row_selection_t * selection;  /* the spots to extract, NULL for all, row_selection.h */
     bool show_progress;
     format_t fmt;                           /* helper.h */
 } execute_tbl_join_args_common_t;
@@ -25,6 +25,8 @@
 */
 #include "temp_registry.h"
 
+#include <string.h>     /* memset() */
+
 #ifndef _h_err_msg_
 #include "err_msg.h"
 #endif
@@ -153,6 +155,7 @@ typedef struct merge_thread_data_t {
     cmn_merge_t * cmn;
     VNamelist * files;
     KThread * thread;
+    concat_stats_t stats;       /* concatenator.h */
     uint32_t idx;
 } merge_thread_data_t;
 
@@ -176,7 +179,8 @@ static rc_t merge_thread_func( const KThread *self, void *data ) {
             merge_thread_data -> cmn -> buf_size,
             merge_thread_data -> cmn -> progress,
             merge_thread_data -> cmn -> force,
-            merge_thread_data -> cmn -> append );
+            merge_thread_data -> cmn -> append,
+            &( merge_thread_data -> stats ) ); /* concatenator.c */
         release_SBuffer( &s_filename );
     }
     return rc;
@@ -189,6 +193,7 @@ rc_t temp_registry_merge( temp_registry_t * self,
                           const char * base_output_filename,
                           size_t buf_size,
                           bool show_progress,
+                          bool show_details,
                           bool force,
                           bool append ) {
     rc_t rc = 0;
@@ -216,6 +221,10 @@ rc_t temp_registry_merge( temp_registry_t * self,
             uint32_t idx;
             Vector thread_data_vec;
             cmn_merge_t cmn = { dir, base_output_filename, buf_size, progress, force, append };
+            concat_stats_t stats; /* concatenator.h */
+            uint64_t start_us = hlp_now_us(); /* helper.c */
+
+            memset( &stats, 0, sizeof stats );
             
             /* we create a thread for each item in self->lists */
             VectorInit( &thread_data_vec, 0, length );
@@ -260,9 +269,16 @@ rc_t temp_registry_merge( temp_registry_t * self,
                     }
                     KThreadRelease( thread_data -> thread );
                     thread_data -> thread = NULL;
+                    concat_add_stats( &stats, &( thread_data -> stats ) ); /* concatenator.c */
                 }
             }
 
+            /* the threads ran in parallel: the speed is measured by the wall-clock */
+            stats . elapsed_us = hlp_now_us() - start_us;
+            if ( 0 == rc && show_details ) {
+                concat_print_stats( &stats ); /* concatenator.c */
+            }
+
             /* clean up the vector with the thread-specific data */
             VectorWhack( &thread_data_vec, merge_thread_data_free, NULL );
         }
@@ -284,12 +300,12 @@ static rc_t print_file_to_stdout( struct KFile const * f, size_t buffer_size ) {
         bool done = false;
         do {
             size_t num_read;
-            rc = KFileRead ( f, pos, buffer, buffer_size - 1, &num_read );
+            rc = KFileRead ( f, pos, buffer, buffer_size, &num_read );
             if ( 0 == rc ) {
                 done = ( 0 == num_read );
                 if ( !done ) {
-                    buffer[ num_read ] = 0;
-                    rc = KOutMsg( "%s", buffer );
+                    /* the part-files can be compressed ( binary ) */
+                    rc = hlp_write_to_stdout( buffer, num_read ); /* helper.c */
                     pos += num_read;
                 }
             }
@@ -61,6 +61,7 @@ rc_t temp_registry_merge( struct temp_registry_t * self,
                           const char * output_filename,
                           size_t buf_size,
                           bool show_progress,
+                          bool show_details,
                           bool force,
                           bool append );
 
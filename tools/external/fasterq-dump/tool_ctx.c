@@ -77,6 +77,16 @@
 #include "dflt_defline.h"
 #endif
 
+#ifndef _h_index_
+#include "index.h"
+#endif
+
+#ifndef _h_compressor_
+#include "compressor.h"
+#endif
+
+#include <stdlib.h>     /* calloc(), free() */
+
 bool tctx_populate_cmn_iter_params( const tool_ctx_t * tool_ctx,
                                         cmn_iter_params_t * params ) {
     bool res = false;
@@ -109,9 +119,21 @@ static rc_t tctx_print( const tool_ctx_t * tool_ctx ) {
     if ( 0 == rc ) {
         rc = KOutMsg( "threads      : %u\n", tool_ctx -> num_threads );
     }
+    if ( 0 == rc ) {
+        rc = KOutMsg( "index-stride : %,lu\n", tool_ctx -> index_stride );
+    }
+    if ( 0 == rc && tool_ctx -> stream ) {
+        rc = KOutMsg( "stream-mode  : yes\n" );
+    }
+    if ( 0 == rc && ct_none != tool_ctx -> join_options . compress ) {
+        rc = KOutMsg( "compression  : %s\n", hlp_compress_2_string( tool_ctx -> join_options . compress ) );
+    }
     if ( 0 == rc && tool_ctx -> row_limit > 0 ) {
         rc = KOutMsg( "row-limit    : %,lu rows\n", tool_ctx -> row_limit );
     }
+    if ( 0 == rc && NULL != tool_ctx -> selection ) {
+        rc = KOutMsg( "selection    : %,lu spots\n", rsel_expected_count( tool_ctx -> selection ) );
+    }
     if ( 0 == rc ) {
         rc = KOutMsg( "scratch-path : '%s'\n", get_temp_dir( tool_ctx -> temp_dir ) /* temp_dir.h */ );
     }
@@ -279,6 +301,7 @@ static rc_t tctx_encforce_constrains( tool_ctx_t * tool_ctx ) {
     uint32_t env_thread_count = ahlp_get_env_u32( "DLFT_THREAD_COUNT", 0 );
     if ( env_thread_count > 0  ) {
         tool_ctx -> num_threads = env_thread_count;
+        tool_ctx -> requested_threads = env_thread_count;
     } else {
         if ( tool_ctx -> num_threads < MIN_NUM_THREADS ) {
             tool_ctx -> num_threads = MIN_NUM_THREADS;
@@ -288,9 +311,15 @@ static rc_t tctx_encforce_constrains( tool_ctx_t * tool_ctx ) {
     if ( tool_ctx -> mem_limit < MIN_MEM_LIMIT ) {
         tool_ctx -> mem_limit = MIN_MEM_LIMIT;
     }
+    if ( tool_ctx -> requested_mem_limit > 0 ) {
+        tool_ctx -> requested_mem_limit = tool_ctx -> mem_limit;
+    }
     if ( tool_ctx -> buf_size > MAX_BUF_SIZE ) {
         tool_ctx -> buf_size = MAX_BUF_SIZE;
     }
+    if ( tool_ctx -> index_stride < MIN_INDEX_FREQUENCY ) {
+        tool_ctx -> index_stride = MIN_INDEX_FREQUENCY; /* index.h */
+    }
     if ( tool_ctx -> use_stdout ) {
         switch( tool_ctx -> fmt ) {
             case ft_fastq_whole_spot    : break;
@@ -315,6 +344,22 @@ static rc_t tctx_encforce_constrains( tool_ctx_t * tool_ctx ) {
         tool_ctx -> only_aligned = false;
         tool_ctx -> only_unaligned = false;
     }
+    if ( ct_none != tool_ctx -> join_options . compress ) {
+        switch( tool_ctx -> fmt ) {
+            /* these are not written by the join-threads */
+            case ft_fasta_ref_tbl   :
+            case ft_fasta_concat    :
+            case ft_ref_report      : StdErrMsg( "compression is not supported for this format -> ignored\n" );
+                                      tool_ctx -> join_options . compress = ct_none;
+                                      break;
+            default : break;
+        }
+    }
+    if ( 0 == rc && !compressor_available( tool_ctx -> join_options . compress ) ) { /* compressor.c */
+        rc = RC( rcExe, rcFile, rcPacking, rcFormat, rcUnsupported );
+        ErrMsg( "compression '%s' is not available in this build -> %R",
+                hlp_compress_2_string( tool_ctx -> join_options . compress ), rc );
+    }
     if ( ignore_stdout ) {
         rc = RC( rcExe, rcFile, rcPacking, rcName, rcExists );
         ErrMsg( "directing output to stdout requested." );
@@ -350,6 +395,7 @@ rc_t tctx_release( const tool_ctx_t * tool_ctx, rc_t rc_in ) {
     if ( NULL != tool_ctx -> accession_short ) {
         free( ( char * )tool_ctx -> accession_short );
     }
+    release_row_selection( tool_ctx -> selection ); /* row_selection.c ( ignores NULL ) */
     if ( NULL != tool_ctx -> ref_name_filter ) {
         rc_t rc2 = VNamelistRelease( tool_ctx -> ref_name_filter );
         if ( 0 != rc2 ) {
@@ -402,9 +448,10 @@ static rc_t tctx_make_output_filename_from_accession( tool_ctx_t * tool_ctx, boo
                                 true /* absolute */,
                                 &( tool_ctx -> dflt_output[ 0 ] ),
                                 sizeof tool_ctx -> dflt_output,
-                                "%s%s",
+                                "%s%s%s",
                                 tool_ctx -> accession_short,
-                                hlp_out_ext( fasta ) /* helper.c */ );
+                                hlp_out_ext( fasta ), /* helper.c */
+                                hlp_compress_ext( tool_ctx -> join_options . compress ) /* helper.c */ );
     if ( 0 != rc ) {
         ErrMsg( "tool_ctx_make_output_filename_from_accession.KDirectoryResolvePath() -> %R", rc );
     } else {
@@ -420,10 +467,11 @@ static rc_t tctx_make_output_filename_from_dir_and_accession( tool_ctx_t * tool_
                                 true /* absolute */,
                                 &( tool_ctx -> dflt_output[ 0 ] ),
                                 sizeof tool_ctx -> dflt_output,
-                                es ? "%s%s%s" : "%s/%s%s",
+                                es ? "%s%s%s%s" : "%s/%s%s%s",
                                 tool_ctx -> output_dirname,
                                 tool_ctx -> accession_short,
-                                hlp_out_ext( fasta ) /* helper.c */ );
+                                hlp_out_ext( fasta ), /* helper.c */
+                                hlp_compress_ext( tool_ctx -> join_options . compress ) /* helper.c */ );
     if ( 0 != rc ) {
         ErrMsg( "tool_ctx_make_output_filename_from_dir_and_accession.KDirectoryResolvePath() -> %R", rc );
     } else {
@@ -513,8 +561,8 @@ static size_t tctx_temp_file_sizes( tool_ctx_t * tool_ctx ) {
         res = ( tool_ctx -> insp_output . acc_size * tool_ctx -> num_threads );
     }
 
-    /* in case of ft_fasta_us_split_spot: there are no temp-files*/
-    if ( ft_fasta_us_split_spot != tool_ctx -> fmt ) {
+    /* in case of ft_fasta_us_split_spot or stream-mode: there are no temp-files*/
+    if ( ft_fasta_us_split_spot != tool_ctx -> fmt && !( tool_ctx -> stream ) ) {
         /* if we do use temp-files: they need as much space as the generated output */
         res = tool_ctx -> estimated_output_size;
         /* plus ( size / thread-count ) */
@@ -643,6 +691,177 @@ static rc_t tctx_check_available_columns( tool_ctx_t * tool_ctx ) {
     return rc;
 }
 
+/* the stream-mode does not sort, so it can only produce one unsorted file of split spots */
+static void tctx_adjust_stream_mode( tool_ctx_t * tool_ctx ) {
+    if ( acc_csra != tool_ctx -> insp_output . acc_type ) {
+        StdErrMsg( "stream-mode is only available for aligned ( cSRA ) accessions -> ignored\n" );
+        tool_ctx -> stream = false;
+    } else if ( hlp_is_format_fasta( tool_ctx -> fmt ) ) {
+        /* FASTA has the unsorted mode already */
+        if ( ft_fasta_us_split_spot != tool_ctx -> fmt ) {
+            StdErrMsg( "stream-mode -> switching to unsorted FASTA split-spot-mode\n" );
+            tool_ctx -> fmt = ft_fasta_us_split_spot;
+        }
+    } else if ( ft_fastq_split_spot != tool_ctx -> fmt ) {
+        StdErrMsg( "stream-mode -> switching to split-spot-mode\n" );
+        tool_ctx -> fmt = ft_fastq_split_spot;
+    }
+}
+
+/* the row-ranges, the spot-list and the sample from the commandline: after the inspector,
+   because the ranges are clipped to the rows of the SEQUENCE-table */
+static rc_t tctx_make_selection( tool_ctx_t * tool_ctx ) {
+    rc_t rc = 0;
+    bool sampling = ( 0.0 != tool_ctx -> sample_fraction );   /* validated in fasterq-dump.c */
+    bool requested = ( NULL != tool_ctx -> row_ranges || NULL != tool_ctx -> spot_list || sampling );
+    if ( requested ) {
+        switch( tool_ctx -> fmt ) {
+            case ft_fasta_ref_tbl   :
+            case ft_fasta_concat    :
+            case ft_ref_report      : StdErrMsg( "row-selection does not apply to references -> ignored\n" );
+                                      requested = false; break;
+            default : break;
+        }
+    }
+    if ( requested ) {
+        rc = make_row_selection( &( tool_ctx -> selection ) ); /* row_selection.c */
+        if ( 0 == rc && NULL != tool_ctx -> row_ranges ) {
+            rc = rsel_add_ranges( tool_ctx -> selection, tool_ctx -> row_ranges );
+        }
+        if ( 0 == rc && NULL != tool_ctx -> spot_list ) {
+            rc = rsel_add_spot_list( tool_ctx -> selection, tool_ctx -> dir, tool_ctx -> spot_list );
+        }
+        if ( 0 == rc && sampling ) {
+            rc = rsel_set_sample( tool_ctx -> selection, tool_ctx -> sample_fraction, tool_ctx -> sample_seed );
+        }
+        if ( 0 == rc ) {
+            rc = rsel_seal( tool_ctx -> selection,
+                            tool_ctx -> insp_output . seq . first_row,
+                            tool_ctx -> insp_output . seq . row_count );
+        }
+        if ( 0 == rc && 0 == rsel_row_count( tool_ctx -> selection ) ) {
+            rc = RC( rcApp, rcArgv, rcAccessing, rcParam, rcEmpty );
+            ErrMsg( "the row-selection does not contain any spots of this accession -> %R", rc );
+        }
+        if ( 0 == rc && acc_csra == tool_ctx -> insp_output . acc_type ) {
+            /* the lookup-table is produced only for the selected spots: that needs the sorted mode */
+            if ( tool_ctx -> stream ) {
+                StdErrMsg( "row-selection on cSRA needs the sorted mode -> stream-mode ignored\n" );
+                tool_ctx -> stream = false;
+            }
+            if ( ft_fasta_us_split_spot == tool_ctx -> fmt ) {
+                StdErrMsg( "row-selection on cSRA needs the sorted mode -> switching to FASTA split-spot-mode\n" );
+                tool_ctx -> fmt = ft_fasta_split_spot;
+                /* the unsorted mode did not need these, the sorted one does */
+                rc = make_temp_dir( &tool_ctx -> temp_dir,
+                                    tool_ctx -> requested_temp_path,
+                                    tool_ctx -> dir ); /* temp_dir.c */
+                if ( 0 == rc ) {
+                    rc = tctx_create_lookup_and_index_path( tool_ctx ); /* above */
+                }
+                if ( 0 == rc ) {
+                    rc = clt_create( &( tool_ctx -> cleanup_task ),
+                                     tool_ctx -> show_details,
+                                     tool_ctx -> keep_tmp_files ); /* cleanup_task.c */
+                }
+                if ( 0 == rc ) {
+                    rc = clt_add_directory( tool_ctx -> cleanup_task,
+                                            get_temp_dir( tool_ctx -> temp_dir ) ); /* cleanup_task.c */
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+/* -------------------------------------------------------------------------------- */
+
+#define SPEED_PROBE_SIZE ( 1024L * 1024 * 4 )
+#define SPEED_PROBE_CHUNK ( 1024L * 1024 )
+
+/* write a few MB into the temp-directory to find out how fast it is, 0 if not known */
+static uint64_t tctx_measure_temp_speed( tool_ctx_t * tool_ctx ) {
+    uint64_t res = 0;
+    char filename[ DFLT_PATH_LEN ];
+    size_t num_writ;
+    rc_t rc = string_printf( filename, sizeof filename, &num_writ, "%s.probe", tool_ctx -> lookup_filename );
+    if ( 0 == rc ) {
+        char * chunk = calloc( 1, SPEED_PROBE_CHUNK );
+        if ( NULL != chunk ) {
+            KFile * f;
+            rc = KDirectoryCreateFile( tool_ctx -> dir, &f, false, 0664, kcmInit, "%s", filename );
+            if ( 0 == rc ) {
+                uint64_t pos = 0;
+                uint64_t t_start = hlp_now_us(); /* helper.c */
+                while ( 0 == rc && pos < SPEED_PROBE_SIZE ) {
+                    rc = KFileWriteAll( f, pos, chunk, SPEED_PROBE_CHUNK, &num_writ );
+                    pos += num_writ;
+                    if ( 0 == num_writ ) { rc = RC( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete ); }
+                }
+                KFileRelease( f );
+                if ( 0 == rc ) {
+                    uint64_t elapsed_us = hlp_now_us() - t_start;
+                    if ( elapsed_us > 0 ) {
+                        res = ( pos * 1000000 ) / elapsed_us;
+                    }
+                }
+                KDirectoryRemove( tool_ctx -> dir, true, "%s", filename );
+            }
+            free( chunk );
+        }
+    }
+    return res;
+}
+
+/* the thread-counts, slice-sizes, mem-limit and merge-batch from what the inspector found, planner.h */
+static void tctx_make_plan( tool_ctx_t * tool_ctx ) {
+    plan_input_t input;
+    const insp_output_t * insp = &( tool_ctx -> insp_output );
+
+    input . requested_threads = tool_ctx -> requested_threads;
+    input . requested_mem_limit = tool_ctx -> requested_mem_limit;
+    input . cpu_count = plan_cpu_count(); /* planner.c */
+    input . total_ram = tool_ctx -> total_ram;
+    input . temp_write_speed = 0;
+    input . seq_rows = insp -> seq . row_count;
+    input . align_rows = insp -> align . row_count;
+    input . align_bases = ( insp -> align . bio_base_count > 0 )
+        ? insp -> align . bio_base_count : insp -> align . total_base_count;
+    if ( NULL != tool_ctx -> selection && insp -> seq . row_count > 0 ) {
+        /* only the selected spots are joined, and only their alignments end up in the lookup-table,
+           but the lookup-production still has to visit all alignment-rows */
+        double part = ( double )rsel_expected_count( tool_ctx -> selection ) / ( double )insp -> seq . row_count;
+        input . seq_rows = rsel_expected_count( tool_ctx -> selection );
+        input . align_bases = ( uint64_t )( input . align_bases * part );
+    }
+    input . sorted_csra = ( acc_csra == insp -> acc_type && !tool_ctx -> stream );
+    switch( tool_ctx -> fmt ) {
+        /* these do not produce a lookup-table */
+        case ft_fasta_us_split_spot :
+        case ft_fasta_ref_tbl       :
+        case ft_fasta_concat        :
+        case ft_ref_report          : input . sorted_csra = false; break;
+        default : break;
+    }
+
+    plan_make( &input, &( tool_ctx -> plan ) ); /* planner.c */
+
+    /* the speed of the temp-directory only matters if there is more to merge than one batch */
+    if ( input . sorted_csra && cmt_only != tool_ctx -> check_mode &&
+         tool_ctx -> plan . est_lookup_size / tool_ctx -> plan . mem_limit > tool_ctx -> plan . merge_batch ) {
+        input . temp_write_speed = tctx_measure_temp_speed( tool_ctx ); /* above */
+        if ( input . temp_write_speed > 0 ) {
+            plan_make( &input, &( tool_ctx -> plan ) ); /* planner.c */
+        }
+    }
+
+    tool_ctx -> num_threads = tool_ctx -> plan . threads;
+    tool_ctx -> mem_limit = tool_ctx -> plan . mem_limit;
+    if ( tool_ctx -> show_details ) {
+        plan_print( &( tool_ctx -> plan ) ); /* planner.c */
+    }
+}
+
 /* taken form libs/kapp/main-priv.h */
 rc_t KAppGetTotalRam ( uint64_t * totalRam );
 
@@ -749,6 +968,16 @@ rc_t tctx_populate_and_call_inspector( tool_ctx_t * tool_ctx ) {
         rc = inspect( &( tool_ctx -> insp_input ), &( tool_ctx -> insp_output ) ); /* inspector.c */
     }
 
+    /* the spots to extract, if given on the commandline ( turns stream-mode off for cSRA ) */
+    if ( 0 == rc ) {
+        rc = tctx_make_selection( tool_ctx ); /* above */
+    }
+
+    /* stream-mode: only for cSRA, and only with unsorted split-spot output */
+    if ( 0 == rc && tool_ctx -> stream ) {
+        tctx_adjust_stream_mode( tool_ctx ); /* above */
+    }
+
     /* check for presence of columns for certain output-types FASTA vs. FASTQ */
     if ( 0 == rc ) {
         rc = tctx_check_available_columns( tool_ctx );
@@ -791,6 +1020,9 @@ rc_t tctx_populate_and_call_inspector( tool_ctx_t * tool_ctx ) {
         }
     }
         
+    /* decide about threads, slices and memory from what the inspector found */
+    if ( 0 == rc ) { tctx_make_plan( tool_ctx ); }
+
     /* evaluate the free-disk-space according the os */
     if ( 0 == rc ) { tctx_get_disk_limits( tool_ctx ); }
 
@@ -54,6 +54,14 @@ extern "C" {
 #ifndef _h_cmn_iter_
 #include "cmn_iter.h"
 #endif
+
+#ifndef _h_planner_
+#include "planner.h"
+#endif
+
+#ifndef _h_row_selection_
+#include "row_selection.h"
+#endif
     
 #define DFLT_PATH_LEN 4096
 
@@ -69,6 +77,9 @@ typedef struct tool_ctx_t {
     const char * requested_seq_tbl_name;
     const char * seq_defline;
     const char * qual_defline;
+    const char * row_ranges;        /* "1-1000,5000,7000-" from the commandline, NULL for all */
+    const char * spot_list;         /* file with spot-ids, NULL for none */
+    const char * perf_report;       /* JSON-lines performance-report, NULL for none */
 
     VNamelist * ref_name_filter;
 
@@ -86,11 +97,17 @@ typedef struct tool_ctx_t {
     size_t disk_limit_tmp_cmdl;
     size_t disk_limit_out_os;
     size_t disk_limit_tmp_os;
+    size_t requested_mem_limit;     /* 0 ... not given on the commandline */
 
     uint32_t num_threads;
+    uint32_t requested_threads;     /* 0 ... not given on the commandline */
     uint32_t stop_after_step;
+    uint32_t perf_interval;         /* seconds between samples in the perf-report, 0 for none */
     uint64_t total_ram;
     uint64_t row_limit;
+    uint64_t index_stride;
+    uint64_t sample_seed;
+    double sample_fraction;         /* 0.0 ... no sampling */
 
     format_t fmt; /* helper.h */
     check_mode_t check_mode; /* helper.h */
@@ -102,11 +119,16 @@ typedef struct tool_ctx_t {
     bool only_external_refs;
     bool use_name;
     bool keep_tmp_files;
+    bool stream;            /* cSRA: no temp-files, unsorted split-spot output */
 
     join_options_t join_options; /* helper.h */
 
     insp_input_t insp_input;       /* inspector.h */
     insp_output_t insp_output;     /* inspector.h */
+
+    plan_t plan;                   /* planner.h */
+
+    struct row_selection_t * selection;    /* NULL for all spots, row_selection.h */
 } tool_ctx_t;
 
 bool tctx_populate_cmn_iter_params( const tool_ctx_t * tool_ctx,
@@ -34,9 +34,7 @@
 #include "err_msg.h"
 #endif
 
-#ifndef _h_klib_printf_
-#include <klib/printf.h>
-#endif
+#include <string.h>     /* memcpy() */
 
 /* ============================================================================================================= */
 typedef enum vfmt_type_t { vft_literal, vft_str, vft_int } vfmt_type_t;
@@ -214,87 +212,6 @@ static vfmt_entry_t * vfmt_clone_entry( const vfmt_entry_t * src ) {
     return res;
 }
 
-static void vfmt_copy_String_to_buffer( SBuffer_t *buffer, const String * src ) {
-    if ( NULL != src && NULL != buffer ) {
-        uint32_t i = 0;
-        String * dst = &( buffer -> S );
-        char * dst_addr = ( char * )( dst -> addr );
-        while ( i < src -> len && dst -> len < buffer -> buffer_size ) {
-            dst_addr [ dst -> len ] = src -> addr[ i++ ];
-            dst -> len += 1;
-        }
-    }
-}
-
-static void vfmt_copy_int_to_buffer( SBuffer_t *buffer, uint64_t value ) {
-    char temp[ 21 ];
-    size_t temp_written;
-    rc_t rc = string_printf ( temp, sizeof temp, &temp_written, "%lu", value );
-    if ( 0 == rc ) {
-        String S;
-        StringInitCString( &S, temp );
-        vfmt_copy_String_to_buffer( buffer, &S );
-    }
-}
-
-static void vfmt_copy_int_entry_to_buffer( const vfmt_entry_t * self, SBuffer_t *buffer,
-                                           const uint64_t * args, size_t args_len ) {
-    if ( NULL != args && self -> idx < args_len ) {
-        vfmt_copy_int_to_buffer( buffer, args[ self -> idx ] );
-    }
-}
-
-/*we need both: str-args AND int-args, because of the alternative idx-usage */
-static void vfmt_copy_str_entry_to_buffer( const vfmt_entry_t * self, SBuffer_t *buffer,
-                                         const String ** str_args, size_t str_args_len,
-                                         const uint64_t * int_args, size_t int_args_len ) {
-    if ( NULL != str_args && self -> idx < str_args_len ) {
-        const String * src = str_args[ self -> idx ];
-        if ( NULL != src && NULL != src -> addr ) {
-            /* we have a string to use */
-            if ( self -> idx2 == 0xFF ) {
-                /* there is no alternative -> print the string even if len == 0 */
-                vfmt_copy_String_to_buffer( buffer, src );
-            } else {
-                if ( src -> len > 0 ) {
-                    /* there is an alternative, but we have a valid string to print */
-                    vfmt_copy_String_to_buffer( buffer, src );
-                } else if ( NULL != int_args && self -> idx2 < int_args_len ) {
-                    /* there is an alternative - and we have an empty string -  */
-                    vfmt_copy_int_to_buffer( buffer, int_args[ self -> idx2 ] );
-                }
-            }
-        } else if ( NULL != int_args && self -> idx2 < int_args_len ) {
-            /* the string-source is NULL, and we have an alternative to use */
-            vfmt_copy_int_to_buffer( buffer, int_args[ self -> idx2 ] );
-        }
-    } else if ( NULL != int_args && self -> idx2 < int_args_len ) {
-        /* there is not even a array of strings, and we have an alternative to use */
-        vfmt_copy_int_to_buffer( buffer, int_args[ self -> idx2 ] );
-    }
-}
-
-static void vfmt_copy_entry_to_buffer( const vfmt_entry_t * self, SBuffer_t * dst,
-                               const String ** str_args, size_t str_args_len,
-                               const uint64_t * int_args, size_t int_args_len ) {
-    if ( NULL != self && NULL != dst ) {
-        switch ( self -> type ) {
-            /* we enter a string literal */
-            case vft_literal : vfmt_copy_String_to_buffer( dst, self -> literal );
-            break;
-            
-            /* we enter a string argument ( supply the int-vector too, because of the alternative! ) */
-            case vft_str    : vfmt_copy_str_entry_to_buffer( self, dst,
-                                                            str_args, str_args_len,
-                                                            int_args, int_args_len );
-            break;
-            
-            /* we enter a int argument */
-            case vft_int    : vfmt_copy_int_entry_to_buffer( self, dst, int_args, int_args_len ); break;
-        }
-    }
-}
-                               
 /* releases an element, data-pointer to match VectorWhack-callback */
 static void vfmt_destroy_entry( void * self, void * data ) {
     if ( NULL != self ) {
@@ -305,10 +222,24 @@ static void vfmt_destroy_entry( void * self, void * data ) {
 }
 
 /* ============================================================================================================= */
+/* the compiled form of the elements: a flat program, executed for each spot without any lookups */
+typedef enum vfmt_opcode_t { vop_literal, vop_str, vop_str_alt, vop_int } vfmt_opcode_t;
+
+typedef struct vfmt_op_t {
+    uint8_t code;           /* vfmt_opcode_t */
+    uint8_t idx;            /* which str/int-arg to use here */
+    uint8_t idx2;           /* for vop_str_alt: the int-arg to use if the string is NULL or empty */
+    uint32_t ofs;           /* for vop_literal: where the run starts in the literal-pool */
+    uint32_t len;           /* for vop_literal: how long the run is */
+} vfmt_op_t;
+
 typedef struct vfmt_t {
     Vector elements;        /* the elements are pointers to var_fmt_entry_t - structs */
     size_t fixed_len;       /* sum of all literal elements + sum of dflt-len of int-elements */
     SBuffer_t buffer;       /* internal buffer to print into */
+    vfmt_op_t * prog;       /* the compiled elements, adjacent literals joined into one run */
+    uint32_t prog_len;
+    char * literals;        /* all literal runs in one block */
 } vfmt_t;
 /* ============================================================================================================= */
 
@@ -348,12 +279,74 @@ static size_t vfmt_calc_fixed_len( Vector * v ) {
         switch( entry -> type ) {
             case vft_literal: res += entry -> literal -> len; break;
             case vft_int    : res += 20; break;     /* the length of max_uint64_t as string */
-            case vft_str    : break;    /* we do not know yet... */
+            case vft_str    : if ( 0xFF != entry -> idx2 ) { res += 20; } /* the alternative is an int */
+                              break;    /* the string-length we do not know yet... */
         }
     }
     return res;
 }
 
+/* turn the elements into a flat program with one literal-pool */
+static rc_t vfmt_compile( vfmt_t * self ) {
+    rc_t rc = 0;
+    const Vector * v = &( self -> elements );
+    uint32_t i, l = VectorLength( v );
+    uint32_t n = 0;
+    size_t pool_len = 0;
+    bool prev_literal = false;
+
+    /* first pass: count the instructions and the bytes of all literals */
+    for ( i = VectorStart( v ); i < l; ++i ) {
+        const vfmt_entry_t * entry = VectorGet( v, i );
+        if ( vft_literal == entry -> type ) {
+            pool_len += entry -> literal -> len;
+            if ( !prev_literal ) { n++; }
+            prev_literal = true;
+        } else {
+            n++;
+            prev_literal = false;
+        }
+    }
+
+    free( ( void * )self -> prog );
+    free( ( void * )self -> literals );
+    self -> prog_len = 0;
+    self -> prog = calloc( n + 1, sizeof self -> prog[ 0 ] );
+    self -> literals = malloc( pool_len + 1 );
+    if ( NULL == self -> prog || NULL == self -> literals ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        ErrMsg( "var_fmt.c vfmt_compile() -> %R", rc );
+    } else {
+        /* second pass: emit the instructions, join adjacent literals */
+        vfmt_op_t * op = NULL;
+        uint32_t pool_pos = 0;
+        for ( i = VectorStart( v ); i < l; ++i ) {
+            const vfmt_entry_t * entry = VectorGet( v, i );
+            if ( vft_literal == entry -> type ) {
+                if ( NULL == op || vop_literal != op -> code ) {
+                    op = &( self -> prog[ self -> prog_len++ ] );
+                    op -> code = vop_literal;
+                    op -> ofs = pool_pos;
+                    op -> len = 0;
+                }
+                memcpy( self -> literals + pool_pos, entry -> literal -> addr, entry -> literal -> len );
+                pool_pos += entry -> literal -> len;
+                op -> len += entry -> literal -> len;
+            } else {
+                op = &( self -> prog[ self -> prog_len++ ] );
+                op -> idx = entry -> idx;
+                op -> idx2 = entry -> idx2;
+                if ( vft_int == entry -> type ) {
+                    op -> code = vop_int;
+                } else {
+                    op -> code = ( 0xFF == entry -> idx2 ) ? vop_str : vop_str_alt;
+                }
+            }
+        }
+    }
+    return rc;
+}
+
 static void vfmt_append( struct vfmt_t * self,  const String * fmt,
                          const struct vfmt_desc_list_t * vars ) {
     if ( NULL != self && NULL != fmt ) {
@@ -377,6 +370,7 @@ static void vfmt_append( struct vfmt_t * self,  const String * fmt,
         /* calculate new fixed-len, and adjust print-buffer */
         self -> fixed_len = vfmt_calc_fixed_len( &( self -> elements ) );
         increase_SBuffer_to( &( self -> buffer ), ( self -> fixed_len * 4 ) );
+        vfmt_compile( self );
     }
 }
 
@@ -404,6 +398,10 @@ struct vfmt_t * vfmt_create( const String * fmt, const struct vfmt_desc_list_t *
     vfmt_t * self = vfmt_create_by_size( 2048 );
     if ( NULL != self ) {
         vfmt_append( self, fmt, vars );
+        if ( NULL == self -> prog ) {
+            vfmt_release( self );
+            self = NULL;
+        }
     }
     return self;
 }
@@ -421,63 +419,146 @@ void vfmt_release( struct vfmt_t * self ) {
     if ( NULL != self ) {
         VectorWhack ( &( self -> elements ), vfmt_destroy_entry, NULL );
         release_SBuffer( &( self -> buffer ) );
+        free( ( void * ) self -> prog );
+        free( ( void * ) self -> literals );
         free( ( void * ) self );
     }
 }
 
-static size_t vfmt_calc_buffer_size( const struct vfmt_t * self,
-                    const String ** str_args, size_t str_args_len ) {
+/* the string-argument of an instruction, NULL if there is none */
+static const String * vfmt_str_arg( const vfmt_op_t * op, const String ** str_args, size_t str_args_len ) {
+    const String * res = NULL;
+    if ( NULL != str_args && op -> idx < str_args_len ) {
+        res = str_args[ op -> idx ];
+        if ( NULL != res && NULL == res -> addr ) { res = NULL; }
+    }
+    return res;
+}
+
+size_t vfmt_max_len( const struct vfmt_t * self, const String ** str_args, size_t str_args_len ) {
     size_t res = 0;
     if ( NULL != self ) {
-        const Vector * v = &( self -> elements );
-        uint32_t i, l = VectorLength( v );
+        uint32_t i;
         res = self -> fixed_len;
-        for ( i = VectorStart( v ); i < l; ++i ) {
-            const vfmt_entry_t * entry = VectorGet( v, i );
-            if ( NULL != entry ) {
-                if ( vft_str == entry -> type ) {
-                    if ( entry -> idx < str_args_len ) {
-                        const String * S = str_args[ entry -> idx ];
-                        if ( NULL != S ) {
-                            if ( NULL != S -> addr ) {
-                                res += S -> len;
-                            }
-                        }
-                    }
-                }
+        for ( i = 0; i < self -> prog_len; ++i ) {
+            const vfmt_op_t * op = &( self -> prog[ i ] );
+            if ( vop_str == op -> code || vop_str_alt == op -> code ) {
+                const String * S = vfmt_str_arg( op, str_args, str_args_len );
+                if ( NULL != S ) { res += S -> len; }
             }
         }
     }
     return res;
 }
 
+static const char vfmt_digit_pairs[ 201 ] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/* decimal representation of value, written 2 digits at a time from the back, no printf-parsing */
+static size_t vfmt_u64_to_dec( char * dst, uint64_t value ) {
+    char tmp[ 20 ];
+    char * p = tmp + sizeof tmp;
+    size_t len;
+    while ( value >= 100 ) {
+        uint32_t i = ( uint32_t )( value % 100 ) * 2;
+        value /= 100;
+        *--p = vfmt_digit_pairs[ i + 1 ];
+        *--p = vfmt_digit_pairs[ i ];
+    }
+    if ( value >= 10 ) {
+        uint32_t i = ( uint32_t )value * 2;
+        *--p = vfmt_digit_pairs[ i + 1 ];
+        *--p = vfmt_digit_pairs[ i ];
+    } else {
+        *--p = ( char )( '0' + value );
+    }
+    len = ( tmp + sizeof tmp ) - p;
+    memcpy( dst, p, len );
+    return len;
+}
+
+size_t vfmt_render( const struct vfmt_t * self, char * dst,
+                    const String ** str_args, size_t str_args_len,
+                    const uint64_t * int_args, size_t int_args_len ) {
+    char * p = dst;
+    if ( NULL != self && NULL != dst ) {
+        const vfmt_op_t * op = self -> prog;
+        const vfmt_op_t * end = op + self -> prog_len;
+        for ( ; op < end; ++op ) {
+            switch( op -> code ) {
+                case vop_literal : memcpy( p, self -> literals + op -> ofs, op -> len );
+                                   p += op -> len;
+                                   break;
+
+                /* no alternative: print the string even if it is empty */
+                case vop_str     : {
+                                        const String * S = vfmt_str_arg( op, str_args, str_args_len );
+                                        if ( NULL != S ) {
+                                            memcpy( p, S -> addr, S -> len );
+                                            p += S -> len;
+                                        }
+                                   }
+                                   break;
+
+                /* with an alternative: the int-arg if the string is NULL or empty */
+                case vop_str_alt : {
+                                        const String * S = vfmt_str_arg( op, str_args, str_args_len );
+                                        if ( NULL != S && S -> len > 0 ) {
+                                            memcpy( p, S -> addr, S -> len );
+                                            p += S -> len;
+                                        } else if ( NULL != int_args && op -> idx2 < int_args_len ) {
+                                            p += vfmt_u64_to_dec( p, int_args[ op -> idx2 ] );
+                                        }
+                                   }
+                                   break;
+
+                case vop_int     : if ( NULL != int_args && op -> idx < int_args_len ) {
+                                        p += vfmt_u64_to_dec( p, int_args[ op -> idx ] );
+                                   }
+                                   break;
+            }
+        }
+    }
+    return p - dst;
+}
+
+rc_t vfmt_append_to_buffer( const struct vfmt_t * self, SBuffer_t * dst,
+                    const String ** str_args, size_t str_args_len,
+                    const uint64_t * int_args, size_t int_args_len ) {
+    rc_t rc;
+    if ( NULL == self || NULL == dst ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcNull );
+    } else {
+        size_t needed = vfmt_max_len( self, str_args, str_args_len ); /* above */
+        rc = reserve_SBuffer( dst, needed ); /* sbuffer.c */
+        if ( 0 == rc ) {
+            char * p = ( char * )&( dst -> S . addr[ dst -> S . size ] );
+            dst -> S . size += vfmt_render( self, p, str_args, str_args_len, int_args, int_args_len );
+            dst -> S . len = ( uint32_t )dst -> S . size;
+        }
+    }
+    return rc;
+}
+
 /* apply the var-fmt-struct to the given arguments, write result to buffer */
 SBuffer_t * vfmt_write_to_buffer( struct vfmt_t * self,
                     const String ** str_args, size_t str_args_len,
                     const uint64_t * int_args, size_t int_args_len ) {
     SBuffer_t * res = NULL;
-    if ( NULL != self )
-    {
-        size_t needed = vfmt_calc_buffer_size( self, str_args, str_args_len ); /* above */
-        if ( needed > 0 )
-        {
-            rc_t rc = increase_SBuffer_to( &( self -> buffer ), needed ); /* does nothing if not neccessary */
-            if ( 0 == rc )
-            {
-                SBuffer_t * dst = &( self -> buffer );
-                self -> buffer . S . len = 0;
-                self -> buffer . S . size = 0;
-
-                const Vector * v = &( self -> elements );
-                uint32_t i, l = VectorLength( v );
-                for ( i = VectorStart( v ); i < l; ++i ) {
-                    const vfmt_entry_t * entry = VectorGet( v, i );
-                    vfmt_copy_entry_to_buffer( entry, dst,
-                                               str_args, str_args_len, int_args, int_args_len );
-                }
-                self -> buffer . S . size = self -> buffer . S . len;
-                res = &( self -> buffer );
-            }
+    if ( NULL != self ) {
+        clear_SBuffer( &( self -> buffer ) ); /* sbuffer.c */
+        if ( 0 == vfmt_append_to_buffer( self, &( self -> buffer ),
+                                         str_args, str_args_len, int_args, int_args_len ) ) {
+            res = &( self -> buffer );
         }
     }
     return res;
@@ -69,6 +69,20 @@ struct vfmt_t;
 struct vfmt_t * vfmt_create( const String * fmt, const struct vfmt_desc_list_t * vars );
 void vfmt_release( struct vfmt_t * self );
 
+/* the upper bound of the bytes vfmt_render() produces for these arguments */
+size_t vfmt_max_len( const struct vfmt_t * self, const String ** str_args, size_t str_args_len );
+
+/* render the compiled format into dst, which has room for vfmt_max_len() bytes,
+   returns the number of bytes written */
+size_t vfmt_render( const struct vfmt_t * self, char * dst,
+                    const String ** str_args, size_t str_args_len,
+                    const uint64_t * int_args, size_t int_args_len );
+
+/* render at the end of the buffer, enlarges it if needed */
+rc_t vfmt_append_to_buffer( const struct vfmt_t * self, SBuffer_t * dst,
+                    const String ** str_args, size_t str_args_len,
+                    const uint64_t * int_args, size_t int_args_len );
+
 /* print to buffer */
 SBuffer_t * vfmt_write_to_buffer( struct vfmt_t * self,
                     const String ** str_args, size_t str_args_len,
@@ -0,0 +1,224 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "zero_copy.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#include <stdlib.h>
+
+typedef struct zero_copy_t {
+    KDirectory * dir;
+    int dst_fd;
+    uint64_t block_size;    /* of the dst-filesystem, a reflink has to start at a block-boundary */
+} zero_copy_t;
+
+const char * zero_copy_method_2_string( zc_method_t method ) {
+    const char * res = "none";
+    switch( method ) {
+        case zcm_reflink    : res = "reflink"; break;
+        case zcm_copy_range : res = "copy_file_range"; break;
+        default             : break;
+    }
+    return res;
+}
+
+bool zero_copy_unsupported( rc_t rc ) {
+    return ( 0 != rc && rcUnsupported == GetRCState( rc ) );
+}
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <linux/fs.h>   /* FICLONERANGE */
+
+#define ZC_MAX_PATH 4096
+
+static rc_t zc_rc_from_errno( int err ) {
+    rc_t rc;
+    switch( err ) {
+        /* the kernel or the filesystem cannot do it: not an error, the caller falls back */
+        case EXDEV      :
+        case EOPNOTSUPP :
+        case ENOSYS     :
+        case EINVAL     :
+        case EBADF      :
+        case ETXTBSY    : rc = RC( rcExe, rcFile, rcCopying, rcFunction, rcUnsupported ); break;
+
+        case ENOSPC     : rc = RC( rcExe, rcFile, rcCopying, rcStorage, rcExhausted ); break;
+        default         : rc = RC( rcExe, rcFile, rcCopying, rcFile, rcFailed ); break;
+    }
+    return rc;
+}
+
+static int zc_open( KDirectory * dir, const char * filename, int flags, rc_t * rc ) {
+    int res = -1;
+    char path[ ZC_MAX_PATH ];
+    *rc = KDirectoryResolvePath( dir, true, path, sizeof path, "%s", filename );
+    if ( 0 != *rc ) {
+        ErrMsg( "zero_copy.c zc_open().KDirectoryResolvePath( '%s' ) -> %R", filename, *rc );
+    } else {
+        res = open( path, flags );
+        if ( res < 0 ) {
+            *rc = zc_rc_from_errno( errno );
+            ErrMsg( "zero_copy.c zc_open( '%s' ) -> %R", path, *rc );
+        }
+    }
+    return res;
+}
+
+rc_t make_zero_copy( struct zero_copy_t ** zc, KDirectory * dir, const char * dst_filename ) {
+    rc_t rc = 0;
+    if ( NULL == zc || NULL == dir || NULL == dst_filename ) {
+        rc = RC( rcExe, rcFile, rcConstructing, rcParam, rcNull );
+    } else {
+        zero_copy_t * res = calloc( 1, sizeof * res );
+        *zc = NULL;
+        if ( NULL == res ) {
+            rc = RC( rcExe, rcFile, rcConstructing, rcMemory, rcExhausted );
+            ErrMsg( "make_zero_copy().calloc( %d ) -> %R", ( sizeof * res ), rc );
+        } else {
+            res -> dir = dir;
+            res -> dst_fd = zc_open( dir, dst_filename, O_WRONLY, &rc ); /* above */
+            if ( 0 == rc ) {
+                struct stat st;
+                res -> block_size = ( 0 == fstat( res -> dst_fd, &st ) && st . st_blksize > 0 )
+                                        ? st . st_blksize : 4096;
+                *zc = res;
+            } else {
+                free( ( void * ) res );
+            }
+        }
+    }
+    return rc;
+}
+
+void release_zero_copy( struct zero_copy_t * self ) {
+    if ( NULL != self ) {
+        if ( self -> dst_fd >= 0 ) { close( self -> dst_fd ); }
+        free( ( void * ) self );
+    }
+}
+
+/* share the blocks of the whole src-file, only possible at a block-boundary in dst */
+static bool zc_reflink( zero_copy_t * self, int src_fd, uint64_t dst_pos ) {
+    bool res = false;
+#ifdef FICLONERANGE
+    if ( 0 == ( dst_pos % self -> block_size ) ) {
+        struct file_clone_range fcr;
+        fcr . src_fd = src_fd;
+        fcr . src_offset = 0;
+        fcr . src_length = 0;   /* 0 ... up to the end of the src-file */
+        fcr . dest_offset = dst_pos;
+        res = ( 0 == ioctl( self -> dst_fd, FICLONERANGE, &fcr ) );
+    }
+#endif
+    return res;
+}
+
+static rc_t zc_copy_range( zero_copy_t * self, int src_fd, uint64_t dst_pos, uint64_t size ) {
+    rc_t rc = 0;
+#ifdef __NR_copy_file_range
+    /* called via syscall(), glibc has a wrapper only since 2.27 */
+    loff_t src_off = 0;
+    loff_t dst_off = dst_pos;
+    while ( 0 == rc && ( uint64_t )src_off < size ) {
+        long n = syscall( __NR_copy_file_range, src_fd, &src_off, self -> dst_fd, &dst_off,
+                          ( size_t )( size - src_off ), 0 );
+        if ( n < 0 ) {
+            if ( EINTR != errno ) { rc = zc_rc_from_errno( errno ); }
+        } else if ( 0 == n ) {
+            /* the src-file is shorter than it was a moment ago... */
+            rc = RC( rcExe, rcFile, rcCopying, rcFunction, rcUnsupported );
+        }
+    }
+#else
+    rc = RC( rcExe, rcFile, rcCopying, rcFunction, rcUnsupported );
+#endif
+    return rc;
+}
+
+rc_t zero_copy_append( struct zero_copy_t * self, const char * src_filename, uint64_t dst_pos,
+                       zc_method_t * method, uint64_t * written ) {
+    rc_t rc = 0;
+    if ( NULL == self ) {
+        rc = RC( rcExe, rcFile, rcCopying, rcSelf, rcNull );
+    } else if ( NULL == src_filename || NULL == method || NULL == written ) {
+        rc = RC( rcExe, rcFile, rcCopying, rcParam, rcNull );
+    } else {
+        int src_fd = zc_open( self -> dir, src_filename, O_RDONLY, &rc ); /* above */
+        if ( 0 == rc ) {
+            struct stat st;
+            if ( 0 != fstat( src_fd, &st ) ) {
+                rc = zc_rc_from_errno( errno );
+            } else if ( 0 == st . st_size ) {
+                *method = zcm_none;
+                *written = 0;
+            } else if ( zc_reflink( self, src_fd, dst_pos ) ) {
+                *method = zcm_reflink;
+                *written = st . st_size;
+            } else {
+                rc = zc_copy_range( self, src_fd, dst_pos, st . st_size ); /* above */
+                if ( 0 == rc ) {
+                    *method = zcm_copy_range;
+                    *written = st . st_size;
+                }
+            }
+            if ( 0 != rc && !zero_copy_unsupported( rc ) ) {
+                ErrMsg( "zero_copy_append( '%s' ) -> %R", src_filename, rc );
+            }
+            close( src_fd );
+        }
+    }
+    return rc;
+}
+
+#else
+
+/* no zero-copy on this platform: the caller always falls back to the copy-machine */
+
+rc_t make_zero_copy( struct zero_copy_t ** zc, KDirectory * dir, const char * dst_filename ) {
+    if ( NULL != zc ) { *zc = NULL; }
+    return RC( rcExe, rcFile, rcConstructing, rcFunction, rcUnsupported );
+}
+
+void release_zero_copy( struct zero_copy_t * self ) {
+}
+
+rc_t zero_copy_append( struct zero_copy_t * self, const char * src_filename, uint64_t dst_pos,
+                       zc_method_t * method, uint64_t * written ) {
+    return RC( rcExe, rcFile, rcCopying, rcFunction, rcUnsupported );
+}
+
+#endif
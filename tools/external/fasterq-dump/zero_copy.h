@@ -0,0 +1,85 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_zero_copy_
+#define _h_zero_copy_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_kfs_directory_
+#include <kfs/directory.h>
+#endif
+
+/* ================================================================================= */
+
+/* -----------------------------------------------------------------------------------
+    Appends whole files to a destination-file without moving the data through
+    user-space ( Linux only ): first it tries to share the blocks ( FICLONERANGE,
+    reflink on XFS/btrfs ), then copy_file_range(). Both only work if source and
+    destination are on the same filesystem. If the kernel cannot do it for a file,
+    zero_copy_append() returns an error with state rcUnsupported - the caller then
+    has to copy this file ( and the following ones ) the conventional way, the
+    partially written range in the destination will simply be overwritten.
+
+    usage:
+        if ( 0 == make_zero_copy( &zc, dir, dst_filename ) ) {
+            for each src_file :
+                rc = zero_copy_append( zc, src_file, pos, &method, &written );
+                if ( zero_copy_unsupported( rc ) ) break;
+                pos += written;
+            release_zero_copy( zc );
+        }
+   ----------------------------------------------------------------------------------- */
+
+typedef enum zc_method_t { zcm_none, zcm_reflink, zcm_copy_range } zc_method_t;
+
+struct zero_copy_t;
+
+/* returns rcUnsupported if the platform has no zero-copy at all */
+rc_t make_zero_copy( struct zero_copy_t ** zc, KDirectory * dir, const char * dst_filename );
+
+void release_zero_copy( struct zero_copy_t * self );
+
+/* appends the whole src-file at dst_pos, method and written are set on success */
+rc_t zero_copy_append( struct zero_copy_t * self, const char * src_filename, uint64_t dst_pos,
+                       zc_method_t * method, uint64_t * written );
+
+/* true if the rc tells the caller to fall back to a conventional copy */
+bool zero_copy_unsupported( rc_t rc );
+
+const char * zero_copy_method_2_string( zc_method_t method );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
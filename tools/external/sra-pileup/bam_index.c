@@ -0,0 +1,427 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "bam_index.h"
+
+#ifndef _h_klib_log_
+#include <klib/log.h>
+#endif
+
+#ifndef _h_klib_vector_
+#include <klib/vector.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BAM_INDEX_MIN_SHIFT 14      /* 16 kbp, the smallest bin and the linear-index window */
+#define BAM_INDEX_BAI_DEPTH 5       /* BAI: 6 levels of bins, covers 512 Mbp */
+
+typedef struct index_chunk {
+    uint64_t beg;
+    uint64_t end;
+} index_chunk;
+
+typedef struct index_bin {
+    uint32_t bin;
+    uint32_t n_chunks;
+    uint32_t allocated;
+    index_chunk * chunks;
+} index_bin;
+
+typedef struct index_ref {
+    index_bin * bins;
+    uint32_t n_bins;
+    uint32_t bins_allocated;
+    uint64_t * linear;              /* first offset per 16k-window, 0 ... none yet */
+    uint64_t n_linear;
+    uint64_t off_beg;               /* of the first record, for the pseudo-bin */
+    uint64_t off_end;               /* behind the last record */
+    uint64_t n_mapped;
+    uint64_t n_unmapped;
+} index_ref;
+
+typedef struct bam_index {
+    index_ref * refs;
+    uint32_t n_refs;
+    bool csi;
+    int depth;
+    int64_t max_pos;                /* the binning-scheme does not reach beyond */
+    KVector * bin_slots;            /* bin -> slot + 1 in the bins of the current reference */
+    int32_t cur_ref;                /* -1 ... none yet */
+    int64_t last_beg;
+    bool unplaced;                  /* the unplaced records at the end have started */
+    uint64_t n_no_coor;
+} bam_index;
+
+/* as in the SAM-spec / htslib, min_shift and depth are those of the CSI-format */
+static uint32_t reg2bin( int64_t beg, int64_t end, int min_shift, int depth ) {
+    int l, s = min_shift;
+    uint32_t t = ( ( 1 << depth * 3 ) - 1 ) / 7;
+    for ( --end, l = depth; l > 0; --l, s += 3, t -= 1 << l * 3 ) {
+        if ( beg >> s == end >> s ) {
+            return t + ( uint32_t )( beg >> s );
+        }
+    }
+    return 0;
+}
+
+uint16_t bam_reg2bin( int64_t beg, int64_t end ) {
+    if ( end > ( ( int64_t )1 << ( BAM_INDEX_MIN_SHIFT + 3 * BAM_INDEX_BAI_DEPTH ) ) ) {
+        return 4680;    /* what samtools writes for records out of reach of the BAI-scheme */
+    }
+    return ( uint16_t )reg2bin( beg, end, BAM_INDEX_MIN_SHIFT, BAM_INDEX_BAI_DEPTH );
+}
+
+/* the pseudo-bin holding the offsets and counts of a reference */
+static uint32_t pseudo_bin( int depth ) {
+    return ( ( 1 << ( depth + 1 ) * 3 ) - 1 ) / 7 + 1;
+}
+
+/* the first linear-index window a bin covers */
+static uint64_t bin_first_window( uint32_t bin, int depth ) {
+    int l = 0;
+    uint32_t t = 0;
+    while ( l < depth && bin >= t + ( 1u << l * 3 ) ) {
+        t += 1u << l * 3;
+        ++l;
+    }
+    return ( uint64_t )( bin - t ) << ( 3 * ( depth - l ) );
+}
+
+static void release_index_ref( index_ref * r ) {
+    uint32_t idx;
+    for ( idx = 0; idx < r -> n_bins; ++idx ) {
+        free( r -> bins[ idx ] . chunks );
+    }
+    free( r -> bins );
+    free( r -> linear );
+}
+
+void release_bam_index( bam_index * self ) {
+    if ( self != NULL ) {
+        if ( self -> refs != NULL ) {
+            uint32_t idx;
+            for ( idx = 0; idx < self -> n_refs; ++idx ) {
+                release_index_ref( &( self -> refs[ idx ] ) );
+            }
+            free( self -> refs );
+        }
+        KVectorRelease( self -> bin_slots );
+        free( self );
+    }
+}
+
+rc_t make_bam_index( bam_index ** idx, uint32_t n_refs, uint64_t max_ref_len, bool csi ) {
+    rc_t rc = 0;
+    bam_index * self = calloc( 1, sizeof * self );
+    *idx = NULL;
+    if ( self == NULL ) {
+        rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    } else {
+        self -> n_refs = n_refs;
+        self -> csi = csi;
+        self -> depth = BAM_INDEX_BAI_DEPTH;
+        if ( csi ) {
+            /* as samtools: deepen the scheme until the longest reference fits */
+            while ( ( ( uint64_t )1 << ( BAM_INDEX_MIN_SHIFT + 3 * self -> depth ) ) < max_ref_len ) {
+                self -> depth++;
+            }
+        }
+        self -> max_pos = ( int64_t )1 << ( BAM_INDEX_MIN_SHIFT + 3 * self -> depth );
+        self -> cur_ref = -1;
+        if ( n_refs > 0 ) {
+            self -> refs = calloc( n_refs, sizeof self -> refs[ 0 ] );
+            if ( self -> refs == NULL ) {
+                rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            }
+        }
+        if ( rc == 0 ) {
+            rc = KVectorMake( &( self -> bin_slots ) );
+        }
+        if ( rc != 0 ) {
+            (void)LOGERR( klogErr, rc, "cannot make BAM-index" );
+            release_bam_index( self );
+        } else {
+            *idx = self;
+        }
+    }
+    return rc;
+}
+
+static rc_t get_bin( bam_index * self, index_ref * r, uint32_t bin, index_bin ** b ) {
+    uint64_t slot;
+    rc_t rc = KVectorGetU64( self -> bin_slots, bin, &slot );
+    if ( rc == 0 ) {
+        *b = &( r -> bins[ slot - 1 ] );
+    } else {
+        rc = 0;
+        if ( r -> n_bins >= r -> bins_allocated ) {
+            uint32_t new_allocated = ( r -> bins_allocated == 0 ) ? 64 : r -> bins_allocated * 2;
+            index_bin * tmp = realloc( r -> bins, new_allocated * sizeof * tmp );
+            if ( tmp == NULL ) {
+                rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+            } else {
+                r -> bins = tmp;
+                r -> bins_allocated = new_allocated;
+            }
+        }
+        if ( rc == 0 ) {
+            *b = &( r -> bins[ r -> n_bins++ ] );
+            memset( *b, 0, sizeof ** b );
+            ( *b ) -> bin = bin;
+            rc = KVectorSetU64( self -> bin_slots, bin, r -> n_bins );
+        }
+    }
+    return rc;
+}
+
+static rc_t add_chunk( index_bin * b, uint64_t beg, uint64_t end ) {
+    rc_t rc = 0;
+    index_chunk * last = ( b -> n_chunks > 0 ) ? &( b -> chunks[ b -> n_chunks - 1 ] ) : NULL;
+    /* extend the last chunk if the record follows it directly or starts in the same block */
+    if ( last != NULL && ( last -> end == beg || ( last -> end >> 16 ) == ( beg >> 16 ) ) ) {
+        last -> end = end;
+    } else {
+        if ( b -> n_chunks >= b -> allocated ) {
+            uint32_t new_allocated = ( b -> allocated == 0 ) ? 4 : b -> allocated * 2;
+            index_chunk * tmp = realloc( b -> chunks, new_allocated * sizeof * tmp );
+            if ( tmp == NULL ) {
+                rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+            } else {
+                b -> chunks = tmp;
+                b -> allocated = new_allocated;
+            }
+        }
+        if ( rc == 0 ) {
+            b -> chunks[ b -> n_chunks ] . beg = beg;
+            b -> chunks[ b -> n_chunks ] . end = end;
+            b -> n_chunks++;
+        }
+    }
+    return rc;
+}
+
+static rc_t add_linear( index_ref * r, int64_t beg, int64_t end, uint64_t voffset ) {
+    rc_t rc = 0;
+    uint64_t first = ( uint64_t )beg >> BAM_INDEX_MIN_SHIFT;
+    uint64_t last = ( uint64_t )( end - 1 ) >> BAM_INDEX_MIN_SHIFT;
+    if ( last >= r -> n_linear ) {
+        uint64_t new_n = ( r -> n_linear == 0 ) ? 1024 : r -> n_linear;
+        uint64_t * tmp;
+        while ( new_n <= last ) { new_n *= 2; }
+        tmp = realloc( r -> linear, new_n * sizeof * tmp );
+        if ( tmp == NULL ) {
+            rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        } else {
+            memset( &( tmp[ r -> n_linear ] ), 0, ( new_n - r -> n_linear ) * sizeof * tmp );
+            r -> linear = tmp;
+            r -> n_linear = new_n;
+        }
+    }
+    if ( rc == 0 ) {
+        uint64_t w;
+        for ( w = first; w <= last; ++w ) {
+            if ( r -> linear[ w ] == 0 ) {
+                r -> linear[ w ] = voffset;
+            }
+        }
+    }
+    return rc;
+}
+
+/* the reference is complete: trim the linear index, fill its holes */
+static rc_t finish_ref( bam_index * self ) {
+    rc_t rc = 0;
+    if ( self -> cur_ref >= 0 ) {
+        index_ref * r = &( self -> refs[ self -> cur_ref ] );
+        uint64_t n = r -> n_linear;
+        uint64_t w;
+        while ( n > 0 && r -> linear[ n - 1 ] == 0 ) { --n; }
+        r -> n_linear = n;
+        /* an empty window gets the offset of the window before it, the leading ones the first */
+        for ( w = 0; w < n; ++w ) {
+            if ( r -> linear[ w ] == 0 ) {
+                r -> linear[ w ] = ( w > 0 ) ? r -> linear[ w - 1 ] : r -> off_beg;
+            }
+        }
+        KVectorRelease( self -> bin_slots );
+        self -> bin_slots = NULL;
+        rc = KVectorMake( &( self -> bin_slots ) );
+    }
+    return rc;
+}
+
+rc_t bam_index_add( bam_index * self, int32_t ref_id, int64_t beg, int64_t end,
+                    bool mapped, uint64_t voffset_beg, uint64_t voffset_end ) {
+    rc_t rc = 0;
+    if ( ref_id < 0 ) {
+        self -> unplaced = true;
+        self -> n_no_coor++;
+    } else if ( self -> unplaced || ( uint32_t )ref_id >= self -> n_refs ||
+                ref_id < self -> cur_ref ||
+                ( ref_id == self -> cur_ref && beg < self -> last_beg ) ) {
+        rc = RC( rcExe, rcIndex, rcInserting, rcData, rcOutoforder );
+    } else if ( end > self -> max_pos || beg < 0 ) {
+        rc = RC( rcExe, rcIndex, rcInserting, rcRange, rcExcessive );
+    } else {
+        index_ref * r = &( self -> refs[ ref_id ] );
+        index_bin * b;
+        if ( ref_id != self -> cur_ref ) {
+            rc = finish_ref( self );
+            self -> cur_ref = ref_id;
+            r -> off_beg = voffset_beg;
+        }
+        if ( end <= beg ) {
+            end = beg + 1;
+        }
+        self -> last_beg = beg;
+        if ( rc == 0 ) {
+            rc = get_bin( self, r, reg2bin( beg, end, BAM_INDEX_MIN_SHIFT, self -> depth ), &b );
+        }
+        if ( rc == 0 ) {
+            rc = add_chunk( b, voffset_beg, voffset_end );
+        }
+        if ( rc == 0 ) {
+            rc = add_linear( r, beg, end, voffset_beg );
+        }
+        if ( rc == 0 ) {
+            r -> off_end = voffset_end;
+            if ( mapped ) {
+                r -> n_mapped++;
+            } else {
+                r -> n_unmapped++;
+            }
+        }
+    }
+    return rc;
+}
+
+static rc_t put_u32( struct dyn_string * out, uint32_t v ) {
+    char b[ 4 ];
+    b[ 0 ] = v & 0xff; b[ 1 ] = ( v >> 8 ) & 0xff; b[ 2 ] = ( v >> 16 ) & 0xff; b[ 3 ] = ( v >> 24 ) & 0xff;
+    return ds_add_mem( out, b, sizeof b ); /* dyn_string.c */
+}
+
+static rc_t put_u64( struct dyn_string * out, uint64_t v ) {
+    rc_t rc = put_u32( out, ( uint32_t )v );
+    if ( rc == 0 ) {
+        rc = put_u32( out, ( uint32_t )( v >> 32 ) );
+    }
+    return rc;
+}
+
+typedef struct index_writer {
+    uint64_t ( * translate )( const void * data, uint64_t voffset );
+    const void * data;
+    struct dyn_string * out;
+} index_writer;
+
+static rc_t put_offset( const index_writer * iw, uint64_t voffset ) {
+    return put_u64( iw -> out, iw -> translate( iw -> data, voffset ) );
+}
+
+static rc_t write_index_ref( const bam_index * self, const index_writer * iw, const index_ref * r ) {
+    uint32_t idx;
+    bool has_meta = ( r -> n_mapped + r -> n_unmapped > 0 );
+    /* n_bin */
+    rc_t rc = put_u32( iw -> out, r -> n_bins + ( has_meta ? 1 : 0 ) );
+    for ( idx = 0; rc == 0 && idx < r -> n_bins; ++idx ) {
+        const index_bin * b = &( r -> bins[ idx ] );
+        uint32_t c;
+        rc = put_u32( iw -> out, b -> bin );
+        if ( rc == 0 && self -> csi ) {
+            /* loffset: the first record overlapping the start of the bin, from the linear index */
+            uint64_t w = bin_first_window( b -> bin, self -> depth );
+            uint64_t loff = ( w < r -> n_linear ) ? r -> linear[ w ] : b -> chunks[ 0 ] . beg;
+            if ( loff > b -> chunks[ 0 ] . beg ) { loff = b -> chunks[ 0 ] . beg; }
+            rc = put_offset( iw, loff );
+        }
+        if ( rc == 0 ) {
+            rc = put_u32( iw -> out, b -> n_chunks );
+        }
+        for ( c = 0; rc == 0 && c < b -> n_chunks; ++c ) {
+            rc = put_offset( iw, b -> chunks[ c ] . beg );
+            if ( rc == 0 ) {
+                rc = put_offset( iw, b -> chunks[ c ] . end );
+            }
+        }
+    }
+    if ( rc == 0 && has_meta ) {
+        /* the pseudo-bin: 2 chunks, the first one the offsets, the second one the counts */
+        rc = put_u32( iw -> out, pseudo_bin( self -> depth ) );
+        if ( rc == 0 && self -> csi ) { rc = put_u64( iw -> out, 0 ); }
+        if ( rc == 0 ) { rc = put_u32( iw -> out, 2 ); }
+        if ( rc == 0 ) { rc = put_offset( iw, r -> off_beg ); }
+        if ( rc == 0 ) { rc = put_offset( iw, r -> off_end ); }
+        if ( rc == 0 ) { rc = put_u64( iw -> out, r -> n_mapped ); }
+        if ( rc == 0 ) { rc = put_u64( iw -> out, r -> n_unmapped ); }
+    }
+    if ( rc == 0 && !self -> csi ) {
+        /* the linear index exists only in BAI */
+        uint64_t w;
+        rc = put_u32( iw -> out, ( uint32_t )r -> n_linear );
+        for ( w = 0; rc == 0 && w < r -> n_linear; ++w ) {
+            rc = put_offset( iw, r -> linear[ w ] );
+        }
+    }
+    return rc;
+}
+
+rc_t bam_index_write( bam_index * self,
+                      uint64_t ( * translate )( const void * data, uint64_t voffset ),
+                      const void * data,
+                      struct dyn_string * out ) {
+    index_writer iw;
+    rc_t rc = finish_ref( self );
+    iw . translate = translate;
+    iw . data = data;
+    iw . out = out;
+    if ( rc == 0 ) {
+        if ( self -> csi ) {
+            rc = ds_add_mem( out, "CSI\1", 4 );
+            if ( rc == 0 ) { rc = put_u32( out, BAM_INDEX_MIN_SHIFT ); }
+            if ( rc == 0 ) { rc = put_u32( out, self -> depth ); }
+            if ( rc == 0 ) { rc = put_u32( out, 0 ); }    /* l_aux */
+        } else {
+            rc = ds_add_mem( out, "BAI\1", 4 );
+        }
+    }
+    if ( rc == 0 ) {
+        uint32_t idx;
+        rc = put_u32( out, self -> n_refs );
+        for ( idx = 0; rc == 0 && idx < self -> n_refs; ++idx ) {
+            rc = write_index_ref( self, &iw, &( self -> refs[ idx ] ) );
+        }
+    }
+    if ( rc == 0 ) {
+        rc = put_u64( out, self -> n_no_coor );
+    }
+    if ( rc != 0 ) {
+        (void)LOGERR( klogErr, rc, "cannot write BAM-index" );
+    }
+    return rc;
+}
@@ -0,0 +1,82 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#ifndef _h_bam_index_
+#define _h_bam_index_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_dyn_string_
+#include "dyn_string.h"
+#endif
+
+/* -----------------------------------------------------------------------------------
+    Builds a BAI- or CSI-index ( binning- and linear-index, as in the SAM-spec ) while
+    the records of a coordinate-sorted BAM-file are written. Because the records come
+    in sorted, a reference is complete as soon as the next one starts, only the bins
+    of the current reference have to be looked up.
+
+    The virtual offsets handed in are the block-number based ones of bgzf.h, they are
+    translated into file-offsets when the index is finally written.
+
+    usage:
+        make_bam_index( &idx, n_refs, max_ref_len, false );
+        bam_index_add( idx, ref_id, beg, end, mapped, voffset_beg, voffset_end );
+        ... for each record, returns rcOutoforder if the records are not sorted ...
+        bam_index_write( idx, translate, bgzf, out );   ... out gets the index-file
+        release_bam_index( idx );
+   ----------------------------------------------------------------------------------- */
+
+struct bam_index;
+
+/* csi = false ... BAI, can index references up to 512 Mbp */
+rc_t make_bam_index( struct bam_index ** idx, uint32_t n_refs, uint64_t max_ref_len, bool csi );
+
+/* ref_id = -1 ... an unplaced record, end is exclusive */
+rc_t bam_index_add( struct bam_index * self, int32_t ref_id, int64_t beg, int64_t end,
+                    bool mapped, uint64_t voffset_beg, uint64_t voffset_end );
+
+/* the bytes of the index-file, CSI has to be BGZF-compressed by the caller */
+rc_t bam_index_write( struct bam_index * self,
+                      uint64_t ( * translate )( const void * data, uint64_t voffset ),
+                      const void * data,
+                      struct dyn_string * out );
+
+void release_bam_index( struct bam_index * self );
+
+/* the bin of a record in the BAM-format, with the BAI-binning-scheme */
+uint16_t bam_reg2bin( int64_t beg, int64_t end );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,996 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "bam_writer.h"
+
+#ifndef _h_bgzf_
+#include "bgzf.h"
+#endif
+
+#ifndef _h_bam_index_
+#include "bam_index.h"
+#endif
+
+#ifndef _h_dyn_string_
+#include "dyn_string.h"
+#endif
+
+#ifndef _h_klib_log_
+#include <klib/log.h>
+#endif
+
+#ifndef _h_klib_out_
+#include <klib/out.h>
+#endif
+
+#ifndef _h_klib_sort_
+#include <klib/sort.h>
+#endif
+
+#ifndef _h_kfs_directory_
+#include <kfs/directory.h>
+#endif
+
+#ifndef _h_kfs_file_
+#include <kfs/file.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BAM_FIELDS 11   /* the mandatory fields of a SAM-line */
+
+typedef struct bam_writer {
+    KFile * f;
+    struct bgzf_writer * bgzf;
+    struct bam_index * index;       /* NULL if no index requested, or given up */
+    char * index_filename;
+    bool csi;
+
+    KWrtWriter org_writer;          /* the KOut-handler before us */
+    void * org_data;
+
+    char * hdr;                     /* the text of the header */
+    size_t hdr_len;
+    size_t hdr_allocated;
+    bool hdr_done;                  /* the BAM-header is written */
+
+    char * line;                    /* the incomplete SAM-line KOutMsg() is printing */
+    size_t line_len;
+    size_t line_allocated;
+
+    char ** ref_names;              /* the reference-dictionary, in header-order */
+    uint32_t * ref_lens;
+    uint32_t * ref_sorted;          /* ref-ids sorted by name, for bam_writer_ref_id() */
+    uint32_t n_refs;
+    uint32_t refs_allocated;
+    int32_t last_ref_id;            /* the last one looked up, most lookups ask for it again */
+
+    uint8_t * rec;                  /* the record being built */
+    size_t rec_len;
+    size_t rec_allocated;
+    int32_t rec_ref_id;
+    int64_t rec_beg;
+    int64_t rec_end;
+    bool rec_mapped;
+
+    uint8_t qual_direct[ 256 ];     /* phred + 33 -> phred, quantized, for bam_writer_begin() */
+    uint8_t qual_text[ 256 ];       /* phred + 33 -> phred, for SAM-lines ( quantized already ) */
+    uint8_t seq_code[ 256 ];        /* ASCII -> 4-bit base */
+} bam_writer;
+
+static rc_t reserve( void ** buf, size_t * allocated, size_t needed ) {
+    rc_t rc = 0;
+    if ( needed > *allocated ) {
+        size_t new_allocated = ( *allocated == 0 ) ? 4096 : *allocated;
+        void * tmp;
+        while ( new_allocated < needed ) { new_allocated *= 2; }
+        tmp = realloc( *buf, new_allocated );
+        if ( tmp == NULL ) {
+            rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+            (void)LOGERR( klogErr, rc, "cannot allocate BAM-writer buffer" );
+        } else {
+            *buf = tmp;
+            *allocated = new_allocated;
+        }
+    }
+    return rc;
+}
+
+static rc_t append( void ** buf, size_t * len, size_t * allocated, const void * src, size_t src_len ) {
+    rc_t rc = reserve( buf, allocated, *len + src_len );
+    if ( rc == 0 && src_len > 0 ) {
+        memcpy( ( char * )*buf + *len, src, src_len );
+        *len += src_len;
+    }
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+static rc_t rec_put( bam_writer * self, const void * src, size_t len ) {
+    return append( ( void ** )&( self -> rec ), &( self -> rec_len ), &( self -> rec_allocated ), src, len );
+}
+
+static rc_t rec_put_u8( bam_writer * self, uint32_t v ) {
+    uint8_t b = v & 0xff;
+    return rec_put( self, &b, 1 );
+}
+
+static rc_t rec_put_u16( bam_writer * self, uint32_t v ) {
+    uint8_t b[ 2 ];
+    b[ 0 ] = v & 0xff; b[ 1 ] = ( v >> 8 ) & 0xff;
+    return rec_put( self, b, sizeof b );
+}
+
+static rc_t rec_put_u32( bam_writer * self, uint32_t v ) {
+    uint8_t b[ 4 ];
+    b[ 0 ] = v & 0xff; b[ 1 ] = ( v >> 8 ) & 0xff; b[ 2 ] = ( v >> 16 ) & 0xff; b[ 3 ] = ( v >> 24 ) & 0xff;
+    return rec_put( self, b, sizeof b );
+}
+
+static void set_u32( uint8_t * dst, uint32_t v ) {
+    dst[ 0 ] = v & 0xff; dst[ 1 ] = ( v >> 8 ) & 0xff; dst[ 2 ] = ( v >> 16 ) & 0xff; dst[ 3 ] = ( v >> 24 ) & 0xff;
+}
+
+static bool parse_int( const char * s, size_t len, int64_t * value ) {
+    size_t i = 0;
+    bool neg = false;
+    int64_t v = 0;
+    if ( len > 0 && ( s[ 0 ] == '-' || s[ 0 ] == '+' ) ) {
+        neg = ( s[ 0 ] == '-' );
+        i++;
+    }
+    if ( i == len ) {
+        return false;
+    }
+    for ( ; i < len; ++i ) {
+        if ( s[ i ] < '0' || s[ i ] > '9' ) {
+            return false;
+        }
+        v = v * 10 + ( s[ i ] - '0' );
+    }
+    *value = neg ? -v : v;
+    return true;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+static int64_t CC cmp_ref_names( const void * a, const void * b, void * data ) {
+    const bam_writer * self = data;
+    return strcmp( self -> ref_names[ *( const uint32_t * )a ], self -> ref_names[ *( const uint32_t * )b ] );
+}
+
+static int cmp_name( const char * name, const char * key, size_t key_len ) {
+    int res = strncmp( name, key, key_len );
+    if ( res == 0 && name[ key_len ] != 0 ) {
+        res = 1;
+    }
+    return res;
+}
+
+static rc_t finish_header( bam_writer * self );
+
+rc_t bam_writer_ref_id( bam_writer * self, const char * name, size_t len, int32_t * id ) {
+    rc_t rc = 0;
+    if ( !self -> hdr_done ) {
+        /* the dictionary is made from the complete header-text */
+        rc = finish_header( self );
+        if ( rc != 0 ) {
+            return rc;
+        }
+    }
+    if ( self -> last_ref_id >= 0 &&
+         cmp_name( self -> ref_names[ self -> last_ref_id ], name, len ) == 0 ) {
+        *id = self -> last_ref_id;
+    } else {
+        uint32_t lo = 0, hi = self -> n_refs;
+        *id = -1;
+        while ( lo < hi ) {
+            uint32_t mid = ( lo + hi ) / 2;
+            int cmp = cmp_name( self -> ref_names[ self -> ref_sorted[ mid ] ], name, len );
+            if ( cmp == 0 ) {
+                *id = self -> ref_sorted[ mid ];
+                break;
+            } else if ( cmp < 0 ) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if ( *id < 0 ) {
+            rc = RC( rcExe, rcNoTarg, rcSearching, rcName, rcNotFound );
+            (void)PLOGERR( klogErr, ( klogErr, rc, "reference '$(r)' is not in the header",
+                                      "r=%.*s", ( int )len, name ) );
+        } else {
+            self -> last_ref_id = *id;
+        }
+    }
+    return rc;
+}
+
+static rc_t add_ref( bam_writer * self, const char * name, size_t name_len, uint32_t len ) {
+    rc_t rc = 0;
+    if ( self -> n_refs >= self -> refs_allocated ) {
+        uint32_t new_allocated = ( self -> refs_allocated == 0 ) ? 64 : self -> refs_allocated * 2;
+        char ** names = realloc( self -> ref_names, new_allocated * sizeof * names );
+        uint32_t * lens = NULL;
+        if ( names != NULL ) {
+            self -> ref_names = names;
+            lens = realloc( self -> ref_lens, new_allocated * sizeof * lens );
+            if ( lens != NULL ) {
+                self -> ref_lens = lens;
+                self -> refs_allocated = new_allocated;
+            }
+        }
+        if ( lens == NULL ) {
+            rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        }
+    }
+    if ( rc == 0 ) {
+        char * s = malloc( name_len + 1 );
+        if ( s == NULL ) {
+            rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        } else {
+            memcpy( s, name, name_len );
+            s[ name_len ] = 0;
+            self -> ref_names[ self -> n_refs ] = s;
+            self -> ref_lens[ self -> n_refs ] = len;
+            self -> n_refs++;
+        }
+    }
+    return rc;
+}
+
+/* one @SQ-line of the header-text: SN and LN, the other fields are only copied into the text */
+static rc_t parse_sq_line( bam_writer * self, const char * line, size_t len ) {
+    rc_t rc = 0;
+    const char * name = NULL;
+    size_t name_len = 0;
+    int64_t ref_len = -1;
+    const char * p = line;
+    const char * end = line + len;
+    while ( p < end ) {
+        const char * tab = memchr( p, '\t', end - p );
+        size_t field_len = ( tab != NULL ) ? ( size_t )( tab - p ) : ( size_t )( end - p );
+        if ( field_len > 3 && p[ 0 ] == 'S' && p[ 1 ] == 'N' && p[ 2 ] == ':' ) {
+            name = p + 3;
+            name_len = field_len - 3;
+        } else if ( field_len > 3 && p[ 0 ] == 'L' && p[ 1 ] == 'N' && p[ 2 ] == ':' ) {
+            if ( !parse_int( p + 3, field_len - 3, &ref_len ) ) {
+                ref_len = -1;
+            }
+        }
+        p += field_len + 1;
+    }
+    if ( name == NULL || ref_len < 0 || ref_len > 0xffffffff ) {
+        rc = RC( rcExe, rcNoTarg, rcParsing, rcFormat, rcInvalid );
+        (void)PLOGERR( klogErr, ( klogErr, rc, "invalid @SQ-line in header: '$(l)'",
+                                  "l=%.*s", ( int )len, line ) );
+    } else {
+        rc = add_ref( self, name, name_len, ( uint32_t )ref_len );
+    }
+    return rc;
+}
+
+static rc_t make_dictionary( bam_writer * self ) {
+    rc_t rc = 0;
+    const char * p = self -> hdr;
+    const char * end = self -> hdr + self -> hdr_len;
+    while ( rc == 0 && p < end ) {
+        const char * nl = memchr( p, '\n', end - p );
+        size_t len = ( nl != NULL ) ? ( size_t )( nl - p ) : ( size_t )( end - p );
+        if ( len > 4 && memcmp( p, "@SQ\t", 4 ) == 0 ) {
+            rc = parse_sq_line( self, p + 4, len - 4 );
+        }
+        p += len + 1;
+    }
+    if ( rc == 0 && self -> n_refs > 0 ) {
+        self -> ref_sorted = malloc( self -> n_refs * sizeof self -> ref_sorted[ 0 ] );
+        if ( self -> ref_sorted == NULL ) {
+            rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        } else {
+            uint32_t idx;
+            for ( idx = 0; idx < self -> n_refs; ++idx ) {
+                self -> ref_sorted[ idx ] = idx;
+            }
+            ksort( self -> ref_sorted, self -> n_refs, sizeof self -> ref_sorted[ 0 ], cmp_ref_names, self );
+        }
+    }
+    return rc;
+}
+
+/* the header-text is complete: make the dictionary, write the BAM-header */
+static rc_t finish_header( bam_writer * self ) {
+    rc_t rc = make_dictionary( self );
+    self -> hdr_done = true;
+    self -> rec_len = 0;
+    if ( rc == 0 ) { rc = rec_put( self, "BAM\1", 4 ); }
+    if ( rc == 0 ) { rc = rec_put_u32( self, ( uint32_t )self -> hdr_len ); }
+    if ( rc == 0 ) { rc = rec_put( self, self -> hdr, self -> hdr_len ); }
+    if ( rc == 0 ) { rc = rec_put_u32( self, self -> n_refs ); }
+    if ( rc == 0 ) {
+        uint32_t idx;
+        for ( idx = 0; rc == 0 && idx < self -> n_refs; ++idx ) {
+            size_t len = strlen( self -> ref_names[ idx ] ) + 1;
+            rc = rec_put_u32( self, ( uint32_t )len );
+            if ( rc == 0 ) { rc = rec_put( self, self -> ref_names[ idx ], len ); }
+            if ( rc == 0 ) { rc = rec_put_u32( self, self -> ref_lens[ idx ] ); }
+        }
+    }
+    if ( rc == 0 ) {
+        rc = bgzf_write( self -> bgzf, self -> rec, self -> rec_len );
+    }
+    if ( rc == 0 ) {
+        /* the records start in a block of their own, as samtools does it */
+        rc = bgzf_flush( self -> bgzf );
+    }
+    if ( rc == 0 && self -> index_filename != NULL ) {
+        uint64_t max_len = 0;
+        uint32_t idx;
+        for ( idx = 0; idx < self -> n_refs; ++idx ) {
+            if ( self -> ref_lens[ idx ] > max_len ) { max_len = self -> ref_lens[ idx ]; }
+        }
+        rc = make_bam_index( &( self -> index ), self -> n_refs, max_len, self -> csi ); /* bam_index.c */
+    }
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+static const char cigar_ops[] = "MIDNSHP=X";
+
+/* the SAM-text cigar into BAM-cigar-ops, sum up the length on the reference */
+static rc_t put_cigar( bam_writer * self, const char * cigar, uint32_t len,
+                       uint32_t * n_ops, int64_t * ref_len ) {
+    rc_t rc = 0;
+    uint32_t i = 0;
+    *n_ops = 0;
+    *ref_len = 0;
+    while ( rc == 0 && i < len ) {
+        uint32_t n = 0;
+        const char * op;
+        uint32_t start = i;
+        while ( i < len && cigar[ i ] >= '0' && cigar[ i ] <= '9' ) {
+            n = n * 10 + ( cigar[ i++ ] - '0' );
+        }
+        op = ( i < len && cigar[ i ] != 0 ) ? strchr( cigar_ops, cigar[ i ] ) : NULL;
+        if ( i == start || op == NULL || n >= ( 1u << 28 ) ) {
+            rc = RC( rcExe, rcNoTarg, rcParsing, rcFormat, rcInvalid );
+            (void)PLOGERR( klogErr, ( klogErr, rc, "invalid cigar-string '$(c)'",
+                                      "c=%.*s", ( int )len, cigar ) );
+        } else {
+            uint32_t code = ( uint32_t )( op - cigar_ops );
+            rc = rec_put_u32( self, ( n << 4 ) | code );
+            /* M, D, N, = and X consume the reference */
+            if ( code == 0 || code == 2 || code == 3 || code == 7 || code == 8 ) {
+                *ref_len += n;
+            }
+            ( *n_ops )++;
+            i++;
+        }
+    }
+    if ( rc == 0 && *n_ops > 0xffff ) {
+        rc = RC( rcExe, rcNoTarg, rcWriting, rcData, rcExcessive );
+        (void)LOGERR( klogErr, rc, "cigar-string has too many operations for BAM" );
+    }
+    return rc;
+}
+
+static rc_t put_seq( bam_writer * self, const char * seq, uint32_t len ) {
+    rc_t rc = reserve( ( void ** )&( self -> rec ), &( self -> rec_allocated ), self -> rec_len + ( len + 1 ) / 2 );
+    if ( rc == 0 ) {
+        uint8_t * dst = &( self -> rec[ self -> rec_len ] );
+        uint32_t i;
+        for ( i = 0; i + 1 < len; i += 2 ) {
+            *dst++ = ( self -> seq_code[ ( uint8_t )seq[ i ] ] << 4 ) | self -> seq_code[ ( uint8_t )seq[ i + 1 ] ];
+        }
+        if ( i < len ) {
+            *dst = self -> seq_code[ ( uint8_t )seq[ i ] ] << 4;
+        }
+        self -> rec_len += ( len + 1 ) / 2;
+    }
+    return rc;
+}
+
+static rc_t put_qual( bam_writer * self, const char * qual, uint32_t len, const uint8_t * map ) {
+    rc_t rc = reserve( ( void ** )&( self -> rec ), &( self -> rec_allocated ), self -> rec_len + len );
+    if ( rc == 0 ) {
+        uint8_t * dst = &( self -> rec[ self -> rec_len ] );
+        uint32_t i;
+        if ( qual == NULL ) {
+            memset( dst, 0xff, len );
+        } else {
+            for ( i = 0; i < len; ++i ) {
+                dst[ i ] = map[ ( uint8_t )qual[ i ] ];
+            }
+        }
+        self -> rec_len += len;
+    }
+    return rc;
+}
+
+static rc_t begin_record( bam_writer * self, const bam_record * r, const uint8_t * qual_map ) {
+    rc_t rc = 0;
+    uint32_t n_ops = 0;
+    int64_t ref_len = 0;
+    if ( !self -> hdr_done ) {
+        rc = finish_header( self );
+    }
+    if ( rc == 0 && r -> qname_len > 254 ) {
+        rc = RC( rcExe, rcNoTarg, rcWriting, rcName, rcExcessive );
+        (void)LOGERR( klogErr, rc, "QNAME too long for BAM" );
+    }
+    if ( rc == 0 ) {
+        /* the fixed part first, n_cigar_op and bin are set when the cigar is known */
+        self -> rec_len = 0;
+        rc = reserve( ( void ** )&( self -> rec ), &( self -> rec_allocated ), 36 );
+        if ( rc == 0 ) {
+            memset( self -> rec, 0, 36 );
+            self -> rec_len = 36;
+            set_u32( self -> rec + 4, ( uint32_t )r -> ref_id );
+            set_u32( self -> rec + 8, ( uint32_t )r -> pos );
+            self -> rec[ 12 ] = ( uint8_t )( r -> qname_len + 1 );
+            self -> rec[ 13 ] = ( uint8_t )( r -> mapq > 255 ? 255 : r -> mapq );
+            self -> rec[ 18 ] = r -> flag & 0xff;
+            self -> rec[ 19 ] = ( r -> flag >> 8 ) & 0xff;
+            set_u32( self -> rec + 20, r -> seq_len );
+            set_u32( self -> rec + 24, ( uint32_t )r -> next_ref_id );
+            set_u32( self -> rec + 28, ( uint32_t )r -> next_pos );
+            set_u32( self -> rec + 32, ( uint32_t )r -> tlen );
+            rc = rec_put( self, r -> qname, r -> qname_len );
+        }
+    }
+    if ( rc == 0 ) { rc = rec_put_u8( self, 0 ); }
+    if ( rc == 0 ) { rc = put_cigar( self, r -> cigar, r -> cigar_len, &n_ops, &ref_len ); }
+    if ( rc == 0 ) { rc = put_seq( self, r -> seq, r -> seq_len ); }
+    if ( rc == 0 ) { rc = put_qual( self, r -> qual, r -> seq_len, qual_map ); }
+    if ( rc == 0 ) {
+        uint16_t bin;
+        self -> rec_ref_id = r -> ref_id;
+        self -> rec_beg = r -> pos;
+        self -> rec_end = r -> pos + ( ref_len > 0 ? ref_len : 1 );
+        self -> rec_mapped = ( ( r -> flag & 0x4 ) == 0 );
+        bin = bam_reg2bin( self -> rec_beg, self -> rec_end ); /* bam_index.c */
+        self -> rec[ 14 ] = bin & 0xff;
+        self -> rec[ 15 ] = ( bin >> 8 ) & 0xff;
+        self -> rec[ 16 ] = n_ops & 0xff;
+        self -> rec[ 17 ] = ( n_ops >> 8 ) & 0xff;
+    }
+    return rc;
+}
+
+rc_t bam_writer_begin( bam_writer * self, const bam_record * rec ) {
+    return begin_record( self, rec, self -> qual_direct );
+}
+
+rc_t bam_writer_tag_A( bam_writer * self, const char * tag, char value ) {
+    rc_t rc = rec_put( self, tag, 2 );
+    if ( rc == 0 ) { rc = rec_put_u8( self, 'A' ); }
+    if ( rc == 0 ) { rc = rec_put_u8( self, ( uint8_t )value ); }
+    return rc;
+}
+
+/* the smallest integer-type that holds the value, as samtools does it */
+rc_t bam_writer_tag_i( bam_writer * self, const char * tag, int64_t value ) {
+    rc_t rc = rec_put( self, tag, 2 );
+    if ( rc == 0 ) {
+        if ( value < 0 ) {
+            if ( value >= -128 ) {
+                rc = rec_put_u8( self, 'c' );
+                if ( rc == 0 ) { rc = rec_put_u8( self, ( uint32_t )value ); }
+            } else if ( value >= -32768 ) {
+                rc = rec_put_u8( self, 's' );
+                if ( rc == 0 ) { rc = rec_put_u16( self, ( uint32_t )value ); }
+            } else {
+                rc = rec_put_u8( self, 'i' );
+                if ( rc == 0 ) { rc = rec_put_u32( self, ( uint32_t )value ); }
+            }
+        } else {
+            if ( value <= 0xff ) {
+                rc = rec_put_u8( self, 'C' );
+                if ( rc == 0 ) { rc = rec_put_u8( self, ( uint32_t )value ); }
+            } else if ( value <= 0xffff ) {
+                rc = rec_put_u8( self, 'S' );
+                if ( rc == 0 ) { rc = rec_put_u16( self, ( uint32_t )value ); }
+            } else {
+                rc = rec_put_u8( self, 'I' );
+                if ( rc == 0 ) { rc = rec_put_u32( self, ( uint32_t )value ); }
+            }
+        }
+    }
+    return rc;
+}
+
+rc_t bam_writer_tag_Z( bam_writer * self, const char * tag, const char * value, size_t len ) {
+    rc_t rc = rec_put( self, tag, 2 );
+    if ( rc == 0 ) { rc = rec_put_u8( self, 'Z' ); }
+    if ( rc == 0 ) { rc = rec_put( self, value, len ); }
+    if ( rc == 0 ) { rc = rec_put_u8( self, 0 ); }
+    return rc;
+}
+
+static rc_t put_float( bam_writer * self, const char * s, size_t len ) {
+    char buf[ 64 ];
+    union { float f; uint32_t u; } v;
+    if ( len >= sizeof buf ) { len = sizeof buf - 1; }
+    memcpy( buf, s, len );
+    buf[ len ] = 0;
+    v . f = ( float )strtod( buf, NULL );
+    return rec_put_u32( self, v . u );
+}
+
+/* B:t,v1,v2,... */
+static rc_t put_array( bam_writer * self, const char * s, size_t len ) {
+    rc_t rc = 0;
+    size_t count_at;
+    uint32_t count = 0;
+    char sub = ( len > 0 ) ? s[ 0 ] : 0;
+    if ( strchr( "cCsSiIf", sub ) == NULL || sub == 0 ) {
+        return RC( rcExe, rcNoTarg, rcParsing, rcFormat, rcInvalid );
+    }
+    rc = rec_put_u8( self, ( uint8_t )sub );
+    count_at = self -> rec_len;
+    if ( rc == 0 ) { rc = rec_put_u32( self, 0 ); }
+    s++; len--;
+    while ( rc == 0 && len > 0 ) {
+        const char * comma;
+        size_t vlen;
+        s++; len--;     /* the comma */
+        comma = memchr( s, ',', len );
+        vlen = ( comma != NULL ) ? ( size_t )( comma - s ) : len;
+        if ( sub == 'f' ) {
+            rc = put_float( self, s, vlen );
+        } else {
+            int64_t v;
+            if ( !parse_int( s, vlen, &v ) ) {
+                rc = RC( rcExe, rcNoTarg, rcParsing, rcFormat, rcInvalid );
+            } else if ( sub == 'c' || sub == 'C' ) {
+                rc = rec_put_u8( self, ( uint32_t )v );
+            } else if ( sub == 's' || sub == 'S' ) {
+                rc = rec_put_u16( self, ( uint32_t )v );
+            } else {
+                rc = rec_put_u32( self, ( uint32_t )v );
+            }
+        }
+        count++;
+        s += vlen;
+        len -= vlen;
+    }
+    if ( rc == 0 ) {
+        set_u32( self -> rec + count_at, count );
+    }
+    return rc;
+}
+
+static rc_t put_text_tag( bam_writer * self, const char * s, size_t len ) {
+    rc_t rc = 0;
+    if ( len < 5 || s[ 2 ] != ':' || s[ 4 ] != ':' ) {
+        rc = RC( rcExe, rcNoTarg, rcParsing, rcFormat, rcInvalid );
+    } else {
+        const char * value = s + 5;
+        size_t value_len = len - 5;
+        switch ( s[ 3 ] ) {
+            case 'A' : rc = ( value_len == 1 ) ? bam_writer_tag_A( self, s, value[ 0 ] )
+                                               : RC( rcExe, rcNoTarg, rcParsing, rcFormat, rcInvalid );
+                       break;
+
+            case 'i' : {
+                            int64_t v;
+                            rc = parse_int( value, value_len, &v ) ? bam_writer_tag_i( self, s, v )
+                                                                  : RC( rcExe, rcNoTarg, rcParsing, rcFormat, rcInvalid );
+                       } break;
+
+            case 'f' : rc = rec_put( self, s, 2 );
+                       if ( rc == 0 ) { rc = rec_put_u8( self, 'f' ); }
+                       if ( rc == 0 ) { rc = put_float( self, value, value_len ); }
+                       break;
+
+            case 'Z' : rc = bam_writer_tag_Z( self, s, value, value_len ); break;
+
+            case 'H' : rc = rec_put( self, s, 2 );
+                       if ( rc == 0 ) { rc = rec_put_u8( self, 'H' ); }
+                       if ( rc == 0 ) { rc = rec_put( self, value, value_len ); }
+                       if ( rc == 0 ) { rc = rec_put_u8( self, 0 ); }
+                       break;
+
+            case 'B' : rc = rec_put( self, s, 2 );
+                       if ( rc == 0 ) { rc = rec_put_u8( self, 'B' ); }
+                       if ( rc == 0 ) { rc = put_array( self, value, value_len ); }
+                       break;
+
+            default  : rc = RC( rcExe, rcNoTarg, rcParsing, rcFormat, rcInvalid ); break;
+        }
+    }
+    if ( rc != 0 ) {
+        (void)PLOGERR( klogErr, ( klogErr, rc, "invalid optional field '$(t)'",
+                                  "t=%.*s", ( int )len, s ) );
+    }
+    return rc;
+}
+
+rc_t bam_writer_tags( bam_writer * self, const char * text, size_t len ) {
+    rc_t rc = 0;
+    const char * p = text;
+    const char * end = text + len;
+    while ( rc == 0 && p < end ) {
+        const char * tab = memchr( p, '\t', end - p );
+        size_t tag_len = ( tab != NULL ) ? ( size_t )( tab - p ) : ( size_t )( end - p );
+        if ( tag_len > 0 ) {
+            rc = put_text_tag( self, p, tag_len );
+        }
+        p += tag_len + 1;
+    }
+    return rc;
+}
+
+rc_t bam_writer_end( bam_writer * self ) {
+    rc_t rc;
+    uint64_t voffset_beg = bgzf_tell( self -> bgzf );
+    set_u32( self -> rec, ( uint32_t )( self -> rec_len - 4 ) );
+    rc = bgzf_write( self -> bgzf, self -> rec, self -> rec_len ); /* bgzf.c */
+    if ( rc == 0 && self -> index != NULL ) {
+        rc_t rc2 = bam_index_add( self -> index, self -> rec_ref_id, self -> rec_beg, self -> rec_end,
+                                  self -> rec_mapped, voffset_beg, bgzf_tell( self -> bgzf ) );
+        if ( rc2 != 0 ) {
+            /* not an error for the BAM-file itself */
+            if ( GetRCState( rc2 ) == rcOutoforder ) {
+                (void)LOGMSG( klogWarn, "the records are not sorted by coordinate, no index written" );
+            } else if ( GetRCState( rc2 ) == rcExcessive ) {
+                (void)LOGMSG( klogWarn, "a reference is too long for a BAI-index ( use csi ), no index written" );
+            } else {
+                (void)LOGERR( klogWarn, rc2, "no index written" );
+            }
+            release_bam_index( self -> index );
+            self -> index = NULL;
+        }
+    }
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+typedef struct sam_field {
+    const char * s;
+    uint32_t len;
+} sam_field;
+
+static bool is_star( const sam_field * f ) {
+    return ( f -> len == 1 && f -> s[ 0 ] == '*' );
+}
+
+static rc_t text_ref_id( bam_writer * self, const sam_field * f, int32_t same, int32_t * id ) {
+    rc_t rc = 0;
+    if ( is_star( f ) || f -> len == 0 ) {
+        *id = -1;
+    } else if ( f -> len == 1 && f -> s[ 0 ] == '=' ) {
+        *id = same;
+    } else {
+        rc = bam_writer_ref_id( self, f -> s, f -> len, id );
+    }
+    return rc;
+}
+
+/* a SAM-line printed by one of the text-printers */
+static rc_t convert_sam_line( bam_writer * self, const char * line, size_t len ) {
+    rc_t rc = 0;
+    sam_field f[ BAM_FIELDS ];
+    const char * p = line;
+    const char * end = line + len;
+    uint32_t n = 0;
+    int64_t v[ BAM_FIELDS ];
+    bam_record r;
+
+    while ( n < BAM_FIELDS && p <= end ) {
+        const char * tab = memchr( p, '\t', end - p );
+        f[ n ] . s = p;
+        f[ n ] . len = ( uint32_t )( ( tab != NULL ) ? tab - p : end - p );
+        p += f[ n ] . len + 1;
+        n++;
+        if ( tab == NULL ) { break; }
+    }
+    if ( n < BAM_FIELDS ||
+         !parse_int( f[ 1 ] . s, f[ 1 ] . len, &v[ 1 ] ) ||
+         !parse_int( f[ 3 ] . s, f[ 3 ] . len, &v[ 3 ] ) ||
+         !parse_int( f[ 4 ] . s, f[ 4 ] . len, &v[ 4 ] ) ||
+         !parse_int( f[ 7 ] . s, f[ 7 ] . len, &v[ 7 ] ) ||
+         !parse_int( f[ 8 ] . s, f[ 8 ] . len, &v[ 8 ] ) ) {
+        rc = RC( rcExe, rcNoTarg, rcParsing, rcFormat, rcInvalid );
+        (void)PLOGERR( klogErr, ( klogErr, rc, "cannot convert SAM-line into BAM: '$(l)'",
+                                  "l=%.*s", ( int )( len > 256 ? 256 : len ), line ) );
+        return rc;
+    }
+    memset( &r, 0, sizeof r );
+    if ( !self -> hdr_done ) {
+        /* the dictionary is needed for the reference-names */
+        rc = finish_header( self );
+    }
+    if ( rc == 0 ) {
+        rc = text_ref_id( self, &f[ 2 ], -1, &r . ref_id );
+    }
+    if ( rc == 0 ) {
+        rc = text_ref_id( self, &f[ 6 ], r . ref_id, &r . next_ref_id );
+    }
+    if ( rc == 0 ) {
+        r . qname = f[ 0 ] . s;
+        r . qname_len = f[ 0 ] . len;
+        r . flag = ( uint32_t )v[ 1 ];
+        r . pos = ( int32_t )( v[ 3 ] - 1 );
+        r . mapq = ( uint32_t )v[ 4 ];
+        if ( !is_star( &f[ 5 ] ) ) {
+            r . cigar = f[ 5 ] . s;
+            r . cigar_len = f[ 5 ] . len;
+        }
+        r . next_pos = ( int32_t )( v[ 7 ] - 1 );
+        r . tlen = ( int32_t )v[ 8 ];
+        if ( !is_star( &f[ 9 ] ) ) {
+            r . seq = f[ 9 ] . s;
+            r . seq_len = f[ 9 ] . len;
+        }
+        if ( !is_star( &f[ 10 ] ) && f[ 10 ] . len == r . seq_len ) {
+            r . qual = f[ 10 ] . s;
+        }
+        rc = begin_record( self, &r, self -> qual_text );
+    }
+    if ( rc == 0 && p < end ) {
+        rc = bam_writer_tags( self, p, end - p );
+    }
+    if ( rc == 0 ) {
+        rc = bam_writer_end( self );
+    }
+    return rc;
+}
+
+static rc_t process_line( bam_writer * self, const char * line, size_t len ) {
+    rc_t rc = 0;
+    if ( len > 0 ) {
+        if ( line[ 0 ] == '@' ) {
+            if ( self -> hdr_done ) {
+                rc = RC( rcExe, rcNoTarg, rcWriting, rcFormat, rcUnexpected );
+                (void)LOGERR( klogErr, rc, "header-line after the first record" );
+            } else {
+                rc = append( ( void ** )&( self -> hdr ), &( self -> hdr_len ), &( self -> hdr_allocated ), line, len );
+                if ( rc == 0 ) {
+                    rc = append( ( void ** )&( self -> hdr ), &( self -> hdr_len ), &( self -> hdr_allocated ), "\n", 1 );
+                }
+            }
+        } else {
+            rc = convert_sam_line( self, line, len );
+        }
+    }
+    return rc;
+}
+
+/* the KOut-handler: cut the text into lines */
+static rc_t CC bam_writer_kout( void * data, const char * buffer, size_t bufsize, size_t * num_writ ) {
+    bam_writer * self = data;
+    rc_t rc = 0;
+    const char * p = buffer;
+    const char * end = buffer + bufsize;
+    while ( rc == 0 && p < end ) {
+        const char * nl = memchr( p, '\n', end - p );
+        if ( nl == NULL ) {
+            rc = append( ( void ** )&( self -> line ), &( self -> line_len ), &( self -> line_allocated ), p, end - p );
+            p = end;
+        } else {
+            if ( self -> line_len == 0 ) {
+                rc = process_line( self, p, nl - p );
+            } else {
+                rc = append( ( void ** )&( self -> line ), &( self -> line_len ), &( self -> line_allocated ), p, nl - p );
+                if ( rc == 0 ) {
+                    rc = process_line( self, self -> line, self -> line_len );
+                }
+                self -> line_len = 0;
+            }
+            p = nl + 1;
+        }
+    }
+    *num_writ = ( rc == 0 ) ? bufsize : 0;
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+static rc_t create_file( const char * filename, KFile ** f ) {
+    rc_t rc;
+    if ( filename != NULL ) {
+        KDirectory * dir;
+        rc = KDirectoryNativeDir( &dir );
+        if ( rc != 0 ) {
+            (void)LOGERR( klogInt, rc, "KDirectoryNativeDir() failed" );
+        } else {
+            rc = KDirectoryCreateFile( dir, f, false, 0664, kcmInit, "%s", filename );
+            if ( rc != 0 ) {
+                (void)PLOGERR( klogErr, ( klogErr, rc, "cannot create '$(f)'", "f=%s", filename ) );
+            }
+            KDirectoryRelease( dir );
+        }
+    } else {
+        rc = KFileMakeStdOut( f );
+    }
+    return rc;
+}
+
+typedef struct file_out {
+    KFile * f;
+    uint64_t pos;
+} file_out;
+
+static rc_t CC write_to_file( void * data, const char * buffer, size_t bufsize, size_t * num_writ ) {
+    file_out * fo = data;
+    rc_t rc = KFileWriteAll( fo -> f, fo -> pos, buffer, bufsize, num_writ );
+    if ( rc == 0 ) {
+        fo -> pos += *num_writ;
+    }
+    return rc;
+}
+
+static rc_t CC write_to_bgzf( void * data, const char * buffer, size_t bufsize, size_t * num_writ ) {
+    rc_t rc = bgzf_write( data, buffer, bufsize ); /* bgzf.c */
+    *num_writ = ( rc == 0 ) ? bufsize : 0;
+    return rc;
+}
+
+static uint64_t translate_offset( const void * data, uint64_t voffset ) {
+    return bgzf_real_offset( data, voffset ); /* bgzf.c */
+}
+
+/* BAI is plain, CSI is BGZF-compressed */
+static rc_t write_index( bam_writer * self ) {
+    struct dyn_string * ds;
+    rc_t rc = ds_allocate( &ds, 64 * 1024 ); /* dyn_string.c */
+    if ( rc == 0 ) {
+        rc = bam_index_write( self -> index, translate_offset, self -> bgzf, ds ); /* bam_index.c */
+        if ( rc == 0 ) {
+            KFile * f;
+            rc = create_file( self -> index_filename, &f );
+            if ( rc == 0 ) {
+                if ( self -> csi ) {
+                    struct bgzf_writer * w;
+                    rc = make_bgzf_writer( &w, f, 0, -1, false ); /* bgzf.c */
+                    if ( rc == 0 ) {
+                        rc = ds_write( ds, write_to_bgzf, w );
+                        if ( rc == 0 ) {
+                            rc = bgzf_finish( w );
+                        }
+                        release_bgzf_writer( w );
+                    }
+                } else {
+                    file_out fo;
+                    fo . f = f;
+                    fo . pos = 0;
+                    rc = ds_write( ds, write_to_file, &fo );
+                }
+                if ( rc != 0 ) {
+                    (void)PLOGERR( klogErr, ( klogErr, rc, "cannot write index '$(f)'", "f=%s", self -> index_filename ) );
+                }
+                KFileRelease( f );
+            }
+        }
+        ds_free( ds );
+    }
+    return rc;
+}
+
+rc_t bam_writer_finish( bam_writer * self ) {
+    rc_t rc = 0;
+    if ( self -> line_len > 0 ) {
+        rc = process_line( self, self -> line, self -> line_len );
+        self -> line_len = 0;
+    }
+    if ( rc == 0 && !self -> hdr_done ) {
+        rc = finish_header( self );
+    }
+    if ( rc == 0 ) {
+        rc = bgzf_finish( self -> bgzf ); /* bgzf.c */
+    }
+    if ( rc == 0 && self -> index != NULL ) {
+        rc = write_index( self );
+    }
+    return rc;
+}
+
+void release_bam_writer( bam_writer * self ) {
+    if ( self != NULL ) {
+        uint32_t idx;
+        if ( self -> org_writer != NULL ) {
+            KOutHandlerSet( self -> org_writer, self -> org_data );
+        }
+        release_bgzf_writer( self -> bgzf );
+        release_bam_index( self -> index );
+        KFileRelease( self -> f );
+        for ( idx = 0; idx < self -> n_refs; ++idx ) {
+            free( self -> ref_names[ idx ] );
+        }
+        free( self -> ref_names );
+        free( self -> ref_lens );
+        free( self -> ref_sorted );
+        free( self -> index_filename );
+        free( self -> hdr );
+        free( self -> line );
+        free( self -> rec );
+        free( self );
+    }
+}
+
+static void init_tables( bam_writer * self, const uint8_t * qual_quant_matrix ) {
+    static const char bases[] = "=ACMGRSVTWYHKDBN";
+    uint32_t c;
+    for ( c = 0; c < 256; ++c ) {
+        uint8_t q = ( c >= 33 ) ? ( uint8_t )( c - 33 ) : 0;
+        self -> qual_text[ c ] = q;
+        self -> qual_direct[ c ] = ( qual_quant_matrix != NULL ) ? qual_quant_matrix[ q ] : q;
+        self -> seq_code[ c ] = 15;     /* N */
+    }
+    for ( c = 0; c < 16; ++c ) {
+        self -> seq_code[ ( uint8_t )bases[ c ] ] = ( uint8_t )c;
+        self -> seq_code[ ( uint8_t )( bases[ c ] | 0x20 ) ] = ( uint8_t )c;
+    }
+}
+
+rc_t make_bam_writer( bam_writer ** w, const char * filename, const char * index_filename,
+                      bool csi, uint32_t num_threads, const uint8_t * qual_quant_matrix ) {
+    rc_t rc = 0;
+    bam_writer * self = calloc( 1, sizeof * self );
+    *w = NULL;
+    if ( self == NULL ) {
+        rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        (void)LOGERR( klogErr, rc, "cannot make BAM-writer" );
+    } else {
+        init_tables( self, qual_quant_matrix );
+        self -> last_ref_id = -1;
+        self -> csi = csi;
+        if ( index_filename != NULL ) {
+            self -> index_filename = malloc( strlen( index_filename ) + 1 );
+            if ( self -> index_filename == NULL ) {
+                rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            } else {
+                strcpy( self -> index_filename, index_filename );
+            }
+        }
+        if ( rc == 0 ) {
+            rc = create_file( filename, &( self -> f ) );
+        }
+        if ( rc == 0 ) {
+            rc = make_bgzf_writer( &( self -> bgzf ), self -> f, num_threads, -1, ( index_filename != NULL ) ); /* bgzf.c */
+        }
+        if ( rc == 0 ) {
+            self -> org_writer = KOutWriterGet();
+            self -> org_data = KOutDataGet();
+            rc = KOutHandlerSet( bam_writer_kout, self );
+            if ( rc != 0 ) {
+                (void)LOGERR( klogInt, rc, "KOutHandlerSet() failed" );
+                self -> org_writer = NULL;
+            }
+        }
+        if ( rc != 0 ) {
+            release_bam_writer( self );
+        } else {
+            *w = self;
+        }
+    }
+    return rc;
+}
@@ -0,0 +1,105 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#ifndef _h_bam_writer_
+#define _h_bam_writer_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+/* -----------------------------------------------------------------------------------
+    Writes sam-dump's output as BAM: BGZF-compressed ( bgzf.c ), optionally indexed
+    ( bam_index.c ). While it exists it is the KOut-handler:
+
+    - the header-lines printed by sam-hdr.c are collected, their @SQ-lines become
+      the reference-dictionary of the BAM-header,
+    - every other line printed via KOutMsg() is a SAM-record, it is converted into
+      a BAM-record ( for the printers that have no BAM-path of their own ),
+    - the aligned-printer skips the text and builds its records with
+      bam_writer_begin() / bam_writer_tag_*() / bam_writer_end().
+
+    The index can only be made if the records come in coordinate-sorted, which they
+    do if the references are walked in the order of the header. If they do not, the
+    index is dropped with a warning.
+   ----------------------------------------------------------------------------------- */
+
+struct bam_writer;
+
+typedef struct bam_record {
+    const char * qname;
+    uint32_t qname_len;
+    uint32_t flag;
+    int32_t ref_id;             /* -1 ... '*' */
+    int32_t pos;                /* 0-based, -1 ... none */
+    uint32_t mapq;
+    const char * cigar;         /* SAM-text, cigar_len = 0 ... '*' */
+    uint32_t cigar_len;
+    int32_t next_ref_id;        /* -1 ... '*' */
+    int32_t next_pos;           /* 0-based, -1 ... none */
+    int32_t tlen;
+    const char * seq;           /* ASCII, seq_len = 0 ... '*' */
+    uint32_t seq_len;
+    const char * qual;          /* phred + 33, NULL ... '*', has to be seq_len long */
+} bam_record;
+
+/* filename = NULL ... stdout
+   index_filename = NULL ... no index, csi = false ... BAI
+   qual_quant_matrix = NULL ... no quantization of the qualities given to bam_writer_begin() */
+rc_t make_bam_writer( struct bam_writer ** w, const char * filename, const char * index_filename,
+                      bool csi, uint32_t num_threads, const uint8_t * qual_quant_matrix );
+
+/* the id of a reference in the dictionary of the header, rcNotFound if it is not there */
+rc_t bam_writer_ref_id( struct bam_writer * self, const char * name, size_t len, int32_t * id );
+
+/* a record is made with one begin(), optional tags and one end() */
+rc_t bam_writer_begin( struct bam_writer * self, const bam_record * rec );
+
+rc_t bam_writer_tag_A( struct bam_writer * self, const char * tag, char value );
+
+rc_t bam_writer_tag_i( struct bam_writer * self, const char * tag, int64_t value );
+
+rc_t bam_writer_tag_Z( struct bam_writer * self, const char * tag, const char * value, size_t len );
+
+/* tags in SAM-text: "XX:t:value" separated by tabs */
+rc_t bam_writer_tags( struct bam_writer * self, const char * text, size_t len );
+
+rc_t bam_writer_end( struct bam_writer * self );
+
+/* writes the rest, the EOF-marker and the index */
+rc_t bam_writer_finish( struct bam_writer * self );
+
+/* restores the KOut-handler */
+void release_bam_writer( struct bam_writer * self );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,479 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "bgzf.h"
+
+#ifndef _h_klib_log_
+#include <klib/log.h>
+#endif
+
+#ifndef _h_kproc_thread_
+#include <kproc/thread.h>
+#endif
+
+#ifndef _h_kproc_lock_
+#include <kproc/lock.h>
+#endif
+
+#ifndef _h_kproc_cond_
+#include <kproc/cond.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>   /* from ncbi-vdb/interfaces/ext */
+
+#define BGZF_BLOCK_SIZE 0xff00          /* uncompressed bytes per block, as samtools does it */
+#define BGZF_MAX_BLOCK_SIZE 0x10000     /* a compressed block, BSIZE is 16 bit */
+#define BGZF_HDR_SIZE 18
+#define BGZF_FTR_SIZE 8
+#define BGZF_BLOCKS_PER_THREAD 4        /* blocks filled/in work/done but not written yet */
+
+/* gzip-header with the 'BC'-extra-field, BSIZE at offset 16 */
+static const uint8_t bgzf_hdr[ BGZF_HDR_SIZE ] = {
+    0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0 };
+
+/* an empty block, marks the end of a BGZF-stream */
+static const uint8_t bgzf_eof[ 28 ] = {
+    0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+enum bgzf_block_state {
+    bs_free = 0,        /* can be filled by the producer */
+    bs_filled,          /* waiting for a worker */
+    bs_compressing,     /* a worker deflates it */
+    bs_done             /* waiting to be written */
+};
+
+typedef struct bgzf_block {
+    uint8_t data[ BGZF_BLOCK_SIZE ];
+    uint8_t out[ BGZF_MAX_BLOCK_SIZE ];
+    size_t len;
+    size_t out_len;
+    enum bgzf_block_state state;
+    rc_t rc;
+} bgzf_block;
+
+typedef struct bgzf_writer {
+    KFile * f;
+    uint64_t pos;                   /* where the next compressed block goes */
+    int level;
+    z_stream zs;                    /* used if the blocks are deflated by the producer */
+    bool zs_valid;
+
+    bgzf_block * blocks;            /* a ring, block-number % num_blocks */
+    uint32_t num_blocks;
+    uint64_t head;                  /* the number of the block being filled */
+    uint64_t tail;                  /* the number of the oldest block not written yet */
+
+    uint64_t * offsets;             /* file-offset of each written block, if kept */
+    uint64_t offsets_allocated;
+    bool keep_offsets;
+
+    KThread ** threads;
+    uint32_t num_threads;
+    KLock * lock;
+    KCondition * filled;            /* a block is waiting for a worker */
+    KCondition * done;              /* a worker has finished a block, or has quit */
+    uint32_t running;               /* workers that have not quit yet */
+    rc_t worker_rc;                 /* why the first worker quit early */
+    bool quit;
+    bool finished;
+} bgzf_writer;
+
+static void put_u16( uint8_t * dst, uint32_t v ) {
+    dst[ 0 ] = v & 0xff;
+    dst[ 1 ] = ( v >> 8 ) & 0xff;
+}
+
+static void put_u32( uint8_t * dst, uint32_t v ) {
+    put_u16( dst, v & 0xffff );
+    put_u16( dst + 2, v >> 16 );
+}
+
+static rc_t bgzf_init_zs( z_stream * zs, int level ) {
+    rc_t rc = 0;
+    memset( zs, 0, sizeof * zs );
+    /* windowBits = -15 : raw deflate, the gzip-header and -trailer are made here */
+    if ( Z_OK != deflateInit2( zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) ) {
+        rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    }
+    return rc;
+}
+
+static int bgzf_deflate_at( z_stream * zs, int level, const bgzf_block * b, bgzf_block * dst ) {
+    int zres = deflateReset( zs );
+    if ( Z_OK == zres ) {
+        zres = deflateParams( zs, level, Z_DEFAULT_STRATEGY );
+    }
+    if ( Z_OK == zres ) {
+        zs -> next_in = ( Bytef * )b -> data;
+        zs -> avail_in = ( uInt )b -> len;
+        zs -> next_out = ( Bytef * )&( dst -> out[ BGZF_HDR_SIZE ] );
+        zs -> avail_out = BGZF_MAX_BLOCK_SIZE - BGZF_HDR_SIZE - BGZF_FTR_SIZE;
+        zres = deflate( zs, Z_FINISH );
+    }
+    return zres;
+}
+
+/* deflate the data of a block into its out-buffer, as a complete BGZF-block */
+static rc_t bgzf_compress( z_stream * zs, int level, bgzf_block * b ) {
+    rc_t rc = 0;
+    int zres = bgzf_deflate_at( zs, level, b, b );
+    if ( Z_STREAM_END != zres && level != 0 ) {
+        /* did not fit into 64k ( data that does not compress ), store it instead */
+        zres = bgzf_deflate_at( zs, 0, b, b );
+    }
+    if ( Z_STREAM_END != zres ) {
+        rc = RC( rcExe, rcNoTarg, rcWriting, rcData, rcUnexpected );
+    } else {
+        uint8_t * p = b -> out;
+        size_t clen = zs -> total_out;
+        b -> out_len = BGZF_HDR_SIZE + clen + BGZF_FTR_SIZE;
+        memcpy( p, bgzf_hdr, BGZF_HDR_SIZE );
+        put_u16( p + 16, ( uint32_t )( b -> out_len - 1 ) );
+        p += BGZF_HDR_SIZE + clen;
+        put_u32( p, ( uint32_t )crc32( crc32( 0L, Z_NULL, 0 ), b -> data, ( uInt )b -> len ) );
+        put_u32( p + 4, ( uint32_t )b -> len );
+    }
+    return rc;
+}
+
+static rc_t bgzf_write_out( bgzf_writer * self, const void * src, size_t len ) {
+    size_t num_writ;
+    rc_t rc = KFileWriteAll( self -> f, self -> pos, src, len, &num_writ );
+    if ( rc == 0 && num_writ != len ) {
+        rc = RC( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+    }
+    if ( rc == 0 ) {
+        self -> pos += num_writ;
+    } else {
+        (void)LOGERR( klogErr, rc, "cannot write BGZF-block" );
+    }
+    return rc;
+}
+
+/* remember where block #nr starts in the file */
+static rc_t bgzf_keep_offset( bgzf_writer * self, uint64_t nr ) {
+    rc_t rc = 0;
+    if ( self -> keep_offsets ) {
+        if ( nr >= self -> offsets_allocated ) {
+            uint64_t new_allocated = ( self -> offsets_allocated == 0 ) ? 4096 : self -> offsets_allocated * 2;
+            uint64_t * tmp = realloc( self -> offsets, new_allocated * sizeof * tmp );
+            if ( tmp == NULL ) {
+                rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+                (void)LOGERR( klogErr, rc, "cannot allocate BGZF-block-offsets" );
+            } else {
+                self -> offsets = tmp;
+                self -> offsets_allocated = new_allocated;
+            }
+        }
+        if ( rc == 0 ) {
+            self -> offsets[ nr ] = self -> pos;
+        }
+    }
+    return rc;
+}
+
+static rc_t bgzf_write_block( bgzf_writer * self, uint64_t nr, bgzf_block * b ) {
+    rc_t rc = b -> rc;
+    if ( rc != 0 ) {
+        (void)LOGERR( klogErr, rc, "cannot compress BGZF-block" );
+    } else {
+        rc = bgzf_keep_offset( self, nr );
+        if ( rc == 0 ) {
+            rc = bgzf_write_out( self, b -> out, b -> out_len );
+        }
+    }
+    return rc;
+}
+
+static rc_t CC bgzf_worker_thread( const KThread * self, void * data ) {
+    bgzf_writer * w = data;
+    z_stream zs;
+    rc_t rc = bgzf_init_zs( &zs, w -> level );
+    if ( rc != 0 ) {
+        (void)LOGERR( klogErr, rc, "cannot initialize deflate" );
+    } else {
+        bool quit = false;
+        while ( rc == 0 && !quit ) {
+            bgzf_block * b = NULL;
+            rc = KLockAcquire( w -> lock );
+            if ( rc == 0 ) {
+                while ( b == NULL && !w -> quit ) {
+                    uint64_t nr;
+                    for ( nr = w -> tail; b == NULL && nr < w -> head; ++nr ) {
+                        bgzf_block * candidate = &( w -> blocks[ nr % w -> num_blocks ] );
+                        if ( candidate -> state == bs_filled ) {
+                            b = candidate;
+                            b -> state = bs_compressing;
+                        }
+                    }
+                    if ( b == NULL && !w -> quit ) {
+                        KConditionWait( w -> filled, w -> lock );
+                    }
+                }
+                quit = ( b == NULL );
+                KLockUnlock( w -> lock );
+            }
+            if ( b != NULL ) {
+                /* an error goes with the block to the writing thread */
+                b -> rc = bgzf_compress( &zs, w -> level, b );
+                rc = KLockAcquire( w -> lock );
+                if ( rc == 0 ) {
+                    b -> state = bs_done;
+                    KConditionBroadcast( w -> done );
+                    KLockUnlock( w -> lock );
+                }
+            }
+        }
+        deflateEnd( &zs );
+    }
+    /* a writer waiting for a block must not wait for workers that are gone */
+    if ( KLockAcquire( w -> lock ) == 0 ) {
+        w -> running--;
+        if ( rc != 0 && w -> worker_rc == 0 ) { w -> worker_rc = rc; }
+        KConditionBroadcast( w -> done );
+        KLockUnlock( w -> lock );
+    }
+    return rc;
+}
+
+/* call with the lock held: write the finished blocks at the tail of the ring,
+   wait for the oldest one if the ring is full or if all have to be written */
+static rc_t bgzf_write_done_blocks( bgzf_writer * self, bool all ) {
+    rc_t rc = 0;
+    while ( rc == 0 && self -> tail < self -> head ) {
+        bgzf_block * b = &( self -> blocks[ self -> tail % self -> num_blocks ] );
+        if ( b -> state == bs_done ) {
+            /* the block belongs to us now, write it without holding the lock */
+            KLockUnlock( self -> lock );
+            rc = bgzf_write_block( self, self -> tail, b );
+            KLockAcquire( self -> lock );
+            b -> state = bs_free;
+            b -> len = 0;
+            self -> tail++;
+        } else if ( self -> running == 0 ) {
+            /* nobody left to deflate the block */
+            rc = self -> worker_rc;
+            if ( rc == 0 ) {
+                rc = RC( rcExe, rcNoTarg, rcWriting, rcThread, rcCanceled );
+            }
+            (void)LOGERR( klogErr, rc, "all BGZF-workers have quit" );
+        } else if ( all || self -> head - self -> tail >= self -> num_blocks ) {
+            KConditionWait( self -> done, self -> lock );
+        } else {
+            break;
+        }
+    }
+    return rc;
+}
+
+/* hand the block being filled to the workers ( or deflate and write it right here ) */
+static rc_t bgzf_submit( bgzf_writer * self ) {
+    rc_t rc;
+    bgzf_block * b = &( self -> blocks[ self -> head % self -> num_blocks ] );
+    if ( self -> num_threads == 0 ) {
+        b -> rc = bgzf_compress( &( self -> zs ), self -> level, b );
+        rc = bgzf_write_block( self, self -> head, b );
+        b -> len = 0;
+        self -> head++;
+        self -> tail = self -> head;
+    } else {
+        rc = KLockAcquire( self -> lock );
+        if ( rc == 0 ) {
+            b -> state = bs_filled;
+            b -> rc = 0;
+            self -> head++;
+            KConditionSignal( self -> filled );
+            rc = bgzf_write_done_blocks( self, false );
+            KLockUnlock( self -> lock );
+        }
+    }
+    return rc;
+}
+
+rc_t bgzf_write( bgzf_writer * self, const void * src, size_t len ) {
+    rc_t rc = 0;
+    const uint8_t * p = src;
+    while ( rc == 0 && len > 0 ) {
+        bgzf_block * b = &( self -> blocks[ self -> head % self -> num_blocks ] );
+        size_t n = BGZF_BLOCK_SIZE - b -> len;
+        if ( n > len ) { n = len; }
+        memcpy( &( b -> data[ b -> len ] ), p, n );
+        b -> len += n;
+        p += n;
+        len -= n;
+        if ( b -> len == BGZF_BLOCK_SIZE ) {
+            rc = bgzf_submit( self );
+        }
+    }
+    return rc;
+}
+
+rc_t bgzf_flush( bgzf_writer * self ) {
+    rc_t rc = 0;
+    if ( self -> blocks[ self -> head % self -> num_blocks ] . len > 0 ) {
+        rc = bgzf_submit( self );
+    }
+    return rc;
+}
+
+uint64_t bgzf_tell( const bgzf_writer * self ) {
+    return ( self -> head << 16 ) | self -> blocks[ self -> head % self -> num_blocks ] . len;
+}
+
+static void bgzf_stop_threads( bgzf_writer * self ) {
+    if ( self -> threads != NULL ) {
+        uint32_t idx;
+        if ( KLockAcquire( self -> lock ) == 0 ) {
+            self -> quit = true;
+            KConditionBroadcast( self -> filled );
+            KLockUnlock( self -> lock );
+        }
+        for ( idx = 0; idx < self -> num_threads; ++idx ) {
+            if ( self -> threads[ idx ] != NULL ) {
+                rc_t status;
+                KThreadWait( self -> threads[ idx ], &status );
+                KThreadRelease( self -> threads[ idx ] );
+            }
+        }
+        free( self -> threads );
+        self -> threads = NULL;
+    }
+}
+
+rc_t bgzf_finish( bgzf_writer * self ) {
+    rc_t rc = bgzf_flush( self );
+    if ( rc == 0 && self -> num_threads > 0 ) {
+        rc = KLockAcquire( self -> lock );
+        if ( rc == 0 ) {
+            rc = bgzf_write_done_blocks( self, true );
+            KLockUnlock( self -> lock );
+        }
+    }
+    bgzf_stop_threads( self );
+    if ( rc == 0 ) {
+        /* the EOF-block gets a number too: an offset can point to the end of the last block */
+        rc = bgzf_keep_offset( self, self -> head );
+        if ( rc == 0 ) {
+            rc = bgzf_write_out( self, bgzf_eof, sizeof bgzf_eof );
+        }
+    }
+    self -> finished = true;
+    return rc;
+}
+
+uint64_t bgzf_real_offset( const bgzf_writer * self, uint64_t voffset ) {
+    uint64_t nr = voffset >> 16;
+    uint64_t res = voffset;
+    if ( self -> keep_offsets && nr < self -> offsets_allocated && nr <= self -> head ) {
+        res = ( self -> offsets[ nr ] << 16 ) | ( voffset & 0xffff );
+    }
+    return res;
+}
+
+void release_bgzf_writer( bgzf_writer * self ) {
+    if ( self != NULL ) {
+        bgzf_stop_threads( self );
+        KConditionRelease( self -> done );
+        KConditionRelease( self -> filled );
+        KLockRelease( self -> lock );
+        if ( self -> zs_valid ) { deflateEnd( &( self -> zs ) ); }
+        free( self -> offsets );
+        free( self -> blocks );
+        free( self );
+    }
+}
+
+static rc_t bgzf_start_threads( bgzf_writer * self ) {
+    rc_t rc = KLockMake( &( self -> lock ) );
+    if ( rc != 0 ) {
+        (void)LOGERR( klogInt, rc, "KLockMake() failed" );
+    } else {
+        rc = KConditionMake( &( self -> filled ) );
+        if ( rc == 0 ) {
+            rc = KConditionMake( &( self -> done ) );
+        }
+        if ( rc != 0 ) {
+            (void)LOGERR( klogInt, rc, "KConditionMake() failed" );
+        }
+    }
+    if ( rc == 0 ) {
+        self -> threads = calloc( self -> num_threads, sizeof self -> threads[ 0 ] );
+        if ( self -> threads == NULL ) {
+            rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        } else {
+            uint32_t idx;
+            /* if a thread cannot be made, the writer is released: no need to count the started ones */
+            self -> running = self -> num_threads;
+            for ( idx = 0; idx < self -> num_threads && rc == 0; ++idx ) {
+                rc = KThreadMake( &( self -> threads[ idx ] ), bgzf_worker_thread, self );
+                if ( rc != 0 ) {
+                    (void)LOGERR( klogInt, rc, "KThreadMake() failed" );
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+rc_t make_bgzf_writer( bgzf_writer ** w, KFile * f, uint32_t num_threads,
+                       int level, bool keep_offsets ) {
+    rc_t rc = 0;
+    if ( w == NULL || f == NULL ) {
+        rc = RC( rcExe, rcNoTarg, rcConstructing, rcParam, rcNull );
+    } else {
+        bgzf_writer * self = calloc( 1, sizeof * self );
+        *w = NULL;
+        if ( self == NULL ) {
+            rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        } else {
+            self -> f = f;
+            self -> level = ( level >= 0 && level <= 9 ) ? level : Z_DEFAULT_COMPRESSION;
+            self -> keep_offsets = keep_offsets;
+            /* a single thread would only wait for the producer, deflate on its thread instead */
+            self -> num_threads = ( num_threads > 1 ) ? num_threads : 0;
+            self -> num_blocks = ( self -> num_threads > 0 ) ? self -> num_threads * BGZF_BLOCKS_PER_THREAD : 1;
+            self -> blocks = calloc( self -> num_blocks, sizeof self -> blocks[ 0 ] );
+            if ( self -> blocks == NULL ) {
+                rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            } else if ( self -> num_threads == 0 ) {
+                rc = bgzf_init_zs( &( self -> zs ), self -> level );
+                self -> zs_valid = ( rc == 0 );
+            } else {
+                rc = bgzf_start_threads( self );
+            }
+            if ( rc != 0 ) {
+                (void)LOGERR( klogErr, rc, "cannot make BGZF-writer" );
+                release_bgzf_writer( self );
+            } else {
+                *w = self;
+            }
+        }
+    }
+    return rc;
+}
@@ -0,0 +1,81 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#ifndef _h_bgzf_
+#define _h_bgzf_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_kfs_file_
+#include <kfs/file.h>   /* KFile */
+#endif
+
+/* -----------------------------------------------------------------------------------
+    Writes a BGZF-stream ( the block-gzip format BAM- and CSI-files are made of ) into
+    a KFile. The data is cut into blocks of at most 0xff00 bytes, each block becomes a
+    gzip-member of its own. With num_threads > 1 the blocks are deflated by a pool of
+    threads while the caller fills the next block, the blocks are written in order.
+
+    Offsets into the stream are 'virtual': ( block-number << 16 ) | offset-in-block.
+    Block-numbers, not compressed file-offsets, because the compressed size of a block
+    is not known when data is put into it. bgzf_real_offset() translates them into the
+    file-offsets of the BAM-spec, if make_bgzf_writer() was asked to keep the offsets
+    of the written blocks, after bgzf_finish().
+   ----------------------------------------------------------------------------------- */
+
+struct bgzf_writer;
+
+/* level < 0 ... default compression-level */
+rc_t make_bgzf_writer( struct bgzf_writer ** w, KFile * f, uint32_t num_threads,
+                       int level, bool keep_offsets );
+
+rc_t bgzf_write( struct bgzf_writer * self, const void * src, size_t len );
+
+/* end the current block, the next write starts a new one */
+rc_t bgzf_flush( struct bgzf_writer * self );
+
+/* virtual offset of the next byte written */
+uint64_t bgzf_tell( const struct bgzf_writer * self );
+
+/* flush, wait for all blocks to be written, append the EOF-marker */
+rc_t bgzf_finish( struct bgzf_writer * self );
+
+/* virtual offset ( block-number based ) into the BAM-spec virtual offset ( file-offset based ) */
+uint64_t bgzf_real_offset( const struct bgzf_writer * self, uint64_t voffset );
+
+/* does not finish the stream, does not release the KFile */
+void release_bgzf_writer( struct bgzf_writer * self );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -593,6 +593,38 @@ rc_t prepare_ref_iter( prepare_ctx *ctx,
     return rc;
 }
 
+/* prepare_ref_iter() for a caller that loads many reference-iterators from the same source:
+   the database and its reference-list stay open in ctx, the source has been checked before */
+rc_t open_prepare_db( prepare_ctx *ctx,
+                      const VDBManager *vdb_mgr,
+                      VSchema *vdb_schema,
+                      const char * path ) {
+    rc_t rc;
+    ctx->seq_tab = NULL;
+    ctx->reflist = NULL;
+    rc = VDBManagerOpenDBRead ( vdb_mgr, &ctx->db, vdb_schema, "%s", path );
+    if ( rc != 0 ) {
+        ctx->db = NULL;
+        PLOGERR( klogErr, ( klogErr, rc, "failed to open '$(path)'", "path=%s", path ) );
+    } else {
+        rc = prepare_reflist( ctx );
+    }
+    return rc;
+}
+
+rc_t prepare_ref_iter_regions( prepare_ctx *ctx, BSTree * regions ) {
+    return foreach_ref_region( regions, prepare_region_cb, ctx ); /* ref_regions.c */
+}
+
+void close_prepare_db( prepare_ctx *ctx ) {
+    if ( ctx->reflist != NULL ) {
+        ReferenceList_Release( ctx->reflist );
+        ctx->reflist = NULL;
+    }
+    VDatabaseRelease ( ctx->db );
+    ctx->db = NULL;
+}
+
 /* =========================================================================================== */
 
 rc_t parse_inf_file( Args * args )
@@ -125,6 +125,8 @@ typedef struct prepare_ctx {
     bool use_evidence_alignments;
     void * data;
     const char *path;
+    const PlacementRecordExtendFuncs *plset_ext;   /* if plset_iter is loaded: extension #1 of its records */
+    int32_t min_mapq;                               /* if plset_iter is loaded */
     rc_t ( CC * on_section ) ( struct prepare_ctx * ctx, const struct reference_range * range );
 } prepare_ctx;
 
@@ -134,6 +136,17 @@ rc_t prepare_ref_iter( prepare_ctx *ctx,
                        const char * path,
                        BSTree * regions );
 
+/* the same in three steps, the database stays open across many reference-iterators:
+   open_prepare_db() once, prepare_ref_iter_regions() for each ref_iter in ctx, close_prepare_db() at the end */
+rc_t open_prepare_db( prepare_ctx *ctx,
+                      const VDBManager *vdb_mgr,
+                      VSchema *vdb_schema,
+                      const char * path );
+
+rc_t prepare_ref_iter_regions( prepare_ctx *ctx, BSTree * regions );
+
+void close_prepare_db( prepare_ctx *ctx );
+
 rc_t prepare_plset_iter( prepare_ctx *ctx,
                          const VDBManager *vdb_mgr,
                          VSchema *vdb_schema,
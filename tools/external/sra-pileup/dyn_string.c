@@ -38,6 +38,8 @@
 #include <klib/out.h>
 #endif
 
+#include <string.h>
+
 typedef struct dyn_string {
     char * data;
     size_t allocated;
@@ -179,6 +181,26 @@ rc_t ds_add_ds( struct dyn_string *self, struct dyn_string *other ) {
     return rc;
 }
 
+rc_t ds_add_mem( struct dyn_string *self, const char * s, size_t size ) {
+    rc_t rc = 0;
+    if ( NULL != self ) {
+        size_t needed = self -> data_len + size + 1;
+        if ( needed > self -> allocated ) {
+            /* grow by doubling, this is used to collect many small pieces */
+            size_t doubled = self -> allocated * 2;
+            rc = ds_expand( self, needed > doubled ? needed : doubled );
+        }
+        if ( rc == 0 ) {
+            memmove( &( self -> data[ self -> data_len ] ), s, size );
+            self -> data_len += size;
+            self -> data[ self -> data_len ] = 0;
+        }
+    } else {
+        rc = RC( rcApp, rcNoTarg, rcConstructing, rcSelf, rcNull );
+    }
+    return rc;
+}
+
 rc_t ds_add_fmt( struct dyn_string * self, const char *fmt, ... ) {
     rc_t rc;
     if ( NULL != self ) {
@@ -221,6 +243,23 @@ rc_t ds_print( struct dyn_string * self ) {
     }
 }
 
+/* hand the content to a KOut-writer directly, without going through KOutMsg() */
+rc_t ds_write( struct dyn_string * self, KWrtWriter writer, void * data ) {
+    rc_t rc = 0;
+    if ( self != NULL && writer != NULL ) {
+        size_t written = 0;
+        while ( rc == 0 && written < self -> data_len ) {
+            size_t num_writ = 0;
+            rc = writer( data, &( self -> data[ written ] ), self -> data_len - written, &num_writ );
+            if ( rc == 0 && num_writ == 0 ) {
+                rc = RC( rcApp, rcNoTarg, rcWriting, rcTransfer, rcIncomplete );
+            }
+            written += num_writ;
+        }
+    }
+    return rc;
+}
+
 size_t ds_len( struct dyn_string * self ) {
     if ( self != NULL ) {
         return self -> data_len;
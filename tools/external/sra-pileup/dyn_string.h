@@ -35,6 +35,10 @@ extern "C" {
 #include <klib/rc.h>
 #endif
 
+#ifndef _h_klib_out_
+#include <klib/out.h>   /* KWrtWriter */
+#endif
+
 struct dyn_string;
 
 rc_t ds_allocate( struct dyn_string **self, size_t size );
@@ -47,8 +51,10 @@ rc_t ds_repeat_char( struct dyn_string *self, const char c, uint32_t n );
 char * ds_get_char( struct dyn_string *self, uint32_t idx );
 rc_t ds_add_str( struct dyn_string *self, const char * s );
 rc_t ds_add_ds( struct dyn_string *self, struct dyn_string *other );
+rc_t ds_add_mem( struct dyn_string *self, const char * s, size_t size );
 rc_t ds_add_fmt( struct dyn_string * self, const char *fmt, ... );
 rc_t ds_print( struct dyn_string * self );
+rc_t ds_write( struct dyn_string * self, KWrtWriter writer, void * data );
 size_t ds_len( struct dyn_string * self );
 rc_t ds_print_char_n( struct dyn_string *self, const char c, uint32_t n );
 
@@ -72,6 +72,7 @@ typedef struct input_database {
     char * path;
     const VDatabase * db;
     const ReferenceList *reflist;
+    uint32_t reflist_options;   /* to make more reflists on the same db ( one per thread ) */
     void * prim_ctx;
     void * sec_ctx;
     void * ev_ctx;
@@ -305,6 +305,65 @@ rc_t matecache_report( const matecache * const self ) {
     return rc;
 }
 
+typedef struct merge_ctx {
+    matecache * dst;
+    const matecache_per_file * src;
+    uint32_t db_idx;
+} merge_ctx;
+
+static rc_t CC on_merge_unaligned( uint64_t key, uint64_t value, void *user_data ) {
+    merge_ctx * mctx = user_data;
+    uint64_t seq_id;
+    rc_t rc = KVectorGetU64( mctx->src->unaligned_64_b, key, &seq_id );
+    if ( rc != 0 ) {
+        (void)LOGERR( klogErr, rc, "cannot retrieve value (unaligned b) U64" );
+    } else {
+        rc = matecache_insert_unaligned( mctx->dst, mctx->db_idx, ( int64_t )key,
+                                         ( INSDC_coord_zero )( value >> 32 ),
+                                         ( uint32_t )( value & 0xFFFFFFFF ),
+                                         ( int64_t )seq_id );
+    }
+    return rc;
+}
+
+static void matecache_add_stat( matecache_stat * const dst, const matecache_stat * const src ) {
+    dst->lookups += src->lookups;
+    dst->finds += src->finds;
+    dst->inserts += src->inserts;
+}
+
+rc_t matecache_merge( matecache * const self, const matecache * const other ) {
+    rc_t rc = 0;
+    if ( self == NULL || other == NULL ) {
+        rc = RC( rcApp, rcNoTarg, rcAccessing, rcSelf, rcNull );
+        (void)LOGERR( klogErr, rc, "cannot merge matecache" );
+    } else {
+        uint32_t idx;
+        for ( idx = 0; idx < self->count && idx < other->count && rc == 0; ++idx ) {
+            matecache_per_file * dst = &self->per_file[ idx ];
+            const matecache_per_file * src = &other->per_file[ idx ];
+            merge_ctx mctx;
+            uint64_t inserts = dst->stat_unaligned.inserts;
+
+            mctx.dst = self;
+            mctx.src = src;
+            mctx.db_idx = idx;
+            rc = KVectorVisitU64( src->unaligned_64_a, false, on_merge_unaligned, &mctx );
+            if ( rc == 0 ) {
+                /* the inserts of the merge do not count, the ones of the worker do */
+                dst->stat_unaligned.inserts = inserts;
+                matecache_add_stat( &dst->stat_same_ref, &src->stat_same_ref );
+                matecache_add_stat( &dst->stat_unaligned, &src->stat_unaligned );
+                if ( src->maxcount_same_ref > dst->maxcount_same_ref ) {
+                    dst->maxcount_same_ref = src->maxcount_same_ref;
+                }
+            }
+        }
+        self->flashes += other->flashes;
+    }
+    return rc;
+}
+
 rc_t matecache_insert_unaligned( matecache * const self,
         uint32_t db_idx, int64_t key, INSDC_coord_zero ref_pos, uint32_t ref_idx, int64_t seq_id ) {
     matecache_per_file * mcpf = NULL;
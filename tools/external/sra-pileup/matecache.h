@@ -77,6 +77,10 @@ rc_t matecache_clear_same_ref( matecache * const self );
 
 rc_t matecache_report( const matecache * const self );
 
+/* moves the half-aligned entries and the statistic of other into self,
+   other is the private cache of a worker-thread */
+rc_t matecache_merge( matecache * const self, const matecache * const other );
+
 
 /* cache functions for aligned mates on the same reference */
 
@@ -0,0 +1,325 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "pileup_depth.h"
+
+#ifndef _h_klib_out_
+#include <klib/out.h>
+#endif
+
+#ifndef _h_klib_log_
+#include <klib/log.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+rc_t CC Quitting( void );
+
+/* -----------------------------------------------------------------------------------------
+   depth only: no pileup-strings, no per-base events. A placement adds +1 at its start and
+   -1 behind its end in the difference-array of the current chunk, the running sum is the
+   depth. Ends behind the current chunk wait in a heap until their chunk is entered.
+   The output are bedGraph-intervals of equal depth:
+   ref-name, start ( 0-based ), end ( exclusive ), depth
+   intervals of depth 0 are only printed with --noskip
+   ----------------------------------------------------------------------------------------- */
+
+typedef struct end_heap {
+    uint32_t * items;           /* min-heap of 0-based, exclusive ends */
+    uint32_t count;
+    uint32_t allocated;
+} end_heap;
+
+static rc_t end_heap_push( end_heap * h, uint32_t value ) {
+    rc_t rc = 0;
+    if ( h -> count >= h -> allocated ) {
+        uint32_t new_allocated = ( h -> allocated == 0 ) ? 1024 : h -> allocated * 2;
+        uint32_t * tmp = realloc( h -> items, new_allocated * sizeof * tmp );
+        if ( tmp == NULL ) {
+            rc = RC ( rcApp, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+            LOGERR( klogErr, rc, "cannot grow heap of placement-ends" );
+        } else {
+            h -> items = tmp;
+            h -> allocated = new_allocated;
+        }
+    }
+    if ( rc == 0 ) {
+        uint32_t idx = h -> count++;
+        while ( idx > 0 && h -> items[ ( idx - 1 ) / 2 ] > value ) {
+            h -> items[ idx ] = h -> items[ ( idx - 1 ) / 2 ];
+            idx = ( idx - 1 ) / 2;
+        }
+        h -> items[ idx ] = value;
+    }
+    return rc;
+}
+
+static void end_heap_pop( end_heap * h ) {
+    uint32_t last = h -> items[ --( h -> count ) ];
+    uint32_t idx = 0;
+    bool done = ( h -> count == 0 );
+    while ( !done ) {
+        uint32_t child = idx * 2 + 1;
+        if ( child + 1 < h -> count && h -> items[ child + 1 ] < h -> items[ child ] ) {
+            child++;
+        }
+        if ( child >= h -> count || last <= h -> items[ child ] ) {
+            h -> items[ idx ] = last;
+            done = true;
+        } else {
+            h -> items[ idx ] = h -> items[ child ];
+            idx = child;
+        }
+    }
+}
+
+typedef struct depth_ctx {
+    pileup_options * options;
+    const char * ref_name;
+    int32_t * diff;             /* DEPTH_CHUNK_SIZE entries, relative to chunk_start */
+    end_heap ends;
+    uint32_t window_start;      /* 0-based */
+    uint32_t window_end;        /* exclusive */
+    uint32_t chunk_start;       /* 0-based */
+    uint32_t chunk_end;         /* exclusive, a multiple of DEPTH_CHUNK_SIZE or window_end */
+    uint32_t carry;             /* the depth at chunk_start, without diff[ 0 ] */
+    bool in_run;                /* the run of equal depth not printed yet */
+    uint32_t run_start;
+    uint32_t run_end;
+    uint32_t run_depth;
+} depth_ctx;
+
+static rc_t end_run( depth_ctx * ctx ) {
+    rc_t rc = 0;
+    if ( ctx -> in_run ) {
+        rc = KOutMsg( "%s\t%u\t%u\t%u\n", ctx -> ref_name, ctx -> run_start, ctx -> run_end, ctx -> run_depth );
+        ctx -> in_run = false;
+    }
+    return rc;
+}
+
+/* the running sum over the chunk, equal depths are joined into runs */
+static rc_t flush_chunk( depth_ctx * ctx ) {
+    rc_t rc = 0;
+    struct skiplist * skiplist = ctx -> options -> skiplist;
+    bool zeros = ctx -> options -> no_skip;
+    uint32_t depth = ctx -> carry;
+    uint32_t idx, len = ctx -> chunk_end - ctx -> chunk_start;
+
+    for ( idx = 0; idx < len && rc == 0; ++idx ) {
+        uint32_t pos = ctx -> chunk_start + idx;
+        depth += ctx -> diff[ idx ];
+        if ( ( depth == 0 && !zeros ) ||
+             ( skiplist != NULL && skiplist_is_skip_position( skiplist, pos + 1 ) ) ) {
+            rc = end_run( ctx );
+        } else if ( ctx -> in_run && depth == ctx -> run_depth ) {
+            ctx -> run_end = pos + 1;
+        } else {
+            rc = end_run( ctx );
+            ctx -> in_run = true;
+            ctx -> run_start = pos;
+            ctx -> run_end = pos + 1;
+            ctx -> run_depth = depth;
+        }
+    }
+    ctx -> carry = depth;
+    if ( rc == 0 ) {
+        rc = end_run( ctx ); /* the runs are cut at the end of a chunk */
+    }
+    return rc;
+}
+
+static void enter_chunk( depth_ctx * ctx, uint32_t start ) {
+    uint64_t end = ( ( uint64_t )( start / DEPTH_CHUNK_SIZE ) + 1 ) * DEPTH_CHUNK_SIZE;
+    ctx -> chunk_start = start;
+    ctx -> chunk_end = ( end < ctx -> window_end ) ? ( uint32_t )end : ctx -> window_end;
+    memset( ctx -> diff, 0, ( ctx -> chunk_end - start ) * sizeof ctx -> diff[ 0 ] );
+    while ( ctx -> ends . count > 0 && ctx -> ends . items[ 0 ] < ctx -> chunk_end ) {
+        ctx -> diff[ ctx -> ends . items[ 0 ] - start ]--;
+        end_heap_pop( &( ctx -> ends ) );
+    }
+}
+
+/* print the current chunk and enter the next one, on the way to pos */
+static rc_t next_chunk( depth_ctx * ctx, uint32_t pos ) {
+    rc_t rc = flush_chunk( ctx );
+    if ( rc == 0 ) {
+        uint32_t start = ctx -> chunk_end;
+        if ( ctx -> carry == 0 && ctx -> ends . count == 0 && !ctx -> options -> no_skip ) {
+            /* nothing reaches into the chunks before pos: jump over them */
+            uint32_t chunk_of_pos = ( pos / DEPTH_CHUNK_SIZE ) * DEPTH_CHUNK_SIZE;
+            if ( chunk_of_pos > start ) {
+                start = chunk_of_pos;
+            }
+        }
+        enter_chunk( ctx, start );
+    }
+    return rc;
+}
+
+static rc_t add_placement( depth_ctx * ctx, INSDC_coord_zero pos, INSDC_coord_len len ) {
+    rc_t rc = 0;
+    int64_t start = pos;
+    int64_t end = start + len;
+
+    /* the iterator returns the placements that stick into the window, count only inside of it */
+    if ( start < ctx -> window_start ) { start = ctx -> window_start; }
+    if ( end > ctx -> window_end ) { end = ctx -> window_end; }
+    if ( start < end ) {
+        while ( rc == 0 && start >= ctx -> chunk_end ) {
+            rc = next_chunk( ctx, ( uint32_t )start );
+        }
+        if ( rc == 0 ) {
+            /* the placements arrive sorted by position, this is only a guard */
+            if ( start < ctx -> chunk_start ) { start = ctx -> chunk_start; }
+            ctx -> diff[ start - ctx -> chunk_start ]++;
+            if ( end < ctx -> chunk_end ) {
+                ctx -> diff[ end - ctx -> chunk_start ]--;
+            } else if ( end < ctx -> window_end ) {
+                rc = end_heap_push( &( ctx -> ends ), ( uint32_t )end );
+            }
+            /* an end at the end of the window is not needed any more */
+        }
+    }
+    return rc;
+}
+
+static rc_t walk_depth_pos( depth_ctx * ctx, PlacementSetIterator * plset_iter, INSDC_coord_zero pos ) {
+    rc_t rc = 0;
+    while ( rc == 0 ) {
+        const PlacementRecord *rec;
+        rc = PlacementSetIteratorNextRecordAt( plset_iter, pos, &rec );
+        if ( rc != 0 ) {
+            if ( GetRCState( rc ) != rcDone ) {
+                LOGERR( klogInt, rc, "PlacementSetIteratorNextRecordAt() failed" );
+            }
+        } else {
+            rc = add_placement( ctx, rec -> pos, rec -> len );
+            PlacementRecordWhack ( rec );
+        }
+    }
+    if ( GetRCState( rc ) == rcDone ) { rc = 0; }
+    return rc;
+}
+
+static rc_t walk_depth_window( depth_ctx * ctx, PlacementSetIterator * plset_iter,
+                               INSDC_coord_zero first_pos, INSDC_coord_len len ) {
+    rc_t rc = 0;
+
+    ctx -> window_start = first_pos;
+    ctx -> window_end = first_pos + len;
+    ctx -> carry = 0;
+    ctx -> ends . count = 0;
+    enter_chunk( ctx, ctx -> window_start );
+
+    while ( rc == 0 ) {
+        rc = Quitting();
+        if ( rc == 0 ) {
+            INSDC_coord_zero pos;
+            rc = PlacementSetIteratorNextAvailPos( plset_iter, &pos, NULL );
+            if ( rc != 0 ) {
+                if ( GetRCState( rc ) != rcDone ) {
+                    LOGERR( klogInt, rc, "PlacementSetIteratorNextAvailPos() failed" );
+                }
+            } else {
+                rc = walk_depth_pos( ctx, plset_iter, pos );
+            }
+        }
+    }
+    if ( GetRCState( rc ) == rcDone ) { rc = 0; }
+
+    /* print what is left of the window */
+    while ( rc == 0 && ctx -> chunk_start < ctx -> window_end ) {
+        rc = next_chunk( ctx, ctx -> window_end );
+    }
+    return rc;
+}
+
+static rc_t walk_depth_ref( depth_ctx * ctx, PlacementSetIterator * plset_iter, const ReferenceObj * ref_obj ) {
+    const char * seq_name;
+    rc_t rc = ReferenceObj_Name( ref_obj, &seq_name );
+    if ( rc != 0 ) {
+        LOGERR( klogInt, rc, "ReferenceObj_Name() failed" );
+    } else {
+        const char * seq_id;
+        rc = ReferenceObj_SeqId( ref_obj, &seq_id );
+        if ( rc != 0 ) {
+            LOGERR( klogInt, rc, "ReferenceObj_SeqId() failed" );
+        } else {
+            ctx -> ref_name = ctx -> options -> use_seq_name ? seq_name : seq_id;
+            if ( ctx -> options -> skiplist != NULL ) {
+                skiplist_enter_ref( ctx -> options -> skiplist, seq_name, seq_id ); /* ref_regions.c */
+            }
+        }
+    }
+
+    while ( rc == 0 ) {
+        INSDC_coord_zero first_pos;
+        INSDC_coord_len len;
+        rc = PlacementSetIteratorNextWindow( plset_iter, &first_pos, &len );
+        if ( rc != 0 ) {
+            if ( GetRCState( rc ) != rcDone ) {
+                LOGERR( klogInt, rc, "PlacementSetIteratorNextWindow() failed" );
+            }
+        } else {
+            rc = walk_depth_window( ctx, plset_iter, first_pos, len );
+        }
+    }
+    if ( GetRCState( rc ) == rcDone ) { rc = 0; }
+    return rc;
+}
+
+rc_t walk_depth( PlacementSetIterator *plset_iter, pileup_options * options ) {
+    depth_ctx ctx;
+    rc_t rc = 0;
+
+    memset( &ctx, 0, sizeof ctx );
+    ctx . options = options;
+    ctx . diff = malloc( DEPTH_CHUNK_SIZE * sizeof ctx . diff[ 0 ] );
+    if ( ctx . diff == NULL ) {
+        rc = RC ( rcApp, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        LOGERR( klogErr, rc, "cannot allocate difference-array" );
+    }
+
+    while ( rc == 0 ) {
+        const ReferenceObj * ref_obj;
+        rc = PlacementSetIteratorNextReference( plset_iter, NULL, NULL, &ref_obj );
+        if ( rc != 0 ) {
+            if ( GetRCState( rc ) != rcDone ) {
+                LOGERR( klogInt, rc, "PlacementSetIteratorNextReference() failed" );
+            }
+        } else if ( ref_obj != NULL ) {
+            rc = walk_depth_ref( &ctx, plset_iter, ref_obj );
+        }
+    }
+    if ( GetRCState( rc ) == rcDone ) { rc = 0; }
+    if ( GetRCState( rc ) == rcCanceled ) { rc = 0; }
+
+    free( ctx . diff );
+    free( ctx . ends . items );
+    return rc;
+}
@@ -0,0 +1,56 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_pileup_depth_
+#define _h_pileup_depth_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_align_manager_
+#include <align/manager.h>
+#endif
+
+#ifndef _h_pileup_options_
+#include "pileup_options.h"
+#endif
+
+/* the runs of equal depth are cut at multiples of this, the output is the same
+   if the reference is walked in one piece or in windows of this size */
+#define DEPTH_CHUNK_SIZE ( 64 * 1024 )
+
+rc_t walk_depth( PlacementSetIterator *plset_iter, pileup_options * options );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*  _h_pileup_depth_ */
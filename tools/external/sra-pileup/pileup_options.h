@@ -52,6 +52,7 @@ typedef struct pileup_options
     uint32_t minmapq;
     uint32_t min_mismatch;
     uint32_t merge_dist;
+    uint32_t num_threads;   /* how many threads walk the reference-windows, 1 ... single-threaded */
     uint32_t source_table;
     uint32_t function;  /* sra_pileup_samtools, sra_pileup_counters, sra_pileup_stat, 
                            sra_pileup_report_ref, sra_pileup_report_ref_ext, sra_pileup_debug, etc */
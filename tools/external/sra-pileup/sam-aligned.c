@@ -38,6 +38,18 @@
 #include <klib/log.h>
 #endif
 
+#ifndef _h_kproc_thread_
+#include <kproc/thread.h>
+#endif
+
+#ifndef _h_kproc_lock_
+#include <kproc/lock.h>
+#endif
+
+#ifndef _h_kproc_cond_
+#include <kproc/cond.h>
+#endif
+
 #ifndef _h_read_fkt_
 #include "read_fkt.h"
 #endif
@@ -58,6 +70,14 @@
 #include "rna_splice_log.h"
 #endif
 
+#ifndef _h_bam_writer_
+#include "bam_writer.h"
+#endif
+
+#ifndef _h_sam_line_
+#include "sam_line.h"
+#endif
+
 rc_t Quitting( void );      /* instead of including <kapp/main.h> */
 
 const char * PRIM_TABLE = "PRIMARY_ALIGNMENT";
@@ -521,6 +541,58 @@ static rc_t prepare_evidence_table_cursor( const samdump_opts * const opts,
     return rc;
 }
 
+static rc_t add_context_pl_iter( const samdump_opts * const opts,
+                                 PlacementSetIterator * const set_iter,
+                                 align_table_context * const atx,
+                                 INSDC_coord_zero ref_pos,
+                                 INSDC_coord_len ref_len,
+                                 const char * spot_group ) {
+    int32_t min_mapq = 0;
+    PlacementIterator *pl_iter;
+    PlacementRecordExtendFuncs ext_0; /* ReferenceObj_MakePlacementIterator makes copies of the elements */
+    align_id_src id_src_selector = primary_align_ids;
+    rc_t rc;
+
+    switch( atx -> align_table_type ) {
+        case att_primary    : id_src_selector = primary_align_ids; break;
+        case att_secondary  : id_src_selector = secondary_align_ids; break;
+        case att_evidence   : id_src_selector = evidence_align_ids; break;
+    }
+
+    memset( &ext_0, 0, sizeof ext_0 );
+    ext_0 . data = atx;
+
+    if ( opts -> use_min_mapq ) { min_mapq = opts -> min_mapq; }
+
+    rc = ReferenceObj_MakePlacementIterator( atx -> ref_obj, /* the reference-obj it is made from */
+        &pl_iter,             /* the placement-iterator we want to make */
+        ref_pos,              /* where it starts on the reference */
+        ref_len,              /* the whole length of this reference/chromosome */
+        min_mapq,             /* no minimal mapping-quality to filter out */
+        NULL,                 /* no special reference-cursor */
+        atx -> cmn . cursor,  /* a cursor into the PRIMARY/SECONDARY/EVIDENCE-table */
+        id_src_selector,      /* what ID-source to select from REFERENCE-table (ref_obj) */
+        &ext_0,               /* placement-record extensions #0 with data-ptr pointing to cursor/index-struct */
+        NULL,                 /* no placement-record extensions #1 */
+        spot_group,           /* optional spotgroup re-grouping */
+        NULL                  /* source-cursor specific data/context */
+        );
+    if ( rc == 0 ) {
+        rc = PlacementSetIteratorAddPlacementIterator ( set_iter, pl_iter );
+        /* if the iterator-set was not able to take ownership of the new iterator
+           we have to release the iterator right here! */
+        if ( rc != 0 ) {
+            PlacementIteratorRelease( pl_iter );
+        }
+        /* if the new iterator has actually no placements inside, the call
+           to PlacementSetIteratorAddPlacementIterator() returned rcDone, which is OK - we continue... */
+        if ( GetRCState( rc ) == rcDone ) { rc = 0; }
+    }
+    return rc;
+}
+
+/* if set_iter is NULL only the context ( with its cursor ) is made, the threaded mode
+   makes the placement-iterators later, one set for each window */
 static rc_t add_table_pl_iter( const samdump_opts * const opts,
                                PlacementSetIterator * const set_iter,
                                const ReferenceObj * const ref_obj,
@@ -532,11 +604,7 @@ static rc_t add_table_pl_iter( const samdump_opts * const opts,
                                align_id_src id_src_selector,
                                Vector * const context_list ) {
     rc_t rc = 0;
-    align_table_context * atx;
-    PlacementRecordExtendFuncs ext_0; /* ReferenceObj_MakePlacementIterator makes copies of the elements */
-
-    memset( &ext_0, 0, sizeof ext_0 );
-    atx = calloc( 1, sizeof * atx );
+    align_table_context * atx = calloc( 1, sizeof * atx );
     if ( atx == NULL ) {
         rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
         (void)PLOGERR( klogInt, ( klogInt, rc, "align-context-allocation for $(tn) failed", "tn=%s", table_name ) );
@@ -561,47 +629,16 @@ static rc_t add_table_pl_iter( const samdump_opts * const opts,
             }
         }
         if ( rc == 0 ) {
-            ext_0 . data = atx;
             /* we must put the atx-ptr into a global list, in order to close everything later at the end... */
-        } else {
-            free_align_table_context( atx );
+            rc = VectorAppend ( context_list, NULL, atx );
         }
-    }
-
-    if ( rc == 0 ) {
-        int32_t min_mapq = 0;
-        PlacementIterator *pl_iter;
-
-        if ( opts -> use_min_mapq ) { min_mapq = opts -> min_mapq; }
-
-        rc = ReferenceObj_MakePlacementIterator( ref_obj, /* the reference-obj it is made from */
-            &pl_iter,             /* the placement-iterator we want to make */
-            ref_pos,              /* where it starts on the reference */
-            ref_len,              /* the whole length of this reference/chromosome */
-            min_mapq,             /* no minimal mapping-quality to filter out */
-            NULL,                 /* no special reference-cursor */
-            atx -> cmn . cursor,  /* a cursor into the PRIMARY/SECONDARY/EVIDENCE-table */
-            id_src_selector,      /* what ID-source to select from REFERENCE-table (ref_obj) */
-            &ext_0,               /* placement-record extensions #0 with data-ptr pointing to cursor/index-struct */
-            NULL,                 /* no placement-record extensions #1 */
-            spot_group,           /* optional spotgroup re-grouping */
-            NULL                  /* source-cursor specific data/context */
-            );
-        if ( rc == 0 ) {
-            rc = PlacementSetIteratorAddPlacementIterator ( set_iter, pl_iter );
-            /* if the iterator-set was not able to take ownership of the new iterator
-               we have to release the iterator right here! */
-            if ( rc != 0 ) {
-                PlacementIteratorRelease( pl_iter );
-            }
-            /* if the new iterator has actually no placements inside, the call
-               to PlacementSetIteratorAddPlacementIterator() returned rcDone, which is OK - we continue... */
-            if ( GetRCState( rc ) == rcDone ) { rc = 0; }
+        if ( rc != 0 ) {
+            free_align_table_context( atx );
         }
     }
 
-    if ( rc == 0 ) {
-        rc = VectorAppend ( context_list, NULL, atx );
+    if ( rc == 0 && set_iter != NULL ) {
+        rc = add_context_pl_iter( opts, set_iter, atx, ref_pos, ref_len, spot_group );
     }
     return rc;
 }
@@ -766,7 +803,7 @@ static uint32_t calc_mate_flags( uint32_t flags ) {
 
 static const char *equal_sign = "=";
 
-static rc_t print_qslice( const samdump_opts * const opts,
+static rc_t print_qslice( struct sam_line * line,
                           bool reverse,
                           const char * source,
                           uint32_t source_str_len,
@@ -781,19 +818,17 @@ static rc_t print_qslice( const samdump_opts * const opts,
         uint32_t len = source_len_vector[ slice_nr ];
         if ( len > 0 ) {
             const char * ptr = &source[ *source_offset ];
-            rc = dump_quality_33( opts, ptr, len, reverse ); /* sam-dump-opts.c */
-            if ( rc == 0 ) {
-                rc = KOutMsg( "" );
-                if ( rc == 0 ) { *source_offset += len; }
-            }
+            rc = sam_line_qual( line, ptr, len, reverse ); /* sam_line.c */
+            if ( rc == 0 ) { *source_offset += len; }
         } else {
-            rc = KOutMsg( "*" );
+            rc = sam_line_char( line, '*' );
         }
     }
     return rc;
 }
 
-static rc_t modify_and_print_cigar( const char * cigar,
+static rc_t modify_and_print_cigar( struct sam_line * line,
+                                    const char * cigar,
                                     size_t cigar_len,
                                     CigOps *ref_cig,
                                     int32_t ref_cig_len,
@@ -805,9 +840,9 @@ static rc_t modify_and_print_cigar( const char * cigar,
         CigOps al_cig[ 1024 ];
         ExplodeCIGAR( al_cig, 1024, cigar, cigar_len );
         CombineCIGAR( cigbuf, al_cig, read_len, ref_pos, ref_cig, ref_cig_len );
-        rc = KOutMsg( "%s\t", cigbuf );
+        rc = sam_line_str_tab( line, cigbuf, string_size( cigbuf ) );
     } else {
-        rc = KOutMsg( "*\t" );
+        rc = sam_line_str( line, "*\t", 2 );
     }
     return rc;
 }
@@ -898,11 +933,8 @@ static bool invalid_qual_value( const unsigned char c ) {
     return ( ( c == 255 ) || ( c == 32 ) );
 }
 
-static rc_t print_quality_or_star( const samdump_opts * const opts,
-                                   const char * const q,
-                                   uint32_t q_len,
-                                   uint32_t r_len ) {
-    rc_t rc;
+/* no quality, or not matching the read, or all invalid */
+static bool is_star_quality( const char * const q, uint32_t q_len, uint32_t r_len ) {
     // this type-cast is now neccessary, because ( q[ 0 ] == 255 ) would always be false
     const unsigned char * const qu = ( const unsigned char * const ) q;
     bool star_qual = ( q_len == 0 || q_len != r_len );
@@ -911,16 +943,86 @@ static rc_t print_quality_or_star( const samdump_opts * const opts,
         while ( i < q_len && ( invalid_qual_value( qu[ i ] ) ) ) { i++; }
         star_qual = ( i == q_len );
     }
-    if ( star_qual ) {
-        rc = KOutMsg( "*" );
+    return star_qual;
+}
+
+static rc_t print_quality_or_star( struct sam_line * line,
+                                   const char * const q,
+                                   uint32_t q_len,
+                                   uint32_t r_len ) {
+    rc_t rc;
+    if ( is_star_quality( q, q_len, r_len ) ) {
+        rc = sam_line_char( line, '*' );
     } else {
-        rc = dump_quality_33( opts, q, q_len, false ); /* sam-dump-opts.c */
+        rc = sam_line_qual( line, q, q_len, false ); /* sam_line.c */
+    }
+    return rc;
+}
+
+/* SAM-FIELD: QNAME of the evidence-alignments */
+static rc_t print_cg_qname( struct sam_line * line,
+                            const samdump_opts * const opts,
+                            const char * spot_group,
+                            uint32_t spot_group_len,
+                            const char * seq_name,
+                            uint32_t seq_name_len,
+                            int64_t allele_id,
+                            uint32_t ploidy_idx ) {
+    rc_t rc = 0;
+    if ( opts -> print_cg_names ) {
+        if ( spot_group_len > 0 ) {
+            /* constructed from spot-group/seq-name */
+            rc = sam_line_str( line, spot_group, spot_group_len );
+            if ( rc == 0 ) { rc = sam_line_str( line, "-1:", 3 ); }
+            if ( rc == 0 ) { rc = sam_line_str_tab( line, seq_name, seq_name_len ); }
+        }
+    } else {
+        if ( seq_name_len > 0 ) {
+            /* constructed from allel-id/sub-id */
+            rc = sam_line_str( line, seq_name, seq_name_len );
+            if ( rc == 0 ) { rc = sam_line_str( line, "/ALLELE_", 8 ); }
+            if ( rc == 0 ) { rc = sam_line_i64( line, allele_id ); }
+            if ( rc == 0 ) { rc = sam_line_char( line, '.' ); }
+            if ( rc == 0 ) { rc = sam_line_u64_tab( line, ploidy_idx ); }
+        }
+    }
+    return rc;
+}
+
+/* the optional fields of the evidence-alignments, after RG */
+static rc_t print_cg_opt_fields( struct sam_line * line,
+                                 const samdump_opts * const opts,
+                                 const align_table_context * const atx,
+                                 const cg_cigar_output * cgc_output,
+                                 int64_t align_id ) {
+    rc_t rc = 0;
+    /* OPT SAM-FIELD: NH     SRA-column: ALIGNMENT_COUNT */
+    if ( atx -> eval . al_count_idx != COL_NOT_AVAILABLE ) {
+        const uint8_t * al_count;
+        uint32_t al_count_len;
+        rc = read_uint8_ptr( align_id, atx -> eval . cursor, atx -> eval . al_count_idx,
+                             &al_count, &al_count_len, "ALIGNMENT_COUNT" );
+        if ( rc == 0 && al_count_len > 0 ) {
+            rc = sam_line_tag_i( line, "NH", *al_count );
+        }
+    }
+    /* OPT SAM-FIELD: NM     SRA-column: EDIT_DISTANCE */
+    if ( rc == 0 ) {
+        rc = sam_line_tag_i( line, "NM", ( uint32_t )cgc_output -> edit_dist );
+    }
+    /* OPT SAM-FIELD: XI     SRA-column: ALIGN_ID */
+    if ( rc == 0 && opts -> print_alignment_id_in_column_xi ) {
+        rc = sam_line_tag_i( line, "XI", ( uint32_t )align_id );
+    }
+    if ( rc == 0 ) {
+        rc = sam_line_end( line );
     }
     return rc;
 }
 
 /* triggered by option "--CG-SAM" */
 static rc_t print_evidence_alignment_cg_sam( const samdump_opts * const opts,
+                                             struct sam_line * line,
                                              const PlacementRecord * const rec,
                                              const align_table_context * const atx,
                                              int64_t align_id,
@@ -941,17 +1043,8 @@ static rc_t print_evidence_alignment_cg_sam( const samdump_opts * const opts,
                             &spot_group, &spot_group_len, "SEQ_SPOT_GROUP" );
     }
     if ( rc == 0 ) {
-        if ( opts -> print_cg_names ) {
-            if ( spot_group_len > 0 ) {
-                /* SAM-FIELD: QNAME     constructed from spot-group/seq-name */
-                rc = KOutMsg( "%.*s-1:%.*s\t", spot_group_len, spot_group, seq_name_len, seq_name );
-            }
-        } else {
-            if ( seq_name_len > 0 ) {
-                /* SAM-FIELD: QNAME     constructed from allel-id/sub-id */
-                rc = KOutMsg( "%.*s/ALLELE_%li.%u\t", seq_name_len, seq_name, rec -> id, ploidy_idx );
-            }
-        }
+        rc = print_cg_qname( line, opts, spot_group, spot_group_len,
+                             seq_name, seq_name_len, rec -> id, ploidy_idx ); /* above */
     }
     if ( rc == 0 ) {
         rc = read_INSDC_coord_zero( align_id, cursor, atx -> ref_pos_idx, &ref_pos, 0, "REF_POS" );
@@ -974,7 +1067,10 @@ static rc_t print_evidence_alignment_cg_sam( const samdump_opts * const opts,
     /* SAM-FIELD: POS       SRA-column: REF_POS + 1 */
     /* SAM-FIELD: MAPQ      SRA-column: MAPQ ( from evidence-alignment-table, not from allel! ) */
     if ( rc == 0 ) {
-        rc = KOutMsg( "%u\t%s\t%i\t%d\t", sam_flags, ref_name, allele_pos + ref_pos + 1, mapq );
+        rc = sam_line_u64_tab( line, sam_flags );
+        if ( rc == 0 ) { rc = sam_line_str_tab( line, ref_name, string_size( ref_name ) ); }
+        if ( rc == 0 ) { rc = sam_line_i64_tab( line, allele_pos + ref_pos + 1 ); }
+        if ( rc == 0 ) { rc = sam_line_i64_tab( line, mapq ); }
     }
     /* get READ, QUALITY and EIDT_DIST before cigar manipulation because we need/change these values */
     if ( rc == 0 ) {
@@ -989,7 +1085,7 @@ static rc_t print_evidence_alignment_cg_sam( const samdump_opts * const opts,
             rc = cg_cigar_treatments( opts -> cigar_treatment, &cgc_input, &cgc_output, align_id, &( atx -> eval ) );
         }
         if ( rc == 0 ) {
-            rc = modify_and_print_cigar( cgc_output . p_cigar . ptr, cgc_output . p_cigar . len,
+            rc = modify_and_print_cigar( line, cgc_output . p_cigar . ptr, cgc_output . p_cigar . len,
                                          atx -> cig_op_buffer, ref_cig_len, ref_pos, cgc_output . p_read . len );
         }
     }
@@ -998,51 +1094,38 @@ static rc_t print_evidence_alignment_cg_sam( const samdump_opts * const opts,
     /* SAM-FIELD: TLEN      SRA-column: TEMPLATE_LEN '0' not in table */
     /* SAM-FIELD: SEQ       SRA-column: READ  */
     if ( rc == 0 ) {
-        rc = KOutMsg( "*\t0\t0\t%.*s\t", cgc_output . p_read . len, cgc_output . p_read . ptr );
+        rc = sam_line_str( line, "*\t0\t0\t", 6 );
+        if ( rc == 0 ) { rc = sam_line_str_tab( line, cgc_output . p_read . ptr, cgc_output . p_read . len ); }
     }
     /* SAM-FIELD: QUAL      SRA-column: SAM_QUALITY */
     if ( rc == 0 ) {
-        rc = print_quality_or_star( opts, cgc_output . p_quality . ptr,
+        rc = print_quality_or_star( line, cgc_output . p_quality . ptr,
                                     cgc_output . p_quality . len, cgc_output . p_read.len ); /* above */
     }
     /* OPT SAM-FIELD: RG     SRA-column: SEQ_SPOT_GROUP */
     if ( rc == 0 && spot_group_len > 0 ) {
-        rc = KOutMsg( "\tRG:Z:%.*s", spot_group_len, spot_group );
+        rc = sam_line_tag_Z( line, "RG", spot_group, spot_group_len );
     }
     if ( rc == 0 && cgc_output . p_tags . len > 0 ) {
-        rc = KOutMsg( "\t%.*s", cgc_output . p_tags . len, cgc_output . p_tags . ptr );
+        rc = sam_line_char( line, '\t' );
+        if ( rc == 0 ) { rc = sam_line_str( line, cgc_output . p_tags . ptr, cgc_output . p_tags . len ); }
     }
     /* OPT SAM-FIELD: ZI     SRA-column: rec -> id */
     /* OPT SAM-FIELD: ZA     SRA-column: ploidy_idx */
     if ( rc == 0 ) {
-        rc = KOutMsg( "\tZI:i:%li\tZA:i:%u", rec -> id, ploidy_idx );
-    }
-    /* OPT SAM-FIELD: NH     SRA-column: ALIGNMENT_COUNT */
-    if ( rc == 0 && atx -> eval . al_count_idx != COL_NOT_AVAILABLE ) {
-        const uint8_t * al_count;
-        uint32_t al_count_len;
-        rc = read_uint8_ptr( align_id, cursor, atx -> eval . al_count_idx,
-                             &al_count, &al_count_len, "ALIGNMENT_COUNT" );
-        if ( rc == 0 && al_count_len > 0 ) {
-            rc = KOutMsg( "\tNH:i:%u", *al_count );
-        }
-    }
-    /* OPT SAM-FIELD: NM     SRA-column: EDIT_DISTANCE */
-    if ( rc == 0 ) {
-        rc = KOutMsg( "\tNM:i:%u", cgc_output . edit_dist );
-    }
-    /* OPT SAM-FIELD: XI     SRA-column: ALIGN_ID */
-    if ( rc == 0 && opts -> print_alignment_id_in_column_xi ) {
-        rc = KOutMsg( "\tXI:i:%u", align_id );
+        rc = sam_line_tag_i( line, "ZI", rec -> id );
+        if ( rc == 0 ) { rc = sam_line_tag_i( line, "ZA", ploidy_idx ); }
     }
+    /* OPT SAM-FIELDS: NH, NM, XI */
     if ( rc == 0 ) {
-        rc = KOutMsg( "\n" );
+        rc = print_cg_opt_fields( line, opts, atx, &cgc_output, align_id ); /* above */
     }
     return rc;
 }
 
 /*  triggered by option --CG-evidence-dnb */
 static rc_t print_evidence_alignment_cg_ev_dnb( const samdump_opts * const opts,
+                                                struct sam_line * line,
                                                 const PlacementRecord * const rec,
                                                 const align_table_context * const atx,
                                                 int64_t align_id,
@@ -1060,17 +1143,8 @@ static rc_t print_evidence_alignment_cg_ev_dnb( const samdump_opts * const opts,
                             &spot_group, &spot_group_len, "SEQ_SPOT_GROUP" );
     }
     if ( rc == 0 ) {
-        if ( opts -> print_cg_names ) {
-            if ( spot_group_len > 0 ) {
-                /* SAM-FIELD: QNAME     constructed from spot-group/seq-name */
-                rc = KOutMsg( "%.*s-1:%.*s\t", spot_group_len, spot_group, seq_name_len, seq_name );
-            }
-        } else {
-            if ( seq_name_len > 0 ) {
-                /* SAM-FIELD: QNAME     constructed from allel-id/sub-id */
-                rc = KOutMsg( "%.*s/ALLELE_%li.%u\t", seq_name_len, seq_name, rec -> id, ploidy_idx );
-            }
-        }
+        rc = print_cg_qname( line, opts, spot_group, spot_group_len,
+                             seq_name, seq_name_len, rec -> id, ploidy_idx ); /* above */
     }
     if ( rc == 0 ) {
         rc = read_INSDC_coord_zero( align_id, cursor, atx -> ref_pos_idx, &ref_pos, 0, "REF_POS" );
@@ -1093,7 +1167,13 @@ static rc_t print_evidence_alignment_cg_ev_dnb( const samdump_opts * const opts,
     /* SAM-FIELD: POS       SRA-column: REF_POS + 1 */
     /* SAM-FIELD: MAPQ      SRA-column: MAPQ ( from evidence-alignment-table, not from allel! ) */
     if ( rc == 0 ) {
-        rc = KOutMsg( "%u\tALLELE_%li.%u\t%i\t%d\t", sam_flags, rec -> id, ploidy_idx, ref_pos + 1, mapq );
+        rc = sam_line_u64_tab( line, sam_flags );
+        if ( rc == 0 ) { rc = sam_line_str( line, "ALLELE_", 7 ); }
+        if ( rc == 0 ) { rc = sam_line_i64( line, rec -> id ); }
+        if ( rc == 0 ) { rc = sam_line_char( line, '.' ); }
+        if ( rc == 0 ) { rc = sam_line_u64_tab( line, ploidy_idx ); }
+        if ( rc == 0 ) { rc = sam_line_i64_tab( line, ref_pos + 1 ); }
+        if ( rc == 0 ) { rc = sam_line_i64_tab( line, mapq ); }
     }
     /* get READ, QUALITY and EIDT_DIST before cigar manipulation because we need/change these values */
     if ( rc == 0 ) {
@@ -1107,48 +1187,38 @@ static rc_t print_evidence_alignment_cg_ev_dnb( const samdump_opts * const opts,
         if ( rc == 0 ) {
             rc = cg_cigar_treatments( opts -> cigar_treatment, &cgc_input, &cgc_output, align_id, &( atx -> eval ) );
         }
+        /* cg_canonical_print_cigar() prints with KOutMsg() */
+        if ( rc == 0 ) {
+            rc = sam_line_flush( line ); /* sam_line.c */
+        }
         if ( rc == 0 ) {
             rc = cg_canonical_print_cigar( cgc_output . p_cigar . ptr, cgc_output . p_cigar . len );
         }
-        if ( rc == 0 ) { rc = KOutMsg( "\t"); }
+        if ( rc == 0 ) { rc = sam_line_char( line, '\t' ); }
     }
     /* SAM-FIELD: RNEXT     SRA-column: MATE_REF_NAME '*' no mates! */
     /* SAM-FIELD: PNEXT     SRA-column: MATE_REF_POS + 1 '0' no mates */
     /* SAM-FIELD: TLEN      SRA-column: TEMPLATE_LEN '0' not in table */
     /* SAM-FIELD: SEQ       SRA-column: READ  */
     if ( rc == 0 ) {
-        rc = KOutMsg( "*\t0\t0\t%.*s\t", cgc_output.p_read.len, cgc_output.p_read.ptr );
+        rc = sam_line_str( line, "*\t0\t0\t", 6 );
+        if ( rc == 0 ) { rc = sam_line_str_tab( line, cgc_output.p_read.ptr, cgc_output.p_read.len ); }
     }
     /* SAM-FIELD: QUAL      SRA-column: SAM_QUALITY */
     if ( rc == 0 ) {
-        rc = print_quality_or_star( opts, cgc_output.p_quality.ptr, cgc_output.p_quality.len, cgc_output.p_read.len ); /* above */
+        rc = print_quality_or_star( line, cgc_output.p_quality.ptr, cgc_output.p_quality.len, cgc_output.p_read.len ); /* above */
     }
     /* OPT SAM-FIELD: RG     SRA-column: SEQ_SPOT_GROUP */
     if ( rc == 0 && spot_group_len > 0 ) {
-        rc = KOutMsg( "\tRG:Z:%.*s", spot_group_len, spot_group );
+        rc = sam_line_tag_Z( line, "RG", spot_group, spot_group_len );
     }
     if ( rc == 0 && cgc_output.p_tags.len > 0 ) {
-        rc = KOutMsg( "\t%.*s", cgc_output.p_tags.len, cgc_output.p_tags.ptr );
-    }
-    /* OPT SAM-FIELD: NH     SRA-column: ALIGNMENT_COUNT */
-    if ( rc == 0 && atx -> eval . al_count_idx != COL_NOT_AVAILABLE ) {
-        const uint8_t * al_count;
-        uint32_t al_count_len;
-        rc = read_uint8_ptr( align_id, cursor, atx -> eval . al_count_idx, &al_count, &al_count_len, "ALIGNMENT_COUNT" );
-        if ( rc == 0 && al_count_len > 0 ) {
-            rc = KOutMsg( "\tNH:i:%u", *al_count );
-        }
+        rc = sam_line_char( line, '\t' );
+        if ( rc == 0 ) { rc = sam_line_str( line, cgc_output.p_tags.ptr, cgc_output.p_tags.len ); }
     }
-    /* OPT SAM-FIELD: NM     SRA-column: EDIT_DISTANCE */
+    /* OPT SAM-FIELDS: NH, NM, XI */
     if ( rc == 0 ) {
-        rc = KOutMsg( "\tNM:i:%u", cgc_output.edit_dist );
-    }
-    /* OPT SAM-FIELD: XI     SRA-column: ALIGN_ID */
-    if ( rc == 0 && opts -> print_alignment_id_in_column_xi ) {
-        rc = KOutMsg( "\tXI:i:%u", align_id );
-    }
-    if ( rc == 0 ) {
-        rc = KOutMsg( "\n" );
+        rc = print_cg_opt_fields( line, opts, atx, &cgc_output, align_id ); /* above */
     }
     return rc;
 }
@@ -1161,6 +1231,7 @@ static rc_t print_alignment_sam_ev( const sam_dump_ctx * sam_ctx,
                                     const PlacementRecord * const rec,
                                     align_table_context * const atx ) {
     const samdump_opts * opts = sam_ctx -> opts;
+    struct sam_line * line = sam_ctx -> line;
     const VCursor * cursor = atx -> cmn . cursor;
     uint32_t ploidy;
     rc_t rc = read_uint32( rec -> id, cursor, atx -> ploidy_idx, &ploidy, 0, "PLOIDY" );
@@ -1214,47 +1285,55 @@ static rc_t print_alignment_sam_ev( const sam_dump_ctx * sam_ctx,
                 /* SAM-FIELD: MAPQ      SRA-column: MAPQ */
                 if ( rc == 0 ) {
                     if ( opts -> print_cg_names ) {
-                        rc = KOutMsg( "-1:0\t" );
+                        rc = sam_line_str( line, "-1:0\t", 5 );
                     } else {
-                        rc = KOutMsg( "ALLELE_%li.%u\t", rec -> id, ploidy_idx + 1 );
+                        rc = sam_line_str( line, "ALLELE_", 7 );
+                        if ( rc == 0 ) { rc = sam_line_i64( line, rec -> id ); }
+                        if ( rc == 0 ) { rc = sam_line_char( line, '.' ); }
+                        if ( rc == 0 ) { rc = sam_line_u64_tab( line, ploidy_idx + 1 ); }
                     }
                 }
                 if ( rc == 0 ) {
-                    rc = KOutMsg( "0\t%s\t%u\t%d\t", ref_name, pos + 1, rec -> mapq );
+                    rc = sam_line_str( line, "0\t", 2 );
+                    if ( rc == 0 ) { rc = sam_line_str_tab( line, ref_name, string_size( ref_name ) ); }
+                    if ( rc == 0 ) { rc = sam_line_u64_tab( line, ( uint32_t )( pos + 1 ) ); }
+                    if ( rc == 0 ) { rc = sam_line_i64_tab( line, rec -> mapq ); }
                 }
                 /* SAM-FIELD: CIGAR     SRA-column: CIGAR_SHORT / CIGAR_LONG sliced!!! */
                 if ( rc == 0 ) {
-                    rc = KOutMsg( "%.*s\t", cigar_slice_len, transformed_cigar );
+                    rc = sam_line_str_tab( line, transformed_cigar, cigar_slice_len );
                 }
                 /* SAM-FIELD: RNEXT     SRA-column: MATE_REF_NAME ( !!! row_len can be zero !!! ) */
                 /* SAM-FIELD: PNEXT     SRA-column: MATE_REF_POS + 1 ( !!! row_len can be zero !!! ) */
                 /* SAM-FIELD: TLEN      SRA-column: TEMPLATE_LEN ( !!! row_len can be zero !!! ) */
                 /* SAM-FIELD: SEQ       SRA-column: READ sliced!!! */
                 if ( rc == 0 ) {
-                    rc = KOutMsg( "*\t0\t0\t%.*s\t", read_slice_len, read );
+                    rc = sam_line_str( line, "*\t0\t0\t", 6 );
+                    if ( rc == 0 ) { rc = sam_line_str_tab( line, read, read_slice_len ); }
                 }
                 /* SAM-FIELD: QUAL      SRA-column: SAM_QUALITY sliced!!! */
                 if ( rc == 0 ) {
                     if ( quality_str_len == read_slice_len )
-                        rc = print_qslice( opts, false, quality, quality_str_len, &quality_offset,
+                        rc = print_qslice( line, false, quality, quality_str_len, &quality_offset,
                                            read_len_vector, read_len_vector_len, ploidy_idx );
                     else
-                        rc = KOutMsg( "*" );
+                        rc = sam_line_char( line, '*' );
                 }
                 /* OPT SAM-FIELD: RG     SRA-column: ploidy_idx */
                 if ( rc == 0 ) {
-                    rc = KOutMsg( "\tRG:Z:ALLELE_%u", ploidy_idx + 1 );
+                    rc = sam_line_str( line, "\tRG:Z:ALLELE_", 13 );
+                    if ( rc == 0 ) { rc = sam_line_u64( line, ploidy_idx + 1 ); }
                 }
                 /* OPT SAM-FIELD: XI     SRA-column: ALIGN_ID */
                 if ( rc == 0 && opts -> print_alignment_id_in_column_xi ) {
-                    rc = KOutMsg( "\tXI:i:%u", rec -> id );
+                    rc = sam_line_tag_i( line, "XI", ( uint32_t )rec -> id );
                 }
                 /* OPT SAM-FIELD: NM     SRA-column: EDIT_DISTANCE sliced!!! */
                 if ( rc == 0 && ( ploidy_idx < edit_dist_vector_len ) ) {
-                    rc = KOutMsg( "\tNM:i:%u", edit_dist_vector[ ploidy_idx ] );
+                    rc = sam_line_tag_i( line, "NM", edit_dist_vector[ ploidy_idx ] );
                 }
                 if ( rc == 0 ) {
-                    rc = KOutMsg( "\n" );
+                    rc = sam_line_end( line );
                 }
             }
             /* we do that here per ALLEL-READ, not at the end per ALLEL, because we have to test which alignments
@@ -1275,12 +1354,12 @@ static rc_t print_alignment_sam_ev( const sam_dump_ctx * sam_ctx,
                             if ( rc == 0 ) {
                                 int32_t ref_cig_len = ExplodeCIGAR( atx -> cig_op_buffer, atx -> cig_op_buffer_len,
                                                                     cigar, cigar_slice_len );
-                                rc = print_evidence_alignment_cg_sam( opts, rec, atx, align_id, ploidy_idx + 1,
+                                rc = print_evidence_alignment_cg_sam( opts, line, rec, atx, align_id, ploidy_idx + 1,
                                                                       ref_name, pos, ref_cig_len );
                             }
                         }
                         if ( rc == 0 && opts -> dump_cg_ev_dnb ) {
-                            rc = print_evidence_alignment_cg_ev_dnb( opts, rec, atx, align_id, ploidy_idx + 1 );
+                            rc = print_evidence_alignment_cg_ev_dnb( opts, line, rec, atx, align_id, ploidy_idx + 1 );
                         }
                     }
                 }
@@ -1295,17 +1374,23 @@ static rc_t print_alignment_sam_ev( const sam_dump_ctx * sam_ctx,
     return rc;
 }
 
-static rc_t opt_field_spot_group( const VCursor * cursor, uint32_t col_id, int64_t row_id ) {
+static rc_t opt_field_spot_group( struct bam_writer * bam, struct sam_line * line,
+                                  const VCursor * cursor, uint32_t col_id, int64_t row_id ) {
     const char * value = NULL;
     uint32_t len;    
     rc_t rc = read_char_ptr( row_id, cursor, col_id, &value, &len, "SPOT_GROUP" );
     if ( rc == 0 && len > 0 ) {
-        rc = KOutMsg( "\tRG:Z:%.*s", len, value );
+        if ( bam != NULL ) {
+            rc = bam_writer_tag_Z( bam, "RG", value, len ); /* bam_writer.c */
+        } else {
+            rc = sam_line_tag_Z( line, "RG", value, len ); /* sam_line.c */
+        }
     }
     return rc;
 }
 
-static rc_t opt_field_lnk_group( const VCursor * cursor, uint32_t col_id, int64_t row_id ) {
+static rc_t opt_field_lnk_group( struct bam_writer * bam, struct sam_line * line,
+                                 const VCursor * cursor, uint32_t col_id, int64_t row_id ) {
     const char * value = NULL;
     uint32_t len;    
     rc_t rc = read_char_ptr( row_id, cursor, col_id, &value, &len, "LINKAGE_GROUP" );
@@ -1344,10 +1429,22 @@ static rc_t opt_field_lnk_group( const VCursor * cursor, uint32_t col_id, int64_
             }
         }
 
-        if ( CB.addr == NULL && UB.addr == NULL ) {
-            rc = KOutMsg( "\tBX:Z:%.*s", len, value );
+        if ( bam != NULL ) {
+            if ( CB.addr == NULL && UB.addr == NULL ) {
+                rc = bam_writer_tag_Z( bam, "BX", value, len );
+            } else {
+                rc = bam_writer_tag_Z( bam, "CB", CB.addr, CB.size );
+                if ( rc == 0 ) {
+                    rc = bam_writer_tag_Z( bam, "UB", UB.addr, UB.size );
+                }
+            }
+        } else if ( CB.addr == NULL && UB.addr == NULL ) {
+            rc = sam_line_tag_Z( line, "BX", value, len );
         } else {
-            rc = KOutMsg( "\tCB:Z:%S\tUB:Z:%S", &CB, &UB );
+            rc = sam_line_tag_Z( line, "CB", CB.addr, CB.size );
+            if ( rc == 0 ) {
+                rc = sam_line_tag_Z( line, "UB", UB.addr, UB.size );
+            }
         }
     }
     return rc;
@@ -1371,6 +1468,13 @@ static rc_t print_alignment_sam_ps( const sam_dump_ctx * sam_ctx,
     cg_cigar_output cgc_output;
     rna_splice_candidates candidates; /* in cg_tools.h */
     bool rna_not_homogeneous_flag = false;
+    char * temp_cigar = NULL;
+    /* the BAM-record is built from the columns, except with the MD-tag: that one is
+       only printed as text, the BAM-writer converts the whole line then */
+    struct bam_writer * bam = opts -> with_md_flag ? NULL : sam_ctx -> bam;
+    struct sam_line * line = sam_ctx -> line;
+    bam_record b_rec;
+    char qname[ 256 ];
 
     /* SAM-FIELD: NONE      SRA-column: MATE_ALIGN_ID ( int64 ) ... for cache lookup's */
     rc_t rc = read_int64( id, cursor, atx -> mate_align_id_idx, &mate_align_id, 0, "MATE_ALIGN_ID" );
@@ -1472,23 +1576,33 @@ static rc_t print_alignment_sam_ps( const sam_dump_ctx * sam_ctx,
     }
     /* SAM-FIELD: QNAME     SRA-column: SEQ_SPOT_ID ( int64 ) */
     if ( rc == 0 ) {
-        if ( seq_spot_id_len > 0 ) {
-            if ( opts -> print_spot_group_in_name | opts -> print_cg_names ) {
-                const char * spot_group;
-                uint32_t spot_group_len;
-                rc = read_char_ptr( id, cursor, atx -> cmn . seq_spot_group_idx, &spot_group, &spot_group_len, "SPOT_GROUP" );
-                if ( rc == 0 ) {
-                    rc = dump_name( opts, *seq_spot_id, spot_group, spot_group_len ); /* sam-dump-opts.c */
+        const char * spot_group = NULL;
+        uint32_t spot_group_len = 0;
+        if ( seq_spot_id_len > 0 && ( opts -> print_spot_group_in_name | opts -> print_cg_names ) ) {
+            rc = read_char_ptr( id, cursor, atx -> cmn . seq_spot_group_idx, &spot_group, &spot_group_len, "SPOT_GROUP" );
+        }
+        if ( rc == 0 ) {
+            if ( bam != NULL ) {
+                memset( &b_rec, 0, sizeof b_rec );
+                if ( seq_spot_id_len > 0 ) {
+                    size_t qname_len;
+                    rc = make_name( opts, qname, sizeof qname, &qname_len,
+                                    *seq_spot_id, spot_group, spot_group_len ); /* sam-dump-opts.c */
+                    b_rec . qname = qname;
+                    b_rec . qname_len = ( uint32_t )qname_len;
+                } else {
+                    b_rec . qname = "*";
+                    b_rec . qname_len = 1;
                 }
+            } else if ( seq_spot_id_len > 0 ) {
+                rc = sam_line_name( line, *seq_spot_id, spot_group, spot_group_len ); /* sam_line.c */
             } else {
-                rc = dump_name( opts, *seq_spot_id, NULL, 0 ); /* sam-dump-opts.c */
+                rc = sam_line_char( line, '*' );
             }
-        } else {
-            rc = KOutMsg( "*" );
         }
     }
-    if ( rc == 0 ) {
-        rc = KOutMsg( "\t" );
+    if ( rc == 0 && bam == NULL ) {
+        rc = sam_line_char( line, '\t' );
     }
     /* massage the sam-flag if we are not dumping unaligned reads... */
     if ( !opts -> dump_unaligned_reads  /** not going to dump unaligned **/
@@ -1503,7 +1617,17 @@ static rc_t print_alignment_sam_ps( const sam_dump_ctx * sam_ctx,
     /* SAM-FIELD: POS       SRA-column: REF_POS + 1 */
     /* SAM-FIELD: MAPQ      SRA-column: MAPQ */
     if ( rc == 0 ) {
-        rc = KOutMsg( "%u\t%s\t%u\t%d\t", sam_flags, ref_name, pos + 1, rec -> mapq );
+        if ( bam != NULL ) {
+            b_rec . flag = sam_flags;
+            b_rec . pos = pos;
+            b_rec . mapq = rec -> mapq;
+            rc = bam_writer_ref_id( bam, ref_name, string_size( ref_name ), &( b_rec . ref_id ) ); /* bam_writer.c */
+        } else {
+            rc = sam_line_u64_tab( line, sam_flags );
+            if ( rc == 0 ) { rc = sam_line_str_tab( line, ref_name, string_size( ref_name ) ); }
+            if ( rc == 0 ) { rc = sam_line_u64_tab( line, ( uint32_t )( pos + 1 ) ); }
+            if ( rc == 0 ) { rc = sam_line_i64_tab( line, rec -> mapq ); }
+        }
     }
     /* get READ, QUALITY and EIDT_DIST before cigar manipulation because we need/change these values */
     if ( rc == 0 ) {
@@ -1512,7 +1636,6 @@ static rc_t print_alignment_sam_ps( const sam_dump_ctx * sam_ctx,
     /* SAM-FIELD: CIGAR     SRA-column: CIGAR_SHORT / with or without treatment */
     if ( rc == 0 ) {
         cg_cigar_input cgc_input;
-        char * temp_cigar = NULL;
         static char const *bogus_quality = "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!";
 
         rc = read_char_ptr( id, cursor, atx -> cmn . cigar_idx, &( cgc_input . p_cigar . ptr ),
@@ -1583,47 +1706,88 @@ static rc_t print_alignment_sam_ps( const sam_dump_ctx * sam_ctx,
             }
         }
         if ( rc == 0 ) {
-            rc = KOutMsg( "%.*s\t", cgc_output . p_cigar . len, cgc_output . p_cigar . ptr );
+            if ( bam != NULL ) {
+                b_rec . cigar = cgc_output . p_cigar . ptr;
+                b_rec . cigar_len = cgc_output . p_cigar . len;
+            } else {
+                rc = sam_line_str_tab( line, cgc_output . p_cigar . ptr, cgc_output . p_cigar . len );
+            }
         }
-        if ( temp_cigar != NULL ) { free( temp_cigar ); }
     }
     /* SAM-FIELD: RNEXT     SRA-column: MATE_REF_NAME ( !!! row_len can be zero !!! ) */
     /* SAM-FIELD: PNEXT     SRA-column: MATE_REF_POS + 1 ( !!! row_len can be zero !!! ) */
     /* SAM-FIELD: TLEN      SRA-column: TEMPLATE_LEN ( !!! row_len can be zero !!! ) */
-    if ( rc == 0 ) {
+    if ( rc == 0 && bam != NULL ) {
+        b_rec . tlen = tlen;
+        if ( mate_ref_name_len > 0 ) {
+            b_rec . next_pos = mate_ref_pos;
+            if ( mate_ref_name == equal_sign ) {
+                b_rec . next_ref_id = b_rec . ref_id;
+            } else {
+                rc = bam_writer_ref_id( bam, mate_ref_name, mate_ref_name_len, &( b_rec . next_ref_id ) );
+            }
+        } else {
+            b_rec . next_ref_id = -1;
+            b_rec . next_pos = ( mate_ref_pos_len == 0 ) ? -1 : mate_ref_pos - 1;
+        }
+    } else if ( rc == 0 ) {
         if ( mate_ref_name_len > 0 ) {
-            rc = KOutMsg( "%.*s\t%u\t%d\t", mate_ref_name_len, mate_ref_name, mate_ref_pos + 1, tlen );
+            rc = sam_line_str_tab( line, mate_ref_name, mate_ref_name_len );
+            if ( rc == 0 ) { rc = sam_line_u64_tab( line, ( uint32_t )( mate_ref_pos + 1 ) ); }
         } else {
             if ( mate_ref_pos_len == 0 ) {
-                rc = KOutMsg( "*\t0\t%d\t", tlen );
+                rc = sam_line_str( line, "*\t0\t", 4 );
             } else {
-                rc = KOutMsg( "*\t%u\t%d\t", mate_ref_pos, tlen );
+                rc = sam_line_str( line, "*\t", 2 );
+                if ( rc == 0 ) { rc = sam_line_u64_tab( line, ( uint32_t )mate_ref_pos ); }
             }
         }
+        if ( rc == 0 ) {
+            rc = sam_line_i64_tab( line, ( int32_t )tlen );
+        }
     }
     /* SAM-FIELD: SEQ       SRA-column: READ */
-    if ( rc == 0 ) {
-        rc = KOutMsg( "%.*s\t", cgc_output . p_read . len, cgc_output . p_read . ptr );
-    }
     /* SAM-FIELD: QUAL      SRA-column: SAM_QUALITY */
-    if ( rc == 0 ) {
-        rc = print_quality_or_star( opts, cgc_output . p_quality . ptr, cgc_output . p_quality . len,
-                                    cgc_output . p_read . len ); /* above */    
+    if ( rc == 0 && bam != NULL ) {
+        b_rec . seq = cgc_output . p_read . ptr;
+        b_rec . seq_len = cgc_output . p_read . len;
+        if ( !is_star_quality( cgc_output . p_quality . ptr, cgc_output . p_quality . len,
+                               cgc_output . p_read . len ) ) {
+            b_rec . qual = cgc_output . p_quality . ptr;   /* quantized by the BAM-writer */
+        }
+        rc = bam_writer_begin( bam, &b_rec ); /* bam_writer.c */
+    } else {
+        if ( rc == 0 ) {
+            rc = sam_line_str_tab( line, cgc_output . p_read . ptr, cgc_output . p_read . len );
+        }
+        if ( rc == 0 ) {
+            rc = print_quality_or_star( line, cgc_output . p_quality . ptr, cgc_output . p_quality . len,
+                                        cgc_output . p_read . len ); /* above */    
+        }
     }
     /* OPT SAM-FIELD: RG     SRA-column: SPOT_GROUP */
     if ( rc == 0 && ( atx -> cmn . seq_spot_group_idx != COL_NOT_AVAILABLE ) ) {
-        rc = opt_field_spot_group( cursor, atx -> cmn . seq_spot_group_idx, id );
+        rc = opt_field_spot_group( bam, line, cursor, atx -> cmn . seq_spot_group_idx, id );
     }
     /* OPT SAM-FIELD: BZ     SRA-column: LINKAGE_GROUP */
     if ( rc == 0 && ( atx -> lnk_group_idx != COL_NOT_AVAILABLE ) ) {
-        rc = opt_field_lnk_group( cursor, atx -> lnk_group_idx, id );
+        rc = opt_field_lnk_group( bam, line, cursor, atx -> lnk_group_idx, id );
     }
     if ( rc == 0 && cgc_output . p_tags . len > 0 ) {
-        rc = KOutMsg( "\t%.*s", cgc_output . p_tags . len, cgc_output . p_tags . ptr );
+        if ( bam != NULL ) {
+            rc = bam_writer_tags( bam, cgc_output . p_tags . ptr, cgc_output . p_tags . len );
+        } else {
+            rc = sam_line_char( line, '\t' );
+            if ( rc == 0 ) { rc = sam_line_str( line, cgc_output . p_tags . ptr, cgc_output . p_tags . len ); }
+        }
     }
     /* OPT SAM-FIELD: XI     SRA-column: ALIGN_ID */
     if ( rc == 0 && opts -> print_alignment_id_in_column_xi ) {
-        rc = KOutMsg( "\tXI:i:%u", id );
+        if ( bam != NULL ) {
+            rc = bam_writer_tag_i( bam, "XI", ( uint32_t )id );
+        } else {
+            rc = sam_line_tag_i( line, "XI", ( uint32_t )id );
+        }
     }
     /* to match sam-tools output: in case we are dumping this in CG-mode.... */
     if ( rc == 0 &&
@@ -1636,7 +1800,20 @@ static rc_t print_alignment_sam_ps( const sam_dump_ctx * sam_ctx,
             uint32_t i;
             for ( i = 0; rc == 0 && i < align_grp_len - 1; ++i ) {
                 if ( align_grp[ i ] == '_' ) {
-                    rc = KOutMsg( "\tZI:i:%.*s\tZA:i:%.1s", i, align_grp, align_grp + i + 1 );
+                    if ( bam != NULL ) {
+                        char tags[ 128 ];
+                        size_t tags_len;
+                        rc = string_printf( tags, sizeof tags, &tags_len, "ZI:i:%.*s\tZA:i:%.1s",
+                                            i, align_grp, align_grp + i + 1 );
+                        if ( rc == 0 ) {
+                            rc = bam_writer_tags( bam, tags, tags_len );
+                        }
+                    } else {
+                        rc = sam_line_str( line, "\tZI:i:", 6 );
+                        if ( rc == 0 ) { rc = sam_line_str( line, align_grp, i ); }
+                        if ( rc == 0 ) { rc = sam_line_str( line, "\tZA:i:", 6 ); }
+                        if ( rc == 0 ) { rc = sam_line_char( line, align_grp[ i + 1 ] ); }
+                    }
                     break;
                 }
             }
@@ -1648,22 +1825,31 @@ static rc_t print_alignment_sam_ps( const sam_dump_ctx * sam_ctx,
         uint32_t al_count_len;
         rc = read_uint8_ptr( id, cursor, atx -> cmn . al_count_idx, &al_count, &al_count_len, "ALIGNMENT_COUNT" );
         if ( rc == 0 && al_count_len > 0 ) {
-            rc = KOutMsg( "\tNH:i:%u", *al_count );
+            if ( bam != NULL ) {
+                rc = bam_writer_tag_i( bam, "NH", *al_count );
+            } else {
+                rc = sam_line_tag_i( line, "NH", *al_count );
+            }
         }
     }
     /* OPT SAM-FIELD: NM     SRA-column: EDIT_DISTANCE */
     if ( rc == 0 ) {
-        rc = KOutMsg( "\tNM:i:%u", ( cgc_output . edit_dist - NM_adjustments ) );
+        if ( bam != NULL ) {
+            rc = bam_writer_tag_i( bam, "NM", ( uint32_t )( cgc_output . edit_dist - NM_adjustments ) );
+        } else {
+            rc = sam_line_tag_i( line, "NM", ( uint32_t )( cgc_output . edit_dist - NM_adjustments ) );
+        }
     }
     /* OPT SAM-FIELD: XS:A:+/-  SRA-column: RNA-SPLICING detected via computation, or from the RNA_ORIENTATION - column */
     if ( rc == 0 ) {
         if ( opts -> rna_splicing ) {
             /* analysis of rna-splicing explicitly requested at the commandline */
             if ( candidates . fwd_matched > 0 || candidates . rev_matched > 0 ) {
-                if ( candidates . fwd_matched > 0 ) {
-                    rc = KOutMsg( "\tXS:A:+" );
+                char xs = ( candidates . fwd_matched > 0 ) ? '+' : '-';
+                if ( bam != NULL ) {
+                    rc = bam_writer_tag_A( bam, "XS", xs );
                 } else {
-                    rc = KOutMsg( "\tXS:A:-" );
+                    rc = sam_line_tag_A( line, "XS", xs );
                 }
             }
         } else {
@@ -1674,7 +1860,11 @@ static rc_t print_alignment_sam_ps( const sam_dump_ctx * sam_ctx,
                 rc = read_char_ptr( id, cursor, atx -> rna_orientation_idx,
                                     &rna_orientation, &rna_orientation_len, "RNA_ORIENTATION" );
                 if ( rc == 0 && rna_orientation_len > 0 ) {
-                    rc = KOutMsg( "\tXS:A:%c", rna_orientation[ 0 ] );
+                    if ( bam != NULL ) {
+                        rc = bam_writer_tag_A( bam, "XS", rna_orientation[ 0 ] );
+                    } else {
+                        rc = sam_line_tag_A( line, "XS", rna_orientation[ 0 ] );
+                    }
                 }
             }
         }
@@ -1687,6 +1877,10 @@ static rc_t print_alignment_sam_ps( const sam_dump_ctx * sam_ctx,
         } else {
             INSDC_coord_len ref_len;
             rc = ReferenceObj_Read( rec -> ref, pos, rec -> len, alig_ref, &ref_len );
+            /* the MD-tag is printed with KOutMsg() */
+            if ( rc == 0 ) {
+                rc = sam_line_flush( line ); /* sam_line.c */
+            }
             if ( rc == 0 ) {
                 rc = kout_md_tag_from_cigar_string( cgc_output . p_cigar.ptr, cgc_output . p_cigar . len, /* cigar */
                         cgc_output . p_read . ptr, cgc_output . p_read . len,                             /* read */
@@ -1696,8 +1890,14 @@ static rc_t print_alignment_sam_ps( const sam_dump_ctx * sam_ctx,
         }
     }
     if ( rc == 0 ) {
-        rc = KOutMsg( "\n" );
+        if ( bam != NULL ) {
+            rc = bam_writer_end( bam ); /* bam_writer.c */
+        } else {
+            rc = sam_line_end( line ); /* sam_line.c */
+        }
     }
+    /* the MD-tag above still looks at the cigar */
+    if ( temp_cigar != NULL ) { free( temp_cigar ); }
 
     /* print a log-info if have to because RNA-splicing is requested and we have not homogeneous bits */
     if ( rna_not_homogeneous_flag ) {
@@ -1717,6 +1917,7 @@ static rc_t print_alignment_fastx( const sam_dump_ctx * sam_ctx,
                                    const align_table_context * const atx ) {
     const VCursor *cursor = atx -> cmn . cursor;
     const samdump_opts * opts = sam_ctx -> opts;
+    struct sam_line * line = sam_ctx -> line;
     int64_t mate_align_id;
     const int64_t * seq_spot_id;
     uint32_t seq_spot_id_len;
@@ -1733,10 +1934,8 @@ static rc_t print_alignment_fastx( const sam_dump_ctx * sam_ctx,
         }
     }
 
-    if ( opts -> output_format == of_fastq ) {
-        rc = KOutMsg( "@" );
-    } else {
-        rc = KOutMsg( ">" );
+    if ( rc == 0 ) {
+        rc = sam_line_char( line, ( opts -> output_format == of_fastq ) ? '@' : '>' );
     }
 
     /* SAM-FIELD: QNAME     1.row: name */
@@ -1748,19 +1947,22 @@ static rc_t print_alignment_fastx( const sam_dump_ctx * sam_ctx,
                 rc = read_char_ptr( rec -> id, cursor, atx -> cmn . seq_spot_group_idx,
                                     &spot_grp, &spot_grp_len, "SEQ_SPOT_GROUP" );
                 if ( rc == 0 ) {
-                    rc = dump_name( opts, *seq_spot_id, spot_grp, spot_grp_len ); /* sam-dump-opts.c */
+                    rc = sam_line_name( line, *seq_spot_id, spot_grp, spot_grp_len ); /* sam_line.c */
                 }
             } else {
-                rc = dump_name( opts, *seq_spot_id, NULL, 0 ); /* sam-dump-opts.c */
+                rc = sam_line_name( line, *seq_spot_id, NULL, 0 ); /* sam_line.c */
             }
         } else {
-            rc = KOutMsg( "*" );
+            rc = sam_line_char( line, '*' );
         }
         if ( rc == 0 ) {
             uint32_t seq_read_id;
             rc = read_uint32( rec -> id, cursor, atx -> cmn . seq_read_id_idx, &seq_read_id, 0, "SEQ_READ_ID" );
             if ( rc == 0 ) {
-                rc = KOutMsg( "/%u", seq_read_id );
+                rc = sam_line_char( line, '/' );
+            }
+            if ( rc == 0 ) {
+                rc = sam_line_u64( line, seq_read_id );
             }
         }
     }
@@ -1772,15 +1974,21 @@ static rc_t print_alignment_fastx( const sam_dump_ctx * sam_ctx,
     /* source of the alignment: primary/secondary/evidence */
     if ( rc == 0 ) {
         switch( atx -> align_table_type ) {
-            case att_primary    :   rc = KOutMsg( " primary" ); break;
-            case att_secondary  :   rc = KOutMsg( " secondary" ); break;
-            case att_evidence   :   rc = KOutMsg( " evidence" ); break;
+            case att_primary    :   rc = sam_line_cstr( line, " primary" ); break;
+            case att_secondary  :   rc = sam_line_cstr( line, " secondary" ); break;
+            case att_evidence   :   rc = sam_line_cstr( line, " evidence" ); break;
         }
     }
 
     /* against what reference aligned, at what position, with what mapping-quality */
     if ( rc == 0 ) {
-        rc = KOutMsg( " ref=%s pos=%u mapq=%i\n", ref_name, pos + 1, rec -> mapq );
+        rc = sam_line_str( line, " ref=", 5 );
+        if ( rc == 0 ) { rc = sam_line_cstr( line, ref_name ); }
+        if ( rc == 0 ) { rc = sam_line_str( line, " pos=", 5 ); }
+        if ( rc == 0 ) { rc = sam_line_u64( line, ( uint32_t )( pos + 1 ) ); }
+        if ( rc == 0 ) { rc = sam_line_str( line, " mapq=", 6 ); }
+        if ( rc == 0 ) { rc = sam_line_i64( line, rec -> mapq ); }
+        if ( rc == 0 ) { rc = sam_line_char( line, '\n' ); }
     }
     /* READ at a new line */
     if ( rc == 0 ) {
@@ -1789,30 +1997,32 @@ static rc_t print_alignment_fastx( const sam_dump_ctx * sam_ctx,
         rc = read_char_ptr( rec -> id, cursor, atx -> cmn . raw_read_idx, &read, &read_size, "RAW_READ" );
         if ( rc == 0 ) {
             if ( read_size > 0 ) {
-                rc = KOutMsg( "%.*s\n", read_size, read );
+                rc = sam_line_str( line, read, read_size );
             } else {
-                rc = KOutMsg( "*\n" );
+                rc = sam_line_char( line, '*' );
             }
         }
     }
 
     /* QUALITY on a new line if in fastq-mode */
     if ( rc == 0 && opts -> output_format == of_fastq ) {
-        rc = KOutMsg( "+\n" );
+        rc = sam_line_str( line, "\n+\n", 3 );
         if ( rc == 0 ) {
             const char * quality;
             uint32_t quality_size;
             rc = read_char_ptr( rec -> id, cursor, atx -> cmn . sam_quality_idx, &quality, &quality_size, "SAM_QUALITY" );
             if ( rc == 0 ) {
                 if ( quality_size > 0 ) {
-                    rc = dump_quality_33( opts, quality, quality_size, orientation );  /* sam-dump-opts.c */
+                    rc = sam_line_qual( line, quality, quality_size, orientation );  /* sam_line.c */
                 } else {
-                    rc = KOutMsg( "*" );
+                    rc = sam_line_char( line, '*' );
                 }
             }
-            if ( rc == 0 ) { rc = KOutMsg( "\n" ); }
         }
     }
+    if ( rc == 0 ) {
+        rc = sam_line_end( line ); /* sam_line.c */
+    }
     return rc;
 }
 
@@ -2124,6 +2334,421 @@ static rc_t print_selected_aligned_spots( const sam_dump_ctx * sam_ctx,
     return rc;
 }
 
+/* -------------------------------------------------------------------------------------------
+   the user did not specify regions and wants more than one thread:
+   the references are cut into windows of ALIGNED_WINDOW_SIZE bases. Every worker-thread takes
+   the next window, walks it with its own reference-list, cursors, placement-set-iterator and
+   mate-cache, and collects the text in a buffer of the window. The main-thread writes the
+   buffers in window-order, which is the order print_all_aligned_spots_0() prints them in.
+   A window prints only the alignments that start in it ( see walk_position() ).
+   The same-ref mate-cache of a worker lives only as long as one window, mates in other
+   windows are read from the table, as with --no-mate-cache.
+   ------------------------------------------------------------------------------------------- */
+
+#define ALIGNED_WINDOW_SIZE ( 128 * 1024 )
+#define ALIGNED_WINDOW_BUFSIZE ( 64 * 1024 )
+#define ALIGNED_WINDOWS_AHEAD 4     /* per worker: windows in work or done, but not written yet */
+
+#if WINDOWS
+#define ALIGNED_THREAD_LOCAL __declspec( thread )
+#else
+#define ALIGNED_THREAD_LOCAL __thread
+#endif
+
+/* the buffer of the window the calling worker-thread walks, NULL in the main-thread */
+static ALIGNED_THREAD_LOCAL struct dyn_string * window_out = NULL;
+
+typedef struct window_out_handler {
+    KWrtWriter org_writer;
+    void * org_data;
+} window_out_handler;
+
+/* the KOut-handler while the workers run: the KOutMsg()'s of the print-functions
+   land in the window-buffer of the calling worker, the main-thread writes through */
+static rc_t CC write_to_window( void * self, const char * buffer, size_t bufsize, size_t * num_writ ) {
+    rc_t rc;
+    if ( window_out != NULL ) {
+        rc = ds_add_mem( window_out, buffer, bufsize ); /* dyn_string.c */
+        *num_writ = ( rc == 0 ) ? bufsize : 0;
+    } else {
+        window_out_handler * h = self;
+        rc = h -> org_writer( h -> org_data, buffer, bufsize, num_writ );
+    }
+    return rc;
+}
+
+typedef struct aligned_window {
+    const input_database * idb;
+    uint32_t ref_idx;
+    INSDC_coord_zero start;
+    INSDC_coord_len len;
+    struct dyn_string * out;        /* made by the worker, written and freed by the main-thread */
+    bool done;
+} aligned_window;
+
+typedef struct aligned_pool {
+    const sam_dump_ctx * sam_ctx;
+    const AlignMgr * a_mgr;
+    aligned_window * windows;
+    uint32_t window_count;
+    uint32_t next_window;           /* the next window to be handed to a worker */
+    uint32_t next_output;           /* the next window to be written */
+    uint32_t max_ahead;
+    KLock * lock;
+    KCondition * window_done;       /* a worker has finished a window */
+    KCondition * window_written;    /* the main-thread has written a window */
+    rc_t rc;                        /* the first error, stops everybody */
+} aligned_pool;
+
+typedef struct aligned_worker {
+    aligned_pool * pool;
+    matecache * mc;                 /* private, NULL if no mate-cache is used */
+    const input_database * idb;     /* the database the reflist and the cursors belong to */
+    const ReferenceList * reflist;  /* private, because a ReferenceObj reads through its own cursor */
+    Vector context_list;            /* align_table_context's, the cursors stay open across windows */
+    KThread * thread;
+} aligned_worker;
+
+static rc_t add_aligned_window( aligned_pool * pool, uint32_t * allocated, const aligned_window * win ) {
+    rc_t rc = 0;
+    if ( pool -> window_count >= *allocated ) {
+        uint32_t new_allocated = ( *allocated == 0 ) ? 1024 : *allocated * 2;
+        aligned_window * tmp = realloc( pool -> windows, new_allocated * sizeof * tmp );
+        if ( tmp == NULL ) {
+            rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+            (void)LOGERR( klogErr, rc, "cannot allocate window-list" );
+        } else {
+            pool -> windows = tmp;
+            *allocated = new_allocated;
+        }
+    }
+    if ( rc == 0 ) {
+        pool -> windows[ pool -> window_count++ ] = *win;
+    }
+    return rc;
+}
+
+/* the windows in the order print_all_aligned_spots_0() walks: database, reference, position */
+static rc_t make_aligned_windows( aligned_pool * pool ) {
+    const sam_dump_ctx * sam_ctx = pool -> sam_ctx;
+    uint32_t allocated = 0;
+    uint32_t db_idx;
+    rc_t rc = 0;
+    for ( db_idx = 0; db_idx < sam_ctx -> ifs -> database_count && rc == 0; ++db_idx ) {
+        const input_database * ids = VectorGet( &( sam_ctx -> ifs -> dbs ), db_idx );
+        if ( ids != NULL ) {
+            uint32_t refobj_count;
+            rc = ReferenceList_Count( ids -> reflist, &refobj_count );
+            if ( rc == 0 && refobj_count > 0 ) {
+                uint32_t ref_idx;
+                for ( ref_idx = 0; ref_idx < refobj_count && rc == 0; ++ref_idx ) {
+                    const ReferenceObj * ref_obj;
+                    rc = ReferenceList_Get( ids -> reflist, &ref_obj, ref_idx );
+                    if ( rc == 0 && ref_obj != NULL ) {
+                        INSDC_coord_len ref_len;
+                        rc = ReferenceObj_SeqLength( ref_obj, &ref_len );
+                        if ( rc == 0 ) {
+                            uint64_t start;
+                            for ( start = 0; start < ref_len && rc == 0; start += ALIGNED_WINDOW_SIZE ) {
+                                aligned_window win;
+                                memset( &win, 0, sizeof win );
+                                win . idb = ids;
+                                win . ref_idx = ref_idx;
+                                win . start = ( INSDC_coord_zero )start;
+                                win . len = ( ref_len - start > ALIGNED_WINDOW_SIZE ) ? ALIGNED_WINDOW_SIZE
+                                                                                      : ( INSDC_coord_len )( ref_len - start );
+                                rc = add_aligned_window( pool, &allocated, &win );
+                            }
+                        }
+                        ReferenceObj_Release( ref_obj );
+                    }
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+static void release_worker_db( aligned_worker * w ) {
+    VectorWhack ( &( w -> context_list ), destroy_align_table_context, NULL );
+    VectorInit ( &( w -> context_list ), 0, 5 );
+    if ( w -> reflist != NULL ) {
+        ReferenceList_Release( w -> reflist );
+        w -> reflist = NULL;
+    }
+    w -> idb = NULL;
+}
+
+/* the worker switches to the database of the window: its own reflist, the cursors follow with the first window */
+static rc_t open_worker_db( aligned_worker * w, const input_database * idb ) {
+    rc_t rc;
+    release_worker_db( w );
+    rc = ReferenceList_MakeDatabase( &( w -> reflist ), idb -> db, idb -> reflist_options, 0, NULL, 0 );
+    if ( rc != 0 ) {
+        (void)PLOGERR( klogErr, ( klogErr, rc, "cannot create reflist for '$(t)'", "t=%s", idb -> path ) );
+    } else {
+        w -> idb = idb;
+    }
+    return rc;
+}
+
+static rc_t walk_aligned_window( aligned_worker * w, const sam_dump_ctx * w_ctx, aligned_window * win ) {
+    const ReferenceObj * ref_obj = NULL;
+    rc_t rc = 0;
+    if ( w -> idb != win -> idb ) {
+        rc = open_worker_db( w, win -> idb );
+    }
+    if ( rc == 0 ) {
+        rc = ReferenceList_Get( w -> reflist, &ref_obj, win -> ref_idx );
+        if ( rc != 0 ) {
+            (void)LOGERR( klogInt, rc, "ReferenceList_Get() failed" );
+        } else if ( VectorLength( &( w -> context_list ) ) == 0 ) {
+            /* only the contexts, no placement-iterators yet */
+            rc = add_pl_iters( w_ctx -> opts, NULL, ref_obj, win -> idb, 0, 0, NULL, &( w -> context_list ) ); /* above */
+        }
+    }
+    if ( rc == 0 ) {
+        PlacementSetIterator * set_iter;
+        rc = AlignMgrMakePlacementSetIterator( w -> pool -> a_mgr, &set_iter );
+        if ( rc != 0 ) {
+            (void)LOGERR( klogErr, rc, "cannot create PlacementSetIterator" );
+        } else {
+            uint32_t idx, count = VectorLength( &( w -> context_list ) );
+            for ( idx = 0; idx < count && rc == 0; ++idx ) {
+                align_table_context * atx = VectorGet( &( w -> context_list ), idx );
+                atx -> ref_obj = ref_obj;
+                atx -> ref_idx = win -> ref_idx;
+                rc = add_context_pl_iter( w_ctx -> opts, set_iter, atx, win -> start, win -> len, NULL ); /* above */
+            }
+            if ( rc == 0 ) {
+                window_out = win -> out;
+                rc = walk_placements( w_ctx, set_iter ); /* above */
+                window_out = NULL;
+            }
+            PlacementSetIteratorRelease( set_iter );
+        }
+    }
+    if ( ref_obj != NULL ) {
+        ReferenceObj_Release( ref_obj );
+    }
+    return rc;
+}
+
+static void set_pool_error( aligned_pool * pool, rc_t rc ) {
+    /* call with the lock held */
+    if ( pool -> rc == 0 ) {
+        pool -> rc = rc;
+    }
+    KConditionBroadcast( pool -> window_written );
+    KConditionSignal( pool -> window_done );
+}
+
+static rc_t CC aligned_worker_thread( const KThread * self, void * data ) {
+    aligned_worker * w = data;
+    aligned_pool * pool = w -> pool;
+    sam_dump_ctx w_ctx = { pool -> sam_ctx -> opts, pool -> sam_ctx -> ifs, w -> mc, NULL, NULL, NULL };
+    bool done = false;
+    rc_t rc = make_sam_line( &( w_ctx . line ), w_ctx . opts ); /* sam_line.c */
+
+    while ( rc == 0 && !done ) {
+        aligned_window * win = NULL;
+        rc = KLockAcquire( pool -> lock );
+        if ( rc == 0 ) {
+            while ( pool -> rc == 0 &&
+                    pool -> next_window < pool -> window_count &&
+                    pool -> next_window >= pool -> next_output + pool -> max_ahead ) {
+                KConditionWait( pool -> window_written, pool -> lock );
+            }
+            if ( pool -> rc == 0 && pool -> next_window < pool -> window_count ) {
+                win = &( pool -> windows[ pool -> next_window++ ] );
+            }
+            KLockUnlock( pool -> lock );
+        }
+        if ( rc == 0 ) {
+            if ( win == NULL ) {
+                done = true;
+            } else {
+                rc = ds_allocate( &( win -> out ), ALIGNED_WINDOW_BUFSIZE ); /* dyn_string.c */
+                if ( rc == 0 ) {
+                    rc = walk_aligned_window( w, &w_ctx, win );
+                }
+                if ( rc == 0 ) {
+                    rc = KLockAcquire( pool -> lock );
+                    if ( rc == 0 ) {
+                        win -> done = true;
+                        KConditionSignal( pool -> window_done );
+                        KLockUnlock( pool -> lock );
+                    }
+                }
+            }
+        }
+    }
+    if ( rc != 0 && KLockAcquire( pool -> lock ) == 0 ) {
+        set_pool_error( pool, rc );
+        KLockUnlock( pool -> lock );
+    }
+    release_worker_db( w );
+    release_sam_line( w_ctx . line ); /* sam_line.c */
+    return rc;
+}
+
+/* the main-thread: wait for the windows one after the other, write and free their text */
+static rc_t write_aligned_windows( aligned_pool * pool, const window_out_handler * h ) {
+    rc_t rc = 0;
+    while ( rc == 0 && pool -> next_output < pool -> window_count ) {
+        aligned_window * win = &( pool -> windows[ pool -> next_output ] );
+        rc = KLockAcquire( pool -> lock );
+        if ( rc == 0 ) {
+            while ( pool -> rc == 0 && !win -> done ) {
+                KConditionWait( pool -> window_done, pool -> lock );
+            }
+            rc = pool -> rc;
+            KLockUnlock( pool -> lock );
+        }
+        if ( rc == 0 ) {
+            rc = ds_write( win -> out, h -> org_writer, h -> org_data ); /* dyn_string.c */
+            if ( rc != 0 ) {
+                (void)LOGERR( klogErr, rc, "cannot write aligned spots" );
+            }
+            ds_free( win -> out );
+            win -> out = NULL;
+        }
+        if ( KLockAcquire( pool -> lock ) == 0 ) {
+            if ( rc != 0 ) {
+                set_pool_error( pool, rc );
+            } else {
+                pool -> next_output++;
+                KConditionBroadcast( pool -> window_written );
+            }
+            KLockUnlock( pool -> lock );
+        }
+    }
+    return rc;
+}
+
+static rc_t make_aligned_pool( aligned_pool * pool ) {
+    rc_t rc = make_aligned_windows( pool );
+    if ( rc == 0 ) {
+        rc = KLockMake( &( pool -> lock ) );
+        if ( rc != 0 ) {
+            (void)LOGERR( klogInt, rc, "KLockMake() failed" );
+        }
+    }
+    if ( rc == 0 ) {
+        rc = KConditionMake( &( pool -> window_done ) );
+        if ( rc == 0 ) {
+            rc = KConditionMake( &( pool -> window_written ) );
+        }
+        if ( rc != 0 ) {
+            (void)LOGERR( klogInt, rc, "KConditionMake() failed" );
+        }
+    }
+    return rc;
+}
+
+static void release_aligned_pool( aligned_pool * pool ) {
+    if ( pool -> windows != NULL ) {
+        uint32_t idx;
+        for ( idx = 0; idx < pool -> window_count; ++idx ) {
+            ds_free( pool -> windows[ idx ] . out );    /* tolerates NULL-ptr */
+        }
+        free( pool -> windows );
+    }
+    KConditionRelease( pool -> window_written );
+    KConditionRelease( pool -> window_done );
+    KLockRelease( pool -> lock );
+}
+
+static rc_t print_all_aligned_spots_threaded( const sam_dump_ctx * sam_ctx,
+                                              const AlignMgr * const a_mgr ) {
+    const samdump_opts * opts = sam_ctx -> opts;
+    aligned_pool pool;
+    aligned_worker * workers = NULL;
+    uint32_t started = 0;
+    rc_t rc;
+
+    memset( &pool, 0, sizeof pool );
+    pool . sam_ctx = sam_ctx;
+    pool . a_mgr = a_mgr;
+    pool . max_ahead = opts -> num_threads * ALIGNED_WINDOWS_AHEAD;
+
+    rc = make_aligned_pool( &pool );
+    if ( rc == 0 && pool . window_count > 0 ) {
+        workers = calloc( opts -> num_threads, sizeof * workers );
+        if ( workers == NULL ) {
+            rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+            (void)LOGERR( klogErr, rc, "cannot allocate worker-threads" );
+        } else {
+            window_out_handler h;
+            h . org_writer = KOutWriterGet();
+            h . org_data = KOutDataGet();
+            rc = KOutHandlerSet( write_to_window, &h );
+            if ( rc != 0 ) {
+                (void)LOGERR( klogInt, rc, "KOutHandlerSet() failed" );
+            } else {
+                uint32_t idx;
+                for ( idx = 0; idx < opts -> num_threads && rc == 0; ++idx ) {
+                    aligned_worker * w = &( workers[ idx ] );
+                    w -> pool = &pool;
+                    VectorInit ( &( w -> context_list ), 0, 5 );
+                    if ( sam_ctx -> mc != NULL ) {
+                        rc = make_matecache( &( w -> mc ), sam_ctx -> ifs -> database_count ); /* matecache.c */
+                    }
+                    if ( rc == 0 ) {
+                        rc = KThreadMake( &( w -> thread ), aligned_worker_thread, w );
+                        if ( rc != 0 ) {
+                            (void)LOGERR( klogInt, rc, "KThreadMake() failed" );
+                        } else {
+                            started++;
+                        }
+                    }
+                }
+                if ( rc != 0 && KLockAcquire( pool . lock ) == 0 ) {
+                    set_pool_error( &pool, rc );
+                    KLockUnlock( pool . lock );
+                }
+                if ( rc == 0 ) {
+                    rc = write_aligned_windows( &pool, &h );
+                }
+                for ( idx = 0; idx < started; ++idx ) {
+                    rc_t status = 0;
+                    rc_t rc2 = KThreadWait( workers[ idx ] . thread, &status );
+                    if ( rc == 0 ) { rc = ( rc2 != 0 ) ? rc2 : status; }
+                    KThreadRelease( workers[ idx ] . thread );
+                }
+                KOutHandlerSet( h . org_writer, h . org_data );
+            }
+            {
+                uint32_t idx;
+                for ( idx = 0; idx < opts -> num_threads; ++idx ) {
+                    aligned_worker * w = &( workers[ idx ] );
+                    if ( w -> mc != NULL ) {
+                        /* the half-aligned entries are needed by print_unaligned_spots() */
+                        if ( rc == 0 ) {
+                            rc = matecache_merge( sam_ctx -> mc, w -> mc ); /* matecache.c */
+                        }
+                        release_matecache( w -> mc );
+                    }
+                }
+            }
+            free( workers );
+        }
+    }
+    release_aligned_pool( &pool );
+    return rc;
+}
+
+/* the threaded mode covers the whole-file dump, one reference at a time,
+   the rna-splice-log and the perf-log are written in walk-order, they need a single thread */
+static bool use_aligned_threads( const samdump_opts * opts ) {
+    return ( opts -> num_threads > 1 &&
+             !opts -> no_mt &&
+             opts -> dump_mode == dm_one_ref_at_a_time &&
+             opts -> rna_splice_log == NULL &&
+             opts -> perf_log == NULL &&
+             !opts -> output_bam );   /* the BAM-writer uses the threads to compress */
+}
+
 /*
    this is called from sam-dump3.c, it prepares the iterators and then walks them
    ---> only entry into this module <--- 
@@ -2147,7 +2772,11 @@ rc_t print_aligned_spots( const sam_dump_ctx * sam_ctx ) {
         if ( opts -> region_count == 0 ) {
             /* the user did not specify regions to be printed ==> print all alignments */
             switch( opts -> dump_mode ) {
-                case dm_one_ref_at_a_time : rc = print_all_aligned_spots_0( sam_ctx, a_mgr ); /* above */
+                case dm_one_ref_at_a_time : if ( use_aligned_threads( opts ) ) {
+                                                rc = print_all_aligned_spots_threaded( sam_ctx, a_mgr ); /* above */
+                                            } else {
+                                                rc = print_all_aligned_spots_0( sam_ctx, a_mgr ); /* above */
+                                            }
                                             break;
                 case dm_prepare_all_refs  : rc = print_all_aligned_spots_1( sam_ctx, a_mgr ); /* above */
                                             break;
@@ -34,6 +34,10 @@
 #include <klib/log.h>
 #endif
 
+#ifndef _h_klib_printf_
+#include <klib/printf.h>
+#endif
+
 #ifndef _h_align_quality_quantizer_
 #include <align/quality-quantizer.h>
 #endif
@@ -711,6 +715,10 @@ static rc_t gather_flag_options( Args * args, samdump_opts * opts ) {
     rc = get_bool_option( args, OPT_NOQUAL, &opts->no_qual );
     if ( rc != 0 ) { return rc; }
 
+    /* write BAM instead of SAM */
+    rc = get_bool_option( args, OPT_BAM, &opts->output_bam );
+    if ( rc != 0 ) { return rc; }
+
     /* forcing to use the legacy code in case of Evidence-Dnb was requested */
     if ( rc == 0 ) {
         if ( opts->dump_cg_ev_dnb ) {
@@ -819,6 +827,9 @@ static rc_t gather_int_options( Args * args, samdump_opts * opts ) {
     if ( rc == 0 ) {
         rc = get_uint32_option( args, OPT_RNA_SPLICEL, 0, &opts->rna_splice_level, true );
     }
+    if ( rc == 0 ) {
+        rc = get_uint32_option( args, OPT_THREADS, 1, &opts->num_threads, true );
+    }
     return rc;
 }
 
@@ -965,6 +976,21 @@ static rc_t gather_string_options( Args * args, samdump_opts * opts ) {
     if ( rc == 0 && s != NULL ) {
         KConfigSetNgcFile( s );
     }
+
+    if ( rc == 0 ) {
+        rc = get_str_option( args, OPT_BAM_INDEX, &s );
+        if ( rc == 0 && s != NULL ) {
+            if ( cmp_pchar( s, "bai" ) == 0 ) {
+                opts->bam_index = bif_bai;
+            } else if ( cmp_pchar( s, "csi" ) == 0 ) {
+                opts->bam_index = bif_csi;
+            } else {
+                rc = RC( rcExe, rcNoTarg, rcValidating, rcParam, rcInvalid );
+                (void)PLOGERR( klogErr, ( klogErr, rc, "invalid bam-index-format '$(t)', use 'bai' or 'csi'",
+                                          "t=%s", s ) );
+            }
+        }
+    }
     return rc;
 }
 
@@ -983,6 +1009,45 @@ static rc_t gather_string_options( Args * args, samdump_opts * opts ) {
         yes         |       yes         |   fa  ha  hu
 
 *********************************************************************************************/
+/* BAM-output excludes some other options */
+static rc_t gather_bam_options( samdump_opts * opts ) {
+    rc_t rc = 0;
+    if ( opts->output_bam ) {
+        if ( opts->force_legacy ) {
+            rc = RC( rcExe, rcNoTarg, rcValidating, rcParam, rcUnsupported );
+            (void)LOGERR( klogErr, rc, "BAM-output is not available with the legacy code-path" );
+        } else if ( opts->output_format != of_sam ) {
+            (void)LOGMSG( klogWarn, "BAM-output ignored with FASTA/FASTQ-output" );
+            opts->output_bam = false;
+        } else {
+            if ( opts->output_compression != oc_none ) {
+                (void)LOGMSG( klogWarn, "gzip/bzip2 ignored with BAM-output ( it is compressed already )" );
+                opts->output_compression = oc_none;
+            }
+            if ( opts->report_cache ) {
+                /* the report would end up in the BAM-output */
+                (void)LOGMSG( klogWarn, "cachereport ignored with BAM-output" );
+                opts->report_cache = false;
+            }
+            if ( opts->header_mode == hm_none ) {
+                /* the reference-dictionary of a BAM-file comes from the header */
+                (void)LOGMSG( klogWarn, "BAM-output needs a header, --no-header ignored" );
+                opts->header_mode = hm_dump;
+            }
+        }
+    }
+    if ( opts->bam_index != bif_none ) {
+        if ( !opts->output_bam ) {
+            (void)LOGMSG( klogWarn, "bam-index ignored without BAM-output" );
+            opts->bam_index = bif_none;
+        } else if ( opts->outputfile == NULL ) {
+            rc = RC( rcExe, rcNoTarg, rcValidating, rcParam, rcInvalid );
+            (void)LOGERR( klogErr, rc, "a bam-index needs an output-file" );
+        }
+    }
+    return rc;
+}
+
 static void gather_unaligned_options( samdump_opts * opts ) {
     if ( opts->region_count == 0 ) {
         if ( opts->dump_unaligned_only ) {
@@ -1069,12 +1134,19 @@ void report_options( const samdump_opts * opts ) {
     }
 
     switch( opts->output_format ) {
-        case of_sam   : KOutMsg( "output-format         : SAM\n" ); break;
+        case of_sam   : KOutMsg( "output-format         : %s\n", opts->output_bam ? "BAM" : "SAM" ); break;
         case of_fasta : KOutMsg( "output-format         : FASTA\n" ); break;
         case of_fastq : KOutMsg( "output-format         : FASTQ\n" ); break;
         default       : KOutMsg( "output-format         : unknown\n" ); break;
     }
 
+    switch( opts->bam_index ) {
+        case bif_none : KOutMsg( "bam-index             : none\n" ); break;
+        case bif_bai  : KOutMsg( "bam-index             : BAI\n" ); break;
+        case bif_csi  : KOutMsg( "bam-index             : CSI\n" ); break;
+        default       : KOutMsg( "bam-index             : unknown\n" ); break;
+    }
+
     switch( opts->dump_mode ) {
         case dm_one_ref_at_a_time : KOutMsg( "dump-mode             : one ref at a time\n" ); break;
         case dm_prepare_all_refs  : KOutMsg( "dump-mode             : prepare all refs\n" ); break;
@@ -1157,6 +1229,7 @@ void report_options( const samdump_opts * opts ) {
     KOutMsg( "rna-splice-log        : %s\n",  opts -> rna_splice_log_file );
 
     KOutMsg( "multithreading        : %s\n",  opts -> no_mt ? "NO" : "YES" );  
+    KOutMsg( "threads               : %u\n",  opts -> num_threads );
     KOutMsg( "with-MD-flag          : %s\n",  opts -> with_md_flag ? "YES" : "NO" );
     KOutMsg( "omit-qualities        : %s\n",  opts -> no_qual ? "YES" : "NO" );
     
@@ -1199,6 +1272,7 @@ rc_t gather_options( Args * args, samdump_opts * opts )
     if ( rc == 0 ) { rc = gather_string_options( args, opts ); }
     if ( rc == 0 ) { rc = gather_int_options( args, opts ); }
     if ( rc == 0 ) { rc = gather_matepair_distances( args, opts ); }
+    if ( rc == 0 ) { rc = gather_bam_options( opts ); }
     if ( rc == 0 ) { gather_unaligned_options( opts ); }
     return rc;
 }
@@ -1222,35 +1296,50 @@ bool is_this_alignment_requested( const samdump_opts * opts, const char *refname
     return res;
 }
 
-rc_t dump_name( const samdump_opts * opts, int64_t seq_spot_id,
-                const char * spot_group, uint32_t spot_group_len ) {
+rc_t make_name( const samdump_opts * opts, char * buffer, size_t buffer_size, size_t * num_writ,
+                int64_t seq_spot_id, const char * spot_group, uint32_t spot_group_len ) {
     rc_t rc;
 
     if ( opts->print_cg_names ) {
         if ( spot_group != NULL && spot_group_len != 0 ) {
-            rc = KOutMsg( "%.*s-1:%lu", spot_group_len, spot_group, seq_spot_id );
+            rc = string_printf( buffer, buffer_size, num_writ, "%.*s-1:%lu", spot_group_len, spot_group, seq_spot_id );
         } else {
-            rc = KOutMsg( "%lu", seq_spot_id );
+            rc = string_printf( buffer, buffer_size, num_writ, "%lu", seq_spot_id );
         }
     } else {
         if ( opts->qname_prefix != NULL ) {
             /* we do have to print a prefix */
             if ( opts->print_spot_group_in_name && spot_group != NULL && spot_group_len > 0 ) {
-                rc = KOutMsg( "%s.%lu.%.*s", opts->qname_prefix, seq_spot_id, spot_group_len, spot_group );
+                rc = string_printf( buffer, buffer_size, num_writ, "%s.%lu.%.*s",
+                                    opts->qname_prefix, seq_spot_id, spot_group_len, spot_group );
             } else {
             /* we do NOT have to append the spot-group */
-                rc = KOutMsg( "%s.%lu", opts->qname_prefix, seq_spot_id );
+                rc = string_printf( buffer, buffer_size, num_writ, "%s.%lu", opts->qname_prefix, seq_spot_id );
             }
         } else {
             /* we do NOT have to print a prefix */
             if ( opts->print_spot_group_in_name && spot_group != NULL && spot_group_len > 0 ) {
-                rc = KOutMsg( "%lu.%.*s", seq_spot_id, spot_group_len, spot_group );
+                rc = string_printf( buffer, buffer_size, num_writ, "%lu.%.*s", seq_spot_id, spot_group_len, spot_group );
             } else {
             /* we do NOT have to append the spot-group */
-                rc = KOutMsg( "%lu", seq_spot_id );
+                rc = string_printf( buffer, buffer_size, num_writ, "%lu", seq_spot_id );
             }
         }
     }
+    if ( rc != 0 ) {
+        (void)LOGERR( klogErr, rc, "cannot make QNAME" );
+    }
+    return rc;
+}
+
+rc_t dump_name( const samdump_opts * opts, int64_t seq_spot_id,
+                const char * spot_group, uint32_t spot_group_len ) {
+    char buffer[ 4096 ];
+    size_t num_writ;
+    rc_t rc = make_name( opts, buffer, sizeof buffer, &num_writ, seq_spot_id, spot_group, spot_group_len );
+    if ( rc == 0 ) {
+        rc = KOutMsg( "%.*s", ( uint32_t )num_writ, buffer );
+    }
     return rc;
 }
 
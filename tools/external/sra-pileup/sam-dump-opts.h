@@ -111,10 +111,13 @@ extern "C" {
 #define OPT_RNA_SPLICEL "rna-splice-level"
 #define OPT_RNA_SPLICE_LOG "rna-splice-log"
 #define OPT_NO_MT       "disable-multithreading"
+#define OPT_THREADS     "threads"
 #define OPT_TIMING      "timing"
 #define OPT_MD_FLAG     "with-md-flag"
 #define OPT_NGC         "ngc"
 #define OPT_NOQUAL      "omit-quality"
+#define OPT_BAM         "bam"
+#define OPT_BAM_INDEX   "bam-index"
 
 typedef struct range {
     uint64_t start;
@@ -146,6 +149,12 @@ enum output_compression {
     oc_bzip2        /* compress output with bzip2 */
 };
 
+enum bam_index_format {
+    bif_none = 0,   /* do not index the BAM-output */
+    bif_bai,        /* write a BAI-index next to the output-file */
+    bif_csi         /* write a CSI-index next to the output-file */
+};
+
 enum cigar_treatment {
     ct_unchanged = 0,   /* use the cigar-string as it is stored */
     ct_cg_style,        /* transform cigar into cg-style ( has B/N ) */
@@ -202,6 +211,9 @@ typedef struct samdump_opts {
     uint32_t input_file_count;
     uint32_t rna_splice_level;  /* can be 0 || 1 || 2 */
 
+    /* how many threads walk the references, 1 ... single-threaded */
+    uint32_t num_threads;
+
     int32_t min_mapq;
 
     /* how much buffering on the output-buffer, of OFF if zero */
@@ -224,6 +236,9 @@ typedef struct samdump_opts {
     /* should the output be compressed / in which format */
     enum output_compression output_compression;
 
+    /* index of the BAM-output, only with output_bam and outputfile */
+    enum bam_index_format bam_index;
+
     /* how to process in case of: aligned reads requested + no regions given */
     enum dump_mode dump_mode;
 
@@ -268,6 +283,9 @@ typedef struct samdump_opts {
     bool no_mt;
     bool no_qual;
 
+    /* write BAM instead of SAM */
+    bool output_bam;
+
 	bool with_md_flag;
 	
     uint8_t qual_quant_matrix[ 256 ];
@@ -297,6 +315,10 @@ bool filter_by_matepair_dist( const samdump_opts * opts, int32_t tlen );
 bool is_this_alignment_requested( const samdump_opts * opts, const char *refname, uint32_t refname_len,
                                   uint64_t start, uint64_t len );
 
+/* the QNAME dump_name() prints, into a buffer */
+rc_t make_name( const samdump_opts * opts, char * buffer, size_t buffer_size, size_t * num_writ,
+                int64_t seq_spot_id, const char * spot_group, uint32_t spot_group_len );
+
 rc_t dump_name( const samdump_opts * opts, int64_t seq_spot_id,
                 const char * spot_group, uint32_t spot_group_len );
 
@@ -312,6 +334,8 @@ typedef struct samdump_ctx {
     const input_files * const ifs;
     matecache * mc;
     struct dyn_string * ds;
+    struct bam_writer * bam;    /* NULL if the output is not BAM */
+    struct sam_line * line;     /* the record-formatter of the aligned printers */
 } sam_dump_ctx;
 
 #ifdef __cplusplus
@@ -72,6 +72,14 @@
 #include "out_redir.h"
 #endif
 
+#ifndef _h_bam_writer_
+#include "bam_writer.h"
+#endif
+
+#ifndef _h_sam_line_
+#include "sam_line.h"
+#endif
+
 #ifndef _h_sam_aligned_
 #include "sam-aligned.h"
 #endif
@@ -206,12 +214,24 @@ char const *rna_splice_log_usage[]    = { "file, into which rna-splice events ar
 
 char const *no_mt_usage[]             = { "disable multithreading", NULL };
 
+char const *threads_usage[]           = { "walk the references with this many threads (dflt:1)",
+                                          "output is the same as single-threaded, ignored if regions are given",
+                                       NULL };
+
 char const *no_qual_usage[]           = { "omit qualities", NULL };
 
 char const *with_md_flag_usage[]      = { "print MD-flag", NULL };
 
 char const *ngc_usage[]               = { "PATH to ngc file", NULL };
 
+char const *bam_usage[]               = { "write BAM instead of SAM, --threads compress in parallel",
+                                          "implies a header, excludes --gzip/--bzip2",
+                                       NULL };
+
+char const *bam_index_usage[]         = { "index the BAM-output ( 'bai' or 'csi' ), needs --output-file",
+                                          "written into output-file.bai/.csi, only if the output is sorted",
+                                       NULL };
+
 OptDef SamDumpArgs[] = {
     { OPT_UNALIGNED,     "u", NULL, sd_unaligned_usage,      0, false, false },  /* print unaligned reads */
     { OPT_PRIM_ONLY,     "1", NULL, sd_primaryonly_usage,    0, false, false },  /* print only primary alignments */
@@ -253,6 +273,7 @@ OptDef SamDumpArgs[] = {
     { OPT_RNA_SPLICEL,  NULL, NULL, rna_splicel_usage,       0, true,  false },  /* level of rna-splicing detection */
     { OPT_RNA_SPLICE_LOG,  NULL, NULL, rna_splice_log_usage, 0, true,  false },  /* filename to log rna-splice events into */
     { OPT_NO_MT,        NULL, NULL, no_mt_usage,             0, false, false },  /* force new code-path */
+    { OPT_THREADS,       "e", NULL, threads_usage,           0, true,  false },  /* number of threads walking the references */
     { OPT_NOQUAL,       "o",  NULL, no_qual_usage,           0, false, false },  /* ommit qualities */
     { OPT_MD_FLAG,      NULL, NULL, with_md_flag_usage,      0, false, false },  /* print the MD-flag */
     { OPT_DUMP_MODE,    NULL, NULL, NULL,                    0, true,  false },  /* how to produce aligned reads if no regions given */
@@ -260,6 +281,8 @@ OptDef SamDumpArgs[] = {
     { OPT_LEGACY,       NULL, NULL, NULL,                    0, false, false },  /* force legacy code-path */
     { OPT_NEW,          NULL, NULL, NULL,                    0, false, false },   /* force new code-path */
     { OPT_NGC,          NULL, NULL, ngc_usage, 0, true, false },  /* ngc file */
+    { OPT_BAM,          NULL, NULL, bam_usage,               0, false, false },  /* output-format = BAM */
+    { OPT_BAM_INDEX,    NULL, NULL, bam_index_usage,         0, true,  false },  /* index the BAM-output */
     { OPT_TIMING,       NULL, NULL, NULL,                    0, true, false }    /* optional timing */
 };
 
@@ -304,6 +327,7 @@ char const *sd_usage_params[] = {
     NULL,                       /* level of rna-splicing detection */
     NULL,                       /* file to log rna-splice-events into */
     NULL,                       /* no-mt */
+    "count",                    /* threads */
     NULL,                       /* no-qualities */
     NULL,                       /* with-md-flag */
     NULL,                       /* dump_mode */
@@ -311,6 +335,8 @@ char const *sd_usage_params[] = {
     NULL,                       /* force legacy code path */
     NULL,                       /* force new code path */
     "PATH",                     /* ngc file */
+    NULL,                       /* bam */
+    "bai|csi",                  /* bam-index */
     NULL                        /* optional timing */
 };
 
@@ -378,7 +404,7 @@ static uint32_t tabsel_2_ReferenceList_Options( const samdump_opts * opts ) {
 }
 
 
-static rc_t print_samdump( const samdump_opts * const opts ) {
+static rc_t print_samdump( const samdump_opts * const opts, struct bam_writer * bam ) {
     KDirectory *dir;
 
     rc_t rc = KDirectoryNativeDir( &dir );
@@ -390,7 +416,7 @@ static rc_t print_samdump( const samdump_opts * const opts ) {
         if ( rc != 0 ) {
             (void)LOGERR( klogErr, rc, "cannot create vdb-manager" );
         } else {
-            sam_dump_ctx sam_ctx = { opts, NULL, NULL, NULL };
+            sam_dump_ctx sam_ctx = { opts, NULL, NULL, NULL, bam, NULL };
             uint32_t reflist_opt = tabsel_2_ReferenceList_Options( opts );
 
             ReportSetVDBManager( mgr ); /**/
@@ -425,6 +451,14 @@ static rc_t print_samdump( const samdump_opts * const opts ) {
                                 LOGERR( klogInt, rc, "cannot create dynamic string" );
                             }
 
+                            /* the line-buffer the aligned records are formatted into */
+                            if ( rc == 0 ) {
+                                rc = make_sam_line( &( sam_ctx . line ), opts ); /* sam_line.c */
+                                if ( rc != 0 ) {
+                                    LOGERR( klogInt, rc, "cannot create line-buffer" );
+                                }
+                            }
+
                             /* print output of header */
                             if ( rc == 0 &&
                                  ( opts -> output_format == of_sam )     &&
@@ -460,6 +494,7 @@ static rc_t print_samdump( const samdump_opts * const opts ) {
                             }
 
                             ds_free( sam_ctx . ds );    /* tolerates NULL-ptr */
+                            release_sam_line( sam_ctx . line );    /* tolerates NULL-ptr */
                         }
                     }
                     release_input_files( ( input_files * )sam_ctx . ifs ); /* inputfiles.c */
@@ -493,6 +528,42 @@ static rc_t perform_cigar_test( const samdump_opts * const opts ) {
     return rc;
 }
 
+/* the BAM-writer takes over the KOut-handler instead of the out-redirection */
+static rc_t print_bam( const samdump_opts * const opts ) {
+    struct bam_writer * bam;
+    char index_filename[ 4096 ];
+    const char * index = NULL;
+    rc_t rc = 0;
+
+    if ( opts -> bam_index != bif_none ) {
+        size_t num_writ;
+        rc = string_printf( index_filename, sizeof index_filename, &num_writ, "%s.%s",
+                            opts -> outputfile, opts -> bam_index == bif_csi ? "csi" : "bai" );
+        if ( rc != 0 ) {
+            (void)LOGERR( klogErr, rc, "cannot make filename of bam-index" );
+        }
+        index = index_filename;
+    }
+    if ( rc == 0 ) {
+        rc = make_bam_writer( &bam,
+                              opts -> outputfile,
+                              index,
+                              opts -> bam_index == bif_csi,
+                              opts -> no_mt ? 0 : opts -> num_threads,
+                              opts -> qual_quant != NULL ? opts -> qual_quant_matrix : NULL ); /* bam_writer.c */
+        if ( rc == 0 ) {
+            /* ------------------------------------------------------ */
+            rc = print_samdump( opts, bam );
+            /* ------------------------------------------------------ */
+            if ( rc == 0 ) {
+                rc = bam_writer_finish( bam ); /* bam_writer.c */
+            }
+            release_bam_writer( bam ); /* bam_writer.c */
+        }
+    }
+    return rc;
+}
+
 /* =========================================================================================== */
 
 static rc_t samdump_main( Args * args, const samdump_opts * const opts )
@@ -500,6 +571,8 @@ static rc_t samdump_main( Args * args, const samdump_opts * const opts )
     rc_t rc = 0;
     out_redir redir; /* from out_redir.h */
     enum out_redir_mode mode = orm_uncompressed;
+    /* the BAM-writer creates the output-file itself */
+    bool redirect = !( opts->output_bam && !opts->report_options && opts->cigar_test == NULL );
 
     switch( opts -> output_compression ) {
         case oc_none  : mode = orm_uncompressed; break;
@@ -507,7 +580,9 @@ static rc_t samdump_main( Args * args, const samdump_opts * const opts )
         case oc_bzip2 : mode = orm_bzip2; break;
     }
 
-    rc = init_out_redir( &redir, mode, opts->outputfile, opts->output_buffer_size ); /* from out_redir.c */
+    if ( redirect ) {
+        rc = init_out_redir( &redir, mode, opts->outputfile, opts->output_buffer_size ); /* from out_redir.c */
+    }
     if ( rc == 0 ) {
         if ( opts->report_options ) {
             report_options( opts ); /* from sam-dump-opts.c */
@@ -518,13 +593,19 @@ static rc_t samdump_main( Args * args, const samdump_opts * const opts )
                 rc = RC( rcExe, rcArgv, rcParsing, rcParam, rcInvalid );
                 (void)LOGERR( klogErr, rc, "no inputfiles given at commandline" );
                 Usage( args );
+            } else if ( opts->output_bam ) {
+                /* ------------------------------------------------------ */
+                rc = print_bam( opts );
+                /* ------------------------------------------------------ */
             } else {
                 /* ------------------------------------------------------ */
-                rc = print_samdump( opts );
+                rc = print_samdump( opts, NULL );
                 /* ------------------------------------------------------ */
             }
         }
-        release_out_redir( &redir ); /* from out_redir.c */
+        if ( redirect ) {
+            release_out_redir( &redir ); /* from out_redir.c */
+        }
     }
     return rc;
 }
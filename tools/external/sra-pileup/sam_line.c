@@ -0,0 +1,327 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "sam_line.h"
+#include "sam-dump-opts.h"
+
+#ifndef _h_klib_out_
+#include <klib/out.h>
+#endif
+
+#ifndef _h_klib_text_
+#include <klib/text.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SAM_LINE_INITIAL_SIZE 4096
+
+typedef struct sam_line {
+    char * buf;
+    size_t len;
+    size_t size;
+    const samdump_opts * opts;
+    char qual_33[ 256 ];    /* phred+33 in, phred+33 out: quantized or unchanged */
+} sam_line;
+
+static const char digit_pairs[ 201 ] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+rc_t make_sam_line( struct sam_line ** self, const struct samdump_opts * opts ) {
+    rc_t rc = 0;
+    sam_line * l = calloc( 1, sizeof *l );
+    *self = NULL;
+    if ( l == NULL ) {
+        rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    } else {
+        l -> buf = malloc( SAM_LINE_INITIAL_SIZE );
+        if ( l -> buf == NULL ) {
+            rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            free( l );
+        } else {
+            uint32_t c;
+            l -> size = SAM_LINE_INITIAL_SIZE;
+            l -> opts = opts;
+            for ( c = 0; c < 256; ++c ) {
+                if ( opts -> qual_quant != NULL ) {
+                    l -> qual_33[ c ] = opts -> qual_quant_matrix[ ( uint8_t )( c - 33 ) ] + 33;
+                } else {
+                    l -> qual_33[ c ] = ( char )c;
+                }
+            }
+            *self = l;
+        }
+    }
+    return rc;
+}
+
+void release_sam_line( struct sam_line * self ) {
+    if ( self != NULL ) {
+        free( self -> buf );
+        free( self );
+    }
+}
+
+static rc_t reserve( sam_line * self, size_t extra ) {
+    rc_t rc = 0;
+    size_t needed = self -> len + extra;
+    if ( needed > self -> size ) {
+        size_t new_size = self -> size * 2;
+        char * tmp;
+        if ( new_size < needed ) { new_size = needed; }
+        tmp = realloc( self -> buf, new_size );
+        if ( tmp == NULL ) {
+            rc = RC( rcApp, rcNoTarg, rcWriting, rcMemory, rcExhausted );
+        } else {
+            self -> buf = tmp;
+            self -> size = new_size;
+        }
+    }
+    return rc;
+}
+
+rc_t sam_line_flush( struct sam_line * self ) {
+    rc_t rc = 0;
+    KWrtWriter writer = KOutWriterGet();
+    size_t written = 0;
+    if ( writer != NULL ) {
+        void * data = KOutDataGet();
+        while ( rc == 0 && written < self -> len ) {
+            size_t num_writ = 0;
+            rc = writer( data, &( self -> buf[ written ] ), self -> len - written, &num_writ );
+            if ( rc == 0 && num_writ == 0 ) {
+                rc = RC( rcApp, rcNoTarg, rcWriting, rcTransfer, rcIncomplete );
+            }
+            written += num_writ;
+        }
+    }
+    self -> len = 0;
+    return rc;
+}
+
+rc_t sam_line_end( struct sam_line * self ) {
+    rc_t rc = sam_line_char( self, '\n' );
+    if ( rc == 0 ) {
+        rc = sam_line_flush( self );
+    }
+    return rc;
+}
+
+rc_t sam_line_char( struct sam_line * self, char c ) {
+    rc_t rc = reserve( self, 1 );
+    if ( rc == 0 ) {
+        self -> buf[ self -> len++ ] = c;
+    }
+    return rc;
+}
+
+rc_t sam_line_str( struct sam_line * self, const char * s, uint32_t len ) {
+    rc_t rc = reserve( self, len );
+    if ( rc == 0 && len > 0 ) {
+        memmove( &( self -> buf[ self -> len ] ), s, len );
+        self -> len += len;
+    }
+    return rc;
+}
+
+rc_t sam_line_cstr( struct sam_line * self, const char * s ) {
+    return sam_line_str( self, s, ( uint32_t )string_size( s ) );
+}
+
+/* the digits are produced from the back, 2 at a time */
+static size_t print_u64( char * dst, uint64_t value ) {
+    char tmp[ 20 ];
+    char * p = tmp + sizeof tmp;
+    size_t n;
+    while ( value >= 100 ) {
+        uint32_t i = ( uint32_t )( value % 100 ) * 2;
+        value /= 100;
+        p -= 2;
+        p[ 0 ] = digit_pairs[ i ];
+        p[ 1 ] = digit_pairs[ i + 1 ];
+    }
+    if ( value >= 10 ) {
+        uint32_t i = ( uint32_t )value * 2;
+        p -= 2;
+        p[ 0 ] = digit_pairs[ i ];
+        p[ 1 ] = digit_pairs[ i + 1 ];
+    } else {
+        *( --p ) = ( char )( '0' + value );
+    }
+    n = ( tmp + sizeof tmp ) - p;
+    memcpy( dst, p, n );
+    return n;
+}
+
+rc_t sam_line_u64( struct sam_line * self, uint64_t value ) {
+    rc_t rc = reserve( self, 20 );
+    if ( rc == 0 ) {
+        self -> len += print_u64( &( self -> buf[ self -> len ] ), value );
+    }
+    return rc;
+}
+
+rc_t sam_line_i64( struct sam_line * self, int64_t value ) {
+    rc_t rc = reserve( self, 21 );
+    if ( rc == 0 ) {
+        uint64_t u = ( uint64_t )value;
+        if ( value < 0 ) {
+            self -> buf[ self -> len++ ] = '-';
+            u = ~u + 1;
+        }
+        self -> len += print_u64( &( self -> buf[ self -> len ] ), u );
+    }
+    return rc;
+}
+
+rc_t sam_line_str_tab( struct sam_line * self, const char * s, uint32_t len ) {
+    rc_t rc = sam_line_str( self, s, len );
+    if ( rc == 0 ) {
+        rc = sam_line_char( self, '\t' );
+    }
+    return rc;
+}
+
+rc_t sam_line_u64_tab( struct sam_line * self, uint64_t value ) {
+    rc_t rc = sam_line_u64( self, value );
+    if ( rc == 0 ) {
+        rc = sam_line_char( self, '\t' );
+    }
+    return rc;
+}
+
+rc_t sam_line_i64_tab( struct sam_line * self, int64_t value ) {
+    rc_t rc = sam_line_i64( self, value );
+    if ( rc == 0 ) {
+        rc = sam_line_char( self, '\t' );
+    }
+    return rc;
+}
+
+/* the same variants as make_name() in sam-dump-opts.c */
+rc_t sam_line_name( struct sam_line * self, int64_t seq_spot_id,
+                    const char * spot_group, uint32_t spot_group_len ) {
+    const samdump_opts * opts = self -> opts;
+    bool has_spot_group = ( spot_group != NULL && spot_group_len > 0 );
+    rc_t rc = 0;
+    if ( opts -> print_cg_names ) {
+        if ( has_spot_group ) {
+            rc = sam_line_str( self, spot_group, spot_group_len );
+            if ( rc == 0 ) {
+                rc = sam_line_str( self, "-1:", 3 );
+            }
+        }
+        if ( rc == 0 ) {
+            rc = sam_line_u64( self, ( uint64_t )seq_spot_id );
+        }
+    } else {
+        if ( opts -> qname_prefix != NULL ) {
+            rc = sam_line_cstr( self, opts -> qname_prefix );
+            if ( rc == 0 ) {
+                rc = sam_line_char( self, '.' );
+            }
+        }
+        if ( rc == 0 ) {
+            rc = sam_line_u64( self, ( uint64_t )seq_spot_id );
+        }
+        if ( rc == 0 && opts -> print_spot_group_in_name && has_spot_group ) {
+            rc = sam_line_char( self, '.' );
+            if ( rc == 0 ) {
+                rc = sam_line_str( self, spot_group, spot_group_len );
+            }
+        }
+    }
+    return rc;
+}
+
+rc_t sam_line_qual( struct sam_line * self, const char * quality, uint32_t len, bool reverse ) {
+    rc_t rc = reserve( self, len );
+    if ( rc == 0 ) {
+        const uint8_t * src = ( const uint8_t * )quality;
+        char * dst = &( self -> buf[ self -> len ] );
+        uint32_t i;
+        if ( reverse ) {
+            for ( i = 0; i < len; ++i ) {
+                dst[ i ] = self -> qual_33[ src[ len - i - 1 ] ];
+            }
+        } else {
+            for ( i = 0; i < len; ++i ) {
+                dst[ i ] = self -> qual_33[ src[ i ] ];
+            }
+        }
+        self -> len += len;
+    }
+    return rc;
+}
+
+static rc_t tag_start( sam_line * self, const char * tag, char type ) {
+    rc_t rc = reserve( self, 6 );
+    if ( rc == 0 ) {
+        char * dst = &( self -> buf[ self -> len ] );
+        dst[ 0 ] = '\t';
+        dst[ 1 ] = tag[ 0 ];
+        dst[ 2 ] = tag[ 1 ];
+        dst[ 3 ] = ':';
+        dst[ 4 ] = type;
+        dst[ 5 ] = ':';
+        self -> len += 6;
+    }
+    return rc;
+}
+
+rc_t sam_line_tag_i( struct sam_line * self, const char * tag, int64_t value ) {
+    rc_t rc = tag_start( self, tag, 'i' );
+    if ( rc == 0 ) {
+        rc = sam_line_i64( self, value );
+    }
+    return rc;
+}
+
+rc_t sam_line_tag_Z( struct sam_line * self, const char * tag, const char * value, uint32_t len ) {
+    rc_t rc = tag_start( self, tag, 'Z' );
+    if ( rc == 0 ) {
+        rc = sam_line_str( self, value, len );
+    }
+    return rc;
+}
+
+rc_t sam_line_tag_A( struct sam_line * self, const char * tag, char c ) {
+    rc_t rc = tag_start( self, tag, 'A' );
+    if ( rc == 0 ) {
+        rc = sam_line_char( self, c );
+    }
+    return rc;
+}
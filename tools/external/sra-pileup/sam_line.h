@@ -0,0 +1,85 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#ifndef _h_sam_line_
+#define _h_sam_line_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+/* ----------------------------------------------------------------------------------------
+   the record-formatter of the aligned printers: the fields of a SAM/FASTX-record are put
+   into a growable line-buffer ( integers via a digit-pair table, qualities via a lookup-table
+   that also does the quantization ), the finished line goes to the current KOut-writer
+   in one piece instead of one KOutMsg() per field
+   ---------------------------------------------------------------------------------------- */
+
+struct sam_line;
+struct samdump_opts;
+
+rc_t make_sam_line( struct sam_line ** self, const struct samdump_opts * opts );
+void release_sam_line( struct sam_line * self );
+
+/* the text of the line so far, for functions that print through KOutMsg() themselves */
+rc_t sam_line_flush( struct sam_line * self );
+
+/* appends '\n' and writes the line */
+rc_t sam_line_end( struct sam_line * self );
+
+rc_t sam_line_char( struct sam_line * self, char c );
+rc_t sam_line_str( struct sam_line * self, const char * s, uint32_t len );
+rc_t sam_line_cstr( struct sam_line * self, const char * s );
+rc_t sam_line_u64( struct sam_line * self, uint64_t value );
+rc_t sam_line_i64( struct sam_line * self, int64_t value );
+
+/* a field followed by a tab */
+rc_t sam_line_str_tab( struct sam_line * self, const char * s, uint32_t len );
+rc_t sam_line_u64_tab( struct sam_line * self, uint64_t value );
+rc_t sam_line_i64_tab( struct sam_line * self, int64_t value );
+
+/* the QNAME of make_name() in sam-dump-opts.c */
+rc_t sam_line_name( struct sam_line * self, int64_t seq_spot_id,
+                    const char * spot_group, uint32_t spot_group_len );
+
+/* phred+33 qualities, quantized if requested, like dump_quality_33() in sam-dump-opts.c */
+rc_t sam_line_qual( struct sam_line * self, const char * quality, uint32_t len, bool reverse );
+
+/* optional fields: "\tXX:i:value", "\tXX:Z:value", "\tXX:A:c" */
+rc_t sam_line_tag_i( struct sam_line * self, const char * tag, int64_t value );
+rc_t sam_line_tag_Z( struct sam_line * self, const char * tag, const char * value, uint32_t len );
+rc_t sam_line_tag_A( struct sam_line * self, const char * tag, char c );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
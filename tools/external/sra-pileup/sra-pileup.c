@@ -68,6 +68,10 @@
 #include "pileup_stat.h"
 #endif
 
+#ifndef _h_pileup_depth_
+#include "pileup_depth.h"
+#endif
+
 #ifndef _h_pileup_v2_
 #include "pileup_v2.h"
 #endif
@@ -80,6 +84,10 @@
 #include <klib/log.h>
 #endif
 
+#ifndef _h_klib_out_
+#include <klib/out.h>
+#endif
+
 #ifndef _h_klib_report_
 #include <klib/report.h>
 #endif
@@ -88,6 +96,22 @@
 #include <klib/vector.h>
 #endif
 
+#ifndef _h_klib_text_
+#include <klib/text.h> /* string_dup_measure() */
+#endif
+
+#ifndef _h_kproc_thread_
+#include <kproc/thread.h>
+#endif
+
+#ifndef _h_kproc_lock_
+#include <kproc/lock.h>
+#endif
+
+#ifndef _h_kproc_cond_
+#include <kproc/cond.h>
+#endif
+
 #ifndef _h_kdb_manager_
 #include <kdb/manager.h>  /* kptDatabase */
 #endif
@@ -142,6 +166,8 @@
 
 #define OPTION_DEPTH_PER_SPOTGRP	"depth-per-spotgroup"
 
+#define OPTION_THREADS "threads"
+
 #define OPTION_NGC "ngc"
 
 #define OPTION_FUNC    "function"
@@ -158,6 +184,7 @@
 #define FUNC_VARCOUNT   "varcount"
 #define FUNC_DELETES    "deletes"
 #define FUNC_INDELS     "indels"
+#define FUNC_DEPTH      "depth"
 
 enum {
     sra_pileup_samtools = 0,
@@ -171,7 +198,8 @@ enum {
     sra_pileup_test = 8,
     sra_pileup_varcount = 9,
     sra_pileup_deletes = 10,
-	sra_pileup_indels = 11
+	sra_pileup_indels = 11,
+    sra_pileup_depth = 12
 };
 
 static const char * minmapq_usage[]         = { "Minimum mapq-value, ",
@@ -196,6 +224,9 @@ static const char * merge_usage[]           = { "If adjacent slices are closer t
                                                 "they are merged and a skiplist is created. ",
                                                 "a value of zero disables the feature, default is 10000", NULL };
 
+static const char * threads_usage[]         = { "walk the references in windows with this many threads (dflt:1),",
+                                                "not for functions debug, test, stat, deletes, ref and ref-ex", NULL };
+
 static const char * func_ref_usage[]        = { "list references", NULL };
 static const char * func_ref_ex_usage[]     = { "list references + coverage", NULL };
 static const char * func_count_usage[]      = { "sort pileup with counters", NULL };
@@ -212,6 +243,9 @@ static const char * func_varcount_usage[]   = { "variation counters: ",
 
 static const char * func_deletes_usage[]    = { "list deletions greater then 20", NULL };
 
+static const char * func_depth_usage[]      = { "depth only, as bedGraph-intervals of equal depth: ",
+                                                "ref-name, start (0-based), end (exclusive), depth", NULL };
+
 static const char * func_usage[]            = { "alternative functionality", NULL };
 
 static const char * ngc_usage[] = { "path to ngc file", NULL };
@@ -228,6 +262,7 @@ OptDef MyOptions[] =
     { OPTION_SEQNAME,	ALIAS_SEQNAME,	NULL,	seqname_usage,	1,        false,       false },
     { OPTION_MIN_M,		NULL,			NULL,	min_m_usage,	1,        true,        false },
     { OPTION_MERGE,		NULL,			NULL,	merge_usage,	1,        true,        false },
+    { OPTION_THREADS,	NULL,			NULL,	threads_usage,	1,        true,        false },
     { OPTION_FUNC,		ALIAS_FUNC,		NULL,	func_usage,		1,        true,        false },
     { OPTION_NGC,       NULL,           NULL,   ngc_usage, 1, true, false },
 };
@@ -308,6 +343,12 @@ static rc_t get_pileup_options( Args * args, pileup_options *opts )
     if ( rc == 0 ) {
         rc = get_uint32_option( args, OPTION_MERGE, &opts->merge_dist, 10000 );
     }
+    if ( rc == 0 ) {
+        rc = get_uint32_option( args, OPTION_THREADS, &opts->num_threads, 1 );
+        if ( opts -> num_threads == 0 ) {
+            opts -> num_threads = 1;
+        }
+    }
     if ( rc == 0 ) {
         rc = get_bool_option( args, OPTION_DUPS, &opts->process_dups, false );
     }
@@ -352,6 +393,8 @@ static rc_t get_pileup_options( Args * args, pileup_options *opts )
                 opts -> function = sra_pileup_deletes;
             } else if ( cmp_pchar( fkt, FUNC_INDELS ) == 0 ) {
                 opts -> function = sra_pileup_indels;
+            } else if ( cmp_pchar( fkt, FUNC_DEPTH ) == 0 ) {
+                opts -> function = sra_pileup_depth;
             }
         }
     }
@@ -408,6 +451,7 @@ rc_t CC Usage ( const Args * args ) {
     HelpOptionLine ( ALIAS_SEQNAME, OPTION_SEQNAME, NULL, seqname_usage );
     HelpOptionLine ( NULL, OPTION_MIN_M, NULL, min_m_usage );
     HelpOptionLine ( NULL, OPTION_MERGE, NULL, merge_usage );
+    HelpOptionLine ( NULL, OPTION_THREADS, "count", threads_usage );
 
     HelpOptionLine ( NULL, "function ref",      NULL, func_ref_usage );
     HelpOptionLine ( NULL, "function ref-ex",   NULL, func_ref_ex_usage );
@@ -418,6 +462,7 @@ rc_t CC Usage ( const Args * args ) {
     HelpOptionLine ( NULL, "function varcount", NULL, func_varcount_usage );
     HelpOptionLine ( NULL, "function deletes",  NULL, func_deletes_usage );
     HelpOptionLine ( NULL, "function indels",   NULL, func_indels_usage );
+    HelpOptionLine ( NULL, "function depth",    NULL, func_depth_usage );
 
     KOutMsg ( "\nGrouping of accessions into artificial spotgroups:\n" );
     KOutMsg ( "  sra-pileup SRRXXXXXX=a SRRYYYYYY=b SRRZZZZZZ=a\n\n" );
@@ -1047,6 +1092,64 @@ static bool row_not_found_while_reading_column( rc_t rc ) {
              rcNotFound == GetRCState( rc ) );
 }
 
+/* the section of the reference prepare_section_cb() loads, 1-based, end inclusive */
+static void section_bounds( const struct reference_range * range, INSDC_coord_len len,
+                            uint32_t * start, uint32_t * end ) {
+    if ( range == NULL ) {
+        *start = 1;
+        *end = ( len - *start ) + 1;
+    } else {
+        *start = get_ref_range_start( range );
+        *end   = get_ref_range_end( range );
+    }
+
+    if ( *start == 0 ) { *start = 1; }
+    if ( ( *end == 0 )||( *end > len + 1 ) ) { *end = ( len - *start ) + 1; }
+}
+
+/* the placements of a section go into the reference-iterator, or ( depth ) into the placement-set-iterator */
+static rc_t add_section_placements( prepare_ctx * ctx, uint32_t start, uint32_t end,
+                                    const VCursor * cursor, align_id_src ids, pileup_col_ids * cur_ids ) {
+    rc_t rc;
+    if ( ctx -> ref_iter != NULL ) {
+        rc = ReferenceIteratorAddPlacements( ctx -> ref_iter,       /* the outer ref-iter */
+                                             ctx -> refobj,         /* the ref-obj for this chromosome */
+                                             start - 1,             /* start ( zero-based ) */
+                                             end - start + 1,       /* length */
+                                             NULL,                  /* ref-cursor */
+                                             cursor,                /* align-cursor */
+                                             ids,                   /* which id's */
+                                             ctx -> spot_group,     /* what read-group */
+                                             cur_ids                /* placement-context */
+                                            );
+    } else {
+        PlacementIterator *pl_iter;
+        rc = ReferenceObj_MakePlacementIterator( ctx -> refobj,     /* the ref-obj for this chromosome */
+                                                 &pl_iter,          /* the placement-iterator we want to make */
+                                                 start - 1,         /* start ( zero-based ) */
+                                                 end - start + 1,   /* length */
+                                                 ctx -> min_mapq,   /* the ref-iter gets it at creation */
+                                                 NULL,              /* ref-cursor */
+                                                 cursor,            /* align-cursor */
+                                                 ids,               /* which id's */
+                                                 NULL,              /* no placement-record extensions #0 */
+                                                 ctx -> plset_ext,  /* extensions #1, as the ref-iter has them */
+                                                 ctx -> spot_group, /* what read-group */
+                                                 cur_ids            /* placement-context */
+                                                );
+        if ( rc == 0 ) {
+            rc = PlacementSetIteratorAddPlacementIterator ( ctx -> plset_iter, pl_iter );
+            /* if the set was not able to take ownership of the iterator, release it here */
+            if ( rc != 0 ) {
+                PlacementIteratorRelease( pl_iter );
+            }
+            /* rcDone: the iterator has no placements inside, that is OK */
+            if ( GetRCState( rc ) == rcDone ) { rc = 0; }
+        }
+    }
+    return rc;
+}
+
 static rc_t CC prepare_section_cb( prepare_ctx * ctx, const struct reference_range * range ) {
     rc_t rc = 0;
     INSDC_coord_len len;
@@ -1064,16 +1167,7 @@ static rc_t CC prepare_section_cb( prepare_ctx * ctx, const struct reference_ran
             uint32_t start, end;
             rc_t rc1 = 0, rc2 = 0, rc3 = 0;
 
-            if ( range == NULL ) {
-                start = 1;
-                end = ( len - start ) + 1;
-            } else {
-                start = get_ref_range_start( range );
-                end   = get_ref_range_end( range );
-            }
-
-            if ( start == 0 ) { start = 1; }
-            if ( ( end == 0 )||( end > len + 1 ) ) { end = ( len - start ) + 1; }
+            section_bounds( range, len, &start, &end );
 
             /* depending on ctx->select prepare primary, secondary or both... */
             if ( ctx->use_primary_alignments ) {
@@ -1090,20 +1184,11 @@ static rc_t CC prepare_section_cb( prepare_ctx * ctx, const struct reference_ran
 
                 if ( rc1 == 0 ) {
                     /* show_placement_params( "primary", ctx->refobj, start, end ); */
-                    rc1 = ReferenceIteratorAddPlacements( ctx -> ref_iter,       /* the outer ref-iter */
-                                                          ctx -> refobj,         /* the ref-obj for this chromosome */
-                                                          start - 1,             /* start ( zero-based ) */
-                                                          end - start + 1,       /* length */
-                                                          NULL,                  /* ref-cursor */
-                                                          ctx -> prim_cur,       /* align-cursor */
-                                                          primary_align_ids,     /* which id's */
-                                                          ctx -> spot_group,     /* what read-group */
-                                                          ctx -> prim_cur_ids    /* placement-context */
-                                                         );
+                    rc1 = add_section_placements( ctx, start, end, ctx -> prim_cur, primary_align_ids, ctx -> prim_cur_ids );
                     if ( rc1 != 0 && !row_not_found_while_reading_column( rc1 ) ) {
                         /* row_not_found_while_reading column within VDB happens if the
                          requested reference-slice is empty, let's silence that */
-                        LOGERR( klogInt, rc1, "ReferenceIteratorAddPlacements(prim) failed" );
+                        LOGERR( klogInt, rc1, "adding primary placements failed" );
                     }
                 }
             }
@@ -1121,20 +1206,11 @@ static rc_t CC prepare_section_cb( prepare_ctx * ctx, const struct reference_ran
 
                 if ( rc2 == 0 ) {
                     /* show_placement_params( "secondary", ctx->refobj, start, end ); */
-                    rc2 = ReferenceIteratorAddPlacements( ctx -> ref_iter,       /* the outer ref-iter */
-                                                          ctx -> refobj,         /* the ref-obj for this chromosome */
-                                                          start - 1,             /* start ( zero-based ) */
-                                                          end - start + 1,       /* length */
-                                                          NULL,                  /* ref-cursor */
-                                                          ctx -> sec_cur,        /* align-cursor */
-                                                          secondary_align_ids,   /* which id's */
-                                                          ctx -> spot_group,     /* what read-group */
-                                                          ctx -> sec_cur_ids     /* placement-context */
-                                                         );
+                    rc2 = add_section_placements( ctx, start, end, ctx -> sec_cur, secondary_align_ids, ctx -> sec_cur_ids );
                     if ( rc2 != 0 && !row_not_found_while_reading_column( rc2 ) ) {
                         /* row_not_found_while_reading column within VDB happens if the
                          requested reference-slice is empty, let's silence that */
-                        LOGERR( klogInt, rc2, "ReferenceIteratorAddPlacements(sec) failed" );
+                        LOGERR( klogInt, rc2, "adding secondary placements failed" );
                     }
                 }
             }
@@ -1152,20 +1228,11 @@ static rc_t CC prepare_section_cb( prepare_ctx * ctx, const struct reference_ran
 
                 if ( rc3 == 0 ) {
                     /* show_placement_params( "evidende", ctx->refobj, start, end ); */
-                    rc3 = ReferenceIteratorAddPlacements( ctx -> ref_iter,       /* the outer ref-iter */
-                                                          ctx -> refobj,         /* the ref-obj for this chromosome */
-                                                          start - 1,             /* start ( zero-based ) */
-                                                          end - start + 1,       /* length */
-                                                          NULL,                  /* ref-cursor */
-                                                          ctx -> ev_cur,         /* align-cursor */
-                                                          evidence_align_ids,    /* which id's */
-                                                          ctx -> spot_group,     /* what read-group */
-                                                          ctx -> ev_cur_ids      /* placement-context */
-                                                         );
+                    rc3 = add_section_placements( ctx, start, end, ctx -> ev_cur, evidence_align_ids, ctx -> ev_cur_ids );
                     if ( rc3 != 0 && !row_not_found_while_reading_column( rc3 ) ) {
                         /* row_not_found_while_reading column within VDB happens if the
                          requested reference-slice is empty, let's silence that */
-                        LOGERR( klogInt, rc3, "ReferenceIteratorAddPlacements(evidence) failed" );
+                        LOGERR( klogInt, rc3, "adding evidence placements failed" );
                     }
                 }
             }
@@ -1191,24 +1258,24 @@ typedef struct foreach_arg_ctx {
     const VDBManager *vdb_mgr;
     VSchema *vdb_schema;
     ReferenceIterator *ref_iter;
+    PlacementSetIterator *plset_iter;               /* instead of ref_iter for depth */
+    const PlacementRecordExtendFuncs *plset_ext;
     BSTree *ranges;
     Vector *cursor_ids;
 } foreach_arg_ctx;
 
 
-/* called for each source-file/accession */
-static rc_t CC on_argument( const char * path, const char * spot_group, void * data ) {
+/* is the source-file/accession a cSRA-database? */
+static rc_t check_csra_source( const VDBManager *vdb_mgr, VSchema *vdb_schema, const char * path ) {
     rc_t rc = 0;
-    foreach_arg_ctx * ctx = ( foreach_arg_ctx * )data;
-
-    int path_type = ( VDBManagerPathType ( ctx -> vdb_mgr, "%s", path ) & ~ kptAlias );
+    int path_type = ( VDBManagerPathType ( vdb_mgr, "%s", path ) & ~ kptAlias );
     ReportResetObject ( path );
     if ( path_type != kptDatabase ) {
         rc = RC ( rcApp, rcNoTarg, rcOpening, rcItem, rcUnsupported );
         PLOGERR( klogErr, ( klogErr, rc, "failed to open '$(path)', it is not a vdb-database", "path=%s", path ) );
     } else {
         const VDatabase *db;
-        rc = VDBManagerOpenDBRead ( ctx -> vdb_mgr, &db, ctx -> vdb_schema, "%s", path );
+        rc = VDBManagerOpenDBRead ( vdb_mgr, &db, vdb_schema, "%s", path );
         if ( rc != 0 ) {
             rc = RC ( rcApp, rcNoTarg, rcOpening, rcItem, rcUnsupported );
             PLOGERR( klogErr, ( klogErr, rc, "failed to open '$(path)'", "path=%s", path ) );
@@ -1218,38 +1285,55 @@ static rc_t CC on_argument( const char * path, const char * spot_group, void * d
             if ( !is_csra ) {
                 rc = RC ( rcApp, rcNoTarg, rcOpening, rcItem, rcUnsupported );
                 PLOGERR( klogErr, ( klogErr, rc, "failed to open '$(path)', it is not a csra-database", "path=%s", path ) );
-            } else {
-                prepare_ctx prep;   /* from cmdline_cmn.h */
-
-                prep . omit_qualities = ctx -> options -> cmn . omit_qualities;
-                prep . read_tlen = ctx -> options -> read_tlen;
-                prep . use_primary_alignments = ( ( ctx -> options -> cmn . tab_select & primary_ats ) == primary_ats );
-                prep . use_secondary_alignments = ( ( ctx -> options -> cmn . tab_select & secondary_ats ) == secondary_ats );
-                prep . use_evidence_alignments = ( ( ctx -> options -> cmn . tab_select & evidence_ats ) == evidence_ats );
-                prep . ref_iter = ctx -> ref_iter;
-                prep . spot_group = spot_group;
-                prep . on_section = prepare_section_cb;
-                prep . data = ctx -> cursor_ids;
-                prep . path = path;
-                prep . db = NULL;
-                prep . prim_cur = NULL;
-                prep . sec_cur = NULL;
-                prep . ev_cur = NULL;
-
-                rc = prepare_ref_iter( &prep, ctx -> vdb_mgr, ctx -> vdb_schema, path, ctx -> ranges ); /* cmdline_cmn.c */
-                if ( rc == 0 && prep . db == NULL ) {
-                    rc = RC ( rcApp, rcNoTarg, rcOpening, rcSelf, rcInvalid );
-                    LOGERR( klogInt, rc, "unsupported source" );
-                }
-                if ( prep . prim_cur != NULL ) { VCursorRelease( prep.prim_cur ); }
-                if ( prep . sec_cur != NULL ) { VCursorRelease( prep.sec_cur ); }
-                if ( prep . ev_cur != NULL ) { VCursorRelease( prep.ev_cur ); }
             }
         }
     }
     return rc;
 }
 
+static void init_prepare_ctx( prepare_ctx * prep, const pileup_options * options, const char * path,
+                              const char * spot_group, Vector * cursor_ids ) {
+    memset( prep, 0, sizeof * prep );
+    prep -> omit_qualities = options -> cmn . omit_qualities;
+    prep -> read_tlen = options -> read_tlen;
+    prep -> use_primary_alignments = ( ( options -> cmn . tab_select & primary_ats ) == primary_ats );
+    prep -> use_secondary_alignments = ( ( options -> cmn . tab_select & secondary_ats ) == secondary_ats );
+    prep -> use_evidence_alignments = ( ( options -> cmn . tab_select & evidence_ats ) == evidence_ats );
+    prep -> spot_group = spot_group;
+    prep -> on_section = prepare_section_cb;
+    prep -> data = cursor_ids;
+    prep -> path = path;
+    prep -> min_mapq = options -> minmapq;
+}
+
+static void release_prepare_cursors( prepare_ctx * prep ) {
+    if ( prep -> prim_cur != NULL ) { VCursorRelease( prep -> prim_cur ); }
+    if ( prep -> sec_cur != NULL ) { VCursorRelease( prep -> sec_cur ); }
+    if ( prep -> ev_cur != NULL ) { VCursorRelease( prep -> ev_cur ); }
+}
+
+/* called for each source-file/accession */
+static rc_t CC on_argument( const char * path, const char * spot_group, void * data ) {
+    foreach_arg_ctx * ctx = ( foreach_arg_ctx * )data;
+    rc_t rc = check_csra_source( ctx -> vdb_mgr, ctx -> vdb_schema, path );
+    if ( rc == 0 ) {
+        prepare_ctx prep;   /* from cmdline_cmn.h */
+
+        init_prepare_ctx( &prep, ctx -> options, path, spot_group, ctx -> cursor_ids );
+        prep . ref_iter = ctx -> ref_iter;
+        prep . plset_iter = ctx -> plset_iter;
+        prep . plset_ext = ctx -> plset_ext;
+
+        rc = prepare_ref_iter( &prep, ctx -> vdb_mgr, ctx -> vdb_schema, path, ctx -> ranges ); /* cmdline_cmn.c */
+        if ( rc == 0 && prep . db == NULL ) {
+            rc = RC ( rcApp, rcNoTarg, rcOpening, rcSelf, rcInvalid );
+            LOGERR( klogInt, rc, "unsupported source" );
+        }
+        release_prepare_cursors( &prep );
+    }
+    return rc;
+}
+
 
 /* free all cursor-ids-blocks created in parallel with the alignment-cursor */
 static void CC cur_id_vector_entry_whack( void *item, void *data ) {
@@ -1257,9 +1341,640 @@ static void CC cur_id_vector_entry_whack( void *item, void *data ) {
     free( ids );
 }
 
+/* -------------------------------------------------------------------------------------------
+   more than one thread ( --threads ): the references ( or the requested regions ) are cut into
+   windows at multiples of PILEUP_WINDOW_SIZE positions. Every worker-thread takes the next window, loads a
+   reference-iterator of its own with the placements of all sources overlapping the window, and
+   walks it with the walker of the requested function. An alignment reaching over the border of
+   a window is loaded by both windows, but a reference-iterator visits only the positions of its
+   window: every position is produced by exactly one window, with its complete pileup.
+   The text of a window is collected in a buffer, the main-thread writes the buffers in
+   window-order, which is the order of the single reference-iterator.
+   The strand/tlen-statistic is not walked in windows: its sliding window reaches from one
+   reference into the next, it stays single-threaded.
+   The depth is loaded into a placement-set-iterator per window, it cuts its runs of equal depth at
+   the same multiples of DEPTH_CHUNK_SIZE as the windows: the output does not depend on the threads.
+   Each worker has its own reference-lists, cursors and skiplist, the databases stay open
+   across the windows of a worker.
+   ------------------------------------------------------------------------------------------- */
+
+#define PILEUP_WINDOW_SIZE DEPTH_CHUNK_SIZE     /* pileup_depth.h */
+#define PILEUP_WINDOW_BUFSIZE ( 64 * 1024 )
+#define PILEUP_WINDOWS_AHEAD 4      /* per worker: windows in work or done, but not written yet */
+
+#if WINDOWS
+#define PILEUP_THREAD_LOCAL __declspec( thread )
+#else
+#define PILEUP_THREAD_LOCAL __thread
+#endif
+
+/* the buffer of the window the calling worker-thread walks, NULL in the main-thread */
+static PILEUP_THREAD_LOCAL struct dyn_string * window_out = NULL;
+
+typedef struct window_out_handler {
+    KWrtWriter org_writer;
+    void * org_data;
+} window_out_handler;
+
+/* the KOut-handler while the workers run: the KOutMsg()'s of the walkers
+   land in the window-buffer of the calling worker, the main-thread writes through */
+static rc_t CC write_to_window( void * self, const char * buffer, size_t bufsize, size_t * num_writ ) {
+    rc_t rc;
+    if ( window_out != NULL ) {
+        rc = ds_add_mem( window_out, buffer, bufsize ); /* dyn_string.c */
+        *num_writ = ( rc == 0 ) ? bufsize : 0;
+    } else {
+        window_out_handler * h = self;
+        rc = h -> org_writer( h -> org_data, buffer, bufsize, num_writ );
+    }
+    return rc;
+}
+
+typedef rc_t ( * pileup_walker )( ReferenceIterator *ref_iter, pileup_options *options );
+
+/* the walker of a window, NULL if the function cannot be walked in windows */
+static pileup_walker get_window_walker( uint32_t function ) {
+    switch( function ) {
+        case sra_pileup_samtools    : return walk_ref_iter;
+        case sra_pileup_counters    : return walk_counters;
+        case sra_pileup_mismatch    : return walk_mismatches;
+        case sra_pileup_index       : return walk_index;
+        case sra_pileup_varcount    : return walk_varcount;
+        case sra_pileup_indels      : return walk_indels;
+    }
+    return NULL;    /* debug shows the windows of the single reference-iterator,
+                       stat carries its sliding window from one reference into the next */
+}
+
+static bool use_pileup_threads( const pileup_options * options ) {
+    return ( options -> num_threads > 1 &&
+             !options -> cmn . no_mt &&
+             ( get_window_walker( options -> function ) != NULL ||
+               options -> function == sra_pileup_depth ) );
+}
+
+typedef struct pileup_source {
+    char * path;
+    char * spot_group;              /* NULL if not given, empty if divided by the original spot-groups */
+} pileup_source;
+
+typedef struct pileup_ref {
+    char * name;                    /* the name the sources find the reference by */
+    uint32_t src_idx;               /* the first source that has the reference */
+} pileup_ref;
+
+typedef struct pileup_window {
+    const pileup_ref * ref;
+    uint32_t start;                 /* 1-based, like a reference-range */
+    uint32_t end;                   /* inclusive */
+    struct dyn_string * out;        /* made by the worker, written and freed by the main-thread */
+    bool done;
+} pileup_window;
+
+typedef struct pileup_pool {
+    pileup_options * options;
+    pileup_callback_data * cb_data;
+    const VDBManager * vdb_mgr;
+    VSchema * vdb_schema;
+    BSTree * regions;
+    pileup_walker walker;          /* NULL for depth, it walks a placement-set-iterator */
+    Vector sources;                 /* pileup_source's, in the order of the arguments */
+    Vector refs;                    /* pileup_ref's, in the order the windows are made */
+    pileup_window * windows;
+    uint32_t window_count;
+    uint32_t next_window;           /* the next window to be handed to a worker */
+    uint32_t next_output;           /* the next window to be written */
+    uint32_t max_ahead;
+    KLock * lock;
+    KCondition * window_done;       /* a worker has finished a window */
+    KCondition * window_written;    /* the main-thread has written a window */
+    rc_t rc;                        /* the first error, stops everybody */
+} pileup_pool;
+
+typedef struct pileup_worker {
+    pileup_pool * pool;
+    pileup_options options;         /* a copy, with a skiplist of its own */
+    prepare_ctx * prep;             /* one for each source, the databases stay open across windows */
+    Vector cursor_ids;
+    KThread * thread;
+} pileup_worker;
+
+/* called for each source-file/accession: check it and remember it for the workers */
+static rc_t CC on_pileup_source( const char * path, const char * spot_group, void * data ) {
+    pileup_pool * pool = data;
+    rc_t rc = check_csra_source( pool -> vdb_mgr, pool -> vdb_schema, path );
+    if ( rc == 0 ) {
+        pileup_source * src = calloc( 1, sizeof * src );
+        if ( src == NULL ) {
+            rc = RC ( rcApp, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        } else {
+            src -> path = string_dup_measure( path, NULL );
+            if ( spot_group != NULL ) {
+                src -> spot_group = string_dup_measure( spot_group, NULL );
+            }
+            if ( src -> path == NULL || ( spot_group != NULL && src -> spot_group == NULL ) ) {
+                rc = RC ( rcApp, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+            } else {
+                rc = VectorAppend ( &( pool -> sources ), NULL, src );
+            }
+            if ( rc != 0 ) {
+                free( src -> path );
+                free( src -> spot_group );
+                free( src );
+            }
+        }
+        if ( rc != 0 ) {
+            LOGERR( klogErr, rc, "cannot remember source" );
+        }
+    }
+    return rc;
+}
+
+static void CC pileup_source_whack( void * item, void * data ) {
+    pileup_source * src = item;
+    free( src -> path );
+    free( src -> spot_group );
+    free( src );
+}
+
+static void CC pileup_ref_whack( void * item, void * data ) {
+    pileup_ref * ref = item;
+    free( ref -> name );
+    free( ref );
+}
+
+/* the reference, if an earlier source has it already, its windows are made */
+static const pileup_ref * find_pileup_ref( const pileup_pool * pool, const char * name, uint32_t src_idx ) {
+    uint32_t idx, count = VectorLength( &( pool -> refs ) );
+    for ( idx = 0; idx < count; ++idx ) {
+        const pileup_ref * ref = VectorGet( &( pool -> refs ), idx );
+        if ( ref -> src_idx != src_idx && cmp_pchar( ref -> name, name ) == 0 ) {
+            return ref;
+        }
+    }
+    return NULL;
+}
+
+static rc_t add_pileup_window( pileup_pool * pool, uint32_t * allocated, const pileup_window * win ) {
+    rc_t rc = 0;
+    if ( pool -> window_count >= *allocated ) {
+        uint32_t new_allocated = ( *allocated == 0 ) ? 1024 : *allocated * 2;
+        pileup_window * tmp = realloc( pool -> windows, new_allocated * sizeof * tmp );
+        if ( tmp == NULL ) {
+            rc = RC ( rcApp, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+            LOGERR( klogErr, rc, "cannot allocate window-list" );
+        } else {
+            pool -> windows = tmp;
+            *allocated = new_allocated;
+        }
+    }
+    if ( rc == 0 ) {
+        pool -> windows[ pool -> window_count++ ] = *win;
+    }
+    return rc;
+}
+
+typedef struct window_maker {
+    pileup_pool * pool;
+    prepare_ctx * prep;
+    uint32_t src_idx;
+    uint32_t allocated;
+} window_maker;
+
+/* cut the section of the reference prepare_section_cb() would load into windows */
+static rc_t make_ref_windows( window_maker * wm, const char * name, const struct reference_range * range ) {
+    pileup_pool * pool = wm -> pool;
+    const ReferenceObj * refobj;
+    rc_t rc;
+
+    if ( find_pileup_ref( pool, name, wm -> src_idx ) != NULL ) {
+        return 0;   /* an earlier source has the reference, the iterator of the window gets this source too */
+    }
+    rc = ReferenceList_Find( wm -> prep -> reflist, &refobj, name, string_size( name ) );
+    if ( rc != 0 ) {
+        rc = 0;     /* this source does not have the requested reference */
+    } else {
+        INSDC_coord_len len;
+        rc = ReferenceObj_SeqLength( refobj, &len );
+        if ( rc != 0 ) {
+            LOGERR( klogInt, rc, "ReferenceObj_SeqLength() failed" );
+        } else {
+            pileup_ref * ref = NULL;
+            uint32_t idx, count = VectorLength( &( pool -> refs ) );
+
+            /* more ranges on the same reference come from the same source */
+            for ( idx = 0; idx < count && ref == NULL; ++idx ) {
+                pileup_ref * r = VectorGet( &( pool -> refs ), idx );
+                if ( r -> src_idx == wm -> src_idx && cmp_pchar( r -> name, name ) == 0 ) {
+                    ref = r;
+                }
+            }
+            if ( ref == NULL ) {
+                ref = calloc( 1, sizeof * ref );
+                if ( ref == NULL ) {
+                    rc = RC ( rcApp, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+                } else {
+                    ref -> name = string_dup_measure( name, NULL );
+                    ref -> src_idx = wm -> src_idx;
+                    if ( ref -> name == NULL ) {
+                        rc = RC ( rcApp, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+                    } else {
+                        rc = VectorAppend ( &( pool -> refs ), NULL, ref );
+                    }
+                    if ( rc != 0 ) {
+                        pileup_ref_whack( ref, NULL );
+                        LOGERR( klogErr, rc, "cannot remember reference" );
+                    }
+                }
+            }
+            if ( rc == 0 ) {
+                uint32_t start, end;
+                uint64_t pos;
+
+                section_bounds( range, len, &start, &end );
+                for ( pos = start; pos <= end && rc == 0; ) {
+                    pileup_window win;
+                    /* the last position ( 1-based ) of the PILEUP_WINDOW_SIZE-chunk pos is in */
+                    uint64_t last = ( ( pos - 1 ) / PILEUP_WINDOW_SIZE + 1 ) * PILEUP_WINDOW_SIZE;
+                    memset( &win, 0, sizeof win );
+                    win . ref = ref;
+                    win . start = ( uint32_t )pos;
+                    if ( last > end ) {
+                        win . end = end;
+                    } else {
+                        win . end = ( uint32_t )last;
+                    }
+                    rc = add_pileup_window( pool, &( wm -> allocated ), &win );
+                    pos = ( uint64_t )win . end + 1;
+                }
+            }
+        }
+        ReferenceObj_Release( refobj );
+    }
+    return rc;
+}
+
+static rc_t CC make_region_windows( const char * name, const struct reference_range * range, void * data ) {
+    return make_ref_windows( data, name, range );
+}
+
+/* the windows in the order of the single reference-iterator: source, reference/region, position */
+static rc_t make_pileup_windows( pileup_pool * pool ) {
+    window_maker wm;
+    uint32_t count = VectorLength( &( pool -> sources ) );
+    rc_t rc = 0;
+
+    wm . pool = pool;
+    wm . allocated = 0;
+    for ( wm . src_idx = 0; wm . src_idx < count && rc == 0; wm . src_idx++ ) {
+        const pileup_source * src = VectorGet( &( pool -> sources ), wm . src_idx );
+        prepare_ctx prep;
+        init_prepare_ctx( &prep, pool -> options, src -> path, src -> spot_group, NULL );
+        wm . prep = &prep;
+        rc = open_prepare_db( &prep, pool -> vdb_mgr, pool -> vdb_schema, src -> path ); /* cmdline_cmn.c */
+        if ( rc == 0 ) {
+            if ( count_ref_regions( pool -> regions ) == 0 ) {
+                /* the user has not specified a reference-range : use the whole file... */
+                uint32_t ref_count;
+                rc = ReferenceList_Count( prep . reflist, &ref_count );
+                if ( rc != 0 ) {
+                    LOGERR( klogInt, rc, "ReferenceList_Count() failed" );
+                } else {
+                    uint32_t idx;
+                    for ( idx = 0; idx < ref_count && rc == 0; ++idx ) {
+                        const ReferenceObj * refobj;
+                        rc = ReferenceList_Get( prep . reflist, &refobj, idx );
+                        if ( rc != 0 ) {
+                            LOGERR( klogInt, rc, "ReferenceList_Get() failed" );
+                        } else {
+                            const char * name;
+                            rc = ReferenceObj_Name( refobj, &name );
+                            if ( rc != 0 ) {
+                                LOGERR( klogInt, rc, "ReferenceObj_Name() failed" );
+                            } else {
+                                rc = make_ref_windows( &wm, name, NULL );
+                            }
+                            ReferenceObj_Release( refobj );
+                        }
+                    }
+                }
+            } else {
+                /* pick only the requested ranges... */
+                rc = foreach_ref_region( pool -> regions, make_region_windows, &wm ); /* ref_regions.c */
+            }
+        }
+        close_prepare_db( &prep ); /* cmdline_cmn.c */
+    }
+    return rc;
+}
+
+static rc_t open_worker_sources( pileup_worker * w ) {
+    pileup_pool * pool = w -> pool;
+    uint32_t idx, count = VectorLength( &( pool -> sources ) );
+    rc_t rc = 0;
+
+    w -> prep = calloc( count, sizeof w -> prep[ 0 ] );
+    if ( w -> prep == NULL ) {
+        rc = RC ( rcApp, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        LOGERR( klogErr, rc, "cannot allocate source-contexts" );
+    }
+    for ( idx = 0; idx < count && rc == 0; ++idx ) {
+        const pileup_source * src = VectorGet( &( pool -> sources ), idx );
+        init_prepare_ctx( &( w -> prep[ idx ] ), &( w -> options ), src -> path, src -> spot_group, &( w -> cursor_ids ) );
+        rc = open_prepare_db( &( w -> prep[ idx ] ), pool -> vdb_mgr, pool -> vdb_schema, src -> path ); /* cmdline_cmn.c */
+    }
+    return rc;
+}
+
+static void release_worker_sources( pileup_worker * w ) {
+    if ( w -> prep != NULL ) {
+        uint32_t idx, count = VectorLength( &( w -> pool -> sources ) );
+        for ( idx = 0; idx < count; ++idx ) {
+            release_prepare_cursors( &( w -> prep[ idx ] ) );
+            close_prepare_db( &( w -> prep[ idx ] ) ); /* cmdline_cmn.c */
+        }
+        free( w -> prep );
+        w -> prep = NULL;
+    }
+}
+
+/* load the iterator of the window from all sources: a reference-iterator, or the placement-set-iterator for depth */
+static rc_t load_pileup_window( pileup_worker * w, const pileup_window * win, ReferenceIterator * ref_iter,
+                                PlacementSetIterator * plset_iter, const PlacementRecordExtendFuncs * cb_block ) {
+    BSTree window_region;
+    rc_t rc;
+
+    BSTreeInit( &window_region );
+    rc = add_region( &window_region, win -> ref -> name, win -> start, win -> end ); /* ref_regions.c */
+    if ( rc == 0 ) {
+        uint32_t idx, count = VectorLength( &( w -> pool -> sources ) );
+        for ( idx = 0; idx < count && rc == 0; ++idx ) {
+            w -> prep[ idx ] . ref_iter = ref_iter;
+            w -> prep[ idx ] . plset_iter = plset_iter;
+            w -> prep[ idx ] . plset_ext = cb_block;
+            rc = prepare_ref_iter_regions( &( w -> prep[ idx ] ), &window_region ); /* cmdline_cmn.c */
+        }
+    }
+    free_ref_regions( &window_region );
+    return rc;
+}
+
+/* an iterator of its own for the window, walked into the buffer of the window */
+static rc_t walk_pileup_window( pileup_worker * w, pileup_window * win ) {
+    pileup_pool * pool = w -> pool;
+    PlacementRecordExtendFuncs cb_block;
+    rc_t rc;
+
+    cb_block . data = pool -> cb_data;
+    cb_block . destroy = NULL;
+    cb_block . populate = populate_tooldata;
+    cb_block . alloc_size = alloc_size;
+    cb_block . fixed_size = 0;
+
+    if ( w -> options . function == sra_pileup_depth ) {
+        PlacementSetIterator * plset_iter;
+        rc = AlignMgrMakePlacementSetIterator ( pool -> cb_data -> almgr, &plset_iter );
+        if ( rc != 0 ) {
+            LOGERR( klogInt, rc, "AlignMgrMakePlacementSetIterator() failed" );
+        } else {
+            rc = load_pileup_window( w, win, NULL, plset_iter, &cb_block );
+            if ( rc == 0 ) {
+                window_out = win -> out;
+                rc = walk_depth( plset_iter, &( w -> options ) ); /* pileup_depth.c */
+                window_out = NULL;
+            }
+            PlacementSetIteratorRelease( plset_iter );
+        }
+    } else {
+        ReferenceIterator * ref_iter;
+        rc = AlignMgrMakeReferenceIterator ( pool -> cb_data -> almgr, &ref_iter, &cb_block, w -> options . minmapq );
+        if ( rc != 0 ) {
+            LOGERR( klogInt, rc, "AlignMgrMakeReferenceIterator() failed" );
+        } else {
+            rc = load_pileup_window( w, win, ref_iter, NULL, &cb_block );
+            if ( rc == 0 ) {
+                window_out = win -> out;
+                rc = pool -> walker( ref_iter, &( w -> options ) );
+                window_out = NULL;
+            }
+            ReferenceIteratorRelease( ref_iter );
+        }
+    }
+    return rc;
+}
+
+static void set_pool_error( pileup_pool * pool, rc_t rc ) {
+    /* call with the lock held */
+    if ( pool -> rc == 0 ) {
+        pool -> rc = rc;
+    }
+    KConditionBroadcast( pool -> window_written );
+    KConditionSignal( pool -> window_done );
+}
+
+static rc_t CC pileup_worker_thread( const KThread * self, void * data ) {
+    pileup_worker * w = data;
+    pileup_pool * pool = w -> pool;
+    bool done = false;
+    rc_t rc = open_worker_sources( w );
+
+    while ( rc == 0 && !done ) {
+        pileup_window * win = NULL;
+        rc = KLockAcquire( pool -> lock );
+        if ( rc == 0 ) {
+            while ( pool -> rc == 0 &&
+                    pool -> next_window < pool -> window_count &&
+                    pool -> next_window >= pool -> next_output + pool -> max_ahead ) {
+                KConditionWait( pool -> window_written, pool -> lock );
+            }
+            if ( pool -> rc == 0 && pool -> next_window < pool -> window_count ) {
+                win = &( pool -> windows[ pool -> next_window++ ] );
+            }
+            KLockUnlock( pool -> lock );
+        }
+        if ( rc == 0 ) {
+            if ( win == NULL ) {
+                done = true;
+            } else {
+                rc = ds_allocate( &( win -> out ), PILEUP_WINDOW_BUFSIZE ); /* dyn_string.c */
+                if ( rc == 0 ) {
+                    rc = walk_pileup_window( w, win );
+                }
+                if ( rc == 0 ) {
+                    rc = KLockAcquire( pool -> lock );
+                    if ( rc == 0 ) {
+                        win -> done = true;
+                        KConditionSignal( pool -> window_done );
+                        KLockUnlock( pool -> lock );
+                    }
+                }
+            }
+        }
+    }
+    if ( rc != 0 && KLockAcquire( pool -> lock ) == 0 ) {
+        set_pool_error( pool, rc );
+        KLockUnlock( pool -> lock );
+    }
+    release_worker_sources( w );
+    return rc;
+}
+
+/* the main-thread: wait for the windows one after the other, write and free their text */
+static rc_t write_pileup_windows( pileup_pool * pool, const window_out_handler * h ) {
+    rc_t rc = 0;
+    while ( rc == 0 && pool -> next_output < pool -> window_count ) {
+        pileup_window * win = &( pool -> windows[ pool -> next_output ] );
+        rc = KLockAcquire( pool -> lock );
+        if ( rc == 0 ) {
+            while ( pool -> rc == 0 && !win -> done ) {
+                KConditionWait( pool -> window_done, pool -> lock );
+            }
+            rc = pool -> rc;
+            KLockUnlock( pool -> lock );
+        }
+        if ( rc == 0 ) {
+            rc = ds_write( win -> out, h -> org_writer, h -> org_data ); /* dyn_string.c */
+            if ( rc != 0 ) {
+                LOGERR( klogErr, rc, "cannot write pileup" );
+            }
+            ds_free( win -> out );
+            win -> out = NULL;
+        }
+        if ( KLockAcquire( pool -> lock ) == 0 ) {
+            if ( rc != 0 ) {
+                set_pool_error( pool, rc );
+            } else {
+                pool -> next_output++;
+                KConditionBroadcast( pool -> window_written );
+            }
+            KLockUnlock( pool -> lock );
+        }
+    }
+    return rc;
+}
+
+static rc_t make_pileup_pool_sync( pileup_pool * pool ) {
+    rc_t rc = KLockMake( &( pool -> lock ) );
+    if ( rc != 0 ) {
+        LOGERR( klogInt, rc, "KLockMake() failed" );
+    } else {
+        rc = KConditionMake( &( pool -> window_done ) );
+        if ( rc == 0 ) {
+            rc = KConditionMake( &( pool -> window_written ) );
+        }
+        if ( rc != 0 ) {
+            LOGERR( klogInt, rc, "KConditionMake() failed" );
+        }
+    }
+    return rc;
+}
+
+static void release_pileup_pool( pileup_pool * pool ) {
+    if ( pool -> windows != NULL ) {
+        uint32_t idx;
+        for ( idx = 0; idx < pool -> window_count; ++idx ) {
+            ds_free( pool -> windows[ idx ] . out );    /* tolerates NULL-ptr */
+        }
+        free( pool -> windows );
+    }
+    VectorWhack ( &( pool -> refs ), pileup_ref_whack, NULL );
+    VectorWhack ( &( pool -> sources ), pileup_source_whack, NULL );
+    KConditionRelease( pool -> window_written );
+    KConditionRelease( pool -> window_done );
+    KLockRelease( pool -> lock );
+}
+
+static rc_t run_pileup_workers( pileup_pool * pool ) {
+    pileup_options * options = pool -> options;
+    uint32_t started = 0;
+    rc_t rc = 0;
+    pileup_worker * workers = calloc( options -> num_threads, sizeof * workers );
+    if ( workers == NULL ) {
+        rc = RC ( rcApp, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        LOGERR( klogErr, rc, "cannot allocate worker-threads" );
+    } else {
+        window_out_handler h;
+        h . org_writer = KOutWriterGet();
+        h . org_data = KOutDataGet();
+        rc = KOutHandlerSet( write_to_window, &h );
+        if ( rc != 0 ) {
+            LOGERR( klogInt, rc, "KOutHandlerSet() failed" );
+        } else {
+            uint32_t idx;
+            for ( idx = 0; idx < options -> num_threads && rc == 0; ++idx ) {
+                pileup_worker * w = &( workers[ idx ] );
+                w -> pool = pool;
+                w -> options = *options;
+                w -> options . skiplist = skiplist_make( pool -> regions ); /* ref_regions.c, NULL if nothing to skip */
+                VectorInit ( &( w -> cursor_ids ), 0, 5 );
+                rc = KThreadMake( &( w -> thread ), pileup_worker_thread, w );
+                if ( rc != 0 ) {
+                    LOGERR( klogInt, rc, "KThreadMake() failed" );
+                } else {
+                    started++;
+                }
+            }
+            if ( rc != 0 && KLockAcquire( pool -> lock ) == 0 ) {
+                set_pool_error( pool, rc );
+                KLockUnlock( pool -> lock );
+            }
+            if ( rc == 0 ) {
+                rc = write_pileup_windows( pool, &h );
+            }
+            for ( idx = 0; idx < started; ++idx ) {
+                rc_t status = 0;
+                rc_t rc2 = KThreadWait( workers[ idx ] . thread, &status );
+                if ( rc == 0 ) { rc = ( rc2 != 0 ) ? rc2 : status; }
+                KThreadRelease( workers[ idx ] . thread );
+            }
+            KOutHandlerSet( h . org_writer, h . org_data );
+            for ( idx = 0; idx < options -> num_threads; ++idx ) {
+                if ( workers[ idx ] . options . skiplist != NULL ) {
+                    skiplist_release( workers[ idx ] . options . skiplist );
+                }
+                VectorWhack ( &( workers[ idx ] . cursor_ids ), cur_id_vector_entry_whack, NULL );
+            }
+        }
+        free( workers );
+    }
+    return rc;
+}
+
+/* the sources are checked and remembered, cut into windows, and the windows are walked by the workers */
+static rc_t pileup_threaded( Args * args, KDirectory * dir, BSTree * regions, const foreach_arg_ctx * arg_ctx,
+                             pileup_callback_data * cb_data, bool * empty ) {
+    pileup_pool pool;
+    rc_t rc;
+
+    memset( &pool, 0, sizeof pool );
+    pool . options = arg_ctx -> options;
+    pool . cb_data = cb_data;
+    pool . vdb_mgr = arg_ctx -> vdb_mgr;
+    pool . vdb_schema = arg_ctx -> vdb_schema;
+    pool . regions = regions;
+    pool . walker = get_window_walker( arg_ctx -> options -> function );
+    pool . max_ahead = arg_ctx -> options -> num_threads * PILEUP_WINDOWS_AHEAD;
+    VectorInit ( &( pool . sources ), 0, 5 );
+    VectorInit ( &( pool . refs ), 0, 32 );
+
+    rc = foreach_argument( args, dir, arg_ctx -> options -> div_by_spotgrp, empty, on_pileup_source, &pool ); /* cmdline_cmn.c */
+    if ( rc == 0 && !*empty ) {
+        rc = make_pileup_windows( &pool );
+    }
+    if ( rc == 0 && pool . window_count > 0 ) {
+        rc = make_pileup_pool_sync( &pool );
+        if ( rc == 0 ) {
+            rc = run_pileup_workers( &pool );
+        }
+    }
+    release_pileup_pool( &pool );
+    return rc;
+}
+
 static rc_t pileup_main( Args * args, pileup_options *options ) {
     foreach_arg_ctx arg_ctx;
     pileup_callback_data cb_data;
+    PlacementRecordExtendFuncs cb_block;
     KDirectory * dir = NULL;
     Vector cur_ids_vector;
 
@@ -1274,20 +1989,28 @@ static rc_t pileup_main( Args * args, pileup_options *options ) {
     arg_ctx . options = options;
     arg_ctx . vdb_schema = NULL;
     arg_ctx . cursor_ids = &cur_ids_vector;
+    arg_ctx . ref_iter = NULL;
+    arg_ctx . plset_iter = NULL;
+    arg_ctx . plset_ext = &cb_block;
 
-    /* (2) make the reference-iterator */
+    /* (2) make the reference-iterator ( depth: a placement-set-iterator, no per-base events ) */
     if ( rc == 0 ) {
-        PlacementRecordExtendFuncs cb_block;
-
         cb_block.data = &cb_data;
         cb_block.destroy = NULL;
         cb_block.populate = populate_tooldata;
         cb_block.alloc_size = alloc_size;
         cb_block.fixed_size = 0;
 
-        rc = AlignMgrMakeReferenceIterator ( cb_data . almgr, &( arg_ctx . ref_iter ), &cb_block, options -> minmapq );
-        if ( rc != 0 ) {
-            LOGERR( klogInt, rc, "AlignMgrMakeReferenceIterator() failed" );
+        if ( options -> function == sra_pileup_depth ) {
+            rc = AlignMgrMakePlacementSetIterator ( cb_data . almgr, &( arg_ctx . plset_iter ) );
+            if ( rc != 0 ) {
+                LOGERR( klogInt, rc, "AlignMgrMakePlacementSetIterator() failed" );
+            }
+        } else {
+            rc = AlignMgrMakeReferenceIterator ( cb_data . almgr, &( arg_ctx . ref_iter ), &cb_block, options -> minmapq );
+            if ( rc != 0 ) {
+                LOGERR( klogInt, rc, "AlignMgrMakeReferenceIterator() failed" );
+            }
         }
     }
 
@@ -1358,6 +2081,10 @@ static rc_t pileup_main( Args * args, pileup_options *options ) {
             case sra_pileup_varcount   :  options -> cmn . omit_qualities = true;
                                           options -> read_tlen = false;
                                           break;
+
+            case sra_pileup_depth      :  options -> cmn . omit_qualities = true;
+                                          options -> read_tlen = false;
+                                          break;
         }
     }
 
@@ -1372,36 +2099,47 @@ static rc_t pileup_main( Args * args, pileup_options *options ) {
             options -> skiplist = skiplist_make( &regions ); /* create skiplist for neighboring slices */
 
             arg_ctx . ranges = &regions;
-            rc = foreach_argument( args, dir, options -> div_by_spotgrp, &empty, on_argument, &arg_ctx ); /* cmdline_cmn.c */
-            if ( empty ) {
-                Usage ( args );
-                rc = RC ( rcApp, rcArgv, rcAccessing, rcSelf, rcInsufficient );
+            if ( use_pileup_threads( options ) ) {
+                /* (5+6) the workers load and walk a reference-iterator per window */
+                rc = pileup_threaded( args, dir, &regions, &arg_ctx, &cb_data, &empty ); /* see above */
+                if ( empty ) {
+                    Usage ( args );
+                    rc = RC ( rcApp, rcArgv, rcAccessing, rcSelf, rcInsufficient );
+                }
+            } else {
+                rc = foreach_argument( args, dir, options -> div_by_spotgrp, &empty, on_argument, &arg_ctx ); /* cmdline_cmn.c */
+                if ( empty ) {
+                    Usage ( args );
+                    rc = RC ( rcApp, rcArgv, rcAccessing, rcSelf, rcInsufficient );
+                }
+
+                /* (6) walk the "loaded" ref-iterator ===> perform the pileup */
+                if ( rc == 0 ) {
+                    /* ============================================== */
+                    switch( options -> function )
+                    {
+                        case sra_pileup_stat        : rc = walk_stat( arg_ctx . ref_iter, options ); break;
+                        case sra_pileup_counters    : rc = walk_counters( arg_ctx . ref_iter, options ); break;
+                        case sra_pileup_debug       : rc = walk_debug( arg_ctx . ref_iter, options ); break;
+                        case sra_pileup_mismatch    : rc = walk_mismatches( arg_ctx . ref_iter, options ); break;
+                        case sra_pileup_index       : rc = walk_index( arg_ctx . ref_iter, options ); break;
+                        case sra_pileup_varcount    : rc = walk_varcount( arg_ctx . ref_iter, options ); break;
+                        case sra_pileup_indels      : rc = walk_indels( arg_ctx . ref_iter, options ); break;
+                        case sra_pileup_depth       : rc = walk_depth( arg_ctx . plset_iter, options ); break;
+                        default : rc = walk_ref_iter( arg_ctx . ref_iter, options ); break;
+                    }
+                    /* ============================================== */
+                }
             }
             free_ref_regions( &regions );
         }
     }
 
-    /* (6) walk the "loaded" ref-iterator ===> perform the pileup */
-    if ( rc == 0 ) {
-        /* ============================================== */
-        switch( options -> function )
-        {
-            case sra_pileup_stat        : rc = walk_stat( arg_ctx . ref_iter, options ); break;
-            case sra_pileup_counters    : rc = walk_counters( arg_ctx . ref_iter, options ); break;
-            case sra_pileup_debug       : rc = walk_debug( arg_ctx . ref_iter, options ); break;
-            case sra_pileup_mismatch    : rc = walk_mismatches( arg_ctx . ref_iter, options ); break;
-            case sra_pileup_index       : rc = walk_index( arg_ctx . ref_iter, options ); break;
-            case sra_pileup_varcount    : rc = walk_varcount( arg_ctx . ref_iter, options ); break;
-			case sra_pileup_indels      : rc = walk_indels( arg_ctx . ref_iter, options ); break;
-            default : rc = walk_ref_iter( arg_ctx . ref_iter, options ); break;
-        }
-        /* ============================================== */
-    }
-
     if ( arg_ctx . vdb_mgr != NULL ) { VDBManagerRelease( arg_ctx . vdb_mgr ); }
     if ( arg_ctx . vdb_schema != NULL ) { VSchemaRelease( arg_ctx . vdb_schema ); }
     if ( dir != NULL ) { KDirectoryRelease( dir ); }
     if ( arg_ctx . ref_iter != NULL ) { ReferenceIteratorRelease( arg_ctx . ref_iter ); }
+    if ( arg_ctx . plset_iter != NULL ) { PlacementSetIteratorRelease( arg_ctx . plset_iter ); }
     if ( cb_data . almgr != NULL ) { AlignMgrRelease ( cb_data . almgr ); }
     VectorWhack ( &cur_ids_vector, cur_id_vector_entry_whack, NULL );
 
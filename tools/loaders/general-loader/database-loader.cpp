@@ -45,9 +45,306 @@
 #include <loader/loader-meta.h>
 
 #include <algorithm>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 using namespace std;
 
+static
+rc_t
+CommitCursorRow ( VCursor * p_cursor )
+{
+    rc_t rc = VCursorCommitRow ( p_cursor );
+    if ( rc == 0 )
+    {
+        rc = VCursorCloseRow ( p_cursor );
+        if ( rc == 0 )
+        {
+            rc = VCursorOpenRow ( p_cursor );
+        }
+    }
+    return rc;
+}
+
+///////////// GeneralLoader::DatabaseLoader::TableWriter
+
+// Cell values and row ends of the table are collected into batches on the parsing thread
+// and written to the table's cursor by the writer's thread, so that the VDB encoding of
+// the tables overlaps with each other and with the parsing.
+// An error of the writer's thread is returned by the next call that hands over a batch.
+class GeneralLoader :: DatabaseLoader :: TableWriter
+{
+public:
+    static const size_t BatchRows   = 4096;             // rows per batch
+    static const size_t BatchBytes  = 4 * 1024 * 1024;  // cell bytes per batch
+    static const size_t MaxBatches  = 2;                // batches queued for the thread
+
+public:
+    TableWriter ( const string& p_name, VCursor * p_cursor );
+    ~TableWriter ();
+
+    rc_t Write ( const Column& p_col, const void* p_data, size_t p_elemCount )
+    {
+        return Add ( opWrite, p_col, p_data, p_elemCount );
+    }
+    rc_t Default ( const Column& p_col, const void* p_data, size_t p_elemCount )
+    {
+        return Add ( opDefault, p_col, p_data, p_elemCount );
+    }
+    rc_t CommitRow ();
+
+    // waits until everything handed over so far is written
+    rc_t Drain ();
+    // drains and ends the thread
+    rc_t Stop ();
+
+private:
+    enum OpType { opWrite, opDefault, opCommit };
+
+    struct Op
+    {
+        OpType type;
+        uint32_t columnIdx;
+        uint32_t elemBits;
+        size_t elemCount;
+        size_t offset;      // into Batch :: data
+    };
+
+    struct Batch
+    {
+        Batch () : rows ( 0 ) {}
+        void Clear () { ops . clear (); data . clear (); rows = 0; }
+
+        vector < Op > ops;
+        vector < uint8_t > data;
+        size_t rows;
+    };
+
+private:
+    TableWriter ( const TableWriter& );
+    TableWriter & operator = ( const TableWriter& );
+
+    rc_t Add ( OpType p_type, const Column& p_col, const void* p_data, size_t p_elemCount );
+    rc_t Submit ();
+    rc_t WriteBatch ( const Batch& p_batch );
+    void Run ();
+
+private:
+    string                  m_name;
+    VCursor *               m_cursor;
+
+    Batch *                 m_batch;    // being filled by the parsing thread
+    deque < Batch * >       m_queue;    // waiting for the writer's thread
+    vector < Batch * >      m_free;     // written, for reuse
+
+    thread                  m_thread;
+    mutex                   m_mutex;
+    condition_variable      m_cv;
+    bool                    m_busy;     // the writer's thread is writing a batch
+    bool                    m_done;     // no more batches
+    rc_t                    m_rc;       // first error of the writer's thread
+    uint64_t                m_rows;     // rows written
+};
+
+GeneralLoader :: DatabaseLoader :: TableWriter :: TableWriter ( const string& p_name, VCursor * p_cursor )
+:   m_name ( p_name ),
+    m_cursor ( p_cursor ),
+    m_batch ( new Batch () ),
+    m_busy ( false ),
+    m_done ( false ),
+    m_rc ( 0 ),
+    m_rows ( 0 )
+{
+    m_thread = thread ( & TableWriter :: Run, this );
+}
+
+GeneralLoader :: DatabaseLoader :: TableWriter :: ~TableWriter ()
+{
+    Stop ();
+
+    delete m_batch;
+    for ( deque < Batch * > :: iterator it = m_queue . begin (); it != m_queue . end (); ++it )
+    {
+        delete * it;
+    }
+    for ( vector < Batch * > :: iterator it = m_free . begin (); it != m_free . end (); ++it )
+    {
+        delete * it;
+    }
+}
+
+rc_t
+GeneralLoader :: DatabaseLoader :: TableWriter :: Add ( OpType p_type, const Column& p_col, const void* p_data, size_t p_elemCount )
+{
+    Op op;
+    op . type       = p_type;
+    op . columnIdx  = p_col . columnIdx;
+    op . elemBits   = p_col . elemBits;
+    op . elemCount  = p_elemCount;
+    op . offset     = m_batch -> data . size ();
+    m_batch -> ops . push_back ( op );
+
+    // the caller's buffer is reused once we return
+    const uint8_t* data = reinterpret_cast<const uint8_t*> ( p_data );
+    size_t size = ( p_elemCount * p_col . elemBits + 7 ) / 8;
+    m_batch -> data . insert ( m_batch -> data . end (), data, data + size );
+    return 0;
+}
+
+rc_t
+GeneralLoader :: DatabaseLoader :: TableWriter :: CommitRow ()
+{
+    Op op;
+    op . type       = opCommit;
+    op . columnIdx  = 0;
+    op . elemBits   = 0;
+    op . elemCount  = 0;
+    op . offset     = m_batch -> data . size ();
+    m_batch -> ops . push_back ( op );
+    ++ m_batch -> rows;
+
+    if ( m_batch -> rows >= BatchRows || m_batch -> data . size () >= BatchBytes )
+    {
+        return Submit ();
+    }
+    return 0;
+}
+
+rc_t
+GeneralLoader :: DatabaseLoader :: TableWriter :: Submit ()
+{
+    unique_lock < mutex > lock ( m_mutex );
+    if ( m_batch -> ops . empty () )
+    {
+        return m_rc;
+    }
+
+    m_cv . wait ( lock, [this] () { return m_queue . size () < MaxBatches || m_rc != 0; } );
+    if ( m_rc != 0 )
+    {
+        return m_rc;
+    }
+
+    m_queue . push_back ( m_batch );
+    if ( m_free . empty () )
+    {
+        m_batch = new Batch ();
+    }
+    else
+    {
+        m_batch = m_free . back ();
+        m_free . pop_back ();
+    }
+    m_cv . notify_all ();
+    return 0;
+}
+
+rc_t
+GeneralLoader :: DatabaseLoader :: TableWriter :: Drain ()
+{
+    rc_t rc = Submit ();
+    if ( rc == 0 )
+    {
+        unique_lock < mutex > lock ( m_mutex );
+        m_cv . wait ( lock, [this] () { return ( m_queue . empty () && ! m_busy ) || m_rc != 0; } );
+        rc = m_rc;
+    }
+    return rc;
+}
+
+rc_t
+GeneralLoader :: DatabaseLoader :: TableWriter :: Stop ()
+{
+    if ( ! m_thread . joinable () )
+    {
+        return m_rc;
+    }
+
+    rc_t rc = Drain ();
+    {
+        lock_guard < mutex > lock ( m_mutex );
+        m_done = true;
+    }
+    m_cv . notify_all ();
+    m_thread . join ();
+
+    pLogMsg ( klogDebug,
+              "database-loader: table '$(t)', $(r) rows written by the table's thread",
+              "t=%s,r=%lu",
+              m_name . c_str (), ( unsigned long ) m_rows );
+    return rc;
+}
+
+rc_t
+GeneralLoader :: DatabaseLoader :: TableWriter :: WriteBatch ( const Batch& p_batch )
+{
+    rc_t rc = 0;
+    for ( vector < Op > :: const_iterator it = p_batch . ops . begin (); it != p_batch . ops . end () && rc == 0; ++it )
+    {
+        const uint8_t* data = p_batch . data . data () + it -> offset;
+        switch ( it -> type )
+        {
+        case opWrite:
+            rc = VCursorWrite ( m_cursor, it -> columnIdx, it -> elemBits, data, 0, it -> elemCount );
+            break;
+        case opDefault:
+            rc = VCursorDefault ( m_cursor, it -> columnIdx, it -> elemBits, data, 0, it -> elemCount );
+            break;
+        case opCommit:
+            rc = CommitCursorRow ( m_cursor );
+            break;
+        }
+    }
+    return rc;
+}
+
+void
+GeneralLoader :: DatabaseLoader :: TableWriter :: Run ()
+{
+    while ( true )
+    {
+        Batch * batch;
+        {
+            unique_lock < mutex > lock ( m_mutex );
+            m_cv . wait ( lock, [this] () { return ! m_queue . empty () || m_done; } );
+            if ( m_queue . empty () )
+            {
+                return;
+            }
+            batch = m_queue . front ();
+            m_queue . pop_front ();
+            m_busy = true;
+        }
+
+        rc_t rc = WriteBatch ( * batch );
+        size_t rows = batch -> rows;
+        batch -> Clear ();
+
+        {
+            lock_guard < mutex > lock ( m_mutex );
+            m_busy = false;
+            m_free . push_back ( batch );
+            if ( rc == 0 )
+            {
+                m_rows += rows;
+            }
+            else
+            {
+                m_rc = rc;
+            }
+        }
+        m_cv . notify_all ();
+
+        if ( rc != 0 )
+        {
+            pLogMsg ( klogErr, "database-loader: failed to write table '$(t)'", "t=%s", m_name . c_str () );
+            return;
+        }
+    }
+}
+
 ///////////// GeneralLoader::DatabaseLoader
 
 GeneralLoader :: DatabaseLoader :: DatabaseLoader ( const std::string&  p_programName,
@@ -61,13 +358,16 @@ GeneralLoader :: DatabaseLoader :: DatabaseLoader ( const std::string&  p_progra
     m_softwareVersion ( 0 ),
     m_mgr ( 0 ),
     m_schema ( 0 ),
-    m_databaseNameOverridden ( ! m_databaseName.empty() )
+    m_databaseNameOverridden ( ! m_databaseName.empty() ),
+    m_pipelined ( false )
 {
     m_databases . insert ( Databases :: value_type ( 0, (VDatabase*)0 ) ); // reserve root database
 }
 
 GeneralLoader :: DatabaseLoader :: ~DatabaseLoader ()
 {
+    StopWriters ();
+
     m_tables . clear();
     m_columns . clear ();
 
@@ -535,7 +835,13 @@ GeneralLoader :: DatabaseLoader :: TblMetadataNode ( uint32_t p_objId, const str
               "n=%s,v=%s,i=%u",
               p_metadata_node . c_str(), p_value.c_str(), p_objId );
 
-    rc_t rc = 0;
+    // the table is updated through its cursor
+    rc_t rc = DrainWriters ();
+    if ( rc != 0 )
+    {
+        return rc;
+    }
+
     Tables::iterator it = m_tables . find ( p_objId );
     if ( it != m_tables . end() )
     {
@@ -578,7 +884,13 @@ GeneralLoader :: DatabaseLoader :: TblMetadataNodeAttr ( uint32_t p_objId, const
               "n=%s,v=%s,i=%u",
               p_metadata_node . c_str(), p_value.c_str(), p_objId );
 
-    rc_t rc = 0;
+    // the table is updated through its cursor
+    rc_t rc = DrainWriters ();
+    if ( rc != 0 )
+    {
+        return rc;
+    }
+
     Tables::iterator it = m_tables . find ( p_objId );
     if ( it != m_tables . end() )
     {
@@ -740,6 +1052,10 @@ GeneralLoader :: DatabaseLoader :: SaveColumnMetadata ( const Column& p_col )
 rc_t
 GeneralLoader :: DatabaseLoader :: CursorWrite ( const struct Column& p_col, const void* p_data, size_t p_size )
 {
+    if ( p_col . cursorIdx < m_writers . size () && m_writers [ p_col . cursorIdx ] != 0 )
+    {
+        return m_writers [ p_col . cursorIdx ] -> Write ( p_col, p_data, p_size );
+    }
     return VCursorWrite ( m_cursors [ p_col . cursorIdx ],
                           p_col . columnIdx,
                           p_col . elemBits,
@@ -751,6 +1067,10 @@ GeneralLoader :: DatabaseLoader :: CursorWrite ( const struct Column& p_col, con
 rc_t
 GeneralLoader :: DatabaseLoader :: CursorDefault ( const struct Column& p_col, const void* p_data, size_t p_size )
 {
+    if ( p_col . cursorIdx < m_writers . size () && m_writers [ p_col . cursorIdx ] != 0 )
+    {
+        return m_writers [ p_col . cursorIdx ] -> Default ( p_col, p_data, p_size );
+    }
     return VCursorDefault ( m_cursors [ p_col . cursorIdx ],
                             p_col . columnIdx,
                             p_col . elemBits,
@@ -874,16 +1194,59 @@ GeneralLoader :: DatabaseLoader :: OpenStream ()
                 break;
             }
         }
+        if ( rc == 0 && m_pipelined )
+        {
+            rc = StartWriters ();
+        }
     }
     return rc;
 }
 
+rc_t
+GeneralLoader :: DatabaseLoader :: CellBatch ( uint32_t p_columnId, const void* p_data, const uint32_t* p_elemCounts, uint32_t p_rowCount )
+{
+    Columns::const_iterator curIt = m_columns . find ( p_columnId );
+    if ( curIt == m_columns . end () )
+    {
+        return RC ( rcExe, rcFile, rcReading, rcColumn, rcNotFound );
+    }
+
+    const Column& col = curIt -> second;
+    pLogMsg ( klogDebug,
+              "database-loader: columnIdx = $(i), elem size=$(s) bits, batch of $(r) rows",
+              "i=%u,s=%u,r=%u",
+              col . columnIdx, col . elemBits, p_rowCount );
+
+    // appended to what is pending for the column, written by NextRows
+    size_t size = 0;
+    for ( uint32_t i = 0; i < p_rowCount; ++i )
+    {
+        size += ( ( size_t ) p_elemCounts [ i ] * col . elemBits + 7 ) / 8;
+    }
+    Batch& batch = m_batches [ p_columnId ];
+    const uint8_t* data = reinterpret_cast<const uint8_t*> ( p_data );
+    batch . data . insert ( batch . data . end (), data, data + size );
+    batch . elemCounts . insert ( batch . elemCounts . end (), p_elemCounts, p_elemCounts + p_rowCount );
+    return 0;
+}
+
 rc_t
 GeneralLoader :: DatabaseLoader :: CloseStream ()
 {
     rc_t rc = 0;
     rc_t rc2 = 0;
 
+    // all rows have to be in the cursors before they are committed
+    rc_t writerRc = StopWriters ();
+
+    rc_t batchRc = 0;
+    if ( ! m_batches . empty () )
+    {
+        LogMsg ( klogErr, "database-loader: cell batches left without the rows to commit them" );
+        batchRc = RC ( rcExe, rcFile, rcReading, rcData, rcIncomplete );
+        m_batches . clear ();
+    }
+
     for ( Cursors::iterator it = m_cursors . begin(); it != m_cursors . end(); ++it )
     {
         rc = VCursorCloseRow ( *it );
@@ -934,27 +1297,94 @@ GeneralLoader :: DatabaseLoader :: CloseStream ()
     }
     m_databases . clear();
 
+    if ( rc == 0 )
+    {
+        rc = writerRc;
+    }
+    if ( rc == 0 )
+    {
+        rc = batchRc;
+    }
     return rc;
 }
 
 rc_t
-GeneralLoader :: DatabaseLoader :: NextRow ( uint32_t p_tableId )
+GeneralLoader :: DatabaseLoader :: CommitRow ( uint32_t p_cursorIdx )
+{
+    if ( p_cursorIdx < m_writers . size () && m_writers [ p_cursorIdx ] != 0 )
+    {
+        return m_writers [ p_cursorIdx ] -> CommitRow ();
+    }
+    return CommitCursorRow ( m_cursors [ p_cursorIdx ] );
+}
+
+rc_t
+GeneralLoader :: DatabaseLoader :: StartWriters ()
+{
+    m_writers . resize ( m_cursors . size (), 0 );
+    for ( Tables::const_iterator it = m_tables . begin(); it != m_tables . end(); ++it )
+    {
+        uint32_t idx = it -> second . cursorIdx;
+        try
+        {
+            m_writers [ idx ] = new TableWriter ( it -> second . name, m_cursors [ idx ] );
+        }
+        catch ( ... )
+        {
+            return RC ( rcExe, rcThread, rcCreating, rcThread, rcExhausted );
+        }
+    }
+    pLogMsg ( klogDebug, "database-loader: writing $(n) tables on their own threads", "n=%u", ( unsigned int ) m_tables . size () );
+    return 0;
+}
+
+rc_t
+GeneralLoader :: DatabaseLoader :: DrainWriters ()
 {
     rc_t rc = 0;
-    Tables::const_iterator table = m_tables . find ( p_tableId );
-    if ( table != m_tables . end() )
+    for ( TableWriters::iterator it = m_writers . begin(); it != m_writers . end(); ++it )
     {
-        VCursor * cursor = m_cursors [ table -> second . cursorIdx ];
-        rc = VCursorCommitRow ( cursor );
-        if ( rc == 0 )
+        if ( * it != 0 )
         {
-            rc = VCursorCloseRow ( cursor );
+            rc_t rc2 = ( * it ) -> Drain ();
             if ( rc == 0 )
             {
-                rc = VCursorOpenRow ( cursor );
+                rc = rc2;
             }
         }
     }
+    return rc;
+}
+
+rc_t
+GeneralLoader :: DatabaseLoader :: StopWriters ()
+{
+    rc_t rc = 0;
+    for ( TableWriters::iterator it = m_writers . begin(); it != m_writers . end(); ++it )
+    {
+        if ( * it != 0 )
+        {
+            rc_t rc2 = ( * it ) -> Stop ();
+            if ( rc == 0 )
+            {
+                rc = rc2;
+            }
+            delete * it;
+        }
+    }
+    m_writers . clear ();
+    return rc;
+}
+
+rc_t
+GeneralLoader :: DatabaseLoader :: NextRow ( uint32_t p_tableId )
+{
+    rc_t rc = 0;
+    Tables::const_iterator table = m_tables . find ( p_tableId );
+    if ( table != m_tables . end() )
+    {
+        rc = CommitRow ( table -> second . cursorIdx );
+    }
     else
     {
         rc = RC ( rcExe, rcFile, rcReading, rcTable, rcNotFound );
@@ -962,6 +1392,65 @@ GeneralLoader :: DatabaseLoader :: NextRow ( uint32_t p_tableId )
     return rc;
 }
 
+rc_t
+GeneralLoader :: DatabaseLoader :: NextRows ( uint32_t p_tableId, uint64_t p_count )
+{
+    Tables::const_iterator table = m_tables . find ( p_tableId );
+    if ( table == m_tables . end() )
+    {
+        return RC ( rcExe, rcFile, rcReading, rcTable, rcNotFound );
+    }
+
+    // the table's pending batches, with the offset of the next cell in each
+    struct Pending
+    {
+        const Column* col;
+        Batches::iterator batch;
+        size_t offset;
+    };
+    std :: vector < Pending > pending;
+    for ( Batches::iterator it = m_batches . begin(); it != m_batches . end(); ++it )
+    {
+        const Column& col = m_columns . find ( it -> first ) -> second;
+        if ( col . tableId == p_tableId )
+        {
+            if ( it -> second . elemCounts . size () != p_count )
+            {
+                pLogMsg ( klogErr,
+                          "database-loader: batch of column '$(c)' has $(b) rows, committing $(n)",
+                          "c=%s,b=%lu,n=%lu",
+                          col . name . c_str (), ( unsigned long ) it -> second . elemCounts . size (), ( unsigned long ) p_count );
+                return RC ( rcExe, rcFile, rcReading, rcData, rcInvalid );
+            }
+            Pending p = { & col, it, 0 };
+            pending . push_back ( p );
+        }
+    }
+
+    rc_t rc = 0;
+    for ( uint64_t row = 0; row < p_count && rc == 0; ++row )
+    {
+        for ( size_t i = 0; i < pending . size () && rc == 0; ++i )
+        {
+            Pending& p = pending [ i ];
+            const Batch& batch = p . batch -> second;
+            uint32_t elemCount = batch . elemCounts [ row ];
+            rc = CursorWrite ( * p . col, batch . data . data () + p . offset, elemCount );
+            p . offset += ( ( size_t ) elemCount * p . col -> elemBits + 7 ) / 8;
+        }
+        if ( rc == 0 )
+        {
+            rc = CommitRow ( table -> second . cursorIdx );
+        }
+    }
+
+    for ( size_t i = 0; i < pending . size (); ++i )
+    {
+        m_batches . erase ( pending [ i ] . batch );
+    }
+    return rc;
+}
+
 rc_t
 GeneralLoader :: DatabaseLoader :: MoveAhead ( uint32_t p_tableId, uint64_t p_count )
 {
@@ -969,20 +1458,9 @@ GeneralLoader :: DatabaseLoader :: MoveAhead ( uint32_t p_tableId, uint64_t p_co
     Tables::const_iterator table = m_tables . find ( p_tableId );
     if ( table != m_tables . end() )
     {
-        VCursor * cursor = m_cursors [ table -> second . cursorIdx ];
         for ( uint64_t i = 0; i < p_count; ++i )
         {   // for now, simulate proper handling (this will commit the current row and insert count-1 empty rows)
-            rc = VCursorCommitRow ( cursor );
-            if ( rc != 0 )
-            {
-                break;
-            }
-            rc = VCursorCloseRow ( cursor );
-            if ( rc != 0 )
-            {
-                break;
-            }
-            rc = VCursorOpenRow ( cursor );
+            rc = CommitRow ( table -> second . cursorIdx );
             if ( rc != 0 )
             {
                 break;
@@ -103,7 +103,8 @@ GeneralLoader::Reader::Align( uint8_t p_bytes )
 
 GeneralLoader::GeneralLoader ( const std::string& p_programName, const struct KStream& p_input )
 :   m_programName ( p_programName ),
-    m_reader ( p_input )
+    m_reader ( p_input ),
+    m_pipelined ( false )
 {
 }
 
@@ -117,6 +118,12 @@ GeneralLoader::SetTargetOverride( const std::string& p_path )
     m_targetOverride = p_path;
 }
 
+void
+GeneralLoader::SetPipelined( bool p_pipelined )
+{
+    m_pipelined = p_pipelined;
+}
+
 void
 GeneralLoader::SplitAndAdd( Paths& p_paths, const string& p_path )
 {
@@ -151,6 +158,7 @@ GeneralLoader::Run()
     if ( rc == 0 )
     {
         DatabaseLoader loader ( m_programName, m_includePaths, m_schemas, m_targetOverride );
+        loader . SetPipelined ( m_pipelined );
         if ( packed )
         {
             PackedProtocolParser p;
@@ -38,6 +38,7 @@ struct VCursor;
 struct VDatabase;
 struct VDBManager;
 struct VSchema;
+struct gwp_batch_evt_v1;
 
 #define GeneralLoaderSignatureString GW_SIGNATURE
 
@@ -55,11 +56,10 @@ public:
     void AddSchemaIncludePath( const std::string& p_path );
     void AddSchemaFile( const std::string& p_file );
     void SetTargetOverride( const std::string& p_path );
+    void SetPipelined( bool p_pipelined );
 
     rc_t Run ();
 
-private:
-
     typedef std::vector < std::string > Paths;
 
 private:
@@ -89,6 +89,9 @@ private:
         uint64_t m_readCount;
     };
 
+public:
+
+    // applies the general-writer events to the database; usable in-process by the producers of the events
     class DatabaseLoader
     {
     public:
@@ -145,7 +148,11 @@ private:
 
         rc_t CellData    ( uint32_t p_columnId, const void* p_data, size_t p_elemCount );
         rc_t CellDefault ( uint32_t p_columnId, const void* p_data, size_t p_elemCount );
+        // p_data holds p_rowCount cells back to back, each starting on a byte boundary
+        rc_t CellBatch ( uint32_t p_columnId, const void* p_data, const uint32_t* p_elemCounts, uint32_t p_rowCount );
         rc_t NextRow ( uint32_t p_tableId );
+        // writes the pending batches of the table, every one of them must have p_count rows
+        rc_t NextRows ( uint32_t p_tableId, uint64_t p_count );
         rc_t MoveAhead ( uint32_t p_tableId, uint64_t p_count );
         rc_t ErrorMessage ( const std :: string& p_text );
         rc_t LogMessage ( const std :: string& p_text );
@@ -156,6 +163,9 @@ private:
         const std :: string& GetDatabaseName() const { return m_databaseName; }
         const Column* GetColumn ( uint32_t p_columnId ) const;
 
+        // write the rows of each table on a thread of its own; takes effect in OpenStream
+        void SetPipelined ( bool p_pipelined ) { m_pipelined = p_pipelined; }
+
     private:
         // Active Cursors
         typedef std::vector < struct VCursor * > Cursors;
@@ -172,10 +182,30 @@ private:
         // From database id to parent database id
         typedef std::map < uint32_t, uint32_t > DatabaseToParent;
 
+        // cells of a column waiting for their rows to be committed
+        struct Batch
+        {
+            std :: vector < uint8_t > data;
+            std :: vector < uint32_t > elemCounts;
+        };
+
+        // From ColumnId to Batch
+        typedef std::map < uint32_t, Batch > Batches;
+
+        // writes the rows of one table on its own thread
+        class TableWriter;
+
+        // From cursor index to the table's writer, empty unless pipelined
+        typedef std::vector < TableWriter * > TableWriters;
+
     private:
         rc_t MakeDatabase ( uint32_t p_id );
         rc_t CursorWrite   ( const Column& p_col, const void* p_data, size_t p_size );
         rc_t CursorDefault ( const Column& p_col, const void* p_data, size_t p_size );
+        rc_t CommitRow ( uint32_t p_cursorIdx );
+        rc_t StartWriters ();
+        rc_t DrainWriters ();
+        rc_t StopWriters ();
         rc_t SaveColumnMetadata ( const Column& p_col );
 
     private:
@@ -194,13 +224,19 @@ private:
         Columns                 m_columns;
         Databases               m_databases;
         DatabaseToParent        m_dbParents;
+        Batches                 m_batches;
 
         struct VDBManager*      m_mgr;
         struct VSchema*         m_schema;
 
         bool                    m_databaseNameOverridden;
+
+        TableWriters            m_writers;
+        bool                    m_pipelined;
     };
 
+private:
+
     class ProtocolParser
     {
     public:
@@ -275,9 +311,11 @@ private:
     private:
         // read p_dataSize bytes and use one of the decoder functions in utf8-like-int-codec.h to unpack a sequence of integer values,
         // stored in m_unpackingBuf as a collection of bytes
-        template < typename T_uintXX > rc_t UncompressInt ( Reader& p_reader, uint32_t p_dataSize, int ( * p_decode ) ( uint8_t const* buf_start, uint8_t const* buf_xend, T_uintXX* ret_decoded ) );
+        template < typename T_uintXX > rc_t UncompressInt ( const void* p_data, uint32_t p_dataSize, int ( * p_decode ) ( uint8_t const* buf_start, uint8_t const* buf_xend, T_uintXX* ret_decoded ) );
+        rc_t UncompressInt ( const DatabaseLoader :: Column& p_col, const void* p_data, uint32_t p_dataSize );
 
         rc_t ParseData ( Reader& p_reader, DatabaseLoader& p_dbLoader, uint32_t p_columnId, uint32_t p_dataSize );
+        rc_t ParseBatch ( Reader& p_reader, DatabaseLoader& p_dbLoader, uint32_t p_columnId, const gwp_batch_evt_v1& p_evt );
 
         rc_t Handle_1stringEvent(
             Reader& p_reader,
@@ -310,6 +348,8 @@ private:
             rc_t (DatabaseLoader :: * p_fn) ( uint32_t p_objId, const std :: string& p_str1, const std :: string& p_str2 , const std :: string& p_str3 ) );
 
         std::vector<uint8_t>    m_unpackingBuf;
+        std::vector<uint8_t>    m_batchBuf;     // inflated batch payload
+        std::vector<uint32_t>   m_batchCounts;  // element counts of the batch's cells
     };
 
 private:
@@ -328,6 +368,7 @@ private:
     Paths                   m_includePaths;
     Paths                   m_schemas;
     std::string             m_targetOverride;
+    bool                    m_pipelined;
 };
 
 #endif
@@ -74,6 +74,15 @@ char const * target_usage[] =
     NULL
 };
 
+static char const option_pipeline[] = "pipeline";
+#define OPTION_PIPELINE option_pipeline
+static
+char const * pipeline_usage[] =
+{
+    "Write every table on a thread of its own, while the input is parsed on the main thread",
+    NULL
+};
+
 OptDef Options[] =
 {
     /* order here is same as in param array below!!! */
@@ -81,6 +90,7 @@ OptDef Options[] =
     { OPTION_INCLUDE_PATHS, ALIAS_INCLUDE_PATHS,    NULL, include_paths_usage,  0,  true,        false },
     { OPTION_SCHEMAS,       ALIAS_SCHEMAS,          NULL, schemas_usage,        0,  true,        false },
     { OPTION_TARGET,        ALIAS_TARGET,           NULL, target_usage,         1,  true,        false },
+    { OPTION_PIPELINE,      NULL,                   NULL, pipeline_usage,       1,  false,       false },
 };
 
 const char* OptHelpParam[] =
@@ -89,6 +99,7 @@ const char* OptHelpParam[] =
     "path(s)",
     "path(s)",
     "path",
+    NULL,
     "",
 };
 
@@ -225,6 +236,15 @@ MAIN_DECL(argc, argv)
                                 }
                             }
 
+                            if ( rc == 0 )
+                            {
+                                rc = ArgsOptionCount (args, OPTION_PIPELINE, &pcount);
+                                if ( rc == 0 )
+                                {
+                                    loader . SetPipelined ( pcount > 0 );
+                                }
+                            }
+
                             if ( rc == 0 )
                             {
                                 rc = loader . Run();
@@ -32,6 +32,8 @@
 #include <general-writer/general-writer.h>
 #include <general-writer/utf8-like-int-codec.h>
 
+#include <zlib.h>
+
 using namespace std;
 
 ///////////// GeneralLoader::ProtocolParser
@@ -509,13 +511,13 @@ GeneralLoader :: UnpackedProtocolParser :: ParseEvents ( Reader& p_reader, Datab
 
 template < typename T_uintXX >
 rc_t
-GeneralLoader :: PackedProtocolParser :: UncompressInt (  Reader& p_reader, uint32_t p_dataSize, int (*p_decode) ( uint8_t const* buf_start, uint8_t const* buf_xend, T_uintXX* ret_decoded )  )
+GeneralLoader :: PackedProtocolParser :: UncompressInt (  const void* p_data, uint32_t p_dataSize, int (*p_decode) ( uint8_t const* buf_start, uint8_t const* buf_xend, T_uintXX* ret_decoded )  )
 {
     m_unpackingBuf . clear();
     // reserve enough for the best-packed case, when each element is represented with 1 byte
     m_unpackingBuf . reserve ( sizeof ( T_uintXX ) * p_dataSize );
 
-    const uint8_t* buf_begin = reinterpret_cast<const uint8_t*> ( p_reader . GetBuffer() );
+    const uint8_t* buf_begin = reinterpret_cast<const uint8_t*> ( p_data );
     const uint8_t* buf_end   = buf_begin + p_dataSize;
     while ( buf_begin < buf_end )
     {
@@ -538,6 +540,23 @@ GeneralLoader :: PackedProtocolParser :: UncompressInt (  Reader& p_reader, uint
     return 0;
 }
 
+rc_t
+GeneralLoader :: PackedProtocolParser :: UncompressInt ( const DatabaseLoader :: Column& p_col, const void* p_data, uint32_t p_dataSize )
+{
+    switch ( p_col . elemBits )
+    {
+    case 16:
+        return UncompressInt ( p_data, p_dataSize, decode_uint16 );
+    case 32:
+        return UncompressInt ( p_data, p_dataSize, decode_uint32 );
+    case 64:
+        return UncompressInt ( p_data, p_dataSize, decode_uint64 );
+    default:
+        LogMsg ( klogErr, "protocol-parser: bad element size for packed integer" );
+        return RC ( rcExe, rcFile, rcReading, rcData, rcInvalid );
+    }
+}
+
 rc_t
 GeneralLoader :: PackedProtocolParser :: Handle_1stringEvent(
     Reader& p_reader,
@@ -602,22 +621,7 @@ GeneralLoader :: PackedProtocolParser :: ParseData ( Reader& p_reader, DatabaseL
         {
             if ( col -> IsCompressed () )
             {
-                switch ( col -> elemBits )
-                {
-                case 16:
-                    rc = UncompressInt ( p_reader, p_dataSize, decode_uint16 );
-                    break;
-                case 32:
-                    rc = UncompressInt ( p_reader, p_dataSize, decode_uint32 );
-                    break;
-                case 64:
-                    rc = UncompressInt ( p_reader, p_dataSize, decode_uint64 );
-                    break;
-                default:
-                    LogMsg ( klogErr, "protocol-parser: bad element size for packed integer" );
-                    rc = RC ( rcExe, rcFile, rcReading, rcData, rcInvalid );
-                    break;
-                }
+                rc = UncompressInt ( * col, p_reader . GetBuffer (), p_dataSize );
                 if ( rc == 0 )
                 {
                     rc = p_dbLoader . CellData ( p_columnId, m_unpackingBuf . data(), m_unpackingBuf . size() * 8 / col -> elemBits );
@@ -636,6 +640,102 @@ GeneralLoader :: PackedProtocolParser :: ParseData ( Reader& p_reader, DatabaseL
     return rc;
 }
 
+rc_t
+GeneralLoader :: PackedProtocolParser :: ParseBatch ( Reader& p_reader, DatabaseLoader& p_dbLoader, uint32_t p_columnId, const gwp_batch_evt_v1& p_evt )
+{
+    const DatabaseLoader :: Column* col = p_dbLoader . GetColumn ( p_columnId );
+    if ( col == 0 )
+    {
+        return RC ( rcExe, rcFile, rcReading, rcColumn, rcNotFound );
+    }
+
+    uint32_t rawSize = ncbi :: raw_size ( p_evt );
+    uint32_t dataSize = ncbi :: size ( p_evt );
+    if ( rawSize > BATCH_LIMIT || dataSize > BATCH_LIMIT )
+    {
+        LogMsg ( klogErr, "protocol-parser: cell batch exceeds maximum size" );
+        return RC ( rcExe, rcFile, rcReading, rcData, rcExcessive );
+    }
+
+    // every row takes at least one byte for its element count
+    uint32_t rowCount = ncbi :: get_nrows ( p_evt );
+    if ( rowCount > rawSize )
+    {
+        LogMsg ( klogErr, "protocol-parser: cell batch row count exceeds its size" );
+        return RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt );
+    }
+
+    rc_t rc = p_reader . Read ( dataSize );
+    if ( rc != 0 )
+    {
+        return rc;
+    }
+
+    const uint8_t* payload = reinterpret_cast<const uint8_t*> ( p_reader . GetBuffer () );
+    switch ( ncbi :: codec ( p_evt ) )
+    {
+    case gw_batch_none:
+        if ( dataSize != rawSize )
+        {
+            LogMsg ( klogErr, "protocol-parser: bad cell batch size" );
+            return RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt );
+        }
+        break;
+    case gw_batch_zlib:
+        {
+            m_batchBuf . resize ( rawSize );
+            uLongf inflated = rawSize;
+            if ( uncompress ( m_batchBuf . data (), & inflated, payload, dataSize ) != Z_OK || inflated != rawSize )
+            {
+                LogMsg ( klogErr, "protocol-parser: cannot inflate cell batch" );
+                return RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt );
+            }
+            payload = m_batchBuf . data ();
+        }
+        break;
+    default:
+        pLogMsg ( klogErr, "protocol-parser: unknown cell batch codec $(c)", "c=%u", ( unsigned ) ncbi :: codec ( p_evt ) );
+        return RC ( rcExe, rcFile, rcReading, rcData, rcUnsupported );
+    }
+
+    // element counts, then the cells
+    const uint8_t* cur = payload;
+    const uint8_t* end = payload + rawSize;
+    uint64_t cellBytes = 0;
+    m_batchCounts . resize ( rowCount );
+    for ( uint32_t i = 0; i < rowCount; ++i )
+    {
+        int numRead = decode_uint32 ( cur, end, & m_batchCounts [ i ] );
+        if ( numRead <= 0 )
+        {
+            pLogMsg ( klogErr, "protocol-parser: decode_uint32() returned $(i)", "i=%i", numRead );
+            return RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt );
+        }
+        cur += numRead;
+        cellBytes += ( ( uint64_t ) m_batchCounts [ i ] * col -> elemBits + 7 ) / 8;
+    }
+
+    const void* cells = cur;
+    uint64_t cellsSize = end - cur;
+    if ( col -> IsCompressed () )
+    {
+        rc = UncompressInt ( * col, cur, ( uint32_t ) cellsSize );
+        if ( rc != 0 )
+        {
+            return rc;
+        }
+        cells = m_unpackingBuf . data ();
+        cellsSize = m_unpackingBuf . size ();
+    }
+    if ( cellsSize != cellBytes )
+    {
+        LogMsg ( klogErr, "protocol-parser: cell batch data does not match its element counts" );
+        return RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt );
+    }
+
+    return p_dbLoader . CellBatch ( p_columnId, cells, m_batchCounts . data (), rowCount );
+}
+
 rc_t
 GeneralLoader :: PackedProtocolParser :: ParseEvents( Reader& p_reader, DatabaseLoader& p_dbLoader )
 {
@@ -955,6 +1055,34 @@ GeneralLoader :: PackedProtocolParser :: ParseEvents( Reader& p_reader, Database
             }
             break;
 
+        case evt_cell_batch:
+            {
+                uint32_t columnId = ncbi :: id ( evt_header );
+                pLogMsg ( klogDebug, "protocol-parser event: Cell-Batch (packed), id=$(i)", "i=%u", columnId );
+
+                gwp_batch_evt_v1 evt;
+                rc = ReadEvent ( p_reader, evt );
+                if ( rc == 0 )
+                {
+                    rc = ParseBatch ( p_reader, p_dbLoader, columnId, evt );
+                }
+            }
+            break;
+
+        case evt_next_rows:
+            {
+                uint32_t tableId = ncbi :: id ( evt_header );
+                pLogMsg ( klogDebug, "protocol-parser event: Next-Rows (packed), id=$(i)", "i=%u", tableId );
+
+                gwp_move_ahead_evt_v1 evt;
+                rc = ReadEvent ( p_reader, evt );
+                if ( rc == 0 )
+                {
+                    rc = p_dbLoader . NextRows ( tableId, ncbi :: get_nrows ( evt ) );
+                }
+            }
+            break;
+
         case evt_errmsg:
             rc = Handle_1stringEvent( p_reader, p_dbLoader, "Error-Message (packed)", & DatabaseLoader::ErrorMessage );
             break;
@@ -128,6 +128,7 @@ public:
     static const uint32_t Column64Id = 64;
 
     static std::string argv0;
+    static bool pipelined;
 
 public:
     GeneralLoaderFixture()
@@ -159,6 +160,7 @@ public:
 
         GeneralLoader* ret = new GeneralLoader ( argv0, * inStream );
         ret -> AddSchemaIncludePath ( ScratchDir );
+        ret -> SetPipelined ( pipelined );
 
         THROW_ON_RC ( KStreamRelease ( inStream ) );
         THROW_ON_RC ( KFileRelease ( p_input ) );
@@ -186,6 +188,7 @@ public:
 
         GeneralLoader gl ( argv0, *inStream );
         gl . AddSchemaIncludePath ( ScratchDir );
+        gl . SetPipelined ( pipelined );
 
         rc_t rc = gl.Run();
         bool ret;
@@ -453,6 +456,7 @@ template<> std::string GeneralLoaderFixture::GetValue ( const string& p_table, c
 }
 
 std::string GeneralLoaderFixture :: argv0;
+bool GeneralLoaderFixture :: pipelined = false;
 
 FIXTURE_TEST_CASE ( EmptyInput, GeneralLoaderFixture )
 {
@@ -1261,6 +1265,42 @@ FIXTURE_TEST_CASE ( IntegerCompression_MultipleValues, GeneralLoaderFixture )
     REQUIRE_EQ ( u64value2, GetValueWithIndex<uint64_t> ( "TABLE1", "column64", 1, 2, 1 ) );
 }
 
+FIXTURE_TEST_CASE ( IntegerCompression_Batch, GeneralLoaderFixture )
+{
+    if ( ! SetUpForIntegerCompression ( GetName() ) )
+        return;
+
+    // 2 rows: { 3 }, { 4, 0x1234 }
+    const uint32_t u32value1 = 3;
+    const uint32_t u32value2 = 4;
+    const uint32_t u32value3 = 0x1234;
+
+    m_source . OpenStreamEvent();
+
+    uint8_t buf[128];
+    int bytesTotal = 0;
+    bytesTotal += encode_uint32 ( 1, buf + bytesTotal, buf + sizeof buf );
+    bytesTotal += encode_uint32 ( 2, buf + bytesTotal, buf + sizeof buf );
+    bytesTotal += encode_uint32 ( u32value1, buf + bytesTotal, buf + sizeof buf );
+    bytesTotal += encode_uint32 ( u32value2, buf + bytesTotal, buf + sizeof buf );
+    bytesTotal += encode_uint32 ( u32value3, buf + bytesTotal, buf + sizeof buf );
+    REQUIRE_EQ ( 7, bytesTotal );
+    m_source . CellBatchEventRaw ( Column32Id, 2, buf, bytesTotal );
+
+    m_source . NextRowsEvent ( DefaultTableId, 2 );
+    m_source . CloseStreamEvent();
+
+    {
+        GeneralLoader* gl = MakeLoader ( m_source . MakeSource () );
+        REQUIRE ( RunLoader ( *gl, 0 ) );
+        delete gl;
+    } // make sure loader is destroyed (= db closed) before we reopen the database for verification
+
+    REQUIRE_EQ ( u32value1, GetValue<uint32_t> ( "TABLE1", "column32", 1 ) );
+    REQUIRE_EQ ( u32value2, GetValueWithIndex<uint32_t> ( "TABLE1", "column32", 2, 2, 0 ) );
+    REQUIRE_EQ ( u32value3, GetValueWithIndex<uint32_t> ( "TABLE1", "column32", 2, 2, 1 ) );
+}
+
 // default values
 
 FIXTURE_TEST_CASE ( OneColumnDefaultNoWrite, GeneralLoaderFixture )
@@ -1310,6 +1350,87 @@ FIXTURE_TEST_CASE ( MoveAhead, GeneralLoaderFixture )
     REQUIRE_THROW ( GetValue<string> ( DefaultTable, DefaultColumn, 4 ) );
 }
 
+FIXTURE_TEST_CASE ( OneColumnBatch, GeneralLoaderFixture )
+{
+    if ( ! TestSource::packed )
+        return; // cell batches are used in packed mode only
+
+    OpenStream_OneTableOneColumn ( GetName() );
+
+    // element counts of all rows, then the cells
+    const char* values[] = { "first", "", "third row" };
+    uint8_t buf[128];
+    uint8_t* p = buf;
+    string cells;
+    for ( size_t i = 0; i != 3; ++i )
+    {
+        p += encode_uint32 ( strlen ( values [ i ] ), p, buf + sizeof buf );
+        cells += values [ i ];
+    }
+    memmove ( p, cells . data (), cells . size () );
+    p += cells . size ();
+
+    m_source . CellBatchEventRaw ( DefaultColumnId, 3, buf, p - buf );
+    m_source . NextRowsEvent ( DefaultTableId, 3 );
+    m_source . CloseStreamEvent();
+
+    REQUIRE ( Run ( m_source . MakeSource (), 0 ) );
+
+    REQUIRE_EQ ( string ( values [ 0 ] ), GetValue<string> ( DefaultTable, DefaultColumn, 1 ) );
+    REQUIRE_EQ ( string ( values [ 1 ] ), GetValue<string> ( DefaultTable, DefaultColumn, 2 ) );
+    REQUIRE_EQ ( string ( values [ 2 ] ), GetValue<string> ( DefaultTable, DefaultColumn, 3 ) );
+    REQUIRE_THROW ( GetValue<string> ( DefaultTable, DefaultColumn, 4 ) );
+}
+
+FIXTURE_TEST_CASE ( OneColumnBatch_RowCountMismatch, GeneralLoaderFixture )
+{
+    if ( ! TestSource::packed )
+        return; // cell batches are used in packed mode only
+
+    OpenStream_OneTableOneColumn ( GetName() );
+
+    uint8_t buf[128];
+    uint8_t* p = buf;
+    p += encode_uint32 ( 1, p, buf + sizeof buf );
+    p += encode_uint32 ( 1, p, buf + sizeof buf );
+    * p ++ = 'a';
+    * p ++ = 'b';
+
+    m_source . CellBatchEventRaw ( DefaultColumnId, 2, buf, p - buf );
+    m_source . NextRowsEvent ( DefaultTableId, 3 );
+    m_source . CloseStreamEvent();
+
+    REQUIRE ( Run ( m_source . MakeSource (), SILENT_RC ( rcExe, rcFile, rcReading, rcData, rcInvalid ) ) );
+}
+
+FIXTURE_TEST_CASE ( OneColumnBatch_RowCountExceedsSize, GeneralLoaderFixture )
+{
+    if ( ! TestSource::packed )
+        return; // cell batches are used in packed mode only
+
+    OpenStream_OneTableOneColumn ( GetName() );
+
+    // a row count no payload of this size can hold is rejected before the counts are decoded
+    uint8_t buf[2] = { 0, 0 };
+    m_source . CellBatchEventRaw ( DefaultColumnId, 0x7FFFFFFF, buf, sizeof buf );
+    m_source . CloseStreamEvent();
+
+    REQUIRE ( Run ( m_source . MakeSource (), SILENT_RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt ) ) );
+}
+
+FIXTURE_TEST_CASE ( OneColumnBatch_EmptyWithRows, GeneralLoaderFixture )
+{
+    if ( ! TestSource::packed )
+        return; // cell batches are used in packed mode only
+
+    OpenStream_OneTableOneColumn ( GetName() );
+
+    m_source . CellBatchEventRaw ( DefaultColumnId, 2, "", 0 );
+    m_source . CloseStreamEvent();
+
+    REQUIRE ( Run ( m_source . MakeSource (), SILENT_RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt ) ) );
+}
+
 FIXTURE_TEST_CASE ( OneColumnDefaultOverwite, GeneralLoaderFixture )
 {
     OpenStream_OneTableOneColumn ( GetName() );
@@ -1553,6 +1674,44 @@ FIXTURE_TEST_CASE ( MultipleTables_Multiple_Columns_MultipleRows, GeneralLoaderF
     REQUIRE_EQ ( t2c2v2,    GetValue<uint8_t>   ( Table2, U8Column, 2 ) );
 }
 
+FIXTURE_TEST_CASE ( MultipleTables_ManyRows, GeneralLoaderFixture )
+{   // enough rows for the pipelined loader to hand over several batches per table
+    SetUpStream ( GetName() );
+
+    m_source . NewTableEvent ( 100, DefaultTable );
+    m_source . NewColumnEvent ( 1, 100, U32Column, 32 );
+
+    m_source . NewTableEvent ( 200, Table2 );
+    m_source . NewColumnEvent ( 2, 200, I64Column, 64 );
+
+    m_source . OpenStreamEvent();
+
+    const uint32_t rows = 10000;
+    for ( uint32_t i = 0; i < rows; ++i )
+    {
+        m_source . CellDataEvent( 1, i );
+        m_source . NextRowEvent ( 100 );
+        if ( i % 2 == 0 )
+        {
+            m_source . CellDataEvent( 2, - ( int64_t ) i );
+            m_source . NextRowEvent ( 200 );
+        }
+    }
+
+    m_source . CloseStreamEvent();
+
+    REQUIRE ( Run ( m_source . MakeSource (), 0 ) );
+
+    REQUIRE_EQ ( ( uint32_t ) 0,        GetValue<uint32_t>  ( DefaultTable, U32Column, 1 ) );
+    REQUIRE_EQ ( ( uint32_t ) 5000,     GetValue<uint32_t>  ( DefaultTable, U32Column, 5001 ) );
+    REQUIRE_EQ ( rows - 1,              GetValue<uint32_t>  ( DefaultTable, U32Column, rows ) );
+    REQUIRE_THROW ( GetValue<uint32_t> ( DefaultTable, U32Column, rows + 1 ) );
+
+    REQUIRE_EQ ( ( int64_t ) 0,         GetValue<int64_t>   ( Table2, I64Column, 1 ) );
+    REQUIRE_EQ ( ( int64_t ) -9998,     GetValue<int64_t>   ( Table2, I64Column, rows / 2 ) );
+    REQUIRE_THROW ( GetValue<int64_t> ( Table2, I64Column, rows / 2 + 1 ) );
+}
+
 FIXTURE_TEST_CASE ( AdditionalSchemaIncludePaths_Single, GeneralLoaderFixture )
 {
     string schemaPath = "schema";
@@ -1786,6 +1945,14 @@ int main ( int argc, char *argv [] )
         cerr << "Packed protocol: ";
         rc = GeneralLoaderTestSuite(argc, argv);
     }
+    if ( rc == 0 )
+    {
+        ClearScratchDir();
+
+        GeneralLoaderFixture :: pipelined = true;
+        cerr << "Packed protocol, pipelined: ";
+        rc = GeneralLoaderTestSuite(argc, argv);
+    }
 
     ClearScratchDir();
 
@@ -90,6 +90,7 @@ public:
     void CloseStreamEvent ();
     void NextRowEvent ( TableId p_id );
     void MoveAheadEvent ( TableId p_id, uint64_t p_count );
+    void NextRowsEvent ( TableId p_id, uint64_t p_count );
     void CellDefaultEvent ( ColumnId p_columnId, const std :: string& p_value );
     void CellDefaultEvent ( ColumnId p_columnId, uint32_t p_value );
     void CellDefaultEvent ( ColumnId p_columnId, bool p_value );
@@ -111,6 +112,11 @@ public:
     {
         m_buffer -> Write ( Event ( evt_cell_data, p_columnId, p_elemCount, p_size, p_value ) );
     }
+    // packed only; p_payload is the packed element counts followed by the cells, not compressed
+    void CellBatchEventRaw ( ColumnId p_columnId, uint32_t p_rowCount, const void* p_payload, uint32_t p_size )
+    {
+        m_buffer -> Write ( Event ( evt_cell_batch, p_columnId, p_rowCount, p_size, p_payload ) );
+    }
 
 private:
     struct Event
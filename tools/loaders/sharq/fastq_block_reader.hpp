@@ -0,0 +1,191 @@
+#ifndef __FASTQ_BLOCK_READER_HPP__
+#define __FASTQ_BLOCK_READER_HPP__
+
+/**
+ * @file fastq_block_reader.hpp
+ * @brief Block-oriented line reader
+ *
+ * Pulls large blocks from the input stream and hands out the lines
+ * as string_views into the block. The newlines of a block are indexed
+ * once, right after the block is read (16 bytes at a time with SSE2).
+ *
+ * A block is refcounted: a line stays valid for as long as the block
+ * holding it is alive (see current_block()); without holding the block
+ * a line is valid until the next call to get_line().
+ */
+
+#include <istream>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace sharq {
+
+/**
+ * @brief Refcounted input block
+ *
+ */
+struct fastq_block_t
+{
+    explicit fastq_block_t(size_t capacity) : data(capacity) {}
+    vector<char> data;
+    size_t size = 0;            ///< bytes used in data
+};
+
+using fastq_block_ptr = shared_ptr<const fastq_block_t>;
+
+
+/**
+ * @brief Appends the offsets of all newlines in [begin, end) to eol
+ *
+ * @param[in] data start of the block, the offsets are relative to it
+ * @param[in] begin first byte to scan
+ * @param[in] end end of the scan
+ * @param[in,out] eol newline offsets
+ */
+inline void find_newlines(const char* data, size_t begin, size_t end, vector<uint32_t>& eol)
+{
+    size_t pos = begin;
+#if defined(__SSE2__)
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; pos + 16 <= end; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+        while (mask != 0) {
+            eol.push_back(uint32_t(pos + __builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+    }
+#endif
+    while (pos < end) {
+        const char* p = (const char*)memchr(data + pos, '\n', end - pos);
+        if (p == nullptr)
+            break;
+        eol.push_back(uint32_t(p - data));
+        pos = (p - data) + 1;
+    }
+}
+
+
+/**
+ * @brief Line reader on top of an istream
+ *
+ * Mimics std::getline: the last line does not need a newline,
+ * eof() becomes true once the end of the data has been reached
+ * while looking for a line.
+ */
+class fastq_block_reader
+{
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+
+    fastq_block_reader(shared_ptr<istream> stream, size_t block_size = DEFAULT_BLOCK_SIZE)
+        : m_stream(std::move(stream))
+        , m_block_size(block_size > 0 ? block_size : DEFAULT_BLOCK_SIZE)
+    {}
+
+    /**
+     * @brief Retrieves the next line without the newline
+     *
+     * @param[out] line view into the current block
+     * @return false if no line was found (eof)
+     */
+    bool get_line(string_view& line)
+    {
+        if (m_next_eol == m_eol.size() && !load_block()) {
+            // no newline any more, the rest of the data is the last line
+            line = string_view(m_block ? m_block->data.data() + m_line_start : "", m_block ? m_block->size - m_line_start : 0);
+            if (m_block)
+                m_line_start = m_block->size;
+            m_eof = true;
+            return !line.empty();
+        }
+        size_t eol = m_eol[m_next_eol++];
+        line = string_view(m_block->data.data() + m_line_start, eol - m_line_start);
+        m_line_start = eol + 1;
+        return true;
+    }
+
+    bool eof() const { return m_eof; }  ///< Returns true if the end of the data has been reached
+
+    /**
+     * @brief Returns the block the last line points into
+     *
+     * Holding it keeps the lines of this block valid
+     */
+    fastq_block_ptr current_block() const { return m_block; }
+
+    size_t blocks_read() const { return m_blocks_read; } ///< Returns the number of blocks read so far
+
+private:
+    /**
+     * @brief Reads the next block, carrying over the unfinished line
+     *
+     * @return false if the stream has no more data
+     */
+    bool load_block()
+    {
+        if (m_stream_done)
+            return false;
+        const size_t tail = m_block ? m_block->size - m_line_start : 0;
+        size_t capacity = m_block_size;
+        while (capacity < tail + m_block_size / 2)
+            capacity *= 2;  // a line longer than a block
+
+        shared_ptr<fastq_block_t> block;
+        // the previous block can be reused if nobody else holds it
+        if (m_block && m_block.use_count() == 1 && m_block->data.size() >= capacity && m_line_start > 0) {
+            block = m_block;
+            memmove(block->data.data(), block->data.data() + m_line_start, tail);
+        } else {
+            block = make_shared<fastq_block_t>(capacity);
+            if (tail > 0)
+                memcpy(block->data.data(), m_block->data.data() + m_line_start, tail);
+        }
+        block->size = tail;
+
+        size_t scanned = tail;
+        m_eol.clear();
+        m_next_eol = 0;
+        // read until we have at least one complete line or the stream is exhausted
+        while (m_eol.empty() && !m_stream_done) {
+            if (block->size == block->data.size())
+                block->data.resize(block->data.size() * 2);
+            m_stream->read(block->data.data() + block->size, block->data.size() - block->size);
+            size_t got = m_stream->gcount();
+            if (got == 0) {
+                m_stream_done = true;
+                break;
+            }
+            block->size += got;
+            find_newlines(block->data.data(), scanned, block->size, m_eol);
+            scanned = block->size;
+        }
+        m_block = block;
+        m_line_start = 0;
+        ++m_blocks_read;
+        return !m_eol.empty();
+    }
+
+    shared_ptr<istream>         m_stream;
+    size_t                      m_block_size;
+    shared_ptr<fastq_block_t>   m_block;                ///< current block
+    vector<uint32_t>            m_eol;                  ///< newline offsets in the current block
+    size_t                      m_next_eol = 0;         ///< next unused entry in m_eol
+    size_t                      m_line_start = 0;       ///< offset of the next line in the current block
+    size_t                      m_blocks_read = 0;
+    bool                        m_stream_done = false;  ///< the stream has no more data
+    bool                        m_eof = false;          ///< get_line() has hit the end of the data
+};
+
+}  // sharq namespace
+
+#endif
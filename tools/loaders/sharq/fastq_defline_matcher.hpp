@@ -32,6 +32,87 @@ enum
     SRA_PLATFORM_ELEMENT_BIO       = 10
 };
 */
+
+struct CDefLineShape
+/// Cheap structural features of a defline, computed in one pass
+{
+    explicit CDefLineShape(const string_view& defline)
+    :   length( defline.size() ),
+        first( defline.empty() ? 0 : defline[0] )
+    {
+        for (char c : defline) {
+            switch (c) {
+            case ':': ++colons; break;
+            case '_': ++underscores; break;
+            case '.': ++periods; break;
+            case '-': ++dashes; break;
+            case '/':
+            case '\\': ++slashes; break;
+            case '#': ++hashes; break;
+            case '@':
+            case '>':
+            case '+': marker = true; break;
+            default:
+                if (c >= '0' && c <= '9')
+                    ++digits;
+            }
+        }
+    }
+
+    size_t   length = 0;
+    char     first = 0;            ///< first character
+    bool     marker = false;       ///< one of [@>+] is present
+    uint32_t colons = 0;
+    uint32_t underscores = 0;
+    uint32_t periods = 0;
+    uint32_t dashes = 0;
+    uint32_t slashes = 0;          ///< '/' and '\\'
+    uint32_t hashes = 0;
+    uint32_t digits = 0;
+};
+
+struct CDefLineShapeFilter
+/// Conditions a defline has to meet for a matcher's regex to possibly match it
+/// (the character counts are lower bounds taken from the literals of the regex)
+{
+    enum EFirst : uint8_t
+    {
+        eAny,       ///< no condition
+        eMarker,    ///< defline starts with one of [@>+]
+        eAt         ///< defline starts with '@'
+    };
+
+    bool Accepts(const CDefLineShape& shape) const
+    {
+        if (first == eMarker && shape.first != '@' && shape.first != '>' && shape.first != '+')
+            return false;
+        if (first == eAt && shape.first != '@')
+            return false;
+        return (!marker || shape.marker) &&
+            shape.length >= length &&
+            shape.colons >= colons &&
+            shape.underscores >= underscores &&
+            shape.colons + shape.underscores >= colons_underscores &&
+            shape.periods >= periods &&
+            shape.dashes >= dashes &&
+            shape.slashes >= slashes &&
+            shape.hashes >= hashes &&
+            shape.digits >= digits;
+    }
+
+    EFirst   first = eAny;
+    bool     marker = false;
+    size_t   length = 0;
+    uint32_t colons = 0;
+    uint32_t underscores = 0;
+    uint32_t colons_underscores = 0;   ///< separators matched by [:_]
+    uint32_t periods = 0;
+    uint32_t dashes = 0;
+    uint32_t slashes = 0;
+    uint32_t hashes = 0;
+    uint32_t digits = 0;
+};
+
 class CDefLineMatcher
 /// Base class for all defline matchers
 {
@@ -66,6 +147,13 @@ public:
         return re.Matches(defline);
     }
 
+    /**
+     * @brief Cheap pre-check, false if the matcher cannot match a defline of this shape
+     *
+     * @param[in] shape features of the defline
+     */
+    bool MayMatch(const CDefLineShape& shape) const { return mShape.Accepts(shape); }
+
     /**
      * @brief retrun Defline description
      *
@@ -97,6 +185,7 @@ protected:
     string mDefLineName;             ///< Defline description
     CRegExprMatcher re;              ///< regexpr matcher
     string m_tmp_spot;               ///< variable for spot name assembly
+    CDefLineShapeFilter mShape;      ///< prefilter, set by the matchers
 
 };
 
@@ -123,6 +212,7 @@ public:
     CDefLineMatcher_AllMatch():
         CDefLineMatcher("undefined", R"([@>+]([!-~]+)(\s+|$))")
     {
+        mShape.marker = true;
     }
 
     //bool Matches(const string_view& defline) override { return true;}
@@ -142,6 +232,8 @@ public:
             "illuminaNewDataGroup",
             R"(^[@>+]([!-~]+?)(\s+|[_|])([12345]|):([NY]):(\d+|O):?([!-~]*?)(\s+|$))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.colons = 2;
     }
 
     uint8_t GetPlatform() const override {
@@ -408,7 +500,12 @@ public:
         CDefLineMatcherIlluminaNewBase(
             "illuminaNew",
             R"(^[@>+]([!-~]+?)([:_])(\d+)([:_])(\d+)([:_])(-?\d+\.?\d*)([:_])(-?\d+\.\d+|\d+)(\s+|[:_|-])([12345]|):([NY]):(\d+|O):?([!-~]*?)(\s+|$))")
-    {}
+    {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.colons = 2;
+        mShape.colons_underscores = 6;
+        mShape.digits = 4;
+    }
 };
 
 
@@ -420,7 +517,12 @@ public:
         CDefLineMatcherIlluminaNewBase(
             "illuminaNewNoPrefix",
             R"(^[@>+]([!-~]*?)(:?)(\d+)([:_])(\d+)([:_])(\d+)([:_])(\d+)(\s+|_)([12345]|):([NY]):(\d+|O):?([!-~]*?)(\s+|$))")
-    {}
+    {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.colons = 2;
+        mShape.colons_underscores = 5;
+        mShape.digits = 4;
+    }
 
 };
 
@@ -435,6 +537,10 @@ public:
             R"(^[@>+]([!-~]+)([:_])(\d+)([:_])(\d+)([:_])(-?\d+\.?\d*)([:_])(-?\d+\.\d+|\d+)([!-/:-~][!-~]*?\s+|[!-/:-~][!-~]*?[:_|-])([12345]|):([NY]):(\d+|O):?([!-~]*?)(\s+|$))"),
         mSuffixPattern("(#[!-~]*?|)(/[12345]|\\[12345])?([!-~]*?)(#[!-~]*?|)(/[12345]|\\[12345])?([:_|]?)(\\s+|$)")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.colons = 2;
+        mShape.colons_underscores = 6;
+        mShape.digits = 4;
     }
     virtual void GetMatch(CFastqRead& read) override
     {
@@ -471,7 +577,11 @@ public:
         CDefLineMatcherIlluminaNewBase(
             "illuminaNewWithPeriods",
             "^[@>+]([!-~]+?)(\\.)(\\d+)(\\.)(\\d+)(\\.)(\\d+)(\\.)(\\d+)(\\s+|_)([12345]|)\\.([NY])\\.(\\d+|O)\\.?([!-~]*?)(\\s+|$)")
-    {}
+    {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.periods = 6;
+        mShape.digits = 4;
+    }
 };
 
 
@@ -483,7 +593,11 @@ public:
         CDefLineMatcherIlluminaNewBase(
             "illuminaNewWithUnderscores",
             "^[@>+]([!-~]+?)(_)(\\d+)(_)(\\d+)(_)(\\d+)(_)(\\d+)(\\s+|_)([12345]|)_([NY])_(\\d+|O)_?([!-~]*?)(\\s+|$)")
-    {}
+    {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.underscores = 6;
+        mShape.digits = 4;
+    }
 };
 
 class CDefLineMatcherIlluminaOldColon : public CDefLineMatcherIlluminaOldBase
@@ -494,7 +608,10 @@ public:
         CDefLineMatcherIlluminaOldBase(
             "IlluminaOldColon",
             R"(^[@>+]?([!-~]+?)(:)(\d+)(:)(\d+)(:)(-?\d+\.?\d*)([-:])(-?\d+\.\d+|-?\d+)_?[012]?(#[!-~]*?|)\s?(/[12345]|\\[12345])?(\s+|$))")
-    {}
+    {
+        mShape.colons = 3;
+        mShape.digits = 4;
+    }
 
 };
 
@@ -506,7 +623,10 @@ public:
         CDefLineMatcherIlluminaOldBase(
             "IlluminaOldUnderscore",
             R"(^[@>+]?([!-~]+?)(_)(\d+)(_)(\d+)(_)(-?\d+\.?\d*)(_)(-?\d+\.\d+|-?\d+)(#[!-~]*?|)\s?(/[12345]|\\[12345])?(\s+|$))")
-    {}
+    {
+        mShape.underscores = 4;
+        mShape.digits = 4;
+    }
 
 };
 
@@ -518,7 +638,10 @@ public:
         CDefLineMatcherIlluminaOldBase(
             "IlluminaOldNoPrefix",
             R"(^[@>+]?([!-~]*?)(:?)(\d+)(:)(\d+)(:)(-?\d+\.?\d*)(:)(-?\d+\.\d+|-?\d+)(#[!-~]*?|)\s?(/[12345]|\\[12345])?(\s+|$))")
-    {}
+    {
+        mShape.colons = 3;
+        mShape.digits = 4;
+    }
 
 };
 
@@ -531,7 +654,11 @@ public:
         CDefLineMatcherIlluminaOldBase(
             "IlluminaOldWithSuffix",
             R"(^[@>+]?([!-~]+?)(:)(\d+)(:)(\d+)(:)(-?\d+\.?\d*)(:)(-?\d+\.\d+|-?\d+)(#[!-~]*?|)(/[12345][!-~]+)(\s+|$))")
-    {}
+    {
+        mShape.colons = 4;
+        mShape.slashes = 1;
+        mShape.digits = 4;
+    }
 };
 
 class CDefLineMatcherIlluminaOldWithSuffix2 : public CDefLineMatcherIlluminaOldBase
@@ -542,7 +669,10 @@ public:
         CDefLineMatcherIlluminaOldBase(
             "IlluminaOldWithSuffix2",
             R"(^[@>+]?([!-~]+?)(:)(\d+)(:)(\d+)(:)(-?\d+\.?\d*)(:)(-?\d+\.?\d*[!-~]+?)(#[!-~]*?|)\s?(/[12345]|\\[12345])?(\s+|$))")
-    {}
+    {
+        mShape.colons = 4;
+        mShape.digits = 4;
+    }
 
 };
 
@@ -556,6 +686,8 @@ public:
             "BgiOld",
             R"(^[@>+](\S{1,3}\d{9}\S{0,3})(L\d)(C\d{3})(R\d{3})([_]?\d{1,8})(#[!-~]*?|)(/[1234]\S*|)(\s+|$))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.digits = 17;
     }
     uint8_t GetPlatform() const override {
         return 0;//SRA_PLATFORM_UNDEFINED
@@ -593,7 +725,11 @@ public:
             "BgiNew",
             R"(^[@>+](\S{1,3}\d{9}\S{0,3})(L\d)(C\d{3})(R\d{3})([_]?\d{1,8})(\S*)(\s+|[_|-])([12345]|):([NY]):(\d+|O):?([!-~]*?)(\s+|$))")
 
-    {}
+    {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.colons = 2;
+        mShape.digits = 17;
+    }
 
     uint8_t GetPlatform() const override {
         return 0;//SRA_PLATFORM_UNDEFINED
@@ -804,7 +940,11 @@ public:
     CDefLineMatcherNanopore1() : CDefLineMatcherNanopore_Basic(
             "Nanopore1",
             R"([@>+]+?(channel_)(\d+)(_read_)?(\d+)?([!-~]*?)(_twodirections|_2d|-2D|_template|-1D|_complement|-complement|\.1C|\.1T|\.2D)?(:[!-~ ]+?_ch\d+_file\d+_strand.fast5)?(\s+|$))"
-        ) {}
+        ) {
+        mShape.marker = true;
+        mShape.underscores = 1;
+        mShape.digits = 1;
+    }
 };
 
 class CDefLineMatcherNanopore2 : public CDefLineMatcherNanopore_Basic
@@ -813,7 +953,11 @@ public:
     CDefLineMatcherNanopore2() : CDefLineMatcherNanopore_Basic(
             "Nanopore2",
             R"([@>+]([!-~]*?ch)(\d+)(_file)(\d+)([!-~]*?)(_twodirections|_2d|-2D|_template|-1D|_complement|-complement|\.1C|\.1T|\.2D)(:[!-~ ]+?_ch\d+_file\d+_strand.fast5)?(\s+|$))"
-        ) {}
+        ) {
+        mShape.marker = true;
+        mShape.underscores = 1;
+        mShape.digits = 2;
+    }
 };
 
 class CDefLineMatcherNanopore3 : public CDefLineMatcherNanoporeBase
@@ -824,7 +968,11 @@ public:
             "Nanopore3",
             R"([@>+]([!-~]*?)[: ]?([!-~]+?Basecall)(_[12]D[_0]*?|_Alignment[_0]*?|_Barcoding[_0]*?|)(_twodirections|_2d|-2D|_template|-1D|_complement|-complement|\.1C|\.1T|\.2D|)[: ]([!-~]*?)[: ]?([!-~ ]+?_ch)_?(\d+)(_read|_file)_?(\d+)(_strand\d*.fast5|_strand\d*.*|)(\s+|$))"
         )
-    {}
+    {
+        mShape.marker = true;
+        mShape.underscores = 2;
+        mShape.digits = 2;
+    }
 
     virtual void GetMatch(CFastqRead& read) override
     {
@@ -868,7 +1016,11 @@ public:
             "Nanopore3_1",
             R"([@>+]([!-~]+?)[: ]?([!-~]+?Basecall)(_[12]D[_0]*?|_Alignment[_0]*?|_Barcoding[_0]*?|)(_twodirections|_2d|-2D|_template|-1D|_complement|-complement|\.1C|\.1T|\.2D|)[: ]([!-~]*?)[: ]?([!-~ ]+?_read_)(\d+)(_ch_)(\d+)(_strand\d*.fast5|_strand\d*.*)(\s+|$))"
         )
-    {}
+    {
+        mShape.marker = true;
+        mShape.underscores = 4;
+        mShape.digits = 2;
+    }
 
     virtual void GetMatch(CFastqRead& read) override
     {
@@ -915,7 +1067,10 @@ public:
         getPoreReadNo( R"(read[=_]?(\d+))" ),
         getPoreChannel( R"(ch[=_]?(\d+))" ),
         getPoreBarcode( R"(barcode=(\S+))" )
-    {}
+    {
+        mShape.marker = true;
+        mShape.dashes = 4;
+    }
 
     virtual void GetMatch(CFastqRead& read) override
     {
@@ -955,7 +1110,11 @@ public:
             "Nanopore5",
             R"([@>+]([!-~]*?[0-9a-fA-F]{8}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{12}_Basecall)(_[12]D[_0]*?|_Alignment[_0]*?|_Barcoding[_0]*?)(_twodirections|_2d|-2D|_template|-1D|_complement|-complement|\.1C|\.1T|\.2D)\S*?$)"
         )
-    {}
+    {
+        mShape.marker = true;
+        mShape.underscores = 2;
+        mShape.dashes = 4;
+    }
 
     virtual void GetMatch(CFastqRead& read) override
     {
@@ -980,6 +1139,9 @@ public:
             "LS454",
             R"(^[@>+]([!-~]+_|)([A-Z0-9]{7})(\d{2})([A-Z0-9]{5})(/[12345])?(\s+|$))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.length = 15;
+        mShape.digits = 2;
     }
     uint8_t GetPlatform() const override {
         return SRA_PLATFORM_454;
@@ -1016,6 +1178,9 @@ public:
             "IonTorrent",
             R"(^[@>+]([A-Z0-9]{5})(:)(\d{1,5})(:)(\d{1,5})([^#/\s]*)(#[!-~]*?|)(/[12345]|\\[12345]|[LR])?(\s+|$))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.colons = 2;
+        mShape.digits = 2;
     }
     uint8_t GetPlatform() const override {
         return SRA_PLATFORM_ION_TORRENT;
@@ -1072,6 +1237,9 @@ public:
             "IonTorrent2",
             R"(^[@>+]([A-Z0-9]{5})(:)(\d{1,5})(:)(\d{1,5})([!-~]*)(\s+|[_|])([12345]|):([NY]):(\d+|O):?([!-~]*?)(\s+|$))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.colons = 4;
+        mShape.digits = 2;
     }
     uint8_t GetPlatform() const override {
         return SRA_PLATFORM_ION_TORRENT;
@@ -1114,6 +1282,9 @@ public:
             "PacBio",
             R"(^[@>+](m\d{5,6}_\d{6}_[!-~]+?_c\d{33}_s\d+_[pX]\d/\d+/?\d*_?\d*|m\d{6}_\d{6}_[!-~]+?_c\d{33}_s\d+_[pX]\d[|/]\d+[|/]ccs[!-~]*?)(\s+|$))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.underscores = 5;
+        mShape.digits = 47;
     }
     CDefLineMatcherPacBio(const string& defLineName, const string& pattern) :
         CDefLineMatcher(defLineName, pattern)
@@ -1145,6 +1316,9 @@ public:
             "PacBio2",
             R"(^[@>+]([!-~]*?m\d{5,6}\S{0,3}_\d{6}_\d{6}\S*[/_]\d+[!-~]*?)(\s+|$))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.underscores = 2;
+        mShape.digits = 18;
     }
 };
 
@@ -1158,6 +1332,10 @@ public:
             "PacBio3",
             R"(^[@>+]([!-~]*?m\d{5,6}\S{0,3}_\d{6}_\d{6}\S*[/_]\d+/ccs[!-~]*?)(\s+|$))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.underscores = 2;
+        mShape.slashes = 1;
+        mShape.digits = 18;
     }
 };
 
@@ -1170,6 +1348,10 @@ public:
             "PacBio4",
             R"(^[@>+]([!-~]*?m\d{5,6}\S{0,3}_\d{6}_\d{6}\S*[/_]\d+/\d+_\d+[!-~]*?)(\s+|$))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.underscores = 3;
+        mShape.slashes = 1;
+        mShape.digits = 20;
     }
 };
 
@@ -1185,6 +1367,9 @@ public:
             "illuminaOldBcRnOnly",
             R"(^[@>+]([!-~]+?)(#[!-~]+?)(/[1234]|\\[1234])(\s+|$))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.slashes = 1;
+        mShape.hashes = 1;
     }
     CDefLineIlluminaOldBcRn(const string& defLineName, const string& pattern) :
         CDefLineMatcher(defLineName, pattern)
@@ -1232,6 +1417,8 @@ public:
             "illuminaOldBcOnly",
             R"(^[@>+]([!-~]+?)(#[!-~]+)(\s+|$)(.?))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.hashes = 1;
     }
 };
 
@@ -1245,6 +1432,8 @@ public:
             "illuminaOldRnOnly",
             R"(^[@>+]([!-~]+?)(/[1234]|\\[1234])(\s+|$)(.?))")
     {
+        mShape.first = CDefLineShapeFilter::eMarker;
+        mShape.slashes = 1;
     }
 };
 
@@ -1255,7 +1444,11 @@ public:
         CDefLineMatcher(
             "ElementBio",
             R"(^@([0-9A-z_]+)(:)([0-9A-z\-_]+)(:)([0-9A-z]+)(:)([12])(:)([0-9]+)(:)([0-9]+)(:)([0-9]+))")
-    {}
+    {
+        mShape.first = CDefLineShapeFilter::eAt;
+        mShape.colons = 6;
+        mShape.digits = 4;
+    }
 
     virtual void GetMatch(CFastqRead& read) override
     {
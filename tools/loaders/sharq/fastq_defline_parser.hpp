@@ -170,11 +170,13 @@ bool CDefLineParser::Match(const string_view& defline, bool strict)
     if (mDefLineMatchers[mIndexLastSuccessfulMatch]->Matches(defline)) {
         return true;
     }
+    // only run the regex of the matchers the defline's shape allows
+    const CDefLineShape shape(defline);
     for (size_t i = 0; i < mDefLineMatchers.size(); ++i) {
         if (i == mIndexLastSuccessfulMatch) {
             continue;
         }
-        if (!mDefLineMatchers[i]->Matches(defline)) {
+        if (!mDefLineMatchers[i]->MayMatch(shape) || !mDefLineMatchers[i]->Matches(defline)) {
             continue;
         }
         if (strict && i == mAllMatchIndex)
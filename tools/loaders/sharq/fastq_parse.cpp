@@ -44,6 +44,10 @@
 #include "fastq_error.hpp"
 #include "fastq_parser.hpp"
 #include "fastq_writer.hpp"
+#include "shard_merge.hpp"
+#ifdef SHARQ_VDB_DIRECT
+#include "general_loader_writer.hpp"
+#endif
 
 #include <json.hpp>
 #include <algorithm>
@@ -73,6 +77,10 @@ using json = nlohmann::json;
  * Parser and writer are set up using the digest data
  *
  * Witer's output (stdout) is expected to be piped in general_loader application.
+ * With --vdb-direct the archive is written in-process by general-loader's DatabaseLoader.
+ *
+ * --shard i/N loads only a contiguous range of the input batches,
+ * --merge combines the saved outputs of the shards into one run.
  *
  * --debug parameter can be used to send the output to stdout
  */
@@ -85,6 +93,7 @@ private:
     int xRun();
     int xRunDigest();
     int xRunSpotAssembly();
+    int xRunMerge();
 
     template <typename ScoreValidator, typename parser_t>
     void xParseWithAssembly(json& group, parser_t& parser);
@@ -98,12 +107,14 @@ private:
     void xProcessDigest(json& data);
 
     void xBreakdownOutput();
+    void xSelectShard();
     void xCheckInputFiles(vector<string>& files);
 
     void xReportTelemetry();
     void xCheckErrorLimits(fastq_error& e);
 
     void xCreateWriterFromDigest(json& data);
+    shared_ptr<Writer2> xCreateVdbWriter();
     bool xIsSingleFileInput() const;
 
     /*
@@ -135,6 +146,15 @@ private:
     uint32_t mMaxErrCount{100};         ///< Maximum numbers of errors allowed when parsing reads
     atomic<uint32_t> mErrorCount{0};            ///< Global error counter
     size_t mHotReadsThreshold{10000000};      ///< Threshold for hot reads
+    string mSpillDir;                   ///< Directory for spilling far reads in spot assembly mode
+    unsigned mSpillPartitions{64};      ///< Number of spill partitions
+    bool mVdbDirect{false};             ///< Write the archive in-process instead of the general-writer stream
+    vector<string> mVdbIncludes;        ///< Schema include paths for the in-process writer
+    vector<string> mVdbSchemas;         ///< Additional schema files for the in-process writer
+    unsigned mShardIndex{0};            ///< Shard to load
+    unsigned mShardCount{1};            ///< Number of shards the input batches are split into
+    bool mMerge{false};                 ///< Merge mode: combine the outputs of the shards
+    vector<string> mMergeParts;         ///< Outputs of the shards to merge
     uint8_t m_platform_code{0};         ///< Platform code set from the parameters
     set<int> mErrorSet = { 100, 110, 111, 120, 130, 140, 160, 190}; ///< Error codes that will be allowed up to mMaxErrCount
     size_t mMaxSpotsInLinearMode = 1200000000; ///< Max spot number for linear (non-spot assembly) mode
@@ -282,6 +302,19 @@ int CFastqParseApp::AppMain(int argc, const char* argv[])
             ->check(CLI::IsMember({"trace", "debug", "info", "warning", "error"}));
 
         app.add_option("--hot-reads-threshold", mHotReadsThreshold, "Hot reads threshold");
+        app.add_option("--spill-dir", mSpillDir, "Spill far reads to this directory in spot assembly mode");
+        app.add_option("--spill-partitions", mSpillPartitions, "Number of spill partitions")
+            ->default_val(64)
+            ->check(CLI::Range(1u, 4096u));
+        app.add_flag("--vdb-direct", mVdbDirect, "Write the archive in-process instead of piping to general-loader");
+        app.add_option("--vdb-include", mVdbIncludes, "Schema include path for --vdb-direct")
+            ->delimiter(':');
+        app.add_option("--vdb-schema", mVdbSchemas, "Additional schema file for --vdb-direct");
+
+        string shard;
+        app.add_option("--shard", shard, "Load only shard i of N of the input batches (i/N, i is 0-based)");
+        app.add_flag("--merge", mMerge, "Merge the saved outputs of the shards given as input files")
+            ->excludes("--shard");
 
         string experiment_file;
         app.add_option("--experiment", experiment_file, "Read structure description");
@@ -333,6 +366,12 @@ int CFastqParseApp::AppMain(int argc, const char* argv[])
             mReport["version"] = SHARQ_VERSION;
 
 
+        if (!shard.empty()) {
+            char tail = 0;
+            if (sscanf(shard.c_str(), "%u/%u%c", &mShardIndex, &mShardCount, &tail) != 2 || mShardCount == 0 || mShardIndex >= mShardCount)
+                throw runtime_error(fmt::format("Invalid --shard value '{}', i/N is expected", shard));
+        }
+
         xSetupOutput();
 
         if (!experiment_file.empty()) try {
@@ -347,7 +386,9 @@ int CFastqParseApp::AppMain(int argc, const char* argv[])
 
         copy(read_types.begin(), read_types.end(), back_inserter(mReadTypes));
 
-        if (!read_pairs[0].empty()) {
+        if (mMerge) {
+            mMergeParts = input_files;
+        } else if (!read_pairs[0].empty()) {
             mHasReadPairs = true;
             if (mDigest == 0 && mReadTypes.empty())
                 throw fastq_error(20, "No readTypes provided");
@@ -373,6 +414,8 @@ int CFastqParseApp::AppMain(int argc, const char* argv[])
                 }
             }
         }
+        if (mShardCount > 1 && !mMerge)
+            xSelectShard();
         ret_code = Run();
     } catch (fastq_error& e) {
         spdlog::error(e.Message());
@@ -470,7 +513,9 @@ void CFastqParseApp::xCheckInputFiles(vector<string>& files)
 int CFastqParseApp::Run()
 {
     int retStatus = 0;
-    if (mDigest != 0)
+    if (mMerge)
+        retStatus = xRunMerge();
+    else if (mDigest != 0)
         retStatus = xRunDigest();
     else if (mSpotAssembly)
         retStatus = xRunSpotAssembly();
@@ -638,6 +683,17 @@ bool CFastqParseApp::xIsSingleFileInput() const
     return all_of(mInputBatches.begin(), mInputBatches.end(), [](const auto& it) { return it.size() == 1; });
 }
 
+shared_ptr<Writer2> CFastqParseApp::xCreateVdbWriter()
+{
+    if (!mVdbDirect)
+        return shared_ptr<Writer2>();   // general-writer stream to mpOutStr
+#ifdef SHARQ_VDB_DIRECT
+    return make_shared<sharq::general_loader_writer>("sharq", mVdbIncludes, mVdbSchemas);
+#else
+    throw runtime_error("--vdb-direct is not supported by this build");
+#endif
+}
+
 void CFastqParseApp::xCreateWriterFromDigest(json& data)
 {
     assert(data.contains("groups"));
@@ -649,9 +705,9 @@ void CFastqParseApp::xCreateWriterFromDigest(json& data)
         m_writer = make_shared<fastq_writer_debug>();
     } else {
         if (platform_code == SRA_PLATFORM_454 && s_has_split_read_spec(mExperimentSpecs) && xIsSingleFileInput()) {
-            m_writer = make_shared<fastq_writer_exp>(mExperimentSpecs, *mpOutStr);
+            m_writer = make_shared<fastq_writer_exp>(mExperimentSpecs, *mpOutStr, xCreateVdbWriter());
         } else {
-            m_writer = make_shared<fastq_writer_vdb>(*mpOutStr);
+            m_writer = make_shared<fastq_writer_vdb>(*mpOutStr, xCreateVdbWriter());
         }
     }
 
@@ -698,6 +754,8 @@ int CFastqParseApp::xRun()
         if (!mDebug)
             parser.set_spot_file(mSpotFile);
         parser.set_allow_early_end(mAllowEarlyFileEnd);
+        parser.set_inflate_threads(mThreads);
+        parser.set_stage_workers(max(1u, mThreads / 8)); // telemetry workers
         m_writer->open();
         auto err_checker = [this](fastq_error& e) -> void { CFastqParseApp::xCheckErrorLimits(e);};
         for (auto& group : data["groups"]) {
@@ -726,12 +784,18 @@ int CFastqParseApp::xRun()
 
         m_writer->close(); // m_writer will save read+write fingerprints in metadata if capable
     } catch (exception& e) {
-        if (!mTelemetryFile.empty())
+        if (!mTelemetryFile.empty()) {
             parser.report_telemetry(mReport);
+            if (mNoTimeStamp == false)
+                parser.report_queue_telemetry(mReport);
+        }
         throw;
     }
-    if (!mTelemetryFile.empty())
+    if (!mTelemetryFile.empty()) {
         parser.report_telemetry(mReport);
+        if (mNoTimeStamp == false)
+            parser.report_queue_telemetry(mReport);
+    }
 
     return 0;
 }
@@ -752,8 +816,12 @@ void CFastqParseApp::xParseWithAssembly(json& group, parser_t& parser)
     spdlog::stopwatch sw;
     str_sv_type read_names;
     parser.template first_pass<ScoreValidator>(read_names, err_checker);
-    if (mNoTimeStamp == false)
+    if (mNoTimeStamp == false) {
         mReport["timing"]["first_pass"] =  ceil(sw.elapsed().count() * 100.0) / 100.0;
+#ifdef __linux__
+        mReport["peak_rss_kb"]["first_pass"] = getPeakRSS();
+#endif
+    }
     sw.reset();
 
     //Reset readers
@@ -785,8 +853,12 @@ void CFastqParseApp::xParseWithAssembly(json& group, parser_t& parser)
             parser.template second_pass<ScoreValidator, false>(err_checker, read_index);
     }
 
-    if (mNoTimeStamp == false)
+    if (mNoTimeStamp == false) {
         mReport["timing"]["second_pass"] =  ceil(sw.elapsed().count() * 100.0) / 100.0;
+#ifdef __linux__
+        mReport["peak_rss_kb"]["second_pass"] = getPeakRSS();
+#endif
+    }
 
     parser.template update_readers_telemetry<ScoreValidator>();
 
@@ -809,7 +881,10 @@ int CFastqParseApp::xRunSpotAssembly()
         if (!mDebug)
             parser.set_spot_file(mSpotFile);
         parser.set_allow_early_end(mAllowEarlyFileEnd);
+        parser.set_inflate_threads(mThreads);
+        parser.set_stage_workers(max(1u, mThreads / 8)); // telemetry workers
         parser.set_hot_reads_threshold(mHotReadsThreshold);
+        parser.set_spill(mSpillDir, mSpillPartitions);
 
         //auto err_checker = [this](fastq_error& e) { CFastqParseApp::xCheckErrorLimits(e);};
         for (auto& group : data["groups"]) {
@@ -833,12 +908,18 @@ int CFastqParseApp::xRunSpotAssembly()
         spdlog::info("Parsing complete");
         m_writer->close();
     } catch (exception& e) {
-        if (!mTelemetryFile.empty())
+        if (!mTelemetryFile.empty()) {
             parser.report_telemetry(mReport);
+            if (mNoTimeStamp == false)
+                parser.report_queue_telemetry(mReport);
+        }
         throw;
     }
-    if (!mTelemetryFile.empty())
+    if (!mTelemetryFile.empty()) {
         parser.report_telemetry(mReport);
+        if (mNoTimeStamp == false)
+            parser.report_queue_telemetry(mReport);
+    }
 
     return 0;
 }
@@ -863,6 +944,46 @@ void CFastqParseApp::xBreakdownOutput()
     }
 }
 
+//  ----------------------------------------------------------------------------
+void CFastqParseApp::xSelectShard()
+{
+    // the reads of a spot can be anywhere in the input in spot assembly mode
+    if (mSpotAssembly)
+        throw runtime_error("--shard is not supported in spot assembly mode");
+    size_t num_batches = mInputBatches.size();
+    if (num_batches < mShardCount)
+        throw runtime_error(fmt::format("--shard {}/{}: only {} input batch(es) to split", mShardIndex, mShardCount, num_batches));
+    // contiguous ranges keep the order of the spots in the merged run
+    size_t first = num_batches * mShardIndex / mShardCount;
+    size_t last = num_batches * (mShardIndex + 1) / mShardCount;
+    mInputBatches = vector<TInputFiles>(mInputBatches.begin() + first, mInputBatches.begin() + last);
+    mReport["shard"]["index"] = mShardIndex;
+    mReport["shard"]["count"] = mShardCount;
+    mReport["shard"]["batches"] = last - first;
+}
+
+//  ----------------------------------------------------------------------------
+int CFastqParseApp::xRunMerge()
+{
+    if (mMergeParts.empty())
+        throw runtime_error("--merge expects the outputs of the shards as input files");
+    auto writer = xCreateVdbWriter();
+    if (!writer)
+        writer = make_shared<Writer2>(*mpOutStr);
+    spdlog::stopwatch sw;
+    sharq::shard_merger merger(writer, mDestination);
+    merger.merge(mMergeParts);
+    const auto& metrics = merger.metrics();
+    mReport["merge"]["parts"] = metrics.parts;
+    mReport["merge"]["rows"] = metrics.rows;
+    mReport["merge"]["bytes"] = metrics.bytes;
+    mReport["merge"]["input_files"] = metrics.input_files;
+    if (mNoTimeStamp == false)
+        mReport["timing"]["merge"] = ceil(sw.elapsed().count() * 100.0) / 100.0;
+    spdlog::info("Merged {} shards, {} rows", metrics.parts, metrics.rows);
+    return 0;
+}
+
 void CFastqParseApp::xCheckErrorLimits(fastq_error& e )
 {
     if (mMaxErrCount == 0)
@@ -65,7 +65,8 @@
 #include "taskflow/taskflow.hpp"
 #include "taskflow/algorithm/sort.hpp"
 #include "fastq_defline_parser.hpp"
-#include "rwqueue/readerwriterqueue.h"
+#include "stage_queue.hpp"
+#include "spot_name_index.hpp"
 #include <condition_variable>
 #include <chrono>
 #include <regex>
@@ -75,6 +76,7 @@
 #include <fingerprint.hpp>
 #include <kfile_stream/kfile_stream.hpp>
 #include "istreambuf_holder.hpp"
+#include "fastq_block_reader.hpp"
 #ifdef SHARQ_USE_NATIVE_CLOUD
 #ifdef CC
 #undef CC
@@ -87,7 +89,6 @@ using namespace std::chrono_literals;
 
 
 using namespace std;
-using namespace moodycamel;
 
 bm::chrono_taker<>::duration_map_type timing_map;
 
@@ -108,117 +109,187 @@ static constexpr int VALIDATE_QUEUE_SIZE = 1024;
 static constexpr int ASSEMBLE_QUEUE_SIZE = 2 * 1024;
 static constexpr int SAVE_SPOT_QUEUE_SIZE = 1 * 1024;
 static constexpr int CLEAR_SPOT_QUEUE_SIZE = 1 * 1024;
+static constexpr size_t STAGE_BATCH_SIZE = 64; ///< items taken from a queue at once by the fanned out stages
 
-//#define PRINT_QUEUE_T_STATS
-
-// ReaderWriterQueue wrapper
+// Stage queue: bounded lock-free MPMC queue with utilization stats
+// Several threads may enqueue (see producers) and dequeue,
+// the queue is done when every producer has closed it
 template<typename T, int QUEUE_SIZE = 1024>
 struct queue_t {
+    typedef chrono::steady_clock clock_t;
+
     string m_name;
     atomic<bool> is_done{false};
     atomic<bool>& is_cancelled;
-    bool finished{false};
-    //ReaderWriterQueue<T> queue{QUEUE_SIZE};
-    BlockingReaderWriterQueue<T> queue{QUEUE_SIZE};
-
-    size_t enqueue_count{0};
-    size_t dequeue_count{0};
-
-#ifdef PRINT_QUEUE_T_STATS
-    std::chrono::duration<double> enqueue_idle_time;
-    spdlog::stopwatch enqueue_sw;
-    std::chrono::duration<double> dequeue_idle_time;
-    spdlog::stopwatch dequeue_sw;
-
-    spdlog::stopwatch queue_sw;
-
-    size_t enqueue_idle_count{0};
-    size_t dequeue_idle_count{0};
-#endif
-    queue_t(const string& name, atomic<bool>& is_cancel)
-        : m_name(name), is_cancelled(is_cancel)
+    atomic<bool> finished{false};
+    sharq::mpmc_queue<T> queue{QUEUE_SIZE};
+
+    atomic<size_t> enqueue_count{0};
+    atomic<size_t> dequeue_count{0};
+
+    size_t m_producers;                         ///< number of producers
+    size_t m_consumers;                         ///< number of consumers
+    atomic<size_t> m_open_producers;            ///< producers that have not closed the queue yet
+    atomic<size_t> m_max_occupancy{0};
+    atomic<size_t> m_occupancy_sum{0};
+    atomic<int64_t> m_producer_idle_ns{0};
+    atomic<int64_t> m_consumer_idle_ns{0};
+    atomic<int64_t> m_wall_ns{0};               ///< set when the queue is finished
+    clock_t::time_point m_start;
+
+    queue_t(const string& name, atomic<bool>& is_cancel, size_t producers = 1, size_t consumers = 1)
+        : m_name(name)
+        , is_cancelled(is_cancel)
+        , m_producers(producers)
+        , m_consumers(consumers)
+        , m_open_producers(producers)
+        , m_start(clock_t::now())
     {
-#ifdef PRINT_QUEUE_T_STATS
-        queue_sw.reset();
-#endif
     }
-#ifdef PRINT_QUEUE_T_STATS
-    ~queue_t() {
-        //if (pipeline_cancelled == false && enqueue_count != dequeue_count)
-        //    throw fastq_error("Queue {} count mismatch {} != {}", m_name, enqueue_count, dequeue_count);
-        auto logger = spdlog::get("parser_logger");
-        if (logger) {
-            auto tm_count = queue_sw.elapsed().count();
-            logger->info("Queue {}, time: {:.2f}", m_name, queue_sw);
-            double v = enqueue_idle_time.count();
-            v = v/tm_count;
-            logger->info("enqueue_idle_time: {:.2f}, pct:{:.2f}, enqueue_idle_count: {:L}", enqueue_idle_time.count(), v, enqueue_idle_count);
-            v = dequeue_idle_time.count();
-            v = v/tm_count;
-            logger->info("dequeue_idle_time: {:.2f}, pct:{:.2f}, dequeue_idle_count: {:L}", dequeue_idle_time.count(), v, dequeue_idle_count);
-            logger->info("--------------------");
-        }
-    }
-#endif
 
     inline
     void enqueue(T&& item) {
-
-#ifdef PRINT_QUEUE_T_STATS
-        auto i = enqueue_idle_count;
-        enqueue_sw.reset();
-#endif
-        do {
-            if (queue.try_enqueue(std::move(item))) {
-#ifdef PRINT_QUEUE_T_STATS
-                if (enqueue_idle_count > i) {
-                    enqueue_idle_time += enqueue_sw.elapsed();
+        if (!queue.try_enqueue(std::move(item))) {
+            auto start = clock_t::now();
+            bool queued = false;
+            while (is_cancelled == false && !queued) {
+                std::this_thread::yield();
+                queued = queue.try_enqueue(std::move(item));
+            }
+            m_producer_idle_ns += s_elapsed_ns(start);
+            if (!queued)
+                return;
+        }
+        x_enqueued(1);
+    }
+
+    // Moves all items to the queue, items are cleared
+    void enqueue_bulk(vector<T>& items) {
+        size_t done = queue.try_enqueue_bulk(items);
+        if (done > 0)
+            x_enqueued(done);
+        if (done < items.size()) {
+            auto start = clock_t::now();
+            while (is_cancelled == false && done < items.size()) {
+                std::this_thread::yield();
+                size_t n = queue.try_enqueue_bulk(items, done);
+                if (n > 0) {
+                    x_enqueued(n);
+                    done += n;
                 }
-#endif
-                ++enqueue_count;
-                break;
             }
-#ifdef PRINT_QUEUE_T_STATS
-            ++enqueue_idle_count;
-#endif
-            std::this_thread::yield();
-        } while (is_cancelled == false);
+            m_producer_idle_ns += s_elapsed_ns(start);
+        }
+        items.clear();
     }
+
     inline
     bool dequeue(T& item) {
         if (finished)
             return false;
-#ifdef PRINT_QUEUE_T_STATS
-        auto i = dequeue_idle_count;
-        dequeue_sw.reset();
-#endif
-        do {
-            if (queue.wait_dequeue_timed(item, std::chrono::milliseconds(100))) {
-            //if (queue.try_dequeue(item)) {
-#ifdef PRINT_QUEUE_T_STATS
-                if (dequeue_idle_count > i) {
-                    dequeue_idle_time += dequeue_sw.elapsed();
-                }
-#endif
+        if (queue.try_dequeue(item)) {
+            ++dequeue_count;
+            return true;
+        }
+        auto start = clock_t::now();
+        bool res = false;
+        for (unsigned spins = 0; is_cancelled == false; ++spins) {
+            // read is_done first: once it is set all items are in the queue
+            bool done = is_done;
+            if (queue.try_dequeue(item)) {
                 ++dequeue_count;
-                return true;
+                res = true;
+                break;
             }
-#ifdef PRINT_QUEUE_T_STATS
-            ++dequeue_idle_count;
-#endif
-            if (is_done == true && queue.peek() == nullptr) {
-                finished = true;
+            if (done) {
+                x_finish();
                 break;
             }
-            std::this_thread::yield();
-        } while (is_cancelled == false);
-        return false;
+            s_backoff(spins);
+        }
+        m_consumer_idle_ns += s_elapsed_ns(start);
+        return res;
     }
 
+    // Replaces the content of items with up to max_items from the queue,
+    // returns false if the queue is finished
+    bool dequeue_bulk(vector<T>& items, size_t max_items) {
+        items.clear();
+        if (finished)
+            return false;
+        size_t n = queue.try_dequeue_bulk(items, max_items);
+        if (n == 0) {
+            auto start = clock_t::now();
+            for (unsigned spins = 0; is_cancelled == false; ++spins) {
+                bool done = is_done;
+                n = queue.try_dequeue_bulk(items, max_items);
+                if (n > 0)
+                    break;
+                if (done) {
+                    x_finish();
+                    break;
+                }
+                s_backoff(spins);
+            }
+            m_consumer_idle_ns += s_elapsed_ns(start);
+        }
+        dequeue_count += n;
+        return n > 0;
+    }
+
+    // Called by each producer when it is done
     void close() {
-        is_done = true;
+        if (m_open_producers.fetch_sub(1) <= 1)
+            is_done = true;
+    }
+
+    // Returns true if the queue is closed and drained
+    bool eof() const {
+        return is_done && queue.empty_approx();
     }
 
+    sharq::queue_stats_t stats() const {
+        sharq::queue_stats_t s;
+        s.capacity = queue.capacity();
+        s.producers = m_producers;
+        s.consumers = m_consumers;
+        s.enqueued = enqueue_count;
+        s.dequeued = dequeue_count;
+        s.max_occupancy = m_max_occupancy;
+        s.occupancy_sum = m_occupancy_sum;
+        s.producer_idle = m_producer_idle_ns / 1e9;
+        s.consumer_idle = m_consumer_idle_ns / 1e9;
+        int64_t wall = m_wall_ns;
+        s.wall = (wall ? wall : s_elapsed_ns(m_start)) / 1e9;
+        return s;
+    }
+
+private:
+    void x_enqueued(size_t n) {
+        enqueue_count += n;
+        size_t occupancy = queue.size_approx();
+        m_occupancy_sum += occupancy * n;
+        size_t curr_max = m_max_occupancy;
+        while (occupancy > curr_max && !m_max_occupancy.compare_exchange_weak(curr_max, occupancy))
+            ;
+    }
+
+    void x_finish() {
+        finished = true;
+        int64_t expected = 0;
+        m_wall_ns.compare_exchange_strong(expected, s_elapsed_ns(m_start));
+    }
+
+    static int64_t s_elapsed_ns(clock_t::time_point start) {
+        return chrono::duration_cast<chrono::nanoseconds>(clock_t::now() - start).count();
+    }
+
+    static void s_backoff(unsigned spins) {
+        if (spins < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(chrono::microseconds(100));
+    }
 };
 
 #define BEGIN_MT_EXCEPTION std::exception_ptr ex_ptr = nullptr; try {
@@ -291,6 +362,7 @@ public:
         : m_defline_parser( platform )
         , m_file_name(file_name)
         , m_stream(_stream)
+        , m_line_reader(make_shared<sharq::fastq_block_reader>(_stream))
         , m_read_type(read_type)
         , m_read_type_sz(m_read_type.size())
         , m_curr_platform(platform)
@@ -305,6 +377,7 @@ public:
             m_defline_parser(other.m_defline_parser),
             m_file_name(other.m_file_name),
             m_stream(other.m_stream),
+            m_line_reader(other.m_line_reader),
             m_read_type(other.m_read_type),
             m_read_type_sz(other.m_read_type_sz),
             m_curr_platform(other.m_curr_platform)
@@ -385,9 +458,9 @@ public:
     template<typename ScoreValidator = validator_options<>>
     bool get_spot_mt(const string& spot_name, vector<CFastqRead>& reads);
 
-    bool eof() const { return m_stream->eof();}  ///< Returns true if file is  at eof
+    bool eof() const { return m_line_reader->eof();}  ///< Returns true if file is  at eof
     // multi-threaded version of eof
-    bool eof_mt() const { return m_read_queue->is_done && m_read_queue->queue.peek() == nullptr;}  ///< Returns true if file is at eof
+    bool eof_mt() const { return m_read_queue->eof();}  ///< Returns true if file is at eof
 
     bool end_of_data() const { return m_buffered_spot.empty() && m_pending_spot.empty() && eof();}  ///< Returns true if file has no more reads
     // multi-threaded version of end_of_data
@@ -402,6 +475,11 @@ public:
      *
      */
     bool is_compressed() const {
+        auto holder = dynamic_cast<sharq::istreambuf_holder*>(&*m_stream);
+        if ( holder && holder->is_inflated() )
+        {
+            return true;
+        }
         auto fstream = dynamic_cast<bxz::ifstream*>(&*m_stream);
         if ( fstream )
         {
@@ -454,6 +532,9 @@ public:
     // fingerprint of all reads consumed so far
     const Fingerprint & fingerprint() const { return m_fingerprint; }
 
+    // utilization of the read queue in the last mt reading
+    const sharq::queue_stats_t& read_queue_stats() const { return m_read_queue_stats; }
+
     data_input_metrics_t m_input_metrics;
 
     const istream & get_stream() const { return * m_stream; }
@@ -462,13 +543,14 @@ private:
     CDefLineParser      m_defline_parser;       ///< Defline parser
     string              m_file_name;            ///< Corresponding file name
     shared_ptr<istream> m_stream;               ///< reader's stream
+    shared_ptr<sharq::fastq_block_reader> m_line_reader; ///< hands out the lines of m_stream as string_views
     vector<char>        m_read_type;            ///< Reader's readType (T|B|A), A - illumina, set based on read length
     size_t              m_line_number = 0;      ///< Line number counter (1-based)
     string              m_buffered_defline;     ///< Defline already read from the stream but not placed in a read
     vector<CFastqRead>  m_buffered_spot;        ///< Spot already read from the stream but no returned to the consumer
     vector<CFastqRead>  m_pending_spot;         ///< Partial spot with the first read only
-    string              m_line;                     ///< Temporary variable to hold current line
-    string_view         m_line_view;                ///< Temporary variable to hold string_view to the current line
+    string              m_line;                     ///< Temporary variable to hold a buffered defline
+    string_view         m_line_view;                ///< Current line, points into m_line_reader's block or into m_line
     string              m_tmp_str;                  ///< Temporary string holder
     int                 m_read_type_sz = 0;         ///< Temporary variable yto hold readtype vector size
     int                 m_curr_platform = 0;        ///< current platform
@@ -479,6 +561,7 @@ private:
     Fingerprint         m_fingerprint;              ///< fingerprint of all reads consumed so far
 
     shared_ptr<queue_t<fastq_read, READ_QUEUE_SIZE>> m_read_queue;
+    sharq::queue_stats_t m_read_queue_stats;    ///< stats of m_read_queue, saved by end_reading
     future<exception_ptr> m_read_future;
     exception_ptr m_read_exception{nullptr};
 
@@ -512,12 +595,12 @@ static bool isCloudURL(const std::string &url)
 using istreambuf_holder = sharq::istreambuf_holder;
 
 #ifdef SHARQ_USE_NATIVE_CLOUD
-static shared_ptr<istream> s_OpenStream(const string& filename, size_t buffer_size = 4096)
+static shared_ptr<istream> s_OpenStream(const string& filename, size_t buffer_size = 4096, unsigned inflate_threads = 0)
 {
     // Handle cloud URLs (S3 and GCS)
     try {
         // Use the cloud filesystem factory
-        return sharq::open_fastq_stream(filename, buffer_size);
+        return sharq::open_fastq_stream(filename, buffer_size, inflate_threads);
     }
     catch (const sharq::fs::FileNotFoundError& e) {
         throw runtime_error("File not found: " + filename);
@@ -646,7 +729,7 @@ int Spawn( const std::string& program, const std::vector<std::string>& args )
 }
 
 static
-shared_ptr<istream> OpenObservedStream( const string& filename, const vdb::KStream * kstream, custom_istream::custom_istream&& stream )
+shared_ptr<istream> OpenObservedStream( const string& filename, const vdb::KStream * kstream, custom_istream::custom_istream&& stream, unsigned inflate_threads )
 {
     const vdb::KStreamMD5ReadObserver * observer = nullptr;
     if ( KStreamMakeMD5ReadObserver ( kstream, & observer ) != 0 )
@@ -655,11 +738,12 @@ shared_ptr<istream> OpenObservedStream( const string& filename, const vdb::KStre
     }
 
     custom_istream::custom_istream * c_istream = new custom_istream::custom_istream( std::move( stream ) );
-    return shared_ptr<istream>( new istreambuf_holder( c_istream, observer ) );
+    return shared_ptr<istream>( new istreambuf_holder( sharq::make_parallel_inflate( c_istream, inflate_threads ), observer ) );
 }
 
+// inflate_threads > 0: gzip/BGZF/zstd input is decompressed by sharq::parallel_inflate_streambuf
 static
-shared_ptr<istream> s_OpenStream(const string& filename, size_t buffer_size)
+shared_ptr<istream> s_OpenStream(const string& filename, size_t buffer_size, unsigned inflate_threads = 0)
 {
     custom_istream::custom_istream * c_istream = nullptr;
     if ( isValidURL( filename ) )
@@ -673,7 +757,7 @@ shared_ptr<istream> s_OpenStream(const string& filename, size_t buffer_size)
                 vdb::KStream * child_stream = nullptr;
                 if ( KStdIOStreamMake ( & child_stream, child, "S3_Stream", true, false ) == 0 )
                 {
-                    return OpenObservedStream( filename, child_stream, custom_istream::custom_istream::make_from_kstream( child_stream, buffer_size ) );
+                    return OpenObservedStream( filename, child_stream, custom_istream::custom_istream::make_from_kstream( child_stream, buffer_size ), inflate_threads );
                 }
                 else
                 {
@@ -690,7 +774,7 @@ shared_ptr<istream> s_OpenStream(const string& filename, size_t buffer_size)
             {
                 throw runtime_error("Failure to open URL '" + filename + "'");
             }
-            return OpenObservedStream( filename, kstream, custom_istream::custom_istream::make_from_kstream( kstream, buffer_size ) );
+            return OpenObservedStream( filename, kstream, custom_istream::custom_istream::make_from_kstream( kstream, buffer_size ), inflate_threads );
         }
     }
     else if ( filename == "-" )
@@ -700,7 +784,7 @@ shared_ptr<istream> s_OpenStream(const string& filename, size_t buffer_size)
         {
             throw runtime_error("Failure to open stdin");
         }
-        return OpenObservedStream( filename, kin, custom_istream::custom_istream::make_from_kstream( kin, buffer_size ) );
+        return OpenObservedStream( filename, kin, custom_istream::custom_istream::make_from_kstream( kin, buffer_size ), inflate_threads );
     }
     else
     {
@@ -717,7 +801,7 @@ shared_ptr<istream> s_OpenStream(const string& filename, size_t buffer_size)
         }
 
         c_istream = new custom_istream::custom_istream( custom_istream::custom_istream::make_from_kfile( kfile, buffer_size ) );
-        return shared_ptr<istream>( new istreambuf_holder( c_istream, observer ));
+        return shared_ptr<istream>( new istreambuf_holder( sharq::make_parallel_inflate( c_istream, inflate_threads ), observer ));
     }
 }
 
@@ -782,12 +866,22 @@ public:
      */
     void set_allow_early_end(bool allow_early_end = true) { m_allow_early_end = allow_early_end; }
 
+    /**
+     * @brief Set the number of decompression threads
+     *
+     * The threads are split between the files of a group,
+     * 0 leaves the decompression to bxzstr
+     *
+     * @param[in]  threads
+     */
+    void set_inflate_threads(unsigned threads) { m_inflate_threads = threads; }
+
     /**
      * @brief Set the spot_file name
      *
      * Debugging/info function: when spot_file name is set
      * the list of all spot names will be serialized
-     * The seirizlized format: BitMagic str_sparse_vector
+     * The serialized format: sharq::spot_name_index
      *
      * @param spot_file[in[
      */
@@ -883,10 +977,10 @@ public:
     void clear_spot_thread();
 
     /**
-     * @brief thread worker
-     * reads from update_telemetry_queue and updates telemetry
+     * @brief thread worker, one of m_stage_workers
+     * reads from update_telemetry_queue and updates the worker's telemetry
     */
-    void update_telemetry_thread();
+    void update_telemetry_thread(size_t worker);
 
     /**
      * @brief thread worker
@@ -909,6 +1003,7 @@ public:
      * @brief Collation check
      *
      * Check if more than one name exists in the collected m_spot_names dictionary
+     * Names added since the last m_spot_names.flush() are not seen
      *
      */
 
@@ -929,6 +1024,26 @@ public:
      */
     void report_telemetry(json& j);
 
+    /**
+     * @brief Reports the utilization of the pipeline queues via json
+     *
+     * Per queue: items passed, max and average occupancy,
+     * the time producers waited on a full queue and consumers on an empty one.
+     * A stage starving for input shows a high consumer idle time of its input queue,
+     * a stage that can't keep up shows a full input queue.
+     *
+     * @param j[out]
+     */
+    void report_queue_telemetry(json& j);
+
+    /**
+     * @brief Set the number of workers for the stages that don't depend on the spot order
+     *
+     * Spot reading, assembly and writing keep a single thread each,
+     * the telemetry stage is fanned out to the workers. Default: 1
+    */
+    void set_stage_workers(unsigned workers) { m_stage_workers = max(1u, workers); }
+
     /**
      * @brief Set threshold for hot/cold reads
      * default: 10000000
@@ -937,6 +1052,18 @@ public:
         m_spot_assembly.m_hot_reads_threshold = threshold;
     }
 
+    /**
+     * @brief Spill far reads to disk instead of keeping them in cold storage
+     *
+     * @param[in] dir directory for the spill files, empty to disable spilling
+     * @param[in] num_partitions number of spill partitions, the memory needed
+     *            to assemble the far spots is about the spill volume / num_partitions
+    */
+    void set_spill(const string& dir, unsigned num_partitions) {
+        m_spot_assembly.m_spill_dir = dir;
+        m_spot_assembly.m_spill_partitions = num_partitions;
+    }
+
     const vector<fastq_reader> & get_readers() const { return m_readers; }
 private:
 
@@ -960,6 +1087,19 @@ private:
         size_t min_sequence_size = numeric_limits<size_t>::max();
     };
 
+    /**
+     * @brief Output telemetry collected by one telemetry worker
+     *
+     */
+    struct spot_telemetry_t {
+        data_output_metrics_t output_metrics;
+        size_t number_of_spots = 0;
+        size_t number_of_reads = 0;
+        size_t number_of_spots_with_orphans = 0;
+        size_t max_sequence_size = 0;
+        size_t min_sequence_size = numeric_limits<size_t>::max();
+    };
+
     struct spot_assembly_metrics_t {
         size_t number_of_far_reads = 0;
         map<uint32_t, size_t> reads_stats; // number of reads, number of spots
@@ -993,19 +1133,39 @@ private:
      * @brief Update telemetry for the assembled spot
      *
      * @param[in] reads assembled spot
+     * @param[in,out] telemetry worker's telemetry
+     */
+    void update_telemetry(const spot_t& spot, spot_telemetry_t& telemetry);
+
+    /**
+     * @brief Start m_stage_workers telemetry workers reading from update_telemetry_queue
+     */
+    void start_telemetry_workers(vector<future<exception_ptr>>& futures);
+
+    /**
+     * @brief Add the workers' telemetry to the current group and output metrics
+     */
+    void merge_telemetry();
+
+    /**
+     * @brief Add the stats of the queue to the ones of the same name
      */
-    void update_telemetry(const spot_t& spot);
+    template<typename Q>
+    void collect_queue_stats(const Q& queue) { m_queue_stats[queue.m_name] += queue.stats(); }
 
     shared_ptr<TWriter>  m_writer;                     ///< FASTQ writer
     vector<fastq_reader> m_readers;                    ///< List of readers
     bool                 m_IsIllumina10x{false};       ///< Parsing Illumina 10x data
-    str_sv_type          m_spot_names;                 ///< Run-time collected spot name dictionary
+    sharq::spot_name_index m_spot_names;               ///< Run-time collected spot name dictionary
     bool                 m_allow_early_end{false};     ///< Allow early file end flag
+    unsigned             m_inflate_threads{0};         ///< Decompression threads per group
     string               m_spot_file;                  ///< Optional file name for spot_name dictionary
     bool                 m_sort_by_readnum{false};          ///< sort reads based on number of readers and existence of read numbers
-    str_sv_type::back_insert_iterator m_spot_names_bi; ///< Internal back_inserter for spot_names collection
     vector<char>         m_read_types;                 ///< ReadTypes
     int                  m_read_type_sz{0};            ///< ReadTypes size
+    unsigned             m_stage_workers{1};           ///< Workers of the order-insensitive stages
+    vector<spot_telemetry_t> m_worker_telemetry;       ///< Telemetry of each telemetry worker
+    map<string, sharq::queue_stats_t> m_queue_stats;   ///< Queue utilization, accumulated over the groups
 
     spot_assembly_t m_spot_assembly;
     std::shared_ptr<spdlog::logger> m_logger;
@@ -1034,25 +1194,19 @@ void s_trim(string_view& in)
         in.remove_suffix(sz - pos);
 }
 
-#define GET_LINE(stream, line, str, count) {\
-line.clear(); \
-if (getline(stream, line).eof()) { \
-    str = line;\
-    if (!line.empty()) {\
-        ++count;\
-        s_trim(str); \
-    } \
-} else { \
+// the line is a view into the reader's current block, no copy is made
+#define GET_LINE(reader, str, count) {\
+if ((reader).get_line(str)) { \
     ++count;\
-    s_trim(str = line); \
-}\
+    s_trim(str); \
+} \
 }\
 
 //  ----------------------------------------------------------------------------
 template<typename ScoreValidator>
 bool fastq_reader::parse_read(CFastqRead& read)
 {
-    if (m_stream->eof())
+    if (eof())
         return false;
     read.Reset();
     if (!m_buffered_defline.empty()) {
@@ -1060,12 +1214,12 @@ bool fastq_reader::parse_read(CFastqRead& read)
         swap(m_line, m_buffered_defline);
         m_line_view = m_line;
     } else {
-        GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+        GET_LINE(*m_line_reader, m_line_view, m_line_number);
         // skip empty lines
         while (m_line_view.empty()) {
-            if (m_stream->eof())
+            if (eof())
                 return false;
-            GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+            GET_LINE(*m_line_reader, m_line_view, m_line_number);
         }
     }
 
@@ -1075,23 +1229,23 @@ bool fastq_reader::parse_read(CFastqRead& read)
     m_defline_parser.Parse(m_line_view, read); // may throw
 
     // sequence
-    GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+    GET_LINE(*m_line_reader, m_line_view, m_line_number);
     while (!m_line_view.empty() && m_line_view[0] != '+') {
         if (m_line_view[0] == '@' || m_line_view[0] == '>') {
             // defline is expected to start with '@' or '>'
             // if it is not, we skip it
-            m_buffered_defline = m_line;
+            m_buffered_defline = m_line_view;
             break;
         }
         m_input_metrics.sequence_len += m_line_view.size();
         read.AddSequenceLine(m_line_view);
-        GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+        GET_LINE(*m_line_reader, m_line_view, m_line_number);
     }
 
     if (!m_line_view.empty() && m_line_view[0] == '+') { // quality score defline
         // quality score defline is expected to start with '+'
         // we skip it
-        GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+        GET_LINE(*m_line_reader, m_line_view, m_line_number);
         if (!m_line_view.empty()) {
             size_t sequence_size = read.Sequence().size();
             if constexpr (ScoreValidator::type() == eNumeric) {
@@ -1100,14 +1254,14 @@ bool fastq_reader::parse_read(CFastqRead& read)
             do {
                 // attempt to detect a missing quality score
                 if (m_line_view[0] == '@' && m_line_view.size() != sequence_size && m_defline_parser.MatchLast(m_line_view)) {
-                    m_buffered_defline = m_line;
+                    m_buffered_defline = m_line_view;
                     break;
                 }
                 m_input_metrics.quality_len += m_line_view.size();
                 read.AddQualityLine(m_line_view);
                 if (read.Quality().size() >= sequence_size)
                     break;
-                GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+                GET_LINE(*m_line_reader, m_line_view, m_line_number);
                 if (m_line_view.empty())
                     break;
             } while (true);
@@ -1471,6 +1625,7 @@ void fastq_reader::end_reading()
     auto read_eptr = m_read_future.get();
     if (read_eptr)
         rethrow_exception(read_eptr);
+    m_read_queue_stats = m_read_queue->stats();
     m_read_queue.reset();
 }
 
@@ -1499,42 +1654,6 @@ void serialize_vec(const string& file_name, str_sv_type& vec)
 }
 
 
-/*!
- *  This function searches list of terms in vec using sparse_vector_scanner.
- *
- *  @param[in] vec  string vector to search in
- *
- *  @param[in] scanner  sparse_vector_scanner to use for the search
- *
- *  @param[in] term  list of terms to search
- *
- *  @return index of found term or -1
- *
- */
-
-template<typename ErrorChecker>
-int s_find_duplicates(str_sv_type& vec, bm::sparse_vector_scanner<str_sv_type>& scanner, const vector<string>& terms, ErrorChecker&& error_checker)
-{
-    auto sz = terms.size();
-    if (sz == 0)
-        return -1;
-    bm::sparse_vector_scanner<str_sv_type>::pipeline<bm::agg_opt_only_counts> pipe(vec);
-    pipe.options().batch_size = 0;
-    for (const auto& term : terms)
-        pipe.add(term.c_str());
-    pipe.complete();
-    scanner.find_eq_str(pipe); // run the search pipeline
-    auto& cnt_vect = pipe.get_bv_count_vector();
-    for (size_t i = 0; i < sz; ++i) {
-        if (cnt_vect[i] > 1) {
-            fastq_error e(170, "Collation check. Duplicate spot '{}' at index {}", terms[i], i);
-            error_checker(e);
-        }
-    }
-    return -1;
-}
-
-
 template<typename TWriter>
 template<typename ErrorChecker>
 void fastq_parser<TWriter>::check_duplicate_spot_names(const vector<search_term_t>& terms, ErrorChecker&& error_checker)
@@ -1542,17 +1661,9 @@ void fastq_parser<TWriter>::check_duplicate_spot_names(const vector<search_term_
     auto sz = terms.size();
     if (sz == 0)
         return;
-    static thread_local bm::sparse_vector_scanner<str_sv_type> scanner;
     spdlog::stopwatch sw;
-    bm::sparse_vector_scanner<str_sv_type>::pipeline<bm::agg_opt_only_counts> pipe(m_spot_names);
-    pipe.options().batch_size = 0;
-    for (const auto& term : terms)
-        pipe.add(term.spot_name.c_str());
-    pipe.complete();
-    scanner.find_eq_str(pipe); // run the search pipeline
-    auto& cnt_vect = pipe.get_bv_count_vector();
     for (size_t i = 0; i < sz; ++i) {
-        if (cnt_vect[i] > 1) {
+        if (m_spot_names.count(terms[i].spot_name) > 1) {
             fastq_error e(170, "Collation check. Duplicate spot '{}' at file {}, line {}", terms[i].spot_name, m_readers[terms[i].reader_idx].file_name(), terms[i].line_no);
             error_checker(e);
         }
@@ -1575,14 +1686,13 @@ void fastq_parser<TWriter>::parse(spot_name_check& name_checker, ErrorChecker&&
     //size_t currCount = 0;
     spdlog::stopwatch sw;
     spdlog::info("Parsing from {} files", m_readers.size());
-    auto spot_names_bi = m_spot_names.get_back_inserter();
 
     assemble_spot_queue.reset(new queue_t<vector<fastq_read>, ASSEMBLE_QUEUE_SIZE>("assemble_spot_queue", pipeline_cancelled));
-    update_telemetry_queue.reset(new queue_t<spot_t, ASSEMBLE_QUEUE_SIZE>("update_telemetry_queue", pipeline_cancelled));
+    update_telemetry_queue.reset(new queue_t<spot_t, ASSEMBLE_QUEUE_SIZE>("update_telemetry_queue", pipeline_cancelled, 1, m_stage_workers));
 
-    array<future<exception_ptr>, 2> futures;
-    futures[1] = std::async(std::launch::async,[this](){ BEGIN_MT_EXCEPTION this->write_spot_thread(); END_MT_EXCEPTION });
-    futures[0] = std::async(std::launch::async,[this](){ BEGIN_MT_EXCEPTION this->update_telemetry_thread(); END_MT_EXCEPTION });
+    vector<future<exception_ptr>> futures;
+    futures.push_back(std::async(std::launch::async,[this](){ BEGIN_MT_EXCEPTION this->write_spot_thread(); END_MT_EXCEPTION }));
+    start_telemetry_workers(futures);
 
     vector<search_term_t> search_terms;
     search_terms.reserve(10000);
@@ -1594,11 +1704,11 @@ void fastq_parser<TWriter>::parse(spot_name_check& name_checker, ErrorChecker&&
         size_t line_no = assembled_spot.front().mLineNumber;
         size_t reader_idx = assembled_spot.front().m_ReaderIdx;
         assemble_spot_queue->enqueue(std::move(assembled_spot));
-        spot_names_bi = spot_name;
+        m_spot_names.add(spot_name);
         if (name_checker.seen_before(spot_name.c_str(), spot_name.size())) {
             search_terms.emplace_back() = { std::move(spot_name), line_no, reader_idx };
             if (search_terms.size() == 10000) {
-                spot_names_bi.flush();
+                m_spot_names.flush();
                 check_duplicate_spot_names(search_terms, error_checker);
                 search_terms.clear();
             }
@@ -1612,11 +1722,16 @@ void fastq_parser<TWriter>::parse(spot_name_check& name_checker, ErrorChecker&&
         if (eptr)
             std::rethrow_exception(eptr);
     }
+    merge_telemetry();
+    collect_queue_stats(*assemble_spot_queue);
+    collect_queue_stats(*update_telemetry_queue);
 
     if (!search_terms.empty()) {
-        spot_names_bi.flush();
+        m_spot_names.flush();
         check_duplicate_spot_names(search_terms, error_checker);
     }
+    if (!m_spot_file.empty())
+        m_spot_names.save(m_spot_file);
 
     update_readers_telemetry<ScoreValidator>();
 
@@ -1693,43 +1808,79 @@ void fastq_parser<TWriter>::update_readers_telemetry()
 }
 
 template<typename TWriter>
-void fastq_parser<TWriter>::update_telemetry(const spot_t& reads)
+void fastq_parser<TWriter>::update_telemetry(const spot_t& reads, spot_telemetry_t& telemetry)
 {
     assert(reads.empty() == false);
-    auto& telemetry = m_telemetry.groups.back();
+    auto& output_metrics = telemetry.output_metrics;
     telemetry.number_of_spots += 1;
     telemetry.number_of_reads += reads.size();
 
-    m_telemetry.output_metrics.read_count += reads.size();
-    ++m_telemetry.output_metrics.spot_count;
+    output_metrics.read_count += reads.size();
+    ++output_metrics.spot_count;
     vector<uint8_t> qual_scores;
     for (const auto& r : reads) {
         auto sz = r.Sequence().size();
-        m_telemetry.output_metrics.sequence_len += sz;
+        output_metrics.sequence_len += sz;
         if (r.mReadType != SRA_READ_TYPE_TECHNICAL) {
-            m_telemetry.output_metrics.sequence_len_bio += sz;
+            output_metrics.sequence_len_bio += sz;
             for (const auto& c : r.Sequence()) {
-                ++m_telemetry.output_metrics.base_counts[c];
+                ++output_metrics.base_counts[c];
             }
         } else {
             for (const auto& c : r.Sequence()) {
-                ++m_telemetry.output_metrics.tech_base_counts[c];
+                ++output_metrics.tech_base_counts[c];
             }
         }
         qual_scores.clear();
         r.GetQualScores(qual_scores);
         for (const auto& c : qual_scores) {
-            ++m_telemetry.output_metrics.quality_counts[c];
+            ++output_metrics.quality_counts[c];
         }
-        telemetry.max_sequence_size = max<int>(sz, telemetry.max_sequence_size);
+        telemetry.max_sequence_size = max<size_t>(sz, telemetry.max_sequence_size);
         telemetry.min_sequence_size = min<size_t>(sz, telemetry.min_sequence_size);
-        m_telemetry.output_metrics.quality_len += r.GetQualScores().size();
+        output_metrics.quality_len += r.GetQualScores().size();
     }
 
-    if ((int)reads.size() < telemetry.reads_per_spot)
+    // reads_per_spot is set from the digest before the parsing starts
+    if ((int)reads.size() < m_telemetry.groups.back().reads_per_spot)
         ++telemetry.number_of_spots_with_orphans;
 }
 
+template<typename TWriter>
+void fastq_parser<TWriter>::start_telemetry_workers(vector<future<exception_ptr>>& futures)
+{
+    m_worker_telemetry.assign(m_stage_workers, spot_telemetry_t());
+    for (size_t i = 0; i < m_stage_workers; ++i)
+        futures.push_back(std::async(std::launch::async, [this, i](){ BEGIN_MT_EXCEPTION this->update_telemetry_thread(i); END_MT_EXCEPTION }));
+}
+
+template<typename TWriter>
+void fastq_parser<TWriter>::merge_telemetry()
+{
+    auto& group = m_telemetry.groups.back();
+    auto& om = m_telemetry.output_metrics;
+    for (const auto& t : m_worker_telemetry) {
+        group.number_of_spots += t.number_of_spots;
+        group.number_of_reads += t.number_of_reads;
+        group.number_of_spots_with_orphans += t.number_of_spots_with_orphans;
+        if (t.number_of_reads > 0) {
+            group.max_sequence_size = max(group.max_sequence_size, t.max_sequence_size);
+            group.min_sequence_size = min(group.min_sequence_size, t.min_sequence_size);
+        }
+        om.sequence_len += t.output_metrics.sequence_len;
+        om.sequence_len_bio += t.output_metrics.sequence_len_bio;
+        om.quality_len += t.output_metrics.quality_len;
+        om.read_count += t.output_metrics.read_count;
+        om.spot_count += t.output_metrics.spot_count;
+        for (size_t i = 0; i < om.base_counts.size(); ++i) {
+            om.base_counts[i] += t.output_metrics.base_counts[i];
+            om.tech_base_counts[i] += t.output_metrics.tech_base_counts[i];
+            om.quality_counts[i] += t.output_metrics.quality_counts[i];
+        }
+    }
+    m_worker_telemetry.clear();
+}
+
 
 
 /**
@@ -1879,71 +2030,15 @@ void fastq_reader::cluster_files(const vector<string>& files, vector<vector<stri
  */
 void check_hash_file(const string& hash_file)
 {
-    str_sv_type vec;
-    {
-        vector<char> buffer;
-        bm::sparse_vector_deserializer<str_sv_type> deserializer;
-        bm::sparse_vector_serial_layout<str_sv_type> lay;
-        bm::read_dump_file(hash_file, buffer);
-        deserializer.deserialize(vec, (const unsigned char*)&buffer[0]);
-    }
-
-
-    spdlog::debug("Checking reads {:L} on {} threads", vec.size(), std::thread::hardware_concurrency());
-    {
-        str_sv_type::statistics st;
-        vec.calc_stat(&st);
-        spdlog::debug("st.memory_used {}", st.memory_used);
-    }
+    sharq::spot_name_index names;
+    names.load(hash_file);
+    spdlog::debug("Checking reads {:L} on {} threads", names.size(), std::thread::hardware_concurrency());
+    spdlog::debug("memory_used {:L}", names.memory_used());
     spdlog::stopwatch sw;
-
-    bm::sparse_vector_scanner<str_sv_type> str_scan;
-    spot_name_check name_check(vec.size());
-
-    size_t index = 0, hits = 0, sz = 0, last_hits = 0;
-    const char* value;
-    bool hit;
-    auto it = vec.begin();
-    vector<string> search_terms;
-    search_terms.reserve(10000);
-    auto err_checker = [](fastq_error& e) -> void { throw e;};
-
-    while (it.valid()) {
-        value = it.value();
-        sz = strlen(value);
-        {
-            bm::chrono_taker<> tt1(std::cout, "check hits", 1, &timing_map);
-            hit = name_check.seen_before(value, sz);
-        }
-        if (hit) {
-            ++hits;
-            search_terms.push_back(value);
-            if (search_terms.size() == 10000) {
-                bm::chrono_taker<> tt1(std::cout, "scan", search_terms.size(), &timing_map);
-                s_find_duplicates(vec, str_scan, search_terms, err_checker);
-                search_terms.clear();
-             }
-        }
-        it.advance();
-        if (++index % 100000000 == 0) {
-            spdlog::debug("index:{:L}, elapsed:{:.2f}, hits:{}, total_hits:{}, memory_used:{:L}", index, sw, hits - last_hits, hits, name_check.memory_used());
-            last_hits = hits;
-            bm::chrono_taker<>::print_duration_map(std::cout, timing_map, bm::chrono_taker<>::ct_all);
-            timing_map.clear();
-        }
-    }
-    if (!search_terms.empty()) {
-        bm::chrono_taker<> tt1(std::cout, "scan", search_terms.size(), &timing_map);
-        s_find_duplicates(vec, str_scan, search_terms, err_checker);
-    }
-
-    {
-        spdlog::debug("index:{:L}, elapsed:{:.2f}, hits:{}, total_hits:{}, memory_used:{:L}", index, sw, hits - last_hits, hits, name_check.memory_used());
-        bm::chrono_taker<>::print_duration_map(std::cout, timing_map, bm::chrono_taker<>::ct_all);
-    }
-
-    //string collisions_file = hash_file + ".dups";
-    //bm::SaveBVector(collisions_file.c_str(), bv_collisions);
+    names.for_each_duplicate([](const string& name, size_t count) {
+        throw fastq_error(170, "Collation check. Duplicate spot '{}', {} occurrences", name, count);
+    });
+    spdlog::debug("elapsed:{:.2f}", sw);
 }
 
 /**
@@ -2156,13 +2251,16 @@ void fastq_parser<TWriter>::set_readers(json& group, bool update_telemetry)
         return;
     uint8_t files_with_read_numbers = 0;
     vector<char> read_types;
+    unsigned inflate_threads = 0;
+    if (m_inflate_threads > 0)
+        inflate_threads = max<unsigned>(1, m_inflate_threads / group["files"].size());
     for (auto& data : group["files"]) {
         const string& name = data["file_path"];
         if (data.contains("readType"))
             read_types = data["readType"];
         else
             read_types.clear();
-        m_readers.emplace_back(name, s_OpenStream(name, (1024 * 1024) * 8), read_types, data["platform_code"].front());
+        m_readers.emplace_back(name, s_OpenStream(name, (1024 * 1024) * 8, inflate_threads), read_types, data["platform_code"].front());
         if (!data["readNums"].empty())
             ++files_with_read_numbers;
     }
@@ -2224,6 +2322,16 @@ void fastq_parser<TWriter>::report_telemetry(json& j)
 
         if (j.contains("is_spot_assembly")) {
             im["far_reads"] = m_telemetry.assembly_metrics.number_of_far_reads;
+            const auto& spill = m_spot_assembly.m_spill.metrics();
+            if (spill.partitions > 0) {
+                auto& sm = j["spill"];
+                sm["bytes"] = spill.bytes;
+                sm["reads"] = spill.reads;
+                sm["spots"] = spill.spots;
+                sm["partitions"] = spill.partitions;
+                sm["max_partition_bytes"] = spill.max_partition_bytes;
+                sm["max_pending_reads"] = spill.max_pending_reads;
+            }
         }
 
         auto& om = j["o"];
@@ -2259,6 +2367,30 @@ void fastq_parser<TWriter>::report_telemetry(json& j)
     }
 }
 
+template<typename TWriter>
+void fastq_parser<TWriter>::report_queue_telemetry(json& j)
+{
+    auto round2 = [](double v) { return ceil(v * 100.0) / 100.0; };
+    try {
+        for (const auto& it : m_queue_stats) {
+            const auto& stats = it.second;
+            auto& q = j["queues"][it.first];
+            q["capacity"] = stats.capacity;
+            q["producers"] = stats.producers;
+            q["consumers"] = stats.consumers;
+            q["enqueued"] = stats.enqueued;
+            q["dequeued"] = stats.dequeued;
+            q["max_occupancy"] = stats.max_occupancy;
+            q["avg_occupancy"] = round2(stats.avg_occupancy());
+            q["producer_idle_sec"] = round2(stats.producer_idle);
+            q["consumer_idle_sec"] = round2(stats.consumer_idle);
+            q["wall_sec"] = round2(stats.wall);
+        }
+    } catch (exception& e) {
+        spdlog::error("Error reporting queue telemetry: {}", e.what());
+    }
+}
+
 template<typename TWriter>
 void set_experiment_file(const string& experiment_file);
 
@@ -2339,6 +2471,7 @@ void fastq_parser<TWriter>::for_each_read(ErrorChecker&& error_checker, T&& func
         } while (pipeline_cancelled == false);
         for (int i = 0; i < num_readers; ++i) {
             m_readers[i].end_reading();
+            m_queue_stats["read_queue"] += m_readers[i].read_queue_stats();
         }
     #else
         } while (true);
@@ -2452,6 +2585,7 @@ void fastq_parser<TWriter>::for_each_spot(ErrorChecker&& error_checker, T&& func
 #ifdef _PARALLEL_READ1_
         for (int i = 0; i < num_readers; ++i) {
             m_readers[i].end_reading();
+            m_queue_stats["read_queue"] += m_readers[i].read_queue_stats();
         }
 #endif
     } catch (exception& e) {
@@ -2552,7 +2686,9 @@ void fastq_parser<TWriter>::save_spot_thread()
     while (save_spot_queue->dequeue(spot_read)) {
         auto& read = spot_read.read;
         assert(read.m_SpotId != 0);
-        if (spot_read.is_last) {
+        if (m_spot_assembly.is_spilled(read.m_SpotId)) {
+            m_spot_assembly.m_spill.save_read(read, spot_read.is_last);
+        } else if (spot_read.is_last) {
             spot_name = read.Spot();
             spot_id = read.m_SpotId;
             m_spot_assembly. template get_spot_mt<ScoreValidator, is_nanopore>(spot_name, read.m_SpotId, spot);
@@ -2567,6 +2703,23 @@ void fastq_parser<TWriter>::save_spot_thread()
             m_spot_assembly. template save_read_mt<ScoreValidator, is_nanopore>(read.m_SpotId, read);
         }
     }
+    if (m_spot_assembly.m_spill.is_open()) {
+        // far spots come out partition by partition, after all other spots
+        spdlog::stopwatch sw;
+        m_spot_assembly.m_spill.assemble([&](vector<fastq_read>& spilled_spot) {
+            spot_name = spilled_spot.back().Spot();
+            spot_id = spilled_spot.back().m_SpotId;
+            spot = std::move(spilled_spot);
+            prepare_assemble_spot(spot_name, spot, read_ids);
+
+            assert(!spot.empty());
+            spot.front().SetSpot(std::move(spot_name));
+            spot.front().m_SpotId = spot_id;
+            assemble_spot_queue->enqueue(std::move(spot));
+        });
+        const auto& metrics = m_spot_assembly.m_spill.metrics();
+        m_logger->info("spill assembly took: {}, spill bytes: {:L}, max pending reads: {:L}", sw, metrics.bytes, metrics.max_pending_reads);
+    }
     assemble_spot_queue->close();
 }
 
@@ -2726,9 +2879,11 @@ void fastq_parser<TWriter>::assemble_spot_thread()
         }
     }
     m_logger->info("spots: {:L}, reads: {:L}", spotCount, readCount);
-    assert(assemble_spot_queue->enqueue_count == assemble_spot_queue->dequeue_count);
-    if (assemble_spot_queue->enqueue_count != assemble_spot_queue->dequeue_count)
-        throw fastq_error("assemble_spot_queue->enqueue_count != assemble_spot_queue->dequeue_count {} != {}", assemble_spot_queue->enqueue_count, assemble_spot_queue->dequeue_count);
+    size_t enqueue_count = assemble_spot_queue->enqueue_count;
+    size_t dequeue_count = assemble_spot_queue->dequeue_count;
+    assert(enqueue_count == dequeue_count);
+    if (enqueue_count != dequeue_count)
+        throw fastq_error("assemble_spot_queue->enqueue_count != assemble_spot_queue->dequeue_count {} != {}", enqueue_count, dequeue_count);
     clear_spot_queue->close();
     update_telemetry_queue->close();
 }
@@ -2739,21 +2894,25 @@ void fastq_parser<TWriter>::clear_spot_thread()
 {
     // get spot_id from clear_spot_queue
     // and clear it from memory
-    size_t spot_id;
-    while (clear_spot_queue->dequeue(spot_id)) {
-        assert(spot_id != 0);
-        m_spot_assembly. template clear_spot_mt<is_nanopore>(spot_id);
+    // clear_spot_mt is not reentrant: a single worker, taking the ids in batches
+    vector<size_t> spot_ids;
+    while (clear_spot_queue->dequeue_bulk(spot_ids, STAGE_BATCH_SIZE)) {
+        for (auto spot_id : spot_ids) {
+            assert(spot_id != 0);
+            m_spot_assembly. template clear_spot_mt<is_nanopore>(spot_id);
+        }
     }
 }
 
 template<typename TWriter>
-void fastq_parser<TWriter>::update_telemetry_thread()
+void fastq_parser<TWriter>::update_telemetry_thread(size_t worker)
 {
-    spot_t spot;
-    while (update_telemetry_queue->dequeue(spot)) {
-        update_telemetry(spot);
+    auto& telemetry = m_worker_telemetry[worker];
+    vector<spot_t> spots;
+    while (update_telemetry_queue->dequeue_bulk(spots, STAGE_BATCH_SIZE)) {
+        for (const auto& spot : spots)
+            update_telemetry(spot, telemetry);
     }
-
 }
 
 template<typename TWriter>
@@ -2798,14 +2957,14 @@ void fastq_parser<TWriter>::second_pass(ErrorChecker&& error_checker, const vect
     save_spot_queue.reset(new queue_t<spot_read_t, SAVE_SPOT_QUEUE_SIZE>("save_spot_queue", pipeline_cancelled));
     assemble_spot_queue.reset(new queue_t<vector<fastq_read>, ASSEMBLE_QUEUE_SIZE>("assemble_spot_queue", pipeline_cancelled));
     clear_spot_queue.reset(new queue_t<size_t, CLEAR_SPOT_QUEUE_SIZE>("clear_spot_queue", pipeline_cancelled));
-    update_telemetry_queue.reset(new queue_t<spot_t, ASSEMBLE_QUEUE_SIZE>("update_telemetry_queue", pipeline_cancelled));
+    update_telemetry_queue.reset(new queue_t<spot_t, ASSEMBLE_QUEUE_SIZE>("update_telemetry_queue", pipeline_cancelled, 1, m_stage_workers));
 
-    array<future<exception_ptr>, 4> futures;
+    vector<future<exception_ptr>> futures;
 
-    futures[3] = std::async(std::launch::async, [this](){ BEGIN_MT_EXCEPTION this->template save_spot_thread<ScoreValidator, is_nanopore>(); END_MT_EXCEPTION });
-    futures[2] = std::async(std::launch::async, [this](){ BEGIN_MT_EXCEPTION this->template assemble_spot_thread<ScoreValidator, is_nanopore>();END_MT_EXCEPTION });
-    futures[1] = std::async(std::launch::async, [this](){ BEGIN_MT_EXCEPTION this->template clear_spot_thread<ScoreValidator, is_nanopore>();END_MT_EXCEPTION });
-    futures[0] = std::async(std::launch::async, [this](){ BEGIN_MT_EXCEPTION this->update_telemetry_thread(); END_MT_EXCEPTION });
+    futures.push_back(std::async(std::launch::async, [this](){ BEGIN_MT_EXCEPTION this->template save_spot_thread<ScoreValidator, is_nanopore>(); END_MT_EXCEPTION }));
+    futures.push_back(std::async(std::launch::async, [this](){ BEGIN_MT_EXCEPTION this->template assemble_spot_thread<ScoreValidator, is_nanopore>();END_MT_EXCEPTION }));
+    futures.push_back(std::async(std::launch::async, [this](){ BEGIN_MT_EXCEPTION this->template clear_spot_thread<ScoreValidator, is_nanopore>();END_MT_EXCEPTION }));
+    start_telemetry_workers(futures);
 
     spot_read_t spot_read;
     for_each_read<ScoreValidator, ErrorChecker>(error_checker, [&](size_t row_id, CFastqRead& read) {
@@ -2831,6 +2990,11 @@ void fastq_parser<TWriter>::second_pass(ErrorChecker&& error_checker, const vect
         if (eptr)
             std::rethrow_exception(eptr);
     }
+    merge_telemetry();
+    collect_queue_stats(*save_spot_queue);
+    collect_queue_stats(*assemble_spot_queue);
+    collect_queue_stats(*clear_spot_queue);
+    collect_queue_stats(*update_telemetry_queue);
 
     // Second pass stats should match the first pass
     assert(m_spot_assembly.m_total_spots == spotCount && read_index.size() == readCount);
@@ -225,6 +225,7 @@ private:
  * 
  * @param filename File path or URI to open
  * @param buffer_size Read buffer size (default 4KB, recommend 1MB for cloud)
+ * @param inflate_threads Decompression threads for gzip/BGZF/zstd input (0: decompressed by bxzstr)
  * @return shared_ptr<istream> Input stream ready for reading
  * @throws runtime_error on failure to open file
  * @throws sharq::fs::CloudStorageError on cloud-specific errors
@@ -238,7 +239,8 @@ private:
  */
 inline std::shared_ptr<std::istream> open_fastq_stream(
     const std::string& filename,
-    size_t buffer_size = 4096)
+    size_t buffer_size = 4096,
+    unsigned inflate_threads = 0)
 {
     custom_istream::custom_istream * c_istream = nullptr;
     // Handle stdin
@@ -257,7 +259,7 @@ inline std::shared_ptr<std::istream> open_fastq_stream(
         }
 
         c_istream = new custom_istream::custom_istream( custom_istream::custom_istream::make_from_kstream( kin, buffer_size ) );
-        return std::shared_ptr<std::istream>( new istreambuf_holder( c_istream, observer ));
+        return std::shared_ptr<std::istream>( new istreambuf_holder( make_parallel_inflate( c_istream, inflate_threads ), observer ));
     }
     
     // Detect storage backend
@@ -280,7 +282,7 @@ inline std::shared_ptr<std::istream> open_fastq_stream(
         }
 
         c_istream = new custom_istream::custom_istream( custom_istream::custom_istream::make_from_kfile( kfile, buffer_size ) );
-        return std::shared_ptr<std::istream>( new istreambuf_holder( c_istream, observer ));
+        return std::shared_ptr<std::istream>( new istreambuf_holder( make_parallel_inflate( c_istream, inflate_threads ), observer ));
     }
     
     if (backend == fs::StorageBackend::HTTP) {
@@ -298,7 +300,7 @@ inline std::shared_ptr<std::istream> open_fastq_stream(
         }
 
         c_istream = new custom_istream::custom_istream( custom_istream::custom_istream::make_from_kstream( kstream, buffer_size ));
-        return std::shared_ptr<std::istream>( new istreambuf_holder( c_istream, observer ));
+        return std::shared_ptr<std::istream>( new istreambuf_holder( make_parallel_inflate( c_istream, inflate_threads ), observer ));
     }
     
     // For S3/GCS, use cloud filesystem
@@ -322,7 +324,7 @@ inline std::shared_ptr<std::istream> open_fastq_stream(
             
             // Wrap with CloudIStreamHolder for metadata preservation
             return std::shared_ptr<std::istream>(
-                new CloudIStreamHolder(c_istream, cloud_stream)
+                new CloudIStreamHolder(make_parallel_inflate(c_istream, inflate_threads), cloud_stream)
             );
             
         } catch (const fs::FileNotFoundError& e) {
@@ -289,6 +289,26 @@ public:
 };
 
 
+/**
+ * @brief Saves the fingerprint of the reads in the table's metadata
+ *
+ * @param[in] writer VDB writer
+ * @param[in] table_id table to store the fingerprint in
+ * @param[in] fingerprint read fingerprint
+ */
+inline void write_read_fingerprint(const Writer2& writer, Writer2::TableID table_id, const Fingerprint& fingerprint)
+{
+    writer.setMetadata( VDB::Writer::MetaNodeRoot::table, table_id, "QC/current/fingerprint", fingerprint.JSON() );
+    writer.setMetadata( VDB::Writer::MetaNodeRoot::table, table_id, "QC/current/digest", fingerprint.digest() );
+    writer.setMetadata( VDB::Writer::MetaNodeRoot::table, table_id, "QC/current/algorithm", fingerprint.algorithm() );
+    writer.setMetadata( VDB::Writer::MetaNodeRoot::table, table_id, "QC/current/version", fingerprint.version() );
+    writer.setMetadata( VDB::Writer::MetaNodeRoot::table, table_id, "QC/current/format", fingerprint.format() );
+
+    time_t t = time(NULL);
+    writer.setMetadata( VDB::Writer::MetaNodeRoot::table, table_id, "QC/current/timestamp", string( (const char*)&t, sizeof(t) ) );
+}
+
+
 /**
  * @brief VDB Writer implementation
  *
@@ -519,17 +539,8 @@ void fastq_writer_vdb::close()
             m_writer->setMetadataAttr( VDB::Writer::MetaNodeRoot::database, 0, key.str(), "format", Fingerprint::format() );
         }
 
-        {   // output fingerprint
-            Writer2::TableID SequenceTabId = m_writer->table("SEQUENCE").id();
-            m_writer->setMetadata( VDB::Writer::MetaNodeRoot::table, SequenceTabId, "QC/current/fingerprint", m_read_fingerprint.JSON() );
-            m_writer->setMetadata( VDB::Writer::MetaNodeRoot::table, SequenceTabId, "QC/current/digest", m_read_fingerprint.digest() );
-            m_writer->setMetadata( VDB::Writer::MetaNodeRoot::table, SequenceTabId, "QC/current/algorithm", m_read_fingerprint.algorithm() );
-            m_writer->setMetadata( VDB::Writer::MetaNodeRoot::table, SequenceTabId, "QC/current/version", m_read_fingerprint.version() );
-            m_writer->setMetadata( VDB::Writer::MetaNodeRoot::table, SequenceTabId, "QC/current/format", m_read_fingerprint.format() );
-
-            time_t t = time(NULL);
-            m_writer->setMetadata( VDB::Writer::MetaNodeRoot::table, SequenceTabId, "QC/current/timestamp", string( (const char*)&t, sizeof(t) ) );
-        }
+        // output fingerprint
+        write_read_fingerprint(*m_writer, m_writer->table("SEQUENCE").id(), m_read_fingerprint);
 
         write_messages();
         m_writer->endWriting();
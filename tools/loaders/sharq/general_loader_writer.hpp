@@ -0,0 +1,364 @@
+#ifndef __GENERAL_LOADER_WRITER_HPP__
+#define __GENERAL_LOADER_WRITER_HPP__
+
+/**
+ * @file general_loader_writer.hpp
+ * @brief In-process VDB writer
+ *
+ * A Writer2 that hands the events straight to general-loader's
+ * DatabaseLoader instead of serializing them for a general-loader process.
+ *
+ * Cell values and row ends are collected into batches of rows;
+ * the batches are written to the VDB cursors by a separate thread,
+ * so the VDB encoding overlaps with parsing. All other events
+ * (schema, tables, columns, metadata) wait for the pending rows
+ * and are applied on the caller's thread.
+ *
+ * On an error message from the producer, or if the writer is destroyed
+ * before endWriting(), the partially written database is removed,
+ * as general-loader does on a failed stream.
+ */
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdexcept>
+#include <cstring>
+#include <iostream>
+
+using namespace std;    // writer.hpp expects it
+
+#include "sra-tools/writer.hpp"
+#include "../general-loader/general-loader.hpp"
+
+#include <klib/printf.h>
+#include <kfs/directory.h>
+
+namespace sharq {
+
+class general_loader_writer : public Writer2
+{
+public:
+    static constexpr size_t BATCH_ROWS = 4096;              ///< rows per batch
+    static constexpr size_t BATCH_BYTES = 8 * 1024 * 1024;  ///< cell bytes per batch
+    static constexpr size_t MAX_BATCHES = 2;                ///< batches queued for the cursor thread
+
+    /**
+     * @brief Creates the writer
+     *
+     * @param[in] program_name name recorded in the database's loader metadata
+     * @param[in] include_paths schema include paths
+     * @param[in] schemas additional schema files
+     * @param[in] target overrides the destination set by the producer, if not empty
+     */
+    general_loader_writer(const string& program_name,
+                          const vector<string>& include_paths = vector<string>(),
+                          const vector<string>& schemas = vector<string>(),
+                          const string& target = string())
+        : Writer2(s_null_stream(), false)
+        , m_loader(new GeneralLoader::DatabaseLoader(program_name, include_paths, schemas, target))
+    {}
+
+    ~general_loader_writer()
+    {
+        x_stop();
+        if (m_is_open)
+            x_discard();
+    }
+
+    bool destination(string const& remoteDb) const override
+    {
+        return x_check(m_loader->RemotePath(remoteDb), "RemotePath");
+    }
+
+    bool schema(string const& file, string const& dbSpec) const override
+    {
+        return x_check(m_loader->UseSchema(file, dbSpec), "UseSchema");
+    }
+
+    bool info(string const& name, string const& version) const override
+    {
+        return x_check(m_loader->SoftwareName(name, version), "SoftwareName");
+    }
+
+    bool openTable(unsigned const tid, string const& name) const override
+    {
+        return x_check(m_loader->NewTable(tid, name), "NewTable");
+    }
+
+    bool openColumn(unsigned const cid, unsigned const tid, unsigned const elemBits, string const& colSpec) const override
+    {
+        return x_check(m_loader->NewColumn(cid, tid, elemBits, 0, colSpec), "NewColumn");
+    }
+
+    bool beginWriting() const override
+    {
+        x_check(m_loader->OpenStream(), "OpenStream");
+        m_is_open = true;
+        m_thread = thread([this]() { x_cursor_thread(); });
+        return true;
+    }
+
+    bool value(unsigned const cid, uint32_t const count, uint32_t const elsize, void const* data) const override
+    {
+        if ((int)cid == -1)
+            return true;
+        auto& b = *m_batch;
+        b.ops.push_back({ cid, count, b.data.size(), false });
+        const char* p = static_cast<const char*>(data);
+        b.data.insert(b.data.end(), p, p + size_t(count) * elsize);
+        return true;
+    }
+
+    bool defaultValue(unsigned const cid, uint32_t const count, uint32_t const elsize, void const* data) const override
+    {
+        if ((int)cid == -1)
+            return true;
+        x_drain();
+        return x_check(m_loader->CellDefault(cid, data, count), "CellDefault");
+    }
+
+    bool closeRow(unsigned const tid) const override
+    {
+        auto& b = *m_batch;
+        b.ops.push_back({ tid, 0, 0, true });
+        if (++b.rows >= BATCH_ROWS || b.data.size() >= BATCH_BYTES)
+            x_submit();
+        return true;
+    }
+
+    bool setMetadata(VDB::Writer::MetaNodeRoot const root, unsigned const oid, string const& path, string const& value) const override
+    {
+        x_drain();
+        switch (root) {
+        case VDB::Writer::database:
+            return x_check(m_loader->DBMetadataNode(oid, path, value), "DBMetadataNode");
+        case VDB::Writer::table:
+            return x_check(m_loader->TblMetadataNode(oid, path, value), "TblMetadataNode");
+        default:
+            return x_check(m_loader->ColMetadataNode(oid, path, value), "ColMetadataNode");
+        }
+    }
+
+    bool setMetadataAttr(VDB::Writer::MetaNodeRoot const root, unsigned const oid, string const& path, string const& attr, string const& value) const override
+    {
+        x_drain();
+        switch (root) {
+        case VDB::Writer::database:
+            return x_check(m_loader->DBMetadataNodeAttr(oid, path, attr, value), "DBMetadataNodeAttr");
+        case VDB::Writer::table:
+            return x_check(m_loader->TblMetadataNodeAttr(oid, path, attr, value), "TblMetadataNodeAttr");
+        default:
+            return x_check(m_loader->ColMetadataNodeAttr(oid, path, attr, value), "ColMetadataNodeAttr");
+        }
+    }
+
+    // log messages are on stderr already (see general_writer_logger_mt)
+    bool logMessage(string const&) const override { return true; }
+    bool progressMessage(string const&) const override { return true; }
+
+    // general-loader fails the load on an error message
+    bool errorMessage(string const&) const override
+    {
+        m_failed = true;
+        return true;
+    }
+
+    bool endWriting() const override
+    {
+        x_drain();
+        x_stop();
+        if (!m_is_open)
+            return true;
+        if (m_failed) {
+            x_discard();
+            return false;
+        }
+        rc_t rc = m_loader->CloseStream();
+        if (rc != 0) {
+            x_discard();
+            x_check(rc, "CloseStream");
+        }
+        m_is_open = false;
+        return true;
+    }
+
+    void flush() const override
+    {
+        x_drain();
+    }
+
+    /// Returns the number of rows written to the cursors so far
+    size_t rows_written() const
+    {
+        lock_guard<mutex> lock(m_mutex);
+        return m_rows_written;
+    }
+
+private:
+    /// Cell values and row ends in the order of the events
+    struct batch_t {
+        struct op_t {
+            uint32_t id;        ///< column id, or table id for a row end
+            uint32_t count;     ///< number of elements
+            size_t   offset;    ///< offset of the elements in data
+            bool     next_row;  ///< row end
+        };
+        vector<op_t> ops;
+        vector<char> data;
+        size_t rows = 0;
+        void clear() { ops.clear(); data.clear(); rows = 0; }
+    };
+    using batch_ptr = unique_ptr<batch_t>;
+
+    static ostream& s_null_stream()
+    {
+        static ostream null_stream(nullptr);
+        return null_stream;
+    }
+
+    static string s_rc_message(rc_t rc, const char* what)
+    {
+        char buffer[1024] = "";
+        size_t num_writ = 0;
+        string_printf(buffer, sizeof buffer, &num_writ, "%R", rc);
+        return string("general-loader: ") + what + " failed: " + buffer;
+    }
+
+    bool x_check(rc_t rc, const char* what) const
+    {
+        if (rc != 0)
+            throw runtime_error(s_rc_message(rc, what));
+        return true;
+    }
+
+    /// Hands the current batch to the cursor thread, waits if too many batches are pending
+    void x_submit() const
+    {
+        if (m_batch->ops.empty())
+            return;
+        if (!m_thread.joinable())
+            throw logic_error("general-loader: rows written before beginWriting()");
+        unique_lock<mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_queue.size() < MAX_BATCHES || m_rc != 0; });
+        if (m_rc != 0)
+            throw runtime_error(s_rc_message(m_rc, m_rc_what));
+        m_queue.push_back(std::move(m_batch));
+        if (!m_free.empty()) {
+            m_batch = std::move(m_free.back());
+            m_free.pop_back();
+        } else {
+            m_batch.reset(new batch_t);
+        }
+        m_cv.notify_all();
+    }
+
+    /// Waits until all rows are written
+    void x_drain() const
+    {
+        if (!m_thread.joinable())
+            return;
+        x_submit();
+        unique_lock<mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return (m_queue.empty() && !m_busy) || m_rc != 0; });
+        if (m_rc != 0)
+            throw runtime_error(s_rc_message(m_rc, m_rc_what));
+    }
+
+    void x_stop() const
+    {
+        if (!m_thread.joinable())
+            return;
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_done = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    /// Releases the database and removes what has been written
+    void x_discard() const
+    {
+        string name = m_loader->GetDatabaseName();
+        m_loader.reset();
+        m_is_open = false;
+        if (!name.empty()) {
+            KDirectory* wd = nullptr;
+            if (KDirectoryNativeDir(&wd) == 0) {
+                KDirectoryRemove(wd, true, "%s", name.c_str());
+                KDirectoryRelease(wd);
+            }
+        }
+    }
+
+    void x_cursor_thread() const
+    {
+        while (true) {
+            batch_ptr batch;
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return !m_queue.empty() || m_done; });
+                if (m_queue.empty())
+                    return;
+                batch = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_busy = true;
+            }
+            rc_t rc = 0;
+            const char* what = "";
+            for (const auto& op : batch->ops) {
+                if (op.next_row) {
+                    rc = m_loader->NextRow(op.id);
+                    what = "NextRow";
+                } else {
+                    rc = m_loader->CellData(op.id, batch->data.data() + op.offset, op.count);
+                    what = "CellData";
+                }
+                if (rc != 0)
+                    break;
+            }
+            size_t rows = batch->rows;
+            batch->clear();
+            {
+                lock_guard<mutex> lock(m_mutex);
+                m_busy = false;
+                m_free.push_back(std::move(batch));
+                if (rc != 0) {
+                    m_rc = rc;
+                    m_rc_what = what;
+                } else {
+                    m_rows_written += rows;
+                }
+            }
+            m_cv.notify_all();
+            if (rc != 0)
+                return;
+        }
+    }
+
+    // Writer's interface is const, the state changes behind it
+    mutable unique_ptr<GeneralLoader::DatabaseLoader> m_loader;
+    mutable batch_ptr m_batch{new batch_t};     ///< batch being filled
+    mutable deque<batch_ptr> m_queue;           ///< batches for the cursor thread
+    mutable vector<batch_ptr> m_free;           ///< written batches for reuse
+    mutable thread m_thread;                    ///< cursor thread
+    mutable mutex m_mutex;
+    mutable condition_variable m_cv;
+    mutable bool m_busy = false;                ///< the cursor thread writes a batch
+    mutable bool m_done = false;                ///< no more batches
+    mutable rc_t m_rc = 0;                      ///< first error of the cursor thread
+    mutable const char* m_rc_what = "";
+    mutable size_t m_rows_written = 0;
+    mutable bool m_is_open = false;             ///< the database is created and not closed yet
+    mutable atomic<bool> m_failed{false};       ///< an error message was received, from any thread
+};
+
+}  // sharq namespace
+
+#endif
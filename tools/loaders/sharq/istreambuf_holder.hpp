@@ -38,6 +38,7 @@
 #include <stdexcept>
 
 #include "bxzstr/bxzstr.hpp"
+#include "parallel_inflate.hpp"
 #include <kfile_stream/kfile_stream.hpp>
 
 namespace sharq {
@@ -91,6 +92,13 @@ public:
         }
     }
 
+    // true if the input is decompressed by parallel_inflate_streambuf before it reaches bxz
+    bool is_inflated() const
+    {
+        auto sb = dynamic_cast<const parallel_inflate_streambuf *>( held_streambuf );
+        return sb != nullptr && sb->format() != parallel_inflate_streambuf::input_format::plain;
+    }
+
 private:
     std::streambuf * held_streambuf;
 
@@ -0,0 +1,616 @@
+#ifndef __PARALLEL_INFLATE_HPP__
+#define __PARALLEL_INFLATE_HPP__
+
+/**
+ * @file parallel_inflate.hpp
+ * @brief Multi-threaded decompression front end
+ *
+ * A streambuf that sits between the raw input and bxz::istream.
+ * The compression is detected from the first bytes of the input:
+ *
+ * - BGZF (gzip members carrying the 'BC' extra field) and zstd frames
+ *   are cut into jobs without decompressing (the block and frame headers
+ *   tell the compressed size), the jobs are inflated by a pool of worker
+ *   threads and handed out in input order.
+ * - Any other gzip input (single member or concatenated members) is
+ *   inflated on a separate thread, overlapping with the parsing.
+ * - Everything else (plain text, bzip2) is passed through unchanged
+ *   and left to bxz.
+ *
+ * zstd input is only recognized if sharq is built with HAVE_ZSTD.
+ */
+
+#include <streambuf>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+namespace sharq {
+
+/**
+ * @brief Decompressing streambuf, see the file description
+ *
+ * Takes ownership of the source streambuf.
+ */
+class parallel_inflate_streambuf : public std::streambuf
+{
+public:
+    enum class input_format { plain, gzip, bgzf, zstd };
+
+    static constexpr size_t JOB_SIZE = 1024 * 1024;               ///< compressed bytes per job
+    static constexpr size_t OUTPUT_CHUNK = 4 * 1024 * 1024;       ///< output block of the single-threaded inflate
+    static constexpr size_t MAX_ZSTD_FRAME = 64 * 1024 * 1024;    ///< larger zstd frames are inflated as a stream
+
+    /**
+     * @brief Detects the input format and starts the threads
+     *
+     * @param[in] src raw input, owned by this object
+     * @param[in] threads number of worker threads for BGZF/zstd
+     */
+    parallel_inflate_streambuf(std::streambuf* src, unsigned threads)
+        : m_src(src)
+        , m_threads(threads > 0 ? threads : 1)
+        , m_max_in_flight(2 * m_threads + 2)
+    {
+        fill_raw(18);
+        m_format = detect_format();
+        if (m_format == input_format::plain)
+            return;
+        if (is_parallel()) {
+            for (unsigned i = 0; i < m_threads; ++i)
+                m_workers.emplace_back(&parallel_inflate_streambuf::worker, this);
+        }
+        m_splitter = thread(&parallel_inflate_streambuf::splitter, this);
+    }
+
+    ~parallel_inflate_streambuf() override
+    {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        if (m_splitter.joinable())
+            m_splitter.join();
+        for (auto& t : m_workers)
+            t.join();
+    }
+
+    input_format format() const { return m_format; } ///< Returns the detected input format
+    bool is_parallel() const { return m_format == input_format::bgzf || m_format == input_format::zstd; } ///< Returns true if the blocks are inflated concurrently
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+        if (m_format == input_format::plain) {
+            if (m_raw_pos == m_raw_end) {
+                m_raw_pos = m_raw_end = 0;
+                if (m_raw.size() < JOB_SIZE)
+                    m_raw.resize(JOB_SIZE);
+                m_raw_end = read_src(m_raw.data(), m_raw.size());
+            }
+            if (m_raw_pos == m_raw_end)
+                return traits_type::eof();
+            setg(m_raw.data() + m_raw_pos, m_raw.data() + m_raw_pos, m_raw.data() + m_raw_end);
+            m_raw_pos = m_raw_end;
+            return traits_type::to_int_type(*gptr());
+        }
+
+        while (true) {
+            job_ptr job;
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_current.reset();
+                m_cv.wait(lock, [this] { return (!m_ordered.empty() && m_ordered.front()->done) || (m_ordered.empty() && m_input_done); });
+                if (m_ordered.empty()) {
+                    if (m_error)
+                        rethrow_exception(m_error);
+                    return traits_type::eof();
+                }
+                job = m_ordered.front();
+                m_ordered.pop_front();
+            }
+            m_cv.notify_all();
+            if (job->error)
+                rethrow_exception(job->error);
+            if (job->out.empty())
+                continue;
+            m_current = job;
+            setg(job->out.data(), job->out.data(), job->out.data() + job->out.size());
+            return traits_type::to_int_type(*gptr());
+        }
+    }
+
+    /**
+     * In the passthrough mode bxz reads straight into its own buffer
+     */
+    streamsize xsgetn(char* s, streamsize n) override
+    {
+        if (m_format != input_format::plain)
+            return std::streambuf::xsgetn(s, n);
+        streamsize copied = 0;
+        if (gptr() < egptr()) {
+            copied = min<streamsize>(n, egptr() - gptr());
+            memcpy(s, gptr(), copied);
+            gbump(int(copied));
+        }
+        if (copied < n && m_raw_pos < m_raw_end) {
+            size_t sz = min<size_t>(n - copied, m_raw_end - m_raw_pos);
+            memcpy(s + copied, m_raw.data() + m_raw_pos, sz);
+            m_raw_pos += sz;
+            copied += sz;
+        }
+        if (copied < n)
+            copied += read_src(s + copied, n - copied);
+        return copied;
+    }
+
+private:
+    /**
+     * @brief Unit of work: compressed blocks in, inflated bytes out
+     */
+    struct job_t
+    {
+        vector<char> in;                ///< compressed data
+        vector<uint32_t> units;         ///< end offsets of the BGZF blocks or zstd frames in 'in'
+        vector<char> out;               ///< inflated data
+        size_t out_size = 0;            ///< expected output size (BGZF), 0 if unknown
+        bool done = false;              ///< out is ready
+        exception_ptr error;
+    };
+    using job_ptr = shared_ptr<job_t>;
+
+    size_t read_src(char* dst, size_t sz)
+    {
+        streamsize got = m_src->sgetn(dst, sz);
+        return got > 0 ? size_t(got) : 0;
+    }
+
+    size_t raw_avail() const { return m_raw_end - m_raw_pos; }
+    const uint8_t* raw_ptr(size_t offset = 0) const { return reinterpret_cast<const uint8_t*>(m_raw.data() + m_raw_pos + offset); }
+
+    /**
+     * @brief Makes at least 'need' bytes available in the raw buffer
+     *
+     * @return false if the input ends before
+     */
+    bool fill_raw(size_t need)
+    {
+        if (raw_avail() >= need)
+            return true;
+        if (m_raw_pos > 0) {
+            memmove(m_raw.data(), m_raw.data() + m_raw_pos, raw_avail());
+            m_raw_end -= m_raw_pos;
+            m_raw_pos = 0;
+        }
+        if (m_raw.size() < max(need, JOB_SIZE))
+            m_raw.resize(max(need, JOB_SIZE));
+        while (m_raw_end < need) {
+            size_t got = read_src(m_raw.data() + m_raw_end, m_raw.size() - m_raw_end);
+            if (got == 0)
+                return false;
+            m_raw_end += got;
+        }
+        return true;
+    }
+
+    static uint16_t le16(const uint8_t* p) { return uint16_t(p[0] | (p[1] << 8)); }
+    static uint32_t le32(const uint8_t* p) { return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24); }
+
+    static constexpr uint32_t ZSTD_FRAME_MAGIC = 0xFD2FB528;
+    static bool is_skippable_frame(uint32_t magic) { return (magic & 0xFFFFFFF0) == 0x184D2A50; }
+
+    /**
+     * @brief Returns the size of the BGZF block at the start of the raw buffer, 0 if it is not one
+     */
+    size_t bgzf_block_size()
+    {
+        if (!fill_raw(18))
+            return 0;
+        const uint8_t* p = raw_ptr();
+        if (p[0] != 0x1f || p[1] != 0x8b || p[2] != 8 || (p[3] & 4) == 0)
+            return 0;
+        size_t xlen = le16(p + 10);
+        if (!fill_raw(12 + xlen))
+            return 0;
+        p = raw_ptr();
+        for (size_t i = 12; i + 4 <= 12 + xlen; ) {
+            size_t slen = le16(p + i + 2);
+            if (p[i] == 'B' && p[i + 1] == 'C' && slen == 2 && i + 6 <= 12 + xlen)
+                return size_t(le16(p + i + 4)) + 1;
+            i += 4 + slen;
+        }
+        return 0;
+    }
+
+    input_format detect_format()
+    {
+        if (raw_avail() >= 2 && raw_ptr()[0] == 0x1f && raw_ptr()[1] == 0x8b)
+            return bgzf_block_size() > 0 ? input_format::bgzf : input_format::gzip;
+#ifdef HAVE_ZSTD
+        if (raw_avail() >= 4 && (le32(raw_ptr()) == ZSTD_FRAME_MAGIC || is_skippable_frame(le32(raw_ptr()))))
+            return input_format::zstd;
+#endif
+        return input_format::plain;
+    }
+
+    /**
+     * @brief Queues the job for the consumer and, if it still has to be inflated, for the workers
+     *
+     * @return false if the reading has been stopped
+     */
+    bool submit(job_ptr job, bool needs_work)
+    {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_ordered.size() < m_max_in_flight || m_stop; });
+            if (m_stop)
+                return false;
+            m_ordered.push_back(job);
+            if (needs_work)
+                m_work.push_back(job);
+        }
+        m_cv.notify_all();
+        return true;
+    }
+
+    /**
+     * @brief Moves 'sz' bytes from the raw buffer into the job
+     */
+    void take_raw(job_t& job, size_t sz)
+    {
+        job.in.insert(job.in.end(), m_raw.data() + m_raw_pos, m_raw.data() + m_raw_pos + sz);
+        job.units.push_back(uint32_t(job.in.size()));
+        m_raw_pos += sz;
+    }
+
+    void splitter()
+    {
+        try {
+            switch (m_format) {
+            case input_format::bgzf:
+                split_bgzf();
+                break;
+#ifdef HAVE_ZSTD
+            case input_format::zstd:
+                split_zstd();
+                break;
+#endif
+            default:
+                inflate_gzip_stream();
+                break;
+            }
+        } catch (...) {
+            lock_guard<mutex> lock(m_mutex);
+            m_error = current_exception();
+        }
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_input_done = true;
+        }
+        m_cv.notify_all();
+    }
+
+    void split_bgzf()
+    {
+        auto job = make_shared<job_t>();
+        while (fill_raw(1)) {
+            size_t sz = bgzf_block_size();
+            if (sz == 0 || sz < 26 || !fill_raw(sz)) {
+                // not BGZF any more or truncated: finish the queued blocks, inflate the rest as a stream
+                if (!job->in.empty() && !submit(job, true))
+                    return;
+                inflate_gzip_stream();
+                return;
+            }
+            job->out_size += le32(raw_ptr(sz - 4));
+            take_raw(*job, sz);
+            if (job->in.size() >= JOB_SIZE) {
+                if (!submit(job, true))
+                    return;
+                job = make_shared<job_t>();
+            }
+        }
+        if (!job->in.empty())
+            submit(job, true);
+    }
+
+    /**
+     * @brief Inflates gzip members as a stream on the splitter thread
+     *
+     * Concatenated members are inflated one after another.
+     */
+    void inflate_gzip_stream()
+    {
+        z_stream strm;
+        memset(&strm, 0, sizeof(strm));
+        if (inflateInit2(&strm, 15 + 32) != Z_OK)
+            throw runtime_error("Failed to initialize zlib");
+        unique_ptr<z_stream, int(*)(z_stream*)> strm_guard(&strm, inflateEnd);
+
+        auto job = make_shared<job_t>();
+        job->out.resize(OUTPUT_CHUNK);
+        while (true) {
+            if (raw_avail() == 0 && !fill_raw(1))
+                break;
+            strm.next_in = (Bytef*)(m_raw.data() + m_raw_pos);
+            strm.avail_in = uInt(raw_avail());
+            strm.next_out = (Bytef*)(job->out.data() + job->out_size);
+            strm.avail_out = uInt(job->out.size() - job->out_size);
+            int ret = inflate(&strm, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+                throw runtime_error(string("Failed to decompress gzip input: ") + (strm.msg ? strm.msg : "zlib error " + to_string(ret)));
+            m_raw_pos = m_raw_end - strm.avail_in;
+            job->out_size = job->out.size() - strm.avail_out;
+            if (ret == Z_STREAM_END)
+                inflateReset(&strm);
+            if (job->out_size == job->out.size()) {
+                job->done = true;
+                if (!submit(job, false))
+                    return;
+                job = make_shared<job_t>();
+                job->out.resize(OUTPUT_CHUNK);
+            }
+        }
+        // a truncated member ends the input with what has been inflated, as bxz does
+        job->out.resize(job->out_size);
+        job->done = true;
+        submit(job, false);
+    }
+
+#ifdef HAVE_ZSTD
+    /**
+     * @brief Returns the size of the zstd frame at the start of the raw buffer
+     *
+     * Walks the frame and block headers; returns 0 if the frame is larger than MAX_ZSTD_FRAME
+     */
+    size_t zstd_frame_size()
+    {
+        if (!fill_raw(8))
+            throw runtime_error("Truncated zstd frame");
+        uint32_t magic = le32(raw_ptr());
+        if (is_skippable_frame(magic))
+            return 8 + size_t(le32(raw_ptr(4)));
+        if (magic != ZSTD_FRAME_MAGIC)
+            throw runtime_error("Invalid zstd frame");
+        const uint8_t fhd = raw_ptr()[4];
+        const unsigned fcs_flag = fhd >> 6;
+        const bool single_segment = (fhd & 0x20) != 0;
+        const bool checksum = (fhd & 0x04) != 0;
+        static const size_t dict_id_size[] = { 0, 1, 2, 4 };
+        static const size_t fcs_size[] = { 0, 2, 4, 8 };
+        size_t pos = 5 + (single_segment ? 0 : 1) + dict_id_size[fhd & 3] + (fcs_flag == 0 && single_segment ? 1 : fcs_size[fcs_flag]);
+        while (true) {
+            if (pos > MAX_ZSTD_FRAME)
+                return 0;
+            if (!fill_raw(pos + 3))
+                throw runtime_error("Truncated zstd frame");
+            const uint8_t* b = raw_ptr(pos);
+            uint32_t header = b[0] | (b[1] << 8) | (b[2] << 16);
+            unsigned type = (header >> 1) & 3;
+            if (type == 3)
+                throw runtime_error("Invalid zstd block");
+            pos += 3 + (type == 1 ? 1 : (header >> 3));
+            if (header & 1)
+                break;
+        }
+        return pos + (checksum ? 4 : 0);
+    }
+
+    void split_zstd()
+    {
+        auto job = make_shared<job_t>();
+        while (fill_raw(1)) {
+            size_t sz = zstd_frame_size();
+            if (sz == 0) {
+                if (!job->in.empty()) {
+                    if (!submit(job, true))
+                        return;
+                    job = make_shared<job_t>();
+                }
+                if (!inflate_zstd_frame())
+                    return;
+                continue;
+            }
+            if (!fill_raw(sz))
+                throw runtime_error("Truncated zstd frame");
+            take_raw(*job, sz);
+            if (job->in.size() >= JOB_SIZE) {
+                if (!submit(job, true))
+                    return;
+                job = make_shared<job_t>();
+            }
+        }
+        if (!job->in.empty())
+            submit(job, true);
+    }
+
+    /**
+     * @brief Inflates one (large) zstd frame as a stream on the splitter thread
+     *
+     * @return false if the reading has been stopped
+     */
+    bool inflate_zstd_frame()
+    {
+        unique_ptr<ZSTD_DCtx, size_t(*)(ZSTD_DCtx*)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+        if (!dctx)
+            throw runtime_error("Failed to initialize zstd");
+        auto job = make_shared<job_t>();
+        job->out.resize(OUTPUT_CHUNK);
+        while (true) {
+            if (raw_avail() == 0 && !fill_raw(1))
+                throw runtime_error("Truncated zstd frame");
+            ZSTD_inBuffer in = { m_raw.data() + m_raw_pos, raw_avail(), 0 };
+            ZSTD_outBuffer out = { job->out.data() + job->out_size, job->out.size() - job->out_size, 0 };
+            size_t ret = ZSTD_decompressStream(dctx.get(), &out, &in);
+            if (ZSTD_isError(ret))
+                throw runtime_error(string("Failed to decompress zstd input: ") + ZSTD_getErrorName(ret));
+            m_raw_pos += in.pos;
+            job->out_size += out.pos;
+            if (ret == 0 || job->out_size == job->out.size()) {
+                job->out.resize(job->out_size);
+                job->done = true;
+                if (!submit(job, false))
+                    return false;
+                if (ret == 0)
+                    return true;
+                job = make_shared<job_t>();
+                job->out.resize(OUTPUT_CHUNK);
+            }
+        }
+    }
+#endif
+
+    void worker()
+    {
+#ifdef HAVE_ZSTD
+        unique_ptr<ZSTD_DCtx, size_t(*)(ZSTD_DCtx*)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+#endif
+        while (true) {
+            job_ptr job;
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return !m_work.empty() || m_stop || m_input_done; });
+                if (m_work.empty())
+                    return;
+                job = m_work.front();
+                m_work.pop_front();
+            }
+            try {
+                if (m_format == input_format::bgzf)
+                    inflate_bgzf(*job);
+#ifdef HAVE_ZSTD
+                else
+                    inflate_zstd(*job, dctx.get());
+#endif
+            } catch (...) {
+                job->error = current_exception();
+            }
+            {
+                lock_guard<mutex> lock(m_mutex);
+                job->done = true;
+                job->in = vector<char>();
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    static void inflate_bgzf(job_t& job)
+    {
+        job.out.resize(job.out_size);
+        z_stream strm;
+        memset(&strm, 0, sizeof(strm));
+        if (inflateInit2(&strm, 15 + 16) != Z_OK)
+            throw runtime_error("Failed to initialize zlib");
+        unique_ptr<z_stream, int(*)(z_stream*)> strm_guard(&strm, inflateEnd);
+        size_t in_pos = 0, out_pos = 0;
+        for (auto unit_end : job.units) {
+            inflateReset(&strm);
+            strm.next_in = (Bytef*)(job.in.data() + in_pos);
+            strm.avail_in = uInt(unit_end - in_pos);
+            strm.next_out = (Bytef*)(job.out.data() + out_pos);
+            strm.avail_out = uInt(job.out.size() - out_pos);
+            int ret = inflate(&strm, Z_FINISH);
+            if (ret != Z_STREAM_END)
+                throw runtime_error(string("Failed to decompress BGZF block: ") + (strm.msg ? strm.msg : "zlib error " + to_string(ret)));
+            out_pos = job.out.size() - strm.avail_out;
+            in_pos = unit_end;
+        }
+        job.out.resize(out_pos);
+    }
+
+#ifdef HAVE_ZSTD
+    static void inflate_zstd(job_t& job, ZSTD_DCtx* dctx)
+    {
+        size_t in_pos = 0;
+        for (auto unit_end : job.units) {
+            const char* frame = job.in.data() + in_pos;
+            const size_t frame_size = unit_end - in_pos;
+            in_pos = unit_end;
+            if (is_skippable_frame(le32(reinterpret_cast<const uint8_t*>(frame))))
+                continue;
+            unsigned long long content_size = ZSTD_getFrameContentSize(frame, frame_size);
+            if (content_size == ZSTD_CONTENTSIZE_ERROR)
+                throw runtime_error("Invalid zstd frame");
+            if (content_size != ZSTD_CONTENTSIZE_UNKNOWN) {
+                size_t out_pos = job.out.size();
+                job.out.resize(out_pos + content_size);
+                size_t ret = ZSTD_decompressDCtx(dctx, job.out.data() + out_pos, content_size, frame, frame_size);
+                if (ZSTD_isError(ret))
+                    throw runtime_error(string("Failed to decompress zstd input: ") + ZSTD_getErrorName(ret));
+                job.out.resize(out_pos + ret);
+                continue;
+            }
+            // the frame does not tell its size: inflate as a stream
+            ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+            ZSTD_inBuffer in = { frame, frame_size, 0 };
+            size_t ret = 1;
+            while (ret != 0) {
+                size_t out_pos = job.out.size();
+                job.out.resize(out_pos + max(frame_size * 4, OUTPUT_CHUNK));
+                ZSTD_outBuffer out = { job.out.data() + out_pos, job.out.size() - out_pos, 0 };
+                ret = ZSTD_decompressStream(dctx, &out, &in);
+                if (ZSTD_isError(ret))
+                    throw runtime_error(string("Failed to decompress zstd input: ") + ZSTD_getErrorName(ret));
+                job.out.resize(out_pos + out.pos);
+                if (ret != 0 && in.pos == in.size && out.pos < out.size)
+                    throw runtime_error("Truncated zstd frame");
+            }
+        }
+    }
+#endif
+
+    unique_ptr<std::streambuf>  m_src;
+    input_format                m_format = input_format::plain;
+    unsigned                    m_threads;
+    size_t                      m_max_in_flight;        ///< max number of jobs between the splitter and the consumer
+
+    vector<char>                m_raw;                  ///< raw input, touched by the splitter thread only (or the consumer in the passthrough mode)
+    size_t                      m_raw_pos = 0;
+    size_t                      m_raw_end = 0;
+
+    mutex                       m_mutex;
+    condition_variable          m_cv;
+    deque<job_ptr>              m_ordered;              ///< jobs in input order
+    deque<job_ptr>              m_work;                 ///< jobs waiting for a worker
+    job_ptr                     m_current;              ///< job the get area points into
+    bool                        m_input_done = false;   ///< the splitter has finished
+    bool                        m_stop = false;
+    exception_ptr               m_error;                ///< splitter failure
+
+    thread                      m_splitter;
+    vector<thread>              m_workers;
+};
+
+/**
+ * @brief Puts a parallel_inflate_streambuf on top of the raw input
+ *
+ * @param[in] sb raw input, ownership is transferred to the result
+ * @param[in] threads decompression threads, 0 leaves the stream as is
+ */
+inline std::streambuf* make_parallel_inflate(std::streambuf* sb, unsigned threads)
+{
+    if (threads == 0)
+        return sb;
+    return new parallel_inflate_streambuf(sb, threads);
+}
+
+}  // sharq namespace
+
+#endif
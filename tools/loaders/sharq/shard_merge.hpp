@@ -0,0 +1,526 @@
+#ifndef __SHARD_MERGE_HPP__
+#define __SHARD_MERGE_HPP__
+
+/**
+ * @file shard_merge.hpp
+ * @brief Merging of the partial loads of a sharded run
+ *
+ * With --shard i/N a sharq instance loads a contiguous range of the
+ * input batches; its general-writer stream, saved to a file, is a part
+ * of the run. The parts are combined with --merge: the streams are replayed
+ * one after another into a single writer, so the rows of the parts get
+ * consecutive row ids in the order the parts are given.
+ * The read fingerprints of the parts are summed up and the input file
+ * fingerprints are renumbered; no spot is parsed again.
+ * Each shard checks its own spot names; the names of all shards are collected
+ * while they are replayed and checked for duplicates before the run is completed.
+ */
+
+#include "fastq_writer.hpp"
+#include "fastq_error.hpp"
+#include "spot_name_index.hpp"
+#include <general-writer/general-writer.h>
+#include <fingerprint.hpp>
+#include <json.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <memory>
+#include <fstream>
+#include <stdexcept>
+#include <spdlog/fmt/fmt.h>
+
+using namespace std;
+
+namespace sharq {
+
+/**
+ * @brief Reader of the general-writer stream written by VDB::Writer
+ *
+ * Supports the unpacked protocol in the host byte order.
+ */
+class general_writer_reader
+{
+public:
+    struct event_t {
+        uint32_t code = evt_bad_event;
+        uint32_t id = 0;            ///< table, column or metadata object id
+        uint32_t tid = 0;           ///< table of a new column
+        uint32_t elem_bits = 0;     ///< element size of a new column or of the cell data
+        uint32_t count = 0;         ///< number of elements in data
+        vector<string> str;         ///< string arguments
+        vector<char> data;          ///< cell data
+    };
+
+    /**
+     * @brief Checks the stream header
+     *
+     * @param[in] is general-writer stream
+     * @param[in] name stream name for the error messages
+     */
+    general_writer_reader(istream& is, const string& name)
+        : m_is(is)
+        , m_name(name)
+    {
+        gw_header_v1 hdr;
+        x_read(&hdr, sizeof(hdr));
+        if (memcmp(hdr.dad.signature, GW_SIGNATURE, sizeof(hdr.dad.signature)) != 0)
+            throw runtime_error(fmt::format("'{}' is not a general-writer stream", m_name));
+        if (hdr.dad.endian != GW_GOOD_ENDIAN || hdr.packing != 0)
+            throw runtime_error(fmt::format("'{}': unsupported byte order or packing", m_name));
+        if (hdr.dad.hdr_size > sizeof(hdr))
+            x_skip(hdr.dad.hdr_size - sizeof(hdr));
+    }
+
+    /**
+     * @brief Reads the next event
+     *
+     * @param[out] evt event
+     * @return false at the end of the data
+     */
+    bool next(event_t& evt)
+    {
+        uint32_t id_evt = 0;
+        m_is.read(reinterpret_cast<char*>(&id_evt), sizeof(id_evt));
+        if (m_is.gcount() == 0 && m_is.eof())
+            return false;
+        if (!m_is)
+            throw runtime_error(fmt::format("'{}': truncated event", m_name));
+        m_bytes += sizeof(id_evt);
+        evt.code = id_evt >> 24;
+        evt.id = id_evt & 0xFFFFFF;
+        evt.str.clear();
+        switch (evt.code) {
+        case evt_end_stream:
+        case evt_open_stream:
+        case evt_next_row:
+            break;
+        case evt_errmsg:
+        case evt_remote_path:
+        case evt_new_table:
+        case evt_logmsg:
+        case evt_progmsg:
+            x_read_strings(evt, 1);
+            break;
+        case evt_use_schema:
+        case evt_software_name:
+        case evt_db_metadata_node:
+        case evt_tbl_metadata_node:
+        case evt_col_metadata_node:
+            x_read_strings(evt, 2);
+            break;
+        case evt_db_metadata_node_attr:
+        case evt_tbl_metadata_node_attr:
+        case evt_col_metadata_node_attr:
+            x_read_strings(evt, 3);
+            break;
+        case evt_new_column: {
+            uint32_t hdr[3];    // table_id, elem_bits, name_sz
+            x_read(hdr, sizeof(hdr));
+            evt.tid = hdr[0];
+            evt.elem_bits = hdr[1];
+            evt.str.resize(1);
+            x_read_string(evt.str[0], hdr[2]);
+            x_skip_padding(hdr[2]);
+            m_elem_bits[evt.id] = evt.elem_bits;
+            break;
+        }
+        case evt_cell_default:
+        case evt_cell_data: {
+            auto it = m_elem_bits.find(evt.id);
+            if (it == m_elem_bits.end())
+                throw runtime_error(fmt::format("'{}': data for unknown column {}", m_name, evt.id));
+            x_read(&evt.count, sizeof(evt.count));
+            evt.elem_bits = it->second;
+            size_t size = (size_t(evt.count) * evt.elem_bits + 7) / 8;
+            evt.data.resize(size);
+            x_read(evt.data.data(), size);
+            x_skip_padding(size);
+            break;
+        }
+        default:
+            throw runtime_error(fmt::format("'{}': unsupported general-writer event {}", m_name, evt.code));
+        }
+        return true;
+    }
+
+    size_t bytes() const { return m_bytes; } ///< Returns the number of bytes read after the header
+
+private:
+    void x_read(void* p, size_t size)
+    {
+        m_is.read(static_cast<char*>(p), size);
+        if (!m_is)
+            throw runtime_error(fmt::format("'{}': truncated event", m_name));
+        m_bytes += size;
+    }
+
+    void x_skip(size_t size)
+    {
+        char pad[16];
+        while (size > 0) {
+            size_t n = min(size, sizeof(pad));
+            x_read(pad, n);
+            size -= n;
+        }
+    }
+
+    void x_skip_padding(size_t size)
+    {
+        x_skip((4 - (size & 3)) & 3);
+    }
+
+    void x_read_string(string& s, size_t size)
+    {
+        s.resize(size);
+        if (size > 0)
+            x_read(s.data(), size);
+    }
+
+    void x_read_strings(event_t& evt, size_t n)
+    {
+        uint32_t sizes[3];
+        x_read(sizes, n * sizeof(uint32_t));
+        evt.str.resize(n);
+        size_t total = 0;
+        for (size_t i = 0; i < n; ++i) {
+            x_read_string(evt.str[i], sizes[i]);
+            total += sizes[i];
+        }
+        x_skip_padding(total);
+    }
+
+    istream& m_is;
+    string m_name;
+    map<uint32_t, uint32_t> m_elem_bits;    ///< column id -> element size in bits
+    size_t m_bytes = 0;
+};
+
+
+/**
+ * @brief Replays the general-writer streams of the shards into one writer
+ *
+ * All shards must have the same schema, tables and columns.
+ */
+class shard_merger
+{
+public:
+    struct metrics_t {
+        size_t parts = 0;       ///< shards merged
+        size_t rows = 0;        ///< rows written
+        size_t bytes = 0;       ///< bytes of the shard streams
+        size_t input_files = 0; ///< input file fingerprints
+    };
+
+    /**
+     * @param[in] writer writer of the merged run
+     * @param[in] destination path of the merged archive
+     */
+    shard_merger(shared_ptr<Writer2> writer, const string& destination)
+        : m_writer(std::move(writer))
+        , m_destination(destination)
+    {}
+
+    /**
+     * @brief Merges the shards in the given order and completes the run
+     *
+     * @param[in] parts files with the general-writer streams of the shards
+     */
+    void merge(const vector<string>& parts)
+    {
+        if (parts.empty())
+            throw runtime_error("No shards to merge");
+        for (const auto& part : parts)
+            x_merge_part(part);
+        // the same check as the one of a single load, across the shards
+        m_names.for_each_duplicate([](const string& name, size_t count) {
+            throw fastq_error(170, "Collation check. Duplicate spot '{}', {} occurrences", name, count);
+        });
+        for (const auto& it : m_fingerprints)
+            write_read_fingerprint(*m_writer, it.first, it.second);
+        if (!m_writer->endWriting())
+            throw runtime_error("The merged run has failed");
+        m_writer->flush();
+    }
+
+    const metrics_t& metrics() const { return m_metrics; } ///< Returns the merge statistics
+
+private:
+    using event_t = general_writer_reader::event_t;
+
+    struct column_t {
+        uint32_t tid;
+        uint32_t elem_bits;
+        string spec;
+    };
+
+    /// Tables and columns of a shard, declared before its data
+    struct layout_t {
+        string schema_file;
+        string schema_db;
+        string software_name;
+        string software_version;
+        map<uint32_t, string> tables;       ///< table id -> name
+        map<uint32_t, column_t> columns;    ///< column id -> definition
+        vector<event_t> defaults;           ///< cell defaults
+    };
+
+    static constexpr const char* cFILE_QC = "LOAD/QC/file_";        ///< input file fingerprints
+    static constexpr const char* cCURRENT_QC = "QC/current/";       ///< read fingerprint
+
+    void x_merge_part(const string& path)
+    {
+        ifstream is;
+        vector<char> buffer(1024 * 1024);
+        is.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        is.open(path, ios::in | ios::binary);
+        if (!is)
+            throw runtime_error(fmt::format("Failed to open shard '{}'", path));
+        general_writer_reader reader(is, path);
+        event_t evt;
+
+        // tables and columns
+        layout_t layout;
+        bool is_open = false;
+        while (!is_open && reader.next(evt)) {
+            switch (evt.code) {
+            case evt_remote_path:
+                break;  // the merged run has its own destination
+            case evt_use_schema:
+                layout.schema_file = evt.str[0];
+                layout.schema_db = evt.str[1];
+                break;
+            case evt_software_name:
+                layout.software_name = evt.str[0];
+                layout.software_version = evt.str[1];
+                break;
+            case evt_new_table:
+                layout.tables[evt.id] = evt.str[0];
+                break;
+            case evt_new_column:
+                layout.columns[evt.id] = { evt.tid, evt.elem_bits, evt.str[0] };
+                break;
+            case evt_cell_default:
+                layout.defaults.push_back(evt);
+                break;
+            case evt_open_stream:
+                is_open = true;
+                break;
+            default:
+                x_message(evt, path);
+                break;
+            }
+        }
+        if (!is_open)
+            throw runtime_error(fmt::format("Shard '{}' has no data", path));
+        if (m_metrics.parts == 0)
+            x_open(layout);
+        x_map_layout(layout, path);
+        for (auto& d : layout.defaults)
+            x_default(d);
+
+        // rows and metadata
+        size_t max_file_no = 0;
+        bool is_complete = false;
+        while (!is_complete && reader.next(evt)) {
+            switch (evt.code) {
+            case evt_cell_data:
+                m_part_columns.at(evt.id).setValue(evt.count, evt.elem_bits / 8, evt.data.data());
+                if (m_part_names.count(evt.id) != 0)
+                    m_names.add(evt.data.data(), evt.count);
+                break;
+            case evt_next_row:
+                m_part_tables.at(evt.id).closeRow();
+                ++m_metrics.rows;
+                break;
+            case evt_cell_default:
+                x_default(evt);
+                break;
+            case evt_db_metadata_node:
+            case evt_db_metadata_node_attr:
+                max_file_no = max(max_file_no, x_db_metadata(evt));
+                break;
+            case evt_tbl_metadata_node:
+            case evt_tbl_metadata_node_attr:
+                x_table_metadata(evt);
+                break;
+            case evt_col_metadata_node:
+                m_writer->setMetadata(VDB::Writer::MetaNodeRoot::column, m_part_columns.at(evt.id).id(), evt.str[0], evt.str[1]);
+                break;
+            case evt_col_metadata_node_attr:
+                m_writer->setMetadataAttr(VDB::Writer::MetaNodeRoot::column, m_part_columns.at(evt.id).id(), evt.str[0], evt.str[1], evt.str[2]);
+                break;
+            case evt_end_stream:
+                is_complete = true;
+                break;
+            default:
+                x_message(evt, path);
+                break;
+            }
+        }
+        if (!is_complete)
+            throw runtime_error(fmt::format("Shard '{}' is incomplete", path));
+        m_file_offset += max_file_no;
+        m_metrics.input_files = m_file_offset;
+        m_metrics.bytes += reader.bytes();
+        ++m_metrics.parts;
+    }
+
+    /// Sets up the merged run with the tables and columns of the first shard
+    void x_open(const layout_t& layout)
+    {
+        m_layout = layout;
+        m_writer->destination(m_destination);
+        m_writer->schema(layout.schema_file, layout.schema_db);
+        m_writer->info(layout.software_name, layout.software_version);
+        for (const auto& table : layout.tables) {
+            vector<Writer2::ColumnDefinition> columns;
+            for (const auto& column : layout.columns) {
+                if (column.second.tid == table.first)
+                    columns.emplace_back(column.second.spec.c_str(), column.second.elem_bits / 8, column.second.spec.c_str());
+            }
+            m_writer->addTable(table.second.c_str(), columns);
+        }
+        m_writer->beginWriting();
+    }
+
+    /// Maps the table and column ids of a shard to the ones of the merged run
+    void x_map_layout(const layout_t& layout, const string& path)
+    {
+        auto mismatch = [&path](const string& what) {
+            return runtime_error(fmt::format("Shard '{}' does not match the first shard: {}", path, what));
+        };
+        if (layout.schema_file != m_layout.schema_file || layout.schema_db != m_layout.schema_db)
+            throw mismatch(fmt::format("schema {} {}", layout.schema_file, layout.schema_db));
+        if (layout.tables.size() != m_layout.tables.size() || layout.columns.size() != m_layout.columns.size())
+            throw mismatch("different tables or columns");
+        m_part_tables.clear();
+        m_part_columns.clear();
+        m_part_names.clear();
+        for (const auto& table : layout.tables)
+            m_part_tables[table.first] = m_writer->table(table.second);
+        for (const auto& column : layout.columns) {
+            const auto& c = column.second;
+            if (c.elem_bits % 8 != 0)
+                throw mismatch(fmt::format("column {} has {}-bit elements", c.spec, c.elem_bits));
+            auto table = layout.tables.find(c.tid);
+            if (table == layout.tables.end())
+                throw mismatch(fmt::format("column {} of an unknown table", c.spec));
+            auto same = [&](const pair<const uint32_t, column_t>& m) {
+                return m.second.spec == c.spec && m.second.elem_bits == c.elem_bits && m_layout.tables.at(m.second.tid) == table->second;
+            };
+            if (none_of(m_layout.columns.begin(), m_layout.columns.end(), same))
+                throw mismatch(fmt::format("column {}", c.spec));
+            m_part_columns[column.first] = m_part_tables.at(c.tid).column(c.spec);
+            if (c.elem_bits == 8 && table->second == "SEQUENCE" && s_is_name_column(c.spec))
+                m_part_names.insert(column.first);
+        }
+    }
+
+    /// Tells if the column expression writes the spot name: NAME, (ascii)NAME or RAW_NAME
+    static bool s_is_name_column(const string& spec)
+    {
+        size_t pos = 0;
+        if (!spec.empty() && spec[0] == '(')
+            pos = spec.find(')') + 1;
+        return spec.compare(pos, string::npos, "NAME") == 0 || spec.compare(pos, string::npos, "RAW_NAME") == 0;
+    }
+
+    void x_default(const event_t& evt)
+    {
+        m_part_columns.at(evt.id).setDefault(evt.count, evt.elem_bits / 8, evt.data.data());
+    }
+
+    /**
+     * @brief Forwards database metadata, renumbering the input file fingerprints
+     *
+     * @return number of the input file, 0 for other nodes
+     */
+    size_t x_db_metadata(event_t& evt)
+    {
+        size_t file_no = 0;
+        auto& path = evt.str[0];
+        const size_t prefix_len = strlen(cFILE_QC);
+        if (path.compare(0, prefix_len, cFILE_QC) == 0) {
+            file_no = stoul(path.substr(prefix_len));
+            path = cFILE_QC + to_string(m_file_offset + file_no);
+        }
+        if (evt.code == evt_db_metadata_node)
+            m_writer->setMetadata(VDB::Writer::MetaNodeRoot::database, evt.id, path, evt.str[1]);
+        else
+            m_writer->setMetadataAttr(VDB::Writer::MetaNodeRoot::database, evt.id, path, evt.str[1], evt.str[2]);
+        return file_no;
+    }
+
+    /// Forwards table metadata, sums up the read fingerprints
+    void x_table_metadata(const event_t& evt)
+    {
+        const auto& table = m_part_tables.at(evt.id);
+        const auto& path = evt.str[0];
+        if (path.compare(0, strlen(cCURRENT_QC), cCURRENT_QC) == 0) {
+            // recalculated for the merged run
+            if (evt.code == evt_tbl_metadata_node && path == string(cCURRENT_QC) + "fingerprint")
+                s_add_fingerprint(m_fingerprints[table.id()], evt.str[1]);
+            return;
+        }
+        if (evt.code == evt_tbl_metadata_node)
+            m_writer->setMetadata(VDB::Writer::MetaNodeRoot::table, table.id(), path, evt.str[1]);
+        else
+            m_writer->setMetadataAttr(VDB::Writer::MetaNodeRoot::table, table.id(), path, evt.str[1], evt.str[2]);
+    }
+
+    void x_message(const event_t& evt, const string& path)
+    {
+        switch (evt.code) {
+        case evt_errmsg:
+            m_writer->errorMessage(evt.str[0]);
+            break;
+        case evt_logmsg:
+            m_writer->logMessage(evt.str[0]);
+            break;
+        case evt_progmsg:
+            m_writer->progressMessage(evt.str[0]);
+            break;
+        default:
+            throw runtime_error(fmt::format("Shard '{}': unexpected general-writer event {}", path, evt.code));
+        }
+    }
+
+    /**
+     * @brief Adds the counts of a fingerprint in JSON form
+     *
+     * @param[in,out] fingerprint sum of the fingerprints
+     * @param[in] fingerprint_json fingerprint as produced by Fingerprint::JSON()
+     */
+    static void s_add_fingerprint(Fingerprint& fingerprint, const string& fingerprint_json)
+    {
+        static const pair<const char*, char> cCOUNTERS[] = {
+            { "A", 'A' }, { "C", 'C' }, { "G", 'G' }, { "T", 'T' }, { "N", 'N' }, { "EoR", 0 }
+        };
+        auto j = nlohmann::json::parse(fingerprint_json);
+        for (const auto& [key, base] : cCOUNTERS) {
+            const auto& counts = j.at(key);
+            for (size_t i = 0; i < counts.size(); ++i)
+                fingerprint.record(base, i, counts[i].get<uint64_t>());
+        }
+        fingerprint.record(0, j.at("maximum-position").get<size_t>(), 0);
+    }
+
+    shared_ptr<Writer2> m_writer;
+    string m_destination;
+    layout_t m_layout;                              ///< tables and columns of the merged run
+    map<uint32_t, Writer2::Table> m_part_tables;    ///< table id of the current shard -> merged table
+    map<uint32_t, Writer2::Column> m_part_columns;  ///< column id of the current shard -> merged column
+    set<uint32_t> m_part_names;                     ///< spot name columns of the current shard
+    spot_name_index m_names;                        ///< spot names of all shards, for the collation check
+    map<Writer2::TableID, Fingerprint> m_fingerprints;  ///< merged table -> sum of the read fingerprints
+    size_t m_file_offset = 0;                       ///< input files of the previous shards
+    metrics_t m_metrics;
+};
+
+}  // sharq namespace
+
+#endif
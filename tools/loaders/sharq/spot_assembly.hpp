@@ -7,6 +7,7 @@
  */
 #include "data_frame.hpp"
 #include "fastq_read.hpp"
+#include "spot_spill.hpp"
 #include <string>
 #include <map>
 #include <spdlog/spdlog.h>
@@ -163,6 +164,9 @@ struct spot_assembly_t {
     // multi-threaded version of clear_spot
     template<bool is_nanopore>
     void clear_spot_mt(size_t row_id);
+
+    // returns true if the reads of the spot go to the spill files instead of cold storage
+    bool is_spilled(size_t spot_id) { return m_is_spilling && !m_hot_spot_ids.test(spot_id); }
     bvector_type m_last_index;     ///< bitvector of num_reads size, 1 if read is last in the spot
 
     bvector_type m_rows_to_clear;  ///< bitvector, 1 if row should be cleared
@@ -192,6 +196,12 @@ struct spot_assembly_t {
 
     size_t m_hot_reads_threshold = 10000000;  ///< threshold for hot reads, if read is far from the last read in the spot, it is saved in cold storage
 
+    // out-of-core storage for far spots
+    string m_spill_dir;                   ///< directory for the spill files, far spots are kept in cold storage if empty
+    unsigned m_spill_partitions = sharq::spot_spill_t::DEFAULT_PARTITIONS; ///< number of spill partitions
+    sharq::spot_spill_t m_spill;          ///< far spots storage in spill mode
+    bool m_is_spilling = false;           ///< far spots of the current group are spilled
+
 };
 
 void spot_assembly_t::init(size_t num_rows) 
@@ -218,6 +228,7 @@ void spot_assembly_t::init(size_t num_rows)
     m_qual_offset.clear();
 
     m_total_spots = 0;
+    m_is_spilling = false;
 } 
 
 static bool file_exists(const string& name) 
@@ -512,6 +523,12 @@ void spot_assembly_t::assign_spot_id(str_sv_type& read_names, vector<T>& read_in
     m_qualities.resize(max_reads);
     m_qual_offset.resize(max_reads);
     fill(m_qual_offset.begin(), m_qual_offset.end(), 0);
+
+    if (!m_spill_dir.empty() && m_total_spots > m_hot_spot_ids.count()) {
+        m_spill.open(m_spill_dir, m_spill_partitions);
+        m_is_spilling = true;
+        spdlog::info("Spilling {:L} far spots to {} partitions in '{}'", m_total_spots - m_hot_spot_ids.count(), m_spill_partitions, m_spill_dir);
+    }
 }
 
 // saves read to hot or cold storage
@@ -917,6 +934,8 @@ void spot_assembly_t::clear_spot_mt(size_t row_id)
         m_hot_spots.erase(row_id);
         return;
     }
+    if (m_is_spilling)
+        return; // the spill partition is gone already
 
     m_rows_to_clear.set_bit_no_check(row_id);
     ++m_num_rows_to_clear;
@@ -0,0 +1,419 @@
+#ifndef __SPOT_NAME_INDEX_HPP__
+#define __SPOT_NAME_INDEX_HPP__
+
+/**
+ * @file spot_name_index.hpp
+ * @brief Spot name dictionary for the collation check
+ *
+ * Names are spread over 2^N buckets by their hash. Each bucket keeps
+ * a few sorted runs of names, front coded: every name stores only the length
+ * of the prefix it shares with the previous name and the rest of its bytes.
+ * Every RESTART_INTERVAL-th name is stored in full, so a lookup is
+ * a binary search over those restart points followed by a short scan.
+ *
+ * Added names wait unsorted in their bucket until the bucket is sealed
+ * into a new run. Runs of similar size are merged, so a bucket has
+ * a logarithmic number of runs and every name is merged a logarithmic
+ * number of times. flush() seals all buckets in parallel.
+ *
+ * The dictionary can be saved to and loaded from a file (--spot_file, --hash).
+ */
+
+#include "taskflow/taskflow.hpp"
+#include "taskflow/algorithm/for_each.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <spdlog/fmt/fmt.h>
+
+using namespace std;
+
+namespace sharq {
+
+/**
+ * @brief Hashed and front coded dictionary of spot names
+ *
+ * add() is not thread-safe, count() can be called concurrently
+ * as long as no thread adds or flushes.
+ */
+class spot_name_index
+{
+public:
+    static constexpr unsigned DEFAULT_BUCKET_BITS = 10;
+    static constexpr size_t RESTART_INTERVAL = 16;  ///< names between two full names in a run
+    static constexpr size_t PENDING_LIMIT = 1024;   ///< unsorted names a bucket holds before it is sealed
+
+    explicit spot_name_index(unsigned bucket_bits = DEFAULT_BUCKET_BITS)
+    {
+        x_init(bucket_bits);
+    }
+    spot_name_index(const spot_name_index&) = delete;
+    spot_name_index& operator=(const spot_name_index&) = delete;
+
+    /// Number of names added
+    size_t size() const { return m_size; }
+
+    void add(const string& name) { add(name.data(), name.size()); }
+
+    void add(const char* name, size_t sz)
+    {
+        auto& bucket = m_buckets[s_hash(name, sz) & m_mask];
+        bucket.pending_offsets.push_back(bucket.pending.size());
+        bucket.pending.insert(bucket.pending.end(), name, name + sz);
+        ++m_size;
+        if (bucket.pending_offsets.size() >= PENDING_LIMIT)
+            x_seal(bucket);
+    }
+
+    /**
+     * @brief Sorts the pending names of all buckets into runs
+     *
+     * Names added since the last flush are not seen by count().
+     *
+     * @param[in] compact merge all runs of a bucket into one
+     */
+    void flush(bool compact = false)
+    {
+        auto seal = [this, compact](bucket_t& bucket) {
+            x_seal(bucket);
+            while (compact && bucket.runs.size() > 1)
+                x_merge_last(bucket);
+        };
+        if (m_size < PENDING_LIMIT * 16) {
+            for (auto& bucket : m_buckets)
+                seal(bucket);
+            return;
+        }
+        if (!m_executor)
+            m_executor.reset(new tf::Executor(max<unsigned>(1, min<unsigned>(24, thread::hardware_concurrency()))));
+        tf::Taskflow taskflow;
+        taskflow.for_each(m_buckets.begin(), m_buckets.end(), seal);
+        m_executor->run(taskflow).wait();
+    }
+
+    /**
+     * @brief Number of times the name was added (as of the last flush)
+     */
+    size_t count(const string& name) const
+    {
+        const auto& bucket = m_buckets[s_hash(name.data(), name.size()) & m_mask];
+        size_t n = 0;
+        for (const auto& run : bucket.runs)
+            n += x_count(run, name);
+        return n;
+    }
+
+    /**
+     * @brief Calls f(name, count) for every name added more than once
+     *
+     * Flushes and compacts the dictionary. Names come sorted within a bucket.
+     */
+    template<typename F>
+    void for_each_duplicate(F&& f)
+    {
+        flush(true);
+        for (const auto& bucket : m_buckets) {
+            if (bucket.runs.empty())
+                continue;
+            run_reader_t reader(bucket.runs.front());
+            string prev;
+            size_t n = 0;
+            while (reader.next()) {
+                if (n > 0 && reader.key == prev) {
+                    ++n;
+                    continue;
+                }
+                if (n > 1)
+                    f(prev, n);
+                prev = reader.key;
+                n = 1;
+            }
+            if (n > 1)
+                f(prev, n);
+        }
+    }
+
+    /// Bytes held by the runs and the pending names
+    size_t memory_used() const
+    {
+        size_t bytes = m_buckets.capacity() * sizeof(bucket_t);
+        for (const auto& bucket : m_buckets) {
+            bytes += bucket.pending.capacity() + bucket.pending_offsets.capacity() * sizeof(uint32_t);
+            for (const auto& run : bucket.runs)
+                bytes += run.data.capacity() + run.restarts.capacity() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief Saves the compacted dictionary
+     */
+    void save(const string& file_name)
+    {
+        flush(true);
+        ofstream os(file_name, ofstream::out | ofstream::binary);
+        os.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+        x_put<uint32_t>(os, m_bits);
+        x_put<uint64_t>(os, m_size);
+        for (const auto& bucket : m_buckets) {
+            x_put<uint64_t>(os, bucket.runs.size());
+            for (const auto& run : bucket.runs) {
+                x_put<uint64_t>(os, run.count);
+                x_put<uint64_t>(os, run.data.size());
+                os.write(reinterpret_cast<const char*>(run.data.data()), run.data.size());
+                x_put<uint64_t>(os, run.restarts.size());
+                os.write(reinterpret_cast<const char*>(run.restarts.data()), run.restarts.size() * sizeof(uint64_t));
+            }
+        }
+        if (!os)
+            throw runtime_error(fmt::format("Failed to write spot name file '{}'", file_name));
+    }
+
+    /**
+     * @brief Replaces the dictionary with the one saved in the file
+     */
+    void load(const string& file_name)
+    {
+        ifstream is(file_name, ifstream::in | ifstream::binary);
+        char magic[sizeof(FILE_MAGIC)] = {0};
+        is.read(magic, sizeof(magic));
+        if (!is || memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0)
+            throw runtime_error(fmt::format("'{}' is not a spot name file", file_name));
+        auto bits = x_get<uint32_t>(is);
+        if (bits > 24)
+            throw runtime_error(fmt::format("Corrupted spot name file '{}'", file_name));
+        x_init(bits);
+        m_size = x_get<uint64_t>(is);
+        for (auto& bucket : m_buckets) {
+            bucket.runs.resize(x_get<uint64_t>(is));
+            for (auto& run : bucket.runs) {
+                run.count = x_get<uint64_t>(is);
+                run.data.resize(x_get<uint64_t>(is));
+                is.read(reinterpret_cast<char*>(run.data.data()), run.data.size());
+                run.restarts.resize(x_get<uint64_t>(is));
+                is.read(reinterpret_cast<char*>(run.restarts.data()), run.restarts.size() * sizeof(uint64_t));
+            }
+            if (!is)
+                throw runtime_error(fmt::format("Corrupted spot name file '{}'", file_name));
+        }
+    }
+
+private:
+    static constexpr char FILE_MAGIC[8] = {'S', 'H', 'Q', 'N', 'I', 'D', 'X', '1'};
+
+    /**
+     * @brief Sorted front coded names
+     *
+     * Each name is varint(shared prefix), varint(suffix length), suffix.
+     */
+    struct run_t {
+        vector<uint8_t>  data;
+        vector<uint64_t> restarts;      ///< offsets of the names stored in full
+        size_t           count = 0;     ///< names in the run
+    };
+
+    struct bucket_t {
+        vector<char>     pending;           ///< unsorted names, back to back
+        vector<uint32_t> pending_offsets;   ///< start of each pending name
+        vector<run_t>    runs;              ///< oldest (largest) first
+    };
+
+    /// Appends sorted names to a run
+    struct run_writer_t {
+        run_t& run;
+        string last;
+
+        explicit run_writer_t(run_t& r) : run(r) {}
+
+        void add(string_view name)
+        {
+            size_t shared = 0;
+            if (run.count % RESTART_INTERVAL == 0) {
+                run.restarts.push_back(run.data.size());
+            } else {
+                size_t max_shared = min(last.size(), name.size());
+                while (shared < max_shared && last[shared] == name[shared])
+                    ++shared;
+            }
+            s_put_varint(run.data, shared);
+            s_put_varint(run.data, name.size() - shared);
+            run.data.insert(run.data.end(), name.begin() + shared, name.end());
+            last.assign(name.data(), name.size());
+            ++run.count;
+        }
+    };
+
+    /// Decodes the names of a run in order
+    struct run_reader_t {
+        const run_t& run;
+        size_t pos;
+        string key;
+
+        explicit run_reader_t(const run_t& r, size_t start = 0) : run(r), pos(start) {}
+
+        bool next()
+        {
+            if (pos >= run.data.size())
+                return false;
+            size_t shared = s_get_varint(run.data, pos);
+            size_t sz = s_get_varint(run.data, pos);
+            key.resize(shared);
+            key.append(reinterpret_cast<const char*>(&run.data[pos]), sz);
+            pos += sz;
+            return true;
+        }
+    };
+
+    void x_init(unsigned bits)
+    {
+        m_bits = bits;
+        m_mask = (size_t(1) << bits) - 1;
+        m_size = 0;
+        m_buckets.clear();
+        m_buckets.resize(m_mask + 1);
+    }
+
+    /// Sorts the pending names of the bucket into a new run
+    void x_seal(bucket_t& bucket)
+    {
+        auto& offsets = bucket.pending_offsets;
+        if (offsets.empty())
+            return;
+        vector<string_view> names;
+        names.reserve(offsets.size());
+        for (size_t i = 0; i < offsets.size(); ++i) {
+            size_t end = i + 1 < offsets.size() ? offsets[i + 1] : bucket.pending.size();
+            names.emplace_back(bucket.pending.data() + offsets[i], end - offsets[i]);
+        }
+        sort(names.begin(), names.end());
+        bucket.runs.emplace_back();
+        run_writer_t writer(bucket.runs.back());
+        for (const auto& name : names)
+            writer.add(name);
+        bucket.pending.clear();
+        offsets.clear();
+        // keep run sizes geometric
+        while (bucket.runs.size() > 1 && bucket.runs[bucket.runs.size() - 2].count <= 2 * bucket.runs.back().count)
+            x_merge_last(bucket);
+    }
+
+    /// Merges the two newest runs of the bucket
+    static void x_merge_last(bucket_t& bucket)
+    {
+        auto& runs = bucket.runs;
+        run_t merged;
+        merged.data.reserve(runs[runs.size() - 2].data.size() + runs.back().data.size());
+        {
+            run_writer_t writer(merged);
+            run_reader_t left(runs[runs.size() - 2]), right(runs.back());
+            bool has_left = left.next(), has_right = right.next();
+            while (has_left || has_right) {
+                if (has_left && (!has_right || left.key <= right.key)) {
+                    writer.add(left.key);
+                    has_left = left.next();
+                } else {
+                    writer.add(right.key);
+                    has_right = right.next();
+                }
+            }
+        }
+        runs.pop_back();
+        runs.back() = std::move(merged);
+    }
+
+    /// Counts the name in a run
+    static size_t x_count(const run_t& run, const string& name)
+    {
+        // first restart with a key >= name, the name can start in the block before it
+        size_t lo = 0, hi = run.restarts.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (s_restart_key(run, mid) < name)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo == run.restarts.size() && lo == 0)
+            return 0;
+        run_reader_t reader(run, run.restarts[lo > 0 ? lo - 1 : 0]);
+        size_t n = 0;
+        while (reader.next()) {
+            int cmp = reader.key.compare(name);
+            if (cmp == 0)
+                ++n;
+            else if (cmp > 0)
+                break;
+        }
+        return n;
+    }
+
+    static string_view s_restart_key(const run_t& run, size_t i)
+    {
+        size_t pos = run.restarts[i];
+        s_get_varint(run.data, pos); // shared prefix, always 0
+        size_t sz = s_get_varint(run.data, pos);
+        return string_view(reinterpret_cast<const char*>(&run.data[pos]), sz);
+    }
+
+    static void s_put_varint(vector<uint8_t>& data, size_t v)
+    {
+        while (v >= 0x80) {
+            data.push_back(uint8_t(v) | 0x80);
+            v >>= 7;
+        }
+        data.push_back(uint8_t(v));
+    }
+
+    static size_t s_get_varint(const vector<uint8_t>& data, size_t& pos)
+    {
+        size_t v = 0;
+        for (unsigned shift = 0; ; shift += 7) {
+            uint8_t b = data[pos++];
+            v |= size_t(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return v;
+        }
+    }
+
+    /// FNV-1a, fixed so that saved dictionaries stay valid across builds
+    static uint64_t s_hash(const char* s, size_t sz)
+    {
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < sz; ++i) {
+            h ^= uint8_t(s[i]);
+            h *= 1099511628211ull;
+        }
+        return h ^ (h >> 32);
+    }
+
+    template<typename T>
+    static void x_put(ostream& os, T v)
+    {
+        os.write(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    template<typename T>
+    static T x_get(istream& is)
+    {
+        T v{};
+        is.read(reinterpret_cast<char*>(&v), sizeof(T));
+        return v;
+    }
+
+    unsigned         m_bits = 0;
+    size_t           m_mask = 0;
+    size_t           m_size = 0;        ///< names added
+    vector<bucket_t> m_buckets;
+    unique_ptr<tf::Executor> m_executor;    ///< created on the first parallel flush
+};
+
+}  // sharq namespace
+
+#endif
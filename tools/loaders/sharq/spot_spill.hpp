@@ -0,0 +1,285 @@
+#ifndef __SPOT_SPILL_HPP__
+#define __SPOT_SPILL_HPP__
+
+/**
+ * @file spot_spill.hpp
+ * @brief Out-of-core storage for far reads of the spot assembly
+ *
+ * The reads of spots whose mates are too far apart to be kept in memory
+ * are appended to one of N partition files, picked by the hash of the spot name.
+ * All reads of a spot land in the same partition, in input order.
+ *
+ * Once the input is exhausted the partitions are read back one at a time:
+ * a spot is complete when its last read is seen, so only the
+ * unfinished spots of a single partition are held in memory.
+ * Within a partition the spots come out in the order of their last read.
+ */
+
+#include "fastq_read.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdio>
+#include <unistd.h>
+#include <spdlog/fmt/fmt.h>
+
+using namespace std;
+
+namespace sharq {
+
+/**
+ * @brief Partitioned on-disk store of the reads of far spots
+ *
+ * Not thread-safe: reads are saved and spots assembled from the same thread.
+ */
+class spot_spill_t
+{
+public:
+    static constexpr unsigned DEFAULT_PARTITIONS = 64;
+    static constexpr size_t BUFFER_SIZE = 256 * 1024;   ///< write buffer per partition
+
+    /**
+     * @brief Spill statistics, accumulated over all uses of the store
+     */
+    struct metrics_t {
+        size_t bytes = 0;               ///< bytes written to the partitions
+        size_t reads = 0;               ///< reads spilled
+        size_t spots = 0;               ///< spots assembled from the partitions
+        size_t partitions = 0;          ///< partition files created
+        size_t max_partition_bytes = 0; ///< largest partition
+        size_t max_pending_reads = 0;   ///< max reads held in memory while assembling a partition
+    };
+
+    spot_spill_t() = default;
+    spot_spill_t(const spot_spill_t&) = delete;
+    spot_spill_t& operator=(const spot_spill_t&) = delete;
+    ~spot_spill_t() { close(); }
+
+    /**
+     * @brief Creates the partition files
+     *
+     * @param[in] dir directory for the partition files
+     * @param[in] num_partitions number of partitions
+     */
+    void open(const string& dir, unsigned num_partitions)
+    {
+        close();
+        if (num_partitions == 0)
+            num_partitions = DEFAULT_PARTITIONS;
+        static unsigned s_instance = 0;
+        string prefix = fmt::format("{}/sharq.{}.{}", dir.empty() ? string(".") : dir, getpid(), s_instance++);
+        m_partitions.resize(num_partitions);
+        for (unsigned i = 0; i < num_partitions; ++i) {
+            auto& p = m_partitions[i];
+            p.file_name = fmt::format("{}.{}.spill", prefix, i);
+            p.stream.open(p.file_name, ios::out | ios::binary | ios::trunc);
+            if (!p.stream)
+                throw runtime_error(fmt::format("Failed to create spill file '{}'", p.file_name));
+            p.buffer.reserve(BUFFER_SIZE);
+        }
+        m_metrics.partitions += num_partitions;
+    }
+
+    bool is_open() const { return !m_partitions.empty(); } ///< Returns true if the partitions are created
+
+    /**
+     * @brief Appends read to the partition of its spot
+     *
+     * @param[in] read read with assigned m_SpotId
+     * @param[in] is_last true if this is the last read of the spot
+     */
+    void save_read(const fastq_read& read, bool is_last)
+    {
+        assert(is_open());
+        auto& p = m_partitions[hash<string>{}(read.Spot()) % m_partitions.size()];
+        auto& b = p.buffer;
+        x_put<uint64_t>(b, read.m_SpotId);
+        x_put<uint8_t>(b, (is_last ? 1 : 0) | (read.ReadFilter() ? 2 : 0));
+        x_put<uint8_t>(b, read.m_ReaderIdx);
+        x_put<uint64_t>(b, read.LineNumber());
+        if (is_last)
+            x_put_str(b, read.Spot());
+        x_put_str(b, read.ReadNum());
+        x_put_str(b, read.SpotGroup());
+        x_put_str(b, read.Suffix());
+        x_put_str(b, read.Channel());
+        x_put_str(b, read.NanoporeReadNo());
+        x_put_str(b, read.Sequence());
+        const auto& qual_scores = read.GetQualScores();
+        x_put<uint32_t>(b, qual_scores.size());
+        b.insert(b.end(), qual_scores.begin(), qual_scores.end());
+        ++m_metrics.reads;
+        if (b.size() >= BUFFER_SIZE)
+            x_flush(p);
+    }
+
+    /**
+     * @brief Reads the partitions back and calls f for every complete spot
+     *
+     * The reads of the spot are in input order, the last read
+     * carries the spot name. The partition files are removed.
+     *
+     * @param[in] f callback taking vector<fastq_read>&
+     */
+    template<typename F>
+    void assemble(F&& f)
+    {
+        for (auto& p : m_partitions)
+            x_flush(p);
+        unordered_map<uint64_t, vector<fastq_read>> pending;
+        vector<fastq_read> spot;
+        for (auto& p : m_partitions) {
+            p.stream.close();
+            m_metrics.bytes += p.size;
+            m_metrics.max_partition_bytes = max(m_metrics.max_partition_bytes, p.size);
+            ifstream is(p.file_name, ios::in | ios::binary);
+            if (!is)
+                throw runtime_error(fmt::format("Failed to open spill file '{}'", p.file_name));
+            size_t num_pending = 0;
+            fastq_read read;
+            bool is_last = false;
+            while (x_get_read(is, read, is_last)) {
+                auto spot_id = read.m_SpotId;
+                if (!is_last) {
+                    pending[spot_id].push_back(std::move(read));
+                    m_metrics.max_pending_reads = max(m_metrics.max_pending_reads, ++num_pending);
+                    continue;
+                }
+                spot.clear();
+                auto it = pending.find(spot_id);
+                if (it != pending.end()) {
+                    num_pending -= it->second.size();
+                    spot = std::move(it->second);
+                    pending.erase(it);
+                }
+                spot.push_back(std::move(read));
+                ++m_metrics.spots;
+                f(spot);
+            }
+            if (!is.eof())
+                throw runtime_error(fmt::format("Failed to read spill file '{}'", p.file_name));
+            if (!pending.empty())
+                throw runtime_error(fmt::format("Spill file '{}' has {} incomplete spots", p.file_name, pending.size()));
+            is.close();
+            remove(p.file_name.c_str());
+            p.file_name.clear();
+        }
+        m_partitions.clear();
+    }
+
+    /**
+     * @brief Removes the partition files
+     */
+    void close()
+    {
+        for (auto& p : m_partitions) {
+            if (p.stream.is_open())
+                p.stream.close();
+            if (!p.file_name.empty())
+                remove(p.file_name.c_str());
+        }
+        m_partitions.clear();
+    }
+
+    const metrics_t& metrics() const { return m_metrics; } ///< Returns the spill statistics
+
+private:
+    struct partition_t {
+        string file_name;
+        ofstream stream;
+        vector<char> buffer;    ///< data not yet written to stream
+        size_t size = 0;        ///< bytes written to stream
+    };
+
+    template<typename T>
+    static void x_put(vector<char>& b, T v)
+    {
+        const char* p = reinterpret_cast<const char*>(&v);
+        b.insert(b.end(), p, p + sizeof(T));
+    }
+
+    static void x_put_str(vector<char>& b, const string& s)
+    {
+        x_put<uint32_t>(b, s.size());
+        b.insert(b.end(), s.begin(), s.end());
+    }
+
+    template<typename T>
+    static T x_get(istream& is)
+    {
+        T v{};
+        is.read(reinterpret_cast<char*>(&v), sizeof(T));
+        return v;
+    }
+
+    static string& x_get_str(istream& is, string& s)
+    {
+        s.resize(x_get<uint32_t>(is));
+        if (!s.empty())
+            is.read(s.data(), s.size());
+        return s;
+    }
+
+    void x_flush(partition_t& p)
+    {
+        if (p.buffer.empty())
+            return;
+        p.stream.write(p.buffer.data(), p.buffer.size());
+        if (!p.stream)
+            throw runtime_error(fmt::format("Failed to write spill file '{}'", p.file_name));
+        p.size += p.buffer.size();
+        p.buffer.clear();
+    }
+
+    /**
+     * @brief Reads the next read from the partition
+     *
+     * @return false at the end of the partition
+     */
+    bool x_get_read(istream& is, fastq_read& read, bool& is_last)
+    {
+        read.Reset();
+        auto spot_id = x_get<uint64_t>(is);
+        if (!is)
+            return false;
+        auto flags = x_get<uint8_t>(is);
+        is_last = (flags & 1) != 0;
+        read.m_SpotId = spot_id;
+        read.m_ReaderIdx = x_get<uint8_t>(is);
+        read.SetLineNumber(x_get<uint64_t>(is));
+        if (flags & 2)
+            read.SetReadFilter(1);
+        if (is_last)
+            read.SetSpot(x_get_str(is, m_str));
+        if (!x_get_str(is, m_str).empty())
+            read.SetReadNum(m_str);
+        if (!x_get_str(is, m_str).empty())
+            read.SetSpotGroup(m_str);
+        if (!x_get_str(is, m_str).empty())
+            read.SetSuffix(m_str);
+        if (!x_get_str(is, m_str).empty())
+            read.SetChannel(m_str);
+        if (!x_get_str(is, m_str).empty())
+            read.SetNanoporeReadNo(m_str);
+        read.SetSequence(x_get_str(is, m_str));
+        vector<uint8_t> qual_scores(x_get<uint32_t>(is));
+        if (!qual_scores.empty())
+            is.read(reinterpret_cast<char*>(qual_scores.data()), qual_scores.size());
+        read.SetQualScores(std::move(qual_scores));
+        if (!is)
+            throw runtime_error("Truncated spill record");
+        return true;
+    }
+
+    vector<partition_t> m_partitions;
+    metrics_t m_metrics;
+    string m_str;           ///< scratch string for reading
+};
+
+}  // sharq namespace
+
+#endif
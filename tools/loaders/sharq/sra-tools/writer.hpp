@@ -264,6 +264,14 @@ namespace VDB {
         {
             return write(code, cid, (uint32_t)data.size(), (uint32_t)sizeof(std::string::value_type), data.data());
         }
+    protected:
+        // for writers that consume the events in-process instead of serializing them
+        Writer(ostream& stream_, bool write_header)
+        : stream(stream_)
+        {
+            if (write_header)
+                StreamHeader().write(stream);
+        }
     public:
         Writer(ostream& stream_)
         : stream(stream_)
@@ -271,17 +279,17 @@ namespace VDB {
             StreamHeader().write(stream);
         }
 
-        bool logMessage(std::string const &message) const
+        virtual bool logMessage(std::string const &message) const
         {
             return String1Event(logMesg, 0, message).write(stream);
         }
 
-        bool progressMessage(std::string const &message) const
+        virtual bool progressMessage(std::string const &message) const
         {
             return String1Event(progressMesg, 0, message).write(stream);
         }
 
-        bool errorMessage(std::string const &message) const
+        virtual bool errorMessage(std::string const &message) const
         {
             return String1Event(errMessage, 0, message).write(stream);
         }
@@ -296,61 +304,67 @@ namespace VDB {
             return String2Event(useSchema, 0, file, dbSpec).write(stream);
         }
 
-        bool info(std::string const &name, std::string const &version) const
+        virtual bool info(std::string const &name, std::string const &version) const
         {
             return String2Event(writerName, 0, name, version).write(stream);
         }
 
-        bool openTable(unsigned const tid, std::string const &name) const
+        virtual bool openTable(unsigned const tid, std::string const &name) const
         {
             return String1Event(newTable, tid, name).write(stream);
         }
 
-        bool openColumn(unsigned const cid, unsigned const tid, unsigned const elemBits, std::string const &colSpec) const
+        virtual bool openColumn(unsigned const cid, unsigned const tid, unsigned const elemBits, std::string const &colSpec) const
         {
             return ColumnEvent(newColumn, cid, tid, elemBits, colSpec).write(stream);
         }
 
-        bool beginWriting() const
+        virtual bool beginWriting() const
         {
             return SimpleEvent(openStream, 0).write(stream);
         }
 
+        // all typed cell values end up in these two
+        virtual bool defaultValue(unsigned const cid, uint32_t const count, uint32_t const elsize, void const *data) const
+        {
+            return write(cellDefault, cid, count, elsize, data);
+        }
+        virtual bool value(unsigned const cid, uint32_t const count, uint32_t const elsize, void const *data) const
+        {
+            return write(cellData, cid, count, elsize, data);
+        }
+
         template <typename T>
         bool defaultValue(unsigned const cid, uint32_t const count, T const *data) const
         {
-            return write(cellDefault, cid, count, data);
+            return defaultValue(cid, count, (uint32_t)sizeof(T), (void const *)data);
         }
         template <typename T>
         bool defaultValue(unsigned const cid, T const &data) const
         {
-            return write(cellDefault, cid, 1, &data);
+            return defaultValue(cid, 1, (uint32_t)sizeof(T), (void const *)&data);
         }
         bool defaultValue(unsigned const cid, std::string const &data) const
         {
-            return write(cellDefault, cid, data);
+            return defaultValue(cid, (uint32_t)data.size(), (uint32_t)sizeof(std::string::value_type), (void const *)data.data());
         }
 
-        bool value(unsigned const cid, uint32_t const count, uint32_t const elsize, void const *data) const
-        {
-            return write(cellData, cid, count, elsize, data);
-        }
         template <typename T>
         bool value(unsigned const cid, uint32_t const count, T const *data) const
         {
-            return write(cellData, cid, count, data);
+            return value(cid, count, (uint32_t)sizeof(T), (void const *)data);
         }
         template <typename T>
         bool value(unsigned const cid, T const &data) const
         {
-            return write(cellData, cid, 1, &data);
+            return value(cid, 1, (uint32_t)sizeof(T), (void const *)&data);
         }
         bool value(unsigned const cid, std::string const &data) const
         {
-            return write(cellData, cid, data);
+            return value(cid, (uint32_t)data.size(), (uint32_t)sizeof(std::string::value_type), (void const *)data.data());
         }
 
-        bool closeRow(unsigned const tid) const
+        virtual bool closeRow(unsigned const tid) const
         {
             return SimpleEvent(nextRow, tid).write(stream);
         }
@@ -375,11 +389,11 @@ namespace VDB {
             return String3Event(code, oid, path, attr, value).write(stream);
         }
 
-        bool endWriting() const
+        virtual bool endWriting() const
         {
             return SimpleEvent(endStream, 0).write(stream);
         }
-        void flush() const {
+        virtual void flush() const {
             stream.flush();
         }
         virtual ~Writer() = default;
@@ -495,9 +509,15 @@ public:
         bool setDefault(std::string const &data) const {
             return parent->defaultValue(columnNumber, data);
         }
+        bool setDefault(unsigned count, unsigned elsize, void const *data) const {
+            return parent->defaultValue(columnNumber, count, elsize, data);
+        }
         bool setDefaultEmpty() const {
             return parent->defaultValue(columnNumber, 0, "");
         }
+        ColumnID id() const {
+            return columnNumber;
+        }
     };
 
     Table table(std::string const &table) const {
@@ -510,6 +530,14 @@ public:
     , nextColumn(0)
     {
     }
+protected:
+    Writer2(ostream& stream, bool write_header)
+    : VDB::Writer(stream, write_header)
+    , nextTable(0)
+    , nextColumn(0)
+    {
+    }
+public:
     void addTable(char const *name, std::vector<ColumnDefinition> const &list)
     {
         decltype(tables.begin()->second.second) columns;
@@ -0,0 +1,196 @@
+#ifndef __STAGE_QUEUE_HPP__
+#define __STAGE_QUEUE_HPP__
+
+/**
+ * @file stage_queue.hpp
+ * @brief Bounded lock-free queue between the stages of the parsing pipeline
+ *
+ * mpmc_queue is a fixed size ring of cells, each with a sequence number
+ * telling whether the cell is ready to be written or to be read
+ * (D. Vyukov's bounded MPMC queue). Producers and consumers claim cells
+ * with a CAS on their own position counter and never wait on each other
+ * except when the ring is full or empty.
+ *
+ * queue_stats_t is the utilization summary of one queue, kept by the
+ * pipeline's queue_t and reported in the telemetry.
+ */
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+namespace sharq {
+
+/**
+ * @brief Bounded multi-producer multi-consumer queue
+ *
+ * Capacity is rounded up to a power of 2.
+ * T must be default constructible and move assignable.
+ */
+template<typename T>
+class mpmc_queue
+{
+public:
+    explicit mpmc_queue(size_t capacity)
+        : m_mask(s_round_up(capacity) - 1)
+        , m_cells(new cell_t[m_mask + 1])
+    {
+        for (size_t i = 0; i <= m_mask; ++i)
+            m_cells[i].sequence.store(i, memory_order_relaxed);
+    }
+    mpmc_queue(const mpmc_queue&) = delete;
+    mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+    size_t capacity() const { return m_mask + 1; }
+
+    /// Moves item into the queue, returns false (item is untouched) if the queue is full
+    bool try_enqueue(T&& item)
+    {
+        size_t pos = m_enqueue_pos.load(memory_order_relaxed);
+        cell_t* cell;
+        while (true) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueue_pos.load(memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(item);
+        cell->sequence.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    /// Moves the oldest item out of the queue, returns false if the queue is empty
+    bool try_dequeue(T& item)
+    {
+        size_t pos = m_dequeue_pos.load(memory_order_relaxed);
+        cell_t* cell;
+        while (true) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_dequeue_pos.load(memory_order_relaxed);
+            }
+        }
+        item = std::move(cell->data);
+        cell->sequence.store(pos + m_mask + 1, memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Moves items[first..] into the queue until it is full
+     *
+     * @return number of items enqueued
+     */
+    size_t try_enqueue_bulk(vector<T>& items, size_t first = 0)
+    {
+        size_t i = first;
+        while (i < items.size() && try_enqueue(std::move(items[i])))
+            ++i;
+        return i - first;
+    }
+
+    /**
+     * @brief Appends up to max_items to items
+     *
+     * @return number of items dequeued
+     */
+    size_t try_dequeue_bulk(vector<T>& items, size_t max_items)
+    {
+        size_t n = 0;
+        T item;
+        while (n < max_items && try_dequeue(item)) {
+            items.push_back(std::move(item));
+            ++n;
+        }
+        return n;
+    }
+
+    /// Number of items in the queue, exact only when no thread is enqueuing or dequeuing
+    size_t size_approx() const
+    {
+        size_t tail = m_dequeue_pos.load(memory_order_acquire);
+        size_t head = m_enqueue_pos.load(memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+
+    bool empty_approx() const { return size_approx() == 0; }
+
+private:
+    struct cell_t {
+        atomic<size_t> sequence;
+        T data;
+    };
+
+    static size_t s_round_up(size_t n)
+    {
+        size_t v = 2;
+        while (v < n)
+            v <<= 1;
+        return v;
+    }
+
+    const size_t m_mask;
+    unique_ptr<cell_t[]> m_cells;
+    alignas(64) atomic<size_t> m_enqueue_pos{0};    ///< next cell to write
+    alignas(64) atomic<size_t> m_dequeue_pos{0};    ///< next cell to read
+};
+
+
+/**
+ * @brief Utilization of a stage queue
+ *
+ * Idle times are summed over all threads of the side,
+ * so with several workers they can exceed the wall time.
+ */
+struct queue_stats_t {
+    size_t capacity = 0;
+    size_t producers = 0;           ///< threads enqueuing
+    size_t consumers = 0;           ///< threads dequeuing
+    size_t enqueued = 0;
+    size_t dequeued = 0;
+    size_t max_occupancy = 0;       ///< max items in the queue
+    size_t occupancy_sum = 0;       ///< items in the queue, summed at every enqueue
+    double producer_idle = 0;       ///< seconds producers waited on a full queue
+    double consumer_idle = 0;       ///< seconds consumers waited on an empty queue
+    double wall = 0;                ///< seconds from the creation of the queue to the last dequeue
+
+    double avg_occupancy() const { return enqueued ? double(occupancy_sum) / enqueued : 0; }
+
+    /// Accumulates the stats of the same stage over several groups or readers
+    queue_stats_t& operator+=(const queue_stats_t& other)
+    {
+        capacity = max(capacity, other.capacity);
+        producers = max(producers, other.producers);
+        consumers = max(consumers, other.consumers);
+        enqueued += other.enqueued;
+        dequeued += other.dequeued;
+        max_occupancy = max(max_occupancy, other.max_occupancy);
+        occupancy_sum += other.occupancy_sum;
+        producer_idle += other.producer_idle;
+        consumer_idle += other.consumer_idle;
+        wall += other.wall;
+        return *this;
+    }
+};
+
+}  // sharq namespace
+
+#endif